@@ -31,11 +31,13 @@
 #include <AsyncComm/ApplicationQueueInterface.h>
 #include <AsyncComm/ApplicationHandler.h>
 
+#include <Common/LatencyHistogram.h>
 #include <Common/Logger.h>
 #include <Common/Mutex.h>
 #include <Common/ReferenceCount.h>
 #include <Common/StringExt.h>
 #include <Common/Thread.h>
+#include <Common/Time.h>
 
 #include <boost/thread/condition.hpp>
 #include <boost/thread/xtime.hpp>
@@ -111,10 +113,12 @@ namespace Hypertable {
      */
     class RequestRec {
     public:
-      RequestRec(ApplicationHandler *arh) : handler(arh), group_state(0) { return; }
+      RequestRec(ApplicationHandler *arh)
+        : handler(arh), group_state(0), enqueue_time(get_ts64()) { return; }
       ~RequestRec() { delete handler; }
       ApplicationHandler *handler; //!< Pointer to ApplicationHandler
       GroupState *group_state;     //!< Pointer to GroupState to which request belongs
+      int64_t enqueue_time;        //!< Time request was added (nanoseconds)
     };
 
     /** Individual request queue
@@ -157,6 +161,9 @@ namespace Hypertable {
 
       /// Flag indicating if queue has been paused
       bool paused;
+
+      /// Time requests spent in the queue before a worker picked them up
+      LatencyHistogram queue_wait;
     };
 
     /** Application queue worker thread function (functor)
@@ -248,6 +255,8 @@ namespace Hypertable {
           }
 
           if (rec) {
+            int64_t wait = get_ts64() - rec->enqueue_time;
+            m_state.queue_wait.record(wait > 0 ? wait / 1000 : 0);
             if (rec->handler)
               rec->handler->run();
             remove(rec);
@@ -367,6 +376,16 @@ namespace Hypertable {
       return m_thread_ids;
     }
 
+    /** Returns queue wait latencies.
+     * Each executed request records the time between #add and the start of
+     * its execution, which includes time spent waiting behind earlier
+     * requests of the same group and time spent while the queue was paused.
+     * @param snapshot Filled in with queue wait histogram (microseconds)
+     */
+    void get_queue_wait(LatencyHistogram::Snapshot &snapshot) const {
+      m_state.queue_wait.snapshot(snapshot);
+    }
+
     /**
      * Shuts down the application queue.  All outstanding requests are carried
      * out and then all threads exit.  #join can be called to wait for
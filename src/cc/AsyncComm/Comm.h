@@ -308,6 +308,11 @@ namespace Hypertable {
      * cbp->append_i32(Error::OK);
      * </pre>
      *
+     * Several responses can be sent for one request by setting
+     * CommHeader::FLAGS_BIT_STREAM in the header of all but the last one;
+     * the request stays pending on the client until a response without the
+     * bit arrives (or the request times out).
+     *
      * If an error is encountered while trying to send the response, the
      * associated handler will be decomissioned.
      * @param addr Connection address (remote address)
@@ -30,9 +30,12 @@
 #define HYPERTABLE_COMMBUF_H
 
 #include <string>
+#include <vector>
 
 #include <boost/shared_array.hpp>
 
+#include <sys/uio.h>
+
 #include "Common/ByteString.h"
 #include "Common/InetAddr.h"
 #include "Common/Logger.h"
@@ -52,7 +55,9 @@ namespace Hypertable {
    * The CommBuf class contains a primary buffer and an extended buffer along
    * with buffer pointers to keep track of how much data has been written into
    * the buffers. These pointers are managed by the IOHandler while the buffer
-   * is being transmitted. The following example illustrates how to build a
+   * is being transmitted.  Instead of a single extended buffer, the extended
+   * data can be supplied as a chain of segments that are gathered by the
+   * IOHandler when the message is written. The following example illustrates how to build a
    * request message using the CommBuf.  
    *
    * <pre>
@@ -86,7 +91,8 @@ namespace Hypertable {
      * @param hdr Comm header
      * @param len Length of the primary buffer to allocate
      */
-    CommBuf(CommHeader &hdr, uint32_t len=0) : header(hdr), ext_ptr(0) {
+    CommBuf(CommHeader &hdr, uint32_t len=0)
+      : header(hdr), ext_ptr(0), ext_chain_index(0), ext_chain_offset(0) {
       len += header.encoded_length();
       data.set(new uint8_t [len], len, true);
       data_ptr = data.base + header.encoded_length();
@@ -104,7 +110,7 @@ namespace Hypertable {
      * @param buffer Extended buffer
      */
     CommBuf(CommHeader &hdr, uint32_t len, StaticBuffer &buffer)
-      : ext(buffer), header(hdr) {
+      : ext(buffer), header(hdr), ext_chain_index(0), ext_chain_offset(0) {
       len += header.encoded_length();
       data.set(new uint8_t [len], len, true);
       data_ptr = data.base + header.encoded_length();
@@ -126,7 +132,8 @@ namespace Hypertable {
      */
     CommBuf(CommHeader &hdr, uint32_t len,
 	    boost::shared_array<uint8_t> &ext_buffer, uint32_t ext_len) :
-      header(hdr), ext_shared_array(ext_buffer) {
+      header(hdr), ext_shared_array(ext_buffer), ext_chain_index(0),
+      ext_chain_offset(0) {
       len += header.encoded_length();
       data.set(new uint8_t [len], len, true);
       data_ptr = data.base + header.encoded_length();
@@ -137,6 +144,29 @@ namespace Hypertable {
       ext_ptr = ext.base;
     }
 
+    /** Constructor. This constructor initializes the CommBuf object by
+     * allocating a primary buffer of length len and writing the header into it.
+     * The extended data is the concatenation of the segments in
+     * <code>chain</code>, which are written without being copied.  The CommBuf
+     * does not take ownership of the segment memory, which must remain valid
+     * until the CommBuf is destroyed.  The total length written into the
+     * header is len plus the combined length of the segments.
+     * @param hdr Comm header
+     * @param len Length of the primary buffer to allocate
+     * @param chain Extended data segments
+     */
+    CommBuf(CommHeader &hdr, uint32_t len, const std::vector<struct iovec> &chain)
+      : header(hdr), ext_ptr(0), ext_chain(chain), ext_chain_index(0),
+        ext_chain_offset(0) {
+      size_t ext_len = 0;
+      for (size_t i=0; i<ext_chain.size(); i++)
+        ext_len += ext_chain[i].iov_len;
+      len += header.encoded_length();
+      data.set(new uint8_t [len], len, true);
+      data_ptr = data.base + header.encoded_length();
+      header.set_total_length(len+ext_len);
+    }
+
     /** Encodes the header at the beginning of the primary buffer.
      * This method resets the primary and extended data pointers to point to the
      * beginning of their respective buffers.  The AsyncComm layer
@@ -149,8 +179,53 @@ namespace Hypertable {
       header.encode(&buf);
       data_ptr = data.base;
       ext_ptr = ext.base;
+      ext_chain_index = 0;
+      ext_chain_offset = 0;
     }
 
+    /** Fills an I/O vector with the unwritten part of the extended buffer
+     * chain.
+     * @param vec I/O vector to fill
+     * @param max Maximum number of entries to fill
+     * @param lenp Address of variable to receive the number of bytes
+     *        referenced by the filled entries
+     * @return Number of entries filled
+     */
+    int fill_ext_chain(struct iovec *vec, int max, size_t *lenp) const {
+      int count = 0;
+      size_t offset = ext_chain_offset;
+      *lenp = 0;
+      for (size_t i=ext_chain_index; i<ext_chain.size() && count<max; i++) {
+        vec[count].iov_base = (uint8_t *)ext_chain[i].iov_base + offset;
+        vec[count].iov_len = ext_chain[i].iov_len - offset;
+        *lenp += vec[count].iov_len;
+        offset = 0;
+        ++count;
+      }
+      return count;
+    }
+
+    /** Advances the extended buffer chain write position.
+     * @param nbytes Number of extended chain bytes written
+     */
+    void advance_ext_chain(size_t nbytes) {
+      while (nbytes) {
+        size_t remaining = ext_chain[ext_chain_index].iov_len - ext_chain_offset;
+        if (nbytes < remaining) {
+          ext_chain_offset += nbytes;
+          return;
+        }
+        nbytes -= remaining;
+        ext_chain_index++;
+        ext_chain_offset = 0;
+      }
+    }
+
+    /** Checks if the extended buffer chain has been completely written.
+     * @return <i>true</i> if no chain bytes remain to be written
+     */
+    bool ext_chain_done() const { return ext_chain_index == ext_chain.size(); }
+
     /** Returns the primary buffer internal data pointer
      */
     void *get_data_ptr() { return data_ptr; }
@@ -299,6 +374,15 @@ namespace Hypertable {
 
     /// Smart pointer to extended buffer memory
     boost::shared_array<uint8_t> ext_shared_array;
+
+    /// Extended buffer segments (not owned), used instead of #ext
+    std::vector<struct iovec> ext_chain;
+
+    /// Index of #ext_chain segment being written
+    size_t ext_chain_index;
+
+    /// Write offset into current #ext_chain segment
+    size_t ext_chain_offset;
   };
 
   /// Smart pointer to CommBuf
@@ -56,6 +56,9 @@ using namespace std;
 
 namespace {
 
+  /// Maximum number of extended buffer chain segments gathered per write
+  const int SEND_CHAIN_IOVECS = 64;
+
   /**
    * Used to read data off a socket that is monotored with edge-triggered epoll.
    * When this function returns with *errnop set to EAGAIN, it is safe to call
@@ -592,7 +595,9 @@ void IOHandlerData::handle_message_body() {
   }
   else if ((m_event->header.flags & CommHeader::FLAGS_BIT_REQUEST) == 0 &&
       (m_event->header.id == 0
-      || (dh = m_reactor->remove_request(m_event->header.id)) == 0)) {
+      || (dh = (m_event->header.flags & CommHeader::FLAGS_BIT_STREAM)
+          ? m_reactor->lookup_request(m_event->header.id)
+          : m_reactor->remove_request(m_event->header.id)) == 0)) {
     if ((m_event->header.flags & CommHeader::FLAGS_BIT_IGNORE_RESPONSE) == 0) {
       HT_WARNF("Received response for non-pending event (id=%d,version"
                "=%d,total_len=%d)", m_event->header.id, m_event->header.version,
@@ -760,7 +765,8 @@ IOHandlerData::send_message(CommBufPtr &cbp, uint32_t timeout_ms,
 
 int IOHandlerData::flush_send_queue() {
   ssize_t nwritten, towrite, remaining;
-  struct iovec vec[2];
+  struct iovec vec[2 + SEND_CHAIN_IOVECS];
+  size_t chain_towrite;
   int count;
   int error = 0;
 
@@ -786,6 +792,9 @@ int IOHandlerData::flush_send_queue() {
         ++count;
       }
     }
+    count += cbp->fill_ext_chain(&vec[count], SEND_CHAIN_IOVECS,
+                                 &chain_towrite);
+    towrite += chain_towrite;
 
     nwritten = et_socket_writev(m_sd, vec, count, &error);
     if (nwritten == (ssize_t)-1) {
@@ -827,6 +836,18 @@ int IOHandlerData::flush_send_queue() {
         error = 0;
         continue;
       }
+      cbp->advance_ext_chain(nwritten);
+      if (error == EAGAIN)
+        break;
+      error = 0;
+      continue;
+    }
+    else if (chain_towrite) {
+      // Chain may be longer than the I/O vector
+      cbp->data_ptr = cbp->data.base + cbp->data.size;
+      cbp->advance_ext_chain(chain_towrite);
+      if (!cbp->ext_chain_done())
+        continue;
     }
 
     // buffer written successfully, now remove from queue (destroys buffer)
@@ -840,7 +861,8 @@ int IOHandlerData::flush_send_queue() {
 
 int IOHandlerData::flush_send_queue() {
   ssize_t nwritten, towrite, remaining;
-  struct iovec vec[2];
+  struct iovec vec[2 + SEND_CHAIN_IOVECS];
+  size_t chain_towrite;
   int count;
 
   while (!m_send_queue.empty()) {
@@ -865,6 +887,9 @@ int IOHandlerData::flush_send_queue() {
         ++count;
       }
     }
+    count += cbp->fill_ext_chain(&vec[count], SEND_CHAIN_IOVECS,
+                                 &chain_towrite);
+    towrite += chain_towrite;
 
     nwritten = FileUtils::writev(m_sd, vec, count);
     if (nwritten == (ssize_t)-1) {
@@ -890,6 +915,15 @@ int IOHandlerData::flush_send_queue() {
         cbp->ext_ptr += nwritten;
         break;
       }
+      cbp->advance_ext_chain(nwritten);
+      break;
+    }
+    else if (chain_towrite) {
+      // Chain may be longer than the I/O vector
+      cbp->data_ptr = cbp->data.base + cbp->data.size;
+      cbp->advance_ext_chain(chain_towrite);
+      if (!cbp->ext_chain_done())
+        continue;
     }
 
     // buffer written successfully, now remove from queue (destroys buffer)
@@ -284,6 +284,9 @@ namespace Hypertable {
      * CommHeader::FLAGS_BIT_IGNORE_RESPONSE bit is not set in the header
      * flags, the corresponding dispatch handler is removed form request queue
      * and the message is delivered to the applicaton using that handler.
+     * If the CommHeader::FLAGS_BIT_STREAM bit is set, more responses to the
+     * same request will follow, so the handler is looked up and left in the
+     * request queue.
      * Otherwise, the message is delivered to the application using the
      * default dispatch handler.  After the message has been delivered, the
      * message receive state is reset with a call to
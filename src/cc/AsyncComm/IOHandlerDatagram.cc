@@ -380,6 +380,7 @@ int IOHandlerDatagram::flush_send_queue() {
                                            - send_rec.second->data.base);
     assert(tosend > 0);
     assert(send_rec.second->ext.base == 0);
+    assert(send_rec.second->ext_chain.empty());
 
     nsent = FileUtils::sendto(m_sd, send_rec.second->data_ptr, tosend,
                               (sockaddr *)&send_rec.first,
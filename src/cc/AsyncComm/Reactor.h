@@ -116,6 +116,14 @@ namespace Hypertable {
       return m_request_cache.remove(id);
     }
 
+    /** Looks up request associated with <code>id</code> without removing it
+     * @return Pointer to request dispatch handler
+     */
+    DispatchHandler *lookup_request(uint32_t id) {
+      ScopedLock lock(m_mutex);
+      return m_request_cache.lookup(id);
+    }
+
     /** Cancels outstanding requests associated with <code>handler</code>
      * @param handler I/O handler for which outstanding requests are to be
      * cancelled
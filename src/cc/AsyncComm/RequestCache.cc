@@ -102,6 +102,14 @@ DispatchHandler *RequestCache::remove(uint32_t id) {
 
 
 
+DispatchHandler *RequestCache::lookup(uint32_t id) {
+  IdHandlerMap::iterator iter = m_id_map.find(id);
+  if (iter == m_id_map.end() || (*iter).second->handler == 0)
+    return 0;
+  return (*iter).second->dh;
+}
+
+
 DispatchHandler *
 RequestCache::get_next_timeout(boost::xtime &now, IOHandler *&handlerp,
                                boost::xtime *next_timeout) {
@@ -86,6 +86,14 @@ namespace Hypertable {
      */
     DispatchHandler *remove(uint32_t id);
 
+    /** Looks up a request without removing it from the cache.  Used for
+     * responses that have CommHeader::FLAGS_BIT_STREAM set, which are
+     * followed by more responses to the same request.
+     * @param id Request ID
+     * @return Pointer to request's dispatch handler, or 0 if not found
+     */
+    DispatchHandler *lookup(uint32_t id);
+
     /** Removes next request that has timed out.  This method finds the first
      * request starting from the head of the list and removes it and returns
      * it's associated handler information if it has timed out.  During the
@@ -0,0 +1,198 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Tests sending of chained extended buffers.
+ * Sends a CommBuf whose extended data is a chain of segments over a socket
+ * pair with a small send buffer, and reads it back in small pieces, so
+ * that writes complete partially, inside segments, and the chain takes
+ * more writes than IOHandlerData gathers per call.  The received bytes
+ * are compared with the message, which is then reset and sent again.
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+}
+
+#include "Common/Init.h"
+#include "Common/Error.h"
+#include "Common/FileUtils.h"
+#include "Common/InetAddr.h"
+#include "Common/Logger.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/CommBuf.h"
+#include "AsyncComm/CommHeader.h"
+#include "AsyncComm/HandlerMap.h"
+#include "AsyncComm/IOHandlerData.h"
+#include "AsyncComm/ReactorFactory.h"
+#include "AsyncComm/ReactorRunner.h"
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: commTestChain",
+    "",
+    "This program tests sending of chained extended buffers.",
+    0
+  };
+
+  /// More segments than IOHandlerData gathers per write (64)
+  const size_t SEGMENT_COUNT = 150;
+
+  /// A segment larger than the socket buffer is always split across writes
+  const size_t LARGE_SEGMENT_SIZE = 200000;
+
+  /** Reads <code>len</code> bytes in small pieces, which keeps the socket
+   * buffer of the sender almost full so that its writes complete partially
+   * at arbitrary offsets.
+   */
+  void read_fully(int sd, char *buf, size_t len) {
+    struct pollfd pfd;
+    pfd.fd = sd;
+    pfd.events = POLLIN;
+    while (len) {
+      if (poll(&pfd, 1, 10000) <= 0) {
+        HT_ERRORF("Timed out with %u bytes still to be received",
+                  (unsigned)len);
+        _exit(1);
+      }
+      ssize_t nread = ::read(sd, buf, std::min(len, (size_t)113));
+      if (nread <= 0) {
+        HT_ERRORF("read(%d) failed - %s", sd,
+                  nread ? strerror(errno) : "EOF");
+        _exit(1);
+      }
+      buf += nread;
+      len -= nread;
+    }
+  }
+
+  void check_received(int sd, const String &expected) {
+    String received(expected.size(), '\0');
+    read_fully(sd, &received[0], received.size());
+    if (received != expected) {
+      size_t i = 0;
+      while (received[i] == expected[i])
+        i++;
+      HT_ERRORF("Received bytes differ from sent bytes at offset %u of %u",
+                (unsigned)i, (unsigned)expected.size());
+      _exit(1);
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  int sd[2];
+  int bufsize = 4096;
+
+  Config::init(argc, argv);
+
+  if (argc > 1)
+    Usage::dump_and_exit(usage);
+
+  srand(8876);
+
+  ReactorFactory::initialize(1);
+
+  HT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == 0);
+  setsockopt(sd[0], SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+  setsockopt(sd[1], SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+  FileUtils::set_flags(sd[0], O_NONBLOCK);
+
+  // Carve segments of varying size out of random data, with a large one
+  // in the middle, and chain them in reverse order
+  size_t sizes[SEGMENT_COUNT];
+  size_t total = 0;
+  for (size_t i=0; i<SEGMENT_COUNT; i++) {
+    sizes[i] = (i == SEGMENT_COUNT / 2) ? LARGE_SEGMENT_SIZE : (i*131)%997 + 1;
+    total += sizes[i];
+  }
+  String source(total, '\0');
+  for (size_t i=0; i<total; i++)
+    source[i] = (char)(rand() & 0xff);
+
+  vector<struct iovec> chain(SEGMENT_COUNT);
+  size_t offset = 0;
+  for (size_t i=0; i<SEGMENT_COUNT; i++) {
+    struct iovec &segment = chain[SEGMENT_COUNT - 1 - i];
+    segment.iov_base = &source[offset];
+    segment.iov_len = sizes[i];
+    offset += sizes[i];
+  }
+
+  DispatchHandlerPtr null_handler;
+  IOHandlerData *handler =
+    new IOHandlerData(sd[0], InetAddr("127.0.0.1", 1), null_handler, true);
+  ReactorRunner::handler_map->insert_handler(handler);
+  HT_ASSERT(handler->start_polling(Reactor::READ_READY |
+                                   Reactor::WRITE_READY) == Error::OK);
+
+  CommHeader header(1);
+  CommBufPtr cbuf = new CommBuf(header, 8, chain);
+  cbuf->append_i64(0x0102030405060708LL);
+
+  // Start from a position inside the chain, which write_header_and_reset()
+  // has to rewind
+  cbuf->advance_ext_chain(chain[0].iov_len + chain[1].iov_len / 2);
+  cbuf->write_header_and_reset();
+
+  String expected((const char *)cbuf->data.base, cbuf->data.size);
+  for (size_t i=0; i<chain.size(); i++)
+    expected.append((const char *)chain[i].iov_base, chain[i].iov_len);
+  HT_ASSERT(expected.size() == cbuf->header.total_len);
+
+  CommHeader marker_header(2);
+  CommBufPtr marker = new CommBuf(marker_header, 4);
+  marker->append_i32(42);
+  marker->write_header_and_reset();
+  String marker_bytes((const char *)marker->data.base, marker->data.size);
+
+  HT_ASSERT(handler->send_message(cbuf) == Error::OK);
+  HT_ASSERT(handler->send_message(marker) == Error::OK);
+  check_received(sd[1], expected + marker_bytes);
+
+  // The marker is written after the chained buffer has been removed from
+  // the send queue, so it can now be reset and sent again
+  cbuf->write_header_and_reset();
+  HT_ASSERT(handler->send_message(cbuf) == Error::OK);
+  check_received(sd[1], expected);
+
+  _exit(0);
+}
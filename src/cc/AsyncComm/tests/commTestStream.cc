@@ -0,0 +1,257 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Stream response test.
+ * Sends requests to an in-process server that answers each of them with a
+ * window of responses, all but the last one flagged with
+ * CommHeader::FLAGS_BIT_STREAM, and checks that the client request stays
+ * pending for the whole window, that it is removed from the request cache
+ * by the last response or by an error response that aborts the stream,
+ * and that a stalled stream times out.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/InetAddr.h"
+#include "Common/Init.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/Comm.h"
+#include "AsyncComm/ConnectionHandlerFactory.h"
+#include "AsyncComm/ConnectionManager.h"
+#include "AsyncComm/Event.h"
+#include "AsyncComm/Protocol.h"
+#include "AsyncComm/ReactorFactory.h"
+
+#include <boost/thread/condition.hpp>
+
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+using namespace Hypertable;
+using namespace Serialization;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: commTestStream",
+    "",
+    "This program tests multi-response (stream) requests of AsyncComm.",
+    0
+  };
+
+  const int DEFAULT_PORT = 32997;
+
+  /** Server side handler.
+   * A request carries the number of responses to send, the index of the
+   * response to replace with an error response (aborting the stream) and
+   * the index of the response at which to stop sending (stalling the
+   * stream), -1 if none.  One extra response is sent after the last one
+   * (or after the error), which the client must drop.
+   */
+  class StreamServer : public DispatchHandler {
+  public:
+    StreamServer(Comm *comm) : m_comm(comm) { }
+
+    virtual void handle(EventPtr &event) {
+      if (event->type != Event::MESSAGE)
+        return;
+      const uint8_t *ptr = event->payload;
+      size_t remain = event->payload_len;
+      int32_t count = decode_i32(&ptr, &remain);
+      int32_t abort_at = decode_i32(&ptr, &remain);
+      int32_t stall_at = decode_i32(&ptr, &remain);
+      for (int32_t i=0; i<=count; i++) {
+        if (i == stall_at)
+          return;
+        CommHeader header;
+        header.initialize_from_request_header(event->header);
+        CommBufPtr cbp;
+        if (i == abort_at) {
+          cbp = Protocol::create_error_message(header, Error::CANCELLED,
+                                               "stream aborted");
+        }
+        else {
+          if (i < count - 1)
+            header.flags |= CommHeader::FLAGS_BIT_STREAM;
+          cbp = new CommBuf(header, 8);
+          cbp->append_i32(Error::OK);
+          cbp->append_i32(i);
+        }
+        int error = m_comm->send_response(event->addr, cbp);
+        HT_ASSERT(error == Error::OK);
+      }
+    }
+
+  private:
+    Comm *m_comm;
+  };
+
+  class StreamHandlerFactory : public ConnectionHandlerFactory {
+  public:
+    StreamHandlerFactory(DispatchHandlerPtr &dhp) : m_dhp(dhp) { }
+    virtual void get_instance(DispatchHandlerPtr &dhp) { dhp = m_dhp; }
+  private:
+    DispatchHandlerPtr m_dhp;
+  };
+
+  /** Client side handler; records the responses of one request.
+   */
+  class StreamClient : public DispatchHandler {
+  public:
+    StreamClient() : m_done(false) { }
+
+    virtual void handle(EventPtr &event) {
+      ScopedLock lock(m_mutex);
+      events.push_back(event);
+      if (event->type != Event::MESSAGE
+          || (event->header.flags & CommHeader::FLAGS_BIT_STREAM) == 0) {
+        m_done = true;
+        m_cond.notify_all();
+      }
+    }
+
+    /** Waits for the last response and for stray ones to arrive.
+     */
+    void wait_for_completion() {
+      {
+        ScopedLock lock(m_mutex);
+        while (!m_done)
+          m_cond.wait(lock);
+      }
+      poll(0, 0, 500);
+    }
+
+    /** Checks the sequence numbers of the first <code>count</code>
+     * responses and that all but the last one were stream responses.
+     */
+    void check_blocks(size_t count) {
+      ScopedLock lock(m_mutex);
+      HT_ASSERT(events.size() >= count);
+      for (size_t i=0; i<count; i++) {
+        HT_ASSERT(events[i]->type == Event::MESSAGE);
+        HT_ASSERT(Protocol::response_code(events[i]) == Error::OK);
+        const uint8_t *ptr = events[i]->payload + 4;
+        size_t remain = events[i]->payload_len - 4;
+        HT_ASSERT(decode_i32(&ptr, &remain) == (int32_t)i);
+        bool stream = (events[i]->header.flags & CommHeader::FLAGS_BIT_STREAM)
+          != 0;
+        HT_ASSERT(stream == (i + 1 < events.size()));
+      }
+    }
+
+    std::vector<EventPtr> events;
+
+  private:
+    Mutex m_mutex;
+    boost::condition m_cond;
+    bool m_done;
+  };
+
+  void send_request(Comm *comm, const CommAddress &addr, StreamClient *client,
+                    int32_t count, int32_t abort_at, int32_t stall_at) {
+    CommHeader header(1);
+    CommBufPtr cbp(new CommBuf(header, 12));
+    cbp->append_i32(count);
+    cbp->append_i32(abort_at);
+    cbp->append_i32(stall_at);
+    int error = comm->send_request(addr, 2000, cbp, client);
+    HT_ASSERT(error == Error::OK);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  Config::init(argc, argv);
+
+  if (argc != 1)
+    Usage::dump_and_exit(usage);
+
+  System::initialize(System::locate_install_dir(argv[0]));
+  ReactorFactory::initialize(1);
+
+  Comm *comm = Comm::instance();
+  InetAddr addr;
+  InetAddr::initialize(&addr, "localhost", DEFAULT_PORT);
+
+  DispatchHandlerPtr server(new StreamServer(comm));
+  ConnectionHandlerFactoryPtr chfp(new StreamHandlerFactory(server));
+  comm->listen(addr, chfp);
+
+  ConnectionManagerPtr conn_mgr = new ConnectionManager(comm);
+  conn_mgr->add(addr, 5, "StreamServer");
+  if (!conn_mgr->wait_for_connection(addr, 30000)) {
+    HT_ERROR("Connect error");
+    _exit(1);
+  }
+
+  // a window of responses is delivered to the pending request in order,
+  // the response sent after the last one is dropped
+  {
+    StreamClient client;
+    send_request(comm, addr, &client, 5, -1, -1);
+    client.wait_for_completion();
+    HT_ASSERT(client.events.size() == 5);
+    client.check_blocks(5);
+  }
+
+  // a window of one is an ordinary request
+  {
+    StreamClient client;
+    send_request(comm, addr, &client, 1, -1, -1);
+    client.wait_for_completion();
+    HT_ASSERT(client.events.size() == 1);
+    client.check_blocks(1);
+  }
+
+  // an error response aborts the stream mid-window and removes the request,
+  // the stream responses sent after it are dropped
+  {
+    StreamClient client;
+    send_request(comm, addr, &client, 5, 2, -1);
+    client.wait_for_completion();
+    HT_ASSERT(client.events.size() == 3);
+    client.check_blocks(2);
+    HT_ASSERT(client.events[2]->type == Event::MESSAGE);
+    HT_ASSERT(Protocol::response_code(client.events[2]) == Error::CANCELLED);
+  }
+
+  // a stream that stalls keeps the request pending until it times out
+  {
+    StreamClient client;
+    send_request(comm, addr, &client, 5, -1, 2);
+    client.wait_for_completion();
+    HT_ASSERT(client.events.size() == 3);
+    client.check_blocks(2);
+    HT_ASSERT(client.events[2]->type == Event::ERROR);
+    HT_ASSERT(client.events[2]->error == Error::REQUEST_TIMEOUT);
+  }
+
+  _exit(0);
+}
@@ -0,0 +1,351 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for PosixFilesystem.
+ * This file contains definitions for PosixFilesystem, a Filesystem that
+ * operates directly on a local directory so that the storage engine can be
+ * benchmarked without a DFS broker.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/FileUtils.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "AsyncComm/Event.h"
+
+#include "PosixFilesystem.h"
+
+extern "C" {
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+
+namespace {
+
+  /// Throws the DfsBroker error corresponding to errno
+  void throw_errno(const String &what) {
+    int error;
+    if (errno == ENOTDIR || errno == ENAMETOOLONG || errno == ENOENT)
+      error = Error::DFSBROKER_BAD_FILENAME;
+    else if (errno == EACCES || errno == EPERM)
+      error = Error::DFSBROKER_PERMISSION_DENIED;
+    else if (errno == EBADF)
+      error = Error::DFSBROKER_BAD_FILE_HANDLE;
+    else if (errno == EINVAL)
+      error = Error::DFSBROKER_INVALID_ARGUMENT;
+    else
+      error = Error::DFSBROKER_IO_ERROR;
+    HT_THROWF(error, "%s - %s", what.c_str(), strerror(errno));
+  }
+
+  /** Delivers a response to an asynchronous request.
+   * @param handler Handler of the request
+   * @param payload Response payload allocated with new[], starting with the
+   *        error code; ownership passes to the event
+   * @param length Length of payload
+   */
+  void respond(DispatchHandler *handler, uint8_t *payload, size_t length) {
+    EventPtr event = new Event(Event::MESSAGE);
+    event->payload = payload;
+    event->payload_len = length;
+    handler->handle(event);
+  }
+
+  /// Delivers a status-only response to an asynchronous request
+  void respond_ok(DispatchHandler *handler) {
+    uint8_t *payload = new uint8_t[4];
+    uint8_t *ptr = payload;
+    Serialization::encode_i32(&ptr, Error::OK);
+    respond(handler, payload, 4);
+  }
+
+  void not_implemented(const char *what) {
+    HT_THROWF(Error::NOT_IMPLEMENTED,
+              "%s not supported by PosixFilesystem", what);
+  }
+
+  int remove_entry(const char *path, const struct stat *, int, struct FTW *) {
+    return ::remove(path);
+  }
+
+}
+
+
+PosixFilesystem::PosixFilesystem(const String &rootdir) : m_rootdir(rootdir) {
+  while (m_rootdir.size() > 1 && m_rootdir[m_rootdir.size()-1] == '/')
+    m_rootdir.resize(m_rootdir.size()-1);
+  if (!FileUtils::exists(m_rootdir) && !FileUtils::mkdirs(m_rootdir))
+    throw_errno(format("Unable to create %s", m_rootdir.c_str()));
+}
+
+String PosixFilesystem::path(const String &name) const {
+  if (!name.empty() && name[0] == '/')
+    return m_rootdir + name;
+  return m_rootdir + "/" + name;
+}
+
+void PosixFilesystem::open(const String &name, uint32_t flags,
+                           DispatchHandler *handler) {
+  not_implemented("Asynchronous open");
+}
+
+int PosixFilesystem::open(const String &name, uint32_t flags) {
+  int fd = ::open(path(name).c_str(), O_RDONLY);
+  if (fd < 0)
+    throw_errno(format("Unable to open %s", name.c_str()));
+  return fd;
+}
+
+int PosixFilesystem::open_buffered(const String &name, uint32_t flags,
+        uint32_t buf_size, uint32_t outstanding, uint64_t start_offset,
+        uint64_t end_offset) {
+  int fd = open(name, flags);
+  if (start_offset && ::lseek(fd, start_offset, SEEK_SET) == (off_t)-1) {
+    ::close(fd);
+    throw_errno(format("Unable to seek %s", name.c_str()));
+  }
+  return fd;
+}
+
+void PosixFilesystem::create(const String &name, uint32_t flags,
+        int32_t bufsz, int32_t replication, int64_t blksz,
+        DispatchHandler *handler) {
+  not_implemented("Asynchronous create");
+}
+
+int PosixFilesystem::create(const String &name, uint32_t flags,
+        int32_t bufsz, int32_t replication, int64_t blksz) {
+  int oflags = O_WRONLY | O_CREAT;
+  oflags |= (flags & OPEN_FLAG_OVERWRITE) ? O_TRUNC : O_APPEND;
+  int fd = ::open(path(name).c_str(), oflags, 0644);
+  if (fd < 0)
+    throw_errno(format("Unable to create %s", name.c_str()));
+  return fd;
+}
+
+void PosixFilesystem::close(int fd, DispatchHandler *handler) {
+  close(fd);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::close(int fd) {
+  if (::close(fd) < 0)
+    throw_errno(format("Unable to close fd %d", fd));
+}
+
+void PosixFilesystem::read(int fd, size_t amount, DispatchHandler *handler) {
+  not_implemented("Asynchronous read");
+}
+
+size_t PosixFilesystem::read(int fd, void *dst, size_t amount) {
+  ssize_t nread = FileUtils::read(fd, dst, amount);
+  if (nread < 0)
+    throw_errno(format("Unable to read fd %d", fd));
+  return nread;
+}
+
+void PosixFilesystem::append(int fd, StaticBuffer &buffer, uint32_t flags,
+                             DispatchHandler *handler) {
+  off_t offset = ::lseek(fd, 0, SEEK_CUR);
+  uint32_t amount = append(fd, buffer, flags);
+  uint8_t *payload = new uint8_t[16];
+  uint8_t *ptr = payload;
+  Serialization::encode_i32(&ptr, Error::OK);
+  Serialization::encode_i64(&ptr, offset);
+  Serialization::encode_i32(&ptr, amount);
+  respond(handler, payload, 16);
+}
+
+size_t PosixFilesystem::append(int fd, StaticBuffer &buffer, uint32_t flags) {
+  ssize_t nwritten = FileUtils::write(fd, buffer.base, buffer.size);
+  if (nwritten != (ssize_t)buffer.size)
+    throw_errno(format("Unable to append %u bytes to fd %d",
+                       (unsigned)buffer.size, fd));
+  if ((flags & O_FLUSH) && ::fdatasync(fd) < 0)
+    throw_errno(format("Unable to sync fd %d", fd));
+  return nwritten;
+}
+
+void PosixFilesystem::seek(int fd, uint64_t offset, DispatchHandler *handler) {
+  seek(fd, offset);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::seek(int fd, uint64_t offset) {
+  if (::lseek(fd, offset, SEEK_SET) == (off_t)-1)
+    throw_errno(format("Unable to seek fd %d to %llu", fd, (Llu)offset));
+}
+
+void PosixFilesystem::remove(const String &name, DispatchHandler *handler) {
+  remove(name);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::remove(const String &name, bool force) {
+  if (::unlink(path(name).c_str()) < 0 && !(force && errno == ENOENT))
+    throw_errno(format("Unable to remove %s", name.c_str()));
+}
+
+void PosixFilesystem::length(const String &name, bool accurate,
+                             DispatchHandler *handler) {
+  not_implemented("Asynchronous length");
+}
+
+int64_t PosixFilesystem::length(const String &name, bool accurate) {
+  struct stat statbuf;
+  if (::stat(path(name).c_str(), &statbuf) < 0)
+    throw_errno(format("Unable to stat %s", name.c_str()));
+  return statbuf.st_size;
+}
+
+void PosixFilesystem::pread(int fd, size_t len, uint64_t offset,
+                            DispatchHandler *handler) {
+  not_implemented("Asynchronous pread");
+}
+
+size_t PosixFilesystem::pread(int fd, void *dst, size_t len, uint64_t offset,
+                              bool verify_checksum) {
+  ssize_t nread = FileUtils::pread(fd, dst, len, offset);
+  if (nread < 0)
+    throw_errno(format("Unable to read %u bytes at %llu from fd %d",
+                       (unsigned)len, (Llu)offset, fd));
+  return nread;
+}
+
+void PosixFilesystem::mkdirs(const String &name, DispatchHandler *handler) {
+  mkdirs(name);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::mkdirs(const String &name) {
+  if (!FileUtils::mkdirs(path(name)))
+    throw_errno(format("Unable to create directory %s", name.c_str()));
+}
+
+void PosixFilesystem::flush(int fd, DispatchHandler *handler) {
+  flush(fd);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::flush(int fd) {
+  if (::fdatasync(fd) < 0)
+    throw_errno(format("Unable to sync fd %d", fd));
+}
+
+void PosixFilesystem::rmdir(const String &name, DispatchHandler *handler) {
+  rmdir(name);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::rmdir(const String &name, bool force) {
+  String dir = path(name);
+  if (!FileUtils::exists(dir)) {
+    if (force)
+      return;
+    errno = ENOENT;
+    throw_errno(format("Unable to remove directory %s", name.c_str()));
+  }
+  if (::nftw(dir.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS) < 0)
+    throw_errno(format("Unable to remove directory %s", name.c_str()));
+}
+
+void PosixFilesystem::readdir(const String &name, DispatchHandler *handler) {
+  not_implemented("Asynchronous readdir");
+}
+
+void PosixFilesystem::readdir(const String &name,
+                              std::vector<Dirent> &listing) {
+  std::vector<DirectoryEntry> entries;
+  posix_readdir(name, entries);
+  listing.clear();
+  foreach_ht (const DirectoryEntry &entry, entries) {
+    Dirent dirent;
+    dirent.name = entry.name;
+    dirent.length = entry.length;
+    dirent.is_dir = (entry.flags & DIRENT_DIRECTORY) != 0;
+    listing.push_back(dirent);
+  }
+}
+
+void PosixFilesystem::posix_readdir(const String &name,
+                                    std::vector<DirectoryEntry> &listing) {
+  String dir = path(name);
+  DIR *dirp = ::opendir(dir.c_str());
+  if (dirp == 0)
+    throw_errno(format("Unable to open directory %s", name.c_str()));
+  listing.clear();
+  struct dirent *dp;
+  while ((dp = ::readdir(dirp)) != 0) {
+    if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+      continue;
+    struct stat statbuf;
+    if (::stat((dir + "/" + dp->d_name).c_str(), &statbuf) < 0)
+      continue;
+    DirectoryEntry entry;
+    entry.name = dp->d_name;
+    entry.flags = S_ISDIR(statbuf.st_mode) ? DIRENT_DIRECTORY : 0;
+    entry.length = (uint32_t)statbuf.st_size;
+    listing.push_back(entry);
+  }
+  ::closedir(dirp);
+}
+
+void PosixFilesystem::exists(const String &name, DispatchHandler *handler) {
+  not_implemented("Asynchronous exists");
+}
+
+bool PosixFilesystem::exists(const String &name) {
+  return FileUtils::exists(path(name));
+}
+
+void PosixFilesystem::rename(const String &src, const String &dst,
+                             DispatchHandler *handler) {
+  rename(src, dst);
+  respond_ok(handler);
+}
+
+void PosixFilesystem::rename(const String &src, const String &dst) {
+  if (::rename(path(src).c_str(), path(dst).c_str()) < 0)
+    throw_errno(format("Unable to rename %s to %s", src.c_str(), dst.c_str()));
+}
+
+void PosixFilesystem::debug(int32_t command,
+                            StaticBuffer &serialized_parameters) {
+  not_implemented("debug");
+}
+
+void PosixFilesystem::debug(int32_t command,
+        StaticBuffer &serialized_parameters, DispatchHandler *handler) {
+  not_implemented("debug");
+}
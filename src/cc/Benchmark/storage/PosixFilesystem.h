@@ -0,0 +1,138 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for PosixFilesystem.
+ * This file contains declarations for PosixFilesystem, a Filesystem that
+ * operates directly on a local directory so that the storage engine can be
+ * benchmarked without a DFS broker.
+ */
+
+#ifndef HYPERTABLE_POSIXFILESYSTEM_H
+#define HYPERTABLE_POSIXFILESYSTEM_H
+
+#include "Common/Filesystem.h"
+
+namespace Hypertable {
+
+  /** In-process Filesystem on a local directory.
+   * Pathnames are interpreted relative to a root directory and all calls
+   * are carried out with plain POSIX calls in the calling thread.  Direct
+   * i/o and replication arguments are ignored.
+   *
+   * Asynchronous appends, closes, seeks, flushes and directory operations
+   * complete before returning and deliver their response event to the
+   * handler from the calling thread, which is what the cell store writer
+   * expects.  The remaining asynchronous calls are not used by the storage
+   * engine classes and throw Error::NOT_IMPLEMENTED.
+   */
+  class PosixFilesystem : public Filesystem {
+  public:
+
+    /** Constructor.
+     * @param rootdir Local directory that pathnames are relative to; it is
+     *        created if it does not exist
+     */
+    PosixFilesystem(const String &rootdir);
+
+    virtual void open(const String &name, uint32_t flags,
+                      DispatchHandler *handler);
+    virtual int open(const String &name, uint32_t flags);
+    virtual int open_buffered(const String &name, uint32_t flags,
+                              uint32_t buf_size, uint32_t outstanding,
+                              uint64_t start_offset=0, uint64_t end_offset=0);
+
+    virtual void create(const String &name, uint32_t flags,
+                        int32_t bufsz, int32_t replication,
+                        int64_t blksz, DispatchHandler *handler);
+    virtual int create(const String &name, uint32_t flags, int32_t bufsz,
+                       int32_t replication, int64_t blksz);
+
+    virtual void close(int fd, DispatchHandler *handler);
+    virtual void close(int fd);
+
+    virtual void read(int fd, size_t amount, DispatchHandler *handler);
+    virtual size_t read(int fd, void *dst, size_t amount);
+
+    virtual void append(int fd, StaticBuffer &buffer, uint32_t flags,
+                        DispatchHandler *handler);
+    virtual size_t append(int fd, StaticBuffer &buffer, uint32_t flags = 0);
+
+    virtual void seek(int fd, uint64_t offset, DispatchHandler *handler);
+    virtual void seek(int fd, uint64_t offset);
+
+    virtual void remove(const String &name, DispatchHandler *handler);
+    virtual void remove(const String &name, bool force = true);
+
+    virtual void length(const String &name, bool accurate,
+                        DispatchHandler *handler);
+    virtual int64_t length(const String &name, bool accurate = true);
+
+    virtual void pread(int fd, size_t len, uint64_t offset,
+                       DispatchHandler *handler);
+    virtual size_t pread(int fd, void *dst, size_t len, uint64_t offset,
+                         bool verify_checksum);
+
+    virtual void mkdirs(const String &name, DispatchHandler *handler);
+    virtual void mkdirs(const String &name);
+
+    virtual void flush(int fd, DispatchHandler *handler);
+    virtual void flush(int fd);
+
+    virtual void rmdir(const String &name, DispatchHandler *handler);
+    virtual void rmdir(const String &name, bool force = true);
+
+    virtual void readdir(const String &name, DispatchHandler *handler);
+    virtual void readdir(const String &name, std::vector<Dirent> &listing);
+
+    virtual void posix_readdir(const String &name,
+                               std::vector<DirectoryEntry> &listing);
+
+    virtual void exists(const String &name, DispatchHandler *handler);
+    virtual bool exists(const String &name);
+
+    virtual void rename(const String &src, const String &dst,
+                        DispatchHandler *handler);
+    virtual void rename(const String &src, const String &dst);
+
+    virtual void debug(int32_t command, StaticBuffer &serialized_parameters);
+    virtual void debug(int32_t command, StaticBuffer &serialized_parameters,
+                       DispatchHandler *handler);
+
+  private:
+
+    /** Returns local pathname of a file.
+     * @param name Pathname relative to the root directory
+     * @return Absolute local pathname
+     */
+    String path(const String &name) const;
+
+    /// Local root directory
+    String m_rootdir;
+  };
+
+  /// Smart pointer to PosixFilesystem
+  typedef intrusive_ptr<PosixFilesystem> PosixFilesystemPtr;
+
+}
+
+#endif // HYPERTABLE_POSIXFILESYSTEM_H
@@ -0,0 +1,820 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Storage engine micro-benchmarks.
+ * This file contains ht_storage_bench, a program that drives the
+ * RangeServer storage engine classes (CellCache, cell stores,
+ * MergeScannerAccessGroup, block compression codecs and FileBlockCache)
+ * directly against a local directory, with synthetic data from
+ * DataGenerator, and reports throughput and heap allocations.  Optionally
+ * cell stores are kept by a local DFS broker and read in-process through
+ * DfsBroker::LocalFilesystem, as the RangeServer does.
+ */
+
+#include "Common/Compat.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/FileUtils.h"
+#include "Common/Init.h"
+#include "Common/Path.h"
+#include "Common/Random.h"
+#include "Common/String.h"
+#include "Common/Time.h"
+
+#include "AsyncComm/ReactorFactory.h"
+
+#include "DfsBroker/Lib/Client.h"
+#include "DfsBroker/Lib/LocalFilesystem.h"
+
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+#include "Hypertable/Lib/CompressorFactory.h"
+#include "Hypertable/Lib/DataGenerator.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "Hypertable/RangeServer/CellCache.h"
+#include "Hypertable/RangeServer/CellStoreFactory.h"
+#include "Hypertable/RangeServer/CellStoreV6.h"
+#include "Hypertable/RangeServer/CellStoreV7.h"
+#include "Hypertable/RangeServer/CellStoreV8.h"
+#include "Hypertable/RangeServer/FileBlockCache.h"
+#include "Hypertable/RangeServer/Global.h"
+#include "Hypertable/RangeServer/MergeScannerAccessGroup.h"
+#include "Hypertable/RangeServer/ScanContext.h"
+
+#include "PosixFilesystem.h"
+
+#include <boost/algorithm/string.hpp>
+
+#include <re2/re2.h>
+
+#if defined(TCMALLOC) || defined(TCMALLOC_MINIMAL)
+#include <google/malloc_hook.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+using namespace std;
+
+namespace {
+
+  /// Number of heap allocations seen by the allocator hook
+  std::atomic<uint64_t> allocation_count(0);
+
+  /// Number of bytes requested in the allocations seen by the allocator hook
+  std::atomic<uint64_t> allocation_bytes(0);
+
+#if defined(TCMALLOC) || defined(TCMALLOC_MINIMAL)
+  /** tcmalloc new hook.
+   * Called by tcmalloc for every malloc() and operator new, so allocations
+   * made by C code and by the compression libraries are counted too.  It
+   * runs inside the allocator and must not allocate.
+   * @param ptr Allocated memory
+   * @param size Number of bytes requested
+   */
+  void count_allocation(const void *ptr, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+
+  /** Starts counting heap allocations.
+   * @return <i>true</i> if allocations are counted
+   */
+  bool count_allocations() {
+    return MallocHook::AddNewHook(&count_allocation);
+  }
+#else
+  /// Allocations are only counted when linked with tcmalloc
+  bool count_allocations() { return false; }
+#endif
+
+  const char *usage =
+    "\n"
+    "Usage: ht_storage_bench [options]\n\n"
+    "Description:\n"
+    "  Runs micro-benchmarks of the RangeServer storage engine without a\n"
+    "  cluster.  Cells produced by DataGenerator are inserted into a cell\n"
+    "  cache, written to cell stores in a local directory, looked up,\n"
+    "  scanned, merged and compacted, and the block compression codecs and\n"
+    "  the block cache are exercised with blocks of the same data.  For\n"
+    "  each benchmark the elapsed time, items/s, MB/s and, when linked with\n"
+    "  tcmalloc, heap allocations per item are reported.\n\n"
+    "  With --dfs-broker, cell stores are instead written through a local\n"
+    "  DFS broker (DfsBroker.Host, DfsBroker.Port) and read directly from\n"
+    "  its root directory (DfsBroker.Local.Root), as the RangeServer does\n"
+    "  with DfsBroker.Local.InProcessReads.\n\n"
+    "  Cell store properties default to the RangeServer defaults\n"
+    "  (Hypertable.RangeServer.CellStore.Default*).\n\n"
+    "Options";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      allow_unregistered_options(true);
+      cmdline_desc(usage).add_options()
+        ("dir", str()->default_value("/tmp/ht_storage_bench"),
+         "Local directory to write cell stores to")
+        ("dfs-broker", boo()->zero_tokens()->default_value(false),
+         "Write cell stores through the local DFS broker and read them "
+         "in-process instead of using --dir")
+        ("dfs-dir", str()->default_value("/ht_storage_bench"),
+         "DFS directory to write cell stores to with --dfs-broker")
+        ("filter", str()->default_value(""), "Only report benchmarks whose "
+         "name matches this regular expression")
+        ("spec-file", str(),
+         "File containing the DataGenerator specification, by default cells "
+         "with random 20 digit row keys and 100 byte values")
+        ("max-bytes", i64()->default_value(32*1024*1024), "Amount of data to "
+         "generate, measured by number of key and value bytes produced")
+        ("seed", i32()->default_value(1), "Pseudo-random number generator seed")
+        ("blocksize", i32(), "Cell store block size")
+        ("compressor", str(), "Cell store block compressor")
+        ("bloom-filter", str(), "Cell store bloom filter mode")
+        ("cellstore-version", i32()->default_value(8),
+         "Cell store format to write (6, 7 or 8)")
+        ("stores", i32()->default_value(4),
+         "Number of cell stores merged by the merge and compaction benchmarks")
+        ("lookups", i32()->default_value(10000),
+         "Number of point lookups per lookup benchmark")
+        ("codecs", str()->default_value("none,bmz,zlib,lzo,quicklz,snappy"),
+         "Comma separated list of block compression codecs to benchmark")
+        ("block-cache-size", i64()->default_value(64*1024*1024),
+         "Size of the block cache used by lookups")
+        ("min-time", f64()->default_value(0.5), "Minimum number of seconds "
+         "to repeat the codec and block cache benchmarks for")
+        ("keep", boo()->zero_tokens()->default_value(false),
+         "Don't remove the cell store files on exit")
+        ;
+      alias("max-bytes", "DataGenerator.MaxBytes");
+      alias("seed", "DataGenerator.Seed");
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DataGeneratorPolicy, DefaultPolicy> Policies;
+
+  const char MAGIC[10] = { 'B','e','n','c','h','m','a','r','k','-' };
+
+  /** Measures one benchmark.
+   * Records the time and the heap allocations between construction and
+   * report(); the items and bytes processed are added by the benchmark.
+   */
+  class Measurement {
+  public:
+    /** Constructor; starts measuring.
+     * @param name Name of the benchmark
+     */
+    Measurement(const String &name)
+      : m_name(name), m_items(0), m_bytes(0),
+        m_allocations(allocation_count.load()),
+        m_allocated(allocation_bytes.load()), m_start(get_ts64()) { }
+
+    /** Adds processed items and bytes.
+     * @param items Number of items (cells, lookups or blocks)
+     * @param bytes Number of bytes
+     */
+    void add(uint64_t items, uint64_t bytes) {
+      m_items += items;
+      m_bytes += bytes;
+    }
+
+    /// Returns seconds since construction
+    double elapsed() const { return (double)(get_ts64() - m_start) / 1e9; }
+
+    /** Stops measuring and prints a result line.
+     * @param label Additional information printed after the figures
+     */
+    void report(const String &label = "");
+
+    /// Prints the column headings
+    static void print_header();
+
+    /// Regular expression selecting the benchmarks to report, may be 0
+    static RE2 *ms_filter;
+
+    /// <i>true</i> if heap allocations are counted
+    static bool ms_count_allocations;
+
+  private:
+    String m_name;
+    uint64_t m_items;
+    uint64_t m_bytes;
+    uint64_t m_allocations;
+    uint64_t m_allocated;
+    int64_t m_start;
+  };
+
+  RE2 *Measurement::ms_filter = 0;
+  bool Measurement::ms_count_allocations = false;
+
+  void Measurement::print_header() {
+    printf("%-32s %10s %10s %12s %10s %10s %10s  %s\n", "Benchmark",
+           "Time(ms)", "Items", "Items/s", "MB/s", "Allocs/it", "Bytes/it",
+           "Label");
+    printf("%s\n", String(110, '-').c_str());
+  }
+
+  void Measurement::report(const String &label) {
+    double seconds = elapsed();
+    uint64_t allocations = allocation_count.load() - m_allocations;
+    uint64_t allocated = allocation_bytes.load() - m_allocated;
+    if (ms_filter && !RE2::PartialMatch(m_name, *ms_filter))
+      return;
+    double items = m_items ? (double)m_items : 1.0;
+    String allocs_per_item("-"), bytes_per_item("-");
+    if (ms_count_allocations) {
+      allocs_per_item = format("%.2f", allocations / items);
+      bytes_per_item = format("%.1f", allocated / items);
+    }
+    printf("%-32s %10.1f %10llu %12.0f %10.1f %10s %10s  %s\n",
+           m_name.c_str(), seconds * 1000.0, (Llu)m_items,
+           seconds > 0.0 ? m_items / seconds : 0.0,
+           seconds > 0.0 ? m_bytes / seconds / (1024.0*1024.0) : 0.0,
+           allocs_per_item.c_str(), bytes_per_item.c_str(), label.c_str());
+    fflush(stdout);
+  }
+
+  /** Cells produced by DataGenerator.
+   * Keys are stored serialized and values as ByteStrings, back to back in
+   * two buffers, so that the benchmarks don't measure key construction.
+   */
+  struct Dataset {
+    Dataset() : keys(0), values(0), bytes(0) { }
+    DynamicBuffer keys;
+    DynamicBuffer values;
+    std::vector<size_t> key_offsets;
+    std::vector<size_t> value_offsets;
+    std::vector<String> families;
+    uint64_t bytes;
+  };
+
+  void generate(PropertiesPtr &props, Dataset &data) {
+    DataGenerator generator(props);
+    std::map<String, uint8_t> family_ids;
+    int64_t revision = 1;
+
+    for (DataGenerator::iterator iter = generator.begin();
+         iter != generator.end(); iter++) {
+      Cell &cell = *iter;
+      uint8_t &family = family_ids[cell.column_family];
+      if (family == 0) {
+        HT_ASSERT(data.families.size() < 255);
+        data.families.push_back(cell.column_family);
+        family = data.families.size();
+      }
+      size_t key_offset = data.keys.fill();
+      size_t value_offset = data.values.fill();
+      create_key_and_append(data.keys, FLAG_INSERT, cell.row_key, family,
+                            cell.column_qualifier ? cell.column_qualifier : "",
+                            revision, revision);
+      revision++;
+      append_as_byte_string(data.values, cell.value, cell.value_len);
+      data.key_offsets.push_back(key_offset);
+      data.value_offsets.push_back(value_offset);
+      data.bytes += (data.keys.fill() - key_offset) + cell.value_len;
+    }
+  }
+
+  SchemaPtr create_schema(const Dataset &data) {
+    String str = "<Schema>\n  <AccessGroup name=\"default\">\n";
+    for (size_t i=0; i<data.families.size(); ++i)
+      str += format("    <ColumnFamily id=\"%u\">\n      <Name>%s</Name>\n"
+                    "    </ColumnFamily>\n", (unsigned)i+1,
+                    data.families[i].c_str());
+    str += "  </AccessGroup>\n</Schema>";
+    SchemaPtr schema = Schema::new_instance(str, str.length());
+    if (!schema->is_valid())
+      HT_THROWF(Error::BAD_SCHEMA, "%s", schema->get_error_string());
+    return schema;
+  }
+
+  /** Reads all cells of a scanner.
+   * @param scanner Scanner to drain
+   * @param bytes Incremented by the key and value bytes returned
+   * @return Number of cells returned
+   */
+  uint64_t drain(CellListScanner *scanner, uint64_t *bytes) {
+    Key key;
+    ByteString value;
+    uint64_t count = 0;
+    while (scanner->get(key, value)) {
+      count++;
+      *bytes += key.length + value.length();
+      scanner->forward();
+    }
+    return count;
+  }
+
+  /// Scan context state shared by the benchmarks
+  struct ScanState {
+    ScanState(SchemaPtr &schema_) : schema(schema_),
+      range(0, Key::END_ROW_MARKER) { }
+    ScanContextPtr context() {
+      return new ScanContext(TIMESTAMP_MAX, &builder.get(), &range, schema);
+    }
+    SchemaPtr schema;
+    RangeSpec range;
+    ScanSpecBuilder builder;
+  };
+
+  class StorageBench {
+  public:
+    StorageBench(Dataset &data, SchemaPtr &schema)
+      : m_data(data), m_schema(schema), m_table_id("2"),
+        m_table_name("StorageBench"),
+        m_version(get_i32("cellstore-version")),
+        m_min_time(get_f64("min-time")),
+        m_dir(get_bool("dfs-broker") ? get_str("dfs-dir") : String("/cs")),
+        m_next_store(0) {
+      if (m_version < 6 || m_version > 8)
+        HT_THROWF(Error::INVALID_ARGUMENT, "Unsupported cell store version %d",
+                  m_version);
+      m_cs_props = new Properties();
+      if (has("blocksize"))
+        m_cs_props->set("blocksize", (uint32_t)get_i32("blocksize"));
+      if (has("compressor"))
+        m_cs_props->set("compressor", get_str("compressor"));
+      if (has("bloom-filter"))
+        Schema::parse_bloom_filter(get_str("bloom-filter"), m_cs_props);
+      Global::dfs->rmdir(m_dir);
+      Global::dfs->mkdirs(m_dir);
+    }
+
+    ~StorageBench() {
+      m_merge_stores.clear();
+      m_store = 0;
+      m_cache = 0;
+      if (!get_bool("keep"))
+        Global::dfs->rmdir(m_dir);
+    }
+
+    void run();
+
+  private:
+    void cellcache_insert();
+    void cellcache_scan();
+    void cellstore_write();
+    void cellstore_scan();
+    void lookups();
+    void lookup(const char *name, CellList *list);
+    void merge();
+    void compaction();
+    void codecs();
+    void block_cache();
+
+    String next_store_name() {
+      return format("%s/cs%d", m_dir.c_str(), m_next_store++);
+    }
+
+    CellStorePtr new_store() {
+      if (m_version == 6)
+        return new CellStoreV6(Global::dfs.get(), m_schema.get());
+      if (m_version == 7)
+        return new CellStoreV7(Global::dfs.get(), m_schema.get());
+      return new CellStoreV8(Global::dfs.get(), m_schema.get());
+    }
+
+    /// Returns serialized cells in blocks of the cell store block size
+    void make_blocks(std::vector<DynamicBuffer *> &blocks);
+
+    Dataset &m_data;
+    SchemaPtr m_schema;
+    TableIdentifier m_table_id;
+    String m_table_name;
+    int32_t m_version;
+    double m_min_time;
+    String m_dir;
+    int m_next_store;
+    PropertiesPtr m_cs_props;
+    CellCachePtr m_cache;
+    CellStorePtr m_store;
+    std::vector<CellStorePtr> m_merge_stores;
+  };
+
+  void StorageBench::run() {
+    Measurement::print_header();
+    cellcache_insert();
+    cellcache_scan();
+    cellstore_write();
+    cellstore_scan();
+    lookups();
+    merge();
+    compaction();
+    codecs();
+    block_cache();
+  }
+
+  void StorageBench::cellcache_insert() {
+    std::vector<Key> keys(m_data.key_offsets.size());
+    for (size_t i=0; i<keys.size(); ++i)
+      keys[i].load(SerializedKey(m_data.keys.base + m_data.key_offsets[i]));
+    ByteString value;
+
+    m_cache = new CellCache();
+    Measurement measurement("cellcache/insert");
+    for (size_t i=0; i<keys.size(); ++i) {
+      value.ptr = m_data.values.base + m_data.value_offsets[i];
+      m_cache->add(keys[i], value);
+    }
+    measurement.add(keys.size(), m_data.bytes);
+    measurement.report(format("%u families", (unsigned)m_data.families.size()));
+  }
+
+  void StorageBench::cellcache_scan() {
+    ScanState state(m_schema);
+    ScanContextPtr scan_ctx = state.context();
+    uint64_t bytes = 0;
+    Measurement measurement("cellcache/scan");
+    CellListScannerPtr scanner = m_cache->create_scanner(scan_ctx);
+    measurement.add(drain(scanner.get(), &bytes), bytes);
+    measurement.report();
+  }
+
+  void StorageBench::cellstore_write() {
+    ScanState state(m_schema);
+    ScanContextPtr scan_ctx = state.context();
+    String name = next_store_name();
+    Key key;
+    ByteString value;
+    uint64_t count = 0, bytes = 0;
+
+    Measurement measurement("cellstore/write");
+    m_store = new_store();
+    m_store->create(name.c_str(), m_data.key_offsets.size(), m_cs_props,
+                    &m_table_id);
+    CellListScannerPtr scanner = m_cache->create_scanner(scan_ctx);
+    while (scanner->get(key, value)) {
+      m_store->add(key, value);
+      count++;
+      bytes += key.length + value.length();
+      scanner->forward();
+    }
+    m_store->finalize(&m_table_id);
+    measurement.add(count, bytes);
+    int64_t length = Global::dfs->length(name);
+    measurement.report(format("v%d, %lld blocks, %.1f MB on disk", m_version,
+                              (Lld)m_store->block_count(),
+                              (double)length / (1024.0*1024.0)));
+    m_store = CellStoreFactory::open(name, 0, 0);
+  }
+
+  void StorageBench::cellstore_scan() {
+    ScanState state(m_schema);
+    ScanContextPtr scan_ctx = state.context();
+    uint64_t bytes = 0;
+    Measurement measurement("cellstore/scan");
+    CellListScannerPtr scanner = m_store->create_scanner(scan_ctx);
+    measurement.add(drain(scanner.get(), &bytes), bytes);
+    measurement.report();
+  }
+
+  void StorageBench::lookups() {
+    lookup("cellcache/lookup", m_cache.get());
+    FileBlockCache *block_cache = Global::block_cache;
+    Global::block_cache = 0;
+    lookup("cellstore/lookup/uncached", m_store.get());
+    Global::block_cache = block_cache;
+    // first pass loads the block cache
+    lookup(0, m_store.get());
+    lookup("cellstore/lookup/cached", m_store.get());
+  }
+
+  void StorageBench::lookup(const char *name, CellList *list) {
+    size_t lookups = get_i32("lookups");
+    std::vector<String> rows;
+    rows.reserve(lookups);
+    Random::seed(get_i32("DataGenerator.Seed"));
+    Key key;
+    for (size_t i=0; i<lookups; ++i) {
+      size_t index = Random::number32() % m_data.key_offsets.size();
+      key.load(SerializedKey(m_data.keys.base + m_data.key_offsets[index]));
+      rows.push_back(key.row);
+    }
+
+    ScanState state(m_schema);
+    uint64_t cells = 0, bytes = 0;
+    Measurement measurement(name ? name : "");
+    foreach_ht (const String &row, rows) {
+      state.builder.clear();
+      state.builder.add_row(row.c_str());
+      ScanContextPtr scan_ctx = state.context();
+      CellListScannerPtr scanner = list->create_scanner(scan_ctx);
+      cells += drain(scanner.get(), &bytes);
+    }
+    measurement.add(rows.size(), bytes);
+    if (name)
+      measurement.report(format("%.2f cells/lookup",
+                                (double)cells / (double)rows.size()));
+  }
+
+  void StorageBench::merge() {
+    ScanState state(m_schema);
+    ScanContextPtr scan_ctx = state.context();
+    size_t nstores = std::max(2, get_i32("stores"));
+    Key key;
+    ByteString value;
+
+    // Deal the cells out to the stores so that the merge interleaves all of
+    // them, as the stores of an access group do
+    std::vector<String> names;
+    for (size_t i=0; i<nstores; ++i) {
+      names.push_back(next_store_name());
+      m_merge_stores.push_back(new_store());
+      m_merge_stores.back()->create(names.back().c_str(),
+          m_data.key_offsets.size() / nstores + 1, m_cs_props, &m_table_id);
+    }
+    CellListScannerPtr scanner = m_cache->create_scanner(scan_ctx);
+    for (size_t i=0; scanner->get(key, value); ++i) {
+      m_merge_stores[i % nstores]->add(key, value);
+      scanner->forward();
+    }
+    for (size_t i=0; i<nstores; ++i) {
+      m_merge_stores[i]->finalize(&m_table_id);
+      m_merge_stores[i] = CellStoreFactory::open(names[i], 0, 0);
+    }
+
+    uint64_t bytes = 0;
+    Measurement measurement("merge/scan");
+    MergeScannerPtr mscanner =
+      new MergeScannerAccessGroup(m_table_name, scan_ctx);
+    for (size_t i=0; i<nstores; ++i)
+      mscanner->add_scanner(m_merge_stores[i]->create_scanner(scan_ctx));
+    measurement.add(drain(mscanner.get(), &bytes), bytes);
+    measurement.report(format("%u stores", (unsigned)nstores));
+  }
+
+  void StorageBench::compaction() {
+    ScanState state(m_schema);
+    ScanContextPtr scan_ctx = state.context();
+    String name = next_store_name();
+    Key key;
+    ByteString value;
+    uint64_t count = 0, bytes = 0;
+
+    Measurement measurement("merge/compaction");
+    MergeScannerPtr mscanner =
+      new MergeScannerAccessGroup(m_table_name, scan_ctx,
+                                  MergeScanner::IS_COMPACTION |
+                                  MergeScanner::RETURN_DELETES);
+    for (size_t i=0; i<m_merge_stores.size(); ++i)
+      mscanner->add_scanner(m_merge_stores[i]->create_scanner(scan_ctx));
+    CellStorePtr cellstore = new_store();
+    cellstore->create(name.c_str(), m_data.key_offsets.size(), m_cs_props,
+                      &m_table_id);
+    while (mscanner->get(key, value)) {
+      cellstore->add(key, value);
+      count++;
+      bytes += key.length + value.length();
+      mscanner->forward();
+    }
+    cellstore->finalize(&m_table_id);
+    measurement.add(count, bytes);
+    measurement.report(format("%u stores", (unsigned)m_merge_stores.size()));
+  }
+
+  void StorageBench::make_blocks(std::vector<DynamicBuffer *> &blocks) {
+    size_t blocksize = m_store->get_blocksize();
+    DynamicBuffer *block = 0;
+    for (size_t i=0; i<m_data.key_offsets.size(); ++i) {
+      const uint8_t *key = m_data.keys.base + m_data.key_offsets[i];
+      const uint8_t *value = m_data.values.base + m_data.value_offsets[i];
+      size_t key_length = SerializedKey(key).length();
+      size_t value_length = ByteString(value).length();
+      if (block == 0 || block->fill() >= blocksize) {
+        block = new DynamicBuffer(blocksize + key_length + value_length);
+        blocks.push_back(block);
+      }
+      block->add_unchecked(key, key_length);
+      block->add_unchecked(value, value_length);
+    }
+  }
+
+  void StorageBench::codecs() {
+    std::vector<DynamicBuffer *> blocks;
+    make_blocks(blocks);
+    uint64_t block_bytes = 0;
+    foreach_ht (DynamicBuffer *block, blocks)
+      block_bytes += block->fill();
+
+    std::vector<String> names;
+    boost::split(names, get_str("codecs"), boost::is_any_of(", "),
+                 boost::token_compress_on);
+    foreach_ht (const String &codec_name, names) {
+      if (codec_name.empty())
+        continue;
+      BlockCompressionCodecPtr codec;
+      try { codec = CompressorFactory::create_block_codec(codec_name); }
+      catch (Exception &e) {
+        HT_ERRORF("Skipping codec %s - %s", codec_name.c_str(), e.what());
+        continue;
+      }
+      std::vector<DynamicBuffer *> zblocks(blocks.size());
+      uint64_t zbytes = 0;
+      for (size_t i=0; i<blocks.size(); ++i) {
+        BlockCompressionHeader header(MAGIC);
+        zblocks[i] = new DynamicBuffer(0);
+        codec->deflate(*blocks[i], *zblocks[i], header);
+        zbytes += zblocks[i]->fill();
+      }
+      String label = format("ratio %.3f", (double)zbytes / (double)block_bytes);
+
+      DynamicBuffer output(0);
+      {
+        Measurement measurement(format("codec/%s/deflate", codec_name.c_str()));
+        do {
+          for (size_t i=0; i<blocks.size(); ++i) {
+            BlockCompressionHeader header(MAGIC);
+            codec->deflate(*blocks[i], output, header);
+          }
+          measurement.add(blocks.size(), block_bytes);
+        } while (measurement.elapsed() < m_min_time);
+        measurement.report(label);
+      }
+      {
+        Measurement measurement(format("codec/%s/inflate", codec_name.c_str()));
+        do {
+          for (size_t i=0; i<zblocks.size(); ++i) {
+            BlockCompressionHeader header;
+            const uint8_t *ptr = zblocks[i]->base;
+            size_t remaining = zblocks[i]->fill();
+            header.decode(&ptr, &remaining);
+            codec->inflate(*zblocks[i], output, header);
+          }
+          measurement.add(zblocks.size(), block_bytes);
+        } while (measurement.elapsed() < m_min_time);
+        measurement.report(label);
+      }
+      foreach_ht (DynamicBuffer *zblock, zblocks)
+        delete zblock;
+    }
+
+    foreach_ht (DynamicBuffer *block, blocks)
+      delete block;
+  }
+
+  void StorageBench::block_cache() {
+    std::vector<DynamicBuffer *> blocks;
+    make_blocks(blocks);
+    uint64_t block_bytes = 0;
+    foreach_ht (DynamicBuffer *block, blocks)
+      block_bytes += block->fill();
+    int file_id = FileBlockCache::get_next_file_id();
+
+    // Blocks are copied before insertion, as the scanners do with the
+    // blocks they read
+    {
+      FileBlockCache cache(block_bytes, block_bytes, false);
+      Measurement measurement("block_cache/insert");
+      for (size_t i=0; i<blocks.size(); ++i) {
+        uint8_t *copy = new uint8_t [blocks[i]->fill()];
+        memcpy(copy, blocks[i]->base, blocks[i]->fill());
+        if (!cache.insert(file_id, i, copy, blocks[i]->fill()))
+          delete [] copy;
+      }
+      measurement.add(blocks.size(), block_bytes);
+      measurement.report("includes block copy");
+
+      uint8_t *block;
+      uint32_t length;
+      Measurement hit_measurement("block_cache/hit");
+      do {
+        for (size_t i=0; i<blocks.size(); ++i) {
+          if (cache.checkout(file_id, i, &block, &length))
+            cache.checkin(file_id, i);
+        }
+        hit_measurement.add(blocks.size(), block_bytes);
+      } while (hit_measurement.elapsed() < m_min_time);
+      hit_measurement.report();
+    }
+
+    // A cache holding a quarter of the blocks, so every insert evicts
+    {
+      FileBlockCache cache(block_bytes / 4, block_bytes / 4, false);
+      Measurement measurement("block_cache/evict");
+      do {
+        file_id = FileBlockCache::get_next_file_id();
+        for (size_t i=0; i<blocks.size(); ++i) {
+          uint8_t *copy = new uint8_t [blocks[i]->fill()];
+          memcpy(copy, blocks[i]->base, blocks[i]->fill());
+          if (!cache.insert(file_id, i, copy, blocks[i]->fill()))
+            delete [] copy;
+        }
+        measurement.add(blocks.size(), block_bytes);
+      } while (measurement.elapsed() < m_min_time);
+      measurement.report("includes block copy");
+    }
+
+    foreach_ht (DynamicBuffer *block, blocks)
+      delete block;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  PropertiesPtr generator_props = new Properties();
+
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    if (has("spec-file")) {
+      String spec_file = get_str("spec-file");
+      if (FileUtils::exists(spec_file))
+        generator_props->load(spec_file, cmdline_hidden_desc(), true);
+      else
+        HT_THROW(Error::FILE_NOT_FOUND, spec_file);
+    }
+    else {
+      generator_props->set("rowkey.order", String("random"));
+      generator_props->set("rowkey.component.0.type", String("integer"));
+      generator_props->set("rowkey.component.0.format", String("%020lld"));
+      generator_props->set("rowkey.component.0.min", String("0"));
+      generator_props->set("rowkey.component.0.max",
+                           String("100000000000000000"));
+      generator_props->set("col.value.size", String("100"));
+    }
+
+    if (get_str("filter") != "") {
+      Measurement::ms_filter = new RE2(get_str("filter"));
+      if (!Measurement::ms_filter->ok())
+        HT_THROWF(Error::INVALID_ARGUMENT, "Bad filter '%s' - %s",
+                  get_str("filter").c_str(),
+                  Measurement::ms_filter->error().c_str());
+    }
+
+    Measurement::ms_count_allocations = count_allocations();
+
+    if (get_bool("dfs-broker")) {
+      ReactorFactory::initialize(2);
+
+      // Cell stores are written through the broker and read in-process, so
+      // reads are not measured with a broker round trip
+      FilesystemPtr broker = new DfsBroker::Client(get_str("DfsBroker.Host"),
+          get_i16("DfsBroker.Port"), get_i32("Hypertable.Request.Timeout"));
+      Path root = get_str("DfsBroker.Local.Root", "");
+      if (!root.is_complete())
+        root = Path(get_str("Hypertable.DataDirectory")) / root;
+      if (!DfsBroker::LocalFilesystem::shares_root(broker, root.string()))
+        HT_THROWF(Error::INVALID_ARGUMENT, "DFS broker does not keep its "
+                  "files under %s, a local broker is required",
+                  root.string().c_str());
+      Global::dfs = new DfsBroker::LocalFilesystem(broker, root.string());
+    }
+    else
+      Global::dfs = new PosixFilesystem(get_str("dir"));
+
+    int64_t block_cache_size = get_i64("block-cache-size");
+    Global::block_cache = new FileBlockCache(block_cache_size,
+                                             block_cache_size, false);
+    Global::memory_tracker = new MemoryTracker(Global::block_cache, 0);
+
+    Dataset data;
+    {
+      Measurement measurement("generate");
+      generate(generator_props, data);
+      measurement.add(data.key_offsets.size(), data.bytes);
+      measurement.report();
+    }
+    if (data.key_offsets.empty())
+      HT_THROW(Error::INVALID_ARGUMENT, "DataGenerator produced no cells");
+
+    SchemaPtr schema = create_schema(data);
+    {
+      StorageBench bench(data, schema);
+      bench.run();
+    }
+
+    Global::dfs = 0;
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
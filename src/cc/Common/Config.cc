@@ -175,6 +175,17 @@ void DefaultPolicy::init_options() {
         "Disable verbose output (system wide)")
     ("Hypertable.Logging.Level", str()->default_value("info"),
         "Set system wide logging level (default: info)")
+    ("Hypertable.Logging.Async", boo()->default_value(false),
+        "Write log messages from a background thread instead of the "
+        "logging thread")
+    ("Hypertable.Logging.Async.QueueLength", i32()->default_value(256),
+        "Number of message slots buffered per thread in asynchronous mode")
+    ("Hypertable.Logging.Async.DropWhenFull", boo()->default_value(true),
+        "Drop NOTICE, INFO and DEBUG messages instead of waiting when a "
+        "thread's buffer is full in asynchronous mode")
+    ("Hypertable.Logging.RateLimit", i32()->default_value(0),
+        "Maximum NOTICE, INFO and DEBUG messages per second logged by a "
+        "single call site (0 = unlimited)")
     ("Hypertable.DataDirectory", str()->default_value(default_data_dir),
         "Hypertable data directory root")
     ("Hypertable.Client.Workers", i32()->default_value(20),
@@ -231,6 +242,11 @@ void DefaultPolicy::init_options() {
     ("DfsBroker.Local.Root", str(), "Root of file and directory "
         "hierarchy for local broker (if relative path, then is relative to "
         "the Hypertable data directory root)")
+    ("DfsBroker.Local.InProcessReads", boo()->default_value(false),
+        "Read files of the local broker in-process through memory mapping "
+        "instead of through the broker (read by RangeServer; ignored unless "
+        "the broker runs on the same host and keeps its files under "
+        "DfsBroker.Local.Root)")
     ("DfsBroker.Local.Workers", i32()->default_value(20),
         "Number of local broker worker threads created")
     ("DfsBroker.Local.Reactors", i32(),
@@ -247,9 +263,15 @@ void DefaultPolicy::init_options() {
     ("Hyperspace.Maintenance.Interval", i32()->default_value(60000), "Hyperspace "
         " maintenance interval (checkpoint BerkeleyDB, log cleanup etc)")
     ("Hyperspace.Checkpoint.Size", i32()->default_value(1*M), "Run BerkeleyDB checkpoint"
-        " when logs exceed this size limit")
+        " when logs exceed this size limit (WAL store: snapshot threshold)")
+    ("Hyperspace.Store", str()->default_value("bdb"), "Storage backend of the "
+        "Hyperspace master: 'bdb' (BerkeleyDB, supports replication) or 'wal' "
+        "(write-ahead log + snapshots, single replica only)")
     ("Hyperspace.Client.Datagram.SendPort", i16()->default_value(0),
         "Client UDP send port for keepalive packets")
+    ("Hyperspace.Client.Cache.Enable", boo()->default_value(true),
+        "Cache attributes, directory listings and existence checks of nodes "
+        "held open by the client with matching event masks")
     ("Hyperspace.LogGc.Interval", i32()->default_value(60000), "Check for unused BerkeleyDB "
         "log files after this much time")
     ("Hyperspace.LogGc.MaxUnusedLogs", i32()->default_value(200), "Number of unused BerkeleyDB "
@@ -283,6 +305,10 @@ void DefaultPolicy::init_options() {
         "Monitoring statistics gathering interval (in milliseconds)")
     ("Hypertable.Monitoring.Disable", boo()->default_value(false),
         "Disables the generation of monitoring statistics")
+    ("Hypertable.Monitoring.RrdTool", boo()->default_value(false),
+        "Also write monitoring statistics to rrdtool files for external "
+        "tools; this spawns rrdtool for every RangeServer and table each "
+        "interval (the monitoring UI reads the time series files)")
     ("Hypertable.LoadBalancer.Enable", boo()->default_value(true),
         "Enable automatic load balancing")
     ("Hypertable.LoadBalancer.Crontab", str()->default_value("0 0 * * *"),
@@ -314,8 +340,30 @@ void DefaultPolicy::init_options() {
         "all servers to trigger a scatter buffer flush")
     ("Hypertable.Scanner.QueueSize",
      i32()->default_value(5), "Size of Scanner ScanBlock queue")
+    ("Hypertable.Scanner.StreamWindow",
+     i32()->default_value(0), "Number of scan blocks a RangeServer pushes "
+        "per fetch request without waiting for the client; 0 fetches one "
+        "block per round trip")
+    ("Hypertable.Scanner.Parallelism",
+     i32()->default_value(8), "Maximum number of ranges scanned concurrently "
+        "by a scanner created with the PARALLEL or UNORDERED flag")
+    ("Hypertable.Scanner.Index.SelectivityThreshold",
+     f64()->default_value(0.5), "Fraction of a column's secondary index "
+        "ranges a query may cover before the primary table is scanned "
+        "instead of the index")
+    ("Hypertable.Scanner.Index.MaxProbeRanges",
+     i32()->default_value(32), "Maximum number of index ranges examined "
+        "per row interval when estimating index selectivity; if a column "
+        "has more, the index is always used")
     ("Hypertable.LocationCache.MaxEntries", i64()->default_value(1*M),
         "Size of range location cache in number of entries")
+    ("Hypertable.LocationCache.Partitions", i32()->default_value(16),
+        "Number of independently locked partitions of the range location "
+        "cache; each table is striped over them by row ranges that hold "
+        "equal numbers of its cached locations")
+    ("Hypertable.LocationCache.NegativeTTL", i32()->default_value(1000),
+        "Time in milliseconds a row that could not be located is remembered "
+        "so that other lookups fail without scanning METADATA; 0 disables")
     ("Hypertable.Master.Host", str(),
         "Host on which Hypertable Master is running")
     ("Hypertable.Master.Port", i16()->default_value(38050),
@@ -389,6 +437,9 @@ void DefaultPolicy::init_options() {
         i32()->default_value(64*KiB), "Default block size for cell stores")
     ("Hypertable.RangeServer.Data.DefaultReplication",
         i32()->default_value(-1), "Default replication for data")
+    ("Hypertable.RangeServer.CellStore.RestartInterval",
+        i32()->default_value(16), "Number of keys between prefix compression "
+        "restart points in cell store blocks, 0 disables restart points")
     ("Hypertable.RangeServer.CellStore.DefaultCompressor",
         str()->default_value("snappy"), "Default compressor for cell stores")
     ("Hypertable.RangeServer.CellStore.DefaultBloomFilter",
@@ -403,12 +454,21 @@ void DefaultPolicy::init_options() {
      "Default minimum group commit interval in milliseconds")
     ("Hypertable.RangeServer.BlockCache.Compressed", boo()->default_value(true),
         "Controls whether or not block cache stores compressed blocks")
+    ("Hypertable.RangeServer.BlockCache.Decoded", boo()->default_value(false),
+        "Controls whether or not block cache also stores decoded blocks, whose "
+        "fully expanded keys can be binary searched")
     ("Hypertable.RangeServer.BlockCache.MinMemory", i64()->default_value(0),
         "Minimum size of block cache")
     ("Hypertable.RangeServer.BlockCache.MaxMemory", i64()->default_value(-1),
         "Maximum (target) size of block cache")
     ("Hypertable.RangeServer.QueryCache.MaxMemory", i64()->default_value(50*M),
         "Maximum size of query cache")
+    ("Hypertable.RangeServer.MemoryGovernor.Enable", boo()->default_value(false),
+        "Continuously rebalance memory between block cache and query cache "
+        "according to measured marginal hit rates")
+    ("Hypertable.RangeServer.MemoryGovernor.StepPercentage",
+        i32()->default_value(2), "Amount of memory moved between consumers "
+        "per maintenance interval, as percentage of RangeServer memory limit")
     ("Hypertable.RangeServer.Range.RowSize.Unlimited", boo()->default_value(false),
      "Marks range active and unsplittable upon encountering row overflow condition. "
      "Can cause ranges to grow extremely large.  Use with caution!")
@@ -423,6 +483,10 @@ void DefaultPolicy::init_options() {
         "range in bytes before splitting (for testing)")
     ("Hypertable.RangeServer.Range.SplitOff", str()->default_value("high"),
         "Portion of range to split off (high or low)")
+    ("Hypertable.RangeServer.Range.CopyFreeSplit", boo()->default_value(false),
+        "Split ranges by flushing the cell cache only, letting both halves "
+        "share the existing CellStores until they are rewritten by a "
+        "background merging compaction")
     ("Hypertable.RangeServer.ClockSkew.Max", i32()->default_value(3*M),
         "Maximum amount of clock skew (microseconds) the system will tolerate")
     ("Hypertable.RangeServer.CommitLog.DfsBroker.Host", str(),
@@ -443,10 +507,17 @@ void DefaultPolicy::init_options() {
     ("Hypertable.RangeServer.CommitLog.Compressor",
         str()->default_value("quicklz"),
        "Commit log compressor to use (zlib, lzo, quicklz, snappy, bmz, none)")
+    ("Hypertable.RangeServer.CommitLog.Stripes", i32()->default_value(1),
+        "Number of directories the user commit log is striped across; stripe "
+        "N > 0 is the stripe.N subdirectory of the log, which can be mounted "
+        "on its own disk")
     ("Hypertable.RangeServer.Testing.MaintenanceNeeded.PauseInterval", i32()->default_value(0),
         "TESTING:  After update, if range needs maintenance, pause for this number of milliseconds")
     ("Hypertable.RangeServer.UpdateCoalesceLimit", i64()->default_value(5*M),
         "Amount of update data to coalesce into single commit log sync")
+    ("Hypertable.RangeServer.Trace.SampleInterval", i32()->default_value(0),
+        "Log a per phase latency trace of every Nth scan and update request "
+        "(0 disables tracing)")
     ("Hypertable.RangeServer.Failover.FlushLimit.PerRange",
      i32()->default_value(10*M), "Amount of updates (bytes) accumulated for a "
         "single range to trigger a replay buffer flush")
@@ -597,6 +668,14 @@ void DefaultPolicy::init() {
     HT_ERROR_OUT << "unknown logging level: "<< loglevel << HT_END;
     _exit(0);
   }
+
+  Logger::get()->set_rate_limit(get_i32("Hypertable.Logging.RateLimit"));
+  if (get_bool("Hypertable.Logging.Async"))
+    Logger::get()->set_async(get_i32("Hypertable.Logging.Async.QueueLength"),
+                             get_bool("Hypertable.Logging.Async.DropWhenFull"));
+  else
+    Logger::get()->set_sync();
+
   if (verbose) {
     HT_NOTICE_OUT << "Initializing " << System::exe_name << " (Hypertable "
         << version_string() << ")..." << HT_END;
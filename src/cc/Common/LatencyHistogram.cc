@@ -0,0 +1,155 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for LatencyHistogram.
+ * This file contains definitions for LatencyHistogram, a lock-free
+ * histogram of latencies with bounded relative error.
+ */
+
+#include "Compat.h"
+#include "Error.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "Serialization.h"
+
+using namespace Hypertable;
+
+LatencyHistogram::LatencyHistogram() : m_count(0), m_sum(0), m_max(0) {
+  for (size_t i=0; i<BUCKETS; ++i)
+    m_counts[i] = 0;
+}
+
+void LatencyHistogram::snapshot(Snapshot &snapshot) const {
+  snapshot.counts.resize(BUCKETS);
+  for (size_t i=0; i<BUCKETS; ++i)
+    snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+  snapshot.count = m_count.load(std::memory_order_relaxed);
+  snapshot.sum = m_sum.load(std::memory_order_relaxed);
+  snapshot.max = m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+  if (index < SUB_BUCKETS)
+    return index;
+  size_t exponent = (index / SUB_BUCKETS) + 3;
+  uint64_t mantissa = (index % SUB_BUCKETS) + SUB_BUCKETS;
+  return ((mantissa + 1) << (exponent - 4)) - 1;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double fraction) const {
+  if (count == 0)
+    return 0;
+  uint64_t rank = (uint64_t)(fraction * count + 0.5);
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t i=0; i<counts.size(); ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      uint64_t bound = bucket_upper_bound(i);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot &other) {
+  if (counts.size() < other.counts.size())
+    counts.resize(other.counts.size(), 0);
+  for (size_t i=0; i<other.counts.size(); ++i)
+    counts[i] += other.counts[i];
+  count += other.count;
+  sum += other.sum;
+  if (other.max > max)
+    max = other.max;
+}
+
+void LatencyHistogram::Snapshot::subtract(const Snapshot &earlier) {
+  if (earlier.count > count || earlier.counts.size() > counts.size())
+    return;
+  for (size_t i=0; i<earlier.counts.size(); ++i)
+    if (earlier.counts[i] > counts[i])
+      return;
+  for (size_t i=0; i<earlier.counts.size(); ++i)
+    counts[i] -= earlier.counts[i];
+  count -= earlier.count;
+  sum = sum > earlier.sum ? sum - earlier.sum : 0;
+  uint64_t bound = 0;
+  for (size_t i=counts.size(); i>0; --i) {
+    if (counts[i-1]) {
+      bound = bucket_upper_bound(i-1);
+      break;
+    }
+  }
+  if (bound < max)
+    max = bound;
+}
+
+size_t LatencyHistogram::Snapshot::encoded_length() const {
+  uint32_t nonzero = 0;
+  size_t length = 0;
+  for (size_t i=0; i<counts.size(); ++i) {
+    if (counts[i]) {
+      length += Serialization::encoded_length_vi32(i) +
+        Serialization::encoded_length_vi64(counts[i]);
+      nonzero++;
+    }
+  }
+  return length + Serialization::encoded_length_vi32(nonzero) +
+    Serialization::encoded_length_vi64(count) +
+    Serialization::encoded_length_vi64(sum) +
+    Serialization::encoded_length_vi64(max);
+}
+
+void LatencyHistogram::Snapshot::encode(uint8_t **bufp) const {
+  uint32_t nonzero = 0;
+  for (size_t i=0; i<counts.size(); ++i)
+    if (counts[i])
+      nonzero++;
+  Serialization::encode_vi64(bufp, count);
+  Serialization::encode_vi64(bufp, sum);
+  Serialization::encode_vi64(bufp, max);
+  Serialization::encode_vi32(bufp, nonzero);
+  for (size_t i=0; i<counts.size(); ++i) {
+    if (counts[i]) {
+      Serialization::encode_vi32(bufp, i);
+      Serialization::encode_vi64(bufp, counts[i]);
+    }
+  }
+}
+
+void LatencyHistogram::Snapshot::decode(const uint8_t **bufp,
+                                        size_t *remainp) {
+  count = Serialization::decode_vi64(bufp, remainp);
+  sum = Serialization::decode_vi64(bufp, remainp);
+  max = Serialization::decode_vi64(bufp, remainp);
+  counts.assign(BUCKETS, 0);
+  uint32_t nonzero = Serialization::decode_vi32(bufp, remainp);
+  for (uint32_t i=0; i<nonzero; ++i) {
+    uint32_t index = Serialization::decode_vi32(bufp, remainp);
+    uint64_t value = Serialization::decode_vi64(bufp, remainp);
+    if (index >= BUCKETS)
+      HT_THROWF(Error::SERIALIZATION_INPUT_OVERRUN,
+                "Latency histogram bucket %u out of range", (unsigned)index);
+    counts[index] = value;
+  }
+}
@@ -0,0 +1,198 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for LatencyHistogram.
+ * This file contains declarations for LatencyHistogram, a lock-free
+ * histogram of latencies with bounded relative error, and
+ * LatencyHistogram::Snapshot, its serializable copy.
+ */
+
+#ifndef HYPERTABLE_LATENCYHISTOGRAM_H
+#define HYPERTABLE_LATENCYHISTOGRAM_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Hypertable {
+
+  /** @addtogroup Common
+   *  @{
+   */
+
+  /** Histogram of latencies in microseconds.
+   * Buckets are log-linear, in the style of HDR histograms: values below 16
+   * have a bucket each, larger values are split into 16 buckets per power of
+   * two.  Reported percentiles are therefore within 6.25% of the recorded
+   * value.  Values above 2^41 microseconds (about 25 days) are clamped.
+   *
+   * record() only performs relaxed atomic increments, so it can be called
+   * concurrently from any number of threads on hot paths.  snapshot() copies
+   * the counters for reporting; it is not atomic with respect to concurrent
+   * record() calls, which is harmless for monitoring.
+   */
+  class LatencyHistogram : boost::noncopyable {
+  public:
+
+    /// Number of linear buckets, also sub-buckets per power of two
+    static const size_t SUB_BUCKETS = 16;
+
+    /// Exponent of the first power of two that is clamped
+    static const size_t MAX_EXPONENT = 41;
+
+    /// Total number of buckets
+    static const size_t BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - 3);
+
+    /** Copy of a histogram's counters.
+     * Snapshots can be merged, serialized and queried for percentiles.
+     */
+    class Snapshot {
+    public:
+      /// Constructor; creates empty snapshot
+      Snapshot() : counts(BUCKETS, 0), count(0), sum(0), max(0) { }
+
+      /** Returns value at or below which a fraction of samples fall.
+       * @param fraction Fraction between 0.0 and 1.0, e.g. 0.99 for p99
+       * @return Upper bound of the bucket containing the percentile
+       *         (microseconds), never more than #max
+       */
+      uint64_t percentile(double fraction) const;
+
+      /** Returns mean of the samples.
+       * @return Mean in microseconds, 0 if empty
+       */
+      double mean() const { return count ? (double)sum / (double)count : 0.0; }
+
+      /** Adds counters of another snapshot.
+       * @param other Snapshot to add
+       */
+      void merge(const Snapshot &other);
+
+      /** Removes counters of an earlier snapshot of the same histogram.
+       * Leaves the samples recorded between the two snapshots.  If
+       * <code>earlier</code> holds more samples than this snapshot the
+       * histogram was reset in between and this snapshot is left unchanged.
+       * Since the histogram only tracks its cumulative maximum, #max is
+       * capped at the upper bound of the highest non-empty bucket.
+       * @param earlier Earlier snapshot of the same histogram
+       */
+      void subtract(const Snapshot &earlier);
+
+      /// Returns serialized length
+      size_t encoded_length() const;
+
+      /** Serializes snapshot; only non-empty buckets are encoded.
+       * @param bufp Address of destination buffer pointer (advanced by call)
+       */
+      void encode(uint8_t **bufp) const;
+
+      /** Deserializes snapshot.
+       * @param bufp Address of source buffer pointer (advanced by call)
+       * @param remainp Address of remaining input buffer length (decremented
+       *        by call)
+       */
+      void decode(const uint8_t **bufp, size_t *remainp);
+
+      /// Equality operator
+      bool operator==(const Snapshot &other) const {
+        return count == other.count && sum == other.sum &&
+          max == other.max && counts == other.counts;
+      }
+
+      /// Sample count per bucket
+      std::vector<uint64_t> counts;
+
+      /// Number of samples
+      uint64_t count;
+
+      /// Sum of samples (microseconds)
+      uint64_t sum;
+
+      /// Largest sample (microseconds)
+      uint64_t max;
+    };
+
+    /// Constructor
+    LatencyHistogram();
+
+    /** Records a sample.
+     * @param usec Latency in microseconds
+     */
+    void record(uint64_t usec) {
+      m_counts[bucket(usec)].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(usec, std::memory_order_relaxed);
+      uint64_t max = m_max.load(std::memory_order_relaxed);
+      while (usec > max &&
+             !m_max.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+        ;
+    }
+
+    /** Copies counters.
+     * @param snapshot Filled in with current counters
+     */
+    void snapshot(Snapshot &snapshot) const;
+
+    /** Returns bucket index of a value.
+     * @param usec Value in microseconds
+     * @return Bucket index
+     */
+    static size_t bucket(uint64_t usec) {
+      if (usec < SUB_BUCKETS)
+        return usec;
+      int exponent = 63 - __builtin_clzll(usec);
+      if (exponent >= (int)MAX_EXPONENT)
+        return BUCKETS - 1;
+      return SUB_BUCKETS * (exponent - 3) +
+        ((usec >> (exponent - 4)) - SUB_BUCKETS);
+    }
+
+    /** Returns the largest value that falls into a bucket.
+     * @param index Bucket index
+     * @return Upper bound of bucket (microseconds)
+     */
+    static uint64_t bucket_upper_bound(size_t index);
+
+  private:
+
+    /// Sample count per bucket
+    std::atomic<uint64_t> m_counts[BUCKETS];
+
+    /// Number of samples
+    std::atomic<uint64_t> m_count;
+
+    /// Sum of samples
+    std::atomic<uint64_t> m_sum;
+
+    /// Largest sample
+    std::atomic<uint64_t> m_max;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_LATENCYHISTOGRAM_H
@@ -28,13 +28,25 @@
 
 #include "Common/Compat.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <vector>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "String.h"
 #include "Logger.h"
 #include "Mutex.h"
+#include "ReaderEpoch.h"
 
 namespace Hypertable { namespace Logger {
 
@@ -42,18 +54,9 @@ static String logger_name;
 static LogWriter *logger_obj = 0;
 static Mutex mutex;
 
-void initialize(const String &name) {
-  logger_name = name;
-}
+namespace {
 
-LogWriter *get() {
-  if (!logger_obj)
-    logger_obj = new LogWriter(logger_name);
-  return logger_obj;
-}
-
-void LogWriter::log_string(int priority, const char *message) {
-  static const char *priority_name[] = {
+  const char *priority_name[] = {
     "FATAL",
     "ALERT",
     "CRIT",
@@ -65,17 +68,432 @@ void LogWriter::log_string(int priority, const char *message) {
     "NOTSET"
   };
 
+  /// Messages suppressed by CallSite::admit() and not yet reported
+  std::atomic<uint32_t> suppressed_messages(0);
+
+  /// Text bytes per ring buffer slot; longer messages use several slots
+  const size_t SLOT_TEXT_SIZE = 240;
+
+  /// Ring buffer slot holding a message or a fragment of one
+  struct Slot {
+    /// Time the message was logged
+    uint32_t time;
+    /// Message priority
+    int16_t priority;
+    /// True if this is the first fragment of the message
+    bool first;
+    /// True if this is the last fragment of the message
+    bool last;
+    /// Number of valid bytes in #text
+    uint32_t length;
+    /// Message text
+    char text[SLOT_TEXT_SIZE];
+  };
+
+  /** Single producer, single consumer ring buffer of a logging thread.
+   * The owning thread advances #head after filling slots, the writer
+   * advances #tail after writing them; all slots of a message are published
+   * together.
+   */
+  struct Ring {
+    Ring(size_t capacity)
+      : slots(capacity), head(0), tail(0), dropped(0), orphaned(false) { }
+    /// Message slots
+    std::vector<Slot> slots;
+    /// Number of slots ever published
+    std::atomic<uint64_t> head;
+    /// Number of slots ever written
+    std::atomic<uint64_t> tail;
+    /// Messages dropped because the ring was full
+    std::atomic<uint32_t> dropped;
+    /// Set when the owning thread has exited
+    std::atomic<bool> orphaned;
+  };
+
+  /// Smart pointer to Ring, shared by the owning thread and the writer
+  typedef boost::shared_ptr<Ring> RingPtr;
+
+  /// Thread local reference to the ring of a thread
+  struct ThreadRing {
+    ThreadRing(const RingPtr &ring, uint64_t generation)
+      : ring(ring), generation(generation) { }
+    /// Marks the ring for removal by the writer when the thread exits
+    ~ThreadRing() { ring->orphaned = true; }
+    /// Ring of the thread
+    RingPtr ring;
+    /// Generation of the AsyncWriter the ring is registered with
+    uint64_t generation;
+  };
+
+  /** Returns the thread local ring references.  Never destroyed, since
+   * threads may still exit after static destruction. */
+  boost::thread_specific_ptr<ThreadRing> &thread_rings() {
+    static boost::thread_specific_ptr<ThreadRing> *rings =
+      new boost::thread_specific_ptr<ThreadRing>();
+    return *rings;
+  }
+
+  /** Background writer of the asynchronous mode.
+   * Rings are registered when a thread first logs; the writer drains them
+   * when woken up by a producer, or at least every WAKEUP_MS milliseconds.
+   * Producers that find their ring full wait on #m_space_cond, which is
+   * signalled after every drain.
+   */
+  class AsyncWriter {
+  public:
+    AsyncWriter(LogWriter *log, FILE *file, size_t queue_length,
+                bool drop_when_full)
+      : m_log(log), m_file(file), m_queue_length(queue_length),
+        m_drop_when_full(drop_when_full), m_generation(++next_generation),
+        m_space_waiters(0), m_wakeup(false), m_shutdown(false),
+        m_thread(0) {
+      m_thread = new boost::thread(boost::bind(&AsyncWriter::run, this));
+    }
+
+    /// Stops the writer thread and writes the remaining messages
+    ~AsyncWriter() {
+      {
+        ScopedLock lock(m_wakeup_mutex);
+        m_shutdown = true;
+        m_cond.notify_one();
+      }
+      m_thread->join();
+      delete m_thread;
+      ScopedLock lock(m_drain_mutex);
+      drain();
+    }
+
+    /** Queues a message, waiting for space or dropping it according to
+     * the drop policy.
+     * @return false if the message is too large for the ring and has to be
+     * written synchronously
+     */
+    bool enqueue(int priority, uint32_t now, const char *message) {
+      Ring *ring = thread_ring();
+      size_t length = strlen(message);
+      uint64_t needed = length ? (length + SLOT_TEXT_SIZE - 1) / SLOT_TEXT_SIZE : 1;
+      uint64_t capacity = ring->slots.size();
+      uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+      if (needed > capacity)
+        return false;
+
+      if (capacity - (head - ring->tail.load(std::memory_order_acquire))
+          < needed) {
+        if (m_drop_when_full && priority > Priority::WARN) {
+          ring->dropped.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+        ScopedLock lock(m_space_mutex);
+        m_space_waiters++;
+        while (capacity - (head - ring->tail.load(std::memory_order_acquire))
+               < needed) {
+          wakeup();
+          m_space_cond.timed_wait(lock,
+              boost::posix_time::milliseconds(WAKEUP_MS));
+        }
+        m_space_waiters--;
+      }
+
+      for (uint64_t i=0; i<needed; ++i) {
+        Slot &slot = ring->slots[(head + i) % capacity];
+        size_t fragment = std::min(length, SLOT_TEXT_SIZE);
+        slot.time = now;
+        slot.priority = priority;
+        slot.first = i == 0;
+        slot.last = i == needed - 1;
+        slot.length = fragment;
+        memcpy(slot.text, message, fragment);
+        message += fragment;
+        length -= fragment;
+      }
+      ring->head.store(head + needed, std::memory_order_release);
+
+      // Only wake the writer when the ring fills up, otherwise it picks
+      // up the message within WAKEUP_MS
+      if ((head + needed) - ring->tail.load(std::memory_order_relaxed)
+          >= capacity / 2)
+        wakeup();
+      return true;
+    }
+
+    /// Writes all queued messages; must be called with #m_drain_mutex locked
+    void drain() {
+      std::vector<RingPtr> rings;
+      {
+        ScopedLock lock(m_rings_mutex);
+        rings = m_rings;
+      }
+      bool wrote = false;
+      for (size_t i=0; i<rings.size(); ++i) {
+        Ring *ring = rings[i].get();
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (tail != ring->head.load(std::memory_order_relaxed))
+          wrote = true;
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t capacity = ring->slots.size();
+        for (; tail != head; ++tail) {
+          Slot &slot = ring->slots[tail % capacity];
+          if (slot.first)
+            m_log->write_prefix(slot.priority, slot.time);
+          fwrite(slot.text, 1, slot.length, m_file);
+          if (slot.last)
+            fputc('\n', m_file);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        uint32_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+          m_log->write_prefix(Priority::WARN, (uint32_t)::time(0));
+          fprintf(m_file, "Log buffer full, dropped %u messages\n",
+                  (unsigned)dropped);
+          wrote = true;
+        }
+      }
+      if (wrote)
+        fflush(m_file);
+      remove_orphans();
+
+      if (m_space_waiters.load()) {
+        ScopedLock lock(m_space_mutex);
+        m_space_cond.notify_all();
+      }
+    }
+
+    /// Mutex serializing writes to the log file
+    Mutex m_drain_mutex;
+
+  private:
+
+    /// Wakeup interval of the writer thread
+    static const int WAKEUP_MS = 10;
+
+    /// Generation of the most recently created writer
+    static std::atomic<uint64_t> next_generation;
+
+    /// Returns ring of calling thread, creating it on first use
+    Ring *thread_ring() {
+      ThreadRing *thread_ring = thread_rings().get();
+      if (thread_ring == 0 || thread_ring->generation != m_generation) {
+        RingPtr ring(new Ring(m_queue_length));
+        thread_ring = new ThreadRing(ring, m_generation);
+        thread_rings().reset(thread_ring);
+        ScopedLock lock(m_rings_mutex);
+        m_rings.push_back(ring);
+      }
+      return thread_ring->ring.get();
+    }
+
+    /// Releases drained rings of exited threads
+    void remove_orphans() {
+      ScopedLock lock(m_rings_mutex);
+      std::vector<RingPtr>::iterator iter = m_rings.begin();
+      while (iter != m_rings.end()) {
+        Ring *ring = iter->get();
+        if (ring->orphaned && ring->tail.load() == ring->head.load())
+          iter = m_rings.erase(iter);
+        else
+          ++iter;
+      }
+    }
+
+    /// Wakes up the writer thread
+    void wakeup() {
+      ScopedLock lock(m_wakeup_mutex);
+      m_wakeup = true;
+      m_cond.notify_one();
+    }
+
+    /// Writer thread main loop
+    void run() {
+      while (true) {
+        {
+          ScopedLock lock(m_drain_mutex);
+          drain();
+        }
+        ScopedLock lock(m_wakeup_mutex);
+        if (m_shutdown)
+          break;
+        if (!m_wakeup)
+          m_cond.timed_wait(lock, boost::posix_time::milliseconds(WAKEUP_MS));
+        m_wakeup = false;
+      }
+    }
+
+    /// Log whose messages are written
+    LogWriter *m_log;
+
+    /// Output file handle
+    FILE *m_file;
+
+    /// Number of slots of new rings
+    size_t m_queue_length;
+
+    /// Drop NOTICE, INFO and DEBUG messages if a ring is full
+    bool m_drop_when_full;
+
+    /// Generation of this writer, distinguishes its rings from older ones
+    uint64_t m_generation;
+
+    /// Mutex protecting #m_rings
+    Mutex m_rings_mutex;
+
+    /// Registered rings
+    std::vector<RingPtr> m_rings;
+
+    /// Mutex for #m_space_cond
+    Mutex m_space_mutex;
+
+    /// Signalled after queued messages have been written
+    boost::condition m_space_cond;
+
+    /// Number of producers waiting on #m_space_cond
+    std::atomic<uint32_t> m_space_waiters;
+
+    /// Mutex for #m_cond, #m_wakeup and #m_shutdown
+    Mutex m_wakeup_mutex;
+
+    /// Signalled to wake up the writer thread
+    boost::condition m_cond;
+
+    /// Set when the writer thread has been woken up
+    bool m_wakeup;
+
+    /// Set to stop the writer thread
+    bool m_shutdown;
+
+    /// Writer thread
+    boost::thread *m_thread;
+  };
+
+  const int AsyncWriter::WAKEUP_MS;
+
+  std::atomic<uint64_t> AsyncWriter::next_generation(0);
+
+  /// Writer of the asynchronous mode, 0 in synchronous mode
+  std::atomic<AsyncWriter *> async_writer(0);
+
+  /// Tracks threads that may be using #async_writer
+  ReaderEpoch async_writer_users;
+
+  /// Stops the asynchronous writer at exit, writing pending messages
+  void stop_async_at_exit() {
+    if (logger_obj)
+      logger_obj->set_sync();
+  }
+
+}
+
+void initialize(const String &name) {
+  logger_name = name;
+}
+
+LogWriter *get() {
+  if (!logger_obj)
+    logger_obj = new LogWriter(logger_name);
+  return logger_obj;
+}
+
+bool CallSite::admit(int priority) {
+  uint32_t limit = get()->get_rate_limit();
+
+  if (limit == 0 || priority <= Priority::WARN)
+    return true;
+
+  // Windows are reset without synchronization; at worst a few extra
+  // messages get through when two threads start a new second together
+  uint32_t now = (uint32_t)::time(0);
+  if (m_second.load(std::memory_order_relaxed) != now) {
+    m_second.store(now, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+  }
+  if (m_count.fetch_add(1, std::memory_order_relaxed) < limit)
+    return true;
+  suppressed_messages.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void LogWriter::set_async(size_t queue_length, bool drop_when_full) {
+  static bool registered_atexit = false;
+  ScopedLock lock(mutex);
+  if (m_test_mode || async_writer.load())
+    return;
+  async_writer = new AsyncWriter(this, m_file, queue_length, drop_when_full);
+  if (!registered_atexit) {
+    atexit(stop_async_at_exit);
+    registered_atexit = true;
+  }
+}
+
+void LogWriter::set_sync() {
   ScopedLock lock(mutex);
-  if (m_test_mode) {
-    fprintf(m_file, "%s %s : %s\n", priority_name[priority], m_name.c_str(),
-            message);
+  AsyncWriter *writer = async_writer.exchange(0);
+  if (writer == 0)
+    return;
+  // wait for threads that are still queueing into the writer's rings
+  async_writer_users.synchronize();
+  delete writer;
+}
+
+bool LogWriter::is_async() const {
+  return async_writer.load() != 0;
+}
+
+void LogWriter::flush() {
+  {
+    ReaderEpoch::Section section(async_writer_users);
+    AsyncWriter *writer = async_writer.load();
+    if (writer) {
+      ScopedLock lock(writer->m_drain_mutex);
+      writer->drain();
+      return;
+    }
+  }
+  fflush(m_file);
+}
+
+void LogWriter::write_prefix(int priority, uint32_t time) {
+  uint32_t suppressed = suppressed_messages.load(std::memory_order_relaxed);
+
+  if (suppressed) {
+    suppressed = suppressed_messages.exchange(0, std::memory_order_relaxed);
+    if (m_test_mode)
+      fprintf(m_file, "NOTICE %s : Rate limit suppressed %u messages\n",
+              m_name.c_str(), (unsigned)suppressed);
+    else
+      fprintf(m_file, "%u NOTICE %s : Rate limit suppressed %u messages\n",
+              (unsigned)time, m_name.c_str(), (unsigned)suppressed);
   }
-  else {
-    time_t t = ::time(0);
-    fprintf(m_file, "%u %s %s : %s\n", (unsigned)t, priority_name[priority],
-            m_name.c_str(), message);
+
+  if (m_test_mode)
+    fprintf(m_file, "%s %s : ", priority_name[priority], m_name.c_str());
+  else
+    fprintf(m_file, "%u %s %s : ", (unsigned)time, priority_name[priority],
+            m_name.c_str());
+}
+
+void LogWriter::log_string(int priority, const char *message) {
+  uint32_t now = (uint32_t)::time(0);
+
+  {
+    ReaderEpoch::Section section(async_writer_users);
+    AsyncWriter *writer = async_writer.load();
+    if (writer) {
+      if (priority > Priority::ERROR && writer->enqueue(priority, now, message))
+        return;
+      // Write queued messages first to preserve their order
+      ScopedLock lock(writer->m_drain_mutex);
+      writer->drain();
+      write_prefix(priority, now);
+      fprintf(m_file, "%s\n", message);
+      fflush(m_file);
+      return;
+    }
   }
 
+  ScopedLock lock(mutex);
+  write_prefix(priority, now);
+  fprintf(m_file, "%s\n", message);
+
   flush();
 }
 
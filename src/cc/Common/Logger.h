@@ -32,6 +32,7 @@
 #include "Error.h"
 #include "String.h"
 
+#include <atomic>
 #include <iostream>
 #include <signal.h>
 #include <stdarg.h>
@@ -66,6 +67,16 @@ namespace Logger {
 
   /** The LogWriter class writes to stdout. It's not used directly, but
    * rather through the macros below (i.e. HT_ERROR_OUT, HT_ERRORF etc).
+   *
+   * By default every message is written (and flushed) synchronously.  In
+   * asynchronous mode (see set_async()) messages are copied into a
+   * lock-free ring buffer owned by the calling thread and written by a
+   * background thread, so logging threads never wait on stdio.  Messages
+   * from the same thread keep their order; messages from different threads
+   * may be reordered slightly.  Messages with priority ERROR or higher
+   * are still written before the call returns, after everything that was
+   * queued before them.  set_sync() stops the background thread and returns
+   * to synchronous mode.
    */
   class LogWriter {
     public:
@@ -74,8 +85,9 @@ namespace Logger {
        * @param name The name of the application
        */
       LogWriter(const String &name)
-        : m_show_line_numbers(true), m_test_mode(false), m_name(name),
-          m_priority(Priority::INFO), m_file(stdout) {
+        : m_show_line_numbers(true), m_test_mode(false),
+          m_name(name), m_priority(Priority::INFO), m_file(stdout),
+          m_rate_limit(0) {
       }
 
       /** Sets the message level; all messages with a higher level are discarded
@@ -109,11 +121,47 @@ namespace Logger {
         return m_show_line_numbers;
       }
 
-      /** Flushes the log file */
-      void flush() {
-        fflush(m_file);
+      /** Switches to asynchronous mode and starts the writer thread.
+       * When the ring buffer of a thread is full, WARN and more severe
+       * messages block until the writer has made room (backpressure).  Less
+       * severe messages block as well unless <code>drop_when_full</code> is
+       * set, in which case they are discarded and the number of discarded
+       * messages is logged by the writer.  Ignored in test mode or if
+       * already in asynchronous mode.
+       *
+       * @param queue_length Number of message slots per thread
+       * @param drop_when_full Drop NOTICE, INFO and DEBUG messages if the
+       *        ring buffer is full
+       */
+      void set_async(size_t queue_length, bool drop_when_full);
+
+      /** Switches back to synchronous mode.  Waits for threads that are
+       * queueing messages, writes all queued messages and stops the writer
+       * thread.  Does nothing if not in asynchronous mode.
+       */
+      void set_sync();
+
+      /** Returns true if messages are written by the background thread */
+      bool is_async() const;
+
+      /** Limits the NOTICE, INFO and DEBUG messages logged by a single call
+       * site (see CallSite)
+       *
+       * @param per_second Maximum messages per second, 0 for no limit
+       */
+      void set_rate_limit(uint32_t per_second) {
+        m_rate_limit = per_second;
       }
 
+      /** Returns the per call site rate limit (0 if unlimited) */
+      uint32_t get_rate_limit() const {
+        return m_rate_limit;
+      }
+
+      /** Flushes the log file; in asynchronous mode, writes all queued
+       * messages first */
+      void flush();
+
       /** Prints a debug message with variable arguments (similar to printf) */
       void debug(const char *format, ...);
 
@@ -130,6 +178,12 @@ namespace Logger {
         log_string(priority, message.c_str());
       }
 
+      /** Writes the "<time> <priority> <name> : " prefix of a message,
+       * preceded by a notice if CallSite limits suppressed messages.  Used
+       * by the asynchronous writer, which holds the write lock.
+       */
+      void write_prefix(int priority, uint32_t time);
+
     private:
       /** Appends a string message to the log */
       void log_string(int priority, const char *message);
@@ -151,6 +205,32 @@ namespace Logger {
 
       /** The output file handle */
       FILE *m_file;
+
+      /** Messages per second and call site, 0 if unlimited */
+      uint32_t m_rate_limit;
+  };
+
+  /** Per call site rate limiter.
+   * The logging macros keep a static instance at every call site, so a
+   * message logged in a tight loop cannot flood the log.  Each site admits
+   * up to LogWriter::get_rate_limit() NOTICE, INFO and DEBUG messages per
+   * second; WARN and more severe messages are never suppressed.  The number
+   * of suppressed messages is logged with the next message written.
+   */
+  class CallSite {
+    public:
+      /** Constructor */
+      constexpr CallSite() : m_second(0), m_count(0) { }
+
+      /** Returns true if a message of the given priority may be logged */
+      bool admit(int priority);
+
+    private:
+      /** Second of the current window */
+      std::atomic<uint32_t> m_second;
+
+      /** Messages logged in the current window */
+      std::atomic<uint32_t> m_count;
   };
 
   /** Public initialization function - creates a singleton instance of
@@ -177,7 +257,8 @@ namespace Logger {
 
 // printf interface macro helper; do not use directly
 #define HT_LOG(priority, msg) do { \
-  if (Logger::get()->is_enabled(priority)) { \
+  static Hypertable::Logger::CallSite _site_; \
+  if (Logger::get()->is_enabled(priority) && _site_.admit(priority)) { \
     if (Logger::get()->show_line_numbers()) \
       Logger::get()->log(priority, Hypertable::format( \
           "(%s:%d) %s", __FILE__, __LINE__, msg)); \
@@ -187,7 +268,8 @@ namespace Logger {
 } while (0)
 
 #define HT_LOGF(priority, fmt, ...) do { \
-  if (Logger::get()->is_enabled(priority)) { \
+  static Hypertable::Logger::CallSite _site_; \
+  if (Logger::get()->is_enabled(priority) && _site_.admit(priority)) { \
     if (Logger::get()->show_line_numbers()) \
       Logger::get()->log(priority, Hypertable::format( \
           "(%s:%d) " fmt, __FILE__, __LINE__, __VA_ARGS__)); \
@@ -200,7 +282,8 @@ namespace Logger {
 // stream interface macro helpers
 #define HT_LOG_BUF_SIZE 4096
 
-#define HT_OUT(priority) do { if (Logger::get()->is_enabled(priority)) { \
+#define HT_OUT(priority) do { static Hypertable::Logger::CallSite _site_; \
+  if (Logger::get()->is_enabled(priority) && _site_.admit(priority)) { \
   char logbuf[HT_LOG_BUF_SIZE]; \
   int _priority_ = Logger::get()->get_level(); \
   FixedOstream _out_(logbuf, sizeof(logbuf)); \
@@ -208,7 +291,8 @@ namespace Logger {
     _out_ <<"("<< __FILE__ <<':'<< __LINE__ <<") "; \
   _out_
 
-#define HT_OUT2(priority) do { if (Logger::get()->is_enabled(priority)) { \
+#define HT_OUT2(priority) do { static Hypertable::Logger::CallSite _site_; \
+  if (Logger::get()->is_enabled(priority) && _site_.admit(priority)) { \
   char logbuf[HT_LOG_BUF_SIZE]; \
   int _priority_ = priority; \
   FixedOstream _out_(logbuf, sizeof(logbuf)); \
@@ -0,0 +1,132 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for ReaderEpoch.
+ * This file contains the declaration and inline definitions of ReaderEpoch,
+ * a class that lets readers access a shared object through an atomic
+ * pointer without locking, while a writer waits for them before freeing it.
+ */
+
+#ifndef HYPERTABLE_READEREPOCH_H
+#define HYPERTABLE_READEREPOCH_H
+
+#include "Common/Mutex.h"
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+
+namespace Hypertable {
+
+  /** @addtogroup Common
+   *  @{
+   */
+
+  /** Grace period tracking for lock-free readers (RCU-style).
+   * Readers wrap every access to an object published through a
+   * <code>std::atomic</code> pointer in a Section.  A writer that wants to
+   * free the object first replaces the pointer and then calls synchronize(),
+   * which returns once every section that could have loaded the old pointer
+   * has exited.
+   *
+   * Readers register with one of two counters selected by the current epoch.
+   * synchronize() flips the epoch and waits for the counter of the previous
+   * epoch to drain, so a continuous stream of new readers cannot hold off the
+   * writer.  Entering and leaving a section costs two atomic operations on a
+   * counter and never blocks.
+   */
+  class ReaderEpoch : boost::noncopyable {
+  public:
+
+    /// Read-side critical section
+    class Section : boost::noncopyable {
+    public:
+      /** Constructor; enters the section.
+       * Pointers published under <code>epoch</code> must be loaded after
+       * construction.
+       * @param epoch Epoch to register with
+       */
+      explicit Section(ReaderEpoch &epoch) : m_counter(epoch.enter()) { }
+
+      /// Destructor; leaves the section
+      ~Section() { m_counter->fetch_sub(1); }
+
+    private:
+      /// Counter this reader is registered with
+      std::atomic<uint32_t> *m_counter;
+    };
+
+    /// Constructor
+    ReaderEpoch() : m_epoch(0) {
+      m_readers[0] = 0;
+      m_readers[1] = 0;
+    }
+
+    /** Waits for readers that may still see a retired pointer.
+     * Must be called after the pointer has been replaced; on return the old
+     * object may be freed.
+     */
+    void synchronize() {
+      ScopedLock lock(m_mutex);
+      uint32_t previous = m_epoch.fetch_add(1) & 1;
+      while (m_readers[previous].load() != 0)
+        boost::this_thread::yield();
+    }
+
+  private:
+
+    /** Registers a reader with the current epoch.
+     * A reader that loads the epoch and is preempted before incrementing the
+     * counter could otherwise register with a counter that a later
+     * synchronize() no longer waits on.  The epoch is therefore re-read
+     * after the increment and, if it moved, the registration is undone and
+     * retried.  Once the re-read matches, any synchronize() that flips away
+     * from this epoch is guaranteed to see the increment.
+     * @return Counter to decrement when the reader leaves
+     */
+    std::atomic<uint32_t> *enter() {
+      while (true) {
+        uint32_t epoch = m_epoch.load();
+        std::atomic<uint32_t> *counter = &m_readers[epoch & 1];
+        counter->fetch_add(1);
+        if (m_epoch.load() == epoch)
+          return counter;
+        counter->fetch_sub(1);
+      }
+    }
+
+    /// %Mutex serializing writers
+    Mutex m_mutex;
+
+    /// Current epoch; its low bit selects the reader counter
+    std::atomic<uint32_t> m_epoch;
+
+    /// Number of readers registered in even and odd epochs
+    std::atomic<uint32_t> m_readers[2];
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_READEREPOCH_H
@@ -28,6 +28,8 @@
 #include "Serialization.h"
 #include "StatsSerializable.h"
 
+#include <limits>
+
 using namespace Hypertable;
 
 StatsSerializable::StatsSerializable(uint16_t _id, uint8_t _group_count)
@@ -69,6 +71,7 @@ void StatsSerializable::encode(uint8_t **bufp) const {
     lenp = *bufp;
     (*bufp) += 2;
     encode_group(group_ids[i], bufp);
+    HT_ASSERT(((*bufp) - lenp) - 2 <= std::numeric_limits<uint16_t>::max());
     len = ((*bufp) - lenp) - 2;
     Serialization::encode_i16(&lenp, len);
   }
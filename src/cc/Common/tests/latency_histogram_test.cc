@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Init.h"
+#include "Common/LatencyHistogram.h"
+#include "Common/Logger.h"
+
+#include <boost/thread/thread.hpp>
+
+using namespace Hypertable;
+
+namespace {
+
+  LatencyHistogram histogram;
+
+  void record_thread() {
+    for (uint64_t i=1; i<=10000; ++i)
+      histogram.record(i);
+  }
+
+}
+
+
+int main(int argc, char *argv[]) {
+  Config::init(argc, argv);
+
+  // Every value falls into a bucket whose bounds contain it
+  for (uint64_t v=0; v<(1ULL<<20); v = v < 100 ? v + 1 : v * 3 / 2) {
+    size_t index = LatencyHistogram::bucket(v);
+    HT_ASSERT(index < LatencyHistogram::BUCKETS);
+    HT_ASSERT(v <= LatencyHistogram::bucket_upper_bound(index));
+    HT_ASSERT(index == 0 ||
+              v > LatencyHistogram::bucket_upper_bound(index - 1));
+  }
+  HT_ASSERT(LatencyHistogram::bucket((uint64_t)-1) ==
+            LatencyHistogram::BUCKETS - 1);
+
+  // Concurrent recording of 1..10000 from four threads
+  boost::thread_group threads;
+  for (int i=0; i<4; ++i)
+    threads.create_thread(record_thread);
+  threads.join_all();
+
+  LatencyHistogram::Snapshot snapshot;
+  histogram.snapshot(snapshot);
+  HT_ASSERT(snapshot.count == 40000);
+  HT_ASSERT(snapshot.max == 10000);
+  HT_ASSERT(snapshot.sum == 4 * (10000ULL * 10001 / 2));
+
+  // Percentiles are within the bucket resolution (1/16)
+  uint64_t p50 = snapshot.percentile(0.5);
+  uint64_t p99 = snapshot.percentile(0.99);
+  HT_ASSERT(p50 >= 5000 && p50 <= 5000 + 5000/16);
+  HT_ASSERT(p99 >= 9900 && p99 <= 10000);
+  HT_ASSERT(snapshot.percentile(1.0) == 10000);
+
+  // Serialization round trip
+  size_t len = snapshot.encoded_length();
+  uint8_t *buf = new uint8_t [len];
+  uint8_t *ptr = buf;
+  snapshot.encode(&ptr);
+  HT_ASSERT((size_t)(ptr - buf) == len);
+
+  LatencyHistogram::Snapshot decoded;
+  const uint8_t *cptr = buf;
+  decoded.decode(&cptr, &len);
+  HT_ASSERT(len == 0);
+  HT_ASSERT(decoded == snapshot);
+  delete [] buf;
+
+  // Merge
+  decoded.merge(snapshot);
+  HT_ASSERT(decoded.count == 80000);
+  HT_ASSERT(decoded.percentile(0.5) == p50);
+
+  // Subtract leaves the samples recorded between two snapshots
+  for (uint64_t i=0; i<1000; ++i)
+    histogram.record(20);
+  LatencyHistogram::Snapshot interval;
+  histogram.snapshot(interval);
+  interval.subtract(snapshot);
+  HT_ASSERT(interval.count == 1000);
+  HT_ASSERT(interval.sum == 20000);
+  HT_ASSERT(interval.max == LatencyHistogram::bucket_upper_bound(
+                LatencyHistogram::bucket(20)));
+  HT_ASSERT(interval.percentile(0.99) == interval.max);
+
+  // Nothing recorded since the earlier snapshot
+  LatencyHistogram::Snapshot unchanged;
+  histogram.snapshot(unchanged);
+  LatencyHistogram::Snapshot earlier = unchanged;
+  unchanged.subtract(earlier);
+  HT_ASSERT(unchanged.count == 0 && unchanged.sum == 0 && unchanged.max == 0);
+
+  // Earlier snapshot with more samples (reset) leaves snapshot unchanged
+  LatencyHistogram::Snapshot reset = snapshot;
+  reset.subtract(decoded);
+  HT_ASSERT(reset == snapshot);
+
+  return 0;
+}
@@ -22,8 +22,15 @@
 #include "Common/Compat.h"
 #include "Common/Logger.h"
 #include "Common/Init.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <sstream>
+#include <vector>
 #include <stdio.h>
+#include <unistd.h>
 #include <signal.h>
 #include <setjmp.h>
 
@@ -114,11 +121,149 @@ void test_big_message() {
   HT_WARN_OUT << buf << HT_END;
 }
 
+/// Captures stdout through a pipe
+class OutputCapture {
+public:
+  OutputCapture() : m_reader(0) {
+    int fds[2];
+    fflush(stdout);
+    HT_ASSERT(pipe(fds) == 0);
+    m_read_fd = fds[0];
+    m_saved_fd = dup(1);
+    HT_ASSERT(dup2(fds[1], 1) == 1);
+    close(fds[1]);
+  }
+
+  /// Starts draining the pipe; until then writes to stdout block once
+  /// the pipe is full
+  void start_reading() {
+    m_reader = new boost::thread(boost::bind(&OutputCapture::read, this));
+  }
+
+  /// Restores stdout and returns the captured lines
+  std::vector<String> finish() {
+    fflush(stdout);
+    dup2(m_saved_fd, 1);
+    close(m_saved_fd);
+    if (m_reader == 0)
+      start_reading();
+    m_reader->join();
+    delete m_reader;
+    close(m_read_fd);
+    std::vector<String> lines;
+    boost::split(lines, m_output, boost::is_any_of("\n"));
+    return lines;
+  }
+
+private:
+  void read() {
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(m_read_fd, buf, sizeof(buf))) > 0)
+      m_output.append(buf, n);
+  }
+
+  int m_read_fd;
+  int m_saved_fd;
+  boost::thread *m_reader;
+  String m_output;
+};
+
+/// Returns the number following <code>tag</code> in <code>line</code>, or -1
+int parse_tag(const String &line, const char *tag) {
+  size_t pos = line.find(tag);
+  if (pos == String::npos)
+    return -1;
+  return atoi(line.c_str() + pos + strlen(tag));
+}
+
+/// Returns the index of the first line containing <code>text</code>
+size_t find_line(const std::vector<String> &lines, const char *text) {
+  for (size_t i = 0; i < lines.size(); ++i)
+    if (lines[i].find(text) != String::npos)
+      return i;
+  return lines.size();
+}
+
+void test_async_logging() {
+  const int QUEUED = 1000;
+  const int RATE_LIMITED = 100;
+  String padding(200, 'x');
+  OutputCapture capture;
+
+  // Small rings with nobody reading the pipe: the writer blocks on a full
+  // pipe and most messages are dropped
+  Logger::get()->set_async(8, true);
+  HT_ASSERT(Logger::get()->is_async());
+  for (int i = 0; i < QUEUED; ++i)
+    HT_INFOF("queued=%d %s", i, padding.c_str());
+  capture.start_reading();
+
+  // Written after everything queued before it; big messages bypass the ring
+  HT_ERROR("error-marker");
+  test_big_message();
+
+  // Back to synchronous mode and into asynchronous mode without dropping
+  Logger::get()->set_sync();
+  HT_ASSERT(!Logger::get()->is_async());
+  Logger::get()->set_async(1024, false);
+  Logger::get()->set_rate_limit(5);
+  for (int i = 0; i < RATE_LIMITED; ++i)
+    HT_INFOF("limited=%d", i);
+  Logger::get()->set_rate_limit(0);
+  HT_NOTICE("notice-marker");
+  Logger::get()->set_sync();
+
+  std::vector<String> lines = capture.finish();
+
+  int written = 0, dropped = 0, limited = 0, suppressed = 0;
+  int last_queued = -1, last_limited = -1;
+  size_t last_queued_line = 0;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    int n;
+    if ((n = parse_tag(lines[i], "queued=")) >= 0) {
+      HT_ASSERT(n > last_queued);
+      last_queued = n;
+      last_queued_line = i;
+      written++;
+    }
+    else if ((n = parse_tag(lines[i], "limited=")) >= 0) {
+      HT_ASSERT(n > last_limited);
+      last_limited = n;
+      limited++;
+    }
+    else if ((n = parse_tag(lines[i], "Log buffer full, dropped ")) >= 0)
+      dropped += n;
+    else if ((n = parse_tag(lines[i], "Rate limit suppressed ")) >= 0)
+      suppressed += n;
+  }
+
+  // every message is either written or counted as dropped
+  HT_ASSERT(dropped > 0);
+  HT_ASSERT(written + dropped == QUEUED);
+
+  // every rate limited message is either written or counted as suppressed
+  HT_ASSERT(limited >= 5);
+  HT_ASSERT(limited + suppressed == RATE_LIMITED);
+
+  // ordering across the synchronous writes
+  size_t error_line = find_line(lines, "error-marker");
+  size_t notice_line = find_line(lines, "notice-marker");
+  size_t big_line = find_line(lines, "0123456789");
+  size_t first_limited = find_line(lines, "limited=");
+  HT_ASSERT(last_queued_line < error_line);
+  HT_ASSERT(error_line < big_line);
+  HT_ASSERT(big_line < first_limited);
+  HT_ASSERT(notice_line < lines.size());
+  HT_ASSERT(first_limited < notice_line);
+}
+
 } // local namespace
 
 int main(int ac, char *av[]) {
   Config::init(ac, av);
   test_basic_logging(av[0]);
   test_big_message();
+  test_async_logging();
   return 0;
 }
@@ -0,0 +1,158 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Stress test for ReaderEpoch.
+ * Reader threads repeatedly load an object through an atomic pointer inside
+ * a ReaderEpoch::Section while a writer purges it (two purges back to back,
+ * each followed by a synchronize()) and reloads it.  Retired objects are
+ * poisoned instead of freed so that a reader that still sees one after the
+ * grace period is detected without relying on a memory checker.  To make
+ * readers stall at arbitrary points (including between loading the epoch and
+ * registering with it) even on a single CPU, an interrupter thread keeps
+ * signalling them with a handler that yields the processor.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/ReaderEpoch.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+extern "C" {
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+}
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const uint32_t LIVE = 0x4c495645;
+  const uint32_t DEAD = 0xdeadbeef;
+
+  struct Filter {
+    Filter() : magic(LIVE) { }
+    volatile uint32_t magic;
+  };
+
+  ReaderEpoch g_readers;
+  std::atomic<Filter *> g_filter;
+  std::atomic<bool> g_done;
+  std::atomic<uint64_t> g_errors;
+  std::atomic<uint64_t> g_probes;
+
+  extern "C" void stall_handler(int) {
+    sched_yield();
+  }
+
+  void reader() {
+    while (!g_done.load()) {
+      ReaderEpoch::Section section(g_readers);
+      Filter *filter = g_filter.load();
+      if (filter == 0)
+        continue;
+      for (int i=0; i<64; i++) {
+        if (filter->magic != LIVE) {
+          g_errors.fetch_add(1);
+          break;
+        }
+      }
+      g_probes.fetch_add(1);
+    }
+  }
+
+  void interrupter(vector<pthread_t> *reader_threads) {
+    size_t i = 0;
+    while (!g_done.load()) {
+      pthread_kill((*reader_threads)[i++ % reader_threads->size()], SIGUSR1);
+      sched_yield();
+    }
+  }
+
+  /// Unpublishes the current filter and retires it after a grace period
+  void purge(vector<Filter *> &retired) {
+    Filter *old_filter = g_filter.exchange(0);
+    g_readers.synchronize();
+    if (old_filter) {
+      old_filter->magic = DEAD;
+      retired.push_back(old_filter);
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  int thread_count = 4;
+  time_t deadline = time(0) + 5;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stall_handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR1, &sa, 0);
+
+  g_filter = new Filter();
+  g_done = false;
+  g_errors = 0;
+  g_probes = 0;
+
+  boost::thread_group threads;
+  vector<pthread_t> reader_threads;
+  for (int i=0; i<thread_count; i++)
+    reader_threads.push_back(threads.create_thread(reader)->native_handle());
+  boost::thread stall_thread(boost::bind(interrupter, &reader_threads));
+
+  vector<Filter *> retired;
+  while (g_errors.load() == 0) {
+    purge(retired);
+    g_filter = new Filter();
+    // Second purge right behind the reload, flipping the epoch again
+    purge(retired);
+    g_filter = new Filter();
+    if (time(0) > deadline)
+      break;
+  }
+
+  g_done = true;
+  stall_thread.join();
+  threads.join_all();
+
+  purge(retired);
+  for (size_t i=0; i<retired.size(); i++)
+    delete retired[i];
+
+  if (g_errors.load() != 0) {
+    HT_ERRORF("Readers probed a retired filter %llu times (%llu probes)",
+              (Llu)g_errors.load(), (Llu)g_probes.load());
+    return 1;
+  }
+
+  return 0;
+}
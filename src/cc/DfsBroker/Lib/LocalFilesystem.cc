@@ -0,0 +1,378 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for LocalFilesystem.
+ * This file contains definitions for LocalFilesystem, a Filesystem that
+ * serves reads of files managed by a local DFS broker in-process through
+ * memory mapped files.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "LocalFilesystem.h"
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hypertable::DfsBroker;
+
+namespace {
+
+  /// Throws the DfsBroker error corresponding to errno
+  void throw_errno(const String &what) {
+    int error;
+    if (errno == ENOTDIR || errno == ENAMETOOLONG || errno == ENOENT)
+      error = Error::DFSBROKER_BAD_FILENAME;
+    else if (errno == EACCES || errno == EPERM)
+      error = Error::DFSBROKER_PERMISSION_DENIED;
+    else if (errno == EBADF)
+      error = Error::DFSBROKER_BAD_FILE_HANDLE;
+    else if (errno == EINVAL)
+      error = Error::DFSBROKER_INVALID_ARGUMENT;
+    else
+      error = Error::DFSBROKER_IO_ERROR;
+    HT_THROWF(error, "%s - %s", what.c_str(), strerror(errno));
+  }
+
+}
+
+
+LocalFilesystem::MappedFile::~MappedFile() {
+  if (base)
+    ::munmap(base, size);
+  if (fd >= 0)
+    ::close(fd);
+}
+
+
+LocalFilesystem::LocalFilesystem(FilesystemPtr &broker, const String &rootdir)
+  : m_broker(broker), m_rootdir(rootdir), m_next_fd(LOCAL_FD_BASE) {
+  HT_INFOF("Reading files under %s in-process", m_rootdir.c_str());
+}
+
+LocalFilesystem::~LocalFilesystem() {
+}
+
+
+bool LocalFilesystem::shares_root(FilesystemPtr &broker,
+                                  const String &rootdir) {
+  String name = format("/.in_process_reads_probe.%d", (int)getpid());
+  struct stat statbuf;
+  bool found;
+
+  try {
+    int32_t fd = broker->create(name, Filesystem::OPEN_FLAG_OVERWRITE,
+                                -1, -1, -1);
+    broker->close(fd);
+  }
+  catch (Exception &e) {
+    HT_WARNF("Unable to create %s through DFS broker - %s", name.c_str(),
+             e.what());
+    return false;
+  }
+
+  found = stat((rootdir + name).c_str(), &statbuf) == 0;
+
+  try {
+    broker->remove(name);
+  }
+  catch (Exception &e) {
+    HT_WARNF("Unable to remove %s through DFS broker - %s", name.c_str(),
+             e.what());
+  }
+  return found;
+}
+
+
+int LocalFilesystem::open_local(const String &name, bool sequential) {
+  MappedFilePtr file = new MappedFile();
+  String abspath = format("%s%s%s", m_rootdir.c_str(),
+                          name[0] == '/' ? "" : "/", name.c_str());
+  struct stat statbuf;
+
+  if ((file->fd = ::open(abspath.c_str(), O_RDONLY)) == -1)
+    throw_errno(format("open('%s')", abspath.c_str()));
+
+  if (fstat(file->fd, &statbuf) == -1)
+    throw_errno(format("fstat('%s')", abspath.c_str()));
+
+  file->end = statbuf.st_size;
+
+  if (statbuf.st_size > 0) {
+    void *base = ::mmap(0, statbuf.st_size, PROT_READ, MAP_SHARED, file->fd, 0);
+    if (base == MAP_FAILED)
+      HT_WARNF("mmap('%s') failed, reading with pread - %s", abspath.c_str(),
+               strerror(errno));
+    else {
+      file->base = (uint8_t *)base;
+      file->size = statbuf.st_size;
+      ::madvise(base, file->size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+  }
+
+  ScopedLock lock(m_mutex);
+  int32_t fd = m_next_fd++;
+  m_files[fd] = file;
+  return fd;
+}
+
+size_t LocalFilesystem::copy_out(MappedFile *file, void *dst, size_t len,
+                                 uint64_t offset) {
+  if (offset + len <= file->size) {
+    memcpy(dst, file->base + offset, len);
+    return len;
+  }
+  // past the end of the mapping
+  size_t nread = 0;
+  while (nread < len) {
+    ssize_t n = ::pread(file->fd, (uint8_t *)dst + nread, len - nread,
+                        offset + nread);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      throw_errno(format("pread(fd=%d, len=%llu, offset=%llu)", file->fd,
+                         (Llu)len, (Llu)offset));
+    }
+    if (n == 0)
+      break;
+    nread += n;
+  }
+  return nread;
+}
+
+LocalFilesystem::MappedFilePtr LocalFilesystem::get_file(int32_t fd) {
+  ScopedLock lock(m_mutex);
+  std::unordered_map<int32_t, MappedFilePtr>::iterator iter = m_files.find(fd);
+  if (iter == m_files.end())
+    HT_THROWF(Error::DFSBROKER_BAD_FILE_HANDLE, "Bad file handle %d", (int)fd);
+  return iter->second;
+}
+
+void LocalFilesystem::check_async(int32_t fd, const char *method) {
+  if (fd >= LOCAL_FD_BASE)
+    HT_THROWF(Error::NOT_IMPLEMENTED, "Asynchronous %s on in-process file "
+              "handle %d", method, (int)fd);
+}
+
+
+void LocalFilesystem::open(const String &name, uint32_t flags,
+                           DispatchHandler *handler) {
+  m_broker->open(name, flags, handler);
+}
+
+int LocalFilesystem::open(const String &name, uint32_t flags) {
+  return open_local(name, false);
+}
+
+int LocalFilesystem::open_buffered(const String &name, uint32_t flags,
+        uint32_t buf_size, uint32_t outstanding, uint64_t start_offset,
+        uint64_t end_offset) {
+  int32_t fd = open_local(name, true);
+  MappedFilePtr file = get_file(fd);
+  file->position = start_offset;
+  if (end_offset && end_offset < file->end)
+    file->end = end_offset;
+  return fd;
+}
+
+void LocalFilesystem::create(const String &name, uint32_t flags,
+        int32_t bufsz, int32_t replication, int64_t blksz,
+        DispatchHandler *handler) {
+  m_broker->create(name, flags, bufsz, replication, blksz, handler);
+}
+
+int LocalFilesystem::create(const String &name, uint32_t flags,
+        int32_t bufsz, int32_t replication, int64_t blksz) {
+  return m_broker->create(name, flags, bufsz, replication, blksz);
+}
+
+void LocalFilesystem::close(int32_t fd, DispatchHandler *handler) {
+  check_async(fd, "close");
+  m_broker->close(fd, handler);
+}
+
+void LocalFilesystem::close(int32_t fd) {
+  if (fd < LOCAL_FD_BASE) {
+    m_broker->close(fd);
+    return;
+  }
+  ScopedLock lock(m_mutex);
+  if (m_files.erase(fd) == 0)
+    HT_THROWF(Error::DFSBROKER_BAD_FILE_HANDLE, "Bad file handle %d", (int)fd);
+}
+
+void LocalFilesystem::read(int32_t fd, size_t amount,
+                           DispatchHandler *handler) {
+  check_async(fd, "read");
+  m_broker->read(fd, amount, handler);
+}
+
+size_t LocalFilesystem::read(int32_t fd, void *dst, size_t amount) {
+  if (fd < LOCAL_FD_BASE)
+    return m_broker->read(fd, dst, amount);
+  MappedFilePtr file = get_file(fd);
+  if (file->position >= file->end)
+    return 0;
+  if (amount > file->end - file->position)
+    amount = file->end - file->position;
+  size_t nread = copy_out(file.get(), dst, amount, file->position);
+  file->position += nread;
+  return nread;
+}
+
+void LocalFilesystem::append(int32_t fd, StaticBuffer &buffer,
+        uint32_t flags, DispatchHandler *handler) {
+  check_async(fd, "append");
+  m_broker->append(fd, buffer, flags, handler);
+}
+
+size_t LocalFilesystem::append(int32_t fd, StaticBuffer &buffer,
+                               uint32_t flags) {
+  if (fd >= LOCAL_FD_BASE)
+    HT_THROWF(Error::DFSBROKER_BAD_FILE_HANDLE, "File handle %d is open "
+              "for reading", (int)fd);
+  return m_broker->append(fd, buffer, flags);
+}
+
+void LocalFilesystem::seek(int32_t fd, uint64_t offset,
+                           DispatchHandler *handler) {
+  check_async(fd, "seek");
+  m_broker->seek(fd, offset, handler);
+}
+
+void LocalFilesystem::seek(int32_t fd, uint64_t offset) {
+  if (fd < LOCAL_FD_BASE) {
+    m_broker->seek(fd, offset);
+    return;
+  }
+  get_file(fd)->position = offset;
+}
+
+void LocalFilesystem::remove(const String &name, DispatchHandler *handler) {
+  m_broker->remove(name, handler);
+}
+
+void LocalFilesystem::remove(const String &name, bool force) {
+  m_broker->remove(name, force);
+}
+
+void LocalFilesystem::length(const String &name, bool accurate,
+                             DispatchHandler *handler) {
+  m_broker->length(name, accurate, handler);
+}
+
+int64_t LocalFilesystem::length(const String &name, bool accurate) {
+  return m_broker->length(name, accurate);
+}
+
+void LocalFilesystem::pread(int32_t fd, size_t len, uint64_t offset,
+                            DispatchHandler *handler) {
+  check_async(fd, "pread");
+  m_broker->pread(fd, len, offset, handler);
+}
+
+size_t LocalFilesystem::pread(int32_t fd, void *dst, size_t len,
+                              uint64_t offset, bool verify_checksum) {
+  if (fd < LOCAL_FD_BASE)
+    return m_broker->pread(fd, dst, len, offset, verify_checksum);
+  // the local broker doesn't checksum either
+  return copy_out(get_file(fd).get(), dst, len, offset);
+}
+
+void LocalFilesystem::mkdirs(const String &name, DispatchHandler *handler) {
+  m_broker->mkdirs(name, handler);
+}
+
+void LocalFilesystem::mkdirs(const String &name) {
+  m_broker->mkdirs(name);
+}
+
+void LocalFilesystem::flush(int32_t fd, DispatchHandler *handler) {
+  check_async(fd, "flush");
+  m_broker->flush(fd, handler);
+}
+
+void LocalFilesystem::flush(int32_t fd) {
+  if (fd >= LOCAL_FD_BASE)
+    return;
+  m_broker->flush(fd);
+}
+
+void LocalFilesystem::rmdir(const String &name, DispatchHandler *handler) {
+  m_broker->rmdir(name, handler);
+}
+
+void LocalFilesystem::rmdir(const String &name, bool force) {
+  m_broker->rmdir(name, force);
+}
+
+void LocalFilesystem::readdir(const String &name, DispatchHandler *handler) {
+  m_broker->readdir(name, handler);
+}
+
+void LocalFilesystem::readdir(const String &name,
+                              std::vector<Dirent> &listing) {
+  m_broker->readdir(name, listing);
+}
+
+void LocalFilesystem::posix_readdir(const String &name,
+        std::vector<Filesystem::DirectoryEntry> &listing) {
+  m_broker->posix_readdir(name, listing);
+}
+
+void LocalFilesystem::exists(const String &name, DispatchHandler *handler) {
+  m_broker->exists(name, handler);
+}
+
+bool LocalFilesystem::exists(const String &name) {
+  return m_broker->exists(name);
+}
+
+void LocalFilesystem::rename(const String &src, const String &dst,
+                             DispatchHandler *handler) {
+  m_broker->rename(src, dst, handler);
+}
+
+void LocalFilesystem::rename(const String &src, const String &dst) {
+  m_broker->rename(src, dst);
+}
+
+void LocalFilesystem::debug(int32_t command,
+                            StaticBuffer &serialized_parameters) {
+  m_broker->debug(command, serialized_parameters);
+}
+
+void LocalFilesystem::debug(int32_t command,
+        StaticBuffer &serialized_parameters, DispatchHandler *handler) {
+  m_broker->debug(command, serialized_parameters, handler);
+}
@@ -0,0 +1,215 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for LocalFilesystem.
+ * This file contains declarations for LocalFilesystem, a Filesystem that
+ * serves reads of files managed by a local DFS broker in-process through
+ * memory mapped files.
+ */
+
+#ifndef HYPERTABLE_DFSBROKER_LOCALFILESYSTEM_H
+#define HYPERTABLE_DFSBROKER_LOCALFILESYSTEM_H
+
+#include <Common/Filesystem.h>
+#include <Common/Mutex.h>
+#include <Common/ReferenceCount.h>
+
+#include <unordered_map>
+
+namespace Hypertable { namespace DfsBroker {
+
+    /** Filesystem that reads files of a local broker directly.
+     * Files opened for reading with the synchronous open() and
+     * open_buffered() calls are opened in-process under the broker's root
+     * directory and memory mapped, so read() and pread() are served from the
+     * page cache with a single copy, without a round trip to the broker and
+     * without the broker's direct i/o alignment copies.  Files that are read
+     * are immutable in Hypertable (cell stores, closed commit log fragments
+     * and hints files), so a mapping taken at open time stays valid; reads
+     * past its end fall back to pread(2).
+     *
+     * Everything else, including all writes, directory operations and all
+     * asynchronous calls, is forwarded to the broker, which therefore remains
+     * the only writer.  Asynchronous calls on a file opened in-process are
+     * not supported and throw Error::NOT_IMPLEMENTED.
+     *
+     * Only usable when the broker runs on the same host and shares its root
+     * directory with the process.
+     */
+    class LocalFilesystem : public Filesystem {
+    public:
+
+      /** Constructor.
+       * @param broker Filesystem that calls are forwarded to
+       * @param rootdir Root directory of the local broker
+       */
+      LocalFilesystem(FilesystemPtr &broker, const String &rootdir);
+
+      virtual ~LocalFilesystem();
+
+      virtual void open(const String &name, uint32_t flags, DispatchHandler *handler);
+      virtual int open(const String &name, uint32_t flags);
+      virtual int open_buffered(const String &name, uint32_t flags, uint32_t buf_size,
+                                uint32_t outstanding, uint64_t start_offset=0,
+                                uint64_t end_offset=0);
+
+      virtual void create(const String &name, uint32_t flags,
+                          int32_t bufsz, int32_t replication,
+                          int64_t blksz, DispatchHandler *handler);
+      virtual int create(const String &name, uint32_t flags, int32_t bufsz,
+                         int32_t replication, int64_t blksz);
+
+      virtual void close(int32_t fd, DispatchHandler *handler);
+      virtual void close(int32_t fd);
+
+      virtual void read(int32_t fd, size_t amount, DispatchHandler *handler);
+      virtual size_t read(int32_t fd, void *dst, size_t amount);
+
+      virtual void append(int32_t fd, StaticBuffer &buffer, uint32_t flags,
+                          DispatchHandler *handler);
+      virtual size_t append(int32_t fd, StaticBuffer &buffer,
+                            uint32_t flags = 0);
+
+      virtual void seek(int32_t fd, uint64_t offset, DispatchHandler *handler);
+      virtual void seek(int32_t fd, uint64_t offset);
+
+      virtual void remove(const String &name, DispatchHandler *handler);
+      virtual void remove(const String &name, bool force = true);
+
+      virtual void length(const String &name, bool accurate,
+                          DispatchHandler *handler);
+      virtual int64_t length(const String &name, bool accurate = true);
+
+      virtual void pread(int32_t fd, size_t len, uint64_t offset,
+                         DispatchHandler *handler);
+      virtual size_t pread(int32_t fd, void *dst, size_t len, uint64_t offset,
+                           bool verify_checksum);
+
+      virtual void mkdirs(const String &name, DispatchHandler *handler);
+      virtual void mkdirs(const String &name);
+
+      virtual void flush(int32_t fd, DispatchHandler *handler);
+      virtual void flush(int32_t fd);
+
+      virtual void rmdir(const String &name, DispatchHandler *handler);
+      virtual void rmdir(const String &name, bool force = true);
+
+      virtual void readdir(const String &name, DispatchHandler *handler);
+      virtual void readdir(const String &name, std::vector<Dirent> &listing);
+
+      virtual void posix_readdir(const String &name,
+              std::vector<Filesystem::DirectoryEntry> &listing);
+
+      virtual void exists(const String &name, DispatchHandler *handler);
+      virtual bool exists(const String &name);
+
+      virtual void rename(const String &src, const String &dst,
+                          DispatchHandler *handler);
+      virtual void rename(const String &src, const String &dst);
+
+      virtual void debug(int32_t command, StaticBuffer &serialized_parameters);
+      virtual void debug(int32_t command, StaticBuffer &serialized_parameters,
+                         DispatchHandler *handler);
+
+      /** Checks that a broker keeps its files under a local directory.
+       * Creates a probe file through <code>broker</code>, checks that it
+       * shows up under <code>rootdir</code> and removes it again.  This
+       * fails for brokers of other filesystems and for local brokers with
+       * a different root directory.
+       * @param broker Broker to check
+       * @param rootdir Root directory the broker is expected to use
+       * @return <i>true</i> if files of <code>broker</code> are found under
+       *         <code>rootdir</code>, <i>false</i> otherwise
+       */
+      static bool shares_root(FilesystemPtr &broker, const String &rootdir);
+
+      /// File descriptors of in-process files start here; the broker's
+      /// descriptors are allocated from 1 upwards and never get this high
+      static const int32_t LOCAL_FD_BASE = 0x40000000;
+
+    private:
+
+      /** File opened in-process.
+       */
+      class MappedFile : public ReferenceCount {
+      public:
+        MappedFile() : fd(-1), base(0), size(0), position(0), end(0) { }
+        ~MappedFile();
+        /// File descriptor of the open file
+        int fd;
+        /// Start of the mapping, 0 if the file is empty or can't be mapped
+        uint8_t *base;
+        /// Length of the mapping
+        uint64_t size;
+        /// Offset of next read()
+        uint64_t position;
+        /// Offset at which read() stops
+        uint64_t end;
+      };
+      typedef intrusive_ptr<MappedFile> MappedFilePtr;
+
+      /** Opens and maps a file.
+       * @param name Path of file relative to the broker root
+       * @param sequential true if the file will be read sequentially
+       * @return File descriptor
+       */
+      int open_local(const String &name, bool sequential);
+
+      /** Copies from a file.
+       * @param file File to read from
+       * @param dst Destination buffer
+       * @param len Number of bytes to read
+       * @param offset File offset to read from
+       * @return Number of bytes read, less than <code>len</code> at the end
+       *         of the file
+       */
+      size_t copy_out(MappedFile *file, void *dst, size_t len, uint64_t offset);
+
+      /** Returns in-process file of a descriptor.
+       * @param fd File descriptor, must be at least LOCAL_FD_BASE
+       * @return File
+       */
+      MappedFilePtr get_file(int32_t fd);
+
+      /// Checks that an asynchronous call is not made on an in-process file
+      void check_async(int32_t fd, const char *method);
+
+      /// Lock for #m_files and #m_next_fd
+      Mutex m_mutex;
+
+      /// Filesystem calls are forwarded to
+      FilesystemPtr m_broker;
+
+      /// Root directory of the broker
+      String m_rootdir;
+
+      /// In-process files by file descriptor
+      std::unordered_map<int32_t, MappedFilePtr> m_files;
+
+      /// Next in-process file descriptor
+      int32_t m_next_fd;
+    };
+
+}}
+
+#endif // HYPERTABLE_DFSBROKER_LOCALFILESYSTEM_H
@@ -0,0 +1,170 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * LocalFilesystem test.
+ * Checks in-process reads of LocalFilesystem: pread() from the mapping,
+ * reads past the end of the mapping of a file that grew after it was
+ * opened, sequential read() within the offsets of open_buffered(), seek(),
+ * empty files and bad file handles.  No broker is needed since only
+ * in-process files are used.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/FileUtils.h"
+#include "Common/Init.h"
+#include "Common/Logger.h"
+
+#include "DfsBroker/Lib/LocalFilesystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+extern "C" {
+#include <stdlib.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hypertable::DfsBroker;
+
+namespace {
+
+  const size_t FILE_SIZE = 100000;
+
+  /// Byte at <code>offset</code> of the test files
+  uint8_t byte_at(uint64_t offset) {
+    return (uint8_t)((offset * 31) ^ (offset >> 8));
+  }
+
+  void write_file(const String &path, uint64_t start, size_t len,
+                  bool append) {
+    std::vector<uint8_t> buf(len + 1);
+    for (size_t i=0; i<len; i++)
+      buf[i] = byte_at(start + i);
+    FILE *fp = fopen(path.c_str(), append ? "a" : "w");
+    HT_ASSERT(fp);
+    HT_ASSERT(fwrite(&buf[0], 1, len, fp) == len);
+    fclose(fp);
+  }
+
+  void check_bytes(const uint8_t *buf, uint64_t offset, size_t len) {
+    for (size_t i=0; i<len; i++)
+      HT_ASSERT(buf[i] == byte_at(offset + i));
+  }
+
+  void check_bad_handle(LocalFilesystem &fs, int32_t fd) {
+    uint8_t buf[16];
+    try {
+      fs.pread(fd, buf, sizeof(buf), 0, false);
+    }
+    catch (Exception &e) {
+      HT_ASSERT(e.code() == Error::DFSBROKER_BAD_FILE_HANDLE);
+      return;
+    }
+    HT_ASSERT(!"pread() of bad file handle succeeded");
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  Config::init(argc, argv);
+
+  char tmpl[] = "/tmp/local_filesystem_test.XXXXXX";
+  HT_ASSERT(mkdtemp(tmpl));
+  String rootdir = tmpl;
+
+  write_file(rootdir + "/data", 0, FILE_SIZE, false);
+  write_file(rootdir + "/empty", 0, 0, false);
+
+  FilesystemPtr broker;
+  LocalFilesystem fs(broker, rootdir);
+  std::vector<uint8_t> buf(FILE_SIZE + 1000);
+
+  // pread() from the mapping, at the start, unaligned and at the end
+  int32_t fd = fs.open("/data", 0);
+  HT_ASSERT(fd >= LocalFilesystem::LOCAL_FD_BASE);
+  uint64_t offsets[] = { 0, 1, 4095, 4096, 65537, FILE_SIZE - 10 };
+  for (size_t i=0; i<sizeof(offsets)/sizeof(uint64_t); i++) {
+    size_t len = std::min((uint64_t)10, FILE_SIZE - offsets[i]);
+    HT_ASSERT(fs.pread(fd, &buf[0], len, offsets[i], false) == len);
+    check_bytes(&buf[0], offsets[i], len);
+  }
+  HT_ASSERT(fs.pread(fd, &buf[0], FILE_SIZE, 0, false) == FILE_SIZE);
+  check_bytes(&buf[0], 0, FILE_SIZE);
+
+  // a read that goes past the end of the file is short
+  HT_ASSERT(fs.pread(fd, &buf[0], 100, FILE_SIZE - 40, false) == 40);
+  check_bytes(&buf[0], FILE_SIZE - 40, 40);
+  HT_ASSERT(fs.pread(fd, &buf[0], 100, FILE_SIZE + 100, false) == 0);
+
+  // bytes appended after open() are beyond the mapping and read with pread(2)
+  write_file(rootdir + "/data", FILE_SIZE, 1000, true);
+  HT_ASSERT(fs.pread(fd, &buf[0], 1000, FILE_SIZE - 500, false) == 1000);
+  check_bytes(&buf[0], FILE_SIZE - 500, 1000);
+  HT_ASSERT(fs.pread(fd, &buf[0], 1000, FILE_SIZE + 500, false) == 500);
+  check_bytes(&buf[0], FILE_SIZE + 500, 500);
+
+  // read() and seek() move the file position
+  HT_ASSERT(fs.read(fd, &buf[0], 100) == 100);
+  check_bytes(&buf[0], 0, 100);
+  fs.seek(fd, 5000);
+  HT_ASSERT(fs.read(fd, &buf[0], 100) == 100);
+  check_bytes(&buf[0], 5000, 100);
+  fs.close(fd);
+  check_bad_handle(fs, fd);
+
+  // open_buffered() reads sequentially between the start and end offsets
+  fd = fs.open_buffered("/data", 0, 65536, 2, 1000, 30000);
+  uint64_t position = 1000;
+  size_t nread;
+  while ((nread = fs.read(fd, &buf[0], 7000)) > 0) {
+    check_bytes(&buf[0], position, nread);
+    position += nread;
+  }
+  HT_ASSERT(position == 30000);
+  fs.close(fd);
+
+  // empty files aren't mapped, reads return nothing
+  fd = fs.open("/empty", 0);
+  HT_ASSERT(fs.read(fd, &buf[0], 100) == 0);
+  HT_ASSERT(fs.pread(fd, &buf[0], 100, 0, false) == 0);
+  fs.close(fd);
+
+  // missing files and unknown handles
+  try {
+    fs.open("/missing", 0);
+    HT_ASSERT(!"open() of missing file succeeded");
+  }
+  catch (Exception &e) {
+    HT_ASSERT(e.code() == Error::DFSBROKER_BAD_FILENAME);
+  }
+  check_bad_handle(fs, LocalFilesystem::LOCAL_FD_BASE + 1000);
+
+  FileUtils::unlink(rootdir + "/data");
+  FileUtils::unlink(rootdir + "/empty");
+  rmdir(rootdir.c_str());
+
+  return 0;
+}
@@ -35,6 +35,7 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <cctype>
 #include <cstdlib>
@@ -60,10 +61,11 @@ using namespace StateDbKeys;
   if (_l_) _out_ <<"' value='"<< format_bytes(20, _v_, _l_); \
   _out_ <<"'"<< HT_END
 
-void close_db_cursor(Dbc **cursor) {
+void close_db_cursor(StoreCursor **cursor) {
   if (*cursor != 0) {
-    (*cursor)->close();
+    boost::scoped_ptr<StoreCursor> cursorp(*cursor);
     *cursor = 0;
+    cursorp->close();
   }
 }
 
@@ -76,13 +78,23 @@ BerkeleyDbFilesystem::BerkeleyDbFilesystem(PropertiesPtr &props,
                                            const std::string &basedir,
                                            const std::vector<Thread::id> &thread_ids,
                                            bool force_recover)
-    : m_base_dir(basedir), m_env(0) {
+    : m_base_dir(basedir), m_env(0), m_wal_next_seq(0) {
 
   m_checkpoint_size_kb = props->get_i32("Hyperspace.Checkpoint.Size") / 1000;
   m_log_gc_interval = props->get_i32("Hyperspace.LogGc.Interval");
   m_max_unused_logs = props->get_i32("Hyperspace.LogGc.MaxUnusedLogs");
   boost::xtime_get(&m_last_log_gc_time, boost::TIME_UTC_);
 
+  String store = props->get_str("Hyperspace.Store");
+  if (store == "wal") {
+    init_wal_store(props);
+    HT_DEBUG_OUT <<"namespace initialized"<< HT_END;
+    return;
+  }
+  else if (store != "bdb")
+    HT_FATALF("Invalid value for Hyperspace.Store: '%s' (must be 'bdb' or "
+              "'wal')", store.c_str());
+
   u_int32_t env_flags =
     DB_CREATE |      // If the environment does not exist, create it
     DB_INIT_LOCK  |  // Initialize locking
@@ -102,10 +114,6 @@ BerkeleyDbFilesystem::BerkeleyDbFilesystem(PropertiesPtr &props,
    * Open Berkeley DB environment and namespace database
    */
   try {
-    int ret;
-    Dbt key, data;
-    DbtManaged keym, datam;
-    char numbuf[17];
     String localhost = System::net_info().host_name;
     String localip = System::net_info().primary_addr;
     HT_INFOF("localhost=%s localip=%s", localhost.c_str(), localip.c_str());
@@ -264,65 +272,12 @@ BerkeleyDbFilesystem::BerkeleyDbFilesystem(PropertiesPtr &props,
           throw;
       }
 
-      key.set_data((void *)"/");
-      key.set_size(2);
-
-      data.set_flags(DB_DBT_REALLOC);
-      if ((ret = handle_namespace_db->get(NULL, &key, &data, 0)) == DB_NOTFOUND) {
-        data.set_data(0);
-        data.set_size(0);
-        ret = handle_namespace_db->put(NULL, &key, &data, 0);
-        key.set_data((void *)"/hyperspace/");
-        key.set_size(strlen("/hyperspace/")+1);
-        ret = handle_namespace_db->put(NULL, &key, &data, 0);
-        key.set_data((void *)"/hyperspace/metadata");
-        key.set_size(strlen("/hyperspace/metadata")+1);
-        ret = handle_namespace_db->put(NULL, &key, &data, 0);
+      {
+        BdbStoreDb namespace_db(handle_namespace_db);
+        BdbStoreDb state_db(handle_state_db);
+        init_databases(&namespace_db, &state_db);
       }
 
-      if (data.get_data() != 0)
-        free(data.get_data());
-
-      // initialize statedb if reqd
-      key.set_data((void *)"/");
-      key.set_size(2);
-
-      data.set_flags(DB_DBT_REALLOC);
-      data.set_data(0);
-      data.set_size(0);
-
-      if((ret = handle_state_db->get(NULL, &key, &data, 0)) == DB_NOTFOUND) {
-        data.set_data(0);
-        data.set_size(0);
-        ret = handle_state_db->put(NULL, &key, &data, 0);
-        HT_ASSERT(ret == 0);
-      }
-      // init next ids in statedb
-      keym.set_str(NEXT_SESSION_ID);
-      if ((ret = handle_state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
-        sprintf(numbuf, "%llu", (Llu)1);
-        datam.set_str(numbuf);
-        ret = handle_state_db->put(NULL, &keym, &datam, 0);
-        HT_ASSERT(ret==0);
-      }
-      keym.set_str(NEXT_HANDLE_ID);
-      if ( (ret = handle_state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
-        sprintf(numbuf, "%llu", (Llu)1);
-        datam.set_str(numbuf);
-        ret = handle_state_db->put(NULL, &keym, &datam, 0);
-        HT_ASSERT(ret==0);
-      }
-      keym.set_str(NEXT_EVENT_ID);
-      if ((ret = handle_state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
-        sprintf(numbuf, "%llu", (Llu)1);
-        datam.set_str(numbuf);
-        ret = handle_state_db->put(NULL, &keym, &datam, 0);
-        HT_ASSERT(ret==0);
-      }
-
-      if (data.get_data() != 0)
-        free(data.get_data());
-
       //close handles
       handle_state_db->close(0);
       delete handle_state_db;
@@ -369,6 +324,13 @@ BerkeleyDbFilesystem::BerkeleyDbFilesystem(PropertiesPtr &props,
 /*
  */
 BerkeleyDbFilesystem::~BerkeleyDbFilesystem() {
+  if (m_wal_namespace) {
+    m_wal_namespace = 0;
+    m_wal_state = 0;
+    HT_INFO("namespace closed");
+    return;
+  }
+
   /*
    * Close Berkeley DB "namespace" database and environment
    */
@@ -504,6 +466,112 @@ void BerkeleyDbFilesystem::init_db_handles(const std::vector<Thread::id> &thread
 }
 
 
+void BerkeleyDbFilesystem::init_wal_store(PropertiesPtr &props) {
+
+  if (props->has("Hyperspace.Replica.Host") &&
+      props->get_strs("Hyperspace.Replica.Host").size() > 1)
+    HT_FATAL("Hyperspace.Store=wal does not support replication, only one "
+             "Hyperspace.Replica.Host may be configured");
+  m_replication_info.do_replication = false;
+
+  uint64_t snapshot_threshold = props->get_i32("Hyperspace.Checkpoint.Size");
+
+  try {
+    m_wal_namespace = new WalStore(m_base_dir + "/wal", snapshot_threshold);
+
+    // Haven't implemented state recovery yet, so start with an empty statedb
+    Path state_dir(m_base_dir + "/wal_state");
+    if (boost::filesystem::exists(state_dir)) {
+      HT_INFO("Removing statedb");
+      boost::filesystem::remove_all(state_dir);
+    }
+    m_wal_state = new WalStore(state_dir.string(), snapshot_threshold, false);
+
+    WalDbTxn txn(m_wal_mutex, m_wal_namespace.get(), m_wal_state.get(),
+                 &m_wal_next_seq);
+    init_databases(txn.namespace_db(), txn.state_db());
+    txn.commit();
+  }
+  catch (Exception &e) {
+    HT_FATALF("Error initializing WAL store (dir=%s) - %s",
+              m_base_dir.c_str(), e.what());
+  }
+  catch (std::exception &e) {
+    HT_FATALF("Error initializing WAL store (dir=%s) - %s",
+              m_base_dir.c_str(), e.what());
+  }
+  HT_INFOF("Opened WAL store in %s/wal", m_base_dir.c_str());
+}
+
+
+void BerkeleyDbFilesystem::init_databases(StoreDb *namespace_db,
+                                          StoreDb *state_db) {
+  int ret;
+  Dbt key, data;
+  DbtManaged keym, datam;
+  char numbuf[17];
+
+  key.set_data((void *)"/");
+  key.set_size(2);
+
+  data.set_flags(DB_DBT_REALLOC);
+  if ((ret = namespace_db->get(NULL, &key, &data, 0)) == DB_NOTFOUND) {
+    data.set_data(0);
+    data.set_size(0);
+    ret = namespace_db->put(NULL, &key, &data, 0);
+    key.set_data((void *)"/hyperspace/");
+    key.set_size(strlen("/hyperspace/")+1);
+    ret = namespace_db->put(NULL, &key, &data, 0);
+    key.set_data((void *)"/hyperspace/metadata");
+    key.set_size(strlen("/hyperspace/metadata")+1);
+    ret = namespace_db->put(NULL, &key, &data, 0);
+  }
+
+  if (data.get_data() != 0)
+    free(data.get_data());
+
+  // initialize statedb if reqd
+  key.set_data((void *)"/");
+  key.set_size(2);
+
+  data.set_flags(DB_DBT_REALLOC);
+  data.set_data(0);
+  data.set_size(0);
+
+  if((ret = state_db->get(NULL, &key, &data, 0)) == DB_NOTFOUND) {
+    data.set_data(0);
+    data.set_size(0);
+    ret = state_db->put(NULL, &key, &data, 0);
+    HT_ASSERT(ret == 0);
+  }
+  // init next ids in statedb
+  keym.set_str(NEXT_SESSION_ID);
+  if ((ret = state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
+    sprintf(numbuf, "%llu", (Llu)1);
+    datam.set_str(numbuf);
+    ret = state_db->put(NULL, &keym, &datam, 0);
+    HT_ASSERT(ret==0);
+  }
+  keym.set_str(NEXT_HANDLE_ID);
+  if ( (ret = state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
+    sprintf(numbuf, "%llu", (Llu)1);
+    datam.set_str(numbuf);
+    ret = state_db->put(NULL, &keym, &datam, 0);
+    HT_ASSERT(ret==0);
+  }
+  keym.set_str(NEXT_EVENT_ID);
+  if ((ret = state_db->get(NULL, &keym, &datam, 0)) == DB_NOTFOUND) {
+    sprintf(numbuf, "%llu", (Llu)1);
+    datam.set_str(numbuf);
+    ret = state_db->put(NULL, &keym, &datam, 0);
+    HT_ASSERT(ret==0);
+  }
+
+  if (data.get_data() != 0)
+    free(data.get_data());
+}
+
+
 BDbHandlesPtr BerkeleyDbFilesystem::get_db_handles() {
   ThreadHandleMap::iterator it = m_thread_handle_map.find(ThisThread::get_id());
   if (it == m_thread_handle_map.end())
@@ -518,6 +586,9 @@ BDbHandlesPtr BerkeleyDbFilesystem::get_db_handles() {
     it->second->handle_state_db->set_flags(DB_DUP|DB_REVSPLITOFF);
     it->second->handle_state_db->open(NULL, ms_name_state_db, NULL,
                                         DB_BTREE, m_db_flags, 0);
+    it->second->store_namespace_db =
+      new BdbStoreDb(it->second->handle_namespace_db);
+    it->second->store_state_db = new BdbStoreDb(it->second->handle_state_db);
     it->second->open=true;
   }
   return it->second;
@@ -526,6 +597,9 @@ BDbHandlesPtr BerkeleyDbFilesystem::get_db_handles() {
 
 void BerkeleyDbFilesystem::do_checkpoint() {
 
+  if (m_wal_namespace)
+    return;
+
   // do checkpoint, don't bother to check if this is the master
   // since its just ignored be  slaves
   HT_DEBUG_OUT << "Do checkpoint if log > " << m_checkpoint_size_kb << "KB" << HT_END;
@@ -584,6 +658,16 @@ void BerkeleyDbFilesystem::do_checkpoint() {
 
 void BerkeleyDbFilesystem::start_transaction(BDbTxn &txn) {
 
+  if (m_wal_namespace) {
+    HT_ASSERT(txn.handle_namespace_db == 0 && txn.handle_state_db == 0);
+    txn.wal_txn.reset(new WalDbTxn(m_wal_mutex, m_wal_namespace.get(),
+                                   m_wal_state.get(), &m_wal_next_seq));
+    txn.handle_namespace_db = txn.wal_txn->namespace_db();
+    txn.handle_state_db = txn.wal_txn->state_db();
+    HT_DEBUG_OUT <<"txn="<< txn << HT_END;
+    return;
+  }
+
   // begin transaction
   try {
     HT_ASSERT(txn.handle_namespace_db == 0 && txn.handle_state_db == 0);
@@ -592,8 +676,8 @@ void BerkeleyDbFilesystem::start_transaction(BDbTxn &txn) {
     BDbHandlesPtr db_handles = get_db_handles();
 
     // Use handles for this thread
-    txn.handle_namespace_db = db_handles->handle_namespace_db;
-    txn.handle_state_db = db_handles->handle_state_db;
+    txn.handle_namespace_db = db_handles->store_namespace_db;
+    txn.handle_state_db = db_handles->store_state_db;
 
     // open txn
     m_env.txn_begin(NULL, &txn.db_txn, 0);
@@ -988,7 +1072,7 @@ void BerkeleyDbFilesystem::unlink(BDbTxn &txn, const String &name) {
   std::vector<String> delkeys;
   DbtManaged keym, datam;
   Dbt key;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool looks_like_dir = false;
   bool looks_like_file = false;
@@ -1146,7 +1230,7 @@ BerkeleyDbFilesystem::get_directory_listing(BDbTxn &txn, String fname,
                                             std::vector<DirEntry> &listing) {
   DbtManaged keym, datam;
   Dbt key;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String str, last_str;
   DirEntry entry;
@@ -1245,7 +1329,7 @@ BerkeleyDbFilesystem::get_directory_attr_listing(BDbTxn &txn, String fname,
                                                  std::vector<DirEntryAttr> &listing) {
   DbtManaged keym, datam;
   Dbt key;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String entryname, last_entryname, str, attr;
   DirEntryAttr entry;
@@ -1331,7 +1415,7 @@ void
 BerkeleyDbFilesystem::get_all_names(BDbTxn &txn,
                                     std::vector<String> &names) {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   int ret;
 
@@ -1379,7 +1463,7 @@ BerkeleyDbFilesystem::list_xattr(BDbTxn &txn, const String& fname,
                                  std::vector<String> &anames)
 {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   int ret;
   bool isdir;
@@ -1430,7 +1514,7 @@ BerkeleyDbFilesystem::create_event(BDbTxn &txn, uint32_t type, uint64_t id,
   DbtManaged keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"create_event txn="<< txn <<" event type='"<< type <<"' id="
@@ -1486,7 +1570,7 @@ BerkeleyDbFilesystem::create_event(BDbTxn &txn, uint32_t type, uint64_t id,
   int ret;
   String key_str;
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   try {
@@ -1628,7 +1712,7 @@ BerkeleyDbFilesystem::delete_event(BDbTxn &txn, uint64_t id)
   DbtManaged keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"delete_event txn="<< txn <<" event id="<< id << HT_END;
@@ -1709,7 +1793,7 @@ bool
 BerkeleyDbFilesystem::event_exists(BDbTxn &txn, uint64_t id)
 {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool exists = true;
   char numbuf[16];
@@ -1756,7 +1840,7 @@ BerkeleyDbFilesystem::create_session(BDbTxn &txn, uint64_t id, const String& add
   String key_str;
   String expbuf;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"create_session txn="<< txn <<" create session addr='"<< addr
@@ -1814,7 +1898,7 @@ BerkeleyDbFilesystem::delete_session(BDbTxn &txn, uint64_t id)
   DbtManaged keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"delete_session txn="<< txn <<" session id="<< id << HT_END;
@@ -1885,7 +1969,7 @@ BerkeleyDbFilesystem::expire_session(BDbTxn &txn, uint64_t id)
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"expire_session txn="<< txn <<" session id="<< id << HT_END;
@@ -1926,7 +2010,7 @@ BerkeleyDbFilesystem::add_session_handle(BDbTxn &txn, uint64_t id, uint64_t hand
   DbtManaged  keym, datam;
   String key_str;
   char numbuf[17];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT << "add_session_handle txn="<< txn <<" session id="<< id
@@ -1964,7 +2048,7 @@ BerkeleyDbFilesystem::get_session_handles(BDbTxn &txn, uint64_t id, std::vector<
   int ret;
   DbtManaged  keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"get_session_handles txn="<< txn <<" session id="<< id << HT_END;
@@ -2005,7 +2089,7 @@ BerkeleyDbFilesystem::delete_session_handle(BDbTxn &txn, uint64_t id, uint64_t h
   String key_str;
   char numbuf[17];
   bool deleted = false;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"delete_session_handle txn="<< txn <<" session id="<< id
@@ -2050,7 +2134,7 @@ bool
 BerkeleyDbFilesystem::session_exists(BDbTxn &txn, uint64_t id)
 {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool exists = true;
   char numbuf[16];
@@ -2095,7 +2179,7 @@ BerkeleyDbFilesystem::set_session_name(BDbTxn &txn, uint64_t id, const String &n
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"set_session_name txn="<< txn <<" name='"<< name << "' id="<< id << HT_END;
@@ -2135,7 +2219,7 @@ BerkeleyDbFilesystem::get_session_name(BDbTxn &txn, uint64_t id)
   int ret;
   DbtManaged  keym, datam;
   String key_str, name;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"get_session_name txn="<< txn <<" session id="<< id << HT_END;
@@ -2183,7 +2267,7 @@ BerkeleyDbFilesystem::create_handle(BDbTxn &txn, uint64_t id, String node_name,
   String key_str;
   char numbuf[17];
   String buf;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"create_handle txn="<< txn <<" id="<< id << " node='"<< node_name
@@ -2284,7 +2368,7 @@ BerkeleyDbFilesystem::delete_handle(BDbTxn &txn, uint64_t id)
   DbtManaged keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"delete_handle txn="<< txn <<" handle id="<< id << HT_END;
@@ -2368,7 +2452,7 @@ BerkeleyDbFilesystem::set_handle_del_state(BDbTxn &txn, uint64_t id, uint32_t de
   DbtManaged keym, datam;
   char numbuf[17];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -2413,7 +2497,7 @@ BerkeleyDbFilesystem::set_handle_open_flags(BDbTxn &txn, uint64_t id, uint32_t o
   DbtManaged keym, datam;
   char numbuf[17];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -2459,7 +2543,7 @@ BerkeleyDbFilesystem::set_handle_event_mask(BDbTxn &txn, uint64_t id, uint32_t e
   DbtManaged keym, datam;
   char numbuf[17];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -2504,7 +2588,7 @@ BerkeleyDbFilesystem::get_handle_event_mask(BDbTxn &txn, uint64_t id)
 {
   DbtManaged keym, datam;
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
   uint32_t event_mask;
@@ -2546,7 +2630,7 @@ BerkeleyDbFilesystem::set_handle_locked(BDbTxn &txn, uint64_t id, bool locked)
   DbtManaged keym, datam;
   int ret;
   String buf;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -2589,7 +2673,7 @@ bool
 BerkeleyDbFilesystem::handle_exists(BDbTxn &txn, uint64_t id)
 {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool exists = true;
   char numbuf[17];
@@ -2840,7 +2924,7 @@ BerkeleyDbFilesystem::create_node(BDbTxn &txn, const String &name,
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String buf;
   char numbuf[17];
@@ -2927,7 +3011,7 @@ BerkeleyDbFilesystem::set_node_lock_generation(BDbTxn &txn, const String &name,
   DbtManaged keym, datam;
   char numbuf[17];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   String key_str;
@@ -2974,7 +3058,7 @@ BerkeleyDbFilesystem::incr_node_lock_generation(BDbTxn &txn, const String &name)
   char numbuf[17];
   int ret;
   uint64_t lock_generation=0;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   String key_str;
@@ -3025,7 +3109,7 @@ BerkeleyDbFilesystem::set_node_ephemeral(BDbTxn &txn, const String &name,
   DbtManaged keym, datam;
   int ret;
   String buf;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -3117,7 +3201,7 @@ BerkeleyDbFilesystem::set_node_cur_lock_mode(BDbTxn &txn, const String &name,
   DbtManaged keym, datam;
   char numbuf[16];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -3161,7 +3245,7 @@ BerkeleyDbFilesystem::get_node_cur_lock_mode(BDbTxn &txn, const String &name)
 {
   DbtManaged keym, datam;
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
   uint32_t lock_mode;
@@ -3204,7 +3288,7 @@ BerkeleyDbFilesystem::set_node_exclusive_lock_handle(BDbTxn &txn,
   DbtManaged keym, datam;
   char numbuf[17];
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
 
@@ -3247,7 +3331,7 @@ BerkeleyDbFilesystem::get_node_exclusive_lock_handle(BDbTxn &txn, const String &
 {
   DbtManaged keym, datam;
   int ret;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   String key_str;
   uint64_t exclusive_lock_handle=0;
@@ -3292,7 +3376,7 @@ BerkeleyDbFilesystem::add_node_handle(BDbTxn &txn, const String &name,
   DbtManaged  keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"add_node_handle txn="<< txn <<" node="<< name << " handle id=" << handle_id
@@ -3334,7 +3418,7 @@ BerkeleyDbFilesystem::get_node_event_notification_map(BDbTxn &txn, const String
   String key_str;
   uint64_t handle, session;
   uint32_t mask;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool has_notifications = false;
 
@@ -3386,7 +3470,7 @@ BerkeleyDbFilesystem::delete_node_handle(BDbTxn &txn, const String &name,
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp=0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   char numbuf[17];
 
@@ -3432,7 +3516,7 @@ BerkeleyDbFilesystem::add_node_pending_lock_request(BDbTxn &txn,
   DbtManaged keym, datam;
   String key_str;
   char numbuf[17];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"add_node_pending_lock_request txn="<< txn <<" node=" << name
@@ -3480,7 +3564,7 @@ BerkeleyDbFilesystem::node_has_pending_lock_request(BDbTxn &txn, const String &n
   DbtManaged keym, datam;
   String key_str;
   bool has_pending_lock_request = false;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   uint64_t handle_id;
 
@@ -3534,7 +3618,7 @@ BerkeleyDbFilesystem::get_node_pending_lock_request(BDbTxn &txn, const String &n
   DbtManaged keym, datam;
   String key_str;
   bool has_pending_lock_request = false;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   uint64_t handle_id;
 
@@ -3588,7 +3672,7 @@ BerkeleyDbFilesystem::delete_node_pending_lock_request(BDbTxn &txn,
   DbtManaged keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"remove_node_pending_lock_request txn="<< txn <<" node=" << name
@@ -3638,7 +3722,7 @@ BerkeleyDbFilesystem::add_node_shared_lock_handle(BDbTxn &txn, const String &nam
   DbtManaged  keym, datam;
   String key_str;
   char numbuf[16];
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"add_node_shared_lock_handle txn="<< txn <<" node="<< name
@@ -3677,7 +3761,7 @@ BerkeleyDbFilesystem::node_has_shared_lock_handles(BDbTxn &txn, const String &na
   int ret;
   DbtManaged  keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool has_shared_lock_handles=false;
 
@@ -3719,7 +3803,7 @@ BerkeleyDbFilesystem::delete_node_shared_lock_handle(BDbTxn &txn, const String &
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp=0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   char numbuf[17];
 
@@ -3761,7 +3845,7 @@ BerkeleyDbFilesystem::delete_node(BDbTxn &txn, const String &name)
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT <<"delete_node txn="<< txn <<" node ="<< name << HT_END;
@@ -3828,7 +3912,7 @@ bool
 BerkeleyDbFilesystem::node_exists(BDbTxn &txn, const String &name)
 {
   DbtManaged keym, datam;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool exists = true;
 
@@ -3871,7 +3955,7 @@ BerkeleyDbFilesystem::get_node_handles(BDbTxn &txn, const String &name,
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
 
   HT_DEBUG_OUT << "get_node_handles txn=" << txn << " node=" << name << HT_END;
@@ -3912,7 +3996,7 @@ BerkeleyDbFilesystem::node_has_open_handles(BDbTxn &txn, const String &name)
   int ret;
   DbtManaged keym, datam;
   String key_str;
-  Dbc *cursorp=0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   bool has_open_handles = false;
   uint64_t open_handle;
@@ -3959,7 +4043,7 @@ BerkeleyDbFilesystem::get_next_id_i64(BDbTxn &txn, IdentifierType id_type, bool
   DbtManaged keym, datam;
   int ret;
   uint64_t retval=0;
-  Dbc *cursorp = 0;
+  StoreCursor *cursorp = 0;
   HT_ON_SCOPE_EXIT(&close_db_cursor, &cursorp);
   char numbuf[17];
 
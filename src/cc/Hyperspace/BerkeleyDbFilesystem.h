@@ -33,6 +33,8 @@
 #include <Hyperspace/DirEntry.h>
 #include <Hyperspace/DirEntryAttr.h>
 #include <Hyperspace/StateDbKeys.h>
+#include <Hyperspace/StoreDb.h>
+#include <Hyperspace/WalStoreDb.h>
 
 #include <Common/DynamicBuffer.h>
 #include <Common/FileUtils.h>
@@ -138,7 +140,8 @@ namespace Hyperspace {
   public:
 
     /** Constructor. */
-    BDbHandles(): open(false), handle_namespace_db(0), handle_state_db(0) {}
+    BDbHandles(): open(false), handle_namespace_db(0), handle_state_db(0),
+                  store_namespace_db(0), store_state_db(0) {}
 
     /** Destructor. Calls close(). */
     ~BDbHandles() {
@@ -146,11 +149,15 @@ namespace Hyperspace {
     }
 
     /** Closes and destroys database handles
-     * Closes and destroys #handle_namespace_db and #handle_state_db and sets
-     * #open to <i>false</i>.
+     * Closes and destroys #handle_namespace_db and #handle_state_db (and
+     * their StoreDb adapters) and sets #open to <i>false</i>.
      */
     void close() {
       if (open) {
+        delete store_namespace_db;
+        delete store_state_db;
+        store_namespace_db = 0;
+        store_state_db = 0;
         try {
           handle_namespace_db->close(0);
           handle_state_db->close(0);
@@ -174,12 +181,22 @@ namespace Hyperspace {
 
     /// Database handle transient state
     Db *handle_state_db;
+
+    /// StoreDb adapter for #handle_namespace_db
+    StoreDb *store_namespace_db;
+
+    /// StoreDb adapter for #handle_state_db
+    StoreDb *store_state_db;
   };
 
   /// Smart pointer to BDbHandles
   typedef intrusive_ptr<BDbHandles> BDbHandlesPtr;
 
-  /** Manages transaction state */
+  /** Manages transaction state.
+   * With the BerkeleyDB store, #db_txn holds the BerkeleyDB transaction;
+   * with the WAL store (<code>Hyperspace.Store=wal</code>), #wal_txn holds
+   * the buffered updates and #db_txn is 0.
+   */
   class BDbTxn {
   public:
     /** Constructor. */
@@ -189,24 +206,41 @@ namespace Hyperspace {
      * @param flag BerkeleyDB commit flags
      */
     void commit(int flag=0) {
+      if (wal_txn) {
+        WalDbTxnPtr txn = wal_txn;
+        wal_txn.reset();
+        handle_namespace_db = handle_state_db = 0;
+        txn->commit();
+        return;
+      }
       db_txn->commit(flag);
       db_txn = 0;
     }
 
     /** Abort transaction. */
     void abort() {
-      db_txn->abort();
-      db_txn = 0;
+      if (wal_txn) {
+        wal_txn->abort();
+        wal_txn.reset();
+        handle_namespace_db = handle_state_db = 0;
+      }
+      else if (db_txn) {
+        db_txn->abort();
+        db_txn = 0;
+      }
     }
 
     /// Filesystem namespace database handle
-    Db *handle_namespace_db;
+    StoreDb *handle_namespace_db;
 
     /// Transient state database handle
-    Db *handle_state_db;
+    StoreDb *handle_state_db;
 
     /// BerkeleyDB transaction object
     DbTxn *db_txn;
+
+    /// WAL store transaction
+    WalDbTxnPtr wal_txn;
   };
 
   /** Writes human-readable version of <code>txn</code> to an ostream.
@@ -242,7 +276,8 @@ namespace Hyperspace {
      * database.  It passes in the value #m_checkpoing_size_kb.  Then if the
      * time of the last checkpoint has exceeded #m_log_gc_interval, it will call
      * <code>m_env.log_archive</code> to obtain a list of unused log files and
-     * it will remove them.
+     * it will remove them.  With the WAL store this is a no-op since
+     * WalStore snapshots itself once its log reaches the checkpoint size.
      */
     void do_checkpoint();
 
@@ -793,6 +828,21 @@ namespace Hyperspace {
      * Initialize per worker thread DB handles
      */
     void init_db_handles(const std::vector<Thread::id> &thread_ids);
+
+    /** Opens the WAL store.
+     * Opens the <i>namespace</i> store in <code>basedir/wal</code> and
+     * recreates the (unsynced) <i>state</i> store in
+     * <code>basedir/wal_state</code>, since state recovery is not
+     * implemented.  Replication is not supported with the WAL store.
+     * @param props Configruation properties
+     */
+    void init_wal_store(PropertiesPtr &props);
+
+    /** Creates the root entries if they don't exist yet.
+     * @param namespace_db <i>namespace</i> database
+     * @param state_db <i>state</i> database
+     */
+    void init_databases(StoreDb *namespace_db, StoreDb *state_db);
     BDbHandlesPtr get_db_handles();
     void build_attr_key(BDbTxn &, String &keystr,
                         const String &aname, Dbt &key);
@@ -814,6 +864,18 @@ namespace Hyperspace {
     uint32_t  m_log_gc_interval;
     uint32_t m_max_unused_logs;
     boost::xtime m_last_log_gc_time;
+
+    /// WAL store holding the <i>namespace</i> database (WAL mode only)
+    WalStorePtr m_wal_namespace;
+
+    /// WAL store holding the <i>state</i> database (WAL mode only)
+    WalStorePtr m_wal_state;
+
+    /// %Mutex serializing WAL store transactions
+    RecMutex m_wal_mutex;
+
+    /// Duplicate sequence number counter of #m_wal_state
+    uint64_t m_wal_next_seq;
   };
 
   /** @} */
@@ -0,0 +1,256 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for ClientCache.
+ * This file contains definitions for ClientCache, a session-scoped cache of
+ * node attributes, directory listings and existence checks that is kept
+ * coherent with %Hyperspace event notifications.
+ */
+
+#include <Common/Compat.h>
+
+#include "ClientCache.h"
+#include "HandleCallback.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+  const uint32_t ATTR_EVENTS = EVENT_MASK_ATTR_SET|EVENT_MASK_ATTR_DEL;
+  const uint32_t CHILD_EVENTS =
+    EVENT_MASK_CHILD_NODE_ADDED|EVENT_MASK_CHILD_NODE_REMOVED;
+}
+
+void ClientCache::add_handle(uint64_t handle, const String &node,
+                             uint32_t event_mask) {
+  ScopedLock lock(m_mutex);
+  HandleInfo &info = m_handles[handle];
+  info.node = node;
+  info.event_mask = event_mask;
+  Node &entry = m_nodes[node];
+  entry.handles++;
+  if ((event_mask & ATTR_EVENTS) == ATTR_EVENTS)
+    entry.attr_watchers++;
+  if ((event_mask & CHILD_EVENTS) == CHILD_EVENTS)
+    entry.child_watchers++;
+}
+
+void ClientCache::remove_handle(uint64_t handle) {
+  ScopedLock lock(m_mutex);
+  auto hiter = m_handles.find(handle);
+  if (hiter == m_handles.end())
+    return;
+  auto iter = m_nodes.find(hiter->second.node);
+  if (iter != m_nodes.end()) {
+    Node &entry = iter->second;
+    uint32_t event_mask = hiter->second.event_mask;
+    HT_ASSERT(entry.handles > 0);
+    entry.handles--;
+    if ((event_mask & ATTR_EVENTS) == ATTR_EVENTS && --entry.attr_watchers == 0)
+      entry.attrs.clear();
+    if ((event_mask & CHILD_EVENTS) == CHILD_EVENTS && --entry.child_watchers == 0) {
+      entry.listing_valid = false;
+      entry.listing.clear();
+      entry.children.clear();
+    }
+    maybe_remove(iter);
+  }
+  m_handles.erase(hiter);
+}
+
+bool ClientCache::get_attr(const String &node, const String &attr,
+                           DynamicBuffer *value, bool *existsp) {
+  ScopedLock lock(m_mutex);
+  auto iter = m_nodes.find(node);
+  if (iter == m_nodes.end() || iter->second.attr_watchers == 0)
+    return false;
+  AttrMap::iterator aiter = iter->second.attrs.find(attr);
+  if (aiter == iter->second.attrs.end()) {
+    m_stats.attr_misses++;
+    return false;
+  }
+  m_stats.attr_hits++;
+  *existsp = (bool)aiter->second;
+  if (aiter->second && value) {
+    value->clear();
+    value->ensure(aiter->second->fill() + 1);
+    value->add_unchecked(aiter->second->base, aiter->second->fill());
+    // nul-terminate to match Session::decode_value()
+    *value->ptr = 0;
+  }
+  return true;
+}
+
+void ClientCache::put_attr(uint64_t generation, const String &node,
+                           const String &attr, const void *value, size_t len,
+                           bool exists) {
+  ScopedLock lock(m_mutex);
+  if (generation != m_generation)
+    return;
+  auto iter = m_nodes.find(node);
+  if (iter == m_nodes.end() || iter->second.attr_watchers == 0)
+    return;
+  DynamicBufferPtr buf;
+  if (exists) {
+    buf = new DynamicBuffer(len);
+    buf->add_unchecked(value, len);
+  }
+  iter->second.attrs[attr] = buf;
+}
+
+bool ClientCache::get_listing(const String &node,
+                              std::vector<DirEntry> &listing) {
+  ScopedLock lock(m_mutex);
+  auto iter = m_nodes.find(node);
+  if (iter == m_nodes.end() || iter->second.child_watchers == 0)
+    return false;
+  if (!iter->second.listing_valid) {
+    m_stats.listing_misses++;
+    return false;
+  }
+  m_stats.listing_hits++;
+  listing = iter->second.listing;
+  return true;
+}
+
+void ClientCache::put_listing(uint64_t generation, const String &node,
+                              const std::vector<DirEntry> &listing) {
+  ScopedLock lock(m_mutex);
+  if (generation != m_generation)
+    return;
+  auto iter = m_nodes.find(node);
+  if (iter == m_nodes.end() || iter->second.child_watchers == 0)
+    return;
+  iter->second.listing = listing;
+  iter->second.listing_valid = true;
+}
+
+bool ClientCache::get_exists(const String &name, bool *existsp) {
+  ScopedLock lock(m_mutex);
+
+  // A node with an open handle cannot be removed
+  auto iter = m_nodes.find(name);
+  if (iter != m_nodes.end() && iter->second.handles > 0) {
+    m_stats.exists_hits++;
+    *existsp = true;
+    return true;
+  }
+
+  String parent, child;
+  if (!split_name(name, parent, child))
+    return false;
+
+  iter = m_nodes.find(parent);
+  if (iter == m_nodes.end() || iter->second.child_watchers == 0)
+    return false;
+
+  std::map<String, bool>::iterator citer = iter->second.children.find(child);
+  if (citer != iter->second.children.end()) {
+    m_stats.exists_hits++;
+    *existsp = citer->second;
+    return true;
+  }
+
+  if (iter->second.listing_valid) {
+    m_stats.exists_hits++;
+    *existsp = false;
+    for (const DirEntry &entry : iter->second.listing) {
+      if (entry.name == child) {
+        *existsp = true;
+        break;
+      }
+    }
+    return true;
+  }
+
+  m_stats.exists_misses++;
+  return false;
+}
+
+void ClientCache::put_exists(uint64_t generation, const String &name,
+                             bool exists) {
+  ScopedLock lock(m_mutex);
+  String parent, child;
+  if (generation != m_generation || !split_name(name, parent, child))
+    return;
+  auto iter = m_nodes.find(parent);
+  if (iter == m_nodes.end() || iter->second.child_watchers == 0)
+    return;
+  iter->second.children[child] = exists;
+}
+
+void ClientCache::notify(const String &node, uint32_t event_mask,
+                         const String &name) {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  auto iter = m_nodes.find(node);
+  if (iter == m_nodes.end())
+    return;
+  if (event_mask & ATTR_EVENTS)
+    m_stats.invalidations += iter->second.attrs.erase(name);
+  else if (event_mask & CHILD_EVENTS) {
+    if (iter->second.listing_valid)
+      m_stats.invalidations++;
+    iter->second.listing_valid = false;
+    iter->second.listing.clear();
+    m_stats.invalidations += iter->second.children.erase(name);
+  }
+}
+
+void ClientCache::clear() {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  for (auto &entry : m_nodes) {
+    entry.second.attrs.clear();
+    entry.second.listing_valid = false;
+    entry.second.listing.clear();
+    entry.second.children.clear();
+  }
+}
+
+void ClientCache::reset() {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  m_nodes.clear();
+  m_handles.clear();
+}
+
+void ClientCache::get_statistics(Statistics &stats) {
+  ScopedLock lock(m_mutex);
+  stats = m_stats;
+  stats.nodes = m_nodes.size();
+}
+
+bool ClientCache::split_name(const String &name, String &parent,
+                             String &child) {
+  size_t last_slash = name.rfind('/');
+  if (last_slash == String::npos || name.length() == 1)
+    return false;
+  parent = (last_slash == 0) ? String("/") : name.substr(0, last_slash);
+  child = name.substr(last_slash + 1);
+  return true;
+}
+
+void ClientCache::maybe_remove(std::unordered_map<String, Node>::iterator iter) {
+  if (iter->second.handles == 0)
+    m_nodes.erase(iter);
+}
@@ -0,0 +1,266 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for ClientCache.
+ * This file contains declarations for ClientCache, a session-scoped cache of
+ * node attributes, directory listings and existence checks that is kept
+ * coherent with %Hyperspace event notifications.
+ */
+
+#ifndef HYPERSPACE_CLIENTCACHE_H
+#define HYPERSPACE_CLIENTCACHE_H
+
+#include <Hyperspace/DirEntry.h>
+
+#include <Common/DynamicBuffer.h>
+#include <Common/Mutex.h>
+#include <Common/ReferenceCount.h>
+#include <Common/String.h>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace Hyperspace {
+
+  using namespace Hypertable;
+
+  /** @addtogroup Hyperspace
+   * @{
+   */
+
+  /** Client-side cache of node attributes and directory listings.
+   * Cached information is only retained for nodes on which the session holds
+   * an open handle registered for the events that would announce a change to
+   * that information:
+   *   - Attribute values of a node are cached if some handle on the node was
+   *     opened with both EVENT_MASK_ATTR_SET and EVENT_MASK_ATTR_DEL.
+   *   - The directory listing of a node, and the existence of its children,
+   *     are cached if some handle on the node was opened with both
+   *     EVENT_MASK_CHILD_NODE_ADDED and EVENT_MASK_CHILD_NODE_REMOVED.
+   *   - A node is known to exist while any handle on it is open, since the
+   *     master refuses to unlink a node that is referred to by a handle.
+   *
+   * The master does not complete a mutation until every session with a
+   * handle interested in the resulting event has received the notification,
+   * so invalidating on notification receipt (see notify()) keeps the cache
+   * coherent.  Lookups that race with an invalidation are detected with a
+   * generation number: callers obtain generation() before issuing the
+   * request that fills a miss and the fill is discarded if any invalidation
+   * happened in the meantime.
+   */
+  class ClientCache : public ReferenceCount {
+  public:
+
+    /** Cache statistics. */
+    struct Statistics {
+      Statistics() : attr_hits(0), attr_misses(0), listing_hits(0),
+                     listing_misses(0), exists_hits(0), exists_misses(0),
+                     invalidations(0), nodes(0) { }
+      /** Returns hit rate (percent) over all cacheable lookups.
+       * @return Hit rate
+       */
+      double hit_rate() const {
+        uint64_t hits = attr_hits + listing_hits + exists_hits;
+        uint64_t total = hits + attr_misses + listing_misses + exists_misses;
+        return total ? ((double)hits * 100.0) / (double)total : 0.0;
+      }
+      /// Attribute lookups served from the cache
+      uint64_t attr_hits;
+      /// Cacheable attribute lookups that went to the master
+      uint64_t attr_misses;
+      /// Directory listings served from the cache
+      uint64_t listing_hits;
+      /// Cacheable directory listings that went to the master
+      uint64_t listing_misses;
+      /// Existence checks served from the cache
+      uint64_t exists_hits;
+      /// Cacheable existence checks that went to the master
+      uint64_t exists_misses;
+      /// Number of cached entries invalidated by notifications
+      uint64_t invalidations;
+      /// Number of nodes currently tracked
+      size_t nodes;
+    };
+
+    /** Constructor. */
+    ClientCache() : m_generation(0) { }
+
+    /** Registers an open handle.
+     * @param handle Handle ID
+     * @param node Normalized name of node
+     * @param event_mask Event mask the handle was opened with
+     */
+    void add_handle(uint64_t handle, const String &node, uint32_t event_mask);
+
+    /** Unregisters a handle.  When the last handle interested in a class
+     * of events on a node goes away, the information cached for that class
+     * is dropped.
+     * @param handle Handle ID
+     */
+    void remove_handle(uint64_t handle);
+
+    /** Returns the current generation number.
+     * @return Current generation number
+     */
+    uint64_t generation() {
+      ScopedLock lock(m_mutex);
+      return m_generation;
+    }
+
+    /** Looks up a cached attribute value.
+     * @param node Normalized name of node
+     * @param attr Attribute name
+     * @param value Filled in with attribute value on a positive hit
+     * @param existsp Set to <i>true</i> if attribute exists, <i>false</i>
+     * if it is cached as non-existent
+     * @return <i>true</i> on a cache hit, <i>false</i> otherwise
+     */
+    bool get_attr(const String &node, const String &attr,
+                  DynamicBuffer *value, bool *existsp);
+
+    /** Caches an attribute value (or its non-existence).
+     * @param generation Generation obtained before the value was fetched
+     * @param node Normalized name of node
+     * @param attr Attribute name
+     * @param value Attribute value (ignored if <code>exists</code> is false)
+     * @param len Length of <code>value</code>
+     * @param exists Flag indicating if the attribute exists
+     */
+    void put_attr(uint64_t generation, const String &node, const String &attr,
+                  const void *value, size_t len, bool exists);
+
+    /** Looks up a cached directory listing.
+     * @param node Normalized name of directory
+     * @param listing Filled in with cached listing on a hit
+     * @return <i>true</i> on a cache hit, <i>false</i> otherwise
+     */
+    bool get_listing(const String &node, std::vector<DirEntry> &listing);
+
+    /** Caches a directory listing.
+     * @param generation Generation obtained before the listing was fetched
+     * @param node Normalized name of directory
+     * @param listing Directory listing
+     */
+    void put_listing(uint64_t generation, const String &node,
+                     const std::vector<DirEntry> &listing);
+
+    /** Looks up whether a node exists.
+     * @param name Normalized name of node
+     * @param existsp Set to cached existence on a hit
+     * @return <i>true</i> on a cache hit, <i>false</i> otherwise
+     */
+    bool get_exists(const String &name, bool *existsp);
+
+    /** Caches the existence of a node.
+     * @param generation Generation obtained before the check was issued
+     * @param name Normalized name of node
+     * @param exists Flag indicating if the node exists
+     */
+    void put_exists(uint64_t generation, const String &name, bool exists);
+
+    /** Applies an event notification received on a handle.
+     * @param node Normalized name of the node the handle refers to
+     * @param event_mask Event type (single EVENT_MASK_* bit)
+     * @param name Attribute name or child node name carried by the event
+     */
+    void notify(const String &node, uint32_t event_mask, const String &name);
+
+    /** Drops all cached values but keeps handle registrations. */
+    void clear();
+
+    /** Drops all cached values and handle registrations. */
+    void reset();
+
+    /** Gets cache statistics.
+     * @param stats Filled in with current statistics
+     */
+    void get_statistics(Statistics &stats);
+
+  private:
+
+    /// Attribute value or negative entry (null buffer)
+    typedef std::map<String, DynamicBufferPtr> AttrMap;
+
+    /// Cached state of a node
+    struct Node {
+      Node() : handles(0), attr_watchers(0), child_watchers(0),
+               listing_valid(false) { }
+      /// Number of open handles on node
+      uint32_t handles;
+      /// Number of open handles receiving attribute events
+      uint32_t attr_watchers;
+      /// Number of open handles receiving child node events
+      uint32_t child_watchers;
+      /// Cached attribute values
+      AttrMap attrs;
+      /// Flag indicating #listing is valid
+      bool listing_valid;
+      /// Cached directory listing
+      std::vector<DirEntry> listing;
+      /// Cached existence of children (keyed by last path component)
+      std::map<String, bool> children;
+    };
+
+    /// Registered handle
+    struct HandleInfo {
+      String node;
+      uint32_t event_mask;
+    };
+
+    /** Splits a normalized name into parent and child name.
+     * @param name Normalized name
+     * @param parent Set to parent directory name
+     * @param child Set to last path component
+     * @return <i>false</i> if <code>name</code> has no parent
+     */
+    static bool split_name(const String &name, String &parent, String &child);
+
+    /** Removes node entry if it no longer has handles.
+     * @param iter Iterator pointing to node entry
+     */
+    void maybe_remove(std::unordered_map<String, Node>::iterator iter);
+
+    /// %Mutex serializing access to members
+    Mutex m_mutex;
+
+    /// Generation number, incremented on every invalidation
+    uint64_t m_generation;
+
+    /// Map of node name to cached state
+    std::unordered_map<String, Node> m_nodes;
+
+    /// Map of handle ID to registration
+    std::unordered_map<uint64_t, HandleInfo> m_handles;
+
+    /// Statistics
+    Statistics m_stats;
+  };
+
+  /// Smart pointer to ClientCache
+  typedef intrusive_ptr<ClientCache> ClientCachePtr;
+
+  /** @}*/
+
+}
+
+#endif // HYPERSPACE_CLIENTCACHE_H
@@ -42,7 +42,7 @@ using namespace Serialization;
 ClientKeepaliveHandler::ClientKeepaliveHandler(Comm *comm, PropertiesPtr &cfg,
                                                Session *session)
   : m_dead(false), m_destroying(false), m_comm(comm),
-    m_session(session), m_session_id(0) {
+    m_session(session), m_cache(session->get_cache()), m_session_id(0) {
   int error;
 
   HT_TRY("getting config values",
@@ -290,6 +290,9 @@ void ClientKeepaliveHandler::handle(Hypertable::EventPtr &event) {
               if (!m_delivered_events.insert(event_id).second)
                 continue;
 
+              if (m_cache)
+                m_cache->notify(handle_state->normal_name, event_mask, name);
+
               if (handle_state->callback) {
                 if (event_mask == EVENT_MASK_ATTR_SET)
                   handle_state->callback->attr_set(name);
@@ -412,6 +415,8 @@ void ClientKeepaliveHandler::expire_session() {
   poll(0,0,2000);
   m_conn_handler = 0;
   m_handle_map.clear();
+  if (m_cache)
+    m_cache->reset();
   m_bad_handle_map.clear();
   m_session_id = 0;
 
@@ -486,6 +491,8 @@ void ClientKeepaliveHandler::destroy() {
     m_conn_handler->close();
   m_conn_handler = 0;
   m_handle_map.clear();
+  if (m_cache)
+    m_cache->reset();
   m_bad_handle_map.clear();
   m_session_id = 0;
   m_comm->close_socket(m_local_addr);
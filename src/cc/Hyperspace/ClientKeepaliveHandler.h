@@ -22,6 +22,7 @@
 #ifndef HYPERSPACE_CLIENTKEEPALIVEHANDLER_H
 #define HYPERSPACE_CLIENTKEEPALIVEHANDLER_H
 
+#include <Hyperspace/ClientCache.h>
 #include <Hyperspace/ClientConnectionHandler.h>
 #include <Hyperspace/ClientHandleState.h>
 
@@ -60,11 +61,16 @@ namespace Hyperspace {
       assert(iter == m_handle_map.end());
 #endif
       m_handle_map[handle_state->handle] = handle_state;
+      if (m_cache)
+        m_cache->add_handle(handle_state->handle, handle_state->normal_name,
+                            handle_state->event_mask);
     }
 
     void unregister_handle(uint64_t handle) {
       ScopedRecLock lock(m_mutex);
       m_handle_map.erase(handle);
+      if (m_cache)
+        m_cache->remove_handle(handle);
     }
 
     bool get_handle_state(uint64_t handle, ClientHandleStatePtr &handle_state) {
@@ -99,6 +105,7 @@ namespace Hyperspace {
     CommAddress m_local_addr;
     bool m_verbose;
     Session *m_session;
+    ClientCachePtr m_cache;
     uint64_t m_session_id;
     ClientConnectionHandlerPtr m_conn_handler;
     std::set<uint64_t> m_delivered_events;
@@ -59,6 +59,9 @@ Session::Session(Comm *comm, PropertiesPtr &cfg)
     m_hyperspace_port = cfg->get_i16("Hyperspace.Replica.Port");
     m_reconnect = cfg->get_bool("Hyperspace.Session.Reconnect"));
 
+  if (cfg->get_bool("Hyperspace.Client.Cache.Enable"))
+    m_cache = new ClientCache();
+
   if (m_reconnect)
     HT_INFO("Hyperspace session setup to reconnect");
 
@@ -312,6 +315,14 @@ bool Session::exists(const std::string &name, Timer *timer) {
 
   normalize_name(name, normal_name);
 
+  uint64_t generation = 0;
+  if (m_cache) {
+    bool exists;
+    if (m_cache->get_exists(normal_name, &exists))
+      return exists;
+    generation = m_cache->generation();
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_exists_request(normal_name));
 
  try_again:
@@ -328,6 +339,8 @@ bool Session::exists(const std::string &name, Timer *timer) {
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint8_t bval = decode_byte(&decode_ptr, &decode_remain);
+      if (m_cache)
+        m_cache->put_exists(generation, normal_name, bval != 0);
       return (bval == 0) ? false : true;
     }
   }
@@ -528,6 +541,21 @@ Session::attr_get(uint64_t handle, const std::string &attr,
                   DynamicBuffer &value, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+  uint64_t generation = 0;
+
+  if (get_cached_name(handle, normal_name)) {
+    bool exists;
+    if (m_cache->get_attr(normal_name, attr, &value, &exists)) {
+      if (!exists)
+        HT_THROWF(Error::HYPERSPACE_ATTR_NOT_FOUND,
+                  "Problem getting attribute '%s' of hyperspace file '%s'",
+                  attr.c_str(), normal_name.c_str());
+      return;
+    }
+    generation = m_cache->generation();
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_attr_get_request(handle, 0, attr));
 
  try_again:
@@ -541,12 +569,18 @@ Session::attr_get(uint64_t handle, const std::string &attr,
       String fname = "UNKNOWN";
       if (m_keepalive_handler_ptr->get_handle_state(handle, handle_state))
         fname = handle_state->normal_name.c_str();
-      HT_THROWF((int)Protocol::response_code(event_ptr.get()),
-                "Problem getting attribute '%s' of hyperspace file '%s'",
+      error = (int)Protocol::response_code(event_ptr.get());
+      if (error == Error::HYPERSPACE_ATTR_NOT_FOUND && !normal_name.empty())
+        m_cache->put_attr(generation, normal_name, attr, 0, 0, false);
+      HT_THROWF(error, "Problem getting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), fname.c_str());
     }
-    else
+    else {
       decode_value(event_ptr, value);
+      if (!normal_name.empty())
+        m_cache->put_attr(generation, normal_name, attr, value.base,
+                          value.fill(), true);
+    }
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -559,6 +593,22 @@ Session::attr_get(const std::string &name, const std::string &attr,
                   DynamicBuffer &value, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+  uint64_t generation = 0;
+
+  if (m_cache) {
+    bool exists;
+    normalize_name(name, normal_name);
+    if (m_cache->get_attr(normal_name, attr, &value, &exists)) {
+      if (!exists)
+        HT_THROWF(Error::HYPERSPACE_ATTR_NOT_FOUND,
+                  "Problem getting attribute '%s' of hyperspace file '%s'",
+                  attr.c_str(), name.c_str());
+      return;
+    }
+    generation = m_cache->generation();
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_attr_get_request(0, &name, attr));
 
  try_again:
@@ -568,12 +618,18 @@ Session::attr_get(const std::string &name, const std::string &attr,
   int error = send_message(cbuf_ptr, &sync_handler, timer);
   if (error == Error::OK) {
     if (!sync_handler.wait_for_reply(event_ptr)) {
-      HT_THROWF((int)Protocol::response_code(event_ptr.get()),
-                "Problem getting attribute '%s' of hyperspace file '%s'",
+      error = (int)Protocol::response_code(event_ptr.get());
+      if (error == Error::HYPERSPACE_ATTR_NOT_FOUND && m_cache)
+        m_cache->put_attr(generation, normal_name, attr, 0, 0, false);
+      HT_THROWF(error, "Problem getting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), name.c_str());
     }
-    else
+    else {
       decode_value(event_ptr, value);
+      if (m_cache)
+        m_cache->put_attr(generation, normal_name, attr, value.base,
+                          value.fill(), true);
+    }
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -659,6 +715,15 @@ Session::attr_exists(uint64_t handle, const std::string& attr, Timer *timer)
 {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+  uint64_t generation = 0;
+
+  if (get_cached_name(handle, normal_name)) {
+    bool exists;
+    if (m_cache->get_attr(normal_name, attr, 0, &exists))
+      return exists;
+    generation = m_cache->generation();
+  }
 
   CommBufPtr cbuf_ptr(Protocol::create_attr_exists_request(handle, attr));
 
@@ -676,6 +741,9 @@ Session::attr_exists(uint64_t handle, const std::string& attr, Timer *timer)
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint8_t bval = decode_byte(&decode_ptr, &decode_remain);
+      // Only non-existence can be cached since the value is not known
+      if (bval == 0 && !normal_name.empty())
+        m_cache->put_attr(generation, normal_name, attr, 0, 0, false);
       return (bval == 0) ? false : true;
     }
   }
@@ -689,6 +757,16 @@ Session::attr_exists(const std::string& name, const std::string& attr, Timer *ti
 {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+  uint64_t generation = 0;
+
+  if (m_cache) {
+    bool exists;
+    normalize_name(name, normal_name);
+    if (m_cache->get_attr(normal_name, attr, 0, &exists))
+      return exists;
+    generation = m_cache->generation();
+  }
 
   CommBufPtr cbuf_ptr(Protocol::create_attr_exists_request(name, attr));
 
@@ -706,6 +784,9 @@ Session::attr_exists(const std::string& name, const std::string& attr, Timer *ti
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint8_t bval = decode_byte(&decode_ptr, &decode_remain);
+      // Only non-existence can be cached since the value is not known
+      if (bval == 0 && !normal_name.empty())
+        m_cache->put_attr(generation, normal_name, attr, 0, 0, false);
       return (bval == 0) ? false : true;
     }
   }
@@ -791,6 +872,15 @@ Session::readdir(uint64_t handle, std::vector<DirEntry> &listing,
                  Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+  uint64_t generation = 0;
+
+  if (get_cached_name(handle, normal_name)) {
+    if (m_cache->get_listing(normal_name, listing))
+      return;
+    generation = m_cache->generation();
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_readdir_request(handle));
 
  try_again:
@@ -825,6 +915,8 @@ Session::readdir(uint64_t handle, std::vector<DirEntry> &listing,
         }
         listing.push_back(dentry);
       }
+      if (!normal_name.empty())
+        m_cache->put_listing(generation, normal_name, listing);
     }
   }
   else {
@@ -1150,6 +1242,14 @@ int Session::state_transition(int state) {
   ScopedLock lock(m_mutex);
   int old_state = m_state;
   m_state = state;
+  if (m_cache) {
+    // Notifications may be missed while not safe; handles are lost with
+    // the session
+    if (m_state == STATE_JEOPARDY)
+      m_cache->clear();
+    else if (m_state == STATE_DISCONNECTED || m_state == STATE_EXPIRED)
+      m_cache->reset();
+  }
   if (m_state == STATE_SAFE) {
     m_cond.notify_all();
     if (old_state == STATE_JEOPARDY) {
@@ -1359,6 +1459,15 @@ Session::send_message(CommBufPtr &cbuf_ptr, DispatchHandler *handler,
 }
 
 
+bool Session::get_cached_name(uint64_t handle, String &normal_name) {
+  ClientHandleStatePtr handle_state;
+  if (!m_cache ||
+      !m_keepalive_handler_ptr->get_handle_state(handle, handle_state))
+    return false;
+  normal_name = handle_state->normal_name;
+  return true;
+}
+
 void Session::normalize_name(const String &name, String &normal) {
 
   if (name == "/") {
@@ -22,6 +22,7 @@
 #ifndef HYPERSPACE_SESSION_H
 #define HYPERSPACE_SESSION_H
 
+#include <Hyperspace/ClientCache.h>
 #include <Hyperspace/ClientKeepaliveHandler.h>
 #include <Hyperspace/DirEntry.h>
 #include <Hyperspace/DirEntryAttr.h>
@@ -139,6 +140,13 @@ namespace Hyperspace {
    * Hyperspace.KeepAlive.Interval=1000
    * Hyperspace.GracePeriod=6000
    * </pre>
+   * <p>
+   * Unless <code>Hyperspace.Client.Cache.Enable</code> is set to false, the
+   * session keeps a ClientCache of attribute values, directory listings and
+   * existence checks for nodes that it holds open with event masks that
+   * would announce changes to that information.  Such lookups are served
+   * locally and invalidated by the event notifications delivered to the
+   * session.
    */
   class Session : public ReferenceCount {
 
@@ -671,6 +679,12 @@ namespace Hyperspace {
 
     void update_master_addr(const String &host);
 
+    /** Returns the client cache.
+     *
+     * @return Smart pointer to client cache (null if caching is disabled)
+     */
+    ClientCachePtr get_cache() { return m_cache; }
+
     /** Attempts to shutdown the Hyperspace server and destroys this session.
      *
      * @param timer maximum wait timer
@@ -689,6 +703,7 @@ namespace Hyperspace {
     int send_message(CommBufPtr &, DispatchHandler *, Timer *timer);
     void normalize_name(const std::string &name, std::string &normal);
     uint64_t open(ClientHandleStatePtr &, CommBufPtr &, Timer *timer);
+    bool get_cached_name(uint64_t handle, String &normal_name);
 
     Mutex                     m_mutex;
     boost::condition          m_cond;
@@ -710,6 +725,7 @@ namespace Hyperspace {
     Mutex                     m_callback_mutex;
     vector<String>            m_hyperspace_replicas;
     String                    m_hyperspace_master;
+    ClientCachePtr            m_cache;
   };
 
   typedef boost::intrusive_ptr<Session> SessionPtr;
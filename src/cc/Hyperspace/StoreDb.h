@@ -0,0 +1,132 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for StoreDb and StoreCursor.
+ * This file contains declarations for StoreDb and StoreCursor, the database
+ * and cursor interfaces through which BerkeleyDbFilesystem accesses its
+ * <i>namespace</i> and <i>state</i> databases, along with the adapters that
+ * forward them to BerkeleyDB.
+ */
+
+#ifndef HYPERSPACE_STOREDB_H
+#define HYPERSPACE_STOREDB_H
+
+#include <db_cxx.h>
+
+namespace Hyperspace {
+
+  /** @addtogroup Hyperspace
+   * @{
+   */
+
+  /** Cursor over a StoreDb.
+   * The methods have the same signatures, flags and return codes as the
+   * corresponding methods of BerkeleyDB's Dbc class.
+   */
+  class StoreCursor {
+  public:
+    virtual ~StoreCursor() { }
+    virtual int get(Dbt *key, Dbt *data, uint32_t flags) = 0;
+    virtual int put(Dbt *key, Dbt *data, uint32_t flags) = 0;
+    virtual int del(uint32_t flags) = 0;
+    virtual int close() = 0;
+  };
+
+  /** Database used by BerkeleyDbFilesystem.
+   * The methods have the same signatures, flags and return codes as the
+   * corresponding methods of BerkeleyDB's Db class, which allows the
+   * filesystem logic to run unchanged on top of a different store.  Errors
+   * are reported by throwing DbException.
+   */
+  class StoreDb {
+  public:
+    virtual ~StoreDb() { }
+    virtual int get(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) = 0;
+    virtual int put(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) = 0;
+    virtual int del(DbTxn *txn, Dbt *key, uint32_t flags) = 0;
+    virtual int exists(DbTxn *txn, Dbt *key, uint32_t flags) = 0;
+
+    /** Creates a cursor.
+     * The cursor must be closed with StoreCursor::close() and then
+     * deleted.
+     * @param txn BerkeleyDB transaction
+     * @param cursorp Return parameter to hold the new cursor
+     * @param flags BerkeleyDB cursor flags
+     * @return 0 on success
+     */
+    virtual int cursor(DbTxn *txn, StoreCursor **cursorp, uint32_t flags) = 0;
+  };
+
+  /** StoreCursor forwarding to a BerkeleyDB cursor. */
+  class BdbStoreCursor : public StoreCursor {
+  public:
+    BdbStoreCursor(Dbc *dbc) : m_dbc(dbc) { }
+    virtual ~BdbStoreCursor() { }
+    virtual int get(Dbt *key, Dbt *data, uint32_t flags) {
+      return m_dbc->get(key, data, flags);
+    }
+    virtual int put(Dbt *key, Dbt *data, uint32_t flags) {
+      return m_dbc->put(key, data, flags);
+    }
+    virtual int del(uint32_t flags) { return m_dbc->del(flags); }
+    virtual int close() {
+      Dbc *dbc = m_dbc;
+      m_dbc = 0;
+      return dbc ? dbc->close() : 0;
+    }
+  private:
+    /// BerkeleyDB cursor
+    Dbc *m_dbc;
+  };
+
+  /** StoreDb forwarding to a BerkeleyDB database handle. */
+  class BdbStoreDb : public StoreDb {
+  public:
+    BdbStoreDb(Db *db) : m_db(db) { }
+    virtual int get(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) {
+      return m_db->get(txn, key, data, flags);
+    }
+    virtual int put(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) {
+      return m_db->put(txn, key, data, flags);
+    }
+    virtual int del(DbTxn *txn, Dbt *key, uint32_t flags) {
+      return m_db->del(txn, key, flags);
+    }
+    virtual int exists(DbTxn *txn, Dbt *key, uint32_t flags) {
+      return m_db->exists(txn, key, flags);
+    }
+    virtual int cursor(DbTxn *txn, StoreCursor **cursorp, uint32_t flags) {
+      Dbc *dbc = 0;
+      int ret = m_db->cursor(txn, &dbc, flags);
+      *cursorp = new BdbStoreCursor(dbc);
+      return ret;
+    }
+  private:
+    /// BerkeleyDB database handle
+    Db *m_db;
+  };
+
+  /** @} */
+
+} // namespace Hyperspace
+
+#endif // HYPERSPACE_STOREDB_H
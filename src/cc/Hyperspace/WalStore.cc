@@ -0,0 +1,436 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for WalStore.
+ * This file contains definitions for WalStore, an embedded key/value store
+ * made up of an in-memory ordered map, an append-only write-ahead log and
+ * periodic snapshots.
+ */
+
+#include <Common/Compat.h>
+
+#include "WalStore.h"
+
+#include <Common/Checksum.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Error.h>
+#include <Common/FileUtils.h>
+#include <Common/Logger.h>
+#include <Common/Serialization.h>
+#include <Common/ScopeGuard.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hyperspace;
+using namespace Serialization;
+
+namespace {
+
+  /// Size of record and snapshot header (checksum + length)
+  const size_t HEADER_SIZE = 8;
+
+  const char *SNAPSHOT_NAME = "snapshot";
+
+  void delete_buffer(char *buf) {
+    delete [] buf;
+  }
+
+  /** Writes a buffer to a new file and syncs it to disk.
+   * @param fname Name of file
+   * @param buf Buffer to write
+   * @param len Length of buffer
+   */
+  void write_file_synced(const String &fname, const uint8_t *buf, size_t len) {
+    int fd = ::open(fname.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd < 0)
+      HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to create %s - %s",
+                fname.c_str(), strerror(errno));
+    if (FileUtils::write(fd, buf, len) != (ssize_t)len || fsync(fd) != 0) {
+      int saved_errno = errno;
+      ::close(fd);
+      HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Problem writing %s - %s",
+                fname.c_str(), strerror(saved_errno));
+    }
+    ::close(fd);
+  }
+
+}
+
+
+bool WalStore::Txn::get(const String &key, String &value) {
+  for (auto iter = m_ops.rbegin(); iter != m_ops.rend(); ++iter) {
+    if (iter->key == key) {
+      if (iter->type == DEL)
+        return false;
+      value = iter->value;
+      return true;
+    }
+  }
+  return m_store->get(key, value);
+}
+
+
+bool WalStore::Txn::seek(const String &key, KeyValue &kv) {
+  String from = key;
+
+  while (true) {
+    // Latest buffered update of the smallest buffered key >= from
+    const Op *op = 0;
+    for (auto &o : m_ops) {
+      if (o.key >= from && (op == 0 || o.key <= op->key))
+        op = &o;
+    }
+    KeyValue stored;
+    bool have_stored = m_store->seek(from, stored);
+    if (op && (!have_stored || op->key <= stored.first)) {
+      if (op->type == PUT) {
+        kv.first = op->key;
+        kv.second = op->value;
+        return true;
+      }
+      // Deleted in this transaction, continue after it
+      from = op->key;
+      from.push_back('\0');
+      continue;
+    }
+    if (!have_stored)
+      return false;
+    kv = stored;
+    return true;
+  }
+}
+
+
+WalStore::WalStore(const String &dir, uint64_t snapshot_threshold, bool sync)
+  : m_dir(dir), m_snapshot_threshold(snapshot_threshold), m_sync(sync),
+    m_log_fd(-1), m_log_num(0), m_log_size(0), m_snapshot_log(0),
+    m_failed(false) {
+
+  if (!FileUtils::exists(m_dir) && !FileUtils::mkdirs(m_dir))
+    HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to create directory %s",
+              m_dir.c_str());
+
+  uint32_t first_log = m_snapshot_log = load_snapshot();
+
+  std::vector<struct dirent> listing;
+  std::vector<uint32_t> logs;
+  FileUtils::readdir(m_dir, "log\\.[0-9]+", listing);
+  for (auto &de : listing)
+    logs.push_back((uint32_t)strtoul(de.d_name + 4, 0, 10));
+  std::sort(logs.begin(), logs.end());
+
+  m_log_num = first_log;
+  for (size_t i=0; i<logs.size(); i++) {
+    if (logs[i] < first_log) {
+      FileUtils::unlink(log_name(logs[i]));
+      continue;
+    }
+    replay_log(log_name(logs[i]), i == logs.size()-1);
+    m_log_num = logs[i] + 1;
+  }
+
+  ScopedLock log_lock(m_log_mutex);
+  open_log();
+
+  HT_INFOF("Loaded %llu keys from %s, logging to %s", (Llu)m_map.size(),
+           m_dir.c_str(), log_name(m_log_num).c_str());
+}
+
+
+WalStore::~WalStore() {
+  if (m_log_fd >= 0)
+    ::close(m_log_fd);
+}
+
+
+bool WalStore::get(const String &key, String &value) {
+  ScopedLock lock(m_mutex);
+  auto iter = m_map.find(key);
+  if (iter == m_map.end())
+    return false;
+  value = iter->second;
+  return true;
+}
+
+
+bool WalStore::exists(const String &key) {
+  ScopedLock lock(m_mutex);
+  return m_map.find(key) != m_map.end();
+}
+
+
+bool WalStore::seek(const String &key, KeyValue &kv) {
+  ScopedLock lock(m_mutex);
+  auto iter = m_map.lower_bound(key);
+  if (iter == m_map.end())
+    return false;
+  kv = *iter;
+  return true;
+}
+
+
+void WalStore::scan(const String &prefix, std::vector<KeyValue> &result) {
+  ScopedLock lock(m_mutex);
+  for (auto iter = m_map.lower_bound(prefix);
+       iter != m_map.end() && iter->first.compare(0, prefix.length(), prefix) == 0;
+       ++iter)
+    result.push_back(*iter);
+}
+
+
+void WalStore::commit(Txn &txn) {
+  bool do_snapshot;
+
+  if (txn.m_ops.empty())
+    return;
+
+  size_t payload_len = 4;
+  for (auto &op : txn.m_ops) {
+    payload_len += 1 + encoded_length_vstr(op.key);
+    if (op.type == Txn::PUT)
+      payload_len += encoded_length_vstr(op.value);
+  }
+
+  DynamicBuffer buf(HEADER_SIZE + payload_len);
+  uint8_t *payload = buf.base + HEADER_SIZE;
+  buf.ptr = payload;
+  encode_i32(&buf.ptr, txn.m_ops.size());
+  for (auto &op : txn.m_ops) {
+    encode_i8(&buf.ptr, op.type);
+    encode_vstr(&buf.ptr, op.key);
+    if (op.type == Txn::PUT)
+      encode_vstr(&buf.ptr, op.value);
+  }
+  HT_ASSERT(buf.fill() == HEADER_SIZE + payload_len);
+  uint8_t *ptr = buf.base;
+  encode_i32(&ptr, fletcher32(payload, payload_len));
+  encode_i32(&ptr, payload_len);
+
+  {
+    ScopedLock log_lock(m_log_mutex);
+    if (m_failed)
+      HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Log %s failed, refusing commit",
+                log_name(m_log_num).c_str());
+    if (FileUtils::write(m_log_fd, buf.base, buf.fill()) != (ssize_t)buf.fill()) {
+      int saved_errno = errno;
+      // Drop the partial record so later commits are not appended after it
+      if (ftruncate(m_log_fd, m_log_size) != 0)
+        m_failed = true;
+      HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Problem writing %s - %s",
+                log_name(m_log_num).c_str(), strerror(saved_errno));
+    }
+    if (m_sync && fsync(m_log_fd) != 0) {
+      int saved_errno = errno;
+      // After a failed fsync, the state of earlier records on disk is
+      // unknown as well
+      if (ftruncate(m_log_fd, m_log_size) != 0)
+        HT_WARNF("Unable to truncate %s - %s", log_name(m_log_num).c_str(),
+                 strerror(errno));
+      m_failed = true;
+      HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Problem syncing %s - %s",
+                log_name(m_log_num).c_str(), strerror(saved_errno));
+    }
+    m_log_size += buf.fill();
+    {
+      ScopedLock lock(m_mutex);
+      apply(payload, payload_len);
+    }
+    do_snapshot = m_log_size >= m_snapshot_threshold;
+  }
+
+  txn.clear();
+
+  if (do_snapshot)
+    snapshot();
+}
+
+
+void WalStore::snapshot() {
+  ScopedLock snapshot_lock(m_snapshot_mutex);
+  DynamicBuffer buf;
+  uint32_t first_log;
+
+  {
+    ScopedLock log_lock(m_log_mutex);
+
+    // Nothing has been logged since the last snapshot
+    if (m_log_size == 0 && m_log_num == m_snapshot_log)
+      return;
+
+    {
+      ScopedLock lock(m_mutex);
+      size_t body_len = 4 + 8;
+      for (auto &kv : m_map)
+        body_len += encoded_length_vstr(kv.first) +
+          encoded_length_vstr(kv.second);
+      buf.reserve(HEADER_SIZE + body_len);
+      buf.ptr = buf.base + HEADER_SIZE;
+      encode_i32(&buf.ptr, m_log_num + 1);
+      encode_i64(&buf.ptr, m_map.size());
+      for (auto &kv : m_map) {
+        encode_vstr(&buf.ptr, kv.first);
+        encode_vstr(&buf.ptr, kv.second);
+      }
+    }
+
+    // Subsequent commits go to a new log which the snapshot does not cover
+    ::close(m_log_fd);
+    m_log_num++;
+    open_log();
+    first_log = m_log_num;
+    m_snapshot_log = first_log;
+  }
+
+  size_t body_len = buf.fill() - HEADER_SIZE;
+  uint8_t *ptr = buf.base;
+  encode_i32(&ptr, fletcher32(buf.base + HEADER_SIZE, body_len));
+  encode_i32(&ptr, body_len);
+
+  String fname = m_dir + "/" + SNAPSHOT_NAME;
+  write_file_synced(fname + ".tmp", buf.base, buf.fill());
+  if (!FileUtils::rename(fname + ".tmp", fname))
+    HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to rename %s.tmp to %s",
+              fname.c_str(), fname.c_str());
+
+  std::vector<struct dirent> listing;
+  FileUtils::readdir(m_dir, "log\\.[0-9]+", listing);
+  for (auto &de : listing) {
+    if ((uint32_t)strtoul(de.d_name + 4, 0, 10) < first_log)
+      FileUtils::unlink(m_dir + "/" + de.d_name);
+  }
+
+  HT_INFOF("Wrote snapshot of %s (%llu bytes), logging to %s", m_dir.c_str(),
+           (Llu)buf.fill(), log_name(first_log).c_str());
+}
+
+
+uint32_t WalStore::load_snapshot() {
+  String fname = m_dir + "/" + SNAPSHOT_NAME;
+  off_t len;
+
+  if (!FileUtils::exists(fname))
+    return 0;
+
+  char *contents = FileUtils::file_to_buffer(fname, &len);
+  if (contents == 0)
+    HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to read %s", fname.c_str());
+  HT_ON_SCOPE_EXIT(&delete_buffer, contents);
+
+  const uint8_t *ptr = (const uint8_t *)contents;
+  size_t remain = len;
+  if (remain < HEADER_SIZE)
+    HT_THROWF(Error::BAD_FORMAT, "Truncated snapshot %s", fname.c_str());
+  uint32_t checksum = decode_i32(&ptr, &remain);
+  uint32_t body_len = decode_i32(&ptr, &remain);
+  if (body_len != remain || fletcher32(ptr, body_len) != checksum)
+    HT_THROWF(Error::CHECKSUM_MISMATCH, "Corrupt snapshot %s", fname.c_str());
+
+  uint32_t first_log = decode_i32(&ptr, &remain);
+  uint64_t count = decode_i64(&ptr, &remain);
+  uint32_t klen, vlen;
+  ScopedLock lock(m_mutex);
+  for (uint64_t i=0; i<count; i++) {
+    const char *key = decode_vstr(&ptr, &remain, &klen);
+    const char *value = decode_vstr(&ptr, &remain, &vlen);
+    m_map[String(key, klen)] = String(value, vlen);
+  }
+  return first_log;
+}
+
+
+void WalStore::replay_log(const String &fname, bool last) {
+  off_t len;
+  char *contents = FileUtils::file_to_buffer(fname, &len);
+  if (contents == 0)
+    HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to read %s", fname.c_str());
+  HT_ON_SCOPE_EXIT(&delete_buffer, contents);
+
+  const uint8_t *base = (const uint8_t *)contents;
+  size_t offset = 0;
+  ScopedLock lock(m_mutex);
+  while (offset < (size_t)len) {
+    const uint8_t *ptr = base + offset;
+    size_t remain = len - offset;
+    bool valid = false;
+    uint32_t checksum = 0, payload_len = 0;
+    if (remain >= HEADER_SIZE) {
+      checksum = decode_i32(&ptr, &remain);
+      payload_len = decode_i32(&ptr, &remain);
+      valid = payload_len <= remain && fletcher32(ptr, payload_len) == checksum;
+    }
+    if (!valid) {
+      if (!last)
+        HT_THROWF(Error::CHECKSUM_MISMATCH, "Corrupt record at offset %llu "
+                  "of %s", (Llu)offset, fname.c_str());
+      HT_WARNF("Truncating torn record at offset %llu of %s", (Llu)offset,
+               fname.c_str());
+      if (::truncate(fname.c_str(), offset) != 0)
+        HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to truncate %s - %s",
+                  fname.c_str(), strerror(errno));
+      break;
+    }
+    apply(ptr, payload_len);
+    offset += HEADER_SIZE + payload_len;
+  }
+}
+
+
+void WalStore::apply(const uint8_t *buf, size_t len) {
+  const uint8_t *ptr = buf;
+  size_t remain = len;
+  uint32_t count = decode_i32(&ptr, &remain);
+  uint32_t klen, vlen;
+
+  for (uint32_t i=0; i<count; i++) {
+    uint8_t type = decode_i8(&ptr, &remain);
+    const char *key = decode_vstr(&ptr, &remain, &klen);
+    if (type == Txn::PUT) {
+      const char *value = decode_vstr(&ptr, &remain, &vlen);
+      m_map[String(key, klen)] = String(value, vlen);
+    }
+    else if (type == Txn::DEL)
+      m_map.erase(String(key, klen));
+    else
+      HT_THROWF(Error::BAD_FORMAT, "Unknown WalStore operation %d", (int)type);
+  }
+}
+
+
+void WalStore::open_log() {
+  String fname = log_name(m_log_num);
+  m_log_fd = ::open(fname.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_APPEND, 0644);
+  if (m_log_fd < 0)
+    HT_THROWF(Error::HYPERSPACE_IO_ERROR, "Unable to create %s - %s",
+              fname.c_str(), strerror(errno));
+  m_log_size = 0;
+}
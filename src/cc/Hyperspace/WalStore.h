@@ -0,0 +1,294 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for WalStore.
+ * This file contains declarations for WalStore, an embedded key/value store
+ * made up of an in-memory ordered map, an append-only write-ahead log and
+ * periodic snapshots.
+ */
+
+#ifndef HYPERSPACE_WALSTORE_H
+#define HYPERSPACE_WALSTORE_H
+
+#include <Common/Mutex.h>
+#include <Common/ReferenceCount.h>
+#include <Common/String.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace Hyperspace {
+
+  using namespace Hypertable;
+
+  /** @addtogroup Hyperspace
+   * @{
+   */
+
+  /** Embedded key/value store backed by a write-ahead log and snapshots.
+   * All keys and values are held in an in-memory ordered map, so reads never
+   * touch the disk.  Updates are grouped into transactions (Txn) which are
+   * made durable by appending a single checksummed record to the current log
+   * file before being applied to the map, so a transaction is either
+   * recovered in its entirety or not at all.
+   *
+   * Once the log grows beyond the snapshot threshold, the map is serialized
+   * and the log is rotated while holding the store locks; the (slow) write
+   * of the snapshot file and removal of the obsolete logs happens after the
+   * locks are dropped, so writers are not stalled for the duration of the
+   * snapshot as they are by a BerkeleyDB checkpoint.
+   *
+   * On-disk layout of the store directory:
+   *   - <code>snapshot</code> - Most recent snapshot, which records the
+   *     number of the first log file that is not reflected in it
+   *   - <code>log.N</code> - Log files, replayed in ascending order of N
+   *
+   * Commits are serialized; the store does not detect conflicts between
+   * concurrent read-modify-write transactions, so callers must serialize
+   * those themselves.
+   */
+  class WalStore : public ReferenceCount {
+  public:
+
+    /// Key/value pair
+    typedef std::pair<String, String> KeyValue;
+
+    /** Transaction.
+     * Buffers updates until passed to WalStore::commit().  Reads issued
+     * through the transaction see its own buffered updates.
+     */
+    class Txn {
+    public:
+
+      /** Constructor.
+       * @param store Store against which the transaction is run
+       */
+      Txn(WalStore *store) : m_store(store) { }
+
+      /** Buffers an insert or overwrite of <code>key</code>.
+       * @param key Key
+       * @param value Value
+       */
+      void put(const String &key, const String &value) {
+        m_ops.push_back(Op(PUT, key, value));
+      }
+
+      /** Buffers a delete of <code>key</code>.
+       * @param key Key
+       */
+      void del(const String &key) {
+        m_ops.push_back(Op(DEL, key, String()));
+      }
+
+      /** Looks up a key, taking buffered updates into account.
+       * @param key Key
+       * @param value Filled in with the value if found
+       * @return <i>true</i> if key exists, <i>false</i> otherwise
+       */
+      bool get(const String &key, String &value);
+
+      /** Finds the first pair whose key is not less than <code>key</code>,
+       * taking buffered updates into account.
+       * @param key Key to seek to
+       * @param kv Filled in with the pair if found
+       * @return <i>true</i> if found, <i>false</i> if past the last key
+       */
+      bool seek(const String &key, KeyValue &kv);
+
+      /** Returns number of buffered updates.
+       * @return Number of buffered updates
+       */
+      size_t size() const { return m_ops.size(); }
+
+      /** Discards buffered updates. */
+      void clear() { m_ops.clear(); }
+
+    private:
+      friend class WalStore;
+
+      /// Update operation type
+      enum { PUT = 1, DEL = 2 };
+
+      /// Buffered update
+      struct Op {
+        Op(uint8_t t, const String &k, const String &v)
+          : type(t), key(k), value(v) { }
+        uint8_t type;
+        String key;
+        String value;
+      };
+
+      /// Store against which the transaction is run
+      WalStore *m_store;
+
+      /// Buffered updates in issue order
+      std::vector<Op> m_ops;
+    };
+
+    /** Constructor.
+     * Loads the latest snapshot found in <code>dir</code>, replays the log
+     * files written after it and starts a new log file.  A torn record at
+     * the end of the last log (crash during append) is discarded.
+     * @param dir Directory holding the store files (created if missing)
+     * @param snapshot_threshold Log size in bytes that triggers a snapshot
+     * @param sync Flag indicating if commits are fsync'ed before returning
+     */
+    WalStore(const String &dir, uint64_t snapshot_threshold=16*1024*1024,
+             bool sync=true);
+
+    /** Destructor.  Closes the current log file. */
+    ~WalStore();
+
+    /** Looks up a key.
+     * @param key Key
+     * @param value Filled in with the value if found
+     * @return <i>true</i> if key exists, <i>false</i> otherwise
+     */
+    bool get(const String &key, String &value);
+
+    /** Checks if a key exists.
+     * @param key Key
+     * @return <i>true</i> if key exists, <i>false</i> otherwise
+     */
+    bool exists(const String &key);
+
+    /** Finds the first pair whose key is not less than <code>key</code>.
+     * @param key Key to seek to
+     * @param kv Filled in with the pair if found
+     * @return <i>true</i> if found, <i>false</i> if past the last key
+     */
+    bool seek(const String &key, KeyValue &kv);
+
+    /** Fetches all pairs whose key starts with <code>prefix</code>.
+     * @param prefix Key prefix
+     * @param result Filled in with matching pairs in key order
+     */
+    void scan(const String &prefix, std::vector<KeyValue> &result);
+
+    /** Commits a transaction.
+     * Appends the transaction to the log (and syncs it if enabled), then
+     * applies it to the in-memory map and clears it.  If the log has grown
+     * beyond the snapshot threshold, a snapshot is taken before returning.
+     * If the append or sync fails, the log is truncated back to its last
+     * good record so that later commits are not appended after a torn one.
+     * If that is not possible, or the sync failed, the store is marked
+     * failed and refuses all further commits.
+     * @param txn Transaction to commit
+     */
+    void commit(Txn &txn);
+
+    /** Writes a snapshot and removes the log files it supersedes. */
+    void snapshot();
+
+    /** Returns number of keys in the store.
+     * @return Number of keys
+     */
+    size_t size() {
+      ScopedLock lock(m_mutex);
+      return m_map.size();
+    }
+
+    /** Returns number of bytes in the current log file.
+     * @return Size of current log file
+     */
+    uint64_t log_size() {
+      ScopedLock lock(m_log_mutex);
+      return m_log_size;
+    }
+
+  private:
+
+    /** Loads snapshot file, if any.
+     * @return Number of first log file not reflected in snapshot
+     */
+    uint32_t load_snapshot();
+
+    /** Replays a log file into the map.
+     * @param fname Log file name
+     * @param last Flag indicating that this is the last log file, in which
+     * case a torn trailing record is truncated rather than treated as an error
+     */
+    void replay_log(const String &fname, bool last);
+
+    /** Applies a decoded transaction payload to the map.
+     * @param buf Payload
+     * @param len Length of payload
+     */
+    void apply(const uint8_t *buf, size_t len);
+
+    /** Opens a new log file #m_log_num, requires #m_log_mutex to be held. */
+    void open_log();
+
+    /** Returns full pathname of log file.
+     * @param num Log file number
+     * @return Log file pathname
+     */
+    String log_name(uint32_t num) {
+      return format("%s/log.%u", m_dir.c_str(), (unsigned)num);
+    }
+
+    /// Store directory
+    String m_dir;
+
+    /// Log size that triggers a snapshot
+    uint64_t m_snapshot_threshold;
+
+    /// Flag indicating if commits are synced to disk
+    bool m_sync;
+
+    /// %Mutex protecting #m_map
+    Mutex m_mutex;
+
+    /// %Mutex serializing log appends and log rotation
+    Mutex m_log_mutex;
+
+    /// %Mutex serializing snapshots
+    Mutex m_snapshot_mutex;
+
+    /// In-memory copy of store contents
+    std::map<String, String> m_map;
+
+    /// Current log file descriptor
+    int m_log_fd;
+
+    /// Current log file number
+    uint32_t m_log_num;
+
+    /// Bytes written to current log file
+    uint64_t m_log_size;
+
+    /// Number of first log file not covered by the last snapshot
+    uint32_t m_snapshot_log;
+
+    /// Set when the log can no longer be appended to safely
+    bool m_failed;
+  };
+
+  /// Smart pointer to WalStore
+  typedef intrusive_ptr<WalStore> WalStorePtr;
+
+  /** @}*/
+
+}
+
+#endif // HYPERSPACE_WALSTORE_H
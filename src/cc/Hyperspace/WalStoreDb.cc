@@ -0,0 +1,313 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for WalStoreDb and WalDbTxn.
+ * This file contains definitions for WalStoreDb, a StoreDb implementation
+ * on top of WalStore, and WalDbTxn, the transaction that groups the updates
+ * made through it.
+ */
+
+#include <Common/Compat.h>
+
+#include "WalStoreDb.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  /// Returns contents of a Dbt as a string
+  String dbt_str(const Dbt *dbt) {
+    return String((const char *)dbt->get_data(), dbt->get_size());
+  }
+
+  /// Returns key following <code>key</code> in sort order
+  String successor(const String &key) {
+    String next = key;
+    next.push_back('\0');
+    return next;
+  }
+
+}
+
+namespace Hyperspace {
+
+  /** StoreCursor over a WalStoreDb.
+   * The position of the cursor is the stored key of the current entry, so
+   * the cursor stays valid across updates made through the same
+   * transaction.
+   */
+  class WalStoreCursor : public StoreCursor {
+  public:
+
+    WalStoreCursor(WalStoreDb *db) : m_db(db), m_positioned(false) { }
+
+    virtual int get(Dbt *key, Dbt *data, uint32_t flags) {
+      WalStore::KeyValue kv;
+      String raw;
+
+      switch (flags) {
+      case DB_SET:
+        raw = dbt_str(key);
+        if (!m_db->find(raw, raw, kv))
+          return DB_NOTFOUND;
+        m_current = kv.first;
+        m_positioned = true;
+        return WalStoreDb::fill(data, kv.second, m_data_buf);
+
+      case DB_GET_BOTH:
+        {
+          raw = dbt_str(key);
+          String value = dbt_str(data);
+          String from = raw;
+          while (m_db->find(raw, from, kv)) {
+            if (kv.second == value) {
+              m_current = kv.first;
+              m_positioned = true;
+              return 0;
+            }
+            from = successor(kv.first);
+          }
+        }
+        return DB_NOTFOUND;
+
+      case DB_SET_RANGE:
+        if (!m_db->m_txn.seek(dbt_str(key), kv))
+          return DB_NOTFOUND;
+        break;
+
+      case DB_NEXT:
+        if (!m_db->m_txn.seek(m_positioned ? successor(m_current) : String(),
+                              kv))
+          return DB_NOTFOUND;
+        break;
+
+      case DB_NEXT_DUP:
+        check_positioned();
+        if (!m_db->find(m_db->raw_key(m_current), successor(m_current), kv))
+          return DB_NOTFOUND;
+        break;
+
+      default:
+        throw DbException("Unsupported WalStoreDb cursor get flags", EINVAL);
+      }
+
+      m_current = kv.first;
+      m_positioned = true;
+      int ret = WalStoreDb::fill(key, m_db->raw_key(kv.first), m_key_buf);
+      if (ret != 0)
+        return ret;
+      return WalStoreDb::fill(data, kv.second, m_data_buf);
+    }
+
+    virtual int put(Dbt *key, Dbt *data, uint32_t flags) {
+      if (flags == DB_KEYLAST) {
+        String raw = dbt_str(key);
+        m_current = m_db->m_dup ? m_db->new_key(raw) : raw;
+        m_positioned = true;
+      }
+      else if (flags == DB_CURRENT)
+        check_positioned();
+      else
+        throw DbException("Unsupported WalStoreDb cursor put flags", EINVAL);
+      m_db->m_txn.put(m_current, dbt_str(data));
+      return 0;
+    }
+
+    virtual int del(uint32_t flags) {
+      check_positioned();
+      m_db->m_txn.del(m_current);
+      return 0;
+    }
+
+    virtual int close() { return 0; }
+
+  private:
+
+    void check_positioned() {
+      if (!m_positioned)
+        throw DbException("WalStoreDb cursor not positioned", EINVAL);
+    }
+
+    /// Database the cursor is iterating over
+    WalStoreDb *m_db;
+
+    /// Flag indicating if cursor refers to an entry
+    bool m_positioned;
+
+    /// Stored key of current entry
+    String m_current;
+
+    /// Returned key memory for Dbts without memory flags
+    String m_key_buf;
+
+    /// Returned data memory for Dbts without memory flags
+    String m_data_buf;
+  };
+
+}
+
+
+int WalStoreDb::get(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) {
+  WalStore::KeyValue kv;
+  String raw = dbt_str(key);
+  if (flags != 0)
+    throw DbException("Unsupported WalStoreDb get flags", EINVAL);
+  if (!find(raw, raw, kv))
+    return DB_NOTFOUND;
+  return fill(data, kv.second, m_data_buf);
+}
+
+
+int WalStoreDb::put(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags) {
+  WalStore::KeyValue kv;
+  String raw = dbt_str(key);
+  if (flags == DB_NOOVERWRITE) {
+    if (find(raw, raw, kv))
+      return DB_KEYEXIST;
+  }
+  else if (flags != 0)
+    throw DbException("Unsupported WalStoreDb put flags", EINVAL);
+  // Like Db::put(), adds a new duplicate to the end of the set
+  m_txn.put(m_dup ? new_key(raw) : raw, dbt_str(data));
+  return 0;
+}
+
+
+int WalStoreDb::del(DbTxn *txn, Dbt *key, uint32_t flags) {
+  WalStore::KeyValue kv;
+  String raw = dbt_str(key);
+  String from = raw;
+  int ret = DB_NOTFOUND;
+  while (find(raw, from, kv)) {
+    m_txn.del(kv.first);
+    from = successor(kv.first);
+    ret = 0;
+  }
+  return ret;
+}
+
+
+int WalStoreDb::exists(DbTxn *txn, Dbt *key, uint32_t flags) {
+  WalStore::KeyValue kv;
+  String raw = dbt_str(key);
+  return find(raw, raw, kv) ? 0 : DB_NOTFOUND;
+}
+
+
+int WalStoreDb::cursor(DbTxn *txn, StoreCursor **cursorp, uint32_t flags) {
+  *cursorp = new WalStoreCursor(this);
+  return 0;
+}
+
+
+String WalStoreDb::new_key(const String &raw) {
+  uint64_t seq = ++(*m_next_seq);
+  String key = raw;
+  for (int shift = 56; shift >= 0; shift -= 8)
+    key.push_back((char)((seq >> shift) & 0xff));
+  return key;
+}
+
+
+bool WalStoreDb::find(const String &raw, const String &from,
+                      WalStore::KeyValue &kv) {
+  String pos = from;
+  while (m_txn.seek(pos, kv)) {
+    // Keys prefixed with raw are contiguous, stop once past them
+    if (kv.first.compare(0, raw.length(), raw) != 0)
+      return false;
+    if (!m_dup)
+      return kv.first.length() == raw.length();
+    // Other keys may sort between duplicates of raw (e.g. raw + "x"), but
+    // only a duplicate of raw is exactly 8 bytes longer than it
+    if (kv.first.length() == raw.length() + 8)
+      return true;
+    pos = successor(kv.first);
+  }
+  return false;
+}
+
+
+int WalStoreDb::fill(Dbt *dbt, const String &value, String &owned) {
+  uint32_t size = value.length();
+  uint32_t flags = dbt->get_flags();
+
+  if (flags & DB_DBT_USERMEM) {
+    dbt->set_size(size);
+    if (size > dbt->get_ulen())
+      return DB_BUFFER_SMALL;
+    memcpy(dbt->get_data(), value.data(), size);
+  }
+  else if (flags & (DB_DBT_MALLOC|DB_DBT_REALLOC)) {
+    void *data = (flags & DB_DBT_REALLOC) ?
+      realloc(dbt->get_data(), size ? size : 1) : malloc(size ? size : 1);
+    if (data == 0)
+      throw DbException("Out of memory", ENOMEM);
+    memcpy(data, value.data(), size);
+    dbt->set_data(data);
+    dbt->set_size(size);
+  }
+  else {
+    owned = value;
+    dbt->set_data((void *)owned.data());
+    dbt->set_size(size);
+  }
+  return 0;
+}
+
+
+WalDbTxn::WalDbTxn(RecMutex &mutex, WalStore *namespace_store,
+                   WalStore *state_store, uint64_t *next_seq)
+  : m_lock(mutex), m_namespace_store(namespace_store),
+    m_state_store(state_store), m_namespace_txn(namespace_store),
+    m_state_txn(state_store), m_namespace_db(m_namespace_txn, false, next_seq),
+    m_state_db(m_state_txn, true, next_seq) {
+}
+
+
+void WalDbTxn::commit() {
+  try {
+    if (m_namespace_txn.size())
+      m_namespace_store->commit(m_namespace_txn);
+    if (m_state_txn.size())
+      m_state_store->commit(m_state_txn);
+  }
+  catch (...) {
+    abort();
+    throw;
+  }
+  if (m_lock.owns_lock())
+    m_lock.unlock();
+}
+
+
+void WalDbTxn::abort() {
+  m_namespace_txn.clear();
+  m_state_txn.clear();
+  if (m_lock.owns_lock())
+    m_lock.unlock();
+}
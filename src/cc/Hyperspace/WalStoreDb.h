@@ -0,0 +1,195 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for WalStoreDb and WalDbTxn.
+ * This file contains declarations for WalStoreDb, a StoreDb implementation
+ * on top of WalStore, and WalDbTxn, the transaction that groups the updates
+ * made through it.
+ */
+
+#ifndef HYPERSPACE_WALSTOREDB_H
+#define HYPERSPACE_WALSTOREDB_H
+
+#include <Hyperspace/StoreDb.h>
+#include <Hyperspace/WalStore.h>
+
+#include <Common/Mutex.h>
+#include <Common/String.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace Hyperspace {
+
+  /** @addtogroup Hyperspace
+   * @{
+   */
+
+  /** StoreDb implementation on top of WalStore.
+   * All access goes through a WalStore::Txn, so reads see the updates
+   * buffered in the same transaction.  Output Dbts are filled in according
+   * to their flags (DB_DBT_MALLOC, DB_DBT_REALLOC or DB_DBT_USERMEM);
+   * otherwise they point into memory owned by the database or cursor object
+   * which stays valid until its next call.
+   *
+   * A database opened with <code>dup</code> set emulates BerkeleyDB's
+   * unsorted duplicates (DB_DUP) as used by the <i>state</i> database:
+   * each duplicate is stored under the raw key followed by an 8-byte
+   * big-endian sequence number, so duplicates of a key are kept in insertion
+   * order.
+   */
+  class WalStoreDb : public StoreDb {
+  public:
+
+    /** Constructor.
+     * @param txn Transaction through which the store is accessed
+     * @param dup Emulate unsorted duplicates
+     * @param next_seq Duplicate sequence number counter, shared by all
+     * transactions against the same store
+     */
+    WalStoreDb(WalStore::Txn &txn, bool dup, uint64_t *next_seq)
+      : m_txn(txn), m_dup(dup), m_next_seq(next_seq) { }
+
+    virtual int get(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags);
+    virtual int put(DbTxn *txn, Dbt *key, Dbt *data, uint32_t flags);
+    virtual int del(DbTxn *txn, Dbt *key, uint32_t flags);
+    virtual int exists(DbTxn *txn, Dbt *key, uint32_t flags);
+    virtual int cursor(DbTxn *txn, StoreCursor **cursorp, uint32_t flags);
+
+  private:
+    friend class WalStoreCursor;
+
+    /** Returns stored key of a new entry for <code>raw</code>.
+     * @param raw Raw key
+     * @return Key under which to store the new entry
+     */
+    String new_key(const String &raw);
+
+    /** Finds the first stored entry of <code>raw</code> after
+     * <code>from</code>.
+     * @param raw Raw key
+     * @param from Stored key to start the search at (inclusive)
+     * @param kv Filled in with the stored key and value if found
+     * @return <i>true</i> if found, <i>false</i> otherwise
+     */
+    bool find(const String &raw, const String &from, WalStore::KeyValue &kv);
+
+    /** Returns raw key of a stored key.
+     * @param stored Stored key
+     * @return Raw key
+     */
+    String raw_key(const String &stored) const {
+      return m_dup ? stored.substr(0, stored.length() - 8) : stored;
+    }
+
+    /** Copies a value into an output Dbt.
+     * @param dbt Output Dbt
+     * @param value Value to copy
+     * @param owned Buffer to use for Dbts without memory flags
+     * @return 0 on success, DB_BUFFER_SMALL if a DB_DBT_USERMEM buffer is
+     * too small
+     */
+    static int fill(Dbt *dbt, const String &value, String &owned);
+
+    /// Transaction through which the store is accessed
+    WalStore::Txn &m_txn;
+
+    /// Flag indicating that duplicates are emulated
+    bool m_dup;
+
+    /// Duplicate sequence number counter
+    uint64_t *m_next_seq;
+
+    /// Returned key memory for Dbts without memory flags
+    String m_key_buf;
+
+    /// Returned data memory for Dbts without memory flags
+    String m_data_buf;
+  };
+
+  /** Transaction against the WalStore backed <i>namespace</i> and
+   * <i>state</i> databases.
+   * Holds the filesystem transaction mutex from construction until commit()
+   * or abort(), so WAL transactions are serialized.  On commit, the
+   * <i>namespace</i> updates are made durable first and then the
+   * <i>state</i> updates are applied.
+   */
+  class WalDbTxn {
+  public:
+
+    /** Constructor.
+     * @param mutex Filesystem transaction mutex
+     * @param namespace_store Store holding the <i>namespace</i> database
+     * @param state_store Store holding the <i>state</i> database
+     * @param next_seq Duplicate sequence number counter of
+     * <code>state_store</code>
+     */
+    WalDbTxn(RecMutex &mutex, WalStore *namespace_store,
+             WalStore *state_store, uint64_t *next_seq);
+
+    /** Returns the <i>namespace</i> database.
+     * @return <i>namespace</i> database
+     */
+    StoreDb *namespace_db() { return &m_namespace_db; }
+
+    /** Returns the <i>state</i> database.
+     * @return <i>state</i> database
+     */
+    StoreDb *state_db() { return &m_state_db; }
+
+    /** Commits the buffered updates and releases the transaction mutex. */
+    void commit();
+
+    /** Discards the buffered updates and releases the transaction mutex. */
+    void abort();
+
+  private:
+
+    /// Lock on the filesystem transaction mutex
+    ScopedRecLock m_lock;
+
+    /// Store holding the <i>namespace</i> database
+    WalStore *m_namespace_store;
+
+    /// Store holding the <i>state</i> database
+    WalStore *m_state_store;
+
+    /// Buffered <i>namespace</i> updates
+    WalStore::Txn m_namespace_txn;
+
+    /// Buffered <i>state</i> updates
+    WalStore::Txn m_state_txn;
+
+    /// <i>namespace</i> database accessed through #m_namespace_txn
+    WalStoreDb m_namespace_db;
+
+    /// <i>state</i> database accessed through #m_state_txn
+    WalStoreDb m_state_db;
+  };
+
+  /// Smart pointer to WalDbTxn
+  typedef boost::shared_ptr<WalDbTxn> WalDbTxnPtr;
+
+  /** @} */
+
+} // namespace Hyperspace
+
+#endif // HYPERSPACE_WALSTOREDB_H
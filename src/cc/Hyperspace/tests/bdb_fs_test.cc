@@ -46,184 +46,225 @@ using namespace Hypertable;
 using namespace Config;
 using namespace std;
 
-int main(int argc, char **argv) {
-  BerkeleyDbFilesystem *bdb_fs;
-  FILE *fp;
-  int ret = 0;
-  bool isdir;
-  PropertiesPtr props = new Properties();
-  init_with_policy<DefaultPolicy>(argc, argv);
-
-  System::initialize(System::locate_install_dir(argv[0]));
+namespace {
 
-  fp = fopen("./bdb_fs_test.output", "w");
+  /** Runs the filesystem operations against a storage backend.
+   * @param store Value of <code>Hyperspace.Store</code>
+   * @param output Output file to write results to
+   * @return 0 if the output matches <code>bdb_fs_test.golden</code>
+   */
+  int run_test(const String &store, const String &output) {
+    BerkeleyDbFilesystem *bdb_fs;
+    FILE *fp;
+    int ret = 0;
+    bool isdir;
+    PropertiesPtr props = new Properties();
 
-  String filename = format("/tmp/bdb_fs_test%d", (int)getpid());
-  FileUtils::mkdirs(filename);
-  vector<Thread::id> thread_ids;
-  thread_ids.push_back(ThisThread::get_id());
+    fp = fopen(output.c_str(), "w");
 
-  props->set("Hyperspace.Checkpoint.Size", 1000000);
-  props->set("Hyperspace.LogGc.Interval", 3600000);
-  props->set("Hyperspace.LogGc.MaxUnusedLogs", 200);
+    String filename = format("/tmp/bdb_fs_test%d", (int)getpid());
+    FileUtils::mkdirs(filename);
+    vector<Thread::id> thread_ids;
+    thread_ids.push_back(ThisThread::get_id());
 
-  bdb_fs = new BerkeleyDbFilesystem(props, filename, thread_ids);
+    props->set("Hyperspace.Checkpoint.Size", 1000000);
+    props->set("Hyperspace.LogGc.Interval", 3600000);
+    props->set("Hyperspace.LogGc.MaxUnusedLogs", 200);
+    props->set("Hyperspace.Store", store);
 
-  BDbTxn txn;
-  bdb_fs->start_transaction(txn);
+    bdb_fs = new BerkeleyDbFilesystem(props, filename, thread_ids);
 
-  try {
-    std::vector<String> listing;
-    std::vector<DirEntry> dir_listing;
-
-    bdb_fs->mkdir(txn, "/dir1");
-    bdb_fs->create(txn, "/dir1/foo", false);
-    bdb_fs->set_xattr_i32(txn, "/dir1/foo", "lock.generation", 2);
-    bdb_fs->unlink(txn, "/dir1/foo");
-    bdb_fs->get_directory_listing(txn, "/dir1", dir_listing);
-
-    if (!dir_listing.empty())
-      fprintf(fp, "/dir1 not empty\n");
+    BDbTxn txn;
+    bdb_fs->start_transaction(txn);
 
     try {
+      std::vector<String> listing;
+      std::vector<DirEntry> dir_listing;
+
+      bdb_fs->mkdir(txn, "/dir1");
+      bdb_fs->create(txn, "/dir1/foo", false);
+      bdb_fs->set_xattr_i32(txn, "/dir1/foo", "lock.generation", 2);
+      bdb_fs->unlink(txn, "/dir1/foo");
+      bdb_fs->get_directory_listing(txn, "/dir1", dir_listing);
+
+      if (!dir_listing.empty())
+        fprintf(fp, "/dir1 not empty\n");
+
+      try {
+        bdb_fs->mkdir(txn, "/foo/bar");
+      }
+      catch (Exception &e) {
+        fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
+      }
+
+      bdb_fs->mkdir(txn, "/foo");
       bdb_fs->mkdir(txn, "/foo/bar");
-    }
-    catch (Exception &e) {
-      fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
-    }
-
-    bdb_fs->mkdir(txn, "/foo");
-    bdb_fs->mkdir(txn, "/foo/bar");
-    bdb_fs->mkdir(txn, "/foo/bar1");
+      bdb_fs->mkdir(txn, "/foo/bar1");
+
+      if (!bdb_fs->exists(txn, "/how", &isdir))
+        fprintf(fp, "\"/how\" does not exist\n");
+
+      if (bdb_fs->exists(txn, "/foo", &isdir)) {
+        fprintf(fp, "\"/foo\" exists, and is ");
+        if (!isdir)
+          fprintf(fp, "not ");
+        fprintf(fp, "a directory\n");
+      }
+
+      uint32_t ival = 1234567;
+      uint64_t lval = 1234567890L;
+
+      bdb_fs->set_xattr_i32(txn, "/foo", "attr1", ival);
+      bdb_fs->set_xattr_i64(txn, "/foo", "attr2", lval);
+
+      std::vector<std::string> anames;
+      std::vector<std::string>::const_iterator attrit;
+      bdb_fs->list_xattr(txn, "/foo", anames);
+
+      for (attrit = anames.begin(); attrit != anames.end(); ++attrit) {
+        fprintf(fp, "Attribute: '%s'\n", (*attrit).c_str());
+      }
+
+      String attr = "attr1";
+      String fname = "/foo";
+
+      if (!bdb_fs->exists_xattr(txn, fname, attr)) {
+        fprintf(fp, "Attribute: '%s' does not exist for file '%s'\n", attr.c_str(), fname.c_str());
+      }
+      else {
+        fprintf(fp, "Attribute: '%s' does exist for file '%s'\n", attr.c_str(), fname.c_str());
+      }
+
+      attr = "attrXYZ";
+      if (!bdb_fs->exists_xattr(txn, fname, attr)) {
+        fprintf(fp, "Attribute: '%s' does not exists for file '%s'\n", attr.c_str(), fname.c_str());
+      }
+      else {
+        fprintf(fp, "Attribute: '%s' does exist for file '%s'\n", attr.c_str(), fname.c_str());
+      }
+
+      ival = 0;
+      lval = 0;
+
+      if (bdb_fs->get_xattr_i32(txn, "/foo", "attr1", &ival))
+        fprintf(fp, "Attribute \"attr1\" of directory \"/foo\" is %u\n", ival);
+
+      if (bdb_fs->get_xattr_i64(txn, "/foo", "attr2", &lval))
+        fprintf(fp, "Attribute \"attr2\" of directory \"/foo\" is %llu\n",
+                (long long unsigned int)lval);
+
+      if (bdb_fs->get_xattr_i32(txn, "/foo", "attr3", &ival))
+        fprintf(fp, "Attribute \"attr3\" of directory \"/foo\" is %u\n", ival);
+
+      try {
+        bdb_fs->create(txn, "/green/dog", false);
+      }
+      catch (Exception &e) {
+        fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
+      }
+
+      bdb_fs->create(txn, "/foo/red", false);
+      bdb_fs->create(txn, "/foo/yellow", true);
+
+      bdb_fs->get_directory_listing(txn, "/foo", dir_listing);
+
+      for (size_t i=0; i<dir_listing.size(); i++) {
+        fprintf(fp, "%s", dir_listing[i].name.c_str());
+        if (dir_listing[i].is_dir)
+          fwrite("/", 1, 1, fp);
+        fwrite("\n", 1, 1, fp);
+      }
+
+      try {
+        bdb_fs->get_directory_listing(txn, "/foo/red", dir_listing);
+      }
+      catch (Exception &e) {
+        fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
+      }
+
+      try {
+        bdb_fs->unlink(txn, "/foo");
+      }
+      catch (Exception &e) {
+        fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
+      }
+
+      bdb_fs->get_all_names(txn, listing);
+
+      for (size_t i=0; i<listing.size(); i++) {
+        fwrite(listing[i].c_str(), 1, listing[i].length(), fp);
+        fwrite("\n", 1, 1, fp);
+      }
+
+      bdb_fs->unlink(txn, "/foo/bar");
+      bdb_fs->unlink(txn, "/foo/red");
+
+      for (size_t i=0; i<listing.size(); i++) {
+        fwrite(listing[i].c_str(), 1, listing[i].length(), fp);
+        fwrite("\n", 1, 1, fp);
+      }
+
+      // Duplicate keys in the state database
+      std::vector<uint64_t> handles;
+      bdb_fs->create_session(txn, 1, "127.0.0.1:38040");
+      bdb_fs->create_session(txn, 2, "127.0.0.1:38041");
+      for (uint64_t handle = 10; handle < 13; ++handle)
+        bdb_fs->add_session_handle(txn, 1, handle);
+      bdb_fs->add_session_handle(txn, 2, 20);
+      bdb_fs->get_session_handles(txn, 1, handles);
+      HT_ASSERT(handles.size() == 3 && handles[0] == 10 &&
+                handles[1] == 11 && handles[2] == 12);
+      HT_ASSERT(bdb_fs->delete_session_handle(txn, 1, 11));
+      HT_ASSERT(!bdb_fs->delete_session_handle(txn, 1, 11));
+      handles.clear();
+      bdb_fs->get_session_handles(txn, 1, handles);
+      HT_ASSERT(handles.size() == 2 && handles[0] == 10 && handles[1] == 12);
+      bdb_fs->delete_session(txn, 1);
+      HT_ASSERT(!bdb_fs->session_exists(txn, 1));
+      HT_ASSERT(bdb_fs->session_exists(txn, 2));
+      handles.clear();
+      bdb_fs->get_session_handles(txn, 2, handles);
+      HT_ASSERT(handles.size() == 1 && handles[0] == 20);
+
+      fclose(fp);
+
+      txn.commit(0);
+
+      delete bdb_fs;
 
-    if (!bdb_fs->exists(txn, "/how", &isdir))
-      fprintf(fp, "\"/how\" does not exist\n");
-
-    if (bdb_fs->exists(txn, "/foo", &isdir)) {
-      fprintf(fp, "\"/foo\" exists, and is ");
-      if (!isdir)
-        fprintf(fp, "not ");
-      fprintf(fp, "a directory\n");
-    }
-
-    uint32_t ival = 1234567;
-    uint64_t lval = 1234567890L;
-
-    bdb_fs->set_xattr_i32(txn, "/foo", "attr1", ival);
-    bdb_fs->set_xattr_i64(txn, "/foo", "attr2", lval);
-
-    std::vector<std::string> anames;
-    std::vector<std::string>::const_iterator attrit;
-    bdb_fs->list_xattr(txn, "/foo", anames);
-
-    for (attrit = anames.begin(); attrit != anames.end(); ++attrit) {
-      fprintf(fp, "Attribute: '%s'\n", (*attrit).c_str());
-    }
-
-    String attr = "attr1";
-    String fname = "/foo";
-
-    if (!bdb_fs->exists_xattr(txn, fname, attr)) {
-      fprintf(fp, "Attribute: '%s' does not exist for file '%s'\n", attr.c_str(), fname.c_str());
-    }
-    else {
-      fprintf(fp, "Attribute: '%s' does exist for file '%s'\n", attr.c_str(), fname.c_str());
-    }
-
-    attr = "attrXYZ";
-    if (!bdb_fs->exists_xattr(txn, fname, attr)) {
-      fprintf(fp, "Attribute: '%s' does not exists for file '%s'\n", attr.c_str(), fname.c_str());
-    }
-    else {
-      fprintf(fp, "Attribute: '%s' does exist for file '%s'\n", attr.c_str(), fname.c_str());
-    }
-
-    ival = 0;
-    lval = 0;
-
-    if (bdb_fs->get_xattr_i32(txn, "/foo", "attr1", &ival))
-      fprintf(fp, "Attribute \"attr1\" of directory \"/foo\" is %u\n", ival);
-
-    if (bdb_fs->get_xattr_i64(txn, "/foo", "attr2", &lval))
-      fprintf(fp, "Attribute \"attr2\" of directory \"/foo\" is %llu\n",
-              (long long unsigned int)lval);
-
-    if (bdb_fs->get_xattr_i32(txn, "/foo", "attr3", &ival))
-      fprintf(fp, "Attribute \"attr3\" of directory \"/foo\" is %u\n", ival);
-
-    try {
-      bdb_fs->create(txn, "/green/dog", false);
-    }
-    catch (Exception &e) {
-      fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
-    }
-
-    bdb_fs->create(txn, "/foo/red", false);
-    bdb_fs->create(txn, "/foo/yellow", true);
-
-    bdb_fs->get_directory_listing(txn, "/foo", dir_listing);
-
-    for (size_t i=0; i<dir_listing.size(); i++) {
-      fprintf(fp, "%s", dir_listing[i].name.c_str());
-      if (dir_listing[i].is_dir)
-        fwrite("/", 1, 1, fp);
-      fwrite("\n", 1, 1, fp);
-    }
-
-    try {
-      bdb_fs->get_directory_listing(txn, "/foo/red", dir_listing);
-    }
-    catch (Exception &e) {
-      fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
-    }
-
-    try {
-      bdb_fs->unlink(txn, "/foo");
     }
     catch (Exception &e) {
-      fprintf(fp, "%s %s\n", Error::get_text(e.code()), e.what());
+      txn.abort();
+      if (e.what())
+        HT_ERRORF("Caught exception: %s - %s", Error::get_text(e.code()),
+                  e.what());
+      else
+        HT_ERRORF("Caught exception: %s", Error::get_text(e.code()));
+      ret = 1;
     }
 
-    bdb_fs->get_all_names(txn, listing);
-
-    for (size_t i=0; i<listing.size(); i++) {
-      fwrite(listing[i].c_str(), 1, listing[i].length(), fp);
-      fwrite("\n", 1, 1, fp);
-    }
+    std::string command = std::string("/bin/rm -rf ") + filename;
 
-    bdb_fs->unlink(txn, "/foo/bar");
-    bdb_fs->unlink(txn, "/foo/red");
+    HT_ASSERT(system(command.c_str()) == 0);
 
-    for (size_t i=0; i<listing.size(); i++) {
-      fwrite(listing[i].c_str(), 1, listing[i].length(), fp);
-      fwrite("\n", 1, 1, fp);
-    }
+    command = String("diff ") + output + " bdb_fs_test.golden";
+    if (system(command.c_str()) != 0)
+      ret = 1;
 
-    fclose(fp);
-
-    txn.commit(0);
+    return ret;
+  }
 
-    delete bdb_fs;
+}
 
-  }
-  catch (Exception &e) {
-    txn.abort();
-    if (e.what())
-      HT_ERRORF("Caught exception: %s - %s", Error::get_text(e.code()),
-                e.what());
-    else
-      HT_ERRORF("Caught exception: %s", Error::get_text(e.code()));
-    ret = 1;
-  }
+int main(int argc, char **argv) {
+  init_with_policy<DefaultPolicy>(argc, argv);
 
-  std::string command = std::string("/bin/rm -rf ") + filename;
+  System::initialize(System::locate_install_dir(argv[0]));
 
-  HT_ASSERT(system(command.c_str()) == 0);
+  int ret = run_test("bdb", "./bdb_fs_test.output");
 
-  command = "diff bdb_fs_test.output bdb_fs_test.golden";
-  if (system(command.c_str()) != 0)
+  if (run_test("wal", "./bdb_fs_test.wal.output") != 0)
     ret = 1;
 
   return ret;
-
 }
@@ -0,0 +1,136 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/System.h"
+
+#include "Hyperspace/ClientCache.h"
+#include "Hyperspace/HandleCallback.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace Hypertable;
+using namespace Hyperspace;
+using namespace std;
+
+namespace {
+
+  const uint32_t ATTR_MASK = EVENT_MASK_ATTR_SET|EVENT_MASK_ATTR_DEL;
+  const uint32_t CHILD_MASK =
+    EVENT_MASK_CHILD_NODE_ADDED|EVENT_MASK_CHILD_NODE_REMOVED;
+
+  void test_attributes(ClientCache &cache) {
+    DynamicBuffer value;
+    bool exists;
+
+    // not watched, nothing is cached
+    cache.put_attr(cache.generation(), "/foo", "a", "x", 1, true);
+    HT_ASSERT(!cache.get_attr("/foo", "a", &value, &exists));
+
+    cache.add_handle(1, "/foo", ATTR_MASK);
+    HT_ASSERT(!cache.get_attr("/foo", "a", &value, &exists));
+    cache.put_attr(cache.generation(), "/foo", "a", "xyz", 3, true);
+    cache.put_attr(cache.generation(), "/foo", "b", 0, 0, false);
+    HT_ASSERT(cache.get_attr("/foo", "a", &value, &exists));
+    HT_ASSERT(exists && value.fill() == 3 && !strcmp((char *)value.base, "xyz"));
+    HT_ASSERT(cache.get_attr("/foo", "b", &value, &exists) && !exists);
+
+    // stale fill is discarded
+    uint64_t generation = cache.generation();
+    cache.notify("/foo", EVENT_MASK_ATTR_SET, "a");
+    HT_ASSERT(!cache.get_attr("/foo", "a", &value, &exists));
+    cache.put_attr(generation, "/foo", "a", "old", 3, true);
+    HT_ASSERT(!cache.get_attr("/foo", "a", &value, &exists));
+    HT_ASSERT(cache.get_attr("/foo", "b", &value, &exists) && !exists);
+
+    // closing the last watching handle drops values
+    cache.remove_handle(1);
+    cache.add_handle(2, "/foo", ATTR_MASK);
+    HT_ASSERT(!cache.get_attr("/foo", "b", &value, &exists));
+    cache.remove_handle(2);
+  }
+
+  void test_listing(ClientCache &cache) {
+    vector<DirEntry> listing, cached;
+    DirEntry entry;
+    bool exists;
+
+    cache.add_handle(3, "/dir", CHILD_MASK);
+    entry.name = "child";
+    entry.is_dir = false;
+    listing.push_back(entry);
+    HT_ASSERT(!cache.get_listing("/dir", cached));
+    cache.put_listing(cache.generation(), "/dir", listing);
+    HT_ASSERT(cache.get_listing("/dir", cached) && cached.size() == 1);
+
+    // existence answered from listing
+    HT_ASSERT(cache.get_exists("/dir/child", &exists) && exists);
+    HT_ASSERT(cache.get_exists("/dir/other", &exists) && !exists);
+
+    cache.notify("/dir", EVENT_MASK_CHILD_NODE_ADDED, "other");
+    HT_ASSERT(!cache.get_listing("/dir", cached));
+    HT_ASSERT(!cache.get_exists("/dir/other", &exists));
+    cache.put_exists(cache.generation(), "/dir/other", true);
+    HT_ASSERT(cache.get_exists("/dir/other", &exists) && exists);
+    cache.notify("/dir", EVENT_MASK_CHILD_NODE_REMOVED, "other");
+    HT_ASSERT(!cache.get_exists("/dir/other", &exists));
+
+    // open handle implies existence
+    cache.add_handle(4, "/elsewhere/file", 0);
+    HT_ASSERT(cache.get_exists("/elsewhere/file", &exists) && exists);
+    cache.remove_handle(4);
+    HT_ASSERT(!cache.get_exists("/elsewhere/file", &exists));
+
+    cache.clear();
+    HT_ASSERT(!cache.get_listing("/dir", cached));
+    cache.reset();
+    cache.put_listing(cache.generation(), "/dir", listing);
+    HT_ASSERT(!cache.get_listing("/dir", cached));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  ClientCache cache;
+  ClientCache::Statistics stats;
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  test_attributes(cache);
+  test_listing(cache);
+
+  cache.get_statistics(stats);
+  HT_ASSERT(stats.attr_hits == 3);
+  HT_ASSERT(stats.listing_hits == 1);
+  HT_ASSERT(stats.exists_hits == 4);
+  HT_ASSERT(stats.invalidations > 0);
+
+  cout << "attr hits=" << stats.attr_hits << " misses=" << stats.attr_misses
+       << " listing hits=" << stats.listing_hits << " misses="
+       << stats.listing_misses << " exists hits=" << stats.exists_hits
+       << " misses=" << stats.exists_misses << " hit rate="
+       << stats.hit_rate() << "%" << endl;
+
+  return 0;
+}
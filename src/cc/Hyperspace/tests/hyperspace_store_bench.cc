@@ -0,0 +1,250 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Hyperspace storage backend benchmark.
+ * Measures throughput of the mkdir, attribute set and lock acquisition
+ * update patterns issued by the Hyperspace master, once against
+ * BerkeleyDbFilesystem and once against WalStore.  The WalStore variants
+ * write the same keys BerkeleyDbFilesystem does (see StateDbKeys.h), one
+ * transaction per operation.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/FileUtils.h"
+#include "Common/Init.h"
+#include "Common/Logger.h"
+#include "Common/Properties.h"
+#include "Common/Stopwatch.h"
+#include "Common/String.h"
+#include "Common/System.h"
+#include "Common/Thread.h"
+
+#include "Hyperspace/BerkeleyDbFilesystem.h"
+#include "Hyperspace/StateDbKeys.h"
+#include "Hyperspace/WalStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hyperspace;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: hyperspace_store_bench [options]\n\n"
+                   "Compares Hyperspace storage backend throughput.\n\n"
+                   "Options").add_options()
+        ("backend", str()->default_value("all"),
+         "Backend to benchmark (bdb, wal, walkv or all); walkv runs the "
+         "equivalent updates directly against a WalStore")
+        ("count", i32()->default_value(10000),
+         "Number of operations per benchmark")
+        ("dir", str()->default_value("/tmp"),
+         "Directory in which to create the stores")
+        ("no-sync", boo()->zero_tokens()->default_value(false),
+         "Do not sync the WalStore log on commit (walkv only)")
+        ;
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DefaultPolicy> Policies;
+
+  const char ATTR_DELIM = 0x01;
+
+  void report(const char *backend, const char *op, int count,
+              Stopwatch &stopwatch) {
+    double secs = stopwatch.elapsed();
+    printf("%-5s %-9s %8d ops %8.3f s %10.1f ops/s\n", backend, op, count,
+           secs, secs > 0.0 ? (double)count / secs : 0.0);
+  }
+
+  void run_fs(const String &store, const String &dir, int count) {
+    PropertiesPtr props = new Properties();
+    vector<Thread::id> thread_ids;
+    thread_ids.push_back(ThisThread::get_id());
+    props->set("Hyperspace.Checkpoint.Size", 1000000);
+    props->set("Hyperspace.LogGc.Interval", 3600000);
+    props->set("Hyperspace.LogGc.MaxUnusedLogs", 200);
+    props->set("Hyperspace.Store", store);
+
+    FileUtils::mkdirs(dir);
+    BerkeleyDbFilesystem *fs = new BerkeleyDbFilesystem(props, dir, thread_ids);
+    Stopwatch stopwatch;
+
+    for (int i=0; i<count; i++) {
+      BDbTxn txn;
+      fs->start_transaction(txn);
+      fs->mkdir(txn, format("/dir%d", i));
+      txn.commit(0);
+    }
+    stopwatch.stop();
+    report(store.c_str(), "mkdir", count, stopwatch);
+
+    stopwatch.reset();
+    stopwatch.start();
+    for (int i=0; i<count; i++) {
+      BDbTxn txn;
+      fs->start_transaction(txn);
+      fs->set_xattr(txn, format("/dir%d", i % 100), "attr", "value", 5);
+      txn.commit(0);
+    }
+    stopwatch.stop();
+    report(store.c_str(), "attr_set", count, stopwatch);
+
+    {
+      BDbTxn txn;
+      fs->start_transaction(txn);
+      fs->create(txn, "/lockfile", false);
+      fs->create_node(txn, "/lockfile");
+      fs->create_handle(txn, 1, "/lockfile", 0, 0, 1, false, 0);
+      fs->add_node_handle(txn, "/lockfile", 1);
+      txn.commit(0);
+    }
+
+    stopwatch.reset();
+    stopwatch.start();
+    for (int i=0; i<count; i++) {
+      BDbTxn txn;
+      fs->start_transaction(txn);
+      uint64_t generation = fs->incr_node_lock_generation(txn, "/lockfile");
+      fs->set_xattr_i64(txn, "/lockfile", "lock.generation", generation);
+      fs->set_node_cur_lock_mode(txn, "/lockfile", 2);
+      fs->set_node_exclusive_lock_handle(txn, "/lockfile", 1);
+      fs->set_handle_locked(txn, 1, true);
+      txn.commit(0);
+    }
+    stopwatch.stop();
+    report(store.c_str(), "lock", count, stopwatch);
+
+    delete fs;
+  }
+
+  void run_wal(const String &dir, int count, bool sync) {
+    WalStorePtr store = new WalStore(dir, 16*1024*1024, sync);
+    WalStore::Txn txn(store.get());
+    Stopwatch stopwatch;
+    String value;
+
+    txn.put("/", "");
+    store->commit(txn);
+
+    for (int i=0; i<count; i++) {
+      String name = format("/dir%d/", i);
+      if (!txn.get("/", value))
+        HT_THROW(Error::HYPERSPACE_FILE_NOT_FOUND, "/");
+      if (txn.get(name, value))
+        HT_THROW(Error::HYPERSPACE_FILE_EXISTS, name);
+      txn.put(name, "");
+      store->commit(txn);
+    }
+    stopwatch.stop();
+    report("walkv", "mkdir", count, stopwatch);
+
+    stopwatch.reset();
+    stopwatch.start();
+    for (int i=0; i<count; i++) {
+      txn.put(format("/dir%d/%cattr", i % 100, ATTR_DELIM), "value");
+      store->commit(txn);
+    }
+    stopwatch.stop();
+    report("walkv", "attr_set", count, stopwatch);
+
+    String gen_key = StateDbKeys::get_node_key("/lockfile",
+        StateDbKeys::NODE_LOCK_GENERATION);
+    String locked_key = StateDbKeys::get_handle_key(1, StateDbKeys::HANDLE_LOCKED);
+    txn.put("/lockfile", "");
+    txn.put(gen_key, "0");
+    txn.put(locked_key, "0");
+    store->commit(txn);
+
+    stopwatch.reset();
+    stopwatch.start();
+    for (int i=0; i<count; i++) {
+      if (!txn.get(gen_key, value))
+        HT_THROW(Error::HYPERSPACE_STATEDB_NODE_ATTR_NOT_FOUND, gen_key);
+      String generation = format("%llu", (Llu)strtoull(value.c_str(), 0, 10) + 1);
+      txn.put(gen_key, generation);
+      txn.put(format("/lockfile%clock.generation", ATTR_DELIM), generation);
+      txn.put(StateDbKeys::get_node_key("/lockfile", StateDbKeys::NODE_LOCK_MODE),
+              "2");
+      txn.put(StateDbKeys::get_node_key("/lockfile",
+              StateDbKeys::NODE_EXCLUSIVE_LOCK_HANDLE), "1");
+      txn.put(locked_key, "1");
+      store->commit(txn);
+    }
+    stopwatch.stop();
+    report("walkv", "lock", count, stopwatch);
+
+    stopwatch.reset();
+    stopwatch.start();
+    store->snapshot();
+    stopwatch.stop();
+    printf("walkv snapshot  %8llu keys %7.3f s\n", (Llu)store->size(),
+           stopwatch.elapsed());
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    String backend = get_str("backend");
+    int count = get_i32("count");
+    String base = format("%s/hyperspace_store_bench%d", get_str("dir").c_str(),
+                         (int)getpid());
+
+    if (backend != "bdb" && backend != "wal" && backend != "walkv" &&
+        backend != "all")
+      HT_THROWF(Error::CONFIG_BAD_VALUE, "Invalid backend '%s'",
+                backend.c_str());
+
+    if (backend == "bdb" || backend == "all")
+      run_fs("bdb", base + "/bdb", count);
+
+    if (backend == "wal" || backend == "all")
+      run_fs("wal", base + "/wal", count);
+
+    if (backend == "walkv" || backend == "all")
+      run_wal(base + "/walkv", count, !get_bool("no-sync"));
+
+    String cmd = "/bin/rm -rf " + base;
+    if (system(cmd.c_str()) != 0)
+      return 1;
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,229 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/FileUtils.h"
+#include "Common/Logger.h"
+#include "Common/String.h"
+#include "Common/System.h"
+
+#include "Hyperspace/WalStore.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hyperspace;
+using namespace std;
+
+namespace {
+
+  void check_value(WalStore *store, const String &key, const String &expected) {
+    String value;
+    HT_ASSERT(store->get(key, value));
+    HT_ASSERT(value == expected);
+  }
+
+  void test_recovery(const String &dir) {
+    {
+      WalStorePtr store = new WalStore(dir, 1024*1024, false);
+      WalStore::Txn txn(store.get());
+      String value;
+
+      txn.put("/foo/", "");
+      txn.put("/foo/bar", "1");
+      HT_ASSERT(txn.get("/foo/bar", value) && value == "1");
+      HT_ASSERT(!store->exists("/foo/bar"));
+      store->commit(txn);
+      HT_ASSERT(txn.size() == 0);
+
+      txn.put("/foo/baz", "2");
+      txn.put("/foo/bar", "3");
+      txn.del("/foo/baz");
+      HT_ASSERT(!txn.get("/foo/baz", value));
+      store->commit(txn);
+
+      txn.put("/other", "x");
+      store->commit(txn);
+    }
+
+    // Append a torn record to the last log
+    vector<struct dirent> listing;
+    FileUtils::readdir(dir, "log\\.[0-9]+", listing);
+    HT_ASSERT(listing.size() == 1);
+    String log = dir + "/" + listing[0].d_name;
+    int fd = ::open(log.c_str(), O_WRONLY|O_APPEND);
+    HT_ASSERT(fd >= 0);
+    HT_ASSERT(FileUtils::write(fd, "\x10\x00\x00\x00garbage", 11) == 11);
+    ::close(fd);
+
+    WalStorePtr store = new WalStore(dir, 1024*1024, false);
+    vector<WalStore::KeyValue> result;
+    HT_ASSERT(store->size() == 3);
+    check_value(store.get(), "/foo/bar", "3");
+    HT_ASSERT(!store->exists("/foo/baz"));
+    store->scan("/foo/", result);
+    HT_ASSERT(result.size() == 2);
+    HT_ASSERT(result[0].first == "/foo/" && result[1].first == "/foo/bar");
+  }
+
+  void test_snapshot(const String &dir) {
+    map<String, String> expected;
+    {
+      WalStorePtr store = new WalStore(dir, 4096, true);
+      WalStore::Txn txn(store.get());
+      for (int i=0; i<1000; i++) {
+        String key = format("/node%d", i % 100);
+        txn.put(key, format("%d", i));
+        expected[key] = format("%d", i);
+        if (i % 10 == 0) {
+          key = format("/node%d", (i + 50) % 100);
+          txn.del(key);
+          expected.erase(key);
+        }
+        store->commit(txn);
+      }
+      HT_ASSERT(store->log_size() < 4096);
+    }
+
+    HT_ASSERT(FileUtils::exists(dir + "/snapshot"));
+    vector<struct dirent> listing;
+    FileUtils::readdir(dir, "log\\.[0-9]+", listing);
+    HT_ASSERT(listing.size() == 1);
+
+    WalStorePtr store = new WalStore(dir, 4096, true);
+    HT_ASSERT(store->size() == expected.size());
+    for (auto &kv : expected)
+      check_value(store.get(), kv.first, kv.second);
+
+    // An explicit snapshot supersedes all existing logs
+    store->snapshot();
+    store = new WalStore(dir, 4096, true);
+    HT_ASSERT(store->size() == expected.size());
+    listing.clear();
+    FileUtils::readdir(dir, "log\\.[0-9]+", listing);
+    HT_ASSERT(listing.size() == 2);
+  }
+
+  void test_seek(const String &dir) {
+    WalStorePtr store = new WalStore(dir, 1024*1024, false);
+    WalStore::Txn txn(store.get());
+    WalStore::KeyValue kv;
+
+    txn.put("/a", "1");
+    txn.put("/c", "3");
+    txn.put("/e", "5");
+    store->commit(txn);
+
+    HT_ASSERT(store->seek("/b", kv) && kv.first == "/c");
+    HT_ASSERT(!store->seek("/f", kv));
+
+    // Buffered updates are merged with the store
+    txn.put("/b", "2");
+    txn.del("/c");
+    txn.put("/d", "4");
+    txn.del("/d");
+    HT_ASSERT(txn.seek("/aa", kv) && kv.first == "/b" && kv.second == "2");
+    HT_ASSERT(txn.seek("/c", kv) && kv.first == "/e" && kv.second == "5");
+    HT_ASSERT(txn.seek("", kv) && kv.first == "/a");
+    txn.put("/e", "6");
+    HT_ASSERT(txn.seek("/c", kv) && kv.first == "/e" && kv.second == "6");
+    txn.del("/e");
+    HT_ASSERT(!txn.seek("/c", kv));
+  }
+
+  void test_commit_failure(const String &dir) {
+    {
+      WalStorePtr store = new WalStore(dir, 1024*1024, false);
+      WalStore::Txn txn(store.get());
+
+      txn.put("/a", "1");
+      store->commit(txn);
+      uint64_t good_size = store->log_size();
+
+      // Cap the file size so that the next append is only partially written
+      struct rlimit saved, limit;
+      HT_ASSERT(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+      signal(SIGXFSZ, SIG_IGN);
+      limit = saved;
+      limit.rlim_cur = good_size + 16;
+      HT_ASSERT(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+      txn.put("/b", String(1024, 'x'));
+      bool failed = false;
+      try {
+        store->commit(txn);
+      }
+      catch (Exception &e) {
+        failed = e.code() == Error::HYPERSPACE_IO_ERROR;
+      }
+      HT_ASSERT(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+      HT_ASSERT(failed);
+
+      // The partial record has been truncated away
+      HT_ASSERT(store->log_size() == good_size);
+      HT_ASSERT(!store->exists("/b"));
+      txn.clear();
+      txn.put("/c", "3");
+      store->commit(txn);
+    }
+
+    WalStorePtr store = new WalStore(dir, 1024*1024, false);
+    HT_ASSERT(store->size() == 2);
+    check_value(store.get(), "/a", "1");
+    check_value(store.get(), "/c", "3");
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  String dir = format("/tmp/wal_store_test%d", (int)getpid());
+
+  try {
+    test_recovery(dir + "/recovery");
+    test_snapshot(dir + "/snapshot");
+    test_seek(dir + "/seek");
+    test_commit_failure(dir + "/commit_failure");
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+
+  String cmd = "/bin/rm -rf " + dir;
+  if (system(cmd.c_str()) != 0)
+    return 1;
+
+  cout << "SUCCESS" << endl;
+  return 0;
+}
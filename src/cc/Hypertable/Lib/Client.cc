@@ -174,6 +174,10 @@ NameIdMapperPtr Client::get_nameid_mapper() {
   return m_namemap;
 }
 
+void Client::get_location_cache_statistics(LocationCache::Statistics &stats) {
+  m_range_locator->get_cache_statistics(stats);
+}
+
 void Client::close() {
   HT_WARN("close() is no longer supported");
 }
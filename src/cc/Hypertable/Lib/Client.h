@@ -30,6 +30,7 @@
 #include "AsyncComm/ConnectionManager.h"
 #include "Hyperspace/Session.h"
 
+#include "LocationCache.h"
 #include "MasterClient.h"
 #include "NameIdMapper.h"
 #include "NamespaceCache.h"
@@ -123,6 +124,13 @@ namespace Hypertable {
 
     NameIdMapperPtr get_nameid_mapper();
 
+    /**
+     * Gets the hit, miss and eviction counters of the range location cache
+     *
+     * @param stats filled in with the location cache statistics
+     */
+    void get_location_cache_statistics(LocationCache::Statistics &stats);
+
     void close();
     void shutdown();
 
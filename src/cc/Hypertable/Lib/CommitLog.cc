@@ -32,6 +32,7 @@
 #include "Common/Time.h"
 #include "Common/md5.h"
 
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
 #include "AsyncComm/Protocol.h"
 
 #include "Hypertable/Lib/CompressorFactory.h"
@@ -51,24 +52,25 @@ const char CommitLog::MAGIC_LINK[10] =
 
 CommitLog::CommitLog(FilesystemPtr &fs, const String &log_dir, bool is_meta)
   : CommitLogBase(log_dir), m_fs(fs) {
-  initialize(log_dir, Config::properties, 0, is_meta);
+  initialize(log_dir, Config::properties, 0, is_meta, 1);
 }
 
 CommitLog::~CommitLog() {
-  delete m_compressor;
   close();
+  foreach_ht (Stripe &stripe, m_stripes)
+    delete stripe.compressor;
 }
 
 void
 CommitLog::initialize(const String &log_dir, PropertiesPtr &props,
-                      CommitLogBase *init_log, bool is_meta) {
+                      CommitLogBase *init_log, bool is_meta, size_t stripes) {
   String compressor;
 
   m_log_dir = log_dir;
-  m_cur_fragment_length = 0;
-  m_cur_fragment_num = 0;
-  m_needs_roll = false;
+  m_next_stripe = 0;
+  m_next_fragment_num = 0;
   m_replication = -1;
+  m_closed = false;
 
   if (is_meta)
     m_replication = props->get_i32("Hypertable.Metadata.Replication");
@@ -81,10 +83,17 @@ CommitLog::initialize(const String &log_dir, PropertiesPtr &props,
     m_max_fragment_size = cfg.get_i64("RollLimit");
     compressor = cfg.get_str("Compressor"));
 
-  m_compressor = CompressorFactory::create_block_codec(compressor);
-
   boost::trim_right_if(m_log_dir, boost::is_any_of("/"));
 
+  // Stripe holds a mutex, so the vector is built in place rather than resized
+  std::vector<Stripe> new_stripes(stripes ? stripes : 1);
+  m_stripes.swap(new_stripes);
+  for (size_t i=0; i<m_stripes.size(); i++) {
+    // Each stripe compresses concurrently, so each needs its own codec
+    m_stripes[i].compressor = CompressorFactory::create_block_codec(compressor);
+    m_stripes[i].dir = stripe_dir(m_log_dir, i);
+  }
+
   m_range_reference_required = props->get_bool("Hypertable.RangeServer.CommitLog.FragmentRemoval.RangeReferenceRequired");
 
   if (init_log) {
@@ -92,18 +101,23 @@ CommitLog::initialize(const String &log_dir, PropertiesPtr &props,
       m_range_reference_required = init_log->range_reference_required();
     stitch_in(init_log);
     foreach_ht (const CommitLogFileInfo *frag, m_fragment_queue) {
-      if (frag->num >= m_cur_fragment_num)
-        m_cur_fragment_num = frag->num + 1;
+      if (frag->num >= m_next_fragment_num)
+        m_next_fragment_num = frag->num + 1;
     }
   }
-  else {  // chose one past the max one found in the directory
+  else {  // chose one past the max one found in the stripe directories
     uint32_t num;
     std::vector<Filesystem::Dirent> listing;
-    m_fs->readdir(m_log_dir, listing);
-    for (size_t i=0; i<listing.size(); i++) {
-      num = atoi(listing[i].name.c_str());
-      if (num >= m_cur_fragment_num)
-        m_cur_fragment_num = num + 1;
+    foreach_ht (const Stripe &stripe, m_stripes) {
+      if (stripe.dir != m_log_dir && !m_fs->exists(stripe.dir))
+        continue;
+      listing.clear();
+      m_fs->readdir(stripe.dir, listing);
+      for (size_t i=0; i<listing.size(); i++) {
+        num = atoi(listing[i].name.c_str());
+        if (num >= m_next_fragment_num)
+          m_next_fragment_num = num + 1;
+      }
     }
   }
 
@@ -112,22 +126,45 @@ CommitLog::initialize(const String &log_dir, PropertiesPtr &props,
   else
     HT_INFOF("Range reference for '%s' is NOT required", m_log_dir.c_str());
 
-  m_cur_fragment_fname = m_log_dir + "/" + m_cur_fragment_num;
+  if (m_stripes.size() > 1)
+    HT_INFOF("Commit log '%s' is striped across %d directories",
+             m_log_dir.c_str(), (int)m_stripes.size());
 
-  try {
-    m_fs->mkdirs(m_log_dir);
-    m_fd = m_fs->create(m_cur_fragment_fname, Filesystem::OPEN_FLAG_OVERWRITE,
-                        -1, m_replication, -1);
-  }
-  catch (Hypertable::Exception &e) {
-    HT_ERRORF("Problem initializing commit log '%s' - %s (%s)",
-              m_log_dir.c_str(), e.what(), Error::get_text(e.code()));
-    m_fd = -1;
-    throw;
+  foreach_ht (Stripe &stripe, m_stripes) {
+    stripe.num = m_next_fragment_num++;
+    stripe.fname = stripe.dir + "/" + stripe.num;
+    try {
+      m_fs->mkdirs(stripe.dir);
+      stripe.fd = m_fs->create(stripe.fname, Filesystem::OPEN_FLAG_OVERWRITE,
+                               -1, m_replication, -1);
+    }
+    catch (Hypertable::Exception &e) {
+      HT_ERRORF("Problem initializing commit log '%s' - %s (%s)",
+                stripe.dir.c_str(), e.what(), Error::get_text(e.code()));
+      stripe.fd = -1;
+      throw;
+    }
   }
 }
 
 
+String CommitLog::stripe_dir(const String &log_dir, size_t stripe) {
+  if (stripe == 0)
+    return log_dir;
+  return log_dir + "/stripe." + (uint32_t)stripe;
+}
+
+
+bool CommitLog::is_stripe_dir(const String &name) {
+  if (!boost::starts_with(name, "stripe.") || name.length() == 7)
+    return false;
+  for (size_t i=7; i<name.length(); i++)
+    if (!isdigit(name[i]))
+      return false;
+  return true;
+}
+
+
 int64_t CommitLog::get_timestamp() {
   ScopedLock lock(m_mutex);
   boost::xtime now;
@@ -137,20 +174,76 @@ int64_t CommitLog::get_timestamp() {
 
 int
 CommitLog::sync() {
-  ScopedLock lock(m_mutex);
   int error = Error::OK;
 
-  // Sync commit log update (protected by lock)
-  try {
-    if (m_fd == -1)
-      return Error::CLOSED;
-    m_fs->flush(m_fd);
-    HT_DEBUG_OUT << "synced commit log explicitly" << HT_END;
+  if (m_stripes.size() == 1) {
+    Stripe &stripe = m_stripes[0];
+    ScopedLock lock(stripe.mutex);
+    // Sync commit log update (protected by lock)
+    try {
+      if (stripe.fd == -1)
+        return Error::CLOSED;
+      m_fs->flush(stripe.fd);
+      stripe.unsynced = false;
+      HT_DEBUG_OUT << "synced commit log explicitly" << HT_END;
+    }
+    catch (Exception &e) {
+      HT_ERRORF("Problem syncing commit log: %s: %s",
+                stripe.fname.c_str(), e.what());
+      error = e.code();
+    }
+    return error;
   }
-  catch (Exception &e) {
-    HT_ERRORF("Problem syncing commit log: %s: %s",
-              m_cur_fragment_fname.c_str(), e.what());
-    error = e.code();
+
+  // Issue a flush on every stripe written to since the last sync and then
+  // wait for all of them, so the stripes are synced concurrently.  A stripe's
+  // lock is only held while its flush is issued; writes that land after that
+  // mark the stripe unsynced again, and a failed flush marks it unsynced
+  // below.
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event;
+  std::vector<Stripe *> flushing;
+
+  foreach_ht (Stripe &stripe, m_stripes) {
+    ScopedLock lock(stripe.mutex);
+    if (stripe.fd == -1) {
+      error = Error::CLOSED;
+      break;
+    }
+    if (!stripe.unsynced)
+      continue;
+    try {
+      m_fs->flush(stripe.fd, &sync_handler);
+      stripe.unsynced = false;
+      flushing.push_back(&stripe);
+    }
+    catch (Exception &e) {
+      HT_ERRORF("Problem syncing commit log: %s: %s",
+                stripe.fname.c_str(), e.what());
+      error = e.code();
+      break;
+    }
+  }
+
+  // Responses arrive in any order, so only the aggregate outcome is known
+  for (size_t i=0; i<flushing.size(); i++) {
+    if (!sync_handler.wait_for_reply(event)) {
+      int code = Protocol::response_code(event.get());
+      HT_ERRORF("Problem syncing commit log '%s' - %s", m_log_dir.c_str(),
+                Error::get_text(code));
+      if (error == Error::OK)
+        error = code;
+    }
+  }
+
+  if (error == Error::OK)
+    HT_DEBUG_OUT << "synced " << flushing.size() << " commit log stripes"
+                 << HT_END;
+  else {
+    foreach_ht (Stripe *stripe, flushing) {
+      ScopedLock lock(stripe->mutex);
+      stripe->unsynced = true;
+    }
   }
 
   return error;
@@ -159,25 +252,34 @@ CommitLog::sync() {
 int CommitLog::write(DynamicBuffer &buffer, int64_t revision, bool sync) {
   int error;
   BlockCompressionHeaderCommitLog header(MAGIC_DATA, revision);
+  Stripe *stripe;
 
-  if (m_needs_roll) {
+  {
     ScopedLock lock(m_mutex);
-    if ((error = roll()) != Error::OK)
+    stripe = &m_stripes[m_next_stripe];
+    if (++m_next_stripe == m_stripes.size())
+      m_next_stripe = 0;
+  }
+
+  ScopedLock lock(stripe->mutex);
+
+  if (stripe->needs_roll) {
+    if ((error = roll(*stripe)) != Error::OK)
       return error;
   }
 
   /**
    * Compress and write the commit block
    */
-  if ((error = compress_and_write(buffer, &header, revision, sync)) != Error::OK)
+  if ((error = compress_and_write(*stripe, buffer, &header, revision, sync))
+      != Error::OK)
     return error;
 
   /**
-   * Roll the log
+   * Roll the stripe
    */
-  if (m_cur_fragment_length > m_max_fragment_size) {
-    ScopedLock lock(m_mutex);
-    if ((error = roll()) != Error::OK)
+  if (stripe->length > m_max_fragment_size) {
+    if ((error = roll(*stripe)) != Error::OK)
       return error;
   }
 
@@ -186,32 +288,34 @@ int CommitLog::write(DynamicBuffer &buffer, int64_t revision, bool sync) {
 
 
 int CommitLog::link_log(CommitLogBase *log_base) {
-  ScopedLock lock(m_mutex);
   int error;
   int64_t link_revision = log_base->get_latest_revision();
   BlockCompressionHeaderCommitLog header(MAGIC_LINK, link_revision);
 
   DynamicBuffer input;
   String &log_dir = log_base->get_log_dir();
+  Stripe &stripe = m_stripes[0];
+  ScopedLock stripe_lock(stripe.mutex);
 
-  if (m_linked_log_hashes.count(md5_hash(log_dir.c_str())) > 0) {
-    HT_WARNF("Skipping log %s because it is already linked in", log_dir.c_str());
-    return Error::OK;
+  {
+    ScopedLock lock(m_mutex);
+    if (m_linked_log_hashes.count(md5_hash(log_dir.c_str())) > 0) {
+      HT_WARNF("Skipping log %s because it is already linked in", log_dir.c_str());
+      return Error::OK;
+    }
   }
 
-  if (m_needs_roll) {
-    if ((error = roll()) != Error::OK)
+  if (stripe.needs_roll) {
+    if ((error = roll(stripe)) != Error::OK)
       return error;
   }
 
   HT_INFOF("clgc Linking log %s into fragment %d; link_rev=%lld latest_rev=%lld",
-           log_dir.c_str(), m_cur_fragment_num, (Lld)link_revision, (Lld)m_latest_revision);
+           log_dir.c_str(), stripe.num, (Lld)link_revision,
+           (Lld)stripe.latest_revision);
 
   HT_ASSERT(link_revision > 0);
 
-  if (link_revision > m_latest_revision)
-    m_latest_revision = link_revision;
-
   input.ensure(header.length());
 
   header.set_revision(link_revision);
@@ -228,15 +332,25 @@ int CommitLog::link_log(CommitLogBase *log_base) {
     StaticBuffer send_buf(input);
     CommitLogFileInfo *file_info = 0;
 
-    if (m_fd == -1)
+    if (stripe.fd == -1)
       return Error::CLOSED;
 
-    m_fs->append(m_fd, send_buf, false);
-    m_cur_fragment_length += amount;
+    m_fs->append(stripe.fd, send_buf, false);
+
+    {
+      ScopedLock lock(m_mutex);
+      if (link_revision > stripe.latest_revision)
+        stripe.latest_revision = link_revision;
+      if (link_revision > m_latest_revision)
+        m_latest_revision = link_revision;
+      stripe.length += amount;
+    }
 
-    if ((error = roll(&file_info)) != Error::OK)
+    if ((error = roll(stripe, &file_info)) != Error::OK)
       return error;
 
+    ScopedLock lock(m_mutex);
+
     file_info->verify();
     file_info->purge_dirs.insert(log_dir);
 
@@ -252,35 +366,42 @@ int CommitLog::link_log(CommitLogBase *log_base) {
     struct LtClfip swo;
     sort(m_fragment_queue.begin(), m_fragment_queue.end(), swo);
 
+    m_linked_log_hashes.insert(md5_hash(log_dir.c_str()));
   }
   catch (Hypertable::Exception &e) {
     HT_ERRORF("Problem linking external log into commit log - %s", e.what());
     return e.code();
   }
 
-  m_linked_log_hashes.insert(md5_hash(log_dir.c_str()));
-
   return Error::OK;
 }
 
 
 int CommitLog::close() {
-  ScopedLock lock(m_mutex);
+  int error = Error::OK;
 
-  try {
-    if (m_fd >= 0) {
-      m_fs->close(m_fd);
-      m_fd = -1;
-    }
+  {
+    ScopedLock lock(m_mutex);
+    m_closed = true;
   }
-  catch (Hypertable::Exception &e) {
-    HT_ERRORF("Problem closing commit log file '%s' - %s (%s)",
-              m_cur_fragment_fname.c_str(), e.what(),
-              Error::get_text(e.code()));
-    return e.code();
+
+  foreach_ht (Stripe &stripe, m_stripes) {
+    ScopedLock lock(stripe.mutex);
+    try {
+      if (stripe.fd >= 0) {
+        m_fs->close(stripe.fd);
+        stripe.fd = -1;
+      }
+    }
+    catch (Hypertable::Exception &e) {
+      HT_ERRORF("Problem closing commit log file '%s' - %s (%s)",
+                stripe.fname.c_str(), e.what(), Error::get_text(e.code()));
+      if (error == Error::OK)
+        error = e.code();
+    }
   }
 
-  return Error::OK;
+  return error;
 }
 
 
@@ -288,7 +409,7 @@ int CommitLog::purge(int64_t revision, StringSet &remove_ok_logs,
                      StringSet &removed_logs, String *trace) {
   ScopedLock lock(m_mutex);
 
-  if (m_fd == -1)
+  if (m_closed)
     return Error::CLOSED;
 
   if (trace) {
@@ -380,41 +501,44 @@ void CommitLog::remove_file_info(CommitLogFileInfo *fi, StringSet &removed_logs)
 }
 
 
-int CommitLog::roll(CommitLogFileInfo **clfip) {
+int CommitLog::roll(Stripe &stripe, CommitLogFileInfo **clfip) {
   CommitLogFileInfo *file_info;
 
-  if (m_fd == -1)
+  if (stripe.fd == -1)
     return Error::CLOSED;
 
-  if (m_latest_revision == TIMESTAMP_MIN)
+  if (stripe.latest_revision == TIMESTAMP_MIN)
     return Error::OK;
 
-  m_needs_roll = true;
+  stripe.needs_roll = true;
 
   if (clfip)
     *clfip = 0;
 
-  if (m_fd >= 0) {
+  if (stripe.fd >= 0) {
     try {
-      m_fs->close(m_fd);
+      m_fs->close(stripe.fd);
     }
     catch (Exception &e) {
       HT_ERRORF("Problem closing commit log fragment: %s: %s",
-		m_cur_fragment_fname.c_str(), e.what());
+		stripe.fname.c_str(), e.what());
       return e.code();
     }
 
-    m_fd = -1;
+    stripe.fd = -1;
+    stripe.unsynced = false;
+
+    ScopedLock lock(m_mutex);
 
     file_info = new CommitLogFileInfo();
     if (clfip)
       *clfip = file_info;
-    file_info->log_dir = m_log_dir;
-    file_info->log_dir_hash = md5_hash(m_log_dir.c_str());
-    file_info->num = m_cur_fragment_num;
-    file_info->size = m_cur_fragment_length;
-    assert(m_latest_revision != TIMESTAMP_MIN);
-    file_info->revision = m_latest_revision;
+    file_info->log_dir = stripe.dir;
+    file_info->log_dir_hash = md5_hash(stripe.dir.c_str());
+    file_info->num = stripe.num;
+    file_info->size = stripe.length;
+    assert(stripe.latest_revision != TIMESTAMP_MIN);
+    file_info->revision = stripe.latest_revision;
 
     if (m_fragment_queue.empty() || m_fragment_queue.back()->revision
         < file_info->revision)
@@ -425,57 +549,68 @@ int CommitLog::roll(CommitLogFileInfo **clfip) {
       sort(m_fragment_queue.begin(), m_fragment_queue.end(), swo);
     }
 
+    stripe.latest_revision = TIMESTAMP_MIN;
+    stripe.length = 0;
+
     m_latest_revision = TIMESTAMP_MIN;
-    m_cur_fragment_length = 0;
+    foreach_ht (const Stripe &other, m_stripes)
+      if (other.latest_revision > m_latest_revision)
+        m_latest_revision = other.latest_revision;
 
-    m_cur_fragment_num++;
-    m_cur_fragment_fname = m_log_dir + "/" + m_cur_fragment_num;
+    stripe.num = m_next_fragment_num++;
+    stripe.fname = stripe.dir + "/" + stripe.num;
 
   }
 
   try {
-    m_fd = m_fs->create(m_cur_fragment_fname, Filesystem::OPEN_FLAG_OVERWRITE,
-                        -1, m_replication, -1);
+    stripe.fd = m_fs->create(stripe.fname, Filesystem::OPEN_FLAG_OVERWRITE,
+                             -1, m_replication, -1);
   }
   catch (Exception &e) {
     HT_ERRORF("Problem rolling commit log: %s: %s",
-              m_cur_fragment_fname.c_str(), e.what());
+              stripe.fname.c_str(), e.what());
     return e.code();
   }
 
-  m_needs_roll = false;
+  stripe.needs_roll = false;
 
   return Error::OK;
 }
 
 
 int
-CommitLog::compress_and_write(DynamicBuffer &input,
+CommitLog::compress_and_write(Stripe &stripe, DynamicBuffer &input,
     BlockCompressionHeader *header, int64_t revision, bool sync) {
-  ScopedLock lock(m_mutex);
   int error = Error::OK;
   DynamicBuffer zblock;
 
-  // Compress block and kick off log write (protected by lock)
+  // Compress block and kick off log write (protected by stripe lock)
   try {
 
-    if (m_fd == -1)
+    if (stripe.fd == -1)
       return Error::CLOSED;
 
-    m_compressor->deflate(input, zblock, *header);
+    stripe.compressor->deflate(input, zblock, *header);
 
     size_t amount = zblock.fill();
     StaticBuffer send_buf(zblock);
 
-    m_fs->append(m_fd, send_buf, sync);
+    m_fs->append(stripe.fd, send_buf, sync);
     assert(revision != 0);
-    if (revision > m_latest_revision)
-      m_latest_revision = revision;
-    m_cur_fragment_length += amount;
+    {
+      ScopedLock lock(m_mutex);
+      if (revision > stripe.latest_revision)
+        stripe.latest_revision = revision;
+      if (revision > m_latest_revision)
+        m_latest_revision = revision;
+      stripe.length += amount;
+    }
+    if (!sync)
+      stripe.unsynced = true;
   }
   catch (Exception &e) {
     HT_ERRORF("Problem writing commit log: %s: %s",
-              m_cur_fragment_fname.c_str(), e.what());
+              stripe.fname.c_str(), e.what());
     error = e.code();
   }
 
@@ -489,15 +624,17 @@ void CommitLog::load_cumulative_size_map(CumulativeSizeMap &cumulative_size_map)
   uint32_t distance = 0;
   CumulativeFragmentData frag_data;
 
-  if (m_fd == -1)
+  if (m_closed)
     HT_THROWF(Error::CLOSED, "Commit log '%s' has been closed", m_log_dir.c_str());
 
   memset(&frag_data, 0, sizeof(frag_data));
 
-  if (m_latest_revision != TIMESTAMP_MIN) {
-    frag_data.size = m_cur_fragment_length;
-    frag_data.fragno = m_cur_fragment_num;
-    cumulative_size_map[m_latest_revision] = frag_data;
+  foreach_ht (const Stripe &stripe, m_stripes) {
+    if (stripe.latest_revision != TIMESTAMP_MIN) {
+      frag_data.size = stripe.length;
+      frag_data.fragno = stripe.num;
+      cumulative_size_map[stripe.latest_revision] = frag_data;
+    }
   }
 
   for (std::deque<CommitLogFileInfo *>::reverse_iterator iter
@@ -520,7 +657,7 @@ void CommitLog::load_cumulative_size_map(CumulativeSizeMap &cumulative_size_map)
 void CommitLog::get_stats(const String &prefix, String &result) {
   ScopedLock lock(m_mutex);
 
-  if (m_fd == -1)
+  if (m_closed)
     HT_THROWF(Error::CLOSED, "Commit log '%s' has been closed", m_log_dir.c_str());
 
   try {
@@ -529,9 +666,11 @@ void CommitLog::get_stats(const String &prefix, String &result) {
       result += prefix + String("-log-fragment[") + frag->num + "]\trevision\t" + frag->revision + "\n";
       result += prefix + String("-log-fragment[") + frag->num + "]\tdir\t" + frag->log_dir + "\n";
     }
-    result += prefix + String("-log-fragment[") + m_cur_fragment_num + "]\tsize\t" + m_cur_fragment_length + "\n";
-    result += prefix + String("-log-fragment]") + m_cur_fragment_num + "]\trevision\t" + m_latest_revision + "\n";
-    result += prefix + String("-log-fragment]") + m_cur_fragment_num + "]\tdir\t" + m_log_dir + "\n";
+    foreach_ht (const Stripe &stripe, m_stripes) {
+      result += prefix + String("-log-fragment[") + stripe.num + "]\tsize\t" + stripe.length + "\n";
+      result += prefix + String("-log-fragment]") + stripe.num + "]\trevision\t" + stripe.latest_revision + "\n";
+      result += prefix + String("-log-fragment]") + stripe.num + "]\tdir\t" + stripe.dir + "\n";
+    }
   }
   catch (Hypertable::Exception &e) {
     HT_ERROR_OUT << "Problem getting stats for log fragments" << HT_END;
@@ -25,6 +25,7 @@
 #include <deque>
 #include <map>
 #include <stack>
+#include <vector>
 
 #include <boost/thread/xtime.hpp>
 
@@ -62,6 +63,16 @@ namespace Hypertable {
    *<pre>
    * Hypertable.RangeServer.CommitLog.RollLimit
    *</pre>
+   *
+   * A log can be striped across several directories, each of which may be
+   * placed on a different disk.  Stripe 0 is the log directory itself and
+   * stripe <i>n</i> is the <code>stripe.</code><i>n</i> subdirectory of it.
+   * Every stripe has its own open fragment, lock and compressor, writes are
+   * spread round-robin across the stripes and proceed in parallel (including
+   * synchronous appends), and sync() flushes the stripes in parallel.  Fragment
+   * numbers are allocated from a single counter so they are unique across
+   * all stripes of the log, which lets CommitLogReader and recovery treat the
+   * fragments of all stripes as fragments of one log.
    */
 
   class CommitLog : public CommitLogBase {
@@ -77,12 +88,13 @@ namespace Hypertable {
      * @param props reference to properties map
      * @param init_log base log to pull fragments from
      * @param is_meta true for root, system and metadata logs
+     * @param stripes number of directories to spread writes across
      */
     CommitLog(FilesystemPtr &fs, const String &log_dir,
               PropertiesPtr &props, CommitLogBase *init_log = 0,
-              bool is_meta=true)
+              bool is_meta=true, size_t stripes=1)
       : CommitLogBase(log_dir), m_fs(fs) {
-      initialize(log_dir, props, init_log, is_meta);
+      initialize(log_dir, props, init_log, is_meta, stripes);
     }
 
     /**
@@ -112,7 +124,9 @@ namespace Hypertable {
      */
     int write(DynamicBuffer &buffer, int64_t revision, bool sync=true);
 
-    /** Sync previous updates written to commit log.
+    /** Sync previous updates written to commit log.  When the log is
+     * striped, all stripes written to since the last sync are flushed
+     * concurrently.
      *
      * @return Error::OK on success or error code on failure
      */
@@ -181,30 +195,87 @@ namespace Hypertable {
 
     String get_current_fragment_file() {
       ScopedLock lock(m_mutex);
-      return m_cur_fragment_fname;
+      return m_stripes[0].fname;
     }
 
+    /**
+     * Returns the number of stripes of the log
+     */
+    size_t get_stripe_count() { return m_stripes.size(); }
+
+    /**
+     * Returns the directory of a stripe
+     *
+     * @param log_dir directory of the commit log
+     * @param stripe stripe number
+     * @return directory holding the fragments of the stripe
+     */
+    static String stripe_dir(const String &log_dir, size_t stripe);
+
+    /**
+     * Checks if a directory entry of a log directory is a stripe directory
+     *
+     * @param name name of the directory entry
+     * @return true if <code>name</code> is of the form stripe.<i>n</i>
+     */
+    static bool is_stripe_dir(const String &name);
+
     static const char MAGIC_DATA[10];
     static const char MAGIC_LINK[10];
 
   private:
-    void initialize(const String &log_dir,
-                    PropertiesPtr &, CommitLogBase *init_log, bool is_meta);
-    int roll(CommitLogFileInfo **clfip=0);
-    int compress_and_write(DynamicBuffer &input, BlockCompressionHeader *header,
+
+    /** Open fragment of one stripe of the log.
+     * Writes to different stripes proceed in parallel: #mutex serializes
+     * compressing, appending to and rolling the fragment of this stripe,
+     * while the log's <code>m_mutex</code> only covers stripe selection and
+     * state shared by all stripes.  <code>fd</code>, <code>needs_roll</code>
+     * and <code>unsynced</code> are protected by #mutex alone.
+     * <code>fname</code>, <code>length</code>, <code>num</code> and
+     * <code>latest_revision</code> are modified with both locks held (#mutex
+     * first), so they may be read holding either one.
+     */
+    struct Stripe {
+      Stripe() : compressor(0), fd(-1), length(0), num(0),
+                 latest_revision(TIMESTAMP_MIN), needs_roll(false),
+                 unsynced(false) { }
+      Mutex    mutex;
+      BlockCompressionCodec *compressor;
+      String   dir;
+      String   fname;
+      int32_t  fd;
+      int64_t  length;
+      uint32_t num;
+      int64_t  latest_revision;
+      bool     needs_roll;
+      bool     unsynced;
+    };
+
+    void initialize(const String &log_dir, PropertiesPtr &,
+                    CommitLogBase *init_log, bool is_meta, size_t stripes);
+    /** Closes the open fragment of a stripe and opens a new one.
+     * Must be called with <code>stripe.mutex</code> locked and
+     * <code>m_mutex</code> unlocked.
+     */
+    int roll(Stripe &stripe, CommitLogFileInfo **clfip=0);
+
+    /** Compresses a block and appends it to the fragment of a stripe.
+     * Must be called with <code>stripe.mutex</code> locked and
+     * <code>m_mutex</code> unlocked.
+     */
+    int compress_and_write(Stripe &stripe, DynamicBuffer &input,
+                           BlockCompressionHeader *header,
                            int64_t revision, bool sync);
     void remove_file_info(CommitLogFileInfo *fi, StringSet &removed_logs);
 
     FilesystemPtr           m_fs;
     std::set<CommitLogFileInfo *> m_reap_set;
-    BlockCompressionCodec  *m_compressor;
-    String                  m_cur_fragment_fname;
-    int64_t                 m_cur_fragment_length;
+    std::vector<Stripe>     m_stripes;
+    size_t                  m_next_stripe;
     int64_t                 m_max_fragment_size;
-    uint32_t                m_cur_fragment_num;
-    int32_t                 m_fd;
+    uint32_t                m_next_fragment_num;
     int32_t                 m_replication;
-    bool                    m_needs_roll;
+    bool                    m_closed;
   };
 
   typedef intrusive_ptr<CommitLog> CommitLogPtr;
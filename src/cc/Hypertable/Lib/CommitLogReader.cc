@@ -62,6 +62,11 @@ namespace {
       return num_x < num_y;
     }
   };
+  struct LtFragmentNumber {
+    bool operator()(const CommitLogFileInfo *x, const CommitLogFileInfo *y) const {
+      return x->num < y->num;
+    }
+  };
 }
 
 CommitLogReader::CommitLogReader(FilesystemPtr &fs, const String &log_dir)
@@ -210,6 +215,7 @@ CommitLogReader::next(const uint8_t **blockp, size_t *lenp,
 
 void CommitLogReader::load_fragments(String log_dir, CommitLogFileInfo *parent) {
   vector<Filesystem::Dirent> listing;
+  vector<String> stripe_dirs;
   CommitLogFileInfo *fi;
   int mark = -1;
 
@@ -246,9 +252,14 @@ void CommitLogReader::load_fragments(String log_dir, CommitLogFileInfo *parent)
       continue;
     }
 
+    if (log_dir == m_log_dir && CommitLog::is_stripe_dir(listing[i].name)) {
+      stripe_dirs.push_back(log_dir + "/" + listing[i].name);
+      continue;
+    }
+
     char *endptr;
     long num = strtol(listing[i].name.c_str(), &endptr, 10);
-    if (m_fragment_filter.size() && log_dir == m_log_dir &&
+    if (m_fragment_filter.size() && parent == 0 &&
       m_fragment_filter.find(num) == m_fragment_filter.end()) {
       if (m_verbose)
         HT_INFOF("Dropping log fragment %s/%ld because it is filtered",
@@ -280,6 +291,16 @@ void CommitLogReader::load_fragments(String log_dir, CommitLogFileInfo *parent)
     }
   }
 
+  // Fragments of the other stripes of a striped log are top level fragments
+  // of this log; fragment numbers are unique across the stripes, so merging
+  // them by number keeps the queue in the order the fragments were opened
+  if (!stripe_dirs.empty()) {
+    foreach_ht (const String &stripe_dir, stripe_dirs)
+      load_fragments(stripe_dir, 0);
+    stable_sort(m_fragment_queue.begin(), m_fragment_queue.end(),
+                LtFragmentNumber());
+  }
+
   if (mark != -1) {
     if (m_fragment_queue.empty() || mark < (int)m_fragment_queue.front()->num) {
       String mark_filename;
@@ -73,6 +73,7 @@ namespace {
     "DESTROY SCANNER ....... Destroys a scanner",
     "DROP RANGE ............ Drop a range",
     "FETCH SCANBLOCK ....... Fetch the next block results of a scan",
+    "LATENCY ............... Display request and phase latency percentiles",
     "LOAD RANGE ............ Load a range",
     "METADATA SYNC ......... Sync METADATA table with RSML data",
     "REPLAY START .......... Start replay",
@@ -293,6 +294,20 @@ namespace {
     0
   };
 
+  const char *help_text_latency[] = {
+    "",
+    "LATENCY",
+    "",
+    "This command displays latency percentiles of the requests the",
+    "RangeServer has carried out since the previous statistics request",
+    "(from this command or from the Master's monitoring), and of the phases",
+    "these requests went through (queue wait, commit log write and sync,",
+    "cell cache add, block cache miss, block read and decompression).",
+    "Times are in microseconds and percentiles are accurate to about 6%.",
+    "",
+    0
+  };
+
   const char *help_text_shutdown_server[] = {
     "",
     "SHUTDOWN",
@@ -392,6 +407,7 @@ namespace {
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
+    "      | prefix [ bloom_filter_options ]",
     "      | none ",
     "",
     "    bloom_filter_options:",
@@ -399,6 +415,8 @@ namespace {
     "      --bits-per-item float",
     "      --num-hashes int",
     "      --max-approx-items int",
+    "      --prefix-length int",
+    "      --prefix-delimiter char",
     "",
     "Description",
     "-----------",
@@ -530,6 +548,7 @@ namespace {
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
+    "      | prefix [ bloom_filter_options ]",
     "      | none ",
     "",
     "    bloom_filter_options:",
@@ -537,6 +556,8 @@ namespace {
     "      --bits-per-item float",
     "      --num-hashes int",
     "      --max-approx-items int",
+    "      --prefix-length int",
+    "      --prefix-delimiter char",
     "",
     "    table_option:",
     "      MAX_VERSIONS int",
@@ -798,11 +819,14 @@ namespace {
     "The bloom filter specification can take one of the following forms.  The rows",
     "form, which is the default, causes only row keys to be inserted into the bloom",
     "filter.  The rows+cols form causes the row key concatenated with the column",
-    "family to be inserted into the bloom filter.  none disables the bloom",
-    "filter.",
+    "family to be inserted into the bloom filter.  The prefix form causes a row",
+    "prefix, defined by --prefix-length or --prefix-delimiter, to be inserted into",
+    "the bloom filter, which allows prefix scans and scans over small row",
+    "intervals to skip cell stores.  none disables the bloom filter.",
     "",
     "  * rows [ bloom_filter_options ]",
     "  * rows+cols [ bloom_filter_options ]",
+    "  * prefix [ bloom_filter_options ]",
     "  * none",
     "",
     "The following describes the bloom filter options:",
@@ -825,6 +849,14 @@ namespace {
     "  --max-approx-items arg  Number of cell store items used to guess the number",
     "                          of actual bloom filter entries (default = 1000)",
     "",
+    "  --prefix-length arg     Number of leading row key bytes inserted into the",
+    "                          bloom filter in prefix mode",
+    "",
+    "  --prefix-delimiter arg  Character that ends the row prefix inserted into",
+    "                          the bloom filter in prefix mode.  The prefix",
+    "                          includes the delimiter and is cut to",
+    "                          --prefix-length bytes if that is also given",
+    "",
     "Compressors",
     "-----------",
     "",
@@ -2091,6 +2123,7 @@ void HqlHelpText::install_range_server_client_text() {
   text_map["fetch scanblock"] = help_text_fetch_scanblock;
   text_map["load"] = help_text_load_range;
   text_map["load range"] = help_text_load_range;
+  text_map["latency"] = help_text_latency;
   text_map["metadata"] = help_text_metadata_sync;
   text_map["metadata sync"] = help_text_metadata_sync;
   text_map["update"] = help_text_update;
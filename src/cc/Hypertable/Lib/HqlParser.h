@@ -109,6 +109,7 @@ namespace Hypertable {
       COMMAND_STOP,
       COMMAND_DUMP_PSEUDO_TABLE,
       COMMAND_SET,
+      COMMAND_LATENCY,
       COMMAND_MAX
     };
 
@@ -2119,6 +2120,7 @@ namespace Hypertable {
           Token FOR          = as_lower_d["for"];
           Token MAINTENANCE  = as_lower_d["maintenance"];
           Token HEAPCHECK    = as_lower_d["heapcheck"];
+          Token LATENCY      = as_lower_d["latency"];
           Token ALGORITHM    = as_lower_d["algorithm"];
           Token COMPACT      = as_lower_d["compact"];
           Token ALL          = as_lower_d["all"];
@@ -2222,6 +2224,7 @@ namespace Hypertable {
             | wait_for_maintenance_statement[set_command(self.state, COMMAND_WAIT_FOR_MAINTENANCE)]
             | balance_statement[set_command(self.state, COMMAND_BALANCE)]
             | heapcheck_statement[set_command(self.state, COMMAND_HEAPCHECK)]
+            | latency_statement[set_command(self.state, COMMAND_LATENCY)]
             | compact_statement[set_command(self.state, COMMAND_COMPACT)]
             | metadata_sync_statement[set_command(self.state, COMMAND_METADATA_SYNC)]
             | stop_statement[set_command(self.state, COMMAND_STOP)]
@@ -2284,6 +2287,10 @@ namespace Hypertable {
             = HEAPCHECK >> *(string_literal[set_output_file(self.state)])
             ;
 
+          latency_statement
+            = LATENCY
+            ;
+
           balance_statement
             = BALANCE >> !(ALGORITHM >> EQUAL >> user_identifier[set_balance_algorithm(self.state)])
               >> *(range_move_spec_list)
@@ -2981,6 +2988,7 @@ namespace Hypertable {
           BOOST_SPIRIT_DEBUG_RULE(range_move_spec_list);
           BOOST_SPIRIT_DEBUG_RULE(range_move_spec);
           BOOST_SPIRIT_DEBUG_RULE(heapcheck_statement);
+          BOOST_SPIRIT_DEBUG_RULE(latency_statement);
           BOOST_SPIRIT_DEBUG_RULE(compact_statement);
           BOOST_SPIRIT_DEBUG_RULE(compact_type_option);
           BOOST_SPIRIT_DEBUG_RULE(compaction_type);
@@ -3032,7 +3040,8 @@ namespace Hypertable {
           replay_commit_statement, cell_interval, cell_predicate,
           cell_spec, wait_for_maintenance_statement, move_range_statement,
           balance_statement, range_move_spec_list, range_move_spec,
-          balance_option_spec, heapcheck_statement, compact_statement,
+          balance_option_spec, heapcheck_statement, latency_statement,
+          compact_statement,
           compact_type_option, compaction_type,
           metadata_sync_statement, metadata_sync_option_spec, stop_statement,
           range_type, table_identifier, pseudo_table_reference,
@@ -0,0 +1,187 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for IndexScanPlanner.
+ * This file contains definitions for IndexScanPlanner, a class that decides
+ * whether a scan with column or qualifier predicates is answered through a
+ * secondary index or with a full scan of the primary table.
+ */
+
+#include <Common/Compat.h>
+
+#include "IndexScanPlanner.h"
+#include "Key.h"
+
+#include <Common/Logger.h>
+#include <Common/Mutex.h>
+#include <Common/Time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+
+using namespace Hypertable;
+
+namespace {
+
+  /// %Mutex protecting #plan_stats
+  Mutex stats_mutex;
+
+  /// Accumulated per-plan counters
+  IndexScanPlanner::Statistics plan_stats[IndexScanPlanner::PLAN_COUNT];
+
+  /// Minimum number of index ranges of a column needed for an estimate
+  const uint32_t MIN_ESTIMATE_RANGES = 2;
+
+}
+
+IndexScanPlanner::IndexScanPlanner(const String &index_table_name,
+                                   PropertiesPtr &props)
+  : m_index_table_name(index_table_name), m_selectivity(0.0) {
+  m_selectivity_threshold =
+    props->get_f64("Hypertable.Scanner.Index.SelectivityThreshold");
+  m_max_probe_ranges = props->get_i32("Hypertable.Scanner.Index.MaxProbeRanges");
+}
+
+
+IndexScanPlanner::Plan
+IndexScanPlanner::choose(const ScanSpec &primary_spec,
+                         const ScanSpec &index_spec,
+                         RangeFinder &index_ranges) {
+  int64_t start_ns = get_ts64();
+  uint32_t matched = 0, total = 0;
+  bool total_truncated = false;
+  Plan plan = INDEX_SCAN;
+
+  if (full_scan_possible(primary_spec)) {
+    try {
+      std::set<int> column_ids;
+      bool truncated;
+      foreach_ht (const RowInterval &ri, index_spec.row_intervals) {
+        matched += count_ranges(index_ranges, ri.start, ri.end, &truncated);
+        // Index rows are prefixed with "<column id>,"; all entries for a
+        // column lie in ["<id>,", "<id>-")
+        int id = atoi(ri.start);
+        if (column_ids.insert(id).second) {
+          total += count_ranges(index_ranges, format("%d,", id),
+                                format("%d-", id).c_str(), &truncated);
+          if (truncated)
+            total_truncated = true;
+        }
+      }
+    }
+    catch (Exception &e) {
+      HT_WARNF("Unable to estimate selectivity of index '%s' - %s",
+               m_index_table_name.c_str(), e.what());
+      matched = total = 0;
+    }
+
+    // the real total is unknown if its count was truncated, so matched
+    // cannot be compared to it
+    if (!total_truncated && total >= MIN_ESTIMATE_RANGES) {
+      m_selectivity = std::min(1.0, (double)matched / (double)total);
+      // a predicate that falls within a single index range is always cheap
+      if (matched > 1 && m_selectivity > m_selectivity_threshold)
+        plan = FULL_SCAN;
+    }
+  }
+
+  int64_t elapsed_us = (get_ts64() - start_ns) / 1000;
+
+  HT_DEBUGF("Plan for scan of '%s' is %s (selectivity=%.3f, %u of %u%s index "
+            "ranges, planning took %lld usec)", m_index_table_name.c_str(),
+            plan_name(plan), m_selectivity, (unsigned)matched, (unsigned)total,
+            total_truncated ? "+" : "", (Lld)elapsed_us);
+
+  ScopedLock lock(stats_mutex);
+  plan_stats[plan].plans++;
+  plan_stats[plan].plan_time += elapsed_us;
+  return plan;
+}
+
+
+bool IndexScanPlanner::full_scan_possible(const ScanSpec &spec) {
+  if (spec.column_predicates.empty() || spec.columns.empty())
+    return true;
+  CstrSet predicate_columns;
+  foreach_ht (const ColumnPredicate &predicate, spec.column_predicates)
+    predicate_columns.insert(predicate.column_family);
+  foreach_ht (const char *column, spec.columns) {
+    if (predicate_columns.count(column) == 0)
+      return false;
+  }
+  return true;
+}
+
+
+void IndexScanPlanner::record_scan(Plan plan, int64_t start_ns) {
+  int64_t elapsed_us = (get_ts64() - start_ns) / 1000;
+  ScopedLock lock(stats_mutex);
+  plan_stats[plan].scans++;
+  plan_stats[plan].scan_time += elapsed_us;
+}
+
+
+void IndexScanPlanner::get_statistics(Plan plan, Statistics &stats) {
+  HT_ASSERT(plan < PLAN_COUNT);
+  ScopedLock lock(stats_mutex);
+  stats = plan_stats[plan];
+}
+
+
+const char *IndexScanPlanner::plan_name(Plan plan) {
+  switch (plan) {
+  case INDEX_SCAN:
+    return "INDEX_SCAN";
+  case FULL_SCAN:
+    return "FULL_SCAN";
+  default:
+    break;
+  }
+  return "UNKNOWN";
+}
+
+
+uint32_t IndexScanPlanner::count_ranges(RangeFinder &index_ranges,
+                                        const String &start_row,
+                                        const char *end_row, bool *truncatedp) {
+  RangeLocationInfo range_info;
+  String row = start_row;
+  uint32_t count = 0;
+
+  if (end_row == 0 || *end_row == 0)
+    end_row = Key::END_ROW_MARKER;
+
+  *truncatedp = true;
+  while (count < m_max_probe_ranges) {
+    index_ranges.find(row.c_str(), &range_info);
+    count++;
+    if (strcmp(range_info.end_row.c_str(), end_row) >= 0) {
+      *truncatedp = false;
+      break;
+    }
+    // construct row key in next range
+    row = range_info.end_row;
+    row.append(1, 1);
+  }
+  return count;
+}
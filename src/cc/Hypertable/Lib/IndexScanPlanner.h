@@ -0,0 +1,171 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for IndexScanPlanner.
+ * This file contains declarations for IndexScanPlanner, a class that decides
+ * whether a scan with column or qualifier predicates is answered through a
+ * secondary index or with a full scan of the primary table.
+ */
+
+#ifndef HYPERTABLE_INDEXSCANPLANNER_H
+#define HYPERTABLE_INDEXSCANPLANNER_H
+
+#include <Common/Properties.h>
+
+#include "RangeFinder.h"
+#include "ScanSpec.h"
+
+namespace Hypertable {
+
+  /** @addtogroup libHypertable
+   * @{
+   */
+
+  /** Chooses the access path for scans that can use a secondary index.
+   * Selectivity is estimated from the index table's range boundaries, which
+   * the RangeLocator caches anyway: the planner counts the ranges spanned by
+   * the index row intervals of the query and compares that to the number of
+   * ranges holding index entries for the same column(s).  If the query
+   * covers more than
+   * <code>Hypertable.Scanner.Index.SelectivityThreshold</code> of them, the
+   * index is not worth the additional round trip and the primary table is
+   * scanned directly, with the predicates evaluated by the range servers.
+   *
+   * Range counts are capped at
+   * <code>Hypertable.Scanner.Index.MaxProbeRanges</code>.  If the count of
+   * index ranges of the column was truncated by the cap, its real total is
+   * unknown and the query cannot be shown to cover most of it, so the index
+   * is used.  The index is also used if the entries of the column fit in a
+   * single range, since no estimate is possible.
+   *
+   * Number, planning time and execution time of every plan are accumulated
+   * in process-wide counters which can be read with get_statistics().
+   */
+  class IndexScanPlanner {
+  public:
+
+    /// Access path
+    enum Plan {
+      /// Scan index table, then fetch matching rows from primary table
+      INDEX_SCAN = 0,
+      /// Scan primary table, filtering with the predicates
+      FULL_SCAN,
+      /// Number of plans
+      PLAN_COUNT
+    };
+
+    /// Accumulated counters for one plan
+    struct Statistics {
+      Statistics() : plans(0), plan_time(0), scans(0), scan_time(0) { }
+      /// Number of times the plan was chosen
+      uint64_t plans;
+      /// Time spent choosing the plan (microseconds)
+      uint64_t plan_time;
+      /// Number of completed scans
+      uint64_t scans;
+      /// Time from creation to completion of the scans (microseconds)
+      uint64_t scan_time;
+    };
+
+    /** Constructor.
+     * @param index_table_name Name of the index table that would answer the
+     *        query
+     * @param props Properties holding the planner settings
+     *        (<code>Hypertable.Scanner.Index.*</code>)
+     */
+    IndexScanPlanner(const String &index_table_name, PropertiesPtr &props);
+
+    /** Chooses the access path.
+     * A full scan is only chosen if it is valid for
+     * <code>primary_spec</code> (see full_scan_possible()).
+     * @param primary_spec Scan specification issued against the primary table
+     * @param index_spec Scan specification for the index table
+     * @param index_ranges Finds the ranges of the index table
+     * @return Chosen plan
+     */
+    Plan choose(const ScanSpec &primary_spec, const ScanSpec &index_spec,
+                RangeFinder &index_ranges);
+
+    /** Returns estimated fraction of the index entries covered by the
+     * query; valid after choose().
+     * @return Estimated selectivity (0.0 if no estimate was possible)
+     */
+    double get_selectivity() const { return m_selectivity; }
+
+    /** Returns <i>true</i> if <code>spec</code> can be answered by a full
+     * scan.  Such a scan requires every selected column to be referenced by a
+     * column predicate (see TableScannerAsync::transform_primary_scan_spec).
+     * @param spec Scan specification issued against the primary table
+     * @return <i>true</i> if full scan is possible, <i>false</i> otherwise
+     */
+    static bool full_scan_possible(const ScanSpec &spec);
+
+    /** Records completion of a scan.
+     * @param plan Plan used by the scan
+     * @param start_ns Time the scan was created (see get_ts64())
+     */
+    static void record_scan(Plan plan, int64_t start_ns);
+
+    /** Returns accumulated counters for a plan.
+     * @param plan Plan
+     * @param stats Filled in with the counters
+     */
+    static void get_statistics(Plan plan, Statistics &stats);
+
+    /** Returns printable name of a plan.
+     * @param plan Plan
+     * @return Name of plan
+     */
+    static const char *plan_name(Plan plan);
+
+  private:
+
+    /** Counts the index ranges overlapping [<code>start_row</code>,
+     * <code>end_row</code>), up to #m_max_probe_ranges.
+     * @param index_ranges Finds the ranges of the index table
+     * @param start_row Start row (inclusive)
+     * @param end_row End row (exclusive)
+     * @param truncatedp Set to <i>true</i> if counting stopped at
+     * #m_max_probe_ranges before reaching <code>end_row</code>
+     * @return Number of ranges
+     */
+    uint32_t count_ranges(RangeFinder &index_ranges, const String &start_row,
+                          const char *end_row, bool *truncatedp);
+
+    /// Name of index table
+    String m_index_table_name;
+
+    /// Fraction of index above which a full scan is used
+    double m_selectivity_threshold;
+
+    /// Maximum number of ranges counted per interval
+    uint32_t m_max_probe_ranges;
+
+    /// Estimated selectivity
+    double m_selectivity;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_INDEXSCANPLANNER_H
@@ -28,7 +28,9 @@
 #include <boost/thread/condition.hpp>
 
 #include "Common/Filesystem.h"
+#include "Common/Time.h"
 #include "HyperAppHelper/Unique.h"
+#include "IndexScanPlanner.h"
 #include "ResultCallback.h"
 #include "TableScannerAsync.h"
 #include "ScanSpec.h"
@@ -88,7 +90,7 @@ static String last;
         m_cell_offset(0), m_row_count(0), m_cell_limit_per_family(0), 
         m_eos(false), m_limits_reached(false), m_readahead_count(0), 
         m_qualifier_scan(qualifier_scan), m_tmp_cutoff(0), 
-        m_final_decrement(false), m_shutdown(false) {
+        m_final_decrement(false), m_shutdown(false), m_start_ns(get_ts64()) {
       atomic_set(&m_outstanding_scanners, 0);
       m_original_cb->increment_outstanding();
 
@@ -255,6 +257,8 @@ static String last;
           m_original_cb->scan_ok(scanner, empty);
           m_original_cb->decrement_outstanding();
           m_final_decrement = true;
+          IndexScanPlanner::record_scan(IndexScanPlanner::INDEX_SCAN,
+                                        m_start_ns);
         }
       }
     }
@@ -394,10 +398,12 @@ static String last;
         ssb.set_time_interval(primary_spec.time_interval.first, 
                               primary_spec.time_interval.second);
 
-        // Add row interval for each entry returned from index
+        // Add row interval for each entry returned from index; the rows
+        // are fetched with rowset scans, batched per range server
         for (CkeyMap::iterator it = m_tmp_keys.begin(); 
                 it != m_tmp_keys.end(); ++it) 
           ssb.add_row((const char *)it->first.row);
+        ssb.set_scan_and_filter_rows(true);
 
         s = m_primary_table->create_scanner_async(this, ssb.get(), 
                 m_timeout_ms, Table::SCANNER_FLAG_IGNORE_INDEX);
@@ -518,6 +524,7 @@ static String last;
         // then add the key to the ScanSpec
         ssb->add_row(cell.row_key);
       } 
+      ssb->set_scan_and_filter_rows(true);
  
       // store the "last" pointer before it goes out of scope
       m_last_rowkey_verify = last;
@@ -799,6 +806,9 @@ static String last;
 
     // shutting down this scanner?
     bool m_shutdown;
+
+    // creation time, for the IndexScanPlanner statistics
+    int64_t m_start_ns;
   };
 
   typedef intrusive_ptr<IndexScannerCallback> IndexScannerCallbackPtr;
@@ -26,6 +26,8 @@
 #include "Common/Error.h"
 #include "Common/String.h"
 
+#include "AsyncComm/CommHeader.h"
+
 #include "Key.h"
 #include "IntervalScannerAsync.h"
 #include "Table.h"
@@ -60,6 +62,9 @@ IntervalScannerAsync::IntervalScannerAsync(Comm *comm, ApplicationQueueInterface
 
   HT_ASSERT(m_timeout_ms);
 
+  m_stream_window =
+    table->get_properties()->get_i32("Hypertable.Scanner.StreamWindow");
+
   table->get(m_table_identifier, m_schema);
   init(scan_spec);
 }
@@ -88,6 +93,7 @@ void IntervalScannerAsync::init(const ScanSpec &scan_spec) {
   m_scan_spec_builder.set_row_offset(scan_spec.row_offset);
   m_scan_spec_builder.set_cell_offset(scan_spec.cell_offset);
   m_scan_spec_builder.set_do_not_cache(scan_spec.do_not_cache);
+  m_scan_spec_builder.set_aggregate(scan_spec.aggregate);
 
   foreach_ht (const ColumnPredicate &cp, scan_spec.column_predicates)
     m_scan_spec_builder.add_column_predicate(cp.column_family,
@@ -309,6 +315,24 @@ bool IntervalScannerAsync::abort(bool is_create) {
   return move_to_next;
 }
 
+bool IntervalScannerAsync::abort(bool is_create, EventPtr &event) {
+  if (is_partial_stream_result(event, is_create)) {
+    m_eos = true;
+    m_state = ABORTED;
+    return false;
+  }
+  return abort(is_create);
+}
+
+bool IntervalScannerAsync::is_partial_stream_result(EventPtr &event,
+                                                    bool is_create) {
+  if (is_create || (event->header.flags & CommHeader::FLAGS_BIT_STREAM) == 0)
+    return false;
+  // more scan blocks will be pushed in response to the same request
+  HT_ASSERT(m_stream_window && m_fetch_outstanding);
+  return true;
+}
+
 bool IntervalScannerAsync::is_destroyed_scanner(bool is_create) {
   // handle case where row limit was hit and scanner was cancelled but fetch request is
   // still outstanding
@@ -418,13 +442,16 @@ void IntervalScannerAsync::set_range_spec(DynamicBuffer &dbuf, RangeSpec &range)
 
 bool IntervalScannerAsync::handle_result(bool *show_results, ScanCellsPtr &cells,
     EventPtr &event, bool is_create) {
+  bool partial = is_partial_stream_result(event, is_create);
 
-  reset_outstanding_status(is_create, true);
+  if (!partial)
+    reset_outstanding_status(is_create, true);
 
   // deal with outstanding fetch/create for aborted scanner
   if (m_eos) {
-    if (m_state == ABORTED)
-      // scan was aborted caller shd have shown error on first occurrence
+    if (m_state == ABORTED || partial)
+      // scan was aborted caller shd have shown error on first occurrence,
+      // or the eos marker is sent with the last block of the stream
       *show_results = false;
     else {
       // scan is over but there was a create/fetch outstanding, send a ScanCells with 0 cells
@@ -609,13 +636,22 @@ void IntervalScannerAsync::do_readahead() {
 
   // if the current scanner is not finished
   if (!m_cur_scanner_finished) {
-    HT_ASSERT(!m_fetch_outstanding && !m_eos && m_current);
+    HT_ASSERT(!m_eos && m_current);
+    // a stream request may still be pushing scan blocks
+    HT_ASSERT(!m_fetch_outstanding || m_stream_window);
     // request next scanblock and block
     try {
-      m_fetch_timer.start();
-      m_fetch_outstanding = true;
-      m_range_server.fetch_scanblock(m_range_info.addr, m_cur_scanner_id,
-                                     &m_fetch_handler, m_fetch_timer);
+      if (!m_fetch_outstanding) {
+        m_fetch_timer.start();
+        m_fetch_outstanding = true;
+        if (m_stream_window)
+          m_range_server.fetch_scanblock_stream(m_range_info.addr,
+                  m_cur_scanner_id, m_stream_window, &m_fetch_handler,
+                  m_fetch_timer);
+        else
+          m_range_server.fetch_scanblock(m_range_info.addr, m_cur_scanner_id,
+                                         &m_fetch_handler, m_fetch_timer);
+      }
     }
     catch (Exception &e) {
       m_fetch_outstanding = false;
@@ -63,6 +63,9 @@ namespace Hypertable {
     virtual ~IntervalScannerAsync();
 
     bool abort(bool is_create);
+    // abort scanner on receipt of a result; a streamed scan block that is
+    // followed by more leaves the fetch outstanding
+    bool abort(bool is_create, EventPtr &event);
     // if we can't retry then abort scanner
     bool retry_or_abort(bool refresh, bool hard, bool is_create, 
             bool *move_to_next, int last_error);
@@ -74,6 +77,7 @@ namespace Hypertable {
 
   private:
     void reset_outstanding_status(bool is_create, bool reset_timer);
+    bool is_partial_stream_result(EventPtr &event, bool is_create);
     void do_readahead();
     void init(const ScanSpec &);
     void find_range_and_start_scan(const char *row_key, bool hard=false);
@@ -115,6 +119,9 @@ namespace Hypertable {
     DynamicBuffer       m_last_key_buf;
     bool                m_create_event_saved;
     bool                m_invalid_scanner_id_ok;
+    /// Number of scan blocks requested per "fetch scanblock stream" request,
+    /// 0 to fetch one block per request
+    uint32_t            m_stream_window;
   };
 
   typedef intrusive_ptr<IntervalScannerAsync> IntervalScannerAsyncPtr;
@@ -20,28 +20,74 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
 #include "Common/InetAddr.h"
+#include "Common/Time.h"
 
 #include "LocationCache.h"
 
 using namespace Hypertable;
 using namespace std;
 
+
+namespace {
+
+  typedef boost::shared_lock<boost::shared_mutex> SharedLock;
+  typedef boost::unique_lock<boost::shared_mutex> ExclusiveLock;
+
+  /// Maximum number of negative entries per partition
+  const size_t MAX_NEGATIVE_ENTRIES = 1024;
+
+  /// Number of locations of an unstriped table in its partition above
+  /// which the table is striped
+  const uint64_t MIN_STRIPE_ENTRIES = 64;
+
+  String negative_key(const char *table_name, const char *rowkey) {
+    String key(table_name);
+    key += ':';
+    if (rowkey)
+      key += rowkey;
+    return key;
+  }
+
+  bool more_recent(const LocationCache::Value *x, const LocationCache::Value *y) {
+    return x->last_use.load() > y->last_use.load();
+  }
+
+  /// Orders locations by end row, the end of the table last
+  bool end_row_lt(const LocationCache::Value *x, const LocationCache::Value *y) {
+    if (y->end_row.empty())
+      return !x->end_row.empty();
+    return !x->end_row.empty() && x->end_row < y->end_row;
+  }
+
+}
+
+
+LocationCache::LocationCache(uint32_t max_entries, size_t partitions,
+                             uint32_t negative_ttl_ms)
+  : m_stripes(new StripeMap()), m_entries(0), m_max_entries(max_entries),
+    m_negative_ttl_ns((int64_t)negative_ttl_ms * 1000000LL) {
+  if (partitions == 0)
+    partitions = 1;
+  for (size_t i=0; i<partitions; i++)
+    m_partitions.push_back(new Partition());
+}
+
 /**
  * Insert
  */
 void
 LocationCache::insert(const char *table_name, RangeLocationInfo &range_loc_info,
                       bool pegged) {
-  ScopedLock lock(m_mutex);
-  Value *newval = new Value;
-  LocationMap::iterator iter;
-  LocationCacheKey key;
+  const CommAddress *addrp;
+  const char *end_row;
+  uint64_t table_entries, split_entries;
 
   assert(table_name);
 
@@ -50,48 +96,88 @@ LocationCache::insert(const char *table_name, RangeLocationInfo &range_loc_info,
       << " location=" << location << HT_END;
   */
 
+  {
+    ScopedLock lock(m_mutex);
+    addrp = get_constant_address(range_loc_info.addr);
+    table_name = m_strings.get(table_name);
+  }
+
+  end_row = range_loc_info.end_row.empty() ? 0 : range_loc_info.end_row.c_str();
+
+  {
+    ReaderEpoch::Section section(m_stripe_readers);
+    while (true) {
+      StripeMap *stripes = m_stripes.load();
+      Partition &partition = get_partition(stripes, table_name, end_row);
+      ExclusiveLock lock(partition.mutex);
+      // the table was striped again after the partition was picked
+      if (m_stripes.load() != stripes)
+        continue;
+      table_entries = insert(partition, table_name, addrp, range_loc_info,
+                             pegged);
+      const TableStripes *table = get_stripes(stripes, table_name);
+      split_entries = table ? table->split_entries : MIN_STRIPE_ENTRIES;
+      break;
+    }
+  }
+
+  make_room();
+
+  if (m_partitions.size() > 1 && table_entries > split_entries)
+    restripe(table_name);
+}
+
+/**
+ * Inserts a location into a partition, partition lock held; returns the
+ * number of locations of the table in the partition
+ */
+uint64_t
+LocationCache::insert(Partition &partition, const char *table_name,
+                      const CommAddress *addrp,
+                      RangeLocationInfo &range_loc_info, bool pegged) {
+  Value *newval = new Value;
+  LocationMap::iterator iter;
+  LocationCacheKey key;
+
   newval->start_row = range_loc_info.start_row;
   newval->end_row = range_loc_info.end_row;
-  newval->addrp = get_constant_address(range_loc_info.addr);
   newval->pegged = pegged;
+  newval->addrp = addrp;
 
-  key.table_name = m_strings.get(table_name);
+  key.table_name = table_name;
   key.end_row = (range_loc_info.end_row == "") ? 0 : newval->end_row.c_str();
 
   // remove old entry
-  if ((iter = m_location_map.find(key)) != m_location_map.end())
-    remove((*iter).second);
-
-  // make room for the new entry
-  while (m_location_map.size() >= m_max_entries) {
-    if (m_tail->pegged)
-      move_to_head(m_tail);
-    else
-      remove(m_tail);
-  }
+  if ((iter = partition.location_map.find(key)) != partition.location_map.end())
+    remove(partition, (*iter).second);
 
-  // add to head
-  if (m_head == 0) {
-    assert(m_tail == 0);
-    newval->next = newval->prev = 0;
-    m_head = m_tail = newval;
-  }
-  else {
-    m_head->next = newval;
-    newval->prev = m_head;
-    newval->next = 0;
-    m_head = newval;
-  }
+  link(partition, newval, ++partition.clock);
 
   // Insert the new entry into the map, recording an iterator to the entry
   {
     std::pair<LocationMap::iterator, bool> old_entry;
     LocationMap::value_type map_value(key, newval);
-    old_entry = m_location_map.insert(map_value);
+    old_entry = partition.location_map.insert(map_value);
     assert(old_entry.second);
     newval->map_iter = old_entry.first;
   }
+  partition.entries++;
+  m_entries++;
+
+  // drop negative entries for rows covered by the new location
+  if (!partition.negative.empty()) {
+    String prefix = negative_key(table_name, 0);
+    NegativeMap::iterator niter =
+      partition.negative.upper_bound(prefix + range_loc_info.start_row);
+    while (niter != partition.negative.end() &&
+           !niter->first.compare(0, prefix.length(), prefix) &&
+           (range_loc_info.end_row.empty() ||
+            niter->first.compare(prefix.length(), String::npos,
+                                 range_loc_info.end_row) <= 0))
+      partition.negative.erase(niter++);
+  }
 
+  return ++partition.table_entries[table_name];
 }
 
 /**
@@ -101,9 +187,13 @@ LocationCache::~LocationCache() {
   for (AddressSet::iterator iter = m_addresses.begin();
        iter != m_addresses.end(); ++iter)
     delete *iter;
-  for (LocationMap::iterator lm_it = m_location_map.begin();
-       lm_it != m_location_map.end(); ++lm_it)
-    delete (*lm_it).second;
+  foreach_ht (Partition *partition, m_partitions) {
+    for (LocationMap::iterator lm_it = partition->location_map.begin();
+         lm_it != partition->location_map.end(); ++lm_it)
+      delete (*lm_it).second;
+    delete partition;
+  }
+  delete m_stripes.load();
 }
 
 
@@ -113,19 +203,55 @@ LocationCache::~LocationCache() {
 bool
 LocationCache::lookup(const char * table_name, const char *rowkey,
                       RangeLocationInfo *rane_loc_infop, bool inclusive) {
-  ScopedLock lock(m_mutex);
+  assert(table_name);
+
+  // A lookup that races a re-striping may miss, a location it finds is
+  // always the one containing the row
+  ReaderEpoch::Section section(m_stripe_readers);
+  const TableStripes *table = get_stripes(m_stripes.load(), table_name);
+  size_t i = stripe(table, rowkey);
+
+  {
+    Partition &partition = get_partition(table_name, i);
+    SharedLock lock(partition.mutex);
+    if (find(partition, table_name, rowkey, inclusive, rane_loc_infop)) {
+      partition.hits++;
+      return true;
+    }
+    if (!inclusive || table == 0 || i == table->bounds.size() ||
+        table->bounds[i] != rowkey) {
+      partition.misses++;
+      return false;
+    }
+  }
+
+  // the range starting at a stripe bound is held by the next stripe
+  Partition &partition = get_partition(table_name, i + 1);
+  SharedLock lock(partition.mutex);
+  if (find(partition, table_name, rowkey, inclusive, rane_loc_infop)) {
+    partition.hits++;
+    return true;
+  }
+  partition.misses++;
+  return false;
+}
+
+/**
+ * Finds the location of the range containing a row, partition lock held
+ */
+bool
+LocationCache::find(Partition &partition, const char *table_name,
+                    const char *rowkey, bool inclusive,
+                    RangeLocationInfo *rane_loc_infop) {
   LocationMap::iterator iter;
   LocationCacheKey key;
 
-  assert(table_name);
-
   key.table_name = table_name;
   key.end_row = rowkey;
 
-  if ((iter = m_location_map.lower_bound(key)) == m_location_map.end())
-    return false;
-
-  if (strcmp((*iter).first.table_name, table_name))
+  if ((iter = partition.location_map.lower_bound(key)) ==
+      partition.location_map.end() ||
+      strcmp((*iter).first.table_name, table_name))
     return false;
 
   if (inclusive) {
@@ -137,7 +263,7 @@ LocationCache::lookup(const char * table_name, const char *rowkey,
       return false;
   }
 
-  move_to_head((*iter).second);
+  (*iter).second->last_use = ++partition.clock;
 
   rane_loc_infop->start_row = (*iter).second->start_row;
   rane_loc_infop->end_row   = (*iter).second->end_row;
@@ -147,7 +273,6 @@ LocationCache::lookup(const char * table_name, const char *rowkey,
 }
 
 bool LocationCache::invalidate(const char *table_name, const char *rowkey) {
-  ScopedLock lock(m_mutex);
   LocationMap::iterator iter;
   LocationCacheKey key;
 
@@ -158,96 +283,367 @@ bool LocationCache::invalidate(const char *table_name, const char *rowkey) {
   key.table_name = table_name;
   key.end_row = rowkey;
 
-  if ((iter = m_location_map.lower_bound(key)) == m_location_map.end())
-    return false;
+  ReaderEpoch::Section section(m_stripe_readers);
+  while (true) {
+    StripeMap *stripes = m_stripes.load();
+    Partition &partition = get_partition(stripes, table_name, rowkey);
+    ExclusiveLock lock(partition.mutex);
 
-  if (strcmp((*iter).first.table_name, table_name))
-    return false;
+    // the table was striped again after the partition was picked
+    if (m_stripes.load() != stripes)
+      continue;
+
+    if ((iter = partition.location_map.lower_bound(key)) ==
+        partition.location_map.end())
+      return false;
+
+    if (strcmp((*iter).first.table_name, table_name))
+      return false;
 
 #if 0
-  if (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0)
-    return false;
+    if (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0)
+      return false;
 #endif
-  if ((rowkey == 0 && !(*iter).second->start_row.empty()) ||
-      (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0))
-    return false;
+    if ((rowkey == 0 && !(*iter).second->start_row.empty()) ||
+        (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0))
+      return false;
 
-  remove((*iter).second);
-  return true;
+    remove(partition, (*iter).second);
+    return true;
+  }
 }
 
 void LocationCache::invalidate_host(const String &hostname) {
-  ScopedLock lock(m_mutex);
   CommAddress addr;
+  const CommAddress *addrp;
 
   addr.set_proxy(hostname);
-  const CommAddress *addrp = get_constant_address(addr);
-
-  LocationMap::iterator iter = m_location_map.begin();
-  Value *val = 0;
-  while (iter != m_location_map.end()) {
-    val = 0;
-    if (iter->second->addrp == addrp)
-      val = iter->second;
-    ++iter;
-    if (val)
-      remove(val);
+  {
+    ScopedLock lock(m_mutex);
+    addrp = get_constant_address(addr);
+  }
+
+  foreach_ht (Partition *partition, m_partitions) {
+    ExclusiveLock lock(partition->mutex);
+    LocationMap::iterator iter = partition->location_map.begin();
+    Value *val = 0;
+    while (iter != partition->location_map.end()) {
+      val = 0;
+      if (iter->second->addrp == addrp)
+        val = iter->second;
+      ++iter;
+      if (val)
+        remove(*partition, val);
+    }
+  }
+}
+
+
+void LocationCache::insert_negative(const char *table_name,
+                                    const char *rowkey) {
+  if (m_negative_ttl_ns == 0)
+    return;
+
+  ReaderEpoch::Section section(m_stripe_readers);
+  Partition &partition = get_partition(m_stripes.load(), table_name, rowkey);
+  ExclusiveLock lock(partition.mutex);
+  int64_t now = get_ts64();
+
+  if (partition.negative.size() >= MAX_NEGATIVE_ENTRIES) {
+    NegativeMap::iterator iter = partition.negative.begin();
+    while (iter != partition.negative.end()) {
+      if (iter->second <= now)
+        partition.negative.erase(iter++);
+      else
+        ++iter;
+    }
+    if (partition.negative.size() >= MAX_NEGATIVE_ENTRIES)
+      partition.negative.clear();
+  }
+
+  partition.negative[negative_key(table_name, rowkey)] =
+    now + m_negative_ttl_ns;
+}
+
+
+bool LocationCache::lookup_negative(const char *table_name,
+                                    const char *rowkey) {
+  if (m_negative_ttl_ns == 0)
+    return false;
+
+  ReaderEpoch::Section section(m_stripe_readers);
+  Partition &partition = get_partition(m_stripes.load(), table_name, rowkey);
+  SharedLock lock(partition.mutex);
+
+  if (partition.negative.empty())
+    return false;
+
+  NegativeMap::iterator iter =
+    partition.negative.find(negative_key(table_name, rowkey));
+  if (iter == partition.negative.end() || iter->second <= get_ts64())
+    return false;
+
+  partition.negative_hits++;
+  return true;
+}
+
+
+void LocationCache::get_statistics(Statistics &stats) {
+  stats = Statistics();
+  foreach_ht (Partition *partition, m_partitions) {
+    SharedLock lock(partition->mutex);
+    stats.hits += partition->hits;
+    stats.misses += partition->misses;
+    stats.negative_hits += partition->negative_hits;
+    stats.evictions += partition->evictions;
+    stats.entries += partition->entries;
+    stats.max_partition_entries =
+      std::max(stats.max_partition_entries, partition->entries.load());
   }
 }
 
 
 void LocationCache::display(std::ostream &out) {
-  for (Value *value = m_head; value; value = value->prev)
+  std::vector<Value *> values;
+
+  foreach_ht (Partition *partition, m_partitions) {
+    SharedLock lock(partition->mutex);
+    for (LocationMap::iterator iter = partition->location_map.begin();
+         iter != partition->location_map.end(); ++iter)
+      values.push_back(iter->second);
+  }
+
+  // most recently used first
+  std::sort(values.begin(), values.end(), more_recent);
+
+  foreach_ht (Value *value, values)
     out << "DUMP: end=" << value->end_row << " start=" << value->start_row
         << endl;
 }
 
 
+size_t LocationCache::table_hash(const char *table_name) {
+  size_t hash = 0;
+  for (const char *ptr = table_name; *ptr; ptr++)
+    hash = (hash * 31) + (unsigned char)*ptr;
+  return hash;
+}
+
+
 /**
- * MoveToHead
+ * Returns the row stripes of a table, 0 if it has not been striped
  */
-void LocationCache::move_to_head(Value *cacheval) {
+const LocationCache::TableStripes *
+LocationCache::get_stripes(const StripeMap *stripes, const char *table_name) {
+  StripeMap::const_iterator iter = stripes->find(table_name);
+  return iter == stripes->end() ? 0 : &iter->second;
+}
 
-  if (m_head == cacheval)
-    return;
 
-  // unstich entry from cache
-  cacheval->next->prev = cacheval->prev;
-  if (cacheval->prev == 0)
-    m_tail = cacheval->next;
-  else
-    cacheval->prev->next = cacheval->next;
-
-  cacheval->next = 0;
-  cacheval->prev = m_head;
-  m_head->next = cacheval;
-  m_head = cacheval;
+/**
+ * Returns the stripe of a row, a null row being the end of the table
+ */
+size_t LocationCache::stripe(const TableStripes *table, const char *row) {
+  if (table == 0)
+    return 0;
+  if (row == 0)
+    return table->bounds.size();
+  return std::lower_bound(table->bounds.begin(), table->bounds.end(), row) -
+    table->bounds.begin();
+}
+
+
+LocationCache::Partition &
+LocationCache::get_partition(const char *table_name, size_t stripe) {
+  if (m_partitions.size() == 1)
+    return *m_partitions[0];
+  return *m_partitions[(table_hash(table_name) + stripe) %
+                       m_partitions.size()];
 }
 
 
 /**
- * remove
+ * Returns the partition of a row, to be called within a section of
+ * m_stripe_readers with stripes loaded from m_stripes
  */
-void LocationCache::remove(Value *cacheval) {
-  assert(cacheval);
-  if (m_tail == cacheval) {
-    m_tail = cacheval->next;
-    if (m_tail)
-      m_tail->prev = 0;
+LocationCache::Partition &
+LocationCache::get_partition(const StripeMap *stripes, const char *table_name,
+                             const char *row) {
+  return get_partition(table_name,
+                       stripe(get_stripes(stripes, table_name), row));
+}
+
+
+/**
+ * Evicts locations from the fullest partition until the cache holds no
+ * more than the maximum number of entries
+ */
+void LocationCache::make_room() {
+  while (m_entries.load() > m_max_entries) {
+    Partition *fullest = m_partitions[0];
+    for (size_t i=1; i<m_partitions.size(); i++) {
+      if (m_partitions[i]->entries.load() > fullest->entries.load())
+        fullest = m_partitions[i];
+    }
+    ExclusiveLock lock(fullest->mutex);
+    if (m_entries.load() > m_max_entries && !evict(*fullest))
+      break;
+  }
+}
+
+
+/**
+ * Evicts the least recently used location of a partition, partition lock
+ * held; locations that were looked up since they were linked are
+ * relinked, pegged ones are skipped.  Returns false if all are pegged.
+ */
+bool LocationCache::evict(Partition &partition) {
+  size_t pegged_skips = 0;
+  while (!partition.lru.empty() && pegged_skips < partition.lru.size()) {
+    Value *oldest = partition.lru.begin()->second;
+    uint64_t last_use = oldest->last_use.load();
+    if (last_use != partition.lru.begin()->first) {
+      partition.lru.erase(partition.lru.begin());
+      link(partition, oldest, last_use);
+    }
+    else if (oldest->pegged) {
+      partition.lru.erase(partition.lru.begin());
+      link(partition, oldest, ++partition.clock);
+      pegged_skips++;
+    }
     else {
-      assert (m_head == cacheval);
-      m_head = 0;
+      remove(partition, oldest);
+      partition.evictions++;
+      return true;
     }
   }
-  else if (m_head == cacheval) {
-    m_head = m_head->prev;
-    m_head->next = 0;
+  return false;
+}
+
+
+/**
+ * Picks stripe bounds that spread the cached locations of a table evenly
+ * and moves the locations to the partitions of their new stripes.  The
+ * table name must come from m_strings.
+ */
+void LocationCache::restripe(const char *table_name) {
+  ScopedLock stripe_lock(m_stripe_mutex);
+  StripeMap *stripes = m_stripes.load();
+  const TableStripes *table = get_stripes(stripes, table_name);
+  uint64_t split_entries = table ? table->split_entries : MIN_STRIPE_ENTRIES;
+  std::vector<Value *> values;
+  LocationCacheKey key;
+  bool split = false;
+
+  key.table_name = table_name;
+  key.end_row = "";
+
+  foreach_ht (Partition *partition, m_partitions)
+    partition->mutex.lock();
+
+  // the table may have been striped again by a concurrent insert
+  foreach_ht (Partition *partition, m_partitions) {
+    TableCountMap::iterator iter = partition->table_entries.find(table_name);
+    if (iter != partition->table_entries.end() && iter->second > split_entries)
+      split = true;
   }
-  else {
-    cacheval->next->prev = cacheval->prev;
-    cacheval->prev->next = cacheval->next;
+
+  if (split) {
+    foreach_ht (Partition *partition, m_partitions) {
+      for (LocationMap::iterator iter = partition->location_map.lower_bound(key);
+           iter != partition->location_map.end() &&
+             !strcmp(iter->first.table_name, table_name); ++iter)
+        values.push_back(iter->second);
+    }
+    std::sort(values.begin(), values.end(), end_row_lt);
+
+    // the bounds are the end rows that divide the locations into as many
+    // stripes as there are partitions
+    StripeMap *new_stripes = new StripeMap(*stripes);
+    TableStripes &new_table = (*new_stripes)[table_name];
+    size_t count = m_partitions.size();
+    new_table.bounds.clear();
+    for (size_t i=1; i<count; i++) {
+      size_t n = i * values.size() / count;
+      if (n == 0 || values[n-1]->end_row.empty())
+        continue;
+      if (new_table.bounds.empty() ||
+          new_table.bounds.back() < values[n-1]->end_row)
+        new_table.bounds.push_back(values[n-1]->end_row);
+    }
+    new_table.split_entries =
+      std::max(MIN_STRIPE_ENTRIES, (uint64_t)(2 * values.size() / count));
+    m_stripes.store(new_stripes);
+
+    String prefix = negative_key(table_name, 0);
+    foreach_ht (Partition *partition, m_partitions) {
+      LocationMap::iterator iter = partition->location_map.lower_bound(key);
+      while (iter != partition->location_map.end() &&
+             !strcmp(iter->first.table_name, table_name)) {
+        Value *value = iter->second;
+        LocationCacheKey value_key = iter->first;
+        ++iter;
+        Partition &to = get_partition(new_stripes, table_name,
+                                      value_key.end_row);
+        if (&to == partition)
+          continue;
+        detach(*partition, value);
+        link(to, value, ++to.clock);
+        value->map_iter =
+          to.location_map.insert(LocationMap::value_type(value_key, value)).first;
+        to.entries++;
+        to.table_entries[table_name]++;
+      }
+
+      // negative entries of the table may now be in the wrong partition
+      NegativeMap::iterator niter = partition->negative.lower_bound(prefix);
+      while (niter != partition->negative.end() &&
+             !niter->first.compare(0, prefix.length(), prefix))
+        partition->negative.erase(niter++);
+    }
   }
-  m_location_map.erase(cacheval->map_iter);
+
+  foreach_ht (Partition *partition, m_partitions)
+    partition->mutex.unlock();
+
+  if (split) {
+    m_stripe_readers.synchronize();
+    delete stripes;
+  }
+}
+
+
+/**
+ * Links entry into the LRU order with the given use counter value
+ */
+void LocationCache::link(Partition &partition, Value *cacheval,
+                         uint64_t stamp) {
+  cacheval->last_use = stamp;
+  cacheval->lru_iter = partition.lru.insert(make_pair(stamp, cacheval)).first;
+}
+
+
+/**
+ * Unlinks entry from the LRU order and the location map of its partition
+ */
+void LocationCache::detach(Partition &partition, Value *cacheval) {
+  TableCountMap::iterator iter =
+    partition.table_entries.find(cacheval->map_iter->first.table_name);
+  if (--iter->second == 0)
+    partition.table_entries.erase(iter);
+  partition.lru.erase(cacheval->lru_iter);
+  partition.location_map.erase(cacheval->map_iter);
+  partition.entries--;
+}
+
+
+/**
+ * remove
+ */
+void LocationCache::remove(Partition &partition, Value *cacheval) {
+  assert(cacheval);
+  detach(partition, cacheval);
+  m_entries--;
   delete cacheval;
 }
 
@@ -262,4 +658,3 @@ const CommAddress *LocationCache::get_constant_address(const CommAddress &addr)
   m_addresses.insert(new_addr);
   return new_addr;
 }
-
@@ -22,14 +22,19 @@
 #ifndef HYPERTABLE_LOCATIONCACHE_H
 #define HYPERTABLE_LOCATIONCACHE_H
 
+#include <atomic>
 #include <cstring>
 #include <ostream>
 #include <map>
 #include <set>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
 
 #include "Common/Mutex.h"
 #include "Common/FlyweightString.h"
 #include "Common/InetAddr.h"
+#include "Common/ReaderEpoch.h"
 #include "Common/ReferenceCount.h"
 #include "Common/StringExt.h"
 
@@ -81,23 +86,77 @@ namespace Hypertable {
 
 
   /**
-   *  This class acts as a cache of Range location information.  It
+   * This class acts as a cache of Range location information.
+   *
+   * The cache is split into partitions, each guarded by a reader/writer
+   * lock, so concurrent lookups only share a lock with lookups in the same
+   * partition and never wait for each other.  Each table is striped over
+   * the partitions by row, and the stripes of a table map to consecutive
+   * partitions starting at one chosen by a hash of the table name.  The
+   * stripe bounds are end rows of cached ranges, picked so that the
+   * table's cached locations are spread evenly, and are picked again when
+   * one stripe grows to twice its share.  Since ranges only split, no
+   * range spans a stripe bound: every location is stored once, in the
+   * partition of its end row, and a lookup only consults the partition of
+   * its row.  The stripe bounds are published through an atomic pointer
+   * that lookups read within a ReaderEpoch section.
+   *
+   * A lookup does not relink the entry it finds; it stamps the entry with
+   * the partition's use counter instead.  Entries are kept ordered by the
+   * stamp they had when last linked, and an entry found at the cold end
+   * with a newer stamp is relinked before anything is evicted, which
+   * evicts exactly the least recently used entry of the partition.  The
+   * maximum number of entries applies to the cache as a whole; when it is
+   * exceeded, entries are evicted from the partition holding the most.
+   *
+   * Rows that could not be located can be remembered for a short time as
+   * negative entries (see insert_negative()), so that concurrent lookups
+   * of a range that is being split or moved do not all scan METADATA.
    */
   class LocationCache : public ReferenceCount {
   public:
     /**
      */
     struct Value {
-      struct Value *prev, *next;
       std::map<LocationCacheKey, Value *>::iterator map_iter;
+      std::map<uint64_t, Value *>::iterator lru_iter;
       std::string start_row;
       std::string end_row;
       const CommAddress *addrp;
       bool pegged;
+      /// Use counter value of the last insert or lookup
+      std::atomic<uint64_t> last_use;
+    };
+
+    /** Cache statistics.
+     */
+    struct Statistics {
+      Statistics() : hits(0), misses(0), negative_hits(0), evictions(0),
+                     entries(0), max_partition_entries(0) { }
+      /// Lookups that found a location
+      uint64_t hits;
+      /// Lookups that found no location
+      uint64_t misses;
+      /// Negative lookups that found an unexpired negative entry
+      uint64_t negative_hits;
+      /// Entries evicted to make room for new ones
+      uint64_t evictions;
+      /// Number of cached locations
+      uint64_t entries;
+      /// Number of cached locations in the fullest partition
+      uint64_t max_partition_entries;
     };
 
-    LocationCache(uint32_t max_entries) : m_mutex(), m_location_map(),
-        m_head(0), m_tail(0), m_max_entries(max_entries) { return; }
+    /** Constructor.
+     * @param max_entries Maximum number of cached locations, over all
+     *        partitions
+     * @param partitions Number of partitions; each table is striped over
+     *        the partitions by row
+     * @param negative_ttl_ms Lifetime of negative entries in milliseconds,
+     *        0 disables negative caching
+     */
+    LocationCache(uint32_t max_entries, size_t partitions=1,
+                  uint32_t negative_ttl_ms=0);
     ~LocationCache();
 
     void insert(const char * table_name, RangeLocationInfo &range_loc_info,
@@ -108,11 +167,104 @@ namespace Hypertable {
 
     void invalidate_host(const String &hostname);
 
+    /** Remembers that a row could not be located.  The negative entry
+     * expires after the negative TTL, or earlier when a location covering
+     * the row is inserted.
+     * @param table_name Table ID
+     * @param rowkey Row key
+     */
+    void insert_negative(const char *table_name, const char *rowkey);
+
+    /** Checks for an unexpired negative entry.
+     * @param table_name Table ID
+     * @param rowkey Row key
+     * @return true if the row recently could not be located
+     */
+    bool lookup_negative(const char *table_name, const char *rowkey);
+
+    /** Gets hit, miss and eviction counters.
+     * @param stats Filled in with the sums of the partition counters since
+     *        construction
+     */
+    void get_statistics(Statistics &stats);
+
     void display(std::ostream &);
 
   private:
-    void move_to_head(Value *cacheval);
-    void remove(Value *cacheval);
+
+    typedef std::map<LocationCacheKey, Value *> LocationMap;
+    typedef std::map<uint64_t, Value *> LruMap;
+    typedef std::map<String, int64_t> NegativeMap;
+    typedef std::map<const char *, uint64_t, LtCstr> TableCountMap;
+
+    /** Row stripes of a table.
+     * Stripe <i>i</i> holds the rows after <code>bounds[i-1]</code> up to
+     * and including <code>bounds[i]</code>; the last stripe holds the rows
+     * after the last bound and the end of the table.  A table without
+     * stripes has all of its locations in its first stripe.
+     */
+    struct TableStripes {
+      TableStripes() : split_entries(0) { }
+      /// Stripe bounds, ascending end rows of cached ranges
+      std::vector<String> bounds;
+      /// Number of locations of the table in one partition above which the
+      /// table is striped again
+      uint64_t split_entries;
+    };
+
+    /// Row stripes keyed by table name
+    typedef std::map<const char *, TableStripes, LtCstr> StripeMap;
+
+    /** Cached locations of the table stripes that map to the same
+     * partition.
+     */
+    struct Partition {
+      Partition() : clock(0), entries(0), hits(0), misses(0),
+                    negative_hits(0), evictions(0) { }
+      /// Held shared by lookups, exclusively by modifications
+      boost::shared_mutex mutex;
+      /// Locations keyed by table and end row
+      LocationMap location_map;
+      /// Locations keyed by the use counter value they were linked with
+      LruMap lru;
+      /// Negative entries keyed by "table:row", mapped to expiration time
+      NegativeMap negative;
+      /// Use counter
+      std::atomic<uint64_t> clock;
+      /// Number of cached locations, read without the lock to pick the
+      /// partition to evict from
+      std::atomic<uint64_t> entries;
+      /// Number of cached locations of each table
+      TableCountMap table_entries;
+      /// Lookups that found a location
+      std::atomic<uint64_t> hits;
+      /// Lookups that found no location
+      std::atomic<uint64_t> misses;
+      /// Negative lookups that found an unexpired negative entry
+      std::atomic<uint64_t> negative_hits;
+      /// Entries evicted to make room for new ones
+      uint64_t evictions;
+    };
+
+    size_t table_hash(const char *table_name);
+    const TableStripes *get_stripes(const StripeMap *stripes,
+                                    const char *table_name);
+    size_t stripe(const TableStripes *table, const char *row);
+    Partition &get_partition(const char *table_name, size_t stripe);
+    Partition &get_partition(const StripeMap *stripes, const char *table_name,
+                             const char *row);
+    bool find(Partition &partition, const char *table_name,
+              const char *rowkey, bool inclusive,
+              RangeLocationInfo *range_loc_infop);
+    uint64_t insert(Partition &partition, const char *table_name,
+                    const CommAddress *addrp,
+                    RangeLocationInfo &range_loc_info, bool pegged);
+    void make_room();
+    bool evict(Partition &partition);
+    void restripe(const char *table_name);
+    void link(Partition &partition, Value *cacheval, uint64_t stamp);
+    void detach(Partition &partition, Value *cacheval);
+    void remove(Partition &partition, Value *cacheval);
 
     const CommAddress *get_constant_address(const CommAddress &addr);
 
@@ -123,16 +275,24 @@ namespace Hypertable {
       }
     };
 
-    typedef std::map<LocationCacheKey, Value *> LocationMap;
     typedef std::set<const CommAddress *, CommAddressPointerLt> AddressSet;
 
+    /// Protects the address set and the table name strings
     Mutex          m_mutex;
-    LocationMap    m_location_map;
     AddressSet     m_addresses;
-    Value         *m_head;
-    Value         *m_tail;
-    uint32_t       m_max_entries;
     FlyweightString m_strings;
+    std::vector<Partition *> m_partitions;
+    /// Serializes re-striping
+    Mutex          m_stripe_mutex;
+    /// Row stripes of the tables that have been striped
+    std::atomic<StripeMap *> m_stripes;
+    /// Readers of #m_stripes
+    ReaderEpoch    m_stripe_readers;
+    /// Number of cached locations
+    std::atomic<uint64_t> m_entries;
+    /// Maximum number of cached locations
+    uint32_t       m_max_entries;
+    int64_t        m_negative_ttl_ns;
   };
 
   typedef intrusive_ptr<LocationCache> LocationCachePtr;
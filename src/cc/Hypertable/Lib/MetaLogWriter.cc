@@ -59,7 +59,8 @@ bool Writer::skip_recover_entry = false;
 
 Writer::Writer(FilesystemPtr &fs, DefinitionPtr &definition, const String &path,
                std::vector<EntityPtr> &initial_entities) :
-  m_fs(fs), m_definition(definition), m_fd(-1), m_offset(0) {
+  m_fs(fs), m_definition(definition), m_fd(-1), m_offset(0),
+  m_batch(new CommitBatch()), m_write_in_progress(false) {
 
   HT_EXPECT(Config::properties, Error::FAILED_EXPECTATION);
 
@@ -118,6 +119,8 @@ Writer::~Writer() {
 
 void Writer::close() {
   ScopedLock lock(m_mutex);
+  while (m_write_in_progress || m_pending.fill())
+    m_cond.wait(lock);
   try {
     if (m_fd != -1) {
       m_fs->close(m_fd);
@@ -188,125 +191,114 @@ void Writer::write_header() {
 
 void Writer::record_state(Entity *entity) {
   ScopedLock lock(m_mutex);
-  size_t length;
-  StaticBuffer buf;
-  boost::shared_array<uint8_t> backup_buf;
 
   if (m_fd == -1)
     HT_THROWF(Error::CLOSED, "MetaLog '%s' has been closed", m_path.c_str());
 
-  {
-    Locker<Entity> lock(*entity);
-    length = EntityHeader::LENGTH + (entity->marked_for_removal() ? 0 : entity->encoded_length());
-    buf.set(new uint8_t [length], length);
-    uint8_t *ptr = buf.base;
-
-    if (entity->marked_for_removal())
-      entity->header.encode( &ptr );
-    else
-      entity->encode_entry( &ptr );
-
-    HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-    backup_buf.reset(new uint8_t [length]);
-    memcpy(backup_buf.get(), buf.base, buf.size);
-  }
-
-  FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-  m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-  m_offset += buf.size;
+  add_pending(entity, false);
+  commit_pending(lock);
 }
 
 void Writer::record_state(std::vector<Entity *> &entities) {
   ScopedLock lock(m_mutex);
-  boost::shared_array<StaticBuffer> buffers( new StaticBuffer[entities.size()] );
-  uint8_t *ptr;
-  size_t length = 0;
-  size_t total_length = 0;
 
   if (m_fd == -1)
     HT_THROWF(Error::CLOSED, "MetaLog '%s' has been closed", m_path.c_str());
 
-  size_t i=0;
-  foreach_ht (Entity *entity, entities) {
-    Locker<Entity> lock(*entity);
-    length = EntityHeader::LENGTH + (entity->marked_for_removal() ? 0 : entity->encoded_length());
-    buffers[i].set(new uint8_t [length], length);
-    ptr = buffers[i].base;
-    if (entity->marked_for_removal())
-      entity->header.encode( &ptr );
-    else
-      entity->encode_entry( &ptr );
-    HT_ASSERT((ptr-buffers[i].base) == (ptrdiff_t)buffers[i].size);
-    total_length += length;
-    i++;
-  }
+  foreach_ht (Entity *entity, entities)
+    add_pending(entity, false);
+  commit_pending(lock);
+}
 
-  boost::shared_array<uint8_t> backup_buf( new uint8_t [total_length] );
-  StaticBuffer buf(new uint8_t [total_length], total_length);
-  ptr = buf.base;
-  for (i=0; i<entities.size(); i++) {
-    memcpy(ptr, buffers[i].base, buffers[i].size);
-    ptr += buffers[i].size;
-  }
-  HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
+void Writer::record_removal(Entity *entity) {
+  ScopedLock lock(m_mutex);
 
-  memcpy(backup_buf.get(), buf.base, buf.size);
+  if (m_fd == -1)
+    HT_THROWF(Error::CLOSED, "MetaLog '%s' has been closed", m_path.c_str());
 
-  FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-  m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-  m_offset += buf.size;
+  add_pending(entity, true);
+  commit_pending(lock);
 }
 
-void Writer::record_removal(Entity *entity) {
+
+void Writer::record_removal(std::vector<Entity *> &entities) {
   ScopedLock lock(m_mutex);
-  StaticBuffer buf(EntityHeader::LENGTH);
-  uint8_t backup_buf[EntityHeader::LENGTH];
-  uint8_t *ptr = buf.base;
 
   if (m_fd == -1)
     HT_THROWF(Error::CLOSED, "MetaLog '%s' has been closed", m_path.c_str());
 
-  entity->header.flags |= EntityHeader::FLAG_REMOVE;
-  entity->header.length = 0;
-  entity->header.checksum = 0;
+  foreach_ht (Entity *entity, entities)
+    add_pending(entity, true);
+  commit_pending(lock);
+}
 
-  entity->header.encode( &ptr );
 
-  HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-  memcpy(backup_buf, buf.base, buf.size);
+void Writer::add_pending(Entity *entity, bool removal) {
 
-  FileUtils::write(m_backup_fd, backup_buf, buf.size);
-  m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-  m_offset += buf.size;
+  if (removal) {
+    entity->header.flags |= EntityHeader::FLAG_REMOVE;
+    entity->header.length = 0;
+    entity->header.checksum = 0;
+    m_pending.ensure(EntityHeader::LENGTH);
+    entity->header.encode(&m_pending.ptr);
+    return;
+  }
 
+  Locker<Entity> lock(*entity);
+  size_t length = EntityHeader::LENGTH +
+    (entity->marked_for_removal() ? 0 : entity->encoded_length());
+  m_pending.ensure(length);
+  uint8_t *base = m_pending.ptr;
+  if (entity->marked_for_removal())
+    entity->header.encode(&m_pending.ptr);
+  else
+    entity->encode_entry(&m_pending.ptr);
+  HT_ASSERT((m_pending.ptr-base) == (ptrdiff_t)length);
 }
 
 
-void Writer::record_removal(std::vector<Entity *> &entities) {
-  ScopedLock lock(m_mutex);
-  size_t length = entities.size() * EntityHeader::LENGTH;
-
-  if (m_fd == -1)
-    HT_THROWF(Error::CLOSED, "MetaLog '%s' has been closed", m_path.c_str());
+void Writer::commit_pending(ScopedLock &lock) {
+  CommitBatchPtr batch = m_batch;
 
-  {
-    StaticBuffer buf(length);
-    boost::shared_array<uint8_t> backup_buf( new uint8_t [length] );
-    uint8_t *ptr = buf.base;
+  while (!batch->done) {
 
-    for (size_t i=0; i<entities.size(); i++) {
-      entities[i]->header.flags |= EntityHeader::FLAG_REMOVE;
-      entities[i]->header.length = 0;
-      entities[i]->header.checksum = 0;
-      entities[i]->header.encode( &ptr );
+    if (m_write_in_progress) {
+      m_cond.wait(lock);
+      continue;
     }
 
-    HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-    memcpy(backup_buf.get(), buf.base, buf.size);
+    // Become the group commit leader for everything pending
+    StaticBuffer buf(m_pending);
+    m_batch.reset(new CommitBatch());
+    m_write_in_progress = true;
 
-    FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-    m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-    m_offset += buf.size;
+    int error = Error::OK;
+    String error_msg;
+
+    lock.unlock();
+    try {
+      FileUtils::write(m_backup_fd, buf.base, buf.size);
+      if (m_fs->append(m_fd, buf, Filesystem::O_FLUSH) != buf.size)
+        HT_THROWF(Error::DFSBROKER_IO_ERROR, "Short write to %s metalog "
+                  "file %s", m_definition->name(), m_filename.c_str());
+    }
+    catch (Exception &e) {
+      error = e.code();
+      error_msg = e.what();
+    }
+    lock.lock();
+
+    if (error == Error::OK)
+      m_offset += buf.size;
+    batch->error = error;
+    batch->error_msg = error_msg;
+    batch->done = true;
+    m_write_in_progress = false;
+    m_cond.notify_all();
   }
 
+  if (batch->error != Error::OK)
+    HT_THROWF(batch->error, "Error writing %s metalog file %s - %s",
+              m_definition->name(), m_filename.c_str(),
+              batch->error_msg.c_str());
 }
@@ -28,10 +28,14 @@
 #ifndef HYPERTABLE_METALOGWRITER_H
 #define HYPERTABLE_METALOGWRITER_H
 
+#include "Common/DynamicBuffer.h"
 #include "Common/Filesystem.h"
 #include "Common/Mutex.h"
 #include "Common/ReferenceCount.h"
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+
 #include <vector>
 
 #include "MetaLogDefinition.h"
@@ -57,6 +61,17 @@ namespace Hypertable {
      * reader->get_entities(entities);
      * MetaLog::Writer writer = new MetaLog::Writer(log_dfs, definition, log_dir, entities);
      * </pre>
+     * Writes are <i>group committed</i>.  Each call to record_state() or
+     * record_removal() serializes its entities into #m_pending (in the order
+     * in which the calls acquire #m_mutex) and then waits for the pending
+     * bytes to be made durable.  The first waiter to find no write in
+     * progress becomes the leader; it takes everything accumulated in
+     * #m_pending and writes it with a single append+sync, while other threads
+     * that arrive in the meantime accumulate the next batch.  No call returns
+     * until the bytes it serialized have been synced (or the write has
+     * failed, in which case the error is re-thrown in every waiter of that
+     * batch).  A failed write only fails its own batch; later calls start a
+     * new batch and are written normally.
      */
     class Writer : public ReferenceCount {
     public:
@@ -172,9 +187,44 @@ namespace Hypertable {
        */
       void purge_old_log_files(std::vector<int32_t> &file_ids, size_t keep_count);
 
+      /** Serializes an entity (or its removal) into #m_pending.
+       * This method must be called with #m_mutex locked.
+       * @param entity Entity to serialize
+       * @param removal Serialize just a removal header for <code>entity</code>
+       */
+      void add_pending(Entity *entity, bool removal);
+
+      /** Waits for pending writes to become durable.
+       * Waits until the batch the data just added to #m_pending belongs to
+       * (#m_batch) has been written.  If there is no write in progress, the
+       * calling thread becomes the group commit leader and writes the
+       * contents of #m_pending to the backup file and to the DFS log file
+       * with a single append, flushing the DFS file, after starting a new
+       * #m_batch.  #m_mutex is released while the write is in progress so
+       * that other threads may queue up the next batch.  If the write fails,
+       * the error is recorded in the batch and re-thrown in all of its
+       * waiters.
+       * @param lock Lock object holding #m_mutex
+       */
+      void commit_pending(ScopedLock &lock);
+
+      /// Outcome of a group commit write, shared by its waiters
+      struct CommitBatch {
+        CommitBatch() : done(false), error(Error::OK) { }
+        /// Set once the batch has been written (or the write failed)
+        bool done;
+        /// Error code of the write, Error::OK on success
+        int error;
+        /// Error message of a failed write
+        String error_msg;
+      };
+
+      /// Smart pointer to CommitBatch
+      typedef boost::shared_ptr<CommitBatch> CommitBatchPtr;
+
       /// %Mutex for serializing access to members
       Mutex m_mutex;
-      
+
       /// Smart pointer to Filesystem object
       FilesystemPtr m_fs;
 
@@ -201,6 +251,18 @@ namespace Hypertable {
 
       /// Current write offset of %MetaLog file
       int m_offset;
+
+      /// Condition signalled when a group commit completes
+      boost::condition m_cond;
+
+      /// Serialized entities waiting to be written
+      DynamicBuffer m_pending;
+
+      /// Batch that the contents of #m_pending belong to
+      CommitBatchPtr m_batch;
+
+      /// Flag indicating that a group commit write is in progress
+      bool m_write_in_progress;
     };
 
     /// Smart pointer to Writer
@@ -0,0 +1,94 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for RangeFinder.
+ * This file contains the declarations of RangeFinder, an interface for
+ * finding the ranges of one table, and LocatorRangeFinder, which finds
+ * them with a RangeLocator.
+ */
+
+#ifndef HYPERTABLE_RANGEFINDER_H
+#define HYPERTABLE_RANGEFINDER_H
+
+#include <Common/Timer.h>
+
+#include "RangeLocationInfo.h"
+#include "RangeLocator.h"
+#include "Types.h"
+
+namespace Hypertable {
+
+  /** @addtogroup libHypertable
+   * @{
+   */
+
+  /** Finds the ranges of one table.
+   * Code that walks range boundaries, such as IndexScanPlanner and
+   * TableScannerAsync::partition_rowset(), looks ranges up through this
+   * interface so that it can be driven by a fixed set of ranges in tests.
+   */
+  class RangeFinder {
+  public:
+    virtual ~RangeFinder() { }
+
+    /** Finds the range containing a row.
+     * @param row Row key
+     * @param range_info Filled in with the location of the range
+     * @throws Exception if the range could not be located
+     */
+    virtual void find(const char *row, RangeLocationInfo *range_info) = 0;
+  };
+
+  /** RangeFinder that looks ranges up with a RangeLocator.
+   */
+  class LocatorRangeFinder : public RangeFinder {
+  public:
+
+    /** Constructor.
+     * @param range_locator Range locator
+     * @param table Table whose ranges are found
+     * @param timer Timer bounding the lookups
+     */
+    LocatorRangeFinder(RangeLocatorPtr &range_locator,
+                       const TableIdentifier *table, Timer &timer)
+      : m_range_locator(range_locator), m_table(table), m_timer(timer) { }
+
+    virtual void find(const char *row, RangeLocationInfo *range_info) {
+      m_range_locator->find_loop(m_table, row, range_info, m_timer, false);
+    }
+
+  private:
+    /// Range locator
+    RangeLocatorPtr m_range_locator;
+
+    /// Table whose ranges are found
+    const TableIdentifier *m_table;
+
+    /// Timer bounding the lookups
+    Timer &m_timer;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_RANGEFINDER_H
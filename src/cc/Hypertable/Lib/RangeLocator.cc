@@ -126,7 +126,9 @@ RangeLocator::RangeLocator(PropertiesPtr &cfg, ConnectionManagerPtr &conn_mgr,
   boost::trim_if(m_toplevel_dir, boost::is_any_of("/"));
   m_toplevel_dir = String("/") + m_toplevel_dir;
 
-  m_cache = new LocationCache(cache_size);
+  m_cache = new LocationCache(cache_size,
+                   cfg->get_i32("Hypertable.LocationCache.Partitions"),
+                   cfg->get_i32("Hypertable.LocationCache.NegativeTTL"));
   // register hyperspace session callback
   m_hyperspace_session_callback.m_rangelocator = this;
   m_hyperspace->add_callback(&m_hyperspace_session_callback);
@@ -304,6 +306,14 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
   if (!hard && m_cache->lookup(table->id, row_key, rane_loc_infop))
     return Error::OK;
 
+  if (!hard && !root_lookup && !table->is_metadata() &&
+      m_cache->lookup_negative(table->id, row_key)) {
+    SAVE_ERR(Error::METADATA_NOT_FOUND, (String)"RangeLocator recently failed "
+             "to find metadata for table '" + table->id + "' row '" +
+             (row_key ? row_key : "") + "'");
+    return Error::METADATA_NOT_FOUND;
+  }
+
   /**
    * If key is on ROOT metadata range, return root range information
    */
@@ -460,6 +470,7 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
     row_key = "";
 
   if (!m_cache->lookup(table->id, row_key, rane_loc_infop, inclusive)) {
+    m_cache->insert_negative(table->id, row_key);
     SAVE_ERR(Error::METADATA_NOT_FOUND, (String)"RangeLocator failed to find "
              "metadata for table '" + table->id + "' row '" + row_key + "'");
     return Error::METADATA_NOT_FOUND;
@@ -469,6 +480,27 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
 }
 
 
+void
+RangeLocator::prefetch(const TableIdentifier *table,
+                       const std::vector<const char *> &rows, Timer &timer) {
+  RangeLocationInfo range_loc_info;
+  size_t i = 0;
+
+  while (i < rows.size() && !timer.expired()) {
+    // A miss scans the METADATA entries of the next
+    // Hypertable.RangeLocator.MetadataReadaheadCount ranges
+    if (find(table, rows[i], &range_loc_info, timer, false) != Error::OK)
+      break;
+    if (range_loc_info.end_row == Key::END_ROW_MARKER)
+      break;
+    // skip the rows of the located range
+    do {
+      i++;
+    } while (i < rows.size() && range_loc_info.end_row.compare(rows[i]) >= 0);
+  }
+}
+
+
 int RangeLocator::process_metadata_scanblock(ScanBlock &scan_block, Timer &timer) {
   RangeLocationInfo range_loc_info;
   SerializedKey serkey;
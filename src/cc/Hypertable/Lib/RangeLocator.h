@@ -23,6 +23,7 @@
 #define HYPERTABLE_RANGELOCATOR_H
 
 #include <deque>
+#include <vector>
 
 #include "Common/Mutex.h"
 #include "Common/Error.h"
@@ -104,6 +105,27 @@ namespace Hypertable {
     int find(const TableIdentifier *table, const char *row_key,
              RangeLocationInfo *range_loc_infop, Timer &timer, bool hard);
 
+    /** Loads the locations of the ranges containing a set of rows into the
+     * cache.  Each cache miss fetches the METADATA entries of a batch of
+     * adjacent ranges, so rows spread over many ranges are located with a
+     * few METADATA scans instead of one per range.  Ranges holding none of
+     * the rows are not looked up.  Prefetching is best effort; errors are
+     * left for the subsequent find() calls to report.
+     *
+     * @param table pointer to table identifier structure
+     * @param rows rows to locate, in ascending order
+     * @param timer reference to timer object
+     */
+    void prefetch(const TableIdentifier *table,
+                  const std::vector<const char *> &rows, Timer &timer);
+
+    /** Gets the statistics of the location cache.
+     * @param stats Filled in with the location cache counters
+     */
+    void get_cache_statistics(LocationCache::Statistics &stats) {
+      m_cache->get_statistics(stats);
+    }
+
     /**
      * Invalidates the cached entry for the given row key
      *
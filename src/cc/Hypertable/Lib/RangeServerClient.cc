@@ -199,6 +199,15 @@ RangeServerClient::update(const CommAddress &addr, const TableIdentifier &table,
   send_message(addr, cbp, handler, timer.remaining());
 }
 
+void
+RangeServerClient::update(const CommAddress &addr, const TableIdentifier &table,
+                          uint32_t count, const std::vector<struct iovec> &chain,
+                          uint32_t flags, DispatchHandler *handler) {
+  CommBufPtr cbp(RangeServerProtocol::create_request_update(table, count,
+                                                            chain, flags));
+  send_message(addr, cbp, handler, m_default_timeout_ms);
+}
+
 
 void
 RangeServerClient::update(const CommAddress &addr, const TableIdentifier &table,
@@ -345,6 +354,14 @@ RangeServerClient::fetch_scanblock(const CommAddress &addr, int scanner_id,
   send_message(addr, cbp, handler, timer.remaining());
 }
 
+void
+RangeServerClient::fetch_scanblock_stream(const CommAddress &addr,
+        int scanner_id, uint32_t window, DispatchHandler *handler,
+        Timer &timer) {
+  CommBufPtr cbp(RangeServerProtocol::
+                 create_request_fetch_scanblock_stream(scanner_id, window));
+  send_message(addr, cbp, handler, timer.remaining());
+}
 
 void
 RangeServerClient::fetch_scanblock(const CommAddress &addr, int scanner_id,
@@ -378,6 +395,41 @@ RangeServerClient::do_fetch_scanblock(const CommAddress &addr, int scanner_id,
 }
 
 
+uint32_t
+RangeServerClient::multi_get(const CommAddress &addr,
+    const TableIdentifier &table, const RangeSpec &range,
+    uint32_t max_versions, const std::pair<String, String> *keys,
+    uint32_t count, ScanBlock &scan_block, Timer &timer) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event;
+  uint32_t keys_completed = 0;
+  CommBufPtr cbp(RangeServerProtocol::create_request_multi_get(table,
+                 range, max_versions, keys, count));
+  send_message(addr, cbp, &sync_handler, timer.remaining());
+
+  if (!sync_handler.wait_for_reply(event))
+    HT_THROW((int)Protocol::response_code(event),
+             String("RangeServer multi_get() failure : ")
+             + Protocol::string_format_message(event));
+  else {
+    int error = scan_block.load_multi_get(event, &keys_completed);
+    if (error != Error::OK)
+      HT_THROW(error, "Problem decoding multi get response");
+  }
+  return keys_completed;
+}
+
+void
+RangeServerClient::multi_get(const CommAddress &addr,
+    const TableIdentifier &table, const RangeSpec &range,
+    uint32_t max_versions, const std::pair<String, String> *keys,
+    uint32_t count, DispatchHandler *handler, Timer &timer) {
+  CommBufPtr cbp(RangeServerProtocol::create_request_multi_get(table,
+                 range, max_versions, keys, count));
+  send_message(addr, cbp, handler, timer.remaining());
+}
+
+
 void
 RangeServerClient::drop_table(const CommAddress &addr,
     const TableIdentifier &table, DispatchHandler *handler) {
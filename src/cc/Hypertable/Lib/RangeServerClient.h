@@ -178,6 +178,22 @@ namespace Hypertable {
                 uint32_t count, StaticBuffer &buffer, uint32_t flags,
                 DispatchHandler *handler, Timer &timer);
 
+    /** Issues an "update" request asynchronously from a chain of segments.
+     * The concatenation of the segments holds a sequence of key/value pairs.
+     * The segments are sent without being copied and are not owned by the
+     * request, so their memory must remain valid until the response has been
+     * delivered to <code>handler</code>.
+     * @param addr address of RangeServer
+     * @param table table identifier
+     * @param count number of key/value pairs in the segments
+     * @param chain segments holding key/value pairs
+     * @param flags update flags
+     * @param handler response handler
+     */
+    void update(const CommAddress &addr, const TableIdentifier &table,
+                uint32_t count, const std::vector<struct iovec> &chain,
+                uint32_t flags, DispatchHandler *handler);
+
     /** Issues an "update" request.  The data argument holds a sequence of
      * key/value pairs.  Each key/value pair is encoded as two variable lenght
      * ByteString records back-to-back.  This method takes ownership of the
@@ -299,6 +315,21 @@ namespace Hypertable {
     void fetch_scanblock(const CommAddress &addr, int scanner_id,
                          DispatchHandler *handler, Timer &timer);
 
+    /** Issues a "fetch scanblock stream" request asynchronously.  The
+     * RangeServer pushes up to <code>window</code> scan blocks, each of
+     * which is delivered to <code>handler</code> as a separate MESSAGE
+     * event.  All events but the last have CommHeader::FLAGS_BIT_STREAM
+     * set in their header.
+     * @param addr address of RangeServer
+     * @param scanner_id Scanner ID returned from a call to create_scanner.
+     * @param window maximum number of scan blocks to push
+     * @param handler response handler
+     * @param timer timer
+     */
+    void fetch_scanblock_stream(const CommAddress &addr, int scanner_id,
+                                uint32_t window, DispatchHandler *handler,
+                                Timer &timer);
+
     /** Issues a synchronous "fetch scanblock" request.
      * @param addr address of RangeServer
      * @param scanner_id scanner ID returned from a call to create_scanner.
@@ -316,6 +347,43 @@ namespace Hypertable {
     void fetch_scanblock(const CommAddress &addr, int scanner_id,
                          ScanBlock &scan_block, Timer &timer);
 
+    /** Issues a synchronous "multi get" request.  Fetches the cells of a
+     * sorted batch of (row, column) keys that all fall within
+     * <code>range</code> in a single round trip; an empty column selects
+     * the whole row.  The RangeServer may stop early to bound the response
+     * size, in which case the remaining keys have to be requested again.
+     * @param addr address of RangeServer
+     * @param table table identifier
+     * @param range range specification
+     * @param max_versions maximum number of versions per column, 0 for all
+     * @param keys array of (row, column) pairs
+     * @param count number of keys
+     * @param scan_block block of return key/value pairs
+     * @param timer timer
+     * @return number of keys whose cells are contained in
+     *         <code>scan_block</code>
+     */
+    uint32_t multi_get(const CommAddress &addr, const TableIdentifier &table,
+                       const RangeSpec &range, uint32_t max_versions,
+                       const std::pair<String, String> *keys, uint32_t count,
+                       ScanBlock &scan_block, Timer &timer);
+
+    /** Issues a "multi get" request asynchronously.  The response is
+     * decoded with ScanBlock::load_multi_get().
+     * @param addr address of RangeServer
+     * @param table table identifier
+     * @param range range specification
+     * @param max_versions maximum number of versions per column, 0 for all
+     * @param keys array of (row, column) pairs
+     * @param count number of keys
+     * @param handler response handler
+     * @param timer timer
+     */
+    void multi_get(const CommAddress &addr, const TableIdentifier &table,
+                   const RangeSpec &range, uint32_t max_versions,
+                   const std::pair<String, String> *keys, uint32_t count,
+                   DispatchHandler *handler, Timer &timer);
+
     /** Issues a "drop table" request asynchronously.
      * @param addr address of RangeServer
      * @param table table identifier
@@ -60,6 +60,7 @@ namespace Hypertable {
     "relinquish range",
     "heapcheck",
     "metadata sync",
+    "initialize",
     "replay fragments",
     "phantom receive",
     "phantom update",
@@ -67,6 +68,8 @@ namespace Hypertable {
     "phantom commit ranges",
     "dump pseudo table",
     "set state",
+    "fetch scanblock stream",
+    "multi get",
     (const char *)0
   };
 
@@ -191,6 +194,19 @@ namespace Hypertable {
     return cbuf;
   }
 
+  CommBuf *
+  RangeServerProtocol::create_request_update(const TableIdentifier &table,
+      uint32_t count, const std::vector<struct iovec> &chain, uint32_t flags) {
+    CommHeader header(COMMAND_UPDATE);
+    if (table.is_system()) // If system table, set the urgent bit
+      header.flags |= CommHeader::FLAGS_BIT_URGENT;
+    CommBuf *cbuf = new CommBuf(header, 8 + table.encoded_length(), chain);
+    table.encode(cbuf->get_data_ptr_address());
+    cbuf->append_i32(count);
+    cbuf->append_i32(flags);
+    return cbuf;
+  }
+
   CommBuf *
   RangeServerProtocol::create_request_update_schema(
       const TableIdentifier &table, const String &schema) {
@@ -243,6 +259,40 @@ namespace Hypertable {
     return cbuf;
   }
 
+  CommBuf *
+  RangeServerProtocol::create_request_fetch_scanblock_stream(int scanner_id,
+                                                             uint32_t window) {
+    CommHeader header(COMMAND_FETCH_SCANBLOCK_STREAM);
+    header.gid = scanner_id;
+    CommBuf *cbuf = new CommBuf(header, 8);
+    cbuf->append_i32(scanner_id);
+    cbuf->append_i32(window);
+    return cbuf;
+  }
+
+  CommBuf *RangeServerProtocol::
+  create_request_multi_get(const TableIdentifier &table,
+      const RangeSpec &range, uint32_t max_versions,
+      const std::pair<String, String> *keys, uint32_t count) {
+    CommHeader header(COMMAND_MULTI_GET);
+    if (table.is_system()) // If system table, set the urgent bit
+      header.flags |= CommHeader::FLAGS_BIT_URGENT;
+    size_t len = table.encoded_length() + range.encoded_length() + 8;
+    for (uint32_t i=0; i<count; i++)
+      len += encoded_length_vstr(keys[i].first) +
+        encoded_length_vstr(keys[i].second);
+    CommBuf *cbuf = new CommBuf(header, len);
+    table.encode(cbuf->get_data_ptr_address());
+    range.encode(cbuf->get_data_ptr_address());
+    cbuf->append_i32(max_versions);
+    cbuf->append_i32(count);
+    for (uint32_t i=0; i<count; i++) {
+      cbuf->append_vstr(keys[i].first);
+      cbuf->append_vstr(keys[i].second);
+    }
+    return cbuf;
+  }
+
   CommBuf *
   RangeServerProtocol::create_request_drop_table(const TableIdentifier &table) {
     CommHeader header(COMMAND_DROP_TABLE);
@@ -38,6 +38,10 @@
 #include "RangeRecoveryPlan.h"
 #include "SystemVariable.h"
 
+#include <vector>
+
+#include <sys/uio.h>
+
 namespace Hypertable {
 
   /** @addtogroup libHypertable
@@ -81,7 +85,9 @@ namespace Hypertable {
     static const uint64_t COMMAND_PHANTOM_COMMIT_RANGES    = 29;
     static const uint64_t COMMAND_DUMP_PSEUDO_TABLE        = 30;
     static const uint64_t COMMAND_SET_STATE                = 31;
-    static const uint64_t COMMAND_MAX                      = 32;
+    static const uint64_t COMMAND_FETCH_SCANBLOCK_STREAM   = 32;
+    static const uint64_t COMMAND_MULTI_GET                = 33;
+    static const uint64_t COMMAND_MAX                      = 34;
 
     static const char *m_command_strings[];
 
@@ -155,6 +161,22 @@ namespace Hypertable {
     static CommBuf *create_request_update(const TableIdentifier &table,
                                           uint32_t count, StaticBuffer &buffer, uint32_t flags);
 
+    /** Creates an "update" request message from a chain of segments.  The
+     * concatenation of the segments holds a sequence of key/value pairs,
+     * encoded as for the StaticBuffer variant.  The segments are written to
+     * the network without being copied, so the memory they reference must
+     * remain valid until the returned CommBuf is destroyed.
+     * @param table table identifier
+     * @param count number of key/value pairs in the segments
+     * @param chain segments holding key/value pairs
+     * @param flags update flags
+     * @return protocol message
+     */
+    static CommBuf *create_request_update(const TableIdentifier &table,
+                                          uint32_t count,
+                                          const std::vector<struct iovec> &chain,
+                                          uint32_t flags);
+
     /** Creates an "update schema" message. Used to update schema for a
      * table
      * @param table table identifier
@@ -192,6 +214,33 @@ namespace Hypertable {
      */
     static CommBuf *create_request_fetch_scanblock(int scanner_id);
 
+    /** Creates a "fetch scanblock stream" request message.  The RangeServer
+     * answers it with up to <code>window</code> scan blocks, each sent as a
+     * separate response; all but the last have CommHeader::FLAGS_BIT_STREAM
+     * set.
+     * @param scanner_id scanner ID returned from a "create scanner" request
+     * @param window maximum number of scan blocks to send
+     * @return protocol message
+     */
+    static CommBuf *create_request_fetch_scanblock_stream(int scanner_id,
+                                                          uint32_t window);
+
+    /** Creates a "multi get" request message.  Each key is a row and an
+     * optional column ("family" or "family:qualifier"); an empty column
+     * selects all columns of the row.  Keys must be sorted by row and
+     * must all fall within <code>range</code>.
+     * @param table table identifier
+     * @param range range specification
+     * @param max_versions maximum number of versions to return per column,
+     *        0 for all
+     * @param keys array of (row, column) pairs
+     * @param count number of keys
+     * @return protocol message
+     */
+    static CommBuf *create_request_multi_get(const TableIdentifier &table,
+        const RangeSpec &range, uint32_t max_versions,
+        const std::pair<String, String> *keys, uint32_t count);
+
     /** Creates a "status" request message.
      * @return protocol message
      */
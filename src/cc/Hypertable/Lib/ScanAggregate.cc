@@ -0,0 +1,126 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for ScanAggregate and ScanAggregator.
+ * This file contains definitions for ScanAggregate, the partial aggregate
+ * returned by range servers for aggregating scans, and ScanAggregator, which
+ * combines partial aggregates on the client.
+ */
+
+#include <Common/Compat.h>
+
+#include "ScanAggregate.h"
+#include "ScanSpec.h"
+
+#include <Common/Serialization.h>
+
+using namespace Hypertable;
+using namespace Serialization;
+
+void ScanAggregate::merge(const ScanAggregate &other) {
+  if (other.numeric_cells) {
+    if (numeric_cells == 0 || other.min < min)
+      min = other.min;
+    if (numeric_cells == 0 || other.max > max)
+      max = other.max;
+    add_sum(other.sum);
+    numeric_cells += other.numeric_cells;
+  }
+  if (other.sum_overflow)
+    sum_overflow = true;
+  cells += other.cells;
+  rows += other.rows;
+}
+
+size_t ScanAggregate::encoded_length() const {
+  return encoded_length_vi64(cells) + encoded_length_vi64(rows) +
+    encoded_length_vi64(numeric_cells) + 25;
+}
+
+void ScanAggregate::encode(uint8_t **bufp) const {
+  encode_vi64(bufp, cells);
+  encode_vi64(bufp, rows);
+  encode_vi64(bufp, numeric_cells);
+  encode_i64(bufp, sum);
+  encode_i64(bufp, min);
+  encode_i64(bufp, max);
+  encode_bool(bufp, sum_overflow);
+}
+
+void ScanAggregate::decode(const uint8_t **bufp, size_t *remainp) {
+  HT_TRY("decoding scan aggregate",
+    cells = decode_vi64(bufp, remainp);
+    rows = decode_vi64(bufp, remainp);
+    numeric_cells = decode_vi64(bufp, remainp);
+    sum = decode_i64(bufp, remainp);
+    min = decode_i64(bufp, remainp);
+    max = decode_i64(bufp, remainp);
+    sum_overflow = decode_bool(bufp, remainp));
+}
+
+bool ScanAggregate::parse_number(const uint8_t *value, size_t len,
+                                 int64_t *numberp) {
+  const uint8_t *end = value + len;
+  bool negative = false;
+  uint64_t number = 0;
+
+  if (value < end && (*value == '-' || *value == '+'))
+    negative = *value++ == '-';
+
+  // At most 19 digits so that the accumulation cannot overflow uint64_t
+  if (value == end || end - value > 19)
+    return false;
+
+  for (; value < end; value++) {
+    if (*value < '0' || *value > '9')
+      return false;
+    number = (number * 10) + (*value - '0');
+  }
+
+  // 19 digits may still exceed the int64_t range
+  uint64_t limit = (uint64_t)std::numeric_limits<int64_t>::max();
+  if (number > (negative ? limit + 1 : limit))
+    return false;
+
+  *numberp = negative ? (int64_t)(0 - number) : (int64_t)number;
+  return true;
+}
+
+
+void ScanAggregator::add(const Cell &cell) {
+  ScanAggregate partial;
+  const uint8_t *ptr = cell.value;
+  size_t remain = cell.value_len;
+
+  partial.decode(&ptr, &remain);
+
+  GroupKey key(m_mode == ScanSpec::AGGREGATE_BY_ROW ? cell.row_key : "",
+               cell.column_family);
+  m_results[key].merge(partial);
+}
+
+void ScanAggregator::get_total(ScanAggregate &total) const {
+  total = ScanAggregate();
+  for (ResultMap::const_iterator iter = m_results.begin();
+       iter != m_results.end(); ++iter)
+    total.merge(iter->second);
+}
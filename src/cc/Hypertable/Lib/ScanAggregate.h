@@ -0,0 +1,209 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for ScanAggregate and ScanAggregator.
+ * This file contains declarations for ScanAggregate, the partial aggregate
+ * returned by range servers for aggregating scans, and ScanAggregator, which
+ * combines partial aggregates on the client.
+ */
+
+#ifndef HYPERTABLE_SCANAGGREGATE_H
+#define HYPERTABLE_SCANAGGREGATE_H
+
+#include <Hypertable/Lib/Cell.h>
+
+#include <Common/String.h>
+
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace Hypertable {
+
+  /** @addtogroup libHypertable
+   * @{
+   */
+
+  /** Partial aggregate over a group of cells.
+   * Numeric statistics (#sum, #min, #max) cover counter cells and cells whose
+   * value is a decimal integer that fits in 64 bits; #numeric_cells is the
+   * number of such cells.  If #sum overflows, it is clamped and
+   * #sum_overflow is set.
+   */
+  class ScanAggregate {
+  public:
+
+    /** Constructor. */
+    ScanAggregate() : cells(0), rows(0), numeric_cells(0), sum(0), min(0),
+                      max(0), sum_overflow(false) { }
+
+    /** Adds a cell value.  If the value parses as a decimal integer, it is
+     * included in the numeric statistics.
+     * @param value Pointer to value
+     * @param len Length of value
+     */
+    void add_value(const uint8_t *value, size_t len) {
+      int64_t number;
+      cells++;
+      if (parse_number(value, len, &number))
+        add_number(number);
+    }
+
+    /** Adds a counter value.
+     * @param count Counter value
+     */
+    void add_counter(int64_t count) {
+      cells++;
+      add_number(count);
+    }
+
+    /** Merges another partial aggregate into this one.
+     * @param other Partial aggregate to merge
+     */
+    void merge(const ScanAggregate &other);
+
+    /** Returns encoded length.
+     * @return Length of serialized aggregate
+     */
+    size_t encoded_length() const;
+
+    /** Writes serialized aggregate to a buffer.
+     * @param bufp Address of destination buffer pointer (advanced by call)
+     */
+    void encode(uint8_t **bufp) const;
+
+    /** Reads serialized aggregate from a buffer.
+     * @param bufp Address of source buffer pointer (advanced by call)
+     * @param remainp Address of remaining byte count (decremented by call)
+     */
+    void decode(const uint8_t **bufp, size_t *remainp);
+
+    /** Parses a cell value as an optionally signed decimal integer.
+     * @param value Pointer to value
+     * @param len Length of value
+     * @param numberp Address of variable to hold result
+     * @return <i>true</i> if the entire value is a decimal integer within
+     * the range of int64_t, <i>false</i> otherwise
+     */
+    static bool parse_number(const uint8_t *value, size_t len,
+                             int64_t *numberp);
+
+    /// Number of cells
+    uint64_t cells;
+    /// Number of distinct rows.  A row is only counted in the first group
+    /// (lowest column family) it has cells in, so that summing over the
+    /// groups of a scan yields the number of distinct rows
+    uint64_t rows;
+    /// Number of cells included in #sum, #min and #max
+    uint64_t numeric_cells;
+    /// Sum of numeric values
+    int64_t sum;
+    /// Minimum numeric value (valid if #numeric_cells is non-zero)
+    int64_t min;
+    /// Maximum numeric value (valid if #numeric_cells is non-zero)
+    int64_t max;
+    /// Set if #sum overflowed, in which case it is clamped to the int64_t
+    /// range
+    bool sum_overflow;
+
+  private:
+
+    /** Adds a number to #sum, clamping it and setting #sum_overflow on
+     * overflow.
+     * @param number Number to add
+     */
+    void add_sum(int64_t number) {
+      if (number > 0 && sum > std::numeric_limits<int64_t>::max() - number) {
+        sum = std::numeric_limits<int64_t>::max();
+        sum_overflow = true;
+      }
+      else if (number < 0 &&
+               sum < std::numeric_limits<int64_t>::min() - number) {
+        sum = std::numeric_limits<int64_t>::min();
+        sum_overflow = true;
+      }
+      else
+        sum += number;
+    }
+
+    /** Adds a number to the numeric statistics.
+     * @param number Number to add
+     */
+    void add_number(int64_t number) {
+      if (numeric_cells == 0 || number < min)
+        min = number;
+      if (numeric_cells == 0 || number > max)
+        max = number;
+      add_sum(number);
+      numeric_cells++;
+    }
+  };
+
+  /** Combines partial aggregates returned by an aggregating scan.
+   * Each cell returned by a scan with ScanSpec::aggregate set carries a
+   * serialized ScanAggregate as its value.  Range servers return one
+   * partial aggregate per group per scan block; this class merges them into
+   * one aggregate per group.
+   */
+  class ScanAggregator {
+  public:
+
+    /// Group key: (row, column family).  Row is empty when grouping by column
+    typedef std::pair<String, String> GroupKey;
+
+    /// Map of group key to aggregate
+    typedef std::map<GroupKey, ScanAggregate> ResultMap;
+
+    /** Constructor.
+     * @param mode Aggregation mode (ScanSpec::AGGREGATE_BY_ROW or
+     * ScanSpec::AGGREGATE_BY_COLUMN)
+     */
+    ScanAggregator(uint32_t mode) : m_mode(mode) { }
+
+    /** Merges the partial aggregate carried by a scanned cell.
+     * @param cell Cell returned by an aggregating scan
+     */
+    void add(const Cell &cell);
+
+    /** Returns combined aggregates.
+     * @return Map of group key to aggregate
+     */
+    const ResultMap &results() const { return m_results; }
+
+    /** Returns aggregate over all groups.
+     * @param total Filled in with the merge of all group aggregates
+     */
+    void get_total(ScanAggregate &total) const;
+
+  private:
+    /// Aggregation mode
+    uint32_t m_mode;
+
+    /// Combined aggregates
+    ResultMap m_results;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_SCANAGGREGATE_H
@@ -67,7 +67,49 @@ int ScanBlock::load(EventPtr &event_ptr) {
     HT_ERROR_OUT << e << HT_END;
     return e.code();
   }
-  uint8_t *p = (uint8_t *)decode_ptr;
+  load_pairs(decode_ptr, len);
+
+  return m_error;
+}
+
+
+int ScanBlock::load_multi_get(EventPtr &event_ptr,
+                              uint32_t *keys_completedp) {
+  const uint8_t *decode_ptr = event_ptr->payload + 4;
+  size_t decode_remain = event_ptr->payload_len - 4;
+  uint32_t len;
+
+  m_event = event_ptr;
+  m_vec.clear();
+  m_iter = m_vec.end();
+  m_flags = 0x0001;
+  m_scanner_id = 0;
+  m_skipped_rows = m_skipped_cells = 0;
+
+  if ((m_error = (int)Protocol::response_code(event_ptr)) != Error::OK)
+    return m_error;
+
+  try {
+    *keys_completedp = decode_i32(&decode_ptr, &decode_remain);
+    len = decode_i32(&decode_ptr, &decode_remain);
+    if (len > decode_remain)
+      HT_THROWF(Error::RESPONSE_TRUNCATED, "multi get block length %u "
+                "exceeds remaining payload %u", (unsigned)len,
+                (unsigned)decode_remain);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return e.code();
+  }
+
+  load_pairs(decode_ptr, len);
+
+  return m_error;
+}
+
+
+void ScanBlock::load_pairs(const uint8_t *ptr, uint32_t len) {
+  uint8_t *p = (uint8_t *)ptr;
   uint8_t *endp = p + len;
   SerializedKey key;
   ByteString value;
@@ -80,8 +122,6 @@ int ScanBlock::load(EventPtr &event_ptr) {
     m_vec.push_back(std::make_pair(key, value));
   }
   m_iter = m_vec.begin();
-
-  return m_error;
 }
 
 
@@ -52,6 +52,17 @@ namespace Hypertable {
      */
     int load(EventPtr &event_ptr);
 
+    /** Loads key/value pairs returned by a MULTI_GET request.  The block
+     * holds the cells of the first <code>*keys_completedp</code> keys of
+     * the request, in key order.
+     *
+     * @param event_ptr smart pointer to response MESSAGE event
+     * @param keys_completedp address of variable to hold number of keys
+     *        whose cells are contained in the block
+     * @return Error::OK on success or error code on failure
+     */
+    int load_multi_get(EventPtr &event_ptr, uint32_t *keys_completedp);
+
     /** Returns the number of key/value pairs in the scanblock.
      *
      * @return number of key/value pairs in the scanblock
@@ -110,6 +121,8 @@ namespace Hypertable {
     int get_skipped_cells() { return m_skipped_cells; }
 
   private:
+    void load_pairs(const uint8_t *ptr, uint32_t len);
+
     int m_error;
     uint16_t m_flags;
     int m_scanner_id;
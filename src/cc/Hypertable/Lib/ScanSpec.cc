@@ -99,7 +99,7 @@ void CellInterval::decode(const uint8_t **bufp, size_t *remainp) {
     end_inclusive = decode_bool(bufp, remainp));
 }
 
-size_t ScanSpec::encoded_length() const {
+size_t ScanSpec::encoded_length_fields() const {
   size_t len = encoded_length_vi32(row_limit) +
                encoded_length_vi32(cell_limit) +
                encoded_length_vi32(cell_limit_per_family) +
@@ -111,7 +111,8 @@ size_t ScanSpec::encoded_length() const {
                encoded_length_vstr(row_regexp) +
                encoded_length_vstr(value_regexp) +
                encoded_length_vi32(row_offset) +
-               encoded_length_vi32(cell_offset);
+               encoded_length_vi32(cell_offset) +
+               encoded_length_vi32(aggregate);
 
   foreach_ht(const char *c, columns) len += encoded_length_vstr(c);
   foreach_ht(const RowInterval &ri, row_intervals) len += ri.encoded_length();
@@ -121,7 +122,14 @@ size_t ScanSpec::encoded_length() const {
   return len + 8 + 8 + 4;
 }
 
+size_t ScanSpec::encoded_length() const {
+  size_t len = encoded_length_fields();
+  return 1 + encoded_length_vi32(len) + len;
+}
+
 void ScanSpec::encode(uint8_t **bufp) const {
+  encode_i8(bufp, ENCODING_VERSION);
+  encode_vi32(bufp, encoded_length_fields());
   encode_vi32(bufp, row_limit);
   encode_vi32(bufp, cell_limit);
   encode_vi32(bufp, cell_limit_per_family);
@@ -144,41 +152,65 @@ void ScanSpec::encode(uint8_t **bufp) const {
   encode_bool(bufp, do_not_cache);
   encode_vi32(bufp, row_offset);
   encode_vi32(bufp, cell_offset);
+  encode_vi32(bufp, aggregate);
 }
 
 void ScanSpec::decode(const uint8_t **bufp, size_t *remainp) {
   RowInterval ri;
   CellInterval ci;
   ColumnPredicate cp;
+  uint8_t version;
+  size_t len;
+
+  HT_TRY("decoding scan spec header",
+    version = decode_i8(bufp, remainp);
+    len = decode_vi32(bufp, remainp));
+
+  if (version != ENCODING_VERSION)
+    HT_THROWF(Error::SERIALIZATION_VERSION_MISMATCH, "ScanSpec encoding "
+              "version %d does not match expected version %d", (int)version,
+              (int)ENCODING_VERSION);
+
+  if (len > *remainp)
+    HT_THROWF(Error::SERIALIZATION_INPUT_OVERRUN, "ScanSpec length %llu "
+              "exceeds remaining %llu bytes", (Llu)len, (Llu)*remainp);
+
+  // Decode the fields within their length, skipping any trailing fields
+  // appended by newer writers
+  const uint8_t *ptr = *bufp;
+  size_t remain = len;
   HT_TRY("decoding scan spec",
-    row_limit = decode_vi32(bufp, remainp);
-    cell_limit = decode_vi32(bufp, remainp);
-    cell_limit_per_family = decode_vi32(bufp, remainp);
-    max_versions = decode_vi32(bufp, remainp);
-    for (size_t nc = decode_vi32(bufp, remainp); nc--;)
-      columns.push_back(decode_vstr(bufp, remainp));
-    for (size_t nri = decode_vi32(bufp, remainp); nri--;) {
-      ri.decode(bufp, remainp);
+    row_limit = decode_vi32(&ptr, &remain);
+    cell_limit = decode_vi32(&ptr, &remain);
+    cell_limit_per_family = decode_vi32(&ptr, &remain);
+    max_versions = decode_vi32(&ptr, &remain);
+    for (size_t nc = decode_vi32(&ptr, &remain); nc--;)
+      columns.push_back(decode_vstr(&ptr, &remain));
+    for (size_t nri = decode_vi32(&ptr, &remain); nri--;) {
+      ri.decode(&ptr, &remain);
       row_intervals.push_back(ri);
     }
-    for (size_t nci = decode_vi32(bufp, remainp); nci--;) {
-      ci.decode(bufp, remainp);
+    for (size_t nci = decode_vi32(&ptr, &remain); nci--;) {
+      ci.decode(&ptr, &remain);
       cell_intervals.push_back(ci);
     }
-    for (size_t nri = decode_vi32(bufp, remainp); nri--;) {
-      cp.decode(bufp, remainp);
+    for (size_t nri = decode_vi32(&ptr, &remain); nri--;) {
+      cp.decode(&ptr, &remain);
       column_predicates.push_back(cp);
     }
-    time_interval.first = decode_i64(bufp, remainp);
-    time_interval.second = decode_i64(bufp, remainp);
-    return_deletes = decode_bool(bufp, remainp);
-    keys_only = decode_bool(bufp, remainp);
-    row_regexp = decode_vstr(bufp, remainp);
-    value_regexp = decode_vstr(bufp, remainp);
-    scan_and_filter_rows = decode_bool(bufp, remainp);
-    do_not_cache = decode_bool(bufp, remainp);
-    row_offset = decode_vi32(bufp, remainp);
-    cell_offset = decode_vi32(bufp, remainp));
+    time_interval.first = decode_i64(&ptr, &remain);
+    time_interval.second = decode_i64(&ptr, &remain);
+    return_deletes = decode_bool(&ptr, &remain);
+    keys_only = decode_bool(&ptr, &remain);
+    row_regexp = decode_vstr(&ptr, &remain);
+    value_regexp = decode_vstr(&ptr, &remain);
+    scan_and_filter_rows = decode_bool(&ptr, &remain);
+    do_not_cache = decode_bool(&ptr, &remain);
+    row_offset = decode_vi32(&ptr, &remain);
+    cell_offset = decode_vi32(&ptr, &remain);
+    aggregate = decode_vi32(&ptr, &remain));
+  *bufp += len;
+  *remainp -= len;
 }
 
 
@@ -243,6 +275,7 @@ ostream &Hypertable::operator<<(ostream &os, const ScanSpec &scan_spec) {
   os <<" do_not_cache=" << scan_spec.do_not_cache;
   os <<" row_offset=" << scan_spec.row_offset;
   os <<" cell_offset=" << scan_spec.cell_offset;
+  os <<" aggregate=" << scan_spec.aggregate;
 
   if (!scan_spec.row_intervals.empty()) {
     os << "\n rows=";
@@ -285,7 +318,7 @@ ScanSpec::ScanSpec(CharArena &arena, const ScanSpec &ss)
     return_deletes(ss.return_deletes), keys_only(ss.keys_only),
     row_regexp(arena.dup(ss.row_regexp)), value_regexp(arena.dup(ss.value_regexp)),
     scan_and_filter_rows(ss.scan_and_filter_rows),
-    do_not_cache(ss.do_not_cache) {
+    do_not_cache(ss.do_not_cache), aggregate(ss.aggregate) {
   columns.reserve(ss.columns.size());
   row_intervals.reserve(ss.row_intervals.size());
   cell_intervals.reserve(ss.cell_intervals.size());
@@ -143,13 +143,28 @@ typedef std::vector<ColumnPredicate, ColumnPredicateAlloc> ColumnPredicates;
  */
 class ScanSpec {
 public:
+
+  /** Aggregation modes.
+   * When #aggregate is not AGGREGATE_NONE, range servers do not return the
+   * matching cells but partial aggregates (see ScanAggregate) over them, one
+   * cell per group, which the client combines with ScanAggregator.
+   */
+  enum {
+    /// Return cells
+    AGGREGATE_NONE = 0,
+    /// One aggregate per (row, column family); returned with the group's row
+    AGGREGATE_BY_ROW = 1,
+    /// One aggregate per column family; returned with an arbitrary row
+    AGGREGATE_BY_COLUMN = 2
+  };
+
   ScanSpec()
     : row_limit(0), cell_limit(0), cell_limit_per_family(0), 
       row_offset(0), cell_offset(0), max_versions(0),
       time_interval(TIMESTAMP_MIN, TIMESTAMP_MAX),
       return_deletes(false), keys_only(false),
       row_regexp(0), value_regexp(0), scan_and_filter_rows(false),
-      do_not_cache(false) { }
+      do_not_cache(false), aggregate(AGGREGATE_NONE) { }
   ScanSpec(CharArena &arena)
     : row_limit(0), cell_limit(0), cell_limit_per_family(0), 
       row_offset(0), cell_offset(0), max_versions(0), columns(CstrAlloc(arena)),
@@ -159,12 +174,26 @@ public:
       time_interval(TIMESTAMP_MIN, TIMESTAMP_MAX),
       return_deletes(false), keys_only(false),
       row_regexp(0), value_regexp(0), scan_and_filter_rows(false),
-      do_not_cache(false) { }
+      do_not_cache(false), aggregate(AGGREGATE_NONE) { }
   ScanSpec(CharArena &arena, const ScanSpec &);
   ScanSpec(const uint8_t **bufp, size_t *remainp) { decode(bufp, remainp); }
 
+  /** Serialization format version.  The encoding is the version (1 byte),
+   * the length of the fields that follow (vint32) and the fields.  Fields
+   * added without changing the version must be appended, so that older
+   * readers can skip them using the length.
+   */
+  static const uint8_t ENCODING_VERSION = 1;
+
   size_t encoded_length() const;
   void encode(uint8_t **bufp) const;
+
+  /** Decodes a serialized scan spec.
+   * @param bufp Address of pointer to serialized spec (advanced)
+   * @param remainp Address of remaining byte count (decremented)
+   * @throws Exception with code Error::SERIALIZATION_VERSION_MISMATCH if
+   * the spec was serialized with a different version
+   */
   void decode(const uint8_t **bufp, size_t *remainp);
 
   void clear() {
@@ -186,6 +215,7 @@ public:
     value_regexp = 0;
     scan_and_filter_rows = false;
     do_not_cache = false;
+    aggregate = AGGREGATE_NONE;
   }
 
   /** 
@@ -214,11 +244,12 @@ public:
     other.value_regexp = value_regexp;
     other.scan_and_filter_rows = scan_and_filter_rows;
     other.do_not_cache = do_not_cache;
+    other.aggregate = aggregate;
     other.column_predicates = column_predicates;
   }
 
   bool cacheable() {
-    if (do_not_cache)
+    if (do_not_cache || aggregate != AGGREGATE_NONE)
       return false;
     else if (row_intervals.size() == 1) {
       HT_ASSERT(row_intervals[0].start && row_intervals[0].end);
@@ -368,6 +399,12 @@ public:
   const char *value_regexp;
   bool scan_and_filter_rows;
   bool do_not_cache;
+  uint32_t aggregate;
+
+private:
+
+  /// Returns the encoded length of the fields following the header
+  size_t encoded_length_fields() const;
 };
 
 /**
@@ -581,6 +618,18 @@ public:
     m_scan_spec.do_not_cache = val;
   }
 
+  /**
+   * Return partial aggregates instead of cells
+   *
+   * @param mode one of the ScanSpec::AGGREGATE_* modes
+   */
+  void set_aggregate(uint32_t mode) {
+    if (mode > ScanSpec::AGGREGATE_BY_COLUMN)
+      HT_THROWF(Error::BAD_SCAN_SPEC, "Invalid aggregation mode %u",
+                (unsigned)mode);
+    m_scan_spec.aggregate = mode;
+  }
+
   /**
    * Clears the state.
    */
@@ -74,7 +74,7 @@ bool desc_inited = false;
 PropertiesDesc
   compressor_desc("  bmz|lzo|quicklz|zlib|snappy|none [compressor_options]\n\n"
       "compressor_options"),
-  bloom_filter_desc("  rows|rows+cols|none [bloom_filter_options]\n\n"
+  bloom_filter_desc("  rows|rows+cols|prefix|none [bloom_filter_options]\n\n"
       "  Default bloom filter is defined by the config property:\n"
       "  Hypertable.RangeServer.CellStore.DefaultBloomFilter.\n\n"
       "bloom_filter_options");
@@ -109,9 +109,13 @@ void init_schema_options_desc() {
      "probability for the Bloom filter")
     ("max-approx-items", i32()->default_value(1000), "Number of cell store "
         "items used to guess the number of actual Bloom filter entries")
+    ("prefix-length", i32()->default_value(0), "Number of leading row bytes "
+        "inserted into the Bloom filter in prefix mode")
+    ("prefix-delimiter", str()->default_value(""), "Character terminating "
+        "the row prefix inserted into the Bloom filter in prefix mode")
     ;
   bloom_filter_hidden_desc.add_options()
-    ("bloom-filter-mode", str(), "Bloom filter mode (rows|rows+cols|none)")
+    ("bloom-filter-mode", str(), "Bloom filter mode (rows|rows+cols|prefix|none)")
     ;
   bloom_filter_pos_desc.add("bloom-filter-mode", 1);
   desc_inited = true;
@@ -248,6 +252,21 @@ Schema::parse_bloom_filter(const String &bloom_filter, PropertiesPtr &props) {
            || mode == "rows-cols" || mode == "row-col"
            || mode == "rows_cols" || mode == "row_col")
     props->set("bloom-filter-mode", BLOOM_FILTER_ROWS_COLS);
+  else if (mode == "prefix" || mode == "row-prefix" || mode == "rows-prefix"
+           || mode == "row_prefix" || mode == "rows_prefix") {
+    int32_t prefix_length = props->get_i32("prefix-length");
+    String delimiter = props->get_str("prefix-delimiter");
+    if (prefix_length < 0 || prefix_length > 65535)
+      HT_THROWF(Error::BAD_SCHEMA, "bad bloom filter prefix length: %d",
+                (int)prefix_length);
+    if (delimiter.length() > 1)
+      HT_THROWF(Error::BAD_SCHEMA, "bloom filter prefix delimiter must be a "
+                "single character: '%s'", delimiter.c_str());
+    if (prefix_length == 0 && delimiter.empty())
+      HT_THROW(Error::BAD_SCHEMA, "bloom filter mode 'prefix' requires "
+               "--prefix-length or --prefix-delimiter");
+    props->set("bloom-filter-mode", BLOOM_FILTER_ROW_PREFIX);
+  }
   else HT_THROWF(Error::BAD_SCHEMA, "unknown bloom filter mode: '%s'",
                  mode.c_str());
 }
@@ -37,7 +37,8 @@ namespace Hypertable {
   enum BloomFilterMode {
     BLOOM_FILTER_DISABLED,
     BLOOM_FILTER_ROWS,
-    BLOOM_FILTER_ROWS_COLS
+    BLOOM_FILTER_ROWS_COLS,
+    BLOOM_FILTER_ROW_PREFIX
   };
 
   class Schema : public ReferenceCount {
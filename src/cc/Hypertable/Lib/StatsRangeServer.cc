@@ -19,8 +19,11 @@
  * 02110-1301, USA.
  */
 #include "Common/Compat.h"
+#include "Common/Logger.h"
 #include "Common/Serialization.h"
 
+#include <limits>
+
 #include "KeySpec.h"
 #include "StatsRangeServer.h"
 
@@ -28,16 +31,20 @@ using namespace Hypertable;
 
 namespace {
   enum Group {
-    PRIMARY_GROUP = 0
+    PRIMARY_GROUP = 0,
+    LATENCY_GROUP = 1,
+    MEMORY_GROUP = 2
   };
 }
 
-StatsRangeServer::StatsRangeServer() : StatsSerializable(RANGE_SERVER, 1), timestamp(TIMESTAMP_MIN) {
+StatsRangeServer::StatsRangeServer() : StatsSerializable(RANGE_SERVER, 3), timestamp(TIMESTAMP_MIN) {
   group_ids[0] = PRIMARY_GROUP;
+  group_ids[1] = LATENCY_GROUP;
+  group_ids[2] = MEMORY_GROUP;
 }
 
 
-StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RANGE_SERVER, 1), timestamp(TIMESTAMP_MIN) {
+StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RANGE_SERVER, 3), timestamp(TIMESTAMP_MIN) {
   const char *base, *ptr;
   String datadirs = props->get_str("Hypertable.RangeServer.Monitoring.DataDirectories");
   String dir;
@@ -60,6 +67,8 @@ StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RAN
                         StatsSystem::DISK|StatsSystem::SWAP|StatsSystem::NET|
                         StatsSystem::PROC | StatsSystem::FS, dirs);
   group_ids[0] = PRIMARY_GROUP;
+  group_ids[1] = LATENCY_GROUP;
+  group_ids[2] = MEMORY_GROUP;
 }
 
 StatsRangeServer::StatsRangeServer(const StatsRangeServer &other) : StatsSerializable(other.id, other.group_count) {
@@ -91,6 +100,8 @@ StatsRangeServer::StatsRangeServer(const StatsRangeServer &other) : StatsSeriali
   live = other.live;
   system = other.system;
   tables = other.tables;
+  latency = other.latency;
+  memory_allocation = other.memory_allocation;
 }
 
 bool StatsRangeServer::operator==(const StatsRangeServer &other) const {
@@ -119,7 +130,9 @@ bool StatsRangeServer::operator==(const StatsRangeServer &other) const {
       !Serialization::equal(cpu_user, other.cpu_user) ||
       !Serialization::equal(cpu_sys, other.cpu_sys) ||
       live != other.live ||
-      system != other.system)
+      system != other.system ||
+      latency != other.latency ||
+      memory_allocation != other.memory_allocation)
     return false;
   if (tables.size() != other.tables.size())
     return false;
@@ -143,6 +156,19 @@ size_t StatsRangeServer::encoded_length_group(int group) const {
       len += tables[i].encoded_length();
     return len;
   }
+  else if (group == LATENCY_GROUP) {
+    size_t len;
+    latency_encoded_count(&len);
+    return len;
+  }
+  else if (group == MEMORY_GROUP) {
+    size_t len = Serialization::encoded_length_vi32(memory_allocation.size());
+    for (std::map<String, int64_t>::const_iterator iter =
+           memory_allocation.begin(); iter != memory_allocation.end(); ++iter)
+      len += Serialization::encoded_length_vstr(iter->first) +
+        Serialization::encoded_length_vi64(iter->second);
+    return len;
+  }
   else
     HT_FATALF("Invalid group number (%d)", group);
   return 0;
@@ -180,10 +206,51 @@ void StatsRangeServer::encode_group(int group, uint8_t **bufp) const {
     for (size_t i=0; i<tables.size(); i++)
       tables[i].encode(bufp);
   }
+  else if (group == LATENCY_GROUP) {
+    size_t len;
+    size_t count = latency_encoded_count(&len);
+    Serialization::encode_vi32(bufp, count);
+    std::map<String, LatencyHistogram::Snapshot>::const_iterator iter =
+      latency.begin();
+    for (size_t i=0; i<count; ++i, ++iter) {
+      Serialization::encode_vstr(bufp, iter->first);
+      iter->second.encode(bufp);
+    }
+  }
+  else if (group == MEMORY_GROUP) {
+    Serialization::encode_vi32(bufp, memory_allocation.size());
+    for (std::map<String, int64_t>::const_iterator iter =
+           memory_allocation.begin(); iter != memory_allocation.end(); ++iter) {
+      Serialization::encode_vstr(bufp, iter->first);
+      Serialization::encode_vi64(bufp, iter->second);
+    }
+  }
   else
     HT_FATALF("Invalid group number (%d)", group);
 }
 
+size_t StatsRangeServer::latency_encoded_count(size_t *lenp) const {
+  size_t count = 0;
+  size_t len = 0;
+  size_t limit = std::numeric_limits<uint16_t>::max() -
+    Serialization::encoded_length_vi32(latency.size());
+  for (std::map<String, LatencyHistogram::Snapshot>::const_iterator iter =
+         latency.begin(); iter != latency.end(); ++iter, ++count) {
+    size_t entry_len = Serialization::encoded_length_vstr(iter->first) +
+      iter->second.encoded_length();
+    if (len + entry_len > limit) {
+      HT_WARNF("Dropping %u of %u latency histograms, serialized length "
+               "exceeds %u bytes", (unsigned)(latency.size() - count),
+               (unsigned)latency.size(),
+               (unsigned)std::numeric_limits<uint16_t>::max());
+      break;
+    }
+    len += entry_len;
+  }
+  *lenp = len + Serialization::encoded_length_vi32(count);
+  return count;
+}
+
 void StatsRangeServer::decode_group(int group, uint16_t len, const uint8_t **bufp, size_t *remainp) {
   if (group == PRIMARY_GROUP) {
     location = Serialization::decode_vstr(bufp, remainp);
@@ -220,6 +287,22 @@ void StatsRangeServer::decode_group(int group, uint16_t len, const uint8_t **buf
       tables.push_back(table);
     }
   }
+  else if (group == LATENCY_GROUP) {
+    size_t histogram_count = Serialization::decode_vi32(bufp, remainp);
+    latency.clear();
+    for (size_t i=0; i<histogram_count; i++) {
+      String name = Serialization::decode_vstr(bufp, remainp);
+      latency[name].decode(bufp, remainp);
+    }
+  }
+  else if (group == MEMORY_GROUP) {
+    size_t consumer_count = Serialization::decode_vi32(bufp, remainp);
+    memory_allocation.clear();
+    for (size_t i=0; i<consumer_count; i++) {
+      String name = Serialization::decode_vstr(bufp, remainp);
+      memory_allocation[name] = Serialization::decode_vi64(bufp, remainp);
+    }
+  }
   else {
     HT_WARNF("Unrecognized StatsRangeServer group %d, skipping...", group);
     (*bufp) += len;
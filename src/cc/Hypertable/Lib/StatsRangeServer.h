@@ -22,10 +22,12 @@
 #ifndef HYPERTABLE_STATSRANGESERVER_H
 #define HYPERTABLE_STATSRANGESERVER_H
 
+#include <map>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
 
+#include "Common/LatencyHistogram.h"
 #include "Common/Properties.h"
 #include "Common/ReferenceCount.h"
 #include "Common/StatsSerializable.h"
@@ -92,11 +94,30 @@ namespace Hypertable {
     std::vector<StatsTable> tables;
     StatsTableMap table_map;
 
+    /// Latency histograms of requests and request phases, keyed by name;
+    /// holds the samples recorded since the previous statistics request
+    std::map<String, LatencyHistogram::Snapshot> latency;
+
+    /// Memory allocated to each consumer by the MemoryGovernor, keyed by
+    /// consumer name; empty if the governor is disabled
+    std::map<String, int64_t> memory_allocation;
+
   protected:
     virtual size_t encoded_length_group(int group) const;
     virtual void encode_group(int group, uint8_t **bufp) const;
     virtual void decode_group(int group, uint16_t len, const uint8_t **bufp, size_t *remainp);
 
+  private:
+
+    /** Returns number of latency histograms that are serialized.
+     * The length of a serialized group is a 16-bit quantity, so only the
+     * leading entries of #latency that fit are encoded; the rest are
+     * dropped with a warning.
+     * @param lenp Address of variable to hold encoded length of the group
+     * @return Number of entries of #latency to encode
+     */
+    size_t latency_encoded_count(size_t *lenp) const;
+
   };
   typedef intrusive_ptr<StatsRangeServer> StatsRangeServerPtr;
 
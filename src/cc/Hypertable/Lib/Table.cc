@@ -20,9 +20,13 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <cstring>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
 
 #include "Common/String.h"
 #include "Common/DynamicBuffer.h"
@@ -30,10 +34,15 @@
 #include "Common/Logger.h"
 
 #include "AsyncComm/ApplicationQueue.h"
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
+#include "AsyncComm/Protocol.h"
 
 #include "Hyperspace/HandleCallback.h"
 #include "Hyperspace/Session.h"
 
+#include "Key.h"
+#include "RangeServerClient.h"
+#include "ScanBlock.h"
 #include "Table.h"
 #include "TableScanner.h"
 #include "TableMutator.h"
@@ -230,3 +239,199 @@ Table::create_scanner_async(ResultCallback *cb, const ScanSpec &scan_spec, uint3
                                 timeout_ms ? timeout_ms : m_timeout_ms, cb,
                                 flags);
 }
+
+namespace {
+
+  /// Request for the keys of one range, sent by Table::multi_get()
+  struct MultiGetRequest {
+    MultiGetRequest() : error(Error::OK) { }
+    /// Index of first key
+    size_t begin;
+    /// Index past the last key
+    size_t end;
+    /// Location of the range
+    RangeLocationInfo range_info;
+    /// Receives the response
+    DispatchHandlerSynchronizer handler;
+    /// Response event
+    EventPtr event;
+    /// Error sending the request or error response
+    int error;
+    /// Error message
+    String error_msg;
+  };
+
+  typedef boost::shared_ptr<MultiGetRequest> MultiGetRequestPtr;
+
+  bool lt_server(const MultiGetRequestPtr &lhs, const MultiGetRequestPtr &rhs) {
+    return lhs->range_info.addr < rhs->range_info.addr;
+  }
+
+  /// Errors after which the range is looked up again
+  bool multi_get_retryable(int error) {
+    return error == Error::RANGESERVER_RANGE_NOT_FOUND ||
+      error == Error::REQUEST_TIMEOUT ||
+      error == Error::COMM_NOT_CONNECTED ||
+      error == Error::COMM_BROKEN_CONNECTION ||
+      error == Error::COMM_INVALID_PROXY;
+  }
+
+  void add_cells(ScanBlock &block, SchemaPtr &schema, CellsBuilder &cells) {
+    SerializedKey serkey;
+    ByteString value;
+    Key key;
+    Cell cell;
+
+    while (block.next(serkey, value)) {
+      if (!key.load(serkey))
+        HT_THROW(Error::BAD_KEY, "");
+      Schema::ColumnFamily *cf = schema->get_column_family(key.column_family_code);
+      if (cf == 0) {
+        if (key.flag != FLAG_DELETE_ROW)
+          HT_THROWF(Error::BAD_KEY, "Unexpected column family code %d",
+                    (int)key.column_family_code);
+        cell.column_family = "";
+      }
+      else
+        cell.column_family = cf->name.c_str();
+      cell.row_key = key.row;
+      cell.column_qualifier = key.column_qualifier;
+      cell.timestamp = key.timestamp;
+      cell.revision = key.revision;
+      cell.value_len = value.decode_length(&cell.value);
+      cell.flag = key.flag;
+      cells.add(cell);
+    }
+  }
+
+}
+
+void Table::multi_get(const std::vector<std::pair<String, String> > &keys,
+                      CellsBuilder &cells, uint32_t max_versions,
+                      uint32_t timeout_ms) {
+  std::vector<std::pair<String, String> > sorted(keys);
+  TableIdentifierManaged table;
+  SchemaPtr schema;
+  uint32_t timeout = timeout_ms ? timeout_ms : m_timeout_ms;
+  Timer timer(timeout, true);
+  RangeServerClient range_server(m_comm, timeout);
+  std::vector<std::pair<size_t, size_t> > spans;
+  std::vector<MultiGetRequestPtr> requests;
+  std::map<size_t, boost::shared_ptr<ScanBlock> > results;
+  uint32_t completed;
+  bool hard = false;
+
+  std::sort(sorted.begin(), sorted.end());
+  get(table, schema);
+
+  if (sorted.size() > 1) {
+    std::vector<const char *> rows;
+    rows.reserve(sorted.size());
+    for (size_t i=0; i<sorted.size(); i++)
+      rows.push_back(sorted[i].first.c_str());
+    m_range_locator->prefetch(&table, rows, timer);
+  }
+
+  // Runs of keys still to be fetched
+  if (!sorted.empty())
+    spans.push_back(std::make_pair((size_t)0, sorted.size()));
+
+  while (!spans.empty()) {
+
+    // The keys of one range go out in a single request
+    requests.clear();
+    for (size_t i=0; i<spans.size(); i++) {
+      size_t next = spans[i].first;
+      while (next < spans[i].second) {
+        MultiGetRequestPtr request(new MultiGetRequest());
+        m_range_locator->find_loop(&table, sorted[next].first.c_str(),
+                                   &request->range_info, timer, hard);
+        request->begin = next;
+        request->end = next + 1;
+        while (request->end < spans[i].second &&
+               sorted[request->end].first <= request->range_info.end_row)
+          request->end++;
+        next = request->end;
+        requests.push_back(request);
+      }
+    }
+    spans.clear();
+    hard = false;
+
+    // Requests are batched by server and all of them are sent before
+    // waiting for the first response
+    std::stable_sort(requests.begin(), requests.end(), lt_server);
+    foreach_ht (MultiGetRequestPtr &request, requests) {
+      RangeSpec range(request->range_info.start_row.c_str(),
+                      request->range_info.end_row.c_str());
+      try {
+        range_server.multi_get(request->range_info.addr, table, range,
+                               max_versions, &sorted[request->begin],
+                               request->end - request->begin,
+                               &request->handler, timer);
+      }
+      catch (Exception &e) {
+        request->error = e.code();
+        request->error_msg = e.what();
+      }
+    }
+
+    // Every response is waited for before any error is raised, since the
+    // handlers go away with the requests
+    foreach_ht (MultiGetRequestPtr &request, requests) {
+      if (request->error == Error::OK &&
+          !request->handler.wait_for_reply(request->event)) {
+        request->error = Protocol::response_code(request->event);
+        request->error_msg = Protocol::string_format_message(request->event);
+      }
+    }
+
+    foreach_ht (MultiGetRequestPtr &request, requests) {
+      size_t count = request->end - request->begin;
+      boost::shared_ptr<ScanBlock> block(new ScanBlock());
+
+      if (request->error == Error::OK &&
+          (request->error = block->load_multi_get(request->event,
+                                                  &completed)) != Error::OK)
+        request->error_msg = "Problem decoding multi get response";
+
+      if (request->error != Error::OK) {
+        if (!multi_get_retryable(request->error))
+          HT_THROWF(request->error, "Problem fetching %u keys from "
+                    "%s[%s..%s] - %s", (unsigned)count, table.id,
+                    request->range_info.start_row.c_str(),
+                    request->range_info.end_row.c_str(),
+                    request->error_msg.c_str());
+        if (timer.remaining() <= 1000)
+          HT_THROWF(Error::REQUEST_TIMEOUT, "Unable to complete multi get "
+                    "within %u ms - %s", (unsigned)timeout,
+                    request->error_msg.c_str());
+        m_range_locator->invalidate(&table,
+                                    sorted[request->begin].first.c_str());
+        spans.push_back(std::make_pair(request->begin, request->end));
+        hard = true;
+        continue;
+      }
+
+      if (completed == 0 || completed > count)
+        HT_THROWF(Error::PROTOCOL_ERROR, "Multi get of %u keys returned %u "
+                  "completed keys", (unsigned)count, (unsigned)completed);
+
+      results[request->begin] = block;
+
+      // The server stopped early to bound the response, ask for the rest
+      if (completed < count)
+        spans.push_back(std::make_pair(request->begin + completed,
+                                       request->end));
+    }
+
+    if (hard)
+      poll(0, 0, 1000);
+  }
+
+  // Responses are keyed by their first key, so this adds the cells in key
+  // order
+  for (std::map<size_t, boost::shared_ptr<ScanBlock> >::iterator iter =
+         results.begin(); iter != results.end(); ++iter)
+    add_cells(*iter->second, schema, cells);
+}
@@ -27,6 +27,7 @@
 
 #include "AsyncComm/ApplicationQueueInterface.h"
 
+#include "Cells.h"
 #include "ClientObject.h"
 #include "NameIdMapper.h"
 #include "Schema.h"
@@ -62,7 +63,11 @@ namespace Hypertable {
       OPEN_FLAG_REFRESH_TABLE_CACHE          = 0x02,
       OPEN_FLAG_NO_AUTO_TABLE_REFRESH        = 0x04,
 
-      SCANNER_FLAG_IGNORE_INDEX              = 0x01
+      SCANNER_FLAG_IGNORE_INDEX              = 0x01,
+      /// Scan ranges concurrently, see Hypertable.Scanner.Parallelism
+      SCANNER_FLAG_PARALLEL                  = 0x02,
+      /// Like SCANNER_FLAG_PARALLEL, delivering cells in arrival order
+      SCANNER_FLAG_UNORDERED                 = 0x04
     };
 
     enum {
@@ -129,6 +134,25 @@ namespace Hypertable {
                                             uint32_t timeout_ms = 0,
                                             int32_t flags = 0);
 
+    /**
+     * Fetches the cells of a batch of keys.  The keys are sorted and
+     * grouped by the range that contains them, as found through the
+     * location cache (the locations of the whole key span are prefetched
+     * first), and every group is fetched with a single "multi get"
+     * request instead of one scanner per key.  Ranges that moved or split
+     * in the meantime are looked up again until the timeout expires.
+     *
+     * @param keys (row, column) pairs; the column is "family" or
+     *        "family:qualifier", or empty for all columns of the row
+     * @param cells Receives the cells, ordered by key
+     * @param max_versions maximum number of versions per column, 0 for all
+     * @param timeout_ms maximum time in milliseconds to allow for the
+     *        whole batch
+     */
+    void multi_get(const std::vector<std::pair<String, String> > &keys,
+                   CellsBuilder &cells, uint32_t max_versions = 0,
+                   uint32_t timeout_ms = 0);
+
     void get_identifier(TableIdentifier *table_id_p) {
       ScopedLock lock(m_mutex);
       refresh_if_required();
@@ -249,6 +273,8 @@ namespace Hypertable {
 
     RangeLocatorPtr get_range_locator() { return m_range_locator; }
 
+    PropertiesPtr get_properties() { return m_props; }
+
   private:
     void initialize();
     void refresh_if_required();
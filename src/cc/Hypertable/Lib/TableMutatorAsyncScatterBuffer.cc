@@ -256,11 +256,11 @@ void TableMutatorAsyncScatterBuffer::send(uint32_t flags) {
       continue;
     }
 
-    send_buffer->pending_updates.set(new uint8_t [len], len);
+    send_buffer->pending_chain.clear();
 
     if (send_buffer->resend()) {
-      memcpy(send_buffer->pending_updates.base,
-             send_buffer->accum.base, len);
+      // Retried updates were appended in send order, send them in place
+      send_buffer->pending_updates.set(send_buffer->accum.release(), len);
       send_buffer->send_count = send_buffer->retry_count;
     }
     else {
@@ -274,16 +274,43 @@ void TableMutatorAsyncScatterBuffer::send(uint32_t flags) {
       }
       sort(send_vec.begin(), send_vec.end());
 
-      ptr = send_buffer->pending_updates.base;
-
+      // Gather the sorted key/value pairs into segments of the accumulation
+      // buffer, merging pairs that are already adjacent
+      std::vector<struct iovec> &chain = send_buffer->pending_chain;
       for (size_t i=0; i<send_vec.size(); i++) {
         key = send_vec[i].key;
         key.next();  // skip key
         key.next();  // skip value
-        memcpy(ptr, send_vec[i].key.ptr, key.ptr - send_vec[i].key.ptr);
-        ptr += key.ptr - send_vec[i].key.ptr;
+        if (!chain.empty() &&
+            (uint8_t *)chain.back().iov_base + chain.back().iov_len
+            == send_vec[i].key.ptr)
+          chain.back().iov_len += key.ptr - send_vec[i].key.ptr;
+        else {
+          struct iovec segment;
+          segment.iov_base = (void *)send_vec[i].key.ptr;
+          segment.iov_len = key.ptr - send_vec[i].key.ptr;
+          chain.push_back(segment);
+        }
+      }
+
+      if (chain.size() == 1 || len / chain.size() >= ms_min_segment_length) {
+        // Already in order or large pairs; send straight out of the
+        // accumulation buffer
+        send_buffer->pending_updates.set(send_buffer->accum.release(), len);
+        if (chain.size() == 1)
+          chain.clear();
+      }
+      else {
+        // Small pairs out of order, gathering is cheaper as a copy
+        send_buffer->pending_updates.set(new uint8_t [len], len);
+        ptr = send_buffer->pending_updates.base;
+        for (size_t i=0; i<chain.size(); i++) {
+          memcpy(ptr, chain[i].iov_base, chain[i].iov_len);
+          ptr += chain[i].iov_len;
+        }
+        HT_ASSERT((size_t)(ptr-send_buffer->pending_updates.base)==len);
+        chain.clear();
       }
-      HT_ASSERT((size_t)(ptr-send_buffer->pending_updates.base)==len);
       send_buffer->dispatch_handler =
         new TableMutatorAsyncDispatchHandler(m_app_queue, m_mutator, m_id, send_buffer.get(),
                                              m_auto_refresh);
@@ -299,9 +326,14 @@ void TableMutatorAsyncScatterBuffer::send(uint32_t flags) {
     try {
       m_send_flags = flags;
       send_buffer->pending_updates.own = false;
-      m_range_server.update(send_buffer->addr, m_table_identifier,
-                            send_buffer->send_count, send_buffer->pending_updates, flags,
-                            send_buffer->dispatch_handler.get());
+      if (send_buffer->pending_chain.empty())
+        m_range_server.update(send_buffer->addr, m_table_identifier,
+                              send_buffer->send_count, send_buffer->pending_updates,
+                              flags, send_buffer->dispatch_handler.get());
+      else
+        m_range_server.update(send_buffer->addr, m_table_identifier,
+                              send_buffer->send_count, send_buffer->pending_chain,
+                              flags, send_buffer->dispatch_handler.get());
 
       outstanding = true;
 
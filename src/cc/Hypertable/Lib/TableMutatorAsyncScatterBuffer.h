@@ -126,6 +126,8 @@ namespace Hypertable {
     uint32_t             m_send_flags;
     uint32_t             m_wait_time;
     const static uint32_t ms_init_redo_wait_time=1000;
+    // Average segment length above which updates are sent without copying
+    const static uint32_t ms_min_segment_length=1024;
     bool dead;
   };
 
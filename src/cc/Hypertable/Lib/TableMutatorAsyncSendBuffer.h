@@ -26,6 +26,12 @@
 
 #include "TableMutatorAsyncCompletionCounter.h"
 
+#include <boost/shared_array.hpp>
+
+#include <vector>
+
+#include <sys/uio.h>
+
 namespace Hypertable {
 
   struct FailedRegionAsync {
@@ -46,25 +52,25 @@ namespace Hypertable {
         m_range_locator(rl) { }
 
     void add_retries(uint32_t count, uint32_t offset, uint32_t len) {
-      accum.add(pending_updates.base+offset, len);
+      append_pending(offset, len);
       counterp->set_retries();
       retry_count += count;
       // invalidate row key
-      SerializedKey key(pending_updates.base+offset);
+      SerializedKey key(pending_ptr(offset));
       m_range_locator->invalidate(m_table_identifier, key.row());
     }
 
     void add_retries_all(bool with_error=false, uint32_t error=0) {
-      accum.add(pending_updates.base, pending_updates.size);
+      append_pending(0, pending_updates.size);
       counterp->set_retries();
       retry_count = send_count;
       // invalidate row key
-      SerializedKey key(pending_updates.base);
+      SerializedKey key(pending_ptr(0));
       m_range_locator->invalidate(m_table_identifier, key.row());
       if (with_error) {
         FailedRegionAsync failed;
         failed.error=(int) error;
-        failed.base = pending_updates.base;
+        failed.base = pending_region(0, pending_updates.size);
         failed.len = pending_updates.size;
         failed_regions.push_back(failed);
         counterp->set_errors();
@@ -75,7 +81,7 @@ namespace Hypertable {
       FailedRegionAsync failed;
       (void)count;
       failed.error = error;
-      failed.base = pending_updates.base + offset;
+      failed.base = pending_region(offset, len);
       failed.len = len;
       failed_regions.push_back(failed);
       counterp->set_errors();
@@ -83,7 +89,7 @@ namespace Hypertable {
     void add_errors_all(uint32_t error) {
       FailedRegionAsync failed;
       failed.error = (int)error;
-      failed.base = pending_updates.base;
+      failed.base = pending_region(0, pending_updates.size);
       failed.len = pending_updates.size;
       failed_regions.push_back(failed);
       counterp->set_errors();
@@ -92,6 +98,8 @@ namespace Hypertable {
       key_offsets.clear();
       accum.clear();
       pending_updates.free();
+      pending_chain.clear();
+      failed_copies.clear();
       failed_regions.clear();
       send_count = 0;
       retry_count = 0;
@@ -109,6 +117,11 @@ namespace Hypertable {
     std::vector<uint64_t> key_offsets;
     DynamicBuffer accum;
     StaticBuffer pending_updates;
+    /// Segments of #pending_updates in send order, empty if
+    /// #pending_updates is sent as is
+    std::vector<struct iovec> pending_chain;
+    /// Contiguous copies of failed regions spanning several segments
+    std::vector<boost::shared_array<uint8_t> > failed_copies;
     CommAddress addr;
     TableMutatorAsyncCompletionCounter *counterp;
     DispatchHandlerPtr dispatch_handler;
@@ -117,6 +130,85 @@ namespace Hypertable {
     uint32_t retry_count;
 
   private:
+
+    /** Appends a region of the sent updates to #accum.
+     * @param offset Offset of the region in the sent update stream
+     * @param len Length of the region
+     */
+    void append_pending(uint32_t offset, uint32_t len) {
+      if (pending_chain.empty()) {
+        accum.add(pending_updates.base+offset, len);
+        return;
+      }
+      size_t i;
+      offset = locate_pending(offset, &i);
+      for (; len; i++) {
+        uint32_t n = pending_chain[i].iov_len - offset;
+        if (n > len)
+          n = len;
+        accum.add((uint8_t *)pending_chain[i].iov_base + offset, n);
+        len -= n;
+        offset = 0;
+      }
+    }
+
+    /** Locates a position in the sent updates.
+     * @param offset Offset in the sent update stream
+     * @param indexp Address of variable to receive the segment index
+     * @return Offset within segment <code>*indexp</code>
+     */
+    uint32_t locate_pending(uint32_t offset, size_t *indexp) {
+      size_t i = 0;
+      while (offset >= pending_chain[i].iov_len) {
+        offset -= pending_chain[i].iov_len;
+        i++;
+      }
+      *indexp = i;
+      return offset;
+    }
+
+    /** Returns a pointer to a position in the sent updates.  Entries are
+     * never split across segments, so the key/value pair starting at
+     * <code>offset</code> is contiguous.
+     * @param offset Offset of a key/value pair in the sent update stream
+     * @return Pointer to the key/value pair
+     */
+    uint8_t *pending_ptr(uint32_t offset) {
+      if (pending_chain.empty())
+        return pending_updates.base + offset;
+      size_t i;
+      offset = locate_pending(offset, &i);
+      return (uint8_t *)pending_chain[i].iov_base + offset;
+    }
+
+    /** Returns a contiguous copy of a region of the sent updates.  Regions
+     * that lie within a single segment are returned in place, others are
+     * copied into #failed_copies.
+     * @param offset Offset of the region in the sent update stream
+     * @param len Length of the region
+     * @return Pointer to the region
+     */
+    uint8_t *pending_region(uint32_t offset, uint32_t len) {
+      if (pending_chain.empty())
+        return pending_updates.base + offset;
+      size_t i;
+      offset = locate_pending(offset, &i);
+      if (offset + len <= pending_chain[i].iov_len)
+        return (uint8_t *)pending_chain[i].iov_base + offset;
+      boost::shared_array<uint8_t> copy(new uint8_t [len]);
+      for (uint8_t *ptr = copy.get(); len; i++) {
+        uint32_t n = pending_chain[i].iov_len - offset;
+        if (n > len)
+          n = len;
+        memcpy(ptr, (uint8_t *)pending_chain[i].iov_base + offset, n);
+        ptr += n;
+        len -= n;
+        offset = 0;
+      }
+      failed_copies.push_back(copy);
+      return copy.get();
+    }
+
     const TableIdentifier *m_table_identifier;
     RangeLocator *m_range_locator;
   };
@@ -20,14 +20,19 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <vector>
 
 #include "Common/Error.h"
 #include "Common/String.h"
+#include "Common/Time.h"
+
+#include "AsyncComm/ApplicationHandler.h"
 
 #include "Table.h"
 #include "TableScannerAsync.h"
 #include "IndexScannerCallback.h"
+#include "IndexScanPlanner.h"
 #include "LoadDataEscape.h"
 
 extern "C" {
@@ -36,6 +41,31 @@ extern "C" {
 
 using namespace Hypertable;
 
+namespace {
+  struct LtRowIntervalStart {
+    bool operator()(const RowInterval &ri1, const RowInterval &ri2) const {
+      return strcmp(ri1.start, ri2.start) < 0;
+    }
+  };
+}
+
+namespace Hypertable {
+
+  /** Starts pending intervals of a parallel scan.
+   * Queued from scan callbacks, which run with the scanner's mutex held,
+   * so that the range lookups of the intervals started next are done
+   * without that mutex.
+   */
+  class LaunchIntervalsHandler : public ApplicationHandler {
+  public:
+    LaunchIntervalsHandler(TableScannerAsync *scanner) : m_scanner(scanner) { }
+    virtual void run() { m_scanner->launch_deferred_intervals(); }
+  private:
+    TableScannerAsync *m_scanner;
+  };
+
+}
+
 
 /**
  *
@@ -45,9 +75,10 @@ TableScannerAsync::TableScannerAsync(Comm *comm,
       RangeLocatorPtr &range_locator, const ScanSpec &scan_spec, 
       uint32_t timeout_ms, ResultCallback *cb, int flags)
   : m_bytes_scanned(0), m_current_scanner(0), m_outstanding(0), 
-    m_error(Error::OK), m_cancelled(false), m_use_index(false)
+    m_error(Error::OK), m_cancelled(false), m_use_index(false),
+    m_plan(-1), m_start_ns(get_ts64()), m_parallelism(0), m_unordered(false),
+    m_launch_scheduled(false), m_comm(comm), m_app_queue(app_queue), m_range_locator(range_locator)
 {
-  ScopedLock lock(m_mutex);
   ScanSpecBuilder primary_spec(scan_spec);
   ScanSpecBuilder index_spec;
   const ScanSpec *first_pass_spec;
@@ -55,9 +86,30 @@ TableScannerAsync::TableScannerAsync(Comm *comm,
 
   HT_ASSERT(timeout_ms);
 
-  // can we optimize this query with an index?
+  // can we optimize this query with an index?  if so, let the planner
+  // decide whether the index is selective enough to be worth it.  The
+  // planner does synchronous METADATA lookups, so this is done before
+  // m_mutex is acquired
   if (!(flags & Table::SCANNER_FLAG_IGNORE_INDEX)
       && use_index(table, scan_spec, index_spec, &use_qualifier)) {
+    Table *index_table = use_qualifier
+      ? table->get_qualifier_index_table().get()
+      : table->get_index_table().get();
+    TableIdentifierManaged index_table_id;
+    SchemaPtr index_schema;
+    index_table->get(index_table_id, index_schema);
+    RangeLocatorPtr index_range_locator = index_table->get_range_locator();
+    Timer index_timer(timeout_ms, true);
+    LocatorRangeFinder index_ranges(index_range_locator, &index_table_id,
+                                    index_timer);
+    PropertiesPtr props = index_table->get_properties();
+    IndexScanPlanner planner(index_table->get_name(), props);
+    m_plan = planner.choose(scan_spec, index_spec.get(), index_ranges);
+  }
+
+  ScopedLock lock(m_mutex);
+
+  if (m_plan == IndexScanPlanner::INDEX_SCAN) {
 
     first_pass_spec = &index_spec.get();
 
@@ -81,6 +133,14 @@ TableScannerAsync::TableScannerAsync(Comm *comm,
   else {
     transform_primary_scan_spec(primary_spec);
     first_pass_spec = &primary_spec.get();
+
+    if (flags & (Table::SCANNER_FLAG_PARALLEL|Table::SCANNER_FLAG_UNORDERED)) {
+      m_parallelism =
+        table->get_properties()->get_i32("Hypertable.Scanner.Parallelism");
+      if (m_parallelism < 1)
+        m_parallelism = 1;
+      m_unordered = (flags & Table::SCANNER_FLAG_UNORDERED) != 0;
+    }
   }
 
   m_cb = cb;
@@ -272,11 +332,20 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
   Timer timer(timeout_ms);
   bool current_set = false;
 
+  m_timeout_ms = timeout_ms;
   m_cb->increment_outstanding();
   m_cb->register_scanner(this);
 
   try {
-    if (scan_spec.row_intervals.empty()) {
+    if (m_parallelism && can_scan_in_parallel(scan_spec)) {
+      // one interval per range; at most m_parallelism of them are scanned
+      // at a time, the rest are started as earlier ones finish
+      m_parallel_spec = scan_spec;
+      partition_intervals(table, range_locator, m_parallel_spec.get(), timer);
+      m_outstanding += m_pending_intervals.size();
+      launch_pending_intervals();
+    }
+    else if (scan_spec.row_intervals.empty()) {
       if (scan_spec.cell_intervals.empty()) {
         ri_scanner = 0;
         ri_scanner = new IntervalScannerAsync(comm, app_queue, table, 
@@ -322,13 +391,33 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
           rowset_scan_spec.row_intervals.push_back(ri);
       }
       if (rowset_scan_spec.row_intervals.size()) {
-        ri_scanner = 0;
-        ri_scanner = new IntervalScannerAsync(comm, app_queue, table, 
-                        range_locator, rowset_scan_spec, timeout_ms, 
-                        !current_set, this, scanner_id++);
-        current_set = true;
-        m_interval_scanners.push_back(ri_scanner);
-        m_outstanding++;
+        // one rowset scanner per run of consecutive rows served by the same
+        // range server; the runs are fetched in parallel and, since they
+        // are in row order, still delivered in row order
+        TableIdentifierManaged table_id;
+        SchemaPtr schema;
+        std::vector<size_t> run_ends;
+        size_t run_start = 0;
+        table->get(table_id, schema);
+        timer.start();
+        LocatorRangeFinder ranges(range_locator, &table_id, timer);
+        partition_rowset(ranges, table->get_name(),
+                         rowset_scan_spec.row_intervals, run_ends);
+        foreach_ht (size_t run_end, run_ends) {
+          scan_spec.base_copy(interval_scan_spec);
+          interval_scan_spec.row_intervals.assign(
+              rowset_scan_spec.row_intervals.begin() + run_start,
+              rowset_scan_spec.row_intervals.begin() + run_end);
+          interval_scan_spec.scan_and_filter_rows = true;
+          run_start = run_end;
+          ri_scanner = 0;
+          ri_scanner = new IntervalScannerAsync(comm, app_queue, table, 
+                          range_locator, interval_scan_spec, timeout_ms, 
+                          !current_set, this, scanner_id++);
+          current_set = true;
+          m_interval_scanners.push_back(ri_scanner);
+          m_outstanding++;
+        }
       }
     }
     else {
@@ -357,6 +446,227 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
   }
 }
 
+void TableScannerAsync::partition_rowset(RangeFinder &ranges,
+        const String &table_name, RowIntervals &rows,
+        std::vector<size_t> &run_ends) {
+  RangeLocationInfo range_info;
+  CommAddress run_addr;
+  size_t i = 0;
+
+  std::sort(rows.begin(), rows.end(), LtRowIntervalStart());
+
+  try {
+    while (i < rows.size()) {
+      ranges.find(rows[i].start, &range_info);
+      if (i > 0 && range_info.addr != run_addr)
+        run_ends.push_back(i);
+      run_addr = range_info.addr;
+      // skip the remaining rows of this range
+      while (i < rows.size()
+             && strcmp(rows[i].start, range_info.end_row.c_str()) <= 0)
+        i++;
+    }
+  }
+  catch (Exception &e) {
+    // let a single rowset scanner deal with the range lookup problem
+    HT_WARNF("Unable to partition rowset scan of '%s' - %s",
+             table_name.c_str(), e.what());
+    run_ends.clear();
+  }
+  run_ends.push_back(rows.size());
+}
+
+bool TableScannerAsync::can_scan_in_parallel(const ScanSpec &scan_spec) {
+  // limits and offsets apply to the interval as a whole, so an interval
+  // that carries them can't be split across ranges
+  return scan_spec.cell_intervals.empty() && !scan_spec.scan_and_filter_rows
+    && scan_spec.row_limit == 0 && scan_spec.cell_limit == 0
+    && scan_spec.row_offset == 0 && scan_spec.cell_offset == 0;
+}
+
+void TableScannerAsync::partition_intervals(Table *table,
+        RangeLocatorPtr &range_locator, const ScanSpec &scan_spec,
+        Timer &timer) {
+  TableIdentifierManaged table_id;
+  SchemaPtr schema;
+  RangeLocationInfo range_info;
+  RowIntervals intervals(scan_spec.row_intervals);
+
+  if (intervals.empty())
+    intervals.push_back(RowInterval("", true, Key::END_ROW_MARKER, true));
+
+  table->get(table_id, schema);
+  timer.start();
+
+  try {
+    foreach_ht (const RowInterval &ri, intervals) {
+      String start = ri.start ? ri.start : "";
+      bool start_inclusive = ri.start_inclusive;
+      String end = (ri.end && *ri.end) ? ri.end : Key::END_ROW_MARKER;
+      String row = start_inclusive ? start : start + (char)1;
+      while (true) {
+        range_locator->find_loop(&table_id, row.c_str(), &range_info, timer,
+                                 false);
+        if (strcmp(range_info.end_row.c_str(), end.c_str()) >= 0) {
+          m_pending_intervals.push_back(PendingInterval(start,
+                  start_inclusive, end, ri.end_inclusive));
+          break;
+        }
+        m_pending_intervals.push_back(PendingInterval(start, start_inclusive,
+                range_info.end_row, true));
+        start = range_info.end_row;
+        start_inclusive = false;
+        // smallest row key that sorts after the end row of the range
+        row = start + (char)1;
+      }
+    }
+  }
+  catch (Exception &e) {
+    // scan the intervals as they are and let the interval scanners deal
+    // with the range lookup problem
+    HT_WARNF("Unable to partition parallel scan of '%s' - %s",
+             table->get_name().c_str(), e.what());
+    m_pending_intervals.clear();
+    foreach_ht (const RowInterval &ri, intervals)
+      m_pending_intervals.push_back(PendingInterval(ri.start ? ri.start : "",
+              ri.start_inclusive, (ri.end && *ri.end) ? ri.end : "",
+              ri.end_inclusive));
+  }
+}
+
+void TableScannerAsync::launch_pending_intervals() {
+  // caller has locked mutex
+  while (!m_pending_intervals.empty()
+         && m_outstanding - (int)m_pending_intervals.size() < m_parallelism) {
+    if (!launch_pending_interval())
+      return;
+  }
+}
+
+bool TableScannerAsync::launch_pending_interval() {
+  ScanSpec interval_scan_spec;
+  IntervalScannerAsyncPtr ri_scanner;
+
+  // caller has locked mutex
+  if (is_cancelled() || m_error != Error::OK) {
+    drop_pending_intervals();
+    return false;
+  }
+
+  const PendingInterval &pending = m_pending_intervals.front();
+  m_parallel_spec.get().base_copy(interval_scan_spec);
+  interval_scan_spec.row_intervals.push_back(RowInterval(
+          pending.start.c_str(), pending.start_inclusive,
+          pending.end.c_str(), pending.end_inclusive));
+
+  // in row order only the first interval scanner starts out current, later
+  // ones hold on to their first block until set_current() is called.  If
+  // every interval scanner started so far has finished, nobody is left to
+  // hand over to the new one, so it starts out current
+  int scanner_id = (int)m_interval_scanners.size();
+  bool current = m_unordered || m_interval_scanners.empty();
+  if (!current && m_current_scanner == scanner_id - 1
+      && m_interval_scanners[m_current_scanner] == 0)
+    current = true;
+
+  try {
+    ri_scanner = new IntervalScannerAsync(m_comm, m_app_queue, m_table,
+                      m_range_locator, interval_scan_spec, m_timeout_ms,
+                      current, this, scanner_id);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    m_error = e.code();
+    m_error_msg = e.what();
+    drop_pending_intervals();
+    return false;
+  }
+
+  m_pending_intervals.pop_front();
+  m_interval_scanners.push_back(ri_scanner);
+  if (current && !m_unordered)
+    m_current_scanner = scanner_id;
+  return true;
+}
+
+void TableScannerAsync::schedule_pending_intervals() {
+  // caller has locked mutex
+  if (m_pending_intervals.empty() || m_launch_scheduled)
+    return;
+
+  if (is_cancelled() || m_error != Error::OK) {
+    drop_pending_intervals();
+    return;
+  }
+
+  if (m_outstanding - (int)m_pending_intervals.size() < m_parallelism) {
+    m_launch_scheduled = true;
+    m_app_queue->add(new LaunchIntervalsHandler(this));
+  }
+}
+
+void TableScannerAsync::launch_deferred_intervals() {
+  TableIdentifierManaged table_id;
+  SchemaPtr schema;
+  RangeLocationInfo range_info;
+  ScopedLock lock(m_mutex);
+
+  m_table->get(table_id, schema);
+
+  while (!m_pending_intervals.empty()
+         && m_outstanding - (int)m_pending_intervals.size() < m_parallelism) {
+
+    if (is_cancelled() || m_error != Error::OK) {
+      drop_pending_intervals();
+      break;
+    }
+
+    // look up the range of the next interval without holding the mutex, so
+    // that the interval scanner finds its location in the cache
+    const PendingInterval &pending = m_pending_intervals.front();
+    String row = pending.start_inclusive ? pending.start
+      : pending.start + (char)1;
+    lock.unlock();
+    try {
+      Timer timer(m_timeout_ms, true);
+      m_range_locator->find_loop(&table_id, row.c_str(), &range_info, timer,
+                                 false);
+    }
+    catch (Exception &e) {
+      // the interval scanner retries the lookup and reports the error
+    }
+    lock.lock();
+
+    if (m_pending_intervals.empty()
+        || m_outstanding - (int)m_pending_intervals.size() >= m_parallelism)
+      break;
+    if (!launch_pending_interval())
+      break;
+  }
+
+  m_launch_scheduled = false;
+  m_cond.notify_all();
+}
+
+void TableScannerAsync::drop_pending_intervals() {
+  if (m_pending_intervals.empty())
+    return;
+
+  // caller has locked mutex
+  m_outstanding -= m_pending_intervals.size();
+  m_pending_intervals.clear();
+
+  // no interval scanner left to deliver the "eos" marker
+  if (m_outstanding == 0) {
+    if (m_error != Error::OK)
+      maybe_callback_error(0, false);
+    else {
+      ScanCellsPtr cells = new ScanCells;
+      maybe_callback_ok(0, false, true, cells);
+    }
+  }
+}
+
 TableScannerAsync::~TableScannerAsync() {
   try {
     cancel();
@@ -436,7 +746,7 @@ void TableScannerAsync::handle_error(int scanner_id, int error, const String &er
   // if we've seen an error before then don't bother with callback
   if (m_error != Error::OK || cancelled) {
     maybe_callback_error(scanner_id, next);
-    if (next && scanner_id == m_current_scanner)
+    if (next && (m_unordered || scanner_id == m_current_scanner))
       move_to_next_interval_scanner(scanner_id);
     return;
   }
@@ -446,10 +756,10 @@ void TableScannerAsync::handle_error(int scanner_id, int error, const String &er
     m_error_msg = error_msg;
     HT_ERROR_OUT << e << HT_END;
     maybe_callback_error(scanner_id, next);
-    if (next && scanner_id == m_current_scanner)
+    if (next && (m_unordered || scanner_id == m_current_scanner))
       move_to_next_interval_scanner(scanner_id);
   }
-  else if (next && scanner_id == m_current_scanner) {
+  else if (next && (m_unordered || scanner_id == m_current_scanner)) {
     move_to_next_interval_scanner(scanner_id);
   }
 }
@@ -470,7 +780,7 @@ void TableScannerAsync::handle_timeout(int scanner_id, const String &error_msg,
                << " - " << error_msg << HT_END;
   m_error = Error::REQUEST_TIMEOUT;
   maybe_callback_error(scanner_id, next);
-  if (next && scanner_id == m_current_scanner)
+  if (next && (m_unordered || scanner_id == m_current_scanner))
     move_to_next_interval_scanner(scanner_id);
 
 }
@@ -492,7 +802,7 @@ void TableScannerAsync::handle_result(int scanner_id, EventPtr &event, bool is_c
     // If the scan already encountered an error/cancelled
     // don't bother calling into callback anymore
     if (abort) {
-      next = m_interval_scanners[scanner_id]->abort(is_create);
+      next = m_interval_scanners[scanner_id]->abort(is_create, event);
       if (cancelled && m_error == Error::OK) {
         // scanner was cancelled and is over
         if (next && m_outstanding==1) {
@@ -541,6 +851,8 @@ void TableScannerAsync::maybe_callback_error(int scanner_id, bool next) {
   m_cb->scan_error(this, m_error, m_error_msg, eos);
 
   if (eos) {
+    if (m_plan == IndexScanPlanner::FULL_SCAN)
+      IndexScanPlanner::record_scan(IndexScanPlanner::FULL_SCAN, m_start_ns);
     m_cb->deregister_scanner(this);
     m_cb->decrement_outstanding();
     m_cond.notify_all();
@@ -568,6 +880,8 @@ void TableScannerAsync::maybe_callback_ok(int scanner_id, bool next, bool do_cal
   }
 
   if (m_outstanding==0) {
+    if (m_plan == IndexScanPlanner::FULL_SCAN)
+      IndexScanPlanner::record_scan(IndexScanPlanner::FULL_SCAN, m_start_ns);
     m_cb->deregister_scanner(this);
     m_cb->decrement_outstanding();
     m_cond.notify_all();
@@ -576,7 +890,7 @@ void TableScannerAsync::maybe_callback_ok(int scanner_id, bool next, bool do_cal
 
 void TableScannerAsync::wait_for_completion() {
   ScopedLock lock(m_mutex);
-  while (m_outstanding != 0)
+  while (m_outstanding != 0 || m_launch_scheduled)
     m_cond.wait(lock);
 }
 
@@ -591,6 +905,13 @@ void TableScannerAsync::move_to_next_interval_scanner(int current_scanner) {
   ScanCellsPtr cells;
   bool abort = cancelled || (m_error != Error::OK);
 
+  // start intervals of a parallel scan in the slot that just freed up
+  schedule_pending_intervals();
+
+  // in arrival order every interval scanner is current and finishes on its own
+  if (m_unordered)
+    return;
+
   while (next && m_outstanding && current_scanner < ((int)m_interval_scanners.size())-1) {
     current_scanner++;
     // unless the scan has been aborted we should be going through scanners in order
@@ -614,6 +935,8 @@ void TableScannerAsync::move_to_next_interval_scanner(int current_scanner) {
         cells = new ScanCells;
       }
       maybe_callback_ok(m_current_scanner, next, do_callback, cells);
+      if (next)
+        schedule_pending_intervals();
     }
   }
 
@@ -621,6 +944,7 @@ void TableScannerAsync::move_to_next_interval_scanner(int current_scanner) {
   // is sent to the caller, and m_outstanding is decremented
   if (next 
       && m_outstanding == 1
+      && m_pending_intervals.empty()
       && current_scanner == ((int)m_interval_scanners.size() - 1) 
       && !cells) {
     cells = new ScanCells;
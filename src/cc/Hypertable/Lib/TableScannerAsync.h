@@ -24,10 +24,13 @@
 
 #include "Common/ReferenceCount.h"
 
+#include <deque>
+
 #include "AsyncComm/DispatchHandlerSynchronizer.h"
 
 #include "Cells.h"
 #include "ClientObject.h"
+#include "RangeFinder.h"
 #include "RangeLocator.h"
 #include "RangeServerClient.h"
 #include "IntervalScannerAsync.h"
@@ -124,8 +127,24 @@ namespace Hypertable {
      */
     Table *get_table() {return m_table; }
 
+    /** Splits a rowset into runs of rows served by the same range server.
+     * Sorts <code>rows</code> by row and looks up the range of the first
+     * row and of each row following a range's end row.  A run ends where
+     * the server of the next range differs from the current one.  If a
+     * range can't be located, the whole rowset is one run.
+     * @param ranges Finds the ranges of the table
+     * @param table_name Name of the table, for log messages
+     * @param rows Single-row intervals of the rowset
+     * @param run_ends Filled in with the index one past the last row of
+     *        each run, in ascending order
+     */
+    static void partition_rowset(RangeFinder &ranges, const String &table_name,
+                                 RowIntervals &rows,
+                                 std::vector<size_t> &run_ends);
+
   private:
     friend class IndexScannerCallback;
+    friend class LaunchIntervalsHandler;
 
     void init(Comm *comm, ApplicationQueueInterfacePtr &app_queue, Table *table,
             RangeLocatorPtr &range_locator, const ScanSpec &scan_spec, 
@@ -139,6 +158,26 @@ namespace Hypertable {
             ScanSpecBuilder &index_spec, bool *use_qualifier);
     void transform_primary_scan_spec(ScanSpecBuilder &primary_spec);
     void add_index_row(ScanSpecBuilder &ssb, const char *row);
+    bool can_scan_in_parallel(const ScanSpec &scan_spec);
+    void partition_intervals(Table *table, RangeLocatorPtr &range_locator,
+            const ScanSpec &scan_spec, Timer &timer);
+    void launch_pending_intervals();
+    bool launch_pending_interval();
+    void schedule_pending_intervals();
+    void launch_deferred_intervals();
+    void drop_pending_intervals();
+
+    /// Row interval of a parallel scan that has no interval scanner yet
+    struct PendingInterval {
+      PendingInterval(const String &start_row, bool start_row_inclusive,
+                      const String &end_row, bool end_row_inclusive)
+        : start(start_row), start_inclusive(start_row_inclusive),
+          end(end_row), end_inclusive(end_row_inclusive) { }
+      String start;
+      bool start_inclusive;
+      String end;
+      bool end_inclusive;
+    };
 
     std::vector<IntervalScannerAsyncPtr>  m_interval_scanners;
     uint32_t            m_timeout_ms;
@@ -156,6 +195,26 @@ namespace Hypertable {
     Table              *m_table;
     bool                m_cancelled;
     bool                m_use_index;
+    /// IndexScanPlanner::Plan chosen for this scan, -1 if no index applies
+    int                 m_plan;
+    /// Creation time of this scanner (see get_ts64())
+    int64_t             m_start_ns;
+    /// Maximum number of interval scanners running at once in a parallel
+    /// scan, 0 if the scan is sequential
+    int                 m_parallelism;
+    /// Deliver cells of a parallel scan in arrival order instead of row order
+    bool                m_unordered;
+    /// Copy of the scan spec that pending intervals are scanned with
+    ScanSpecBuilder     m_parallel_spec;
+    /// Per range intervals of a parallel scan still to be started; each one
+    /// is counted in m_outstanding
+    std::deque<PendingInterval> m_pending_intervals;
+    /// Set while a LaunchIntervalsHandler for this scanner is queued or
+    /// running; the scanner is not destroyed before it is cleared
+    bool                m_launch_scheduled;
+    Comm               *m_comm;
+    ApplicationQueueInterfacePtr m_app_queue;
+    RangeLocatorPtr     m_range_locator;
   };
 
   typedef intrusive_ptr<TableScannerAsync> TableScannerAsyncPtr;
@@ -55,6 +55,7 @@ namespace {
 
   void test1(DfsBroker::Client *dfs_client);
   void test_link(DfsBroker::Client *dfs_client);
+  void test_stripes(DfsBroker::Client *dfs_client);
   void write_entries(CommitLog *log, int num_entries, uint64_t *sump,
                      CommitLogBase *link_log);
   void read_entries(DfsBroker::Client *dfs_client, CommitLogReader *log_reader,
@@ -85,6 +86,7 @@ int main(int argc, char **argv) {
 
     //test1(dfs);
     test_link(dfs.get());
+    test_stripes(dfs.get());
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -205,6 +207,59 @@ namespace {
     HT_ASSERT(sum_read == sum_written);
   }
 
+  void test_stripes(DfsBroker::Client *dfs_client) {
+    String log_dir = "/hypertable/test_log";
+    String fname = log_dir + "/striped";
+    CommitLog *log;
+    CommitLogReaderPtr log_reader_ptr;
+    uint64_t sum_written = 0;
+    uint64_t sum_read = 0;
+    FilesystemPtr fs = dfs_client;
+    std::vector<uint32_t> fragments;
+    std::set<uint32_t> unique_fragments;
+
+    dfs_client->rmdir(log_dir);
+    dfs_client->mkdirs(fname);
+
+    log = new CommitLog(fs, fname, properties, 0, false, 3);
+    HT_ASSERT(log->get_stripe_count() == 3);
+    write_entries(log, 20, &sum_written, 0);
+    HT_ASSERT(log->sync() == Error::OK);
+    delete log;
+
+    HT_ASSERT(dfs_client->exists(CommitLog::stripe_dir(fname, 2)));
+
+    // Reading the log directory picks up the fragments of all stripes
+    log_reader_ptr = new CommitLogReader(fs, fname);
+    read_entries(dfs_client, log_reader_ptr.get(), &sum_read);
+    HT_ASSERT(sum_read == sum_written);
+
+    log_reader_ptr->get_init_fragment_ids(fragments);
+    unique_fragments.insert(fragments.begin(), fragments.end());
+    HT_ASSERT(unique_fragments.size() == fragments.size());
+    HT_ASSERT(fragments.size() >= 3);
+
+    // Replaying a subset of the fragments reads just those fragments
+    fragments.resize(1);
+    log_reader_ptr = new CommitLogReader(fs, fname, fragments);
+    uint64_t sum_subset = 0;
+    read_entries(dfs_client, log_reader_ptr.get(), &sum_subset);
+    HT_ASSERT(sum_subset < sum_written);
+
+    // A log reopened with the reader's fragments continues the numbering
+    log_reader_ptr = new CommitLogReader(fs, fname);
+    sum_read = 0;
+    read_entries(dfs_client, log_reader_ptr.get(), &sum_read);
+    log = new CommitLog(fs, fname, properties, log_reader_ptr.get(), false, 3);
+    write_entries(log, 20, &sum_written, 0);
+    delete log;
+
+    sum_read = 0;
+    log_reader_ptr = new CommitLogReader(fs, fname);
+    read_entries(dfs_client, log_reader_ptr.get(), &sum_read);
+    HT_ASSERT(sum_read == sum_written);
+  }
+
   void
   write_entries(CommitLog *log, int num_entries, uint64_t *sump,
                 CommitLogBase *link_log) {
@@ -0,0 +1,275 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Tests the access path decisions of IndexScanPlanner and the splitting of
+ * rowset scans by TableScannerAsync::partition_rowset(), with ranges taken
+ * from a fixed list instead of a RangeLocator.  The planner must use the
+ * index unless the query covers more than the selectivity threshold of the
+ * column's index ranges, and always when the count of the column's ranges
+ * was truncated at MaxProbeRanges.  A rowset must be split where the range
+ * server changes and stay whole if a range lookup fails.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Properties.h"
+#include "Common/Usage.h"
+
+#include "Hypertable/Lib/IndexScanPlanner.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/RangeFinder.h"
+#include "Hypertable/Lib/ScanSpec.h"
+#include "Hypertable/Lib/TableScannerAsync.h"
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: index_scan_planner_test",
+    "",
+    "Validates the index scan planner and the partitioning of rowset scans.",
+    0
+  };
+
+  /** RangeFinder over a fixed list of ranges.
+   * The last range added must end with Key::END_ROW_MARKER.
+   */
+  class TestRangeFinder : public RangeFinder {
+  public:
+    TestRangeFinder() : lookups(0), fail_after(-1) { }
+
+    /** Adds the range following the last one added.
+     * @param end_row End row of the range
+     * @param server Server of the range
+     */
+    void add_range(const String &end_row, const String &server) {
+      m_ranges[end_row] = server;
+    }
+
+    virtual void find(const char *row, RangeLocationInfo *range_info) {
+      if (fail_after >= 0 && lookups >= fail_after)
+        HT_THROWF(Error::REQUEST_TIMEOUT, "Unable to locate row '%s'", row);
+      lookups++;
+      map<String, String>::iterator iter = m_ranges.lower_bound(row);
+      HT_ASSERT(iter != m_ranges.end());
+      if (iter == m_ranges.begin())
+        range_info->start_row = "";
+      else {
+        map<String, String>::iterator prev = iter;
+        range_info->start_row = (--prev)->first;
+      }
+      range_info->end_row = iter->first;
+      range_info->addr.set_proxy(iter->second);
+    }
+
+    /// Number of ranges looked up
+    int lookups;
+
+    /// Number of lookups after which lookups fail, -1 for never
+    int fail_after;
+
+  private:
+    /// Servers of the ranges, keyed by end row
+    map<String, String> m_ranges;
+  };
+
+  /** Creates the planner properties.
+   * @param threshold Selectivity threshold
+   * @param max_probe_ranges Maximum number of ranges counted per interval
+   * @return Properties
+   */
+  PropertiesPtr planner_properties(double threshold,
+                                   int32_t max_probe_ranges) {
+    PropertiesPtr props = new Properties();
+    props->set("Hypertable.Scanner.Index.SelectivityThreshold", threshold);
+    props->set("Hypertable.Scanner.Index.MaxProbeRanges", max_probe_ranges);
+    return props;
+  }
+
+  /** Chooses the plan for a query of column 1 over an index interval.
+   * The primary scan selects column "a" with a predicate on "a", so a
+   * full scan is possible.
+   * @param props Planner properties
+   * @param index_ranges Ranges of the index table
+   * @param start Start of the index row interval
+   * @param end End of the index row interval
+   * @param selectivityp Set to the estimated selectivity
+   * @return Chosen plan
+   */
+  IndexScanPlanner::Plan choose(PropertiesPtr &props,
+                                TestRangeFinder &index_ranges,
+                                const char *start, const char *end,
+                                double *selectivityp) {
+    ScanSpecBuilder primary_spec;
+    ScanSpecBuilder index_spec;
+    primary_spec.add_column("a");
+    primary_spec.add_column_predicate("a", ColumnPredicate::PREFIX_MATCH, "x");
+    index_spec.add_row_interval(start, true, end, false);
+    IndexScanPlanner planner("^IndexScanPlannerTest", props);
+    IndexScanPlanner::Plan plan =
+      planner.choose(primary_spec.get(), index_spec.get(), index_ranges);
+    *selectivityp = planner.get_selectivity();
+    return plan;
+  }
+
+  void test_planner() {
+    PropertiesPtr props = planner_properties(0.5, 10);
+    TestRangeFinder index_ranges;
+    double selectivity;
+
+    // Index entries of column 1 lie in ["1,", "1-") and span nine ranges,
+    // the last of which extends into column 2
+    index_ranges.add_range("0,zzz", "rs1");
+    const char *column_1_ends[] = { "1,b", "1,d", "1,f", "1,h", "1,j", "1,l",
+                                    "1,n", "1,p" };
+    for (size_t i=0; i<sizeof(column_1_ends)/sizeof(const char *); i++)
+      index_ranges.add_range(column_1_ends[i], "rs1");
+    index_ranges.add_range("2,m", "rs1");
+    index_ranges.add_range(Key::END_ROW_MARKER, "rs1");
+
+    // Five of nine ranges are above the threshold
+    HT_ASSERT(choose(props, index_ranges, "1,c", "1,k", &selectivity) ==
+              IndexScanPlanner::FULL_SCAN);
+    HT_ASSERT(fabs(selectivity - 5.0/9.0) < 0.0001);
+
+    // Two of nine ranges are below it
+    HT_ASSERT(choose(props, index_ranges, "1,c", "1,e", &selectivity) ==
+              IndexScanPlanner::INDEX_SCAN);
+    HT_ASSERT(fabs(selectivity - 2.0/9.0) < 0.0001);
+
+    // A predicate within a single range uses the index whatever the
+    // threshold
+    PropertiesPtr low_props = planner_properties(0.01, 10);
+    HT_ASSERT(choose(low_props, index_ranges, "1,c", "1,cc", &selectivity) ==
+              IndexScanPlanner::INDEX_SCAN);
+
+    // A higher threshold keeps the index for the wide query
+    PropertiesPtr high_props = planner_properties(0.6, 10);
+    HT_ASSERT(choose(high_props, index_ranges, "1,c", "1,k", &selectivity) ==
+              IndexScanPlanner::INDEX_SCAN);
+    HT_ASSERT(fabs(selectivity - 5.0/9.0) < 0.0001);
+
+    // The count of the column's ranges stops at MaxProbeRanges, so its real
+    // total is unknown and the index is used, even for a query that covers
+    // the whole column
+    PropertiesPtr truncated_props = planner_properties(0.5, 4);
+    HT_ASSERT(choose(truncated_props, index_ranges, "1,", "1-", &selectivity)
+              == IndexScanPlanner::INDEX_SCAN);
+    HT_ASSERT(selectivity == 0.0);
+
+    // Without the cap the same query is a full scan
+    HT_ASSERT(choose(props, index_ranges, "1,", "1-", &selectivity) ==
+              IndexScanPlanner::FULL_SCAN);
+    HT_ASSERT(selectivity == 1.0);
+
+    // A range lookup failure leaves the index in use
+    index_ranges.lookups = 0;
+    index_ranges.fail_after = 3;
+    HT_ASSERT(choose(props, index_ranges, "1,c", "1,k", &selectivity) ==
+              IndexScanPlanner::INDEX_SCAN);
+    index_ranges.fail_after = -1;
+
+    // All entries of a column in one range give no estimate
+    TestRangeFinder single_range;
+    single_range.add_range(Key::END_ROW_MARKER, "rs1");
+    HT_ASSERT(choose(props, single_range, "1,", "1-", &selectivity) ==
+              IndexScanPlanner::INDEX_SCAN);
+    HT_ASSERT(selectivity == 0.0);
+
+    // A full scan can't return a column without a predicate
+    ScanSpecBuilder primary_spec;
+    ScanSpecBuilder index_spec;
+    primary_spec.add_column("a");
+    primary_spec.add_column("b");
+    primary_spec.add_column_predicate("a", ColumnPredicate::PREFIX_MATCH, "x");
+    index_spec.add_row_interval("1,", true, "1-", false);
+    HT_ASSERT(!IndexScanPlanner::full_scan_possible(primary_spec.get()));
+    IndexScanPlanner planner("^IndexScanPlannerTest", props);
+    HT_ASSERT(planner.choose(primary_spec.get(), index_spec.get(),
+                             index_ranges) == IndexScanPlanner::INDEX_SCAN);
+  }
+
+  void test_partition_rowset() {
+    TestRangeFinder ranges;
+    ranges.add_range("c", "rs1");
+    ranges.add_range("f", "rs1");
+    ranges.add_range("k", "rs2");
+    ranges.add_range("p", "rs1");
+    ranges.add_range(Key::END_ROW_MARKER, "rs2");
+
+    const char *rows[] = { "m", "a", "d", "x", "g", "b", "c", "q", "n" };
+    RowIntervals rowset;
+    for (size_t i=0; i<sizeof(rows)/sizeof(const char *); i++)
+      rowset.push_back(RowInterval(rows[i], true, rows[i], true));
+
+    // a b c d on rs1, g on rs2, m n on rs1, q x on rs2; adjacent ranges on
+    // the same server form one run and each range is looked up once
+    vector<size_t> run_ends;
+    TableScannerAsync::partition_rowset(ranges, "RowsetTest", rowset,
+                                        run_ends);
+    const char *sorted[] = { "a", "b", "c", "d", "g", "m", "n", "q", "x" };
+    for (size_t i=0; i<rowset.size(); i++)
+      HT_ASSERT(!strcmp(rowset[i].start, sorted[i]));
+    size_t expected_ends[] = { 4, 5, 7, 9 };
+    HT_ASSERT(run_ends.size() == 4);
+    for (size_t i=0; i<run_ends.size(); i++)
+      HT_ASSERT(run_ends[i] == expected_ends[i]);
+    HT_ASSERT(ranges.lookups == 5);
+
+    // All rows on one server form a single run
+    TestRangeFinder one_server;
+    one_server.add_range("f", "rs1");
+    one_server.add_range(Key::END_ROW_MARKER, "rs1");
+    run_ends.clear();
+    TableScannerAsync::partition_rowset(one_server, "RowsetTest", rowset,
+                                        run_ends);
+    HT_ASSERT(run_ends.size() == 1 && run_ends[0] == rowset.size());
+
+    // A failed lookup leaves the rowset to a single scanner
+    ranges.lookups = 0;
+    ranges.fail_after = 2;
+    run_ends.clear();
+    TableScannerAsync::partition_rowset(ranges, "RowsetTest", rowset,
+                                        run_ends);
+    HT_ASSERT(run_ends.size() == 1 && run_ends[0] == rowset.size());
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  if (argc > 1)
+    Usage::dump_and_exit(usage);
+
+  test_planner();
+  test_partition_rowset();
+
+  return 0;
+}
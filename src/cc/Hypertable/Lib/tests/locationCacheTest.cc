@@ -21,6 +21,7 @@
 
 #include "Common/Compat.h"
 #include <fstream>
+#include <iostream>
 #include <utility>
 extern "C" {
 #  include <stdio.h>
@@ -32,6 +33,7 @@ extern "C" {
 #include "Common/StringExt.h"
 #include "Common/Usage.h"
 
+#include "Hypertable/Lib/Key.h"
 #include "Hypertable/Lib/LocationCache.h"
 
 using namespace Hypertable;
@@ -241,9 +243,13 @@ namespace {
 
   ofstream outfile;
 
+  uint64_t lookup_count = 0;
+
   void TestLookup(LocationCache &cache, const String & table_id, const char *rowkey) {
     RangeLocationInfo  range_loc_info;
 
+    lookup_count++;
+
     outfile << "LOOKUP(" << table_id << ", " << rowkey << ") -> ";
 
     if (cache.lookup(table_id.c_str(), rowkey, &range_loc_info))
@@ -315,5 +321,125 @@ int main(int argc, char **argv) {
   if (system("diff ./locationCacheTest.output ./locationCacheTest.golden"))
     return 1;
 
+  LocationCache::Statistics stats;
+  cache.get_statistics(stats);
+  if (stats.hits + stats.misses != lookup_count || stats.entries > 68) {
+    cout << "Bad statistics: hits=" << stats.hits << " misses="
+         << stats.misses << " lookups=" << lookup_count << " entries="
+         << stats.entries << endl;
+    return 1;
+  }
+
+  // Negative entries expire when a covering location is inserted
+  LocationCache partitioned(68, 4, 60000);
+  partitioned.insert_negative("1", "foo");
+  if (!partitioned.lookup_negative("1", "foo") ||
+      partitioned.lookup_negative("1", "fop") ||
+      partitioned.lookup_negative("2", "foo"))
+    return 1;
+  range_loc_info.start_row = "bar";
+  range_loc_info.end_row = "kite";
+  range_loc_info.addr.set_proxy(server_ids[0]);
+  partitioned.insert("1", range_loc_info);
+  range_loc_info.addr.set_proxy(server_ids[1]);
+  partitioned.insert("2", range_loc_info);
+  if (partitioned.lookup_negative("1", "foo") ||
+      !partitioned.lookup("1", "foo", &range_loc_info) ||
+      range_loc_info.addr.proxy != server_ids[0] ||
+      !partitioned.lookup("2", "foo", &range_loc_info) ||
+      range_loc_info.addr.proxy != server_ids[1])
+    return 1;
+
+  // A table is striped over the partitions by row, a range is stored once
+  // and found from every row it contains
+  LocationCache striped(1000, 4);
+  range_loc_info.start_row = "";
+  range_loc_info.end_row = "m";
+  range_loc_info.addr.set_proxy(server_ids[0]);
+  striped.insert("1", range_loc_info);
+  range_loc_info.start_row = "m";
+  range_loc_info.end_row = Key::END_ROW_MARKER;
+  range_loc_info.addr.set_proxy(server_ids[1]);
+  striped.insert("1", range_loc_info);
+  const char *rows[] = { "0", "b", "n", "\x90", "\xf0" };
+  for (size_t i=0; i<sizeof(rows)/sizeof(const char *); i++) {
+    if (!striped.lookup("1", rows[i], &range_loc_info) ||
+        range_loc_info.addr.proxy != server_ids[i < 2 ? 0 : 1])
+      return 1;
+  }
+  striped.get_statistics(stats);
+  if (stats.entries != 2 || stats.hits != 5)
+    return 1;
+  if (!striped.invalidate("1", "\x90") ||
+      striped.lookup("1", "n", &range_loc_info) ||
+      striped.lookup("1", "\xf0", &range_loc_info) ||
+      !striped.lookup("1", "b", &range_loc_info))
+    return 1;
+  striped.get_statistics(stats);
+  if (stats.entries != 1 || stats.misses != 2)
+    return 1;
+
+  // Ranges whose rows share a prefix are spread over the partitions, and
+  // the maximum number of entries applies to the whole cache
+  LocationCache shared(1000, 4);
+  String start_row;
+  char row[32];
+  for (int i=0; i<800; i++) {
+    sprintf(row, "user%06d", (i+1)*100);
+    range_loc_info.start_row = start_row;
+    range_loc_info.end_row = row;
+    range_loc_info.addr.set_proxy(server_ids[i % 4]);
+    shared.insert("3", range_loc_info);
+    start_row = row;
+  }
+  shared.get_statistics(stats);
+  if (stats.entries != 800 || stats.evictions != 0 ||
+      stats.max_partition_entries > stats.entries / 2) {
+    cout << "Bad shared prefix statistics: entries=" << stats.entries
+         << " evictions=" << stats.evictions << " max_partition_entries="
+         << stats.max_partition_entries << endl;
+    return 1;
+  }
+  for (int i=0; i<800; i++) {
+    sprintf(row, "user%06d", i*100 + 50);
+    if (!shared.lookup("3", row, &range_loc_info) ||
+        range_loc_info.addr.proxy != server_ids[i % 4])
+      return 1;
+    sprintf(row, "user%06d", (i+1)*100);
+    if (!shared.lookup("3", row, &range_loc_info) ||
+        range_loc_info.addr.proxy != server_ids[i % 4])
+      return 1;
+  }
+
+  // An inclusive lookup of a start row finds the range starting there,
+  // also when the row is a stripe bound
+  for (int i=0; i<800; i+=2) {
+    sprintf(row, "user%06d", (i+1)*100);
+    if (!shared.invalidate("3", row))
+      return 1;
+  }
+  for (int i=1; i<800; i+=2) {
+    sprintf(row, "user%06d", i*100);
+    if (!shared.lookup("3", row, &range_loc_info, true) ||
+        range_loc_info.addr.proxy != server_ids[i % 4])
+      return 1;
+  }
+
+  start_row.clear();
+  for (int i=0; i<1200; i++) {
+    sprintf(row, "user%06d", (i+1)*100);
+    range_loc_info.start_row = start_row;
+    range_loc_info.end_row = row;
+    range_loc_info.addr.set_proxy(server_ids[i % 4]);
+    shared.insert("4", range_loc_info);
+    start_row = row;
+  }
+  shared.get_statistics(stats);
+  if (stats.entries != 1000 || stats.evictions != 600) {
+    cout << "Bad eviction statistics: entries=" << stats.entries
+         << " evictions=" << stats.evictions << endl;
+    return 1;
+  }
+
   return 0;
 }
@@ -31,8 +31,11 @@
 #include "AsyncComm/ReactorFactory.h"
 #include "AsyncComm/ConnectionManager.h"
 
+#include <boost/thread/thread.hpp>
+
 #include <iostream>
 #include <fstream>
+#include <map>
 
 
 #include "Hypertable/Lib/Config.h"
@@ -64,6 +67,7 @@ namespace Hypertable {
       }
       virtual void display(ostream &os) { os << "value=" << value; }
       void increment() { value++; }
+      int32_t get_value() { return value; }
 
     private:
       String m_name;
@@ -122,6 +126,27 @@ namespace {
     }
   }
 
+  /** Concurrently records state changes of a private set of entities
+   * to exercise group commit.
+   */
+  class ConcurrentWriter {
+  public:
+    ConcurrentWriter(MetaLog::WriterPtr &writer,
+                     vector<MetaLog::EntityPtr> &entities)
+      : m_writer(writer), m_entities(entities) { }
+    void operator()() {
+      for (size_t i=0; i<64; i++) {
+        MetaLog::EntityGeneric *entity =
+          (MetaLog::EntityGeneric *)m_entities[i % m_entities.size()].get();
+        entity->increment();
+        m_writer->record_state(entity);
+      }
+    }
+  private:
+    MetaLog::WriterPtr m_writer;
+    vector<MetaLog::EntityPtr> &m_entities;
+  };
+
   void display_entities(ofstream &out) {
     for (size_t i=0; i<g_entities.size(); i++) {
       if (g_entities[i])
@@ -202,6 +227,48 @@ main(int ac, char *av[]) {
       HT_ASSERT(FileUtils::size("metalog_test2.out") == FileUtils::size("metalog_test2.golden"));
     }
 
+    /**
+     *  Write concurrently from several threads and verify final states
+     */
+
+    {
+      vector<MetaLog::EntityPtr> thread_entities[8];
+      map<String, int32_t> expected;
+      boost::thread_group threads;
+
+      writer = new MetaLog::Writer(fs, g_test_definition,
+                                   testdir + "/" + g_test_definition->name(),
+                                   g_entities);
+      for (size_t i=0; i<8; i++) {
+        for (size_t j=0; j<4; j++)
+          thread_entities[i].push_back(new MetaLog::EntityGeneric(131072+(i*4)+j));
+        threads.create_thread(ConcurrentWriter(writer, thread_entities[i]));
+      }
+      threads.join_all();
+      writer = 0;
+
+      for (size_t i=0; i<8; i++) {
+        foreach_ht (MetaLog::EntityPtr &entity, thread_entities[i])
+          expected[entity->name()] =
+            ((MetaLog::EntityGeneric *)entity.get())->get_value();
+      }
+
+      reader = new MetaLog::Reader(fs, g_test_definition,
+                                   testdir + "/" + g_test_definition->name());
+      vector<MetaLog::EntityPtr> entities;
+      reader->get_entities(entities);
+      reader = 0;
+      size_t found = 0;
+      foreach_ht (MetaLog::EntityPtr &entity, entities) {
+        map<String, int32_t>::iterator iter = expected.find(entity->name());
+        if (iter != expected.end()) {
+          HT_ASSERT(((MetaLog::EntityGeneric *)entity.get())->get_value() == iter->second);
+          found++;
+        }
+      }
+      HT_ASSERT(found == expected.size());
+    }
+
     /**
      *  Write another log and skip the RECOVER entry
      */
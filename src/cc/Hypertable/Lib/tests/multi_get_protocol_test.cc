@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Tests the encoding of the "multi get" RangeServer request and the decoding
+ * of its response, including a response that completes only some of the
+ * requested keys.
+ */
+
+#include <Common/Compat.h>
+#include <Common/ByteString.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Error.h>
+#include <Common/Logger.h>
+#include <Common/Serialization.h>
+#include <Common/Usage.h>
+
+#include <AsyncComm/CommBuf.h>
+#include <AsyncComm/Event.h>
+
+#include <Hypertable/Lib/Key.h>
+#include <Hypertable/Lib/RangeServerProtocol.h>
+#include <Hypertable/Lib/ScanBlock.h>
+#include <Hypertable/Lib/Types.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace Hypertable;
+using namespace Serialization;
+using namespace std;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: multi_get_protocol_test",
+    "",
+    "Tests encoding and decoding of the multi get request and response.",
+    0
+  };
+
+  const char *rows[] = { "apple", "banana", "cherry", "date", "elder" };
+  const size_t row_count = sizeof(rows) / sizeof(const char *);
+
+  /** Builds a successful multi get response holding one cell for each of
+   * the rows in [<code>begin</code>, <code>end</code>).
+   */
+  EventPtr make_response(size_t begin, size_t end, uint32_t keys_completed) {
+    DynamicBuffer pairs;
+    for (size_t i=begin; i<end; i++) {
+      create_key_and_append(pairs, FLAG_INSERT, rows[i], 1, "q",
+                            (int64_t)i+1, (int64_t)i+1);
+      append_as_byte_string(pairs, rows[i]);
+    }
+    size_t len = 12 + pairs.fill();
+    uint8_t *payload = new uint8_t [len];
+    uint8_t *ptr = payload;
+    encode_i32(&ptr, Error::OK);
+    encode_i32(&ptr, keys_completed);
+    encode_i32(&ptr, pairs.fill());
+    memcpy(ptr, pairs.base, pairs.fill());
+
+    EventPtr event = new Event(Event::MESSAGE);
+    event->payload = payload;
+    event->payload_len = len;
+    return event;
+  }
+
+  /** Reads the cells of <code>block</code>, checking that they are the
+   * cells of rows [<code>begin</code>, <code>end</code>).
+   */
+  void check_block(ScanBlock &block, size_t begin, size_t end) {
+    SerializedKey serkey;
+    ByteString value;
+    Key key;
+    const uint8_t *vptr;
+
+    HT_ASSERT(block.size() == end - begin);
+    for (size_t i=begin; i<end; i++) {
+      HT_ASSERT(block.next(serkey, value));
+      HT_ASSERT(key.load(serkey));
+      HT_ASSERT(!strcmp(key.row, rows[i]));
+      HT_ASSERT(key.column_family_code == 1);
+      HT_ASSERT(!strcmp(key.column_qualifier, "q"));
+      HT_ASSERT(key.timestamp == (int64_t)i+1);
+      size_t vlen = value.decode_length(&vptr);
+      HT_ASSERT(vlen == strlen(rows[i]) && !memcmp(vptr, rows[i], vlen));
+    }
+    HT_ASSERT(!block.next(serkey, value));
+  }
+
+  void test_request() {
+    TableIdentifier table("3");
+    RangeSpec range("apple", "zebra");
+    std::vector<std::pair<String, String> > keys;
+
+    keys.push_back(make_pair(String("apple"), String("")));
+    keys.push_back(make_pair(String("banana"), String("col:q")));
+    keys.push_back(make_pair(String(""), String("col")));
+
+    CommBufPtr cbuf(RangeServerProtocol::
+                    create_request_multi_get(table, range, 7, &keys[0],
+                                             keys.size()));
+    HT_ASSERT(cbuf->header.command == RangeServerProtocol::COMMAND_MULTI_GET);
+
+    // Decode the way RequestHandlerMultiGet does
+    const uint8_t *decode_ptr = cbuf->data.base + cbuf->header.encoded_length();
+    size_t decode_remain = cbuf->data.size - cbuf->header.encoded_length();
+    TableIdentifier decoded_table;
+    RangeSpec decoded_range;
+
+    decoded_table.decode(&decode_ptr, &decode_remain);
+    decoded_range.decode(&decode_ptr, &decode_remain);
+    HT_ASSERT(!strcmp(decoded_table.id, "3"));
+    HT_ASSERT(!strcmp(decoded_range.start_row, "apple"));
+    HT_ASSERT(!strcmp(decoded_range.end_row, "zebra"));
+    HT_ASSERT(decode_i32(&decode_ptr, &decode_remain) == 7);
+    HT_ASSERT(decode_i32(&decode_ptr, &decode_remain) == keys.size());
+    for (size_t i=0; i<keys.size(); i++) {
+      HT_ASSERT(keys[i].first == decode_vstr(&decode_ptr, &decode_remain));
+      HT_ASSERT(keys[i].second == decode_vstr(&decode_ptr, &decode_remain));
+    }
+    HT_ASSERT(decode_remain == 0);
+  }
+
+  void test_continuation() {
+    ScanBlock block;
+    uint32_t completed = 0;
+    size_t next = 0;
+
+    // The server stops after three of the five keys ...
+    EventPtr event = make_response(0, 3, 3);
+    HT_ASSERT(block.load_multi_get(event, &completed) == Error::OK);
+    HT_ASSERT(completed == 3);
+    check_block(block, next, next + completed);
+    next += completed;
+
+    // ... and the remaining keys are fetched with a second request
+    event = make_response(next, row_count, row_count - next);
+    HT_ASSERT(block.load_multi_get(event, &completed) == Error::OK);
+    HT_ASSERT(completed == row_count - next);
+    check_block(block, next, next + completed);
+    next += completed;
+    HT_ASSERT(next == row_count);
+
+    // A completed key need not have any cells
+    event = make_response(0, 0, 2);
+    HT_ASSERT(block.load_multi_get(event, &completed) == Error::OK);
+    HT_ASSERT(completed == 2);
+    check_block(block, 0, 0);
+  }
+
+  void test_bad_responses() {
+    ScanBlock block;
+    uint32_t completed;
+
+    // Block length beyond the payload
+    EventPtr event = make_response(0, 2, 2);
+    uint8_t *ptr = (uint8_t *)event->payload + 8;
+    encode_i32(&ptr, event->payload_len);
+    HT_ASSERT(block.load_multi_get(event, &completed) ==
+              Error::RESPONSE_TRUNCATED);
+
+    // Error response
+    event = new Event(Event::MESSAGE);
+    uint8_t *payload = new uint8_t [4];
+    ptr = payload;
+    encode_i32(&ptr, Error::RANGESERVER_RANGE_NOT_FOUND);
+    event->payload = payload;
+    event->payload_len = 4;
+    HT_ASSERT(block.load_multi_get(event, &completed) ==
+              Error::RANGESERVER_RANGE_NOT_FOUND);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  if (argc != 1)
+    Usage::dump_and_exit(usage);
+
+  test_request();
+  test_continuation();
+  test_bad_responses();
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Table::multi_get() test.
+ * Loads a table that splits into many ranges and fetches a batch of keys
+ * spread across all of them, with absent rows and with and without column
+ * restrictions, checking that exactly the cells of the requested keys are
+ * returned, in key order.  The batch is repeated while the ranges are
+ * still splitting, so that relocated ranges are retried.
+ */
+
+#include "Common/Compat.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include "Hypertable/Lib/Client.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+
+  const char *schema =
+  "<Schema>"
+  "  <AccessGroup name=\"default\">"
+  "    <ColumnFamily>"
+  "      <Name>data</Name>"
+  "    </ColumnFamily>"
+  "    <ColumnFamily>"
+  "      <Name>meta</Name>"
+  "    </ColumnFamily>"
+  "  </AccessGroup>"
+  "</Schema>";
+
+  const char *usage[] = {
+    "usage: multi_get_test",
+    "",
+    "Validates Table::multi_get() against a table with many ranges.",
+    0
+  };
+
+  const size_t ROW_COUNT = 4000;
+  const size_t VALUE_SIZE = 1000;
+  const size_t ITERATIONS = 5;
+
+  typedef map<String, set<String> > ExpectedCells;
+
+  /** Builds the batch of keys, most recent key first, together with the
+   * column families expected for each row.
+   */
+  void build_keys(vector<pair<String, String> > &keys,
+                  ExpectedCells &expected) {
+    char row[32];
+
+    for (size_t i=0; i<ROW_COUNT; i++) {
+      sprintf(row, "%05u", (unsigned)i);
+      if (i % 7 == 0) {
+        keys.push_back(make_pair(String(row), String("")));
+        expected[row].insert("data");
+        expected[row].insert("meta");
+      }
+      else if (i % 7 == 3) {
+        keys.push_back(make_pair(String(row), String("meta")));
+        expected[row].insert("meta");
+      }
+      else if (i % 7 == 5) {
+        keys.push_back(make_pair(String(row), String("data")));
+        expected[row].insert("data");
+      }
+      else if (i % 11 == 0) {
+        // absent row sorting between existing rows
+        String absent = format("%s-absent", row);
+        keys.push_back(make_pair(absent, String("")));
+      }
+    }
+    keys.push_back(make_pair(String("zzzzz"), String("")));
+
+    // multi_get() sorts the keys itself
+    reverse(keys.begin(), keys.end());
+  }
+
+  void check_cells(Cells &cells, ExpectedCells &expected) {
+    ExpectedCells returned;
+    String last_row;
+
+    for (size_t i=0; i<cells.size(); i++) {
+      HT_ASSERT(last_row <= cells[i].row_key);
+      last_row = cells[i].row_key;
+      HT_ASSERT(returned[cells[i].row_key].
+                insert(cells[i].column_family).second);
+      if (!strcmp(cells[i].column_family, "meta"))
+        HT_ASSERT(cells[i].value_len == strlen(cells[i].row_key) &&
+                  !memcmp(cells[i].value, cells[i].row_key,
+                          cells[i].value_len));
+      else
+        HT_ASSERT(cells[i].value_len == VALUE_SIZE);
+    }
+
+    HT_ASSERT(returned == expected);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  char keybuf[32];
+  uint8_t value[VALUE_SIZE];
+
+  if (argc > 1)
+    Usage::dump_and_exit(usage);
+
+  memset(value, 'v', VALUE_SIZE);
+
+  try {
+    Client *hypertable = new Client(System::locate_install_dir(argv[0]),
+                                    "./hypertable.cfg");
+    NamespacePtr ns = hypertable->open_namespace("/");
+    vector<pair<String, String> > keys;
+    ExpectedCells expected;
+    TablePtr table;
+    KeySpec key;
+
+    ns->drop_table("MultiGetTest", true);
+    ns->create_table("MultiGetTest", schema);
+    table = ns->open_table("MultiGetTest");
+
+    {
+      TableMutatorPtr mutator = table->create_mutator();
+      for (size_t i=0; i<ROW_COUNT; i++) {
+        sprintf(keybuf, "%05u", (unsigned)i);
+        key.row = keybuf;
+        key.row_len = strlen(keybuf);
+        key.column_family = "data";
+        mutator->set(key, value, VALUE_SIZE);
+        key.column_family = "meta";
+        key.column_qualifier = "q";
+        key.column_qualifier_len = 1;
+        mutator->set(key, keybuf, strlen(keybuf));
+        key.column_qualifier = 0;
+        key.column_qualifier_len = 0;
+      }
+      mutator->flush();
+    }
+
+    build_keys(keys, expected);
+
+    for (size_t i=0; i<ITERATIONS; i++) {
+      CellsBuilder cb;
+      Cells cells;
+      table->multi_get(keys, cb);
+      cb.get(cells);
+      check_cells(cells, expected);
+      HT_INFOF("multi get iteration %u finished", (unsigned)i);
+      poll(0, 0, 2000);
+    }
+
+    // An empty batch returns nothing
+    {
+      vector<pair<String, String> > none;
+      CellsBuilder cb;
+      table->multi_get(none, cb);
+      HT_ASSERT(cb.size() == 0);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  _exit(0);
+}
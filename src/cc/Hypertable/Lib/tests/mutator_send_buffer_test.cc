@@ -0,0 +1,204 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Tests how TableMutatorAsyncSendBuffer maps offsets reported by the range
+ * server to regions of updates that were sent as a chain of segments.
+ * Failed regions within one segment must point into the segment, regions
+ * spanning segments must be contiguous copies, and every region must hold
+ * the bytes at its offset in the sent update stream.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/CommAddress.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/RangeLocator.h"
+#include "Hypertable/Lib/TableMutatorAsyncCompletionCounter.h"
+#include "Hypertable/Lib/TableMutatorAsyncSendBuffer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: mutator_send_buffer_test",
+    "",
+    "Validates the mapping of failed update offsets onto chained segments.",
+    0
+  };
+
+  const size_t SEGMENT_COUNT = 8;
+  const uint32_t sizes[SEGMENT_COUNT] = { 10, 1, 25, 7, 100, 3, 40, 14 };
+
+  /** Checks the failed region of the most recent add_errors() call.
+   * @param send_buffer Send buffer
+   * @param stream Sent update stream
+   * @param offset Offset of the region in <code>stream</code>
+   * @param len Length of the region
+   * @param in_place Pointer the region is expected at, 0 if it is expected
+   *        to be copied
+   */
+  void check_region(TableMutatorAsyncSendBuffer &send_buffer,
+                    const vector<uint8_t> &stream, uint32_t offset,
+                    uint32_t len, const uint8_t *in_place) {
+    size_t copies = send_buffer.failed_copies.size();
+    send_buffer.add_errors(Error::RANGESERVER_OUT_OF_RANGE, 1, offset, len);
+
+    vector<FailedRegionAsync> failed;
+    send_buffer.get_failed_regions(failed);
+    const FailedRegionAsync &region = failed.back();
+
+    HT_ASSERT(region.error == Error::RANGESERVER_OUT_OF_RANGE);
+    HT_ASSERT(region.len == len);
+    HT_ASSERT(!memcmp(region.base, &stream[offset], len));
+    if (in_place) {
+      HT_ASSERT(region.base == in_place);
+      HT_ASSERT(send_buffer.failed_copies.size() == copies);
+    }
+    else {
+      HT_ASSERT(send_buffer.failed_copies.size() == copies + 1);
+      HT_ASSERT(region.base == send_buffer.failed_copies.back().get());
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  TableMutatorAsyncCompletionCounter counter;
+  TableIdentifier table("1");
+
+  if (argc > 1)
+    Usage::dump_and_exit(usage);
+
+  srand(1234);
+
+  uint32_t total = 0;
+  for (size_t i=0; i<SEGMENT_COUNT; i++)
+    total += sizes[i];
+
+  // Updates sent as a single buffer
+  {
+    TableMutatorAsyncSendBuffer send_buffer(&table, &counter, 0);
+    send_buffer.pending_updates.set(new uint8_t [total], total);
+    for (uint32_t i=0; i<total; i++)
+      send_buffer.pending_updates.base[i] = (uint8_t)rand();
+    vector<uint8_t> stream(send_buffer.pending_updates.base,
+                           send_buffer.pending_updates.base + total);
+
+    check_region(send_buffer, stream, 17, 50,
+                 send_buffer.pending_updates.base + 17);
+  }
+
+  // Updates sent as a chain of segments of the accumulation buffer, in an
+  // order different from the buffer's
+  TableMutatorAsyncSendBuffer send_buffer(&table, &counter, 0);
+  send_buffer.pending_updates.set(new uint8_t [total], total);
+  for (uint32_t i=0; i<total; i++)
+    send_buffer.pending_updates.base[i] = (uint8_t)rand();
+
+  vector<uint32_t> starts(SEGMENT_COUNT);
+  uint32_t offset = 0;
+  for (size_t i=0; i<SEGMENT_COUNT; i++) {
+    starts[i] = offset;
+    offset += sizes[i];
+  }
+  size_t order[SEGMENT_COUNT] = { 5, 2, 7, 0, 4, 1, 6, 3 };
+  vector<uint8_t> stream;
+  vector<uint32_t> stream_offsets;
+  for (size_t i=0; i<SEGMENT_COUNT; i++) {
+    struct iovec segment;
+    segment.iov_base = send_buffer.pending_updates.base + starts[order[i]];
+    segment.iov_len = sizes[order[i]];
+    send_buffer.pending_chain.push_back(segment);
+    stream_offsets.push_back(stream.size());
+    stream.insert(stream.end(), (uint8_t *)segment.iov_base,
+                  (uint8_t *)segment.iov_base + segment.iov_len);
+  }
+  HT_ASSERT(stream.size() == total);
+
+  vector<struct iovec> &chain = send_buffer.pending_chain;
+
+  // Within the first segment
+  check_region(send_buffer, stream, 0, 2, (uint8_t *)chain[0].iov_base);
+
+  // A whole segment, starting and ending on segment boundaries
+  check_region(send_buffer, stream, stream_offsets[2], sizes[order[2]],
+               (uint8_t *)chain[2].iov_base);
+
+  // Inside a segment
+  check_region(send_buffer, stream, stream_offsets[4] + 30, 50,
+               (uint8_t *)chain[4].iov_base + 30);
+
+  // The one byte segment
+  check_region(send_buffer, stream, stream_offsets[5], 1,
+               (uint8_t *)chain[5].iov_base);
+
+  // Ending at the end of the stream
+  check_region(send_buffer, stream, stream_offsets[7] + 1,
+               sizes[order[7]] - 1, (uint8_t *)chain[7].iov_base + 1);
+
+  // Across one boundary
+  check_region(send_buffer, stream, stream_offsets[1] + 20, 10, 0);
+
+  // Across several segments, ending on a boundary
+  check_region(send_buffer, stream, stream_offsets[2] + 5,
+               stream_offsets[6] - stream_offsets[2] - 5, 0);
+
+  // Every offset and length
+  for (uint32_t start=0; start<total; start++) {
+    for (uint32_t len=1; start+len<=total; len++) {
+      size_t i = 0;
+      while (start >= stream_offsets[i] + chain[i].iov_len)
+        i++;
+      const uint8_t *in_place = 0;
+      if (start + len <= stream_offsets[i] + chain[i].iov_len)
+        in_place = (uint8_t *)chain[i].iov_base + (start - stream_offsets[i]);
+      check_region(send_buffer, stream, start, len, in_place);
+    }
+  }
+
+  // All of the updates
+  size_t copies = send_buffer.failed_copies.size();
+  send_buffer.add_errors_all(Error::COMM_BROKEN_CONNECTION);
+  vector<FailedRegionAsync> failed;
+  send_buffer.get_failed_regions(failed);
+  HT_ASSERT(failed.back().error == Error::COMM_BROKEN_CONNECTION);
+  HT_ASSERT(failed.back().len == total);
+  HT_ASSERT(!memcmp(failed.back().base, &stream[0], total));
+  HT_ASSERT(send_buffer.failed_copies.size() == copies + 1);
+
+  send_buffer.clear();
+  HT_ASSERT(send_buffer.failed_copies.empty());
+  HT_ASSERT(send_buffer.failed_regions.empty());
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Parallel scan test.
+ * Scans a table with more row intervals than
+ * <code>Hypertable.Scanner.Parallelism</code>, so that interval scanners
+ * are started as earlier ones finish, and checks that every cell is
+ * delivered once, in row order unless the scan is unordered, and that the
+ * scanner completes, also when it is cancelled with intervals in flight.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Usage.h"
+
+#include "Hypertable/Lib/Client.h"
+#include "Hypertable/Lib/Future.h"
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+extern "C" {
+#include <poll.h>
+#include <unistd.h>
+}
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+
+  const char *schema =
+  "<Schema>"
+  "  <AccessGroup name=\"default\">"
+  "    <ColumnFamily>"
+  "      <Name>data</Name>"
+  "    </ColumnFamily>"
+  "  </AccessGroup>"
+  "</Schema>";
+
+  const char *usage[] = {
+    "usage: parallel_scan_test",
+    "",
+    "Validates parallel and unordered scans with intervals in flight.",
+    0
+  };
+
+  const size_t ROW_COUNT = 200;
+  const size_t INTERVAL_COUNT = 10;
+  const size_t VALUE_SIZE = 1000;
+
+  void build_scan_spec(ScanSpecBuilder &ssb) {
+    char start[32], end[32];
+    size_t rows_per_interval = ROW_COUNT / INTERVAL_COUNT;
+    ssb.clear();
+    for (size_t i=0; i<INTERVAL_COUNT; i++) {
+      sprintf(start, "%05u", (unsigned)(i * rows_per_interval));
+      sprintf(end, "%05u", (unsigned)((i + 1) * rows_per_interval));
+      ssb.add_row_interval(start, true, end, false);
+    }
+  }
+
+  void check_result(ResultPtr &result) {
+    if (result->is_error()) {
+      int error;
+      String error_msg;
+      result->get_error(error, error_msg);
+      Exception e(error, error_msg);
+      HT_ERROR_OUT << "Encountered scan error " << e << HT_END;
+      _exit(1);
+    }
+    HT_ASSERT(result->is_scan());
+  }
+
+  /** Waits for a scanner to account for all of its intervals.
+   * @param scanner Scanner to wait for
+   */
+  void wait_for_complete(TableScannerAsyncPtr &scanner) {
+    for (int i=0; i<600 && !scanner->is_complete(); i++)
+      poll(0, 0, 100);
+    HT_ASSERT(scanner->is_complete());
+  }
+
+  /** Scans all intervals to completion.
+   * @param table Table to scan
+   * @param flags Scanner flags
+   */
+  void scan_to_completion(TablePtr &table, int flags) {
+    ScanSpecBuilder ssb;
+    ResultPtr result;
+    Cells cells;
+    set<String> rows;
+    String last_row;
+    // small capacity keeps intervals waiting on the client in flight
+    Future ff(4 * VALUE_SIZE);
+
+    build_scan_spec(ssb);
+    TableScannerAsyncPtr scanner =
+      table->create_scanner_async(&ff, ssb.get(), 0, flags);
+
+    while (ff.get(result)) {
+      check_result(result);
+      result->get_cells(cells);
+      for (size_t i=0; i<cells.size(); ++i) {
+        if (!(flags & Table::SCANNER_FLAG_UNORDERED)) {
+          HT_ASSERT(last_row.empty() || last_row < cells[i].row_key);
+          last_row = cells[i].row_key;
+        }
+        HT_ASSERT(rows.insert(cells[i].row_key).second);
+      }
+    }
+
+    // every interval was started and accounted for exactly once
+    HT_ASSERT(rows.size() == ROW_COUNT);
+    HT_ASSERT(scanner->is_complete());
+    scanner = 0;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  char keybuf[32];
+  uint8_t value[VALUE_SIZE];
+
+  if (argc > 1)
+    Usage::dump_and_exit(usage);
+
+  memset(value, 'v', VALUE_SIZE);
+
+  try {
+    Client *hypertable = new Client(argv[0], "./parallel_scan_test.cfg");
+    NamespacePtr ns = hypertable->open_namespace("/");
+    TablePtr table;
+    KeySpec key;
+
+    ns->drop_table("ParallelScanTest", true);
+    ns->create_table("ParallelScanTest", schema);
+    table = ns->open_table("ParallelScanTest");
+
+    {
+      TableMutatorPtr mutator = table->create_mutator();
+      key.column_family = "data";
+      for (size_t i=0; i<ROW_COUNT; i++) {
+        sprintf(keybuf, "%05u", (unsigned)i);
+        key.row = keybuf;
+        key.row_len = strlen(keybuf);
+        mutator->set(key, value, VALUE_SIZE);
+      }
+      mutator->flush();
+    }
+
+    scan_to_completion(table, Table::SCANNER_FLAG_PARALLEL);
+    HT_INFO("ordered parallel scan test finished");
+
+    scan_to_completion(table, Table::SCANNER_FLAG_UNORDERED);
+    HT_INFO("unordered parallel scan test finished");
+
+    // cancel while interval scanners are running and intervals are pending
+    int flag_list[] = { Table::SCANNER_FLAG_PARALLEL,
+                        Table::SCANNER_FLAG_UNORDERED };
+    for (size_t i=0; i<sizeof(flag_list)/sizeof(int); i++) {
+      ScanSpecBuilder ssb;
+      ResultPtr result;
+      Cells cells;
+      size_t cell_count = 0;
+      Future ff(4 * VALUE_SIZE);
+
+      build_scan_spec(ssb);
+      TableScannerAsyncPtr scanner =
+        table->create_scanner_async(&ff, ssb.get(), 0, flag_list[i]);
+      while (cell_count < ROW_COUNT / 4 && ff.get(result)) {
+        check_result(result);
+        result->get_cells(cells);
+        cell_count += cells.size();
+      }
+      HT_ASSERT(cell_count >= ROW_COUNT / 4);
+      ff.cancel();
+      wait_for_complete(scanner);
+      scanner = 0;
+    }
+    HT_INFO("parallel scan cancel test finished");
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  _exit(0);
+}
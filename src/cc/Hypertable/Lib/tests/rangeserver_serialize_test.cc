@@ -82,6 +82,18 @@ int main(int argc, char *argv[]) {
 
     stats1->tables.push_back(table_stat);
   }
+
+  const char *latency_names[] = { "update", "commit_log_sync", "queue_wait" };
+  for (size_t i=0; i<sizeof(latency_names)/sizeof(const char *); i++) {
+    LatencyHistogram histogram;
+    for (size_t j=0; j<100; j++)
+      histogram.record(Random::number32() % 1000000);
+    histogram.snapshot(stats1->latency[latency_names[i]]);
+  }
+
+  stats1->memory_allocation["BlockCache"] = Random::number64() % 1000000000;
+  stats1->memory_allocation["QueryCache"] = Random::number64() % 100000000;
+  stats1->memory_allocation["CellCache"] = Random::number64() % 1000000000;
   
   
   size_t len = stats1->encoded_length();
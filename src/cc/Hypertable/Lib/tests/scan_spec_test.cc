@@ -22,6 +22,7 @@
 #include <Common/Compat.h>
 
 #include <Hypertable/Lib/Client.h>
+#include <Hypertable/Lib/ScanAggregate.h>
 
 #include <Common/md5.h>
 #include <Common/Logger.h>
@@ -29,6 +30,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 
 using namespace std;
 using namespace Hypertable;
@@ -83,5 +85,116 @@ int main(int argc, char **argv) {
   HT_ASSERT(fired==true);
   fired=false;
 
+  // aggregation mode survives serialization and disables caching
+  {
+    ScanSpecBuilder ssb;
+    ssb.add_row("foo");
+    HT_ASSERT(ssb.get().cacheable());
+    ssb.set_aggregate(ScanSpec::AGGREGATE_BY_COLUMN);
+    HT_ASSERT(!ssb.get().cacheable());
+
+    uint8_t buf[256];
+    uint8_t *ptr = buf;
+    HT_ASSERT(ssb.get().encoded_length() <= sizeof(buf));
+    ssb.get().encode(&ptr);
+    const uint8_t *dptr = buf;
+    size_t remain = ptr - buf;
+    ScanSpec decoded(&dptr, &remain);
+    HT_ASSERT(remain == 0);
+    HT_ASSERT(decoded.aggregate == ScanSpec::AGGREGATE_BY_COLUMN);
+
+    // trailing fields appended by a newer writer are skipped
+    size_t len = ptr - buf;
+    const uint8_t *lptr = buf + 1;
+    size_t lremain = len - 1;
+    size_t fields_len = Serialization::decode_vi32(&lptr, &lremain);
+    size_t header_len = len - fields_len;
+    buf[len] = 0x7f;
+    buf[len + 1] = 0x55;
+    ptr = buf + 1;
+    Serialization::encode_vi32(&ptr, fields_len + 1);
+    HT_ASSERT((size_t)(ptr - buf) == header_len);
+    dptr = buf;
+    remain = len + 2;
+    ScanSpec extended(&dptr, &remain);
+    HT_ASSERT(remain == 1 && *dptr == 0x55);
+    HT_ASSERT(extended.aggregate == ScanSpec::AGGREGATE_BY_COLUMN);
+
+    // a different version is rejected
+    buf[0] = ScanSpec::ENCODING_VERSION + 1;
+    dptr = buf;
+    remain = len;
+    try {
+      ScanSpec mismatch(&dptr, &remain);
+      HT_ASSERT(!"version mismatch not detected");
+    }
+    catch (Exception &e) {
+      HT_ASSERT(e.code() == Error::SERIALIZATION_VERSION_MISMATCH);
+    }
+  }
+
+  // out of range numbers are not numeric, and sum overflow is flagged
+  {
+    int64_t number;
+    HT_ASSERT(ScanAggregate::parse_number((const uint8_t *)"9223372036854775807", 19, &number));
+    HT_ASSERT(number == std::numeric_limits<int64_t>::max());
+    HT_ASSERT(!ScanAggregate::parse_number((const uint8_t *)"9223372036854775808", 19, &number));
+    HT_ASSERT(ScanAggregate::parse_number((const uint8_t *)"-9223372036854775808", 20, &number));
+    HT_ASSERT(number == std::numeric_limits<int64_t>::min());
+    HT_ASSERT(!ScanAggregate::parse_number((const uint8_t *)"-9223372036854775809", 20, &number));
+
+    ScanAggregate a, b;
+    a.add_counter(std::numeric_limits<int64_t>::max() - 1);
+    HT_ASSERT(!a.sum_overflow);
+    b.add_counter(2);
+    a.merge(b);
+    HT_ASSERT(a.sum_overflow && a.sum == std::numeric_limits<int64_t>::max());
+
+    uint8_t buf[64];
+    uint8_t *ptr = buf;
+    a.encode(&ptr);
+    HT_ASSERT((size_t)(ptr - buf) == a.encoded_length());
+    const uint8_t *dptr = buf;
+    size_t remain = ptr - buf;
+    ScanAggregate decoded;
+    decoded.decode(&dptr, &remain);
+    HT_ASSERT(remain == 0 && decoded.sum_overflow);
+  }
+
+  // partial aggregates are combined per group
+  {
+    ScanAggregate a, b;
+    a.add_value((const uint8_t *)"10", 2);
+    a.add_value((const uint8_t *)"abc", 3);
+    a.add_counter(-5);
+    a.rows = 1;
+    b.add_value((const uint8_t *)"+7", 2);
+    b.rows = 1;
+
+    uint8_t buf[2][64];
+    uint8_t *ptr;
+    Cell cell;
+    cell.row_key = "row";
+    cell.column_family = "cf";
+    ScanAggregator aggregator(ScanSpec::AGGREGATE_BY_COLUMN);
+    ptr = buf[0];
+    a.encode(&ptr);
+    cell.value = buf[0];
+    cell.value_len = ptr - buf[0];
+    aggregator.add(cell);
+    ptr = buf[1];
+    b.encode(&ptr);
+    cell.row_key = "other";
+    cell.value = buf[1];
+    cell.value_len = ptr - buf[1];
+    aggregator.add(cell);
+
+    HT_ASSERT(aggregator.results().size() == 1);
+    ScanAggregate total;
+    aggregator.get_total(total);
+    HT_ASSERT(total.cells == 4 && total.rows == 2 && total.numeric_cells == 3);
+    HT_ASSERT(total.sum == 12 && total.min == -5 && total.max == 10);
+  }
+
   _exit(0);
 }
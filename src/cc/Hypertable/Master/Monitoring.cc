@@ -43,12 +43,46 @@ extern "C" {
 using namespace Hypertable;
 using namespace std;
 
+namespace {
+
+  /// Statistics kept per RangeServer, in rangeserver_rrd_data order
+  const char *rangeserver_metrics[] = {
+    "range_count", "scanner_count", "file_count", "scan_rate", "update_rate",
+    "sync_rate", "cell_read_rate", "cell_write_rate", "byte_read_rate",
+    "byte_write_rate", "qcache_hit_pct", "qcache_max_mem", "qcache_fill",
+    "bcache_hit_pct", "bcache_max_mem", "bcache_fill", "disk_used_pct",
+    "disk_read_bytes", "disk_write_bytes", "disk_read_iops",
+    "disk_write_iops", "vm_size", "vm_resident", "page_in", "page_out",
+    "heap_size", "heap_slack", "tracked_memory", "net_rx_rate", "net_tx_rate",
+    "loadavg", "cpu_user", "cpu_sys", 0
+  };
+
+  /// Statistics kept per table
+  const char *table_metrics[] = {
+    "range_count", "scanner_count", "scan_rate", "update_rate",
+    "cell_read_rate", "cell_write_rate", "byte_read_rate", "byte_write_rate",
+    "disk_read_rate", "disk_used", "compression_ratio", "memory_used",
+    "memory_allocated", "shadow_cache_memory", "block_index_memory",
+    "bloom_filter_memory", "bloom_filter_access", "bloom_filter_maybes", 0
+  };
+
+  std::vector<String> metric_names(const char **names) {
+    std::vector<String> metrics;
+    for (; *names; ++names)
+      metrics.push_back(*names);
+    return metrics;
+  }
+
+}
+
 Monitoring::Monitoring(Context *context)
-  : m_context(context), m_last_server_count(0), m_disable_rrdtool(false) {
+  : m_context(context), m_last_server_count(0), m_disable(false),
+    m_enable_rrdtool(false) {
   PropertiesPtr &props = m_context->props;
 
   /** Create directories for storing monitoring stats */
-  m_disable_rrdtool = props->get_bool("Hypertable.Monitoring.Disable");
+  m_disable = props->get_bool("Hypertable.Monitoring.Disable");
+  m_enable_rrdtool = props->get_bool("Hypertable.Monitoring.RrdTool");
   m_monitoring_interval = props->get_i32("Hypertable.Monitoring.Interval");
   Path data_dir = props->get_str("Hypertable.DataDirectory");
   m_monitoring_dir = (data_dir /= "/run/monitoring").string();
@@ -62,6 +96,16 @@ Monitoring::Monitoring(Context *context)
   m_namemap_ptr = m_context->namemap;
 
   memset(m_last_server_set_digest, 0, 16);
+
+  // Same resolutions as the rrdtool archives: 1 day of samples, 5 minute
+  // averages for 10 days, 30 minute averages for 31 days, 6 hour averages
+  // for 1.5 years, and 5 minute and 6 hour maxima
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 1, 2880));
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 10, 2880));
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 60, 1448));
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 720, 2190));
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::MAX, 10, 2880));
+  m_archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::MAX, 720, 2190));
 }
 
 void Monitoring::create_dir(const String &dir) {
@@ -97,6 +141,7 @@ void Monitoring::drop_server(const String &location) {
   RangeServerMap::iterator iter = m_server_map.find(location);
   if (iter != m_server_map.end())
     m_server_map.erase(iter);
+  m_rangeserver_stores.erase(location);
 }
 
 namespace {
@@ -229,15 +274,10 @@ void Monitoring::add(std::vector<RangeServerStatistics> &stats) {
 
     compute_clock_skew(stats[i].stats->timestamp, &stats[i]);
 
-    String rrd_file = m_monitoring_rs_dir + "/" + stats[i].location + "_stats_v0.rrd";
-
-    if (!FileUtils::exists(rrd_file))
-      create_rangeserver_rrd(rrd_file);
-
     if (rrd_data.timestamp > table_stats_timestamp) {
       table_stats_timestamp = rrd_data.timestamp;
     }
-    update_rangeserver_rrd(rrd_file, rrd_data);
+    update_rangeserver_stats(stats[i].location, rrd_data);
     add_table_stats(stats[i].stats->tables,stats[i].fetch_timestamp);
 
     (*iter).second->stats = stats[i].stats;
@@ -319,24 +359,7 @@ void Monitoring::add(std::vector<RangeServerStatistics> &stats) {
       }
     }
 
-    String table_file_name = ts_iter->first;
-    String rrd_file = m_monitoring_table_dir + "/" + table_file_name + "_table_stats_v0.rrd";
-    if (!FileUtils::exists(rrd_file)) {
-        String dir;
-        size_t slash_pos;
-        slash_pos = table_file_name.rfind("/");
-        if (slash_pos != string::npos) {
-            dir = table_file_name.substr(0,slash_pos+1);
-        }
-        String table_dir = m_monitoring_table_dir + "/"+dir;
-        if (!FileUtils::exists(table_dir)) {
-            if (!FileUtils::mkdirs(table_dir)) {
-                HT_THROW(Error::LOCAL_IO_ERROR, "Unable to create table dir");
-            }
-        }
-        create_table_rrd(rrd_file);
-    }
-    update_table_rrd(rrd_file,ts_iter->second);
+    update_table_stats(ts_iter->first, ts_iter->second);
   }
   dump_table_summary_json();
 
@@ -411,6 +434,109 @@ void Monitoring::compute_clock_skew(int64_t server_timestamp, RangeServerStatist
     stats->clock_skew =  (skew / 1000000L) * multiplier;
 }
 
+TimeSeriesStore *Monitoring::get_rangeserver_store(const String &location) {
+  TimeSeriesStorePtr &store = m_rangeserver_stores[location];
+  if (!store)
+    store = new TimeSeriesStore(m_monitoring_rs_dir + "/" + location
+                                + "_stats_v0.ts", std::max(1, m_monitoring_interval/1000),
+                                metric_names(rangeserver_metrics), m_archives);
+  return store.get();
+}
+
+TimeSeriesStore *Monitoring::get_table_store(const String &table_id) {
+  TimeSeriesStorePtr &store = m_table_stores[table_id];
+  if (!store)
+    store = new TimeSeriesStore(m_monitoring_table_dir + "/" + table_id
+                                + "_table_stats_v0.ts", std::max(1, m_monitoring_interval/1000),
+                                metric_names(table_metrics), m_archives);
+  return store.get();
+}
+
+void Monitoring::update_rangeserver_stats(const String &location,
+                                          struct rangeserver_rrd_data &rrd_data) {
+  if (m_disable)
+    return;
+
+  double values[] = {
+    (double)rrd_data.range_count, (double)rrd_data.scanner_count,
+    (double)rrd_data.file_count, rrd_data.scan_rate, rrd_data.update_rate,
+    rrd_data.sync_rate, rrd_data.cell_read_rate, rrd_data.cell_write_rate,
+    rrd_data.byte_read_rate, rrd_data.byte_write_rate, rrd_data.qcache_hit_pct,
+    (double)rrd_data.qcache_max_mem, (double)rrd_data.qcache_fill,
+    rrd_data.bcache_hit_pct, (double)rrd_data.bcache_max_mem,
+    (double)rrd_data.bcache_fill, rrd_data.disk_used_pct,
+    (double)rrd_data.disk_read_bytes, (double)rrd_data.disk_write_bytes,
+    (double)rrd_data.disk_read_iops, (double)rrd_data.disk_write_iops,
+    (double)rrd_data.vm_size, (double)rrd_data.vm_resident,
+    (double)rrd_data.page_in, (double)rrd_data.page_out,
+    (double)rrd_data.heap_size, (double)rrd_data.heap_slack,
+    (double)rrd_data.tracked_memory, rrd_data.net_rx_rate,
+    rrd_data.net_tx_rate, rrd_data.load_average, rrd_data.cpu_user,
+    rrd_data.cpu_sys
+  };
+
+  try {
+    get_rangeserver_store(location)->update(rrd_data.timestamp,
+        std::vector<double>(values, values + sizeof(values)/sizeof(double)));
+  }
+  catch (Exception &e) {
+    HT_ERRORF("Problem recording statistics of %s - %s", location.c_str(),
+              e.what());
+    m_rangeserver_stores.erase(location);
+  }
+
+  if (m_enable_rrdtool) {
+    String rrd_file = m_monitoring_rs_dir + "/" + location + "_stats_v0.rrd";
+    if (!FileUtils::exists(rrd_file))
+      create_rangeserver_rrd(rrd_file);
+    update_rangeserver_rrd(rrd_file, rrd_data);
+  }
+}
+
+void Monitoring::update_table_stats(const String &table_id,
+                                    struct table_rrd_data &rrd_data) {
+  if (m_disable)
+    return;
+
+  // Table ids of namespaced tables contain a slash
+  size_t slash_pos = table_id.rfind("/");
+  if (slash_pos != string::npos) {
+    String table_dir = m_monitoring_table_dir + "/" + table_id.substr(0, slash_pos+1);
+    if (!FileUtils::exists(table_dir) && !FileUtils::mkdirs(table_dir))
+      HT_THROW(Error::LOCAL_IO_ERROR, "Unable to create table dir");
+  }
+
+  double values[] = {
+    (double)rrd_data.range_count, (double)rrd_data.scanner_count,
+    rrd_data.scan_rate, rrd_data.update_rate, rrd_data.cell_read_rate,
+    rrd_data.cell_write_rate, rrd_data.byte_read_rate,
+    rrd_data.byte_write_rate, rrd_data.disk_read_rate,
+    (double)rrd_data.disk_used, rrd_data.compression_ratio,
+    (double)rrd_data.memory_used, (double)rrd_data.memory_allocated,
+    (double)rrd_data.shadow_cache_memory, (double)rrd_data.block_index_memory,
+    (double)rrd_data.bloom_filter_memory,
+    (double)rrd_data.bloom_filter_accesses,
+    (double)rrd_data.bloom_filter_maybes
+  };
+
+  try {
+    get_table_store(table_id)->update(table_stats_timestamp,
+        std::vector<double>(values, values + sizeof(values)/sizeof(double)));
+  }
+  catch (Exception &e) {
+    HT_ERRORF("Problem recording statistics of table %s - %s",
+              table_id.c_str(), e.what());
+    m_table_stores.erase(table_id);
+  }
+
+  if (m_enable_rrdtool) {
+    String rrd_file = m_monitoring_table_dir + "/" + table_id + "_table_stats_v0.rrd";
+    if (!FileUtils::exists(rrd_file))
+      create_table_rrd(rrd_file);
+    update_table_rrd(rrd_file, rrd_data);
+  }
+}
+
 void Monitoring::create_rangeserver_rrd(const String &filename) {
   char buf[64];
   String step;
@@ -803,9 +929,6 @@ void Monitoring::invalidate_id_mapping(const String &table_id) {
 }
 
 void Monitoring::run_rrdtool(std::vector<String> &command) {
-  if (m_disable_rrdtool)
-    return;
-
   String cmd = "rrdtool";
 
   foreach_ht (const String &s, command) {
@@ -36,6 +36,7 @@
 #include "Hypertable/Lib/StatsTable.h"
 
 #include "RangeServerStatistics.h"
+#include "TimeSeriesStore.h"
 #include "Hypertable/Lib/NameIdMapper.h"
 
 
@@ -135,8 +136,16 @@ namespace Hypertable {
       double disk_read_rate;
     };
 
+    typedef std::map<String, TimeSeriesStorePtr> TimeSeriesStoreMap;
+
     void create_dir(const String &dir);
     void compute_clock_skew(int64_t server_timestamp, RangeServerStatistics *stats);
+    TimeSeriesStore *get_rangeserver_store(const String &location);
+    TimeSeriesStore *get_table_store(const String &table_id);
+    void update_rangeserver_stats(const String &location,
+                                  struct rangeserver_rrd_data &rrd_data);
+    void update_table_stats(const String &table_id,
+                            struct table_rrd_data &rrd_data);
     void create_rangeserver_rrd(const String &filename);
     void update_rangeserver_rrd(const String &filename, struct rangeserver_rrd_data &rrd_data);
     void run_rrdtool(std::vector<String> &command);
@@ -170,7 +179,11 @@ namespace Hypertable {
     unsigned char m_last_server_set_digest[16];
     uint64_t table_stats_timestamp;
     NameIdMapperPtr m_namemap_ptr;
-    bool m_disable_rrdtool;
+    TimeSeriesStoreMap m_rangeserver_stores;
+    TimeSeriesStoreMap m_table_stores;
+    std::vector<TimeSeriesStore::Archive> m_archives;
+    bool m_disable;
+    bool m_enable_rrdtool;
   };
 
   typedef intrusive_ptr<Monitoring> MonitoringPtr;
@@ -86,14 +86,19 @@ void OperationGatherStatistics::execute() {
     monitoring_dir = (data_dir /= "/run/monitoring").string();
     filename = monitoring_dir + "/mop.dot";
     filename_tmp = monitoring_dir + "/mop.tmp.dot";
-    if (FileUtils::write(filename_tmp, graphviz_str) != -1)
-      FileUtils::rename(filename_tmp, filename);
-    dot_cmd = format("dot -Tjpg -Gcharset=latin1 -o%s/mop.tmp.jpg %s/mop.dot",
-                     monitoring_dir.c_str(), monitoring_dir.c_str());
-    if (system(dot_cmd.c_str()) != -1) {
-      filename = monitoring_dir + "/mop.jpg";
-      filename_tmp = monitoring_dir + "/mop.tmp.jpg";
-      FileUtils::rename(filename_tmp, filename);
+    // Only spawn dot when the operation graph changed since the last round
+    if (!FileUtils::exists(monitoring_dir + "/mop.jpg") ||
+        !FileUtils::exists(filename) ||
+        FileUtils::file_to_string(filename) != graphviz_str) {
+      if (FileUtils::write(filename_tmp, graphviz_str) != -1)
+        FileUtils::rename(filename_tmp, filename);
+      dot_cmd = format("dot -Tjpg -Gcharset=latin1 -o%s/mop.tmp.jpg %s/mop.dot",
+                       monitoring_dir.c_str(), monitoring_dir.c_str());
+      if (system(dot_cmd.c_str()) != -1) {
+        filename = monitoring_dir + "/mop.jpg";
+        filename_tmp = monitoring_dir + "/mop.tmp.jpg";
+        FileUtils::rename(filename_tmp, filename);
+      }
     }
 
     dispatch_handler.wait_for_completion();
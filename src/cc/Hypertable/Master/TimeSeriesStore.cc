@@ -0,0 +1,436 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for TimeSeriesStore.
+ * This file contains definitions for TimeSeriesStore, an embedded
+ * round-robin time series file used by the Master to persist monitoring
+ * statistics.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/FileUtils.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "TimeSeriesStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hypertable::Serialization;
+using namespace std;
+
+namespace {
+
+  const char MAGIC[8] = { 'H','T','T','S','D','B','0','1' };
+
+  /// Length of the fixed part of the header
+  const size_t HEADER_LENGTH = 32;
+
+  /// Length of a metric name in the header
+  const size_t NAME_LENGTH = 32;
+
+  /// Length of an archive specification in the header
+  const size_t ARCHIVE_LENGTH = 16;
+
+  const double UNKNOWN = numeric_limits<double>::quiet_NaN();
+
+  /// Doubles are stored as their IEEE 754 bit pattern so NaN survives
+  void encode_value(uint8_t **bufp, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    encode_i64(bufp, bits);
+  }
+
+  double decode_value(const uint8_t **bufp, size_t *remainp) {
+    uint64_t bits = decode_i64(bufp, remainp);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  void write_fully(int fd, const uint8_t *buf, size_t len, off_t offset,
+                   const String &filename) {
+    while (len) {
+      ssize_t nwritten = ::pwrite(fd, buf, len, offset);
+      if (nwritten < 0) {
+        if (errno == EINTR)
+          continue;
+        HT_THROWF(Error::LOCAL_IO_ERROR, "Problem writing time series file "
+                  "'%s' - %s", filename.c_str(), strerror(errno));
+      }
+      buf += nwritten;
+      len -= nwritten;
+      offset += nwritten;
+    }
+  }
+
+  void read_fully(int fd, uint8_t *buf, size_t len, off_t offset,
+                  const String &filename) {
+    ssize_t nread = FileUtils::pread(fd, buf, len, offset);
+    if (nread != (ssize_t)len)
+      HT_THROWF(Error::LOCAL_IO_ERROR, "Short read of time series file '%s'",
+                filename.c_str());
+  }
+
+  /** Closes a file descriptor on scope exit. */
+  class FileCloser {
+  public:
+    FileCloser(int fd) : m_fd(fd) { }
+    ~FileCloser() { ::close(m_fd); }
+  private:
+    int m_fd;
+  };
+
+  int open_file(const String &filename, int flags) {
+    int fd = ::open(filename.c_str(), flags, 0644);
+    if (fd < 0)
+      HT_THROWF(Error::LOCAL_IO_ERROR, "Unable to open time series file "
+                "'%s' - %s", filename.c_str(), strerror(errno));
+    return fd;
+  }
+
+}
+
+
+TimeSeriesStore::TimeSeriesStore(const String &filename, uint32_t step,
+                                 const vector<String> &metrics,
+                                 const vector<Archive> &archives)
+  : m_filename(filename), m_step(step), m_metrics(metrics), m_last_slot(0) {
+  HT_ASSERT(m_step > 0);
+  foreach_ht (const Archive &archive, archives) {
+    HT_ASSERT(archive.steps_per_row > 0 && archive.rows > 0);
+    m_archives.push_back(ArchiveState(archive));
+    m_archives.back().acc.resize(m_metrics.size(), 0.0);
+    m_archives.back().count.resize(m_metrics.size(), 0.0);
+  }
+  foreach_ht (const String &metric, m_metrics)
+    HT_ASSERT(metric.length() < NAME_LENGTH);
+
+  if (!FileUtils::exists(m_filename) || !load()) {
+    HT_INFOF("Creating time series file %s", m_filename.c_str());
+    create();
+  }
+}
+
+
+void TimeSeriesStore::update(uint64_t timestamp, const vector<double> &values) {
+  HT_ASSERT(values.size() == m_metrics.size());
+
+  uint64_t slot = timestamp / m_step;
+  if (slot <= m_last_slot)
+    return;
+
+  int fd = open_file(m_filename, O_RDWR);
+  FileCloser closer(fd);
+
+  for (size_t i=0; i<m_archives.size(); i++) {
+    ArchiveState &archive = m_archives[i];
+    int64_t row = slot / archive.spec.steps_per_row;
+
+    if (row != archive.acc_row) {
+      if (archive.acc_row >= 0)
+        flush_row(fd, i, row);
+      archive.acc_row = row;
+      fill(archive.acc.begin(), archive.acc.end(), 0.0);
+      fill(archive.count.begin(), archive.count.end(), 0.0);
+    }
+
+    for (size_t j=0; j<values.size(); j++) {
+      if (std::isnan(values[j]))
+        continue;
+      if (archive.spec.consolidation == MAX) {
+        if (archive.count[j] == 0 || values[j] > archive.acc[j])
+          archive.acc[j] = values[j];
+      }
+      else
+        archive.acc[j] += values[j];
+      archive.count[j] += 1.0;
+    }
+  }
+
+  m_last_slot = slot;
+  write_state(fd);
+}
+
+
+uint32_t TimeSeriesStore::fetch(const String &metric,
+                                Consolidation consolidation,
+                                uint64_t start, uint64_t end,
+                                vector<Point> &points) {
+  size_t column = find(m_metrics.begin(), m_metrics.end(), metric)
+    - m_metrics.begin();
+  if (column == m_metrics.size())
+    return 0;
+
+  // Finest archive that covers start, or coarsest one
+  int index = -1;
+  uint64_t best_resolution = 0;
+  bool best_covers = false;
+  for (size_t i=0; i<m_archives.size(); i++) {
+    const ArchiveState &archive = m_archives[i];
+    if (archive.spec.consolidation != consolidation)
+      continue;
+    uint64_t resolution = (uint64_t)archive.spec.steps_per_row * m_step;
+    uint64_t span = resolution * archive.spec.rows;
+    bool covers = last_update() < span || last_update() - span <= start;
+    if (index == -1 ||
+        (covers && (!best_covers || resolution < best_resolution)) ||
+        (!covers && !best_covers && resolution > best_resolution)) {
+      index = i;
+      best_resolution = resolution;
+      best_covers = covers;
+    }
+  }
+  if (index == -1)
+    return 0;
+
+  const ArchiveState &archive = m_archives[index];
+  if (archive.last_row < 0)
+    return (uint32_t)best_resolution;
+
+  int64_t rows = archive.spec.rows;
+  int64_t first = std::max((int64_t)(start / best_resolution),
+                           std::max(archive.first_row,
+                                    archive.last_row - rows + 1));
+  int64_t last = std::min((int64_t)(end / best_resolution), archive.last_row);
+  if (first > last)
+    return (uint32_t)best_resolution;
+
+  int fd = open_file(m_filename, O_RDONLY);
+  FileCloser closer(fd);
+
+  // Read the rows of the period, in at most two pieces as the ring wraps
+  size_t row_length = 8 * m_metrics.size();
+  vector<uint8_t> buf;
+  int64_t row = first;
+  while (row <= last) {
+    int64_t position = row % rows;
+    int64_t count = std::min(last - row + 1, rows - position);
+    buf.resize(count * row_length);
+    read_fully(fd, &buf[0], buf.size(),
+               data_offset(index) + position * row_length, m_filename);
+    for (int64_t i=0; i<count; i++) {
+      const uint8_t *ptr = &buf[i * row_length + column * 8];
+      size_t remain = 8;
+      points.push_back(Point((row + i) * best_resolution,
+                             decode_value(&ptr, &remain)));
+    }
+    row += count;
+  }
+
+  return (uint32_t)best_resolution;
+}
+
+
+void TimeSeriesStore::create() {
+  int fd = open_file(m_filename, O_RDWR | O_CREAT | O_TRUNC);
+  FileCloser closer(fd);
+
+  size_t length = data_offset(m_archives.size());
+  vector<uint8_t> buf(state_offset(0), 0);
+  uint8_t *ptr = &buf[0];
+
+  memcpy(ptr, MAGIC, sizeof(MAGIC));
+  ptr += sizeof(MAGIC);
+  encode_i32(&ptr, m_step);
+  encode_i32(&ptr, m_metrics.size());
+  encode_i32(&ptr, m_archives.size());
+  encode_i32(&ptr, 0);
+  encode_i64(&ptr, 0);
+  foreach_ht (const String &metric, m_metrics) {
+    memcpy(ptr, metric.c_str(), metric.length());
+    ptr += NAME_LENGTH;
+  }
+  foreach_ht (const ArchiveState &archive, m_archives) {
+    encode_i32(&ptr, archive.spec.consolidation);
+    encode_i32(&ptr, archive.spec.steps_per_row);
+    encode_i32(&ptr, archive.spec.rows);
+    encode_i32(&ptr, 0);
+  }
+  HT_ASSERT(ptr == &buf[0] + buf.size());
+
+  write_fully(fd, &buf[0], buf.size(), 0, m_filename);
+  if (::ftruncate(fd, length) < 0)
+    HT_THROWF(Error::LOCAL_IO_ERROR, "Problem sizing time series file '%s' "
+              "- %s", m_filename.c_str(), strerror(errno));
+  write_state(fd);
+}
+
+
+bool TimeSeriesStore::load() {
+  int fd = open_file(m_filename, O_RDONLY);
+  FileCloser closer(fd);
+
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) < 0 ||
+      (size_t)statbuf.st_size != data_offset(m_archives.size())) {
+    HT_WARNF("Time series file %s has unexpected size, recreating",
+             m_filename.c_str());
+    return false;
+  }
+
+  vector<uint8_t> buf(data_offset(0));
+  read_fully(fd, &buf[0], buf.size(), 0, m_filename);
+  const uint8_t *ptr = &buf[0];
+  size_t remain = buf.size();
+
+  bool matches = memcmp(ptr, MAGIC, sizeof(MAGIC)) == 0;
+  ptr += sizeof(MAGIC);
+  remain -= sizeof(MAGIC);
+  matches = decode_i32(&ptr, &remain) == m_step && matches;
+  matches = decode_i32(&ptr, &remain) == m_metrics.size() && matches;
+  matches = decode_i32(&ptr, &remain) == m_archives.size() && matches;
+  decode_i32(&ptr, &remain);
+  uint64_t last_slot = decode_i64(&ptr, &remain);
+  foreach_ht (const String &metric, m_metrics) {
+    matches = matches && strncmp((const char *)ptr, metric.c_str(),
+                                 NAME_LENGTH) == 0;
+    ptr += NAME_LENGTH;
+    remain -= NAME_LENGTH;
+  }
+  foreach_ht (const ArchiveState &archive, m_archives) {
+    matches = decode_i32(&ptr, &remain) == (uint32_t)archive.spec.consolidation
+      && matches;
+    matches = decode_i32(&ptr, &remain) == archive.spec.steps_per_row
+      && matches;
+    matches = decode_i32(&ptr, &remain) == archive.spec.rows && matches;
+    decode_i32(&ptr, &remain);
+  }
+
+  if (!matches) {
+    HT_WARNF("Time series file %s has a different layout, recreating",
+             m_filename.c_str());
+    return false;
+  }
+
+  m_last_slot = last_slot;
+  foreach_ht (ArchiveState &archive, m_archives) {
+    archive.acc_row = decode_i64(&ptr, &remain);
+    archive.first_row = decode_i64(&ptr, &remain);
+    archive.last_row = decode_i64(&ptr, &remain);
+    for (size_t j=0; j<m_metrics.size(); j++) {
+      archive.acc[j] = decode_value(&ptr, &remain);
+      archive.count[j] = decode_value(&ptr, &remain);
+    }
+  }
+  return true;
+}
+
+
+void TimeSeriesStore::flush_row(int fd, size_t index, int64_t next_row) {
+  ArchiveState &archive = m_archives[index];
+  size_t row_length = 8 * m_metrics.size();
+  int64_t rows = archive.spec.rows;
+  double min_count = archive.spec.steps_per_row * 0.5;
+  vector<uint8_t> buf(row_length);
+  uint8_t *ptr = &buf[0];
+
+  // Consolidated row
+  for (size_t j=0; j<m_metrics.size(); j++) {
+    if (archive.count[j] == 0 || archive.count[j] < min_count)
+      encode_value(&ptr, UNKNOWN);
+    else if (archive.spec.consolidation == MAX)
+      encode_value(&ptr, archive.acc[j]);
+    else
+      encode_value(&ptr, archive.acc[j] / archive.count[j]);
+  }
+  write_fully(fd, &buf[0], row_length,
+              data_offset(index) + (archive.acc_row % rows) * row_length,
+              m_filename);
+
+  // Rows without any samples in between are unknown; a gap of a full ring
+  // also overwrites the row just written, which has dropped out of the ring
+  int64_t gap = std::min(next_row - archive.acc_row - 1, rows);
+  if (gap > 0) {
+    buf.resize(gap * row_length);
+    ptr = &buf[0];
+    for (int64_t i=0; i<gap * (int64_t)m_metrics.size(); i++)
+      encode_value(&ptr, UNKNOWN);
+    int64_t row = next_row - gap;
+    int64_t offset = 0;
+    while (row < next_row) {
+      int64_t position = row % rows;
+      int64_t count = std::min(next_row - row, rows - position);
+      write_fully(fd, &buf[offset], count * row_length,
+                  data_offset(index) + position * row_length, m_filename);
+      offset += count * row_length;
+      row += count;
+    }
+  }
+
+  if (archive.first_row < 0)
+    archive.first_row = archive.acc_row;
+  archive.last_row = std::max(archive.acc_row, next_row - 1);
+}
+
+
+void TimeSeriesStore::write_state(int fd) {
+  vector<uint8_t> buf(8 + state_length() * m_archives.size());
+  uint8_t *ptr = &buf[0];
+
+  encode_i64(&ptr, m_last_slot);
+  foreach_ht (const ArchiveState &archive, m_archives) {
+    encode_i64(&ptr, archive.acc_row);
+    encode_i64(&ptr, archive.first_row);
+    encode_i64(&ptr, archive.last_row);
+    for (size_t j=0; j<m_metrics.size(); j++) {
+      encode_value(&ptr, archive.acc[j]);
+      encode_value(&ptr, archive.count[j]);
+    }
+  }
+
+  // The step number of the last sample ends the fixed header; the archive
+  // states follow the metric names and archive specifications
+  write_fully(fd, &buf[0], 8, HEADER_LENGTH - 8, m_filename);
+  write_fully(fd, &buf[8], buf.size() - 8, state_offset(0), m_filename);
+}
+
+
+size_t TimeSeriesStore::state_length() const {
+  return 24 + 16 * m_metrics.size();
+}
+
+
+size_t TimeSeriesStore::state_offset(size_t index) const {
+  return HEADER_LENGTH + NAME_LENGTH * m_metrics.size() +
+    ARCHIVE_LENGTH * m_archives.size() + index * state_length();
+}
+
+
+size_t TimeSeriesStore::data_offset(size_t index) const {
+  size_t offset = state_offset(m_archives.size());
+  for (size_t i=0; i<index; i++)
+    offset += (size_t)m_archives[i].spec.rows * 8 * m_metrics.size();
+  return offset;
+}
@@ -0,0 +1,178 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for TimeSeriesStore.
+ * This file contains declarations for TimeSeriesStore, an embedded
+ * round-robin time series file used by the Master to persist monitoring
+ * statistics.
+ */
+
+#ifndef HYPERTABLE_TIMESERIESSTORE_H
+#define HYPERTABLE_TIMESERIESSTORE_H
+
+#include <utility>
+#include <vector>
+
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /** @addtogroup Master
+   *  @{
+   */
+
+  /** Round-robin time series file.
+   * Stores a fixed set of gauge metrics sampled every <i>step</i> seconds in
+   * a file of fixed size, in the style of rrdtool.  The file holds a number
+   * of archives, each of which consolidates <i>steps_per_row</i> samples into
+   * one row (average or maximum) and keeps the most recent <i>rows</i> rows
+   * in a ring.  Fine grained archives cover a short period of time, coarse
+   * grained archives a long one.
+   *
+   * Rows are identified by their absolute row number, i.e. time divided by
+   * the archive resolution, so row timestamps need not be stored.  An
+   * archive row is only written when its interval is complete, which makes
+   * an update a handful of small writes at fixed offsets.  A row is unknown
+   * (NaN) if less than half of its samples were received.
+   *
+   * The file is opened for every update and fetch, so any number of stores
+   * can be kept without holding file descriptors.  A store is not thread
+   * safe; callers serialize access.
+   */
+  class TimeSeriesStore : public ReferenceCount {
+  public:
+
+    /// Consolidation function of an archive
+    enum Consolidation {
+      AVERAGE = 0,
+      MAX = 1
+    };
+
+    /** Archive specification. */
+    struct Archive {
+      Archive(Consolidation c, uint32_t spr, uint32_t r)
+        : consolidation(c), steps_per_row(spr), rows(r) { }
+      /// Consolidation function
+      Consolidation consolidation;
+      /// Number of samples consolidated into one row
+      uint32_t steps_per_row;
+      /// Number of rows kept
+      uint32_t rows;
+    };
+
+    /// Fetched data point; timestamp (seconds) of the start of the
+    /// interval and value, NaN if unknown
+    typedef std::pair<uint64_t, double> Point;
+
+    /** Constructor.
+     * Opens <code>filename</code>; the file is created if it does not exist
+     * and recreated if it was created with a different layout.
+     * @param filename Name of the time series file
+     * @param step Sampling interval (seconds)
+     * @param metrics Names of the metrics
+     * @param archives Archives of the file
+     */
+    TimeSeriesStore(const String &filename, uint32_t step,
+                    const std::vector<String> &metrics,
+                    const std::vector<Archive> &archives);
+
+    /** Adds a sample of all metrics.
+     * Samples with a timestamp that falls into the same or an earlier step
+     * than the previous sample are ignored.
+     * @param timestamp Time of the sample (seconds since the epoch)
+     * @param values Value of each metric, NaN if unknown
+     */
+    void update(uint64_t timestamp, const std::vector<double> &values);
+
+    /** Fetches values of a metric.
+     * Picks the finest archive with the given consolidation function that
+     * covers <code>start</code>, or the coarsest one if none does.
+     * @param metric Name of the metric
+     * @param consolidation Consolidation function
+     * @param start Start of the period (seconds since the epoch)
+     * @param end End of the period (seconds since the epoch)
+     * @param points Filled in with the rows of the period, oldest first
+     * @return Resolution of the fetched rows (seconds), 0 if there is no
+     *         such metric or archive
+     */
+    uint32_t fetch(const String &metric, Consolidation consolidation,
+                   uint64_t start, uint64_t end, std::vector<Point> &points);
+
+    /// Returns time of the most recent sample (seconds), 0 if none
+    uint64_t last_update() const { return m_last_slot * m_step; }
+
+    /// Returns name of the time series file
+    const String &filename() const { return m_filename; }
+
+  private:
+
+    /// In-memory state of an archive, mirrored in the file header
+    struct ArchiveState {
+      ArchiveState(const Archive &a) : spec(a), acc_row(-1), first_row(-1),
+                                       last_row(-1) { }
+      Archive spec;
+      /// Absolute number of the row being accumulated, -1 if none
+      int64_t acc_row;
+      /// Absolute number of the oldest row written, -1 if none
+      int64_t first_row;
+      /// Absolute number of the newest row written, -1 if none
+      int64_t last_row;
+      /// Accumulated value per metric (sum or maximum)
+      std::vector<double> acc;
+      /// Number of known samples accumulated per metric
+      std::vector<double> count;
+    };
+
+    void create();
+    bool load();
+    void flush_row(int fd, size_t index, int64_t row);
+    void write_state(int fd);
+    size_t state_offset(size_t index) const;
+    size_t data_offset(size_t index) const;
+    size_t state_length() const;
+
+    /// Name of the time series file
+    String m_filename;
+
+    /// Sampling interval (seconds)
+    uint32_t m_step;
+
+    /// Metric names
+    std::vector<String> m_metrics;
+
+    /// Archives
+    std::vector<ArchiveState> m_archives;
+
+    /// Step number of the most recent sample
+    uint64_t m_last_slot;
+  };
+
+  /// Smart pointer to TimeSeriesStore
+  typedef intrusive_ptr<TimeSeriesStore> TimeSeriesStorePtr;
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_TIMESERIESSTORE_H
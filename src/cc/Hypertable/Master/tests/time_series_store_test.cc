@@ -0,0 +1,130 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include "Hypertable/Master/TimeSeriesStore.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const char *FILENAME = "./time_series_store_test.ts";
+
+  TimeSeriesStorePtr open_store() {
+    vector<String> metrics;
+    metrics.push_back("a");
+    metrics.push_back("b");
+    vector<TimeSeriesStore::Archive> archives;
+    archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 1, 10));
+    archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::AVERAGE, 5, 10));
+    archives.push_back(TimeSeriesStore::Archive(TimeSeriesStore::MAX, 5, 10));
+    return new TimeSeriesStore(FILENAME, 10, metrics, archives);
+  }
+
+  void update(TimeSeriesStore *store, uint64_t timestamp, double a, double b) {
+    vector<double> values;
+    values.push_back(a);
+    values.push_back(b);
+    store->update(timestamp, values);
+  }
+
+}
+
+int main(int argc, char **argv) {
+  vector<TimeSeriesStore::Point> points;
+
+  unlink(FILENAME);
+  TimeSeriesStorePtr store = open_store();
+
+  // 20 samples, one per 10 second step, starting at t=1000
+  for (uint64_t i=0; i<20; i++)
+    update(store.get(), 1000 + i*10, (double)i, 100.0 - i);
+
+  // Samples in the same step are ignored
+  update(store.get(), 1195, 1000.0, 1000.0);
+  HT_ASSERT(store->last_update() == 1190);
+
+  // The fine archive keeps the last 10 complete rows
+  HT_ASSERT(store->fetch("a", TimeSeriesStore::AVERAGE, 1100, 1200, points) == 10);
+  HT_ASSERT(points.size() == 9);
+  HT_ASSERT(points.front().first == 1100 && points.front().second == 10.0);
+  HT_ASSERT(points.back().first == 1180 && points.back().second == 18.0);
+
+  // Periods older than the fine archive come from the coarse one
+  points.clear();
+  HT_ASSERT(store->fetch("b", TimeSeriesStore::AVERAGE, 1000, 1200, points) == 50);
+  HT_ASSERT(points.size() == 3);
+  HT_ASSERT(points[0].first == 1000 && points[0].second == 98.0);
+  HT_ASSERT(points[2].first == 1100 && points[2].second == 88.0);
+
+  points.clear();
+  HT_ASSERT(store->fetch("a", TimeSeriesStore::MAX, 1000, 1200, points) == 50);
+  HT_ASSERT(points.size() == 3);
+  HT_ASSERT(points[1].second == 9.0);
+
+  // Unknown metrics and consolidations yield nothing
+  points.clear();
+  HT_ASSERT(store->fetch("c", TimeSeriesStore::AVERAGE, 0, 2000, points) == 0);
+  HT_ASSERT(points.empty());
+
+  // State survives reopening the file
+  store = open_store();
+  HT_ASSERT(store->last_update() == 1190);
+  update(store.get(), 1200, 20.0, 80.0);
+  update(store.get(), 1210, 21.0, 79.0);
+  points.clear();
+  store->fetch("a", TimeSeriesStore::AVERAGE, 1190, 1200, points);
+  HT_ASSERT(points.size() == 2);
+  HT_ASSERT(points[0].second == 19.0 && points[1].second == 20.0);
+
+  // Rows without samples are unknown
+  update(store.get(), 1250, 25.0, 75.0);
+  update(store.get(), 1260, 26.0, 74.0);
+  points.clear();
+  store->fetch("a", TimeSeriesStore::AVERAGE, 1210, 1250, points);
+  HT_ASSERT(points.size() == 5);
+  HT_ASSERT(points[0].second == 21.0);
+  HT_ASSERT(std::isnan(points[1].second) && std::isnan(points[3].second));
+  HT_ASSERT(points[4].second == 25.0);
+
+  // A gap longer than the ring leaves only unknown rows behind
+  update(store.get(), 1500, 50.0, 50.0);
+  update(store.get(), 1510, 51.0, 49.0);
+  points.clear();
+  store->fetch("a", TimeSeriesStore::AVERAGE, 1410, 1510, points);
+  HT_ASSERT(points.size() == 10);
+  HT_ASSERT(points.front().first == 1410);
+  for (size_t i=0; i<9; i++)
+    HT_ASSERT(std::isnan(points[i].second));
+  HT_ASSERT(points.back().second == 50.0);
+
+  unlink(FILENAME);
+  cout << "SUCCESS" << endl;
+  return 0;
+}
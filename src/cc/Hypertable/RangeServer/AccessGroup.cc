@@ -26,7 +26,7 @@
 #include <Hypertable/RangeServer/CellCacheScanner.h>
 #include <Hypertable/RangeServer/CellStoreFactory.h>
 #include <Hypertable/RangeServer/CellStoreReleaseCallback.h>
-#include <Hypertable/RangeServer/CellStoreV6.h>
+#include <Hypertable/RangeServer/CellStoreV8.h>
 #include <Hypertable/RangeServer/Config.h>
 #include <Hypertable/RangeServer/Global.h>
 #include <Hypertable/RangeServer/MaintenanceFlag.h>
@@ -196,7 +196,7 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context) {
     m_cell_cache_manager->add_scanners(scanner, scan_context);
 
     if (!m_in_memory) {
-      bool bloom_filter_disabled;
+      uint8_t bloom_filter_mode;
 
       for (size_t i=0; i<m_stores.size(); ++i) {
 
@@ -204,14 +204,16 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context) {
             scan_context->time_interval.second < m_stores[i].timestamp_min)
           continue;
 
-        bloom_filter_disabled = boost::any_cast<uint8_t>(m_stores[i].cs->get_trailer()->get("bloom_filter_mode")) == BLOOM_FILTER_DISABLED;
+        bloom_filter_mode = boost::any_cast<uint8_t>(m_stores[i].cs->get_trailer()->get("bloom_filter_mode"));
 
         initial_bytes_read = m_stores[i].cs->bytes_read();
 
         // Query bloomfilter only if it is enabled and a start row has been specified
-        // (ie query is not something like select bar from foo;)
-        if (bloom_filter_disabled ||
-            !scan_context->single_row ||
+        // (ie query is not something like select bar from foo;).  Row prefix
+        // filters can also rule out stores for prefix and row interval scans
+        if (bloom_filter_mode == BLOOM_FILTER_DISABLED ||
+            (!scan_context->single_row &&
+             bloom_filter_mode != BLOOM_FILTER_ROW_PREFIX) ||
             scan_context->start_row == "") {
           if (m_stores[i].shadow_cache) {
             scanner->add_scanner(m_stores[i].shadow_cache->create_scanner(scan_context));
@@ -256,6 +258,113 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context) {
   return scanner;
 }
 
+AccessGroup::RowLookupPtr AccessGroup::create_row_lookup() {
+  RowLookupPtr lookup = new RowLookup(this);
+
+  {
+    ScopedLock lock(m_outstanding_scanner_mutex);
+    m_outstanding_scanner_count++;
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    m_cell_cache_manager->get_caches(lookup->m_active_cache,
+                                     lookup->m_immutable_cache);
+    if (!m_in_memory) {
+      lookup->m_stores.reserve(m_stores.size());
+      foreach_ht (CellStoreInfo &csinfo, m_stores) {
+        RowLookup::Store store;
+        store.cs = csinfo.cs;
+        store.shadow_cache = csinfo.shadow_cache;
+        store.timestamp_min = csinfo.timestamp_min;
+        store.timestamp_max = csinfo.timestamp_max;
+        store.bloom_filter = boost::any_cast<uint8_t>(csinfo.cs->get_trailer()->get("bloom_filter_mode")) != BLOOM_FILTER_DISABLED;
+        store.bloom_filter_accesses = 0;
+        store.bloom_filter_maybes = 0;
+        store.shadow_cache_hits = 0;
+        lookup->m_stores.push_back(store);
+        lookup->m_callback.add_file(csinfo.cs->get_filename());
+      }
+    }
+  }
+
+  m_file_tracker.add_references(lookup->m_callback.get_file_vector());
+
+  return lookup;
+}
+
+
+AccessGroup::RowLookup::~RowLookup() {
+  {
+    ScopedLock lock(m_access_group->m_mutex);
+    foreach_ht (Store &store, m_stores) {
+      foreach_ht (CellStoreInfo &csinfo, m_access_group->m_stores) {
+        if (csinfo.cs.get() == store.cs.get()) {
+          csinfo.bloom_filter_accesses += store.bloom_filter_accesses;
+          csinfo.bloom_filter_maybes += store.bloom_filter_maybes;
+          csinfo.shadow_cache_hits += store.shadow_cache_hits;
+          break;
+        }
+      }
+    }
+  }
+  m_callback();
+}
+
+
+CellListScanner *
+AccessGroup::RowLookup::create_scanner(ScanContextPtr &scan_context) {
+  uint32_t flags = (scan_context->spec && scan_context->spec->return_deletes) ?
+    MergeScanner::RETURN_DELETES : 0;
+  MergeScanner *scanner =
+    new MergeScannerAccessGroup(m_access_group->m_table_name, scan_context,
+                                flags | MergeScanner::ACCUMULATE_COUNTERS);
+
+  try {
+    uint64_t initial_bytes_read;
+
+    if (!m_active_cache->empty())
+      scanner->add_scanner(m_active_cache->create_scanner(scan_context));
+    if (m_immutable_cache)
+      scanner->add_scanner(m_immutable_cache->create_scanner(scan_context));
+
+    foreach_ht (Store &store, m_stores) {
+
+      if (scan_context->time_interval.first > store.timestamp_max ||
+          scan_context->time_interval.second < store.timestamp_min)
+        continue;
+
+      if (store.bloom_filter && scan_context->single_row &&
+          scan_context->start_row != "") {
+        store.bloom_filter_accesses++;
+        if (!store.cs->may_contain(scan_context))
+          continue;
+        store.bloom_filter_maybes++;
+      }
+
+      initial_bytes_read = store.cs->bytes_read();
+
+      if (store.shadow_cache) {
+        scanner->add_scanner(store.shadow_cache->create_scanner(scan_context));
+        store.shadow_cache_hits++;
+      }
+      else
+        scanner->add_scanner(store.cs->create_scanner(scan_context));
+
+      if (store.cs->bytes_read() > initial_bytes_read)
+        scanner->add_disk_read(store.cs->bytes_read() - initial_bytes_read);
+    }
+  }
+  catch (Exception &e) {
+    delete scanner;
+    HT_THROW2F(e.code(), e, "Problem creating row scanner on access group %s",
+               m_access_group->m_full_name.c_str());
+  }
+
+  return scanner;
+}
+
+
 bool AccessGroup::include_in_scan(ScanContextPtr &scan_context) {
   ScopedLock lock(m_schema_mutex);
   for (std::set<uint8_t>::iterator iter = m_column_families.begin();
@@ -596,7 +705,7 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
         }
       }
 
-      cellstore = new CellStoreV6(Global::dfs.get(), m_schema.get());
+      cellstore = new CellStoreV8(Global::dfs.get(), m_schema.get());
 
       max_num_entries = m_cell_cache_manager->immutable_items();
 
@@ -659,16 +768,16 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
 
     m_garbage_tracker.adjust_targets(now, mscanner);
 
-    CellStoreTrailerV6 *trailer = dynamic_cast<CellStoreTrailerV6 *>(cellstore->get_trailer());
+    CellStoreTrailerV8 *trailer = dynamic_cast<CellStoreTrailerV8 *>(cellstore->get_trailer());
 
     if (major)
       HT_ASSERT(mscanner);
 
     if (major)
-      trailer->flags |= CellStoreTrailerV6::MAJOR_COMPACTION;
+      trailer->flags |= CellStoreTrailerV8::MAJOR_COMPACTION;
 
     if (maintenance_flags & MaintenanceFlag::SPLIT)
-      trailer->flags |= CellStoreTrailerV6::SPLIT;
+      trailer->flags |= CellStoreTrailerV8::SPLIT;
 
     cellstore->finalize(&m_identifier);
 
@@ -959,6 +1068,7 @@ AccessGroup::shrink(String &split_row, bool drop_high, Hints *hints) {
     hints->latest_stored_revision = m_latest_stored_revision;
     hints->disk_usage = m_disk_usage;
     m_garbage_tracker.update_cellstore_info(m_stores);
+    get_merge_info(m_needs_merging, m_end_merge);
 
     m_earliest_cached_revision_saved = TIMESTAMP_MAX;
 
@@ -1100,7 +1210,29 @@ bool AccessGroup::find_merge_run(size_t *indexp, size_t *lenp) {
   size_t count;
   int64_t running_total = 0;
 
-  if (m_in_memory || m_stores.size() <= 1)
+  if (m_in_memory || m_stores.empty())
+    return false;
+
+  // Stores still shared with a sibling range after a copy-free split cover
+  // only part of their file; merge everything up to the newest of them so
+  // the out-of-range data gets dropped and the files can be released
+  if (Global::copy_free_split) {
+    size_t shared_end = 0;
+    for (i=0; i<m_stores.size(); i++) {
+      if (m_stores[i].cs->fraction_covered() < 1.0)
+        shared_end = i + 1;
+    }
+    if (shared_end) {
+      if (indexp)
+        *indexp = 0;
+      if (lenp)
+        *lenp = shared_end;
+      return true;
+    }
+    i = 0;
+  }
+
+  if (m_stores.size() <= 1)
     return false;
 
   std::vector<int64_t> disk_usage(m_stores.size());
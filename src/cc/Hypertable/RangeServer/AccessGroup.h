@@ -26,6 +26,7 @@
 #include <Hypertable/RangeServer/CellCacheManager.h>
 #include <Hypertable/RangeServer/CellStore.h>
 #include <Hypertable/RangeServer/CellStoreInfo.h>
+#include <Hypertable/RangeServer/CellStoreReleaseCallback.h>
 #include <Hypertable/RangeServer/CellStoreTrailerV6.h>
 #include <Hypertable/RangeServer/LiveFileTracker.h>
 #include <Hypertable/RangeServer/MaintenanceFlag.h>
@@ -156,6 +157,76 @@ namespace Hypertable {
 
     CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
 
+    /** Access group state pinned for a batch of single row lookups.
+     * A multi get request creates one with create_row_lookup() for the
+     * whole batch of keys, so the access group lock is taken and the cell
+     * store trailers are read once per batch instead of once per key.  The
+     * caches and cell stores in place at creation stay referenced, and the
+     * cell store files protected from garbage collection, until the object
+     * is destroyed.
+     */
+    class RowLookup : public ReferenceCount {
+    public:
+
+      /// Destructor.
+      /// Adds the bloom filter and shadow cache counts to the access group
+      /// and releases the cell store files.
+      ~RowLookup();
+
+      /** Creates a scanner for one row.
+       * The scanner reads the caches and those cell stores whose time range
+       * overlaps the scan and whose bloom filter may contain the row of
+       * <code>scan_ctx</code>.  Each cell store is read through its block
+       * index, starting at the block that may contain the row.
+       * @param scan_ctx Single row scan context
+       * @return Merge scanner over the selected caches and cell stores
+       */
+      CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
+
+      /// Access group the lookup was created on
+      AccessGroup *access_group() { return m_access_group; }
+
+    private:
+      friend class AccessGroup;
+
+      RowLookup(AccessGroup *ag) : m_access_group(ag), m_callback(ag) { }
+
+      /// Cell store of the batch
+      struct Store {
+        CellStorePtr cs;
+        CellCachePtr shadow_cache;
+        int64_t timestamp_min;
+        int64_t timestamp_max;
+        bool bloom_filter;
+        uint32_t bloom_filter_accesses;
+        uint32_t bloom_filter_maybes;
+        uint32_t shadow_cache_hits;
+      };
+
+      /// Access group
+      AccessGroup *m_access_group;
+
+      /// Active cache at creation
+      CellCachePtr m_active_cache;
+
+      /// Immutable cache at creation, 0 if none
+      CellCachePtr m_immutable_cache;
+
+      /// Cell stores at creation, empty for in memory access groups
+      std::vector<Store> m_stores;
+
+      /// Releases the cell store files on destruction
+      CellStoreReleaseCallback m_callback;
+    };
+
+    /// Smart pointer to RowLookup
+    typedef intrusive_ptr<RowLookup> RowLookupPtr;
+
+    /** Pins the caches and cell stores for a batch of row lookups.
+     * @return Row lookup object for the batch
+     */
+    RowLookupPtr create_row_lookup();
+
     bool include_in_scan(ScanContextPtr &scan_ctx);
     uint64_t disk_usage();
     uint64_t memory_usage();
@@ -123,6 +123,14 @@ namespace Hypertable {
     /// @param scan_ctx Scan context for initializing scanners
     void add_scanners(MergeScanner *scanner, ScanContextPtr &scan_context);
 
+    /// Gets the active and immutable caches.
+    /// @param active Set to #m_active_cache
+    /// @param immutable Set to #m_immutable_cache, 0 if none is installed
+    void get_caches(CellCachePtr &active, CellCachePtr &immutable) {
+      active = m_active_cache;
+      immutable = m_immutable_cache;
+    }
+
     /// Populates map of split row data.
     /// This method calls CellCache::split_row_estimate_data() on both the
     /// active and immutable caches to add data to <code>split_row_data</code>.
@@ -159,6 +159,19 @@ namespace Hypertable {
      */
     virtual bool may_contain(ScanContextPtr &scan_ctx) = 0;
 
+    /**
+     * Block zone map lookup.  Cell stores that record per-block timestamp
+     * ranges and column family sets return <i>false</i> for blocks that
+     * cannot hold any cell selected by <code>scan_ctx</code>, allowing the
+     * interval scanners to skip reading and inflating them.
+     * @param offset File offset of block
+     * @param scan_ctx Scan context
+     * @return <i>false</i> if block can be skipped, <i>true</i> otherwise
+     */
+    virtual bool block_may_contain(int64_t offset, ScanContextPtr &scan_ctx) {
+      return true;
+    }
+
     /**
      * Returns the disk used by this cell store.  If the cell store is opened
      * with a restricted range, then it returns an estimate of the disk used by
@@ -168,6 +181,16 @@ namespace Hypertable {
      */
     virtual uint64_t disk_usage() = 0;
 
+    /**
+     * Returns the fraction of this cell store's blocks that lie within the
+     * (possibly restricted) range with which it was opened.  A value below
+     * 1.0 means the file is shared with another range, e.g. after a
+     * copy-free split.
+     *
+     * @return fraction of blocks covered
+     */
+    virtual double fraction_covered() { return 1.0; }
+
     /**
      * Returns the number of CellStore blocks covered by this object.
      * @return block count
@@ -324,6 +347,7 @@ namespace Hypertable {
     static const char DATA_BLOCK_MAGIC[10];
     static const char INDEX_FIXED_BLOCK_MAGIC[10];
     static const char INDEX_VARIABLE_BLOCK_MAGIC[10];
+    static const char ZONE_MAP_BLOCK_MAGIC[10];
 
   protected:
 
@@ -28,6 +28,8 @@
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Global.h"
 #include "CellStoreBlockIndexArray.h"
+#include "KeyDecompressorNone.h"
+#include "LatencyMetrics.h"
 
 #include "CellStoreScannerIntervalBlockIndex.h"
 
@@ -38,13 +40,15 @@ template <typename IndexT>
 CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(CellStore *cellstore,
   IndexT *index, SerializedKey start_key, SerializedKey end_key, ScanContextPtr &scan_ctx) :
   m_cellstore(cellstore), m_index(index), m_start_key(start_key),
-  m_end_key(end_key), m_fd(-1), m_cached(false), m_check_for_range_end(false),
+  m_end_key(end_key), m_fd(-1), m_cached(false), m_decoded(false), m_check_for_range_end(false),
   m_scan_ctx(scan_ctx), m_rowset(scan_ctx->rowset) {
 
   memset(&m_block, 0, sizeof(m_block));
   m_file_id = m_cellstore->get_file_id();
   m_zcodec = m_cellstore->create_block_compression_codec();
   m_key_decompressor = m_cellstore->create_key_decompressor();
+  m_entry_decompressor = new KeyDecompressorNone();
+  m_decompressor = m_key_decompressor;
 
   m_end_row = (m_end_key) ? m_end_key.row() : Key::END_ROW_MARKER;
   m_fd = m_cellstore->get_fd();
@@ -59,7 +63,28 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
 
   if (m_start_key) {
     const uint8_t *ptr;
-    while (m_key_decompressor->less_than(m_start_key)) {
+
+    // Decoded blocks can be searched directly for the start key
+    if (m_decoded && m_decompressor->less_than(m_start_key)) {
+      ptr = m_decoded_block.lower_bound(m_start_key);
+      if (ptr >= m_block.end) {
+        if (!fetch_next_block(true)) {
+          m_iter = m_index->end();
+          return;
+        }
+      }
+      else
+        m_cur_value.ptr = m_decompressor->add(ptr);
+    }
+    // Blocks with restart points are searched from the closest one
+    else if (!m_decoded && m_decompressor->less_than(m_start_key) &&
+             (ptr = m_decompressor->seek(m_start_key)) != 0 &&
+             ptr > m_block.base) {
+      m_decompressor->reset();
+      m_cur_value.ptr = m_decompressor->add(ptr);
+    }
+
+    while (m_decompressor->less_than(m_start_key)) {
       ptr = m_cur_value.ptr + m_cur_value.length();
       if (ptr >= m_block.end) {
         if (!fetch_next_block(true)) {
@@ -68,14 +93,14 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
         }
       }
       else
-        m_cur_value.ptr = m_key_decompressor->add(ptr);
+        m_cur_value.ptr = m_decompressor->add(ptr);
     }
   }
 
   /**
    * End of range check
    */
-  if (m_end_key && !m_key_decompressor->less_than(m_end_key)) {
+  if (m_end_key && !m_decompressor->less_than(m_end_key)) {
     m_iter = m_index->end();
     return;
   }
@@ -83,7 +108,7 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
   /**
    * Column family check
    */
-  m_key_decompressor->load(m_key);
+  m_decompressor->load(m_key);
   if (m_key.flag != FLAG_DELETE_ROW &&
       !m_scan_ctx->family_mask[m_key.column_family_code])
     forward();
@@ -93,14 +118,11 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
 
 template <typename IndexT>
 CellStoreScannerIntervalBlockIndex<IndexT>::~CellStoreScannerIntervalBlockIndex() {
-  if (m_block.base != 0) {
-    if (m_cached)
-      Global::block_cache->checkin(m_file_id, m_block.offset);
-    else
-      delete [] m_block.base;
-  }
+  if (m_block.base != 0)
+    release_block();
   delete m_zcodec;
   delete m_key_decompressor;
+  delete m_entry_decompressor;
 }
 
 template <typename IndexT>
@@ -133,14 +155,14 @@ void CellStoreScannerIntervalBlockIndex<IndexT>::forward() {
         m_iter = m_index->end();
         return;
       }
-      if (m_check_for_range_end && !m_key_decompressor->less_than(m_end_key)) {
+      if (m_check_for_range_end && !m_decompressor->less_than(m_end_key)) {
         m_iter = m_index->end();
         return;
       }
     }
     else {
-      m_cur_value.ptr = m_key_decompressor->add(ptr);
-      if (m_check_for_range_end && !m_key_decompressor->less_than(m_end_key)) {
+      m_cur_value.ptr = m_decompressor->add(ptr);
+      if (m_check_for_range_end && !m_decompressor->less_than(m_end_key)) {
         m_iter = m_index->end();
         return;
       }
@@ -149,7 +171,7 @@ void CellStoreScannerIntervalBlockIndex<IndexT>::forward() {
     /**
      * Column family check
      */
-    m_key_decompressor->load(m_key);
+    m_decompressor->load(m_key);
     if (m_key.flag == FLAG_DELETE_ROW
         || m_scan_ctx->family_mask[m_key.column_family_code])
       // forward to next row requested by scan and filter rows
@@ -177,10 +199,7 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 
   // If we're at the end of the current block, deallocate and move to next
   if (m_block.base != 0 && eob) {
-    if (m_cached)
-      Global::block_cache->checkin(m_file_id, m_block.offset);
-    else
-      delete [] m_block.base;
+    release_block();
     memset(&m_block, 0, sizeof(m_block));
     ++m_iter;
 
@@ -191,6 +210,20 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
     }
   }
 
+  // skip blocks that the zone map rules out for this scan
+  while (m_block.base == 0 && m_iter != m_index->end() &&
+         !m_cellstore->block_may_contain(m_iter.value(), m_scan_ctx)) {
+    if (strcmp(m_iter.key().row(), m_end_row) > 0) {
+      m_iter = m_index->end();
+      break;
+    }
+    ++m_iter;
+    if (m_rowset.size()) {
+      while (m_iter != m_index->end() && strcmp(*m_rowset.begin(), m_iter.key().row()) > 0)
+        ++m_iter;
+    }
+  }
+
   if (m_block.base == 0 && m_iter != m_index->end()) {
     DynamicBuffer expand_buf;
     uint32_t len;
@@ -210,12 +243,24 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
       m_block.zlength = it_next.value() - m_block.offset;
     }
 
+    /**
+     * Decoded block cache lookup
+     */
+    m_decoded = Global::block_cache && Global::block_cache->decoded() &&
+      Global::block_cache->checkout(m_file_id,
+                                    FileBlockCache::decoded_offset(m_block.offset),
+                                    (uint8_t **)&m_block.base, &len);
+
     /**
      * Cache lookup / block read
      */
-    if (Global::block_cache == 0 || Global::block_cache->compressed() ||
-        !Global::block_cache->checkout(m_file_id, m_block.offset,
-				       (uint8_t **)&m_block.base, &len)) {
+    if (m_decoded)
+      m_cached = true;
+    else if (Global::block_cache == 0 || Global::block_cache->compressed() ||
+             Global::block_cache->decoded() ||
+             !Global::block_cache->checkout(m_file_id, m_block.offset,
+                                            (uint8_t **)&m_block.base, &len)) {
+      LatencyMetrics::Timer miss_timer(LatencyMetrics::BLOCK_CACHE_MISS);
       bool second_try = false;
       bool checked_out = false;
     try_again:
@@ -228,7 +273,10 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 	  buf.grow(m_block.zlength, true);
 
 	  /** Read compressed block **/
-	  Global::dfs->pread(m_fd, buf.base, m_block.zlength, m_block.offset, second_try);
+	  {
+	    LatencyMetrics::Timer read_timer(LatencyMetrics::BLOCK_READ);
+	    Global::dfs->pread(m_fd, buf.base, m_block.zlength, m_block.offset, second_try);
+	  }
 
 	  checked_out = false;
 	}
@@ -244,7 +292,10 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
         /** inflate compressed block **/
         BlockCompressionHeader header;
 
-        m_zcodec->inflate(buf, expand_buf, header);
+        {
+          LatencyMetrics::Timer inflate_timer(LatencyMetrics::BLOCK_DECOMPRESS);
+          m_zcodec->inflate(buf, expand_buf, header);
+        }
 
         if (!checked_out)
           m_disk_read += expand_buf.fill();
@@ -284,21 +335,59 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 
       /** Insert uncompressed block into cache  **/
       m_cached = Global::block_cache && !Global::block_cache->compressed() &&
+          !Global::block_cache->decoded() &&
           Global::block_cache->insert(m_file_id, m_block.offset,
 				      (uint8_t *)m_block.base, len, true);
+
+      /** Decode block and insert it into cache in place of the raw block **/
+      if (Global::block_cache && Global::block_cache->decoded()) {
+        uint32_t decoded_len;
+        uint8_t *decoded = DecodedBlock::encode(m_key_decompressor, m_block.base,
+                                                m_block.base + len, &decoded_len);
+        if (Global::block_cache->insert(m_file_id,
+                                        FileBlockCache::decoded_offset(m_block.offset),
+                                        decoded, decoded_len, true)) {
+          delete [] m_block.base;
+          m_block.base = decoded;
+          len = decoded_len;
+          m_cached = m_decoded = true;
+        }
+        else
+          delete [] decoded;
+      }
     }
     else
       m_cached = true;
 
-    m_key_decompressor->reset();
-    m_block.end = m_block.base + len;
-    m_cur_value.ptr = m_key_decompressor->add(m_block.base);
+    if (m_decoded) {
+      m_decoded_block.load(m_block.base, len);
+      m_block.end = m_decoded_block.end();
+      m_decompressor = m_entry_decompressor;
+    }
+    else {
+      m_block.end = m_key_decompressor->load_block(m_block.base,
+                                                   m_block.base + len);
+      m_decompressor = m_key_decompressor;
+    }
+    m_decompressor->reset();
+    m_cur_value.ptr = m_decompressor->add(m_block.base);
 
     return true;
   }
   return false;
 }
 
+
+template <typename IndexT>
+void CellStoreScannerIntervalBlockIndex<IndexT>::release_block() {
+  if (m_cached)
+    Global::block_cache->checkin(m_file_id, m_decoded ?
+                                 FileBlockCache::decoded_offset(m_block.offset) :
+                                 m_block.offset);
+  else
+    delete [] m_block.base;
+}
+
 namespace Hypertable {
   template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<uint32_t> >;
   template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<int64_t> >;
@@ -26,6 +26,7 @@
 
 #include "CellStore.h"
 #include "CellStoreScannerInterval.h"
+#include "DecodedBlock.h"
 #include "ScanContext.h"
 
 namespace Hypertable {
@@ -48,6 +49,7 @@ namespace Hypertable {
   private:
 
     bool fetch_next_block(bool eob=false);
+    void release_block();
 
     CellStorePtr          m_cellstore;
     IndexT               *m_index;
@@ -62,8 +64,12 @@ namespace Hypertable {
     DynamicBuffer         m_key_buf;
     BlockCompressionCodec *m_zcodec;
     KeyDecompressor      *m_key_decompressor;
+    KeyDecompressor      *m_entry_decompressor;
+    KeyDecompressor      *m_decompressor;
+    DecodedBlock          m_decoded_block;
     int32_t               m_fd;
     bool                  m_cached;
+    bool                  m_decoded;
     bool                  m_check_for_range_end;
     int                   m_file_id;
     ScanContextPtr        m_scan_ctx;
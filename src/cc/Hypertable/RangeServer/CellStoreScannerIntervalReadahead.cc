@@ -29,6 +29,7 @@
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Global.h"
 #include "CellStoreBlockIndexArray.h"
+#include "LatencyMetrics.h"
 
 #include "CellStoreScannerIntervalReadahead.h"
 
@@ -109,6 +110,15 @@ CellStoreScannerIntervalReadahead<IndexT>::CellStoreScannerIntervalReadahead(Cel
 
   if (start_key) {
     const uint8_t *ptr;
+
+    // Blocks with restart points are searched from the closest one
+    if (m_key_decompressor->less_than(start_key) &&
+        (ptr = m_key_decompressor->seek(start_key)) != 0 &&
+        ptr > m_block.base) {
+      m_key_decompressor->reset();
+      m_cur_value.ptr = m_key_decompressor->add(ptr);
+    }
+
     while (m_key_decompressor->less_than(start_key)) {
       ptr = m_cur_value.ptr + m_cur_value.length();
       if (ptr >= m_block.end) {
@@ -241,7 +251,7 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
   if (m_offset >= m_end_offset)
     m_eos = true;
 
-  if (m_block.base == 0 && !m_eos) {
+  while (m_block.base == 0 && !m_eos) {
     DynamicBuffer expand_buf(0);
     uint32_t len;
     uint32_t nread;
@@ -252,6 +262,7 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
     try {
       BlockCompressionHeader header;
       DynamicBuffer input_buf( header.length() );
+      int64_t read_start = get_ts64();
 
       nread = Global::dfs->read(m_fd, input_buf.base, header.length() );
       HT_EXPECT(nread == header.length(), Error::RANGESERVER_SHORT_CELLSTORE_READ);
@@ -270,12 +281,24 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
       nread = Global::dfs->read(m_fd, input_buf.ptr,  header.get_data_zlength()+extra);
       HT_EXPECT(nread == header.get_data_zlength()+extra, Error::RANGESERVER_SHORT_CELLSTORE_READ);
       input_buf.ptr += header.get_data_zlength() + extra;
+      LatencyMetrics::record(LatencyMetrics::BLOCK_READ, read_start,
+                             LatencyMetrics::current_trace());
 
       if (m_offset + (int64_t)input_buf.fill() >= m_end_offset && m_end_key)
         m_check_for_range_end = true;
       m_offset += input_buf.fill();
 
-      m_zcodec->inflate(input_buf, expand_buf, header);
+      // skip inflating blocks that the zone map rules out for this scan
+      if (!m_cellstore->block_may_contain(m_block.offset, m_scan_ctx)) {
+        if (m_offset >= m_end_offset)
+          m_eos = true;
+        continue;
+      }
+
+      {
+        LatencyMetrics::Timer inflate_timer(LatencyMetrics::BLOCK_DECOMPRESS);
+        m_zcodec->inflate(input_buf, expand_buf, header);
+      }
 
       m_disk_read += expand_buf.fill();
 
@@ -296,7 +319,8 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
     len = fill;
 
     m_key_decompressor->reset();
-    m_block.end = m_block.base + len;
+    m_block.end = m_key_decompressor->load_block(m_block.base,
+                                                 m_block.base + len);
     m_cur_value.ptr = m_key_decompressor->add(m_block.base);
 
     return true;
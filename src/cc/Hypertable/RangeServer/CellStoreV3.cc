@@ -705,6 +705,8 @@ void CellStoreV3::load_block_index() {
 
   HT_ASSERT(m_index_stats.block_index_memory == 0);
 
+  Global::block_index_loads++;
+
   if (m_compressor == 0)
     m_compressor = create_block_compression_codec();
 
@@ -876,6 +876,8 @@ void CellStoreV5::load_block_index() {
 
   HT_ASSERT(m_index_stats.block_index_memory == 0);
 
+  Global::block_index_loads++;
+
   compressor = create_block_compression_codec();
 
   amount = index_amount = m_trailer.filter_offset - m_trailer.fix_index_offset;
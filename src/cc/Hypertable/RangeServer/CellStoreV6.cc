@@ -68,10 +68,12 @@ CellStoreV6::CellStoreV6(Filesystem *filesys, Schema *schema)
   : m_filesys(filesys), m_schema(schema), m_fd(-1), m_filename(),
     m_64bit_index(false), m_compressor(0), m_buffer(0),
     m_outstanding_appends(0), m_offset(0), m_file_length(0),
-    m_disk_usage(0), m_file_id(0), m_uncompressed_blocksize(0),
+    m_disk_usage(0), m_fraction_covered(1.0), m_file_id(0),
+    m_uncompressed_blocksize(0),
     m_bloom_filter_mode(BLOOM_FILTER_DISABLED), m_bloom_filter_items(0),
     m_filter_false_positive_prob(0.0), m_restricted_range(false),
-    m_column_ttl(0), m_replaced_files_loaded(false), m_bloom_filter(0) {
+    m_column_ttl(0), m_replaced_files_loaded(false),
+    m_bloom_filter_access_counter(0), m_bloom_filter(0) {
   m_file_id = FileBlockCache::get_next_file_id();
   assert(sizeof(float) == 4);
 }
@@ -80,7 +82,7 @@ CellStoreV6::CellStoreV6(Filesystem *filesys, Schema *schema)
 CellStoreV6::~CellStoreV6() {
   try {
     delete m_compressor;
-    delete m_bloom_filter;
+    delete m_bloom_filter.load();
     delete m_bloom_filter_items;
     if (m_fd != -1)
       m_filesys->close(m_fd);
@@ -271,6 +273,8 @@ CellStoreV6::create(const char *fname, size_t max_entries,
 
 
 void CellStoreV6::create_bloom_filter(bool is_approx) {
+  BloomFilterWithChecksum *bloom_filter = 0;
+
   assert(!m_bloom_filter && m_bloom_filter_items);
 
   HT_DEBUG_OUT << "Creating new BloomFilter for CellStore '"
@@ -278,12 +282,12 @@ void CellStoreV6::create_bloom_filter(bool is_approx) {
     << m_trailer.filter_items_estimate << " items"<< HT_END;
   try {
     if (m_filter_false_positive_prob != 0.0)
-      m_bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_estimate,
-                                                   m_filter_false_positive_prob);
+      bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_estimate,
+                                                 m_filter_false_positive_prob);
     else
-      m_bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_estimate,
-                                                   m_bloom_bits_per_item,
-                                                   m_trailer.bloom_filter_hash_count);
+      bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_estimate,
+                                                 m_bloom_bits_per_item,
+                                                 m_trailer.bloom_filter_hash_count);
   }
   catch(Exception &e) {
     HT_FATAL_OUT << "Error creating new BloomFilter for CellStore '"
@@ -292,10 +296,11 @@ void CellStoreV6::create_bloom_filter(bool is_approx) {
   }
 
   foreach_ht(const Blob &blob, *m_bloom_filter_items)
-    m_bloom_filter->insert(blob.start, blob.size);
+    bloom_filter->insert(blob.start, blob.size);
 
   delete m_bloom_filter_items;
   m_bloom_filter_items = 0;
+  m_bloom_filter = bloom_filter;
 
   HT_DEBUG_OUT << "Created new BloomFilter for CellStore '"
     << m_filename <<"'"<< HT_END;
@@ -356,6 +361,7 @@ void CellStoreV6::load_replaced_files() {
 }
 
 void CellStoreV6::load_bloom_filter() {
+  BloomFilterWithChecksum *bloom_filter = 0;
   size_t len;
 
   HT_ASSERT(m_index_stats.bloom_filter_memory == 0);
@@ -364,10 +370,10 @@ void CellStoreV6::load_bloom_filter() {
                << m_filename <<"' with "<< m_trailer.filter_items_estimate
                << " items"<< HT_END;
   try {
-    m_bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_actual,
-                                                 m_trailer.filter_items_actual,
-                                                 m_trailer.filter_length,
-                                                 m_trailer.bloom_filter_hash_count);
+    bloom_filter = new BloomFilterWithChecksum(m_trailer.filter_items_actual,
+                                               m_trailer.filter_items_actual,
+                                               m_trailer.filter_length,
+                                               m_trailer.bloom_filter_hash_count);
   }
   catch(Exception &e) {
     HT_FATAL_OUT << "Error loading BloomFilter for CellStore '"
@@ -375,39 +381,48 @@ void CellStoreV6::load_bloom_filter() {
                  << " items -"<< e << HT_END;
   }
 
-  if (m_bloom_filter->total_size() > 0) {
+  try {
+    if (bloom_filter->total_size() > 0) {
 
-    bool second_try = false;
+      bool second_try = false;
 
-    while (true) {
-      try {
-	len = m_filesys->pread(m_fd, m_bloom_filter->base(), m_bloom_filter->total_size(),
-			       m_trailer.filter_offset, second_try);
-      }
-      catch (Exception &e) {
-	if (!second_try) {
-	  second_try=true;
-	  continue;
-	}
-	HT_THROW2(e.code(), e, format("Error loading BloomFilter for CellStore '%s'",
-				      m_filename.c_str()));
+      while (true) {
+        try {
+          len = m_filesys->pread(m_fd, bloom_filter->base(), bloom_filter->total_size(),
+                                 m_trailer.filter_offset, second_try);
+        }
+        catch (Exception &e) {
+          if (!second_try) {
+            second_try=true;
+            continue;
+          }
+          HT_THROW2(e.code(), e, format("Error loading BloomFilter for CellStore '%s'",
+                                        m_filename.c_str()));
+        }
+        break;
       }
-      break;
-    }
 
-    if (len != m_bloom_filter->total_size())
-      HT_THROWF(Error::DFSBROKER_IO_ERROR, "Problem loading bloomfilter for"
-                "CellStore '%s' : tried to read %lld but only got %lld",
-                m_filename.c_str(), (Lld)m_bloom_filter->total_size(), (Lld)len);
+      if (len != bloom_filter->total_size())
+        HT_THROWF(Error::DFSBROKER_IO_ERROR, "Problem loading bloomfilter for"
+                  "CellStore '%s' : tried to read %lld but only got %lld",
+                  m_filename.c_str(), (Lld)bloom_filter->total_size(), (Lld)len);
 
-    m_bytes_read += len;
+      m_bytes_read += len;
 
-    m_bloom_filter->validate(m_filename);
+      bloom_filter->validate(m_filename);
+    }
+  }
+  catch (...) {
+    delete bloom_filter;
+    throw;
   }
 
-  m_index_stats.bloom_filter_memory = sizeof(BloomFilterWithChecksum) + m_bloom_filter->total_size();
+  m_index_stats.bloom_filter_memory = sizeof(BloomFilterWithChecksum) + bloom_filter->total_size();
   Global::memory_tracker->add(m_index_stats.bloom_filter_memory);
 
+  // publish to lock-free readers in may_contain()
+  m_bloom_filter = bloom_filter;
+
 }
 
 
@@ -420,8 +435,10 @@ uint64_t CellStoreV6::purge_indexes() {
 
     if (m_index_stats.bloom_filter_memory > 0) {
       memory_purged = m_index_stats.bloom_filter_memory;
-      delete m_bloom_filter;
-      m_bloom_filter = 0;
+      // Unpublish, then wait for readers that may still be probing it
+      BloomFilterWithChecksum *bloom_filter = m_bloom_filter.exchange(0);
+      m_bloom_filter_readers.synchronize();
+      delete bloom_filter;
       m_index_stats.bloom_filter_memory = 0;
     }
 
@@ -540,12 +557,13 @@ void CellStoreV6::add(const Key &key, const ByteString value) {
       }
     }
     else {
-      assert(!m_bloom_filter_items && m_bloom_filter);
+      BloomFilterWithChecksum *bloom_filter = m_bloom_filter.load();
+      assert(!m_bloom_filter_items && bloom_filter);
 
-      m_bloom_filter->insert(key.row);
+      bloom_filter->insert(key.row);
 
       if (m_bloom_filter_mode == BLOOM_FILTER_ROWS_COLS)
-        m_bloom_filter->insert(key.row, key.row_len + 2);
+        bloom_filter->insert(key.row, key.row_len + 2);
     }
   }
 
@@ -665,15 +683,16 @@ void CellStoreV6::finalize(TableIdentifier *table_identifier) {
       create_bloom_filter();
     }
 
-    if (m_bloom_filter) {
-      m_trailer.filter_length = m_bloom_filter->get_length_bits();
-      m_trailer.filter_items_actual = m_bloom_filter->get_items_actual();
+    BloomFilterWithChecksum *bloom_filter = m_bloom_filter.load();
+    if (bloom_filter) {
+      m_trailer.filter_length = bloom_filter->get_length_bits();
+      m_trailer.filter_items_actual = bloom_filter->get_items_actual();
       m_trailer.bloom_filter_mode = m_bloom_filter_mode;
-      m_trailer.bloom_filter_hash_count = m_bloom_filter->get_num_hashes();
-      m_bloom_filter->serialize(send_buf);
+      m_trailer.bloom_filter_hash_count = bloom_filter->get_num_hashes();
+      bloom_filter->serialize(send_buf);
       m_filesys->append(m_fd, send_buf, 0, &m_sync_handler);
       m_outstanding_appends++;
-      m_offset += m_bloom_filter->total_size();
+      m_offset += bloom_filter->total_size();
     }
   }
 
@@ -788,6 +807,7 @@ void CellStoreV6::finalize(TableIdentifier *table_identifier) {
 
   m_disk_usage +=
     (int64_t)((double)(m_offset-m_trailer.fix_index_offset) * fraction_covered);
+  m_fraction_covered = fraction_covered;
 
   /** Re-open file for reading **/
   m_fd = m_filesys->open(m_filename, Filesystem::OPEN_FLAG_DIRECTIO);
@@ -795,7 +815,7 @@ void CellStoreV6::finalize(TableIdentifier *table_identifier) {
   m_index_stats.block_index_memory = index_memory;
 
   if (m_bloom_filter)
-    m_index_stats.bloom_filter_memory = sizeof(BloomFilterWithChecksum) + m_bloom_filter->total_size();
+    m_index_stats.bloom_filter_memory = sizeof(BloomFilterWithChecksum) + m_bloom_filter.load()->total_size();
 
   delete [] m_column_ttl;
   m_column_ttl = 0;
@@ -914,6 +934,7 @@ CellStoreV6::rescope(const String &start_row, const String &end_row) {
       m_disk_usage = m_index_map64.disk_used() + 
         (int64_t)((double)(m_file_length-m_trailer.fix_index_offset) *
 		  m_index_map64.fraction_covered());
+      m_fraction_covered = m_index_map64.fraction_covered();
       m_block_count = m_index_map64.index_entries();
     }
     else {
@@ -922,6 +943,7 @@ CellStoreV6::rescope(const String &start_row, const String &end_row) {
       m_disk_usage = m_index_map32.disk_used() + 
         (int64_t)((double)(m_file_length-m_trailer.fix_index_offset) *
 		  m_index_map32.fraction_covered());
+      m_fraction_covered = m_index_map32.fraction_covered();
       m_block_count = m_index_map32.index_entries();
     }
     Global::memory_tracker->add( m_index_stats.block_index_memory );
@@ -943,6 +965,8 @@ void CellStoreV6::load_block_index() {
 
   HT_ASSERT(m_index_stats.block_index_memory == 0);
 
+  Global::block_index_loads++;
+
   compressor = create_block_compression_codec();
 
   amount = index_amount = m_trailer.filter_offset - m_trailer.fix_index_offset;
@@ -1012,6 +1036,7 @@ void CellStoreV6::load_block_index() {
     m_disk_usage = m_index_map64.disk_used() + 
       (int64_t)((double)(m_file_length-m_trailer.fix_index_offset) *
 		m_index_map64.fraction_covered());
+    m_fraction_covered = m_index_map64.fraction_covered();
     m_block_count = m_index_map64.index_entries();
   }
   else {
@@ -1022,6 +1047,7 @@ void CellStoreV6::load_block_index() {
     m_disk_usage = m_index_map32.disk_used() + 
       (int64_t)((double)(m_file_length-m_trailer.fix_index_offset) *
 		m_index_map32.fraction_covered());
+    m_fraction_covered = m_index_map32.fraction_covered();
     m_block_count = m_index_map32.index_entries();
   }
 
@@ -1038,48 +1064,69 @@ bool CellStoreV6::may_contain(ScanContextPtr &scan_context) {
   else if (m_trailer.filter_length == 0) // bloom filter is empty
     return false;
 
-  {
+  touch_bloom_filter();
+
+  while (true) {
+    {
+      ReaderEpoch::Section section(m_bloom_filter_readers);
+      BloomFilterWithChecksum *bloom_filter = m_bloom_filter.load();
+
+      if (bloom_filter)
+        return probe_bloom_filter(bloom_filter, scan_context);
+    }
+
+    // Load outside of the read-side section, purge_indexes() waits for it
+    // while holding m_mutex
     ScopedLock lock(m_mutex);
     if (m_bloom_filter == 0)
       load_bloom_filter();
+  }
+}
 
-    m_index_stats.bloom_filter_access_counter = ++Global::access_counter;
-
-    switch (m_bloom_filter_mode) {
-    case BLOOM_FILTER_ROWS:
-      m_index_stats.bloom_filter_access_counter = ++Global::access_counter;
-      return m_bloom_filter->may_contain(scan_context->start_row.data(),
-                                         scan_context->start_row.size());
-    case BLOOM_FILTER_ROWS_COLS:
-      m_index_stats.bloom_filter_access_counter = ++Global::access_counter;
-      if (m_bloom_filter->may_contain(scan_context->start_row.data(),
-                                      scan_context->start_row.size())) {
-        SchemaPtr &schema = scan_context->schema;
-        size_t rowlen = scan_context->start_row.length();
-        uint8_t column_family_id;
-        const char *ptr;
-        boost::scoped_array<char> rowcol(new char[rowlen + 2]);
-        memcpy(rowcol.get(), scan_context->start_row.c_str(), rowlen + 1);
-
-        foreach_ht(const char *col, scan_context->spec->columns) {
-          if ((ptr = strchr(col, ':')) != 0) {
-            String family(col, (size_t)(ptr-col));
-            column_family_id = schema->get_column_family(family.c_str())->id;
-          }
-          else
-            column_family_id = schema->get_column_family(col)->id;
 
-          rowcol[rowlen + 1] = column_family_id;
+void CellStoreV6::touch_bloom_filter() {
+  // Only advance the shared clock if this store is not already the most
+  // recently accessed one, so hot stores don't contend on it
+  uint64_t counter = Global::access_counter.load(std::memory_order_relaxed);
+  if (m_bloom_filter_access_counter.load(std::memory_order_relaxed) != counter)
+    m_bloom_filter_access_counter.store(++Global::access_counter,
+                                        std::memory_order_relaxed);
+}
+
 
-          m_index_stats.bloom_filter_access_counter = ++Global::access_counter;
-          if (m_bloom_filter->may_contain(rowcol.get(), rowlen + 2))
-            return true;
+bool CellStoreV6::probe_bloom_filter(BloomFilterWithChecksum *bloom_filter,
+                                     ScanContextPtr &scan_context) {
+  switch (m_bloom_filter_mode) {
+  case BLOOM_FILTER_ROWS:
+    return bloom_filter->may_contain(scan_context->start_row.data(),
+                                     scan_context->start_row.size());
+  case BLOOM_FILTER_ROWS_COLS:
+    if (bloom_filter->may_contain(scan_context->start_row.data(),
+                                  scan_context->start_row.size())) {
+      SchemaPtr &schema = scan_context->schema;
+      size_t rowlen = scan_context->start_row.length();
+      uint8_t column_family_id;
+      const char *ptr;
+      boost::scoped_array<char> rowcol(new char[rowlen + 2]);
+      memcpy(rowcol.get(), scan_context->start_row.c_str(), rowlen + 1);
+
+      foreach_ht(const char *col, scan_context->spec->columns) {
+        if ((ptr = strchr(col, ':')) != 0) {
+          String family(col, (size_t)(ptr-col));
+          column_family_id = schema->get_column_family(family.c_str())->id;
         }
+        else
+          column_family_id = schema->get_column_family(col)->id;
+
+        rowcol[rowlen + 1] = column_family_id;
+
+        if (bloom_filter->may_contain(rowcol.get(), rowlen + 2))
+          return true;
       }
-      return false;
-    default:
-      HT_ASSERT(!"unpossible bloom filter mode!");
     }
+    return false;
+  default:
+    HT_ASSERT(!"unpossible bloom filter mode!");
   }
   return false; // silence stupid compilers
 }
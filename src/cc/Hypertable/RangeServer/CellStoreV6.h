@@ -28,6 +28,7 @@
 #ifndef HYPERTABLE_CELLSTOREV6_H
 #define HYPERTABLE_CELLSTOREV6_H
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
@@ -38,6 +39,7 @@
 #include "Common/DynamicBuffer.h"
 #include "Common/BloomFilterWithChecksum.h"
 #include "Common/BlobHashSet.h"
+#include "Common/ReaderEpoch.h"
 
 #include "Hypertable/Lib/BlockCompressionCodec.h"
 #include "Hypertable/Lib/SerializedKey.h"
@@ -95,6 +97,10 @@ namespace Hypertable {
     virtual int64_t get_blocksize() { return m_trailer.blocksize; }
     virtual bool may_contain(ScanContextPtr &);
     virtual uint64_t disk_usage() { return m_disk_usage; }
+    virtual double fraction_covered() {
+      ScopedLock lock(m_mutex);
+      return m_fraction_covered;
+    }
     virtual float compression_ratio() { return m_trailer.compression_ratio; }
     virtual void split_row_estimate_data(SplitRowDataMapT &split_row_data);
 
@@ -120,7 +126,8 @@ namespace Hypertable {
 
     virtual size_t bloom_filter_size() {
       ScopedLock lock(m_mutex);
-      return m_bloom_filter ? m_bloom_filter->size() : 0;
+      BloomFilterWithChecksum *bloom_filter = m_bloom_filter.load();
+      return bloom_filter ? bloom_filter->size() : 0;
     }
 
     virtual int64_t bloom_filter_memory_used() {
@@ -128,6 +135,11 @@ namespace Hypertable {
       return m_index_stats.bloom_filter_memory;
     }
 
+    virtual void get_index_memory_stats(IndexMemoryStats *statsp) {
+      CellStore::get_index_memory_stats(statsp);
+      statsp->bloom_filter_access_counter = m_bloom_filter_access_counter;
+    }
+
     virtual int64_t block_index_memory_used() {
       ScopedLock lock(m_mutex);
       return m_index_stats.block_index_memory;
@@ -155,6 +167,22 @@ namespace Hypertable {
   protected:
     void create_bloom_filter(bool is_approx = false);
     void load_bloom_filter();
+
+    /** Advances bloom filter access time for LRU purging.
+     * Global::access_counter is only incremented if another store was
+     * accessed since the last probe of this one.
+     */
+    void touch_bloom_filter();
+
+    /** Probes bloom filter for the row (and columns) of a scan.
+     * Must be called from within a ReaderEpoch::Section of
+     * #m_bloom_filter_readers.
+     * @param bloom_filter Published bloom filter
+     * @param scan_context Scan context
+     * @return <i>false</i> if the store holds no matching cells
+     */
+    bool probe_bloom_filter(BloomFilterWithChecksum *bloom_filter,
+                            ScanContextPtr &scan_context);
     void load_block_index();
     void load_replaced_files();
 
@@ -174,6 +202,7 @@ namespace Hypertable {
     int64_t                m_offset;
     int64_t                m_file_length;
     int64_t                m_disk_usage;
+    double                 m_fraction_covered;
     int                    m_file_id;
     float                  m_uncompressed_data;
     float                  m_compressed_data;
@@ -191,10 +220,16 @@ namespace Hypertable {
     int64_t               *m_column_ttl;
     bool                   m_replaced_files_loaded;
 
-    // Member that require mutex protection
+    /// Access time of bloom filter (see Global::access_counter)
+    std::atomic<uint64_t>  m_bloom_filter_access_counter;
+
+    /// Read-side sections of may_contain(), waited for before purging
+    ReaderEpoch            m_bloom_filter_readers;
 
-    /// Bloom filter
-    BloomFilterWithChecksum *m_bloom_filter;
+    /// Bloom filter; set under mutex, read lock-free by may_contain()
+    std::atomic<BloomFilterWithChecksum *> m_bloom_filter;
+
+    // Member that require mutex protection
 
     /// 32-bit block index
     CellStoreBlockIndexArray<uint32_t> m_index_map32;
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for CellStoreV7.
+ * This file contains the type declarations for CellStoreV7, a class for
+ * creating and loading version 7 cell store files.
+ */
+
+#ifndef HYPERTABLE_CELLSTOREV7_H
+#define HYPERTABLE_CELLSTOREV7_H
+
+#include <cstring>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CellStoreBlockIndexArray.h"
+
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/BloomFilterWithChecksum.h"
+#include "Common/BlobHashSet.h"
+#include "Common/ReaderEpoch.h"
+
+#include "Hypertable/Lib/BlockCompressionCodec.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "CellStore.h"
+#include "CellStoreTrailerV7.h"
+#include "KeyCompressor.h"
+
+
+/**
+ * Forward declarations
+ */
+namespace Hypertable {
+  class BlockCompressionCodec;
+  class Client;
+  class Protocol;
+}
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   * @{
+   */
+
+  /** Version 7 cell store.
+   * In addition to the version 6 layout, this version records a zone map
+   * with one entry per data block holding the block's timestamp range and
+   * the set of column families it contains.  The zone map is written after
+   * the bloom filter and stays resident for the lifetime of the object;
+   * block_may_contain() consults it so that the interval scanners can skip
+   * blocks that lie outside a scan's time interval or column set.
+   */
+  class CellStoreV7 : public CellStore {
+
+    /// Per-block zone map entry
+    struct ZoneMapEntry {
+      ZoneMapEntry() { clear(); }
+      void clear() {
+        offset = 0;
+        timestamp_min = TIMESTAMP_MAX;
+        timestamp_max = TIMESTAMP_MIN;
+        delete_timestamp_max = TIMESTAMP_MIN;
+        memset(families, 0, sizeof(families));
+      }
+      bool operator<(const ZoneMapEntry &other) const {
+        return offset < other.offset;
+      }
+      /// Offset of block
+      int64_t offset;
+      /// Minimum timestamp of cells in block
+      int64_t timestamp_min;
+      /// Maximum timestamp of cells in block
+      int64_t timestamp_max;
+      /// Maximum timestamp of delete records in block
+      int64_t delete_timestamp_max;
+      /// Bitmap of column family codes present in block
+      uint8_t families[32];
+    };
+
+    /// Serialized length of ZoneMapEntry
+    static const size_t ZONE_MAP_ENTRY_LENGTH = 64;
+
+    class IndexBuilder {
+    public:
+      IndexBuilder() : m_bigint(false) { }
+      void add_entry(KeyCompressorPtr &key_compressor, int64_t offset);
+      DynamicBuffer &fixed_buf() { return m_fixed; }
+      DynamicBuffer &variable_buf() { return m_variable; }
+      bool big_int() { return m_bigint; }
+      void chop();
+      void release_fixed_buf() { delete [] m_fixed.release(); }
+    private:
+      DynamicBuffer m_fixed;
+      DynamicBuffer m_variable;
+      bool m_bigint;
+    };
+
+  public:
+    CellStoreV7(Filesystem *filesys, Schema *schema=0);
+    virtual ~CellStoreV7();
+
+    virtual void create(const char *fname, size_t max_entries,
+                        PropertiesPtr &props,
+                        const TableIdentifier *table_id=0);
+    virtual void add(const Key &key, const ByteString value);
+    virtual void finalize(TableIdentifier *table_identifier);
+    virtual void open(const String &fname, const String &start_row,
+                      const String &end_row, int32_t fd, int64_t file_length,
+                      CellStoreTrailer *trailer);
+    virtual void rescope(const String &start_row, const String &end_row);
+    virtual int64_t get_blocksize() { return m_trailer.blocksize; }
+    virtual bool may_contain(ScanContextPtr &);
+    virtual bool block_may_contain(int64_t offset, ScanContextPtr &scan_ctx);
+    virtual uint64_t disk_usage() { return m_disk_usage; }
+    virtual double fraction_covered() {
+      ScopedLock lock(m_mutex);
+      return m_fraction_covered;
+    }
+    virtual float compression_ratio() { return m_trailer.compression_ratio; }
+    virtual void split_row_estimate_data(SplitRowDataMapT &split_row_data);
+
+    /** Populates <code>scanner</code> with key/value pairs generated from
+     * CellStore index.  This method will first load the CellStore block 
+     * index into memory, if it is not already loaded, and then it will call
+     * the CellStoreBlockIndexArray::populate_pseudo_table_scanner method
+     * to populate <code>scanner</code> with synthesized <i>.cellstore.index</i>
+     * pseudo-table cells.
+     * @param scanner Pointer to CellListScannerBuffer to receive key/value
+     * pairs
+     */
+    virtual void populate_index_pseudo_table_scanner(CellListScannerBuffer *scanner);
+
+    virtual int64_t get_total_entries() { return m_trailer.total_entries; }
+    virtual std::string &get_filename() { return m_filename; }
+    virtual int get_file_id() { return m_file_id; }
+    virtual CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
+    virtual BlockCompressionCodec *create_block_compression_codec();
+    virtual KeyDecompressor *create_key_decompressor();
+    virtual void display_block_info();
+    virtual int64_t end_of_last_block() { return m_trailer.fix_index_offset; }
+
+    virtual size_t bloom_filter_size() {
+      ScopedLock lock(m_mutex);
+      BloomFilterWithChecksum *bloom_filter = m_bloom_filter.load();
+      return bloom_filter ? bloom_filter->size() : 0;
+    }
+
+    virtual int64_t bloom_filter_memory_used() {
+      ScopedLock lock(m_mutex);
+      return m_index_stats.bloom_filter_memory;
+    }
+
+    virtual void get_index_memory_stats(IndexMemoryStats *statsp) {
+      CellStore::get_index_memory_stats(statsp);
+      statsp->bloom_filter_access_counter = m_bloom_filter_access_counter;
+    }
+
+    virtual int64_t block_index_memory_used() {
+      ScopedLock lock(m_mutex);
+      return m_index_stats.block_index_memory;
+    }
+
+    virtual uint64_t purge_indexes();
+    virtual bool restricted_range() { return m_restricted_range; }
+    virtual const std::vector<String> &get_replaced_files();
+
+    virtual int32_t get_fd() {
+      ScopedLock lock(m_mutex);
+      return m_fd;
+    }
+
+    virtual int32_t reopen_fd() {
+      ScopedLock lock(m_mutex);
+      if (m_fd != -1)
+        m_filesys->close(m_fd);
+      m_fd = m_filesys->open(m_filename, 0);
+      return m_fd;
+    }
+
+    virtual CellStoreTrailer *get_trailer() { return &m_trailer; }
+
+  protected:
+    void create_bloom_filter(bool is_approx = false);
+    void load_bloom_filter();
+
+    /** Advances bloom filter access time for LRU purging.
+     * Global::access_counter is only incremented if another store was
+     * accessed since the last probe of this one.
+     */
+    void touch_bloom_filter();
+
+    /** Probes bloom filter for the row (and columns) of a scan.
+     * Must be called from within a ReaderEpoch::Section of
+     * #m_bloom_filter_readers.
+     * @param bloom_filter Published bloom filter
+     * @param scan_context Scan context
+     * @param prefix_len Length of row prefix to probe
+     * @return <i>false</i> if the store holds no matching cells
+     */
+    bool probe_bloom_filter(BloomFilterWithChecksum *bloom_filter,
+                            ScanContextPtr &scan_context,
+                            size_t prefix_len);
+    void load_block_index();
+    void load_replaced_files();
+
+    /** Adds key to zone map entry of block being built.
+     * @param key Key being added to current block
+     */
+    void add_to_zone(const Key &key);
+
+    /** Writes zone map section to file at current offset.
+     * @param zbuf Scratch buffer
+     */
+    void write_zone_map(DynamicBuffer &zbuf);
+
+    /** Reads zone map section from file. */
+    void load_zone_map();
+
+    /** Returns length of row prefix inserted into bloom filter in
+     * BLOOM_FILTER_ROW_PREFIX mode.  The prefix ends after the first
+     * occurrence of the prefix delimiter and is at most prefix length bytes
+     * long.
+     * @param row Row key
+     * @param len Length of row key
+     * @return Length of bloom filter prefix of <code>row</code>
+     */
+    size_t row_prefix_length(const char *row, size_t len);
+
+    /** Determines bloom filter prefix shared by all rows selected by a scan.
+     * @param scan_ctx Scan context
+     * @param prefix_lenp Address of variable to hold length of prefix of
+     * <code>scan_ctx->start_row</code>
+     * @return <i>true</i> if all selected rows share one bloom filter prefix,
+     * <i>false</i> otherwise
+     */
+    bool scan_prefix_length(ScanContextPtr &scan_ctx, size_t *prefix_lenp);
+
+    typedef BlobHashSet<> BloomFilterItems;
+
+    Filesystem            *m_filesys;
+    SchemaPtr              m_schema;
+    int32_t                m_fd;
+    std::string            m_filename;
+    bool                   m_64bit_index;
+    CellStoreTrailerV7     m_trailer;
+    BlockCompressionCodec *m_compressor;
+    DynamicBuffer          m_buffer;
+    IndexBuilder           m_index_builder;
+    DispatchHandlerSynchronizer  m_sync_handler;
+    uint32_t               m_outstanding_appends;
+    int64_t                m_offset;
+    int64_t                m_file_length;
+    int64_t                m_disk_usage;
+    double                 m_fraction_covered;
+    int                    m_file_id;
+    float                  m_uncompressed_data;
+    float                  m_compressed_data;
+    int64_t                m_uncompressed_blocksize;
+    BlockCompressionCodec::Args m_compressor_args;
+    size_t                 m_max_entries;
+
+    BloomFilterMode        m_bloom_filter_mode;
+    BloomFilterItems      *m_bloom_filter_items;
+    int64_t                m_max_approx_items;
+    float                  m_bloom_bits_per_item;
+    float                  m_filter_false_positive_prob;
+    KeyCompressorPtr       m_key_compressor;
+    bool                   m_restricted_range;
+    int64_t               *m_column_ttl;
+    bool                   m_replaced_files_loaded;
+
+    /// Zone map entry of block being built
+    ZoneMapEntry           m_zone;
+
+    /// Zone map, sorted by block offset (immutable after finalize/open)
+    std::vector<ZoneMapEntry> m_zone_map;
+
+    /// Access time of bloom filter (see Global::access_counter)
+    std::atomic<uint64_t>  m_bloom_filter_access_counter;
+
+    /// Read-side sections of may_contain(), waited for before purging
+    ReaderEpoch            m_bloom_filter_readers;
+
+    /// Bloom filter; set under mutex, read lock-free by may_contain()
+    std::atomic<BloomFilterWithChecksum *> m_bloom_filter;
+
+    // Member that require mutex protection
+
+    /// 32-bit block index
+    CellStoreBlockIndexArray<uint32_t> m_index_map32;
+
+    /// 64-bit block index
+    CellStoreBlockIndexArray<int64_t> m_index_map64;
+  };
+
+  /// Smart pointer to CellStoreV7 type
+  typedef intrusive_ptr<CellStoreV7> CellStoreV7Ptr;
+
+  /** @}*/
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_CELLSTOREV7_H
@@ -46,9 +46,11 @@ extern "C" {
 #include "RequestHandlerUpdate.h"
 #include "RequestHandlerCreateScanner.h"
 #include "RequestHandlerFetchScanblock.h"
+#include "RequestHandlerFetchScanblockStream.h"
 #include "RequestHandlerHeapcheck.h"
 #include "RequestHandlerDropTable.h"
 #include "RequestHandlerMetadataSync.h"
+#include "RequestHandlerMultiGet.h"
 #include "RequestHandlerStatus.h"
 #include "RequestHandlerDropRange.h"
 #include "RequestHandlerRelinquishRange.h"
@@ -134,6 +136,14 @@ void ConnectionHandler::handle(EventPtr &event) {
         handler = new RequestHandlerFetchScanblock(m_comm,
             m_range_server_ptr.get(), event);
         break;
+      case RangeServerProtocol::COMMAND_FETCH_SCANBLOCK_STREAM:
+        handler = new RequestHandlerFetchScanblockStream(m_comm,
+            m_range_server_ptr.get(), event);
+        break;
+      case RangeServerProtocol::COMMAND_MULTI_GET:
+        handler = new RequestHandlerMultiGet(m_comm,
+            m_range_server_ptr.get(), event);
+        break;
       case RangeServerProtocol::COMMAND_DROP_TABLE:
         handler = new RequestHandlerDropTable(m_comm, m_range_server_ptr.get(),
                                               event);
@@ -0,0 +1,105 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for DecodedBlock.
+ * This file contains definitions for DecodedBlock, a cell store block whose
+ * keys have been fully decompressed, with a directory of entry offsets that
+ * supports binary search within the block.
+ */
+
+#include "Common/Compat.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include "Hypertable/Lib/Key.h"
+
+#include "DecodedBlock.h"
+
+#include <vector>
+
+using namespace Hypertable;
+
+uint8_t *DecodedBlock::encode(KeyDecompressor *decompressor,
+                              const uint8_t *base, const uint8_t *end,
+                              uint32_t *lengthp) {
+  DynamicBuffer buf(((end - base) * 3) / 2);
+  std::vector<uint32_t> offsets;
+  const uint8_t *ptr = base;
+  ByteString value;
+  Key key;
+
+  end = decompressor->load_block(base, end);
+  decompressor->reset();
+  while (ptr < end) {
+    value.ptr = decompressor->add(ptr);
+    decompressor->load(key);
+    ptr = value.ptr + value.length();
+    offsets.push_back(buf.fill());
+    buf.add(key.serial.ptr, key.length);
+    buf.add(value.ptr, ptr - value.ptr);
+  }
+
+  if (ptr != end)
+    HT_THROW(Error::BAD_KEY, "Overrun decoding cell store block");
+
+  buf.ensure(4 * (offsets.size() + 1));
+  for (size_t i=0; i<offsets.size(); ++i)
+    Serialization::encode_i32(&buf.ptr, offsets[i]);
+  Serialization::encode_i32(&buf.ptr, offsets.size());
+
+  size_t length;
+  uint8_t *block = buf.release(&length);
+  *lengthp = length;
+  return block;
+}
+
+void DecodedBlock::load(const uint8_t *buf, uint32_t length) {
+  HT_ASSERT(length >= 4);
+  const uint8_t *ptr = buf + length - 4;
+  size_t remaining = 4;
+  m_count = Serialization::decode_i32(&ptr, &remaining);
+  HT_ASSERT(4 * (m_count + 1) <= length);
+  m_base = buf;
+  m_directory = buf + length - 4 * (m_count + 1);
+  m_end = m_directory;
+}
+
+const uint8_t *DecodedBlock::entry(uint32_t i) const {
+  const uint8_t *ptr = m_directory + 4 * i;
+  size_t remaining = 4;
+  return m_base + Serialization::decode_i32(&ptr, &remaining);
+}
+
+const uint8_t *DecodedBlock::lower_bound(SerializedKey key) const {
+  uint32_t lo = 0;
+  uint32_t hi = m_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (SerializedKey(entry(mid)) < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo == m_count ? m_end : entry(lo);
+}
@@ -0,0 +1,132 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for DecodedBlock.
+ * This file contains declarations for DecodedBlock, a cell store block whose
+ * keys have been fully decompressed, with a directory of entry offsets that
+ * supports binary search within the block.
+ */
+
+#ifndef HYPERTABLE_DECODEDBLOCK_H
+#define HYPERTABLE_DECODEDBLOCK_H
+
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "KeyDecompressor.h"
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Decoded cell store block.
+   * A decoded block holds the key/value pairs of an uncompressed cell store
+   * block with every key expanded to its full serialized form, so the
+   * entries can be read with KeyDecompressorNone starting at any entry.  The
+   * entries are followed by a directory holding the offset of each entry and
+   * the entry count:
+   *
+   * <pre>
+   *   entry[0] .. entry[n-1]   serialized key followed by value
+   *   offset[0] .. offset[n-1] 32-bit offset of each entry
+   *   n                        32-bit entry count
+   * </pre>
+   *
+   * Since every entry is a restart point, lower_bound() locates a key with a
+   * binary search instead of rebuilding prefix compressed keys from the start
+   * of the block.  The encoded form is a single buffer allocated with
+   * <code>new[]</code>, so it can be stored in FileBlockCache alongside the
+   * raw block (see FileBlockCache::decoded_offset()).
+   */
+  class DecodedBlock {
+  public:
+
+    /// Constructor; creates empty block
+    DecodedBlock() : m_base(0), m_end(0), m_directory(0), m_count(0) { }
+
+    /** Constructor.
+     * @param buf Encoded block as returned by encode()
+     * @param length Length of encoded block
+     */
+    DecodedBlock(const uint8_t *buf, uint32_t length) { load(buf, length); }
+
+    /** Encodes an uncompressed cell store block.
+     * @param decompressor Key decompressor for the block's key format
+     * @param base Start of uncompressed block
+     * @param end End of uncompressed block, including any block trailer
+     *        parsed by KeyDecompressor::load_block()
+     * @param lengthp Address of variable to hold length of encoded block
+     * @return Encoded block, allocated with <code>new[]</code>
+     */
+    static uint8_t *encode(KeyDecompressor *decompressor, const uint8_t *base,
+                           const uint8_t *end, uint32_t *lengthp);
+
+    /** Loads an encoded block.
+     * @param buf Encoded block as returned by encode()
+     * @param length Length of encoded block
+     */
+    void load(const uint8_t *buf, uint32_t length);
+
+    /// Returns pointer to first entry
+    const uint8_t *base() const { return m_base; }
+
+    /// Returns pointer to end of the last entry
+    const uint8_t *end() const { return m_end; }
+
+    /// Returns number of entries
+    uint32_t size() const { return m_count; }
+
+    /** Returns entry at a given position.
+     * @param i Entry number, less than size()
+     * @return Pointer to serialized key of the entry
+     */
+    const uint8_t *entry(uint32_t i) const;
+
+    /** Finds first entry whose key is not less than <code>key</code>.
+     * @param key Key to search for
+     * @return Pointer to serialized key of the entry, or end() if all keys are
+     *         less than <code>key</code>
+     */
+    const uint8_t *lower_bound(SerializedKey key) const;
+
+  private:
+
+    /// First entry
+    const uint8_t *m_base;
+
+    /// End of entries, start of directory
+    const uint8_t *m_end;
+
+    /// Entry offset directory
+    const uint8_t *m_directory;
+
+    /// Number of entries
+    uint32_t m_count;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_DECODEDBLOCK_H
@@ -47,8 +47,10 @@ FileBlockCache::checkout(int file_id, uint64_t file_offset, uint8_t **blockp,
 
   m_accesses++;
 
-  if ((iter = hash_index.find(make_key(file_id, file_offset))) == hash_index.end())
+  if ((iter = hash_index.find(make_key(file_id, file_offset))) == hash_index.end()) {
+    m_ghost.hit(make_key(file_id, file_offset));
     return false;
+  }
 
   BlockCacheEntry entry = *iter;
   entry.ref_count++;
@@ -124,8 +126,8 @@ bool FileBlockCache::contains(int file_id, uint64_t file_offset) {
     m_hits++;
     return true;
   }
-  else
-    return false;
+  m_ghost.hit(make_key(file_id, file_offset));
+  return false;
 }
 
 
@@ -162,6 +164,7 @@ int64_t FileBlockCache::make_room(int64_t amount) {
     if ((*iter).ref_count == 0) {
       m_available += (*iter).length;
       amount_freed += (*iter).length;
+      m_ghost.insert((*iter).key(), (*iter).length);
       delete [] (*iter).block;
       iter = m_cache.erase(iter);
       if (m_available >= amount)
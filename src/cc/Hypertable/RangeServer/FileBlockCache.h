@@ -30,6 +30,8 @@
 #include "Common/Mutex.h"
 #include "Common/atomic.h"
 
+#include "GhostCache.h"
+
 namespace Hypertable {
   using namespace boost::multi_index;
 
@@ -38,14 +40,35 @@ namespace Hypertable {
     static atomic_t ms_next_file_id;
 
   public:
-    FileBlockCache(int64_t min_memory, int64_t max_memory, bool compressed)
+    FileBlockCache(int64_t min_memory, int64_t max_memory, bool compressed,
+                   bool decoded=false)
       : m_min_memory(min_memory), m_max_memory(max_memory), m_limit(max_memory),
-	m_available(max_memory), m_accesses(0), m_hits(0), m_compressed(compressed)
+	m_available(max_memory), m_accesses(0), m_hits(0), m_compressed(compressed),
+        m_decoded(decoded)
     { HT_ASSERT(min_memory <= max_memory); }
     ~FileBlockCache();
 
     bool compressed() { return m_compressed; }
 
+    /**
+     * Returns true if decoded blocks (see DecodedBlock) are cached in
+     * addition to the raw blocks
+     */
+    bool decoded() { return m_decoded; }
+
+    /**
+     * Returns the offset under which the decoded form of the block at
+     * <code>file_offset</code> is cached.  Decoded blocks share the cache,
+     * its memory limit and its LRU order with raw blocks.
+     *
+     * @param file_offset Offset of raw block
+     * @return Offset to pass to checkout(), checkin() and insert()
+     */
+    static uint64_t decoded_offset(uint64_t file_offset) {
+      HT_ASSERT(file_offset < DECODED_OFFSET_BIT);
+      return file_offset | DECODED_OFFSET_BIT;
+    }
+
     bool checkout(int file_id, uint64_t file_offset, uint8_t **blockp,
                   uint32_t *lengthp);
     void checkin(int file_id, uint64_t file_offset);
@@ -70,6 +93,29 @@ namespace Hypertable {
       return m_limit;
     }
 
+    int64_t get_min_memory() { return m_min_memory; }
+
+    int64_t get_max_memory() { return m_max_memory; }
+
+    /**
+     * Sets the amount of evicted block data remembered to measure how many
+     * misses additional memory would have turned into hits.
+     *
+     * @param capacity Ghost capacity in bytes, 0 disables ghost tracking
+     */
+    void set_ghost_capacity(int64_t capacity) {
+      ScopedLock lock(m_mutex);
+      m_ghost.set_capacity(capacity);
+    }
+
+    /**
+     * Returns the number of misses on recently evicted blocks.
+     */
+    uint64_t ghost_hits() {
+      ScopedLock lock(m_mutex);
+      return m_ghost.hits();
+    }
+
     /**
      * Sets limit to memory currently used, it will not reduce the limit
      * below min_memory
@@ -106,10 +152,13 @@ namespace Hypertable {
 
     int64_t make_room(int64_t amount);
 
+    /// Offset bit distinguishing decoded blocks from raw blocks
+    static const uint64_t DECODED_OFFSET_BIT = 68719476736ULL;  // 2^36
+
     inline static int64_t make_key(int file_id, uint64_t file_offset) {
-      HT_ASSERT(file_id < 268435456LL);        // Can't be larger than 2^28
-      HT_ASSERT(file_offset < 68719476736LL);  // Can't be larger than 2^36
-      return ((int64_t)file_id << 36) | (int64_t)file_offset;
+      HT_ASSERT(file_id < 134217728LL);         // Can't be larger than 2^27
+      HT_ASSERT(file_offset < 137438953472LL);  // Can't be larger than 2^37
+      return ((int64_t)file_id << 37) | (int64_t)file_offset;
     }
 
     class BlockCacheEntry {
@@ -153,6 +202,7 @@ namespace Hypertable {
 
     Mutex         m_mutex;
     BlockCache    m_cache;
+    GhostCache<int64_t, HashI64> m_ghost;
     int64_t      m_min_memory;
     int64_t      m_max_memory;
     int64_t      m_limit;
@@ -160,6 +210,7 @@ namespace Hypertable {
     uint64_t     m_accesses;
     uint64_t     m_hits;
     bool         m_compressed;
+    bool         m_decoded;
   };
 
 }
@@ -22,8 +22,135 @@
 #include "Common/Compat.h"
 #include "FillScanBlock.h"
 
+#include "Hypertable/Lib/ScanAggregate.h"
+
+#include <map>
+
 namespace Hypertable {
 
+  namespace {
+
+    /** Partial aggregate of a group along with the key it is returned
+     * under. */
+    struct AggregateGroup {
+      AggregateGroup() : timestamp(TIMESTAMP_MIN), revision(TIMESTAMP_MIN) { }
+      ScanAggregate aggregate;
+      int64_t timestamp;
+      int64_t revision;
+    };
+
+    /** Adds a cell to a group.  <code>first_in_row</code> is set for the
+     * first cell of a row, so each row is counted once, in the group of its
+     * lowest column family. */
+    void add_to_group(AggregateGroup &group, ScanContext *scan_context,
+                      Key &key, ByteString &value, bool first_in_row) {
+
+      if (first_in_row)
+        group.aggregate.rows++;
+      if (key.timestamp > group.timestamp)
+        group.timestamp = key.timestamp;
+      if (key.revision > group.revision)
+        group.revision = key.revision;
+
+      if (scan_context->spec->keys_only)
+        group.aggregate.cells++;
+      else if (scan_context->family_info[key.column_family_code].counter) {
+        const uint8_t *decode;
+        size_t remain = value.decode_length(&decode);
+        // value must be encoded 64 bit int followed by '=' character
+        if (remain != 9)
+          HT_FATAL_OUT << "Expected counter to be encoded 64 bit int but remain=" << remain
+                       << " ,key=" << key << " ,value="<< value.str() << HT_END;
+        group.aggregate.add_counter(Serialization::decode_i64(&decode, &remain));
+      }
+      else {
+        const uint8_t *decode = 0;
+        size_t len = value.ptr ? value.decode_length(&decode) : 0;
+        group.aggregate.add_value(decode, len);
+      }
+    }
+
+    void emit_group(DynamicBuffer &dbuf, const char *row, uint8_t family,
+                    AggregateGroup &group) {
+      uint8_t buf[64];
+      uint8_t *ptr = buf;
+      HT_ASSERT(group.aggregate.encoded_length() <= sizeof(buf));
+      group.aggregate.encode(&ptr);
+      create_key_and_append(dbuf, FLAG_INSERT, row, family, "",
+                            group.timestamp, group.revision);
+      append_as_byte_string(dbuf, buf, ptr - buf);
+    }
+
+    /** Fills a scan block with partial aggregates.
+     * Blocks only end on row boundaries, so no row is split across two
+     * partial aggregates.  With AGGREGATE_BY_ROW, a (row, column family)
+     * group is emitted as soon as it is complete and the block is closed at
+     * the first row boundary after <code>buffer_size</code> bytes of output.
+     * With AGGREGATE_BY_COLUMN, the whole remaining range is consumed and
+     * one group per column family is emitted under the last row scanned.
+     */
+    bool fill_aggregate_block(CellListScannerPtr &scanner, DynamicBuffer &dbuf,
+                              int64_t buffer_size) {
+      ScanContext *scan_context = scanner->scan_context();
+      bool by_row = scan_context->spec->aggregate == ScanSpec::AGGREGATE_BY_ROW;
+      std::map<uint8_t, AggregateGroup> families;
+      AggregateGroup group;
+      String row;
+      int family = -1;
+      Key key;
+      ByteString value;
+      bool more = true;
+
+      dbuf.reserve(4 + buffer_size);
+      dbuf.ptr = dbuf.base + 4;
+
+      while ((more = scanner->get(key, value))) {
+
+        // Delete markers are returned if return_deletes is set, but they
+        // are not part of the aggregate
+        if (key.flag != FLAG_INSERT) {
+          scanner->forward();
+          continue;
+        }
+
+        bool new_row = row.empty() || strcmp(key.row, row.c_str());
+
+        if (by_row) {
+          if (new_row || key.column_family_code != family) {
+            if (family != -1)
+              emit_group(dbuf, row.c_str(), family, group);
+            family = -1;
+            if (new_row && dbuf.fill() - 4 >= (size_t)buffer_size)
+              break;
+            group = AggregateGroup();
+            family = key.column_family_code;
+          }
+          add_to_group(group, scan_context, key, value, new_row);
+        }
+        else
+          add_to_group(families[key.column_family_code], scan_context, key,
+                       value, new_row);
+
+        if (new_row)
+          row = key.row;
+
+        scanner->forward();
+      }
+
+      if (family != -1)
+        emit_group(dbuf, row.c_str(), family, group);
+
+      for (auto &entry : families)
+        emit_group(dbuf, row.c_str(), entry.first, entry.second);
+
+      uint8_t *ptr = dbuf.base;
+      Serialization::encode_i32(&ptr, dbuf.fill() - 4);
+
+      return more;
+    }
+
+  }
+
   bool
   FillScanBlock(CellListScannerPtr &scanner, DynamicBuffer &dbuf, int64_t buffer_size) {
     Key key;
@@ -42,6 +169,9 @@ namespace Hypertable {
 
     assert(dbuf.base == 0);
 
+    if (scan_context->spec->aggregate != ScanSpec::AGGREGATE_NONE)
+      return fill_aggregate_block(scanner, dbuf, buffer_size);
+
     while ((more = scanner->get(key, value))) {
       counter = false;
 
@@ -0,0 +1,158 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for GhostCache.
+ * This file contains the type declaration for GhostCache, a bounded list of
+ * keys recently evicted from a cache, used to estimate the benefit of giving
+ * the cache more memory.
+ */
+
+#ifndef HYPERTABLE_GHOSTCACHE_H
+#define HYPERTABLE_GHOSTCACHE_H
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <stdint.h>
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Keys recently evicted from a cache.
+   * The owning cache inserts the key and length of every entry it evicts
+   * and calls hit() on every miss.  A miss that finds its key here would
+   * have been a hit if the cache had been larger by capacity() bytes, so the
+   * hit count measures the marginal benefit of that much additional memory.
+   * Only keys are kept, so the ghost itself costs a few dozen bytes per
+   * entry.  This class is not thread safe; it is protected by the mutex of
+   * the owning cache.
+   */
+  template <typename KeyT, typename HashT>
+  class GhostCache {
+  public:
+
+    /** Constructor.
+     * @param capacity Total length of evicted entries to remember
+     */
+    GhostCache(int64_t capacity=0)
+      : m_capacity(capacity), m_length(0), m_hits(0) { }
+
+    /** Sets total length of evicted entries to remember.
+     * @param capacity New capacity in bytes
+     */
+    void set_capacity(int64_t capacity) {
+      m_capacity = capacity;
+      trim();
+    }
+
+    /// Returns capacity in bytes
+    int64_t capacity() const { return m_capacity; }
+
+    /** Remembers an evicted entry.
+     * @param key Key of the evicted entry
+     * @param length Length of the evicted entry
+     */
+    void insert(const KeyT &key, int64_t length) {
+      if (m_capacity == 0)
+        return;
+      KeyIndex &key_index = m_entries.template get<1>();
+      typename KeyIndex::iterator iter = key_index.find(key);
+      if (iter != key_index.end()) {
+        m_length -= iter->length;
+        key_index.erase(iter);
+      }
+      m_entries.push_back(Entry(key, length));
+      m_length += length;
+      trim();
+    }
+
+    /** Checks a cache miss against the evicted entries.
+     * If the key is found, it is forgotten and the hit is counted.
+     * @param key Key that missed in the owning cache
+     * @return <i>true</i> if the key was recently evicted
+     */
+    bool hit(const KeyT &key) {
+      KeyIndex &key_index = m_entries.template get<1>();
+      typename KeyIndex::iterator iter = key_index.find(key);
+      if (iter == key_index.end())
+        return false;
+      m_length -= iter->length;
+      key_index.erase(iter);
+      m_hits++;
+      return true;
+    }
+
+    /// Returns number of misses that were recently evicted
+    uint64_t hits() const { return m_hits; }
+
+  private:
+
+    /// Evicts oldest keys until the total length is within capacity
+    void trim() {
+      while (m_length > m_capacity && !m_entries.empty()) {
+        m_length -= m_entries.front().length;
+        m_entries.pop_front();
+      }
+    }
+
+    /// Evicted entry
+    struct Entry {
+      Entry(const KeyT &k, int64_t len) : key(k), length(len) { }
+      KeyT key;
+      int64_t length;
+    };
+
+    typedef boost::multi_index_container<
+      Entry,
+      boost::multi_index::indexed_by<
+        boost::multi_index::sequenced<>,
+        boost::multi_index::hashed_unique<
+          boost::multi_index::member<Entry, KeyT, &Entry::key>, HashT>
+      >
+    > EntrySet;
+
+    typedef typename EntrySet::template nth_index<1>::type KeyIndex;
+
+    /// Evicted entries in eviction order, oldest first
+    EntrySet m_entries;
+
+    /// Capacity in bytes
+    int64_t m_capacity;
+
+    /// Total length of remembered entries
+    int64_t m_length;
+
+    /// Number of hits
+    uint64_t m_hits;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_GHOSTCACHE_H
@@ -46,6 +46,7 @@ namespace Hypertable {
   bool                   Global::verbose = false;
   bool                   Global::row_size_unlimited = false;
   bool                   Global::ignore_cells_with_clock_skew = false;
+  bool                   Global::copy_free_split = false;
   CommitLog             *Global::user_log = 0;
   CommitLog             *Global::system_log = 0;
   CommitLog             *Global::metadata_log = 0;
@@ -65,6 +66,7 @@ namespace Hypertable {
   TablePtr               Global::rs_metrics_table = 0;
   int64_t                Global::range_metadata_split_size = 0;
   MemoryTracker         *Global::memory_tracker = 0;
+  MemoryGovernor        *Global::memory_governor = 0;
   int64_t                Global::log_prune_threshold_min = 0;
   int64_t                Global::log_prune_threshold_max = 0;
   int64_t                Global::cellstore_target_size_min = 0;
@@ -72,7 +74,8 @@ namespace Hypertable {
   int64_t                Global::memory_limit = 0;
   int64_t                Global::memory_limit_ensure_unused = 0;
   int64_t                Global::memory_limit_ensure_unused_current = 0;
-  uint64_t               Global::access_counter = 0;
+  std::atomic<uint64_t>  Global::access_counter(0);
+  std::atomic<uint64_t>  Global::block_index_loads(0);
   bool                   Global::enable_shadow_cache = true;
   std::string            Global::toplevel_dir;
   int32_t                Global::metrics_interval = 0;
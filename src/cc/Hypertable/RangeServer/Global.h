@@ -22,6 +22,7 @@
 #ifndef HYPERTABLE_RANGESERVER_GLOBAL_H
 #define HYPERTABLE_RANGESERVER_GLOBAL_H
 
+#include <atomic>
 #include <string>
 
 #include <boost/thread/thread.hpp>
@@ -47,6 +48,7 @@
 #include "LoadStatistics.h"
 #include "LocationInitializer.h"
 #include "MaintenanceQueue.h"
+#include "MemoryGovernor.h"
 #include "MemoryTracker.h"
 #include "MetaLogEntityTask.h"
 #include "MetaLogEntityRemoveOkLogs.h"
@@ -74,6 +76,7 @@ namespace Hypertable {
     static bool           verbose;
     static bool           row_size_unlimited;
     static bool           ignore_cells_with_clock_skew;
+    static bool           copy_free_split;
     static CommitLog     *user_log;
     static CommitLog     *system_log;
     static CommitLog     *metadata_log;
@@ -93,6 +96,7 @@ namespace Hypertable {
     static TablePtr       rs_metrics_table;
     static int64_t        range_metadata_split_size;
     static Hypertable::MemoryTracker *memory_tracker;
+    static Hypertable::MemoryGovernor *memory_governor;
     static int64_t        log_prune_threshold_min;
     static int64_t        log_prune_threshold_max;
     static int64_t        cellstore_target_size_min;
@@ -104,7 +108,10 @@ namespace Hypertable {
     // amount of unused physical memory to achieve according
     // to the current memory situation
     static int64_t        memory_limit_ensure_unused_current;
-    static uint64_t       access_counter;
+    // logical clock ordering cell store index accesses (LRU purging)
+    static std::atomic<uint64_t> access_counter;
+    // number of cell store block indexes loaded (MemoryGovernor)
+    static std::atomic<uint64_t> block_index_loads;
     static bool           enable_shadow_cache;
     static std::string    toplevel_dir;
     static int32_t        metrics_interval;
@@ -35,6 +35,27 @@ namespace Hypertable {
     virtual const uint8_t *add(const uint8_t *ptr) = 0;
     virtual bool less_than(SerializedKey serialized_key) = 0;
     virtual void load(Key &key) = 0;
+
+    /** Prepares for decoding an uncompressed block.
+     * Block formats that carry a trailer after the key/value entries
+     * override this method to parse it.
+     * @param base Start of block
+     * @param end End of block
+     * @return End of the block's key/value entries
+     */
+    virtual const uint8_t *load_block(const uint8_t *base, const uint8_t *end) {
+      return end;
+    }
+
+    /** Finds position from which to search the block for a key.
+     * Must be called after load_block().  The returned entry can be decoded
+     * after a call to reset() and its key is less than
+     * <code>serialized_key</code>, unless it is the first entry of the block.
+     * @param serialized_key Key to search for
+     * @return Entry from which to continue a sequential search, or 0 if the
+     *         block format does not support seeking
+     */
+    virtual const uint8_t *seek(SerializedKey serialized_key) { return 0; }
   };
   typedef intrusive_ptr<KeyDecompressor> KeyDecompressorPtr;
 
@@ -0,0 +1,97 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for KeyDecompressorPrefixRestart.
+ * This file contains definitions for KeyDecompressorPrefixRestart, a key
+ * decompressor for prefix compressed blocks with restart points.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include "KeyDecompressorPrefixRestart.h"
+
+using namespace Hypertable;
+
+const uint8_t *
+KeyDecompressorPrefixRestart::load_block(const uint8_t *base,
+                                         const uint8_t *end) {
+  if (end - base < 4)
+    HT_THROW(Error::BLOCK_COMPRESSOR_TRUNCATED,
+             "Cell store block too short for restart point directory");
+  const uint8_t *ptr = end - 4;
+  size_t remaining = 4;
+  m_restart_count = Serialization::decode_i32(&ptr, &remaining);
+  if ((uint64_t)4 * (m_restart_count + 1) > (uint64_t)(end - base))
+    HT_THROWF(Error::BLOCK_COMPRESSOR_TRUNCATED,
+              "Bad restart point count (%u) in cell store block",
+              (unsigned)m_restart_count);
+  m_base = base;
+  m_directory = end - 4 * (m_restart_count + 1);
+  return m_directory;
+}
+
+const uint8_t *KeyDecompressorPrefixRestart::seek(SerializedKey serialized_key) {
+  if (m_restart_count == 0)
+    return 0;
+
+  // find first restart point not less than serialized_key
+  uint32_t lo = 0;
+  uint32_t hi = m_restart_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (restart_less_than(restart_point(mid), serialized_key))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  // the matching key lies after the preceding restart point
+  return restart_point(lo == 0 ? 0 : lo - 1);
+}
+
+const uint8_t *KeyDecompressorPrefixRestart::restart_point(uint32_t i) {
+  const uint8_t *ptr = m_directory + 4 * i;
+  size_t remaining = 4;
+  return m_base + Serialization::decode_i32(&ptr, &remaining);
+}
+
+bool
+KeyDecompressorPrefixRestart::restart_less_than(const uint8_t *entry,
+                                                SerializedKey serialized_key) {
+  const uint8_t *ptr;
+  SerializedKey serkey(entry);
+  size_t remaining = serkey.decode_length(&ptr);
+  uint8_t control = *ptr++;
+  remaining--;
+  uint32_t matching = Serialization::decode_vi32(&ptr, &remaining);
+  HT_ASSERT(matching == 0);
+
+  m_key_buf.clear();
+  m_key_buf.ensure(8 + remaining);
+  Serialization::encode_vi32(&m_key_buf.ptr, 1 + remaining);
+  *m_key_buf.ptr++ = control;
+  m_key_buf.add_unchecked(ptr, remaining);
+  return SerializedKey(m_key_buf.base) < serialized_key;
+}
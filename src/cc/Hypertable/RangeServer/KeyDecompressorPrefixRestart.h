@@ -0,0 +1,95 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for KeyDecompressorPrefixRestart.
+ * This file contains declarations for KeyDecompressorPrefixRestart, a key
+ * decompressor for prefix compressed blocks with restart points.
+ */
+
+#ifndef HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
+#define HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
+
+#include "Common/DynamicBuffer.h"
+
+#include "KeyDecompressorPrefix.h"
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Key decompressor for KeyCompressionType::PREFIX_RESTART blocks.
+   * Keys are prefix compressed as with KeyCompressionType::PREFIX, except
+   * that restart point keys share no prefix with their predecessor.  The
+   * block ends with a directory holding the 32-bit offset of every restart
+   * point followed by the 32-bit number of restart points.  seek() binary
+   * searches the restart points so that only the keys following the
+   * closest restart point have to be decoded sequentially.
+   */
+  class KeyDecompressorPrefixRestart : public KeyDecompressorPrefix {
+  public:
+    /// Constructor
+    KeyDecompressorPrefixRestart()
+      : m_base(0), m_directory(0), m_restart_count(0) { }
+
+    virtual const uint8_t *load_block(const uint8_t *base, const uint8_t *end);
+    virtual const uint8_t *seek(SerializedKey serialized_key);
+
+  private:
+
+    /** Returns restart point.
+     * @param i Restart point number
+     * @return Pointer to entry of restart point
+     */
+    const uint8_t *restart_point(uint32_t i);
+
+    /** Compares restart point key with a key.
+     * @param entry Entry of restart point
+     * @param serialized_key Key to compare with
+     * @return true if key of restart point is less than
+     *         <code>serialized_key</code>
+     */
+    bool restart_less_than(const uint8_t *entry, SerializedKey serialized_key);
+
+    /// Start of block
+    const uint8_t *m_base;
+
+    /// Restart point directory
+    const uint8_t *m_directory;
+
+    /// Number of restart points
+    uint32_t m_restart_count;
+
+    /// Buffer holding uncompressed form of restart point keys
+    DynamicBuffer m_key_buf;
+  };
+
+  /// Smart pointer to KeyDecompressorPrefixRestart
+  typedef intrusive_ptr<KeyDecompressorPrefixRestart> KeyDecompressorPrefixRestartPtr;
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
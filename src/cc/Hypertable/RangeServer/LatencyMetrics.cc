@@ -0,0 +1,130 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for LatencyMetrics.
+ * This file contains definitions for LatencyMetrics, a class that
+ * collects latency histograms of RangeServer requests and of the phases
+ * they go through, and samples individual requests for tracing.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include "LatencyMetrics.h"
+
+#include <boost/thread/tss.hpp>
+
+#include <atomic>
+
+using namespace Hypertable;
+
+namespace {
+
+  const char *metric_names[LatencyMetrics::METRIC_COUNT] = {
+    "create_scanner",
+    "fetch_scanblock",
+    "multi_get",
+    "update",
+    "update_qualify",
+    "commit_log_write",
+    "commit_log_sync",
+    "cell_cache_add",
+    "block_cache_miss",
+    "block_read",
+    "block_decompress"
+  };
+
+  /// Traces are owned by their RequestTimer, never by the thread
+  void no_cleanup(LatencyMetrics::Trace *) { }
+
+  boost::thread_specific_ptr<LatencyMetrics::Trace> current(no_cleanup);
+
+  std::atomic<uint32_t> trace_interval(0);
+
+  std::atomic<uint64_t> request_counter(0);
+
+}
+
+LatencyHistogram LatencyMetrics::ms_histograms[LatencyMetrics::METRIC_COUNT];
+
+
+LatencyMetrics::Trace::Trace(Metric request) : m_request(request) {
+  memset(m_usec, 0, sizeof(m_usec));
+  memset(m_count, 0, sizeof(m_count));
+}
+
+void LatencyMetrics::Trace::log(uint64_t total_usec) {
+  String phases;
+  for (int i=0; i<METRIC_COUNT; ++i) {
+    if (m_count[i] && i != m_request)
+      phases += format(" %s=%ux%lluus", metric_names[i], (unsigned)m_count[i],
+                       (Llu)m_usec[i]);
+  }
+  HT_INFOF("Trace %s %s total=%lluus%s", metric_names[m_request],
+           m_description.c_str(), (Llu)total_usec, phases.c_str());
+}
+
+
+LatencyMetrics::RequestTimer::RequestTimer(Metric metric)
+  : m_metric(metric), m_start(get_ts64()), m_trace(sample(metric)),
+    m_saved_trace(0) {
+  if (m_trace) {
+    m_saved_trace = current.get();
+    current.reset(m_trace);
+  }
+}
+
+LatencyMetrics::RequestTimer::~RequestTimer() {
+  uint64_t usec = record(m_metric, m_start);
+  if (m_trace) {
+    current.reset(m_saved_trace);
+    m_trace->log(usec);
+    delete m_trace;
+  }
+}
+
+
+const char *LatencyMetrics::name(Metric metric) {
+  return metric_names[metric];
+}
+
+LatencyMetrics::Trace *LatencyMetrics::sample(Metric request) {
+  uint32_t interval = trace_interval.load(std::memory_order_relaxed);
+  if (interval == 0 ||
+      (request_counter.fetch_add(1, std::memory_order_relaxed) % interval) != 0)
+    return 0;
+  return new Trace(request);
+}
+
+void LatencyMetrics::set_trace_interval(uint32_t interval) {
+  trace_interval = interval;
+}
+
+LatencyMetrics::Trace *LatencyMetrics::current_trace() {
+  return current.get();
+}
+
+void
+LatencyMetrics::get(std::map<String, LatencyHistogram::Snapshot> &histograms) {
+  for (int i=0; i<METRIC_COUNT; ++i)
+    ms_histograms[i].snapshot(histograms[metric_names[i]]);
+}
@@ -0,0 +1,232 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for LatencyMetrics.
+ * This file contains declarations for LatencyMetrics, a class that
+ * collects latency histograms of RangeServer requests and of the phases
+ * they go through, and samples individual requests for tracing.
+ */
+
+#ifndef HYPERTABLE_LATENCYMETRICS_H
+#define HYPERTABLE_LATENCYMETRICS_H
+
+#include "Common/LatencyHistogram.h"
+#include "Common/String.h"
+#include "Common/Time.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <map>
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Latency histograms of RangeServer requests and request phases.
+   * Every request type and every phase has one process-wide
+   * LatencyHistogram.  Phases are timed with a Timer on the thread that
+   * executes them.
+   *
+   * Requests can additionally be sampled for tracing: every Nth request
+   * (see set_trace_interval()) gets a Trace that accumulates the time spent
+   * in each phase and is logged when the request completes.  Scan requests
+   * install their trace as the current trace of the executing thread, so
+   * phases deep in the cell store scanners are attributed without passing
+   * the trace around.  Updates go through the group commit pipeline on
+   * several threads, so their trace is carried by the update context and
+   * passed to record() explicitly.
+   */
+  class LatencyMetrics {
+  public:
+
+    /// Request types and phases
+    enum Metric {
+      CREATE_SCANNER = 0,  //!< create_scanner request
+      FETCH_SCANBLOCK,     //!< fetch_scanblock request
+      MULTI_GET,           //!< multi_get request
+      UPDATE,              //!< update request, from receipt to response
+      UPDATE_QUALIFY,      //!< Qualify and transform phase of updates
+      COMMIT_LOG_WRITE,    //!< Commit log write
+      COMMIT_LOG_SYNC,     //!< Commit log sync
+      CELL_CACHE_ADD,      //!< Adding updates to cell caches
+      BLOCK_CACHE_MISS,    //!< Cell store block fetch that missed the cache
+      BLOCK_READ,          //!< Cell store block read from the DFS
+      BLOCK_DECOMPRESS,    //!< Cell store block decompression
+      METRIC_COUNT
+    };
+
+    /** Per request phase breakdown.
+     */
+    class Trace : boost::noncopyable {
+    public:
+      /** Constructor.
+       * @param request Request type being traced
+       */
+      Trace(Metric request);
+
+      /** Adds time spent in a phase.
+       * @param metric Phase
+       * @param usec Time spent (microseconds)
+       */
+      void add(Metric metric, uint64_t usec) {
+        m_usec[metric] += usec;
+        m_count[metric]++;
+      }
+
+      /** Sets description logged with the trace.
+       * @param description Description, e.g. table and range
+       */
+      void set_description(const String &description) {
+        m_description = description;
+      }
+
+      /** Logs the trace.
+       * @param total_usec Total request time (microseconds)
+       */
+      void log(uint64_t total_usec);
+
+    private:
+      /// Request type
+      Metric m_request;
+
+      /// Description
+      String m_description;
+
+      /// Time spent per phase
+      uint64_t m_usec[METRIC_COUNT];
+
+      /// Number of times each phase was entered
+      uint32_t m_count[METRIC_COUNT];
+    };
+
+    /** Times a phase.
+     * Records the time between construction and destruction into the
+     * histogram of the phase and into the current trace of the thread.
+     */
+    class Timer : boost::noncopyable {
+    public:
+      /** Constructor.
+       * @param metric Phase to time
+       */
+      Timer(Metric metric) : m_metric(metric), m_start(get_ts64()) { }
+
+      /// Destructor; records elapsed time
+      ~Timer() { record(m_metric, m_start, current_trace()); }
+
+    private:
+      /// Phase being timed
+      Metric m_metric;
+
+      /// Start time (nanoseconds)
+      int64_t m_start;
+    };
+
+    /** Times a request executed on a single thread.
+     * If the request is sampled, installs a Trace as the current trace of the
+     * thread for the lifetime of the object and logs it on destruction.
+     */
+    class RequestTimer : boost::noncopyable {
+    public:
+      /** Constructor.
+       * @param metric Request type
+       */
+      RequestTimer(Metric metric);
+
+      /// Destructor; records elapsed time and logs the trace
+      ~RequestTimer();
+
+      /** Returns trace of the request.
+       * @return Trace, or 0 if the request is not sampled
+       */
+      Trace *trace() { return m_trace; }
+
+    private:
+      /// Request type
+      Metric m_metric;
+
+      /// Start time (nanoseconds)
+      int64_t m_start;
+
+      /// Trace of sampled request
+      Trace *m_trace;
+
+      /// Trace that was current when the timer was created
+      Trace *m_saved_trace;
+    };
+
+    /** Returns name of a metric.
+     * @param metric Metric
+     * @return Name used in statistics and traces
+     */
+    static const char *name(Metric metric);
+
+    /** Records time elapsed since <code>start</code>.
+     * @param metric Request type or phase
+     * @param start Start time as returned by get_ts64()
+     * @param trace Trace to add the time to, may be 0
+     * @return Elapsed time (microseconds)
+     */
+    static uint64_t record(Metric metric, int64_t start, Trace *trace=0) {
+      int64_t elapsed = get_ts64() - start;
+      uint64_t usec = elapsed > 0 ? elapsed / 1000 : 0;
+      ms_histograms[metric].record(usec);
+      if (trace)
+        trace->add(metric, usec);
+      return usec;
+    }
+
+    /** Decides whether to trace the next request.
+     * @param request Request type
+     * @return New trace if the request is sampled, 0 otherwise
+     */
+    static Trace *sample(Metric request);
+
+    /** Sets the trace sampling interval.
+     * @param interval Trace every <code>interval</code>th request, 0
+     *        disables tracing
+     */
+    static void set_trace_interval(uint32_t interval);
+
+    /** Returns trace installed on the calling thread.
+     * @return Current trace, or 0 if none
+     */
+    static Trace *current_trace();
+
+    /** Gets histogram snapshots of all metrics.
+     * @param histograms Filled in with one snapshot per metric, keyed by
+     *        name()
+     */
+    static void get(std::map<String, LatencyHistogram::Snapshot> &histograms);
+
+  private:
+
+    /// Histograms, indexed by Metric
+    static LatencyHistogram ms_histograms[METRIC_COUNT];
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_LATENCYMETRICS_H
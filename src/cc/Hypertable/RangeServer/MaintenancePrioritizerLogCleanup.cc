@@ -104,8 +104,9 @@ MaintenancePrioritizerLogCleanup::prioritize(std::vector<RangeData> &range_data,
    *  If there is no update activity, or there is little update activity and
    *  scan activity, then increase the block cache size
    */
-  if (load_stats.update_bytes == 0 ||
-      (load_stats.update_bytes < 1000000 && load_stats.scan_count > 20)) {
+  if (!Global::memory_governor &&
+      (load_stats.update_bytes == 0 ||
+       (load_stats.update_bytes < 1000000 && load_stats.scan_count > 20))) {
     if (memory_state.balance < memory_state.limit) {
       int64_t available = memory_state.limit - memory_state.balance;
       if (Global::block_cache) {
@@ -165,6 +165,8 @@ MaintenancePrioritizerLowMemory::assign_priorities_all(std::vector<RangeData> &r
  *   3. compact remaining cell caches
  *   4. purge cell store indexes
  *
+ * When the MemoryGovernor is enabled, the order of "shrink block cache" and
+ * "purge cell store indexes" follows their measured marginal benefit.
  */
 
 void MaintenancePrioritizerLowMemory::assign_priorities_user(
@@ -182,14 +184,8 @@ void MaintenancePrioritizerLowMemory::assign_priorities_user(
     if (!compact_cellcaches(range_data, memory_state, priority, trace))
       return;
 
-    if (Global::block_cache) {
-      Global::block_cache->cap_memory_use();
-      memory_state.decrement_needed( Global::block_cache->decrease_limit(memory_state.needed) );
-      if (!memory_state.need_more())
-        return;
-    }
-
-    if (!purge_cellstore_indexes(range_data, memory_state, priority, trace))
+    if (!shrink_block_cache_and_purge_indexes(range_data, memory_state,
+                                              priority, trace))
       return;
 
   }
@@ -198,14 +194,8 @@ void MaintenancePrioritizerLowMemory::assign_priorities_user(
     HT_INFOF("WRITE workload prioritization (update_bytes=%llu, scan_count=%u)",
 	     (Llu)load_stats.update_bytes, (unsigned)load_stats.scan_count);
 
-    if (Global::block_cache) {
-      Global::block_cache->cap_memory_use();
-      memory_state.decrement_needed( Global::block_cache->decrease_limit(memory_state.needed) );
-      if (!memory_state.need_more())
-        return;
-    }
-
-    if (!purge_cellstore_indexes(range_data, memory_state, priority, trace))
+    if (!shrink_block_cache_and_purge_indexes(range_data, memory_state,
+                                              priority, trace))
       return;
 
     if (!compact_cellcaches(range_data, memory_state, priority, trace))
@@ -214,3 +204,29 @@ void MaintenancePrioritizerLowMemory::assign_priorities_user(
   }
 
 }
+
+
+bool MaintenancePrioritizerLowMemory::shrink_block_cache_and_purge_indexes(
+       std::vector<RangeData> &range_data, MemoryState &memory_state,
+       int32_t &priority, String *trace) {
+
+  bool indexes_first = Global::memory_governor &&
+    Global::memory_governor->purge_indexes_first();
+
+  if (indexes_first &&
+      !purge_cellstore_indexes(range_data, memory_state, priority, trace))
+    return false;
+
+  if (Global::block_cache) {
+    Global::block_cache->cap_memory_use();
+    memory_state.decrement_needed( Global::block_cache->decrease_limit(memory_state.needed) );
+    if (!memory_state.need_more())
+      return false;
+  }
+
+  if (!indexes_first &&
+      !purge_cellstore_indexes(range_data, memory_state, priority, trace))
+    return false;
+
+  return true;
+}
@@ -43,6 +43,15 @@ namespace Hypertable {
                                 MemoryState &memory_state,
                                 int32_t &priority, String *trace);
 
+    /** Shrinks the block cache and purges cell store indexes, in the order
+     * suggested by the MemoryGovernor if enabled, block cache first
+     * otherwise.
+     * @return <i>false</i> if enough memory has been freed
+     */
+    bool shrink_block_cache_and_purge_indexes(std::vector<RangeData> &range_data,
+                                              MemoryState &memory_state,
+                                              int32_t &priority, String *trace);
+
   };
 
 }
@@ -295,6 +295,18 @@ void MaintenanceScheduler::schedule() {
     }
   }
 
+  if (Global::memory_governor) {
+    MemoryGovernor::Usage usage;
+    usage.cell_cache = cell_cache_memory;
+    usage.block_index = block_index_memory;
+    usage.bloom_filter = bloom_filter_memory;
+    usage.shadow_cache = shadow_cache_memory;
+    usage.block_index_loads = Global::block_index_loads;
+    Global::memory_governor->rebalance(Global::memory_limit,
+                                       memory_state.balance, usage, low_memory,
+                                       debug ? &trace_str : 0);
+  }
+
   {
     int64_t block_cache_memory = Global::block_cache ? Global::block_cache->memory_used() : 0;
     int64_t total_memory = block_cache_memory + block_index_memory + bloom_filter_memory + cell_cache_memory + shadow_cache_memory + m_query_cache_memory;
@@ -0,0 +1,227 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for MemoryGovernor.
+ * This file contains the method definitions for MemoryGovernor, a class
+ * that divides the memory left over by CellCaches and CellStore indexes
+ * between the block cache and the query cache.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/Properties.h"
+
+#include "MemoryGovernor.h"
+
+#include <algorithm>
+
+using namespace Hypertable;
+
+MemoryGovernor::MemoryGovernor(FileBlockCache *block_cache,
+                               QueryCache *query_cache, int64_t step)
+  : m_block_cache(block_cache), m_query_cache(query_cache), m_step(step),
+    m_query_cache_min(0), m_last_block_cache_ghost_hits(0),
+    m_last_query_cache_ghost_hits(0), m_last_block_index_loads(0),
+    m_block_cache_benefit(0), m_query_cache_benefit(0),
+    m_block_index_cost(0.0) {
+  if (m_block_cache)
+    m_block_cache->set_ghost_capacity(m_step);
+  if (m_query_cache) {
+    m_query_cache->set_ghost_capacity(m_step);
+    m_query_cache_min = std::min((int64_t)m_query_cache->max_memory(), m_step);
+  }
+}
+
+
+void MemoryGovernor::rebalance(int64_t limit, int64_t balance,
+                               const Usage &usage, bool low_memory,
+                               String *trace) {
+  ScopedLock lock(m_mutex);
+  uint64_t ghost_hits;
+  int64_t block_cache_used = 0;
+  int64_t query_cache_used = 0;
+  int64_t block_cache_limit = 0;
+  int64_t query_cache_limit = 0;
+
+  if (m_block_cache) {
+    ghost_hits = m_block_cache->ghost_hits();
+    m_block_cache_benefit = ghost_hits - m_last_block_cache_ghost_hits;
+    m_last_block_cache_ghost_hits = ghost_hits;
+    block_cache_used = m_block_cache->memory_used();
+    block_cache_limit = m_block_cache->get_limit();
+  }
+
+  if (m_query_cache) {
+    ghost_hits = m_query_cache->ghost_hits();
+    m_query_cache_benefit = ghost_hits - m_last_query_cache_ghost_hits;
+    m_last_query_cache_ghost_hits = ghost_hits;
+    query_cache_used = m_query_cache->memory_used();
+    query_cache_limit = m_query_cache->max_memory();
+  }
+
+  m_block_index_cost = 0.0;
+  if (usage.block_index > 0)
+    m_block_index_cost =
+      (double)(usage.block_index_loads - m_last_block_index_loads) *
+      (double)m_step / (double)usage.block_index;
+  m_last_block_index_loads = usage.block_index_loads;
+
+  m_usage = usage;
+
+  if (trace) {
+    *trace += format("MemoryGovernor-block_cache_ghost_hits\t%llu\n",
+                     (Llu)m_block_cache_benefit);
+    *trace += format("MemoryGovernor-query_cache_ghost_hits\t%llu\n",
+                     (Llu)m_query_cache_benefit);
+    *trace += format("MemoryGovernor-block_index_cost\t%f\n",
+                     m_block_index_cost);
+  }
+
+  if (low_memory)
+    return;
+
+  // Memory not held by either cache, less one step of headroom
+  int64_t budget = limit - (balance - block_cache_used - query_cache_used)
+    - m_step;
+  if (budget < 0)
+    budget = 0;
+
+  int64_t block_cache_target = block_cache_limit;
+  int64_t query_cache_target = query_cache_limit;
+
+  compute_targets(budget, &block_cache_target, &query_cache_target);
+
+  if (trace) {
+    *trace += format("MemoryGovernor-budget\t%lld\n", (Lld)budget);
+    *trace += format("MemoryGovernor-block_cache_target\t%lld\n",
+                     (Lld)block_cache_target);
+    *trace += format("MemoryGovernor-query_cache_target\t%lld\n",
+                     (Lld)query_cache_target);
+  }
+
+  if (block_cache_target > block_cache_limit)
+    m_block_cache->increase_limit(block_cache_target - block_cache_limit);
+  else if (block_cache_target < block_cache_limit)
+    m_block_cache->decrease_limit(block_cache_limit - block_cache_target);
+
+  if (query_cache_target != query_cache_limit)
+    m_query_cache->set_max_memory(query_cache_target);
+
+  if (block_cache_target != block_cache_limit ||
+      query_cache_target != query_cache_limit)
+    HT_INFOF("MemoryGovernor: BlockCache %.2fMB -> %.2fMB (ghost hits %llu), "
+             "QueryCache %.2fMB -> %.2fMB (ghost hits %llu)",
+             (double)block_cache_limit / Property::MiB,
+             (double)block_cache_target / Property::MiB,
+             (Llu)m_block_cache_benefit,
+             (double)query_cache_limit / Property::MiB,
+             (double)query_cache_target / Property::MiB,
+             (Llu)m_query_cache_benefit);
+}
+
+
+void MemoryGovernor::compute_targets(int64_t budget,
+                                     int64_t *block_cache_target,
+                                     int64_t *query_cache_target) {
+  int64_t block_cache_min = 0;
+  int64_t block_cache_max = 0;
+  int64_t amount;
+
+  if (m_block_cache) {
+    block_cache_min = m_block_cache->get_min_memory();
+    block_cache_max = m_block_cache->get_max_memory();
+  }
+
+  // Move one step towards the cache that would have hit more often
+  if (m_block_cache && m_query_cache) {
+    if (m_block_cache_benefit > m_query_cache_benefit) {
+      amount = std::min(m_step, *query_cache_target - m_query_cache_min);
+      amount = std::min(amount, block_cache_max - *block_cache_target);
+      if (amount > 0) {
+        *query_cache_target -= amount;
+        *block_cache_target += amount;
+      }
+    }
+    else if (m_query_cache_benefit > m_block_cache_benefit) {
+      amount = std::min(m_step, *block_cache_target - block_cache_min);
+      if (amount > 0) {
+        *block_cache_target -= amount;
+        *query_cache_target += amount;
+      }
+    }
+  }
+
+  int64_t excess = *block_cache_target + *query_cache_target - budget;
+
+  if (excess > 0) {
+    // Shrink the cache with fewer ghost hits first
+    bool query_cache_first = m_query_cache &&
+      m_query_cache_benefit <= m_block_cache_benefit;
+    for (int i=0; i<2 && excess > 0; i++) {
+      if (query_cache_first == (i == 0)) {
+        if (m_query_cache) {
+          amount = std::min(excess, *query_cache_target - m_query_cache_min);
+          if (amount > 0) {
+            *query_cache_target -= amount;
+            excess -= amount;
+          }
+        }
+      }
+      else if (m_block_cache) {
+        amount = std::min(excess, *block_cache_target - block_cache_min);
+        if (amount > 0) {
+          *block_cache_target -= amount;
+          excess -= amount;
+        }
+      }
+    }
+  }
+  else if (excess < 0) {
+    // Give spare budget to the cache with more ghost hits
+    int64_t spare = -excess;
+    if (m_query_cache &&
+        (!m_block_cache || m_query_cache_benefit > m_block_cache_benefit))
+      *query_cache_target += spare;
+    else if (m_block_cache)
+      *block_cache_target += std::min(spare,
+                                      block_cache_max - *block_cache_target);
+  }
+}
+
+
+bool MemoryGovernor::purge_indexes_first() {
+  ScopedLock lock(m_mutex);
+  return m_block_index_cost < (double)m_block_cache_benefit;
+}
+
+
+void MemoryGovernor::get_allocation(std::map<String, int64_t> &allocation) {
+  ScopedLock lock(m_mutex);
+  allocation["BlockCache"] = m_block_cache ? m_block_cache->get_limit() : 0;
+  allocation["QueryCache"] =
+    m_query_cache ? (int64_t)m_query_cache->max_memory() : 0;
+  allocation["CellCache"] = m_usage.cell_cache;
+  allocation["BlockIndex"] = m_usage.block_index;
+  allocation["BloomFilter"] = m_usage.bloom_filter;
+  allocation["ShadowCache"] = m_usage.shadow_cache;
+}
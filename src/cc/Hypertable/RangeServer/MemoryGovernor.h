@@ -0,0 +1,170 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for MemoryGovernor.
+ * This file contains the type declarations for MemoryGovernor, a class that
+ * divides the memory left over by CellCaches and CellStore indexes between
+ * the block cache and the query cache.
+ */
+
+#ifndef HYPERTABLE_MEMORYGOVERNOR_H
+#define HYPERTABLE_MEMORYGOVERNOR_H
+
+#include "Common/Mutex.h"
+#include "Common/String.h"
+
+#include "FileBlockCache.h"
+#include "QueryCache.h"
+
+#include <map>
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Divides RangeServer memory between its consumers.
+   * CellCaches, block indexes, bloom filters and shadow caches hold data
+   * that cannot simply be dropped, so the memory they use is taken off the
+   * top.  What remains of the memory limit, less one step of headroom, is
+   * the budget of the block cache and the query cache.
+   *
+   * Both caches remember one step worth of recently evicted keys in a
+   * GhostCache.  The number of misses that hit the ghost during an interval
+   * is the number of hits one more step of memory would have bought, so the
+   * governor moves one step per interval from the cache with the lower count
+   * to the one with the higher count.  When the budget shrinks because
+   * CellCaches or indexes grew, the cache with the lower count is shrunk
+   * first; spare budget goes to the cache with the higher count.
+   *
+   * The same counts decide, when memory is low, whether purging CellStore
+   * block indexes is cheaper than shrinking the block cache (see
+   * purge_indexes_first()).
+   */
+  class MemoryGovernor {
+  public:
+
+    /// Memory used by consumers other than the block and query caches
+    struct Usage {
+      Usage() : cell_cache(0), block_index(0), bloom_filter(0),
+                shadow_cache(0), block_index_loads(0) { }
+      /// CellCache memory
+      int64_t cell_cache;
+      /// CellStore block index memory
+      int64_t block_index;
+      /// CellStore bloom filter memory
+      int64_t bloom_filter;
+      /// CellStore shadow cache memory
+      int64_t shadow_cache;
+      /// Cumulative number of block index loads
+      uint64_t block_index_loads;
+    };
+
+    /** Constructor.
+     * Sets the ghost capacity of both caches to <code>step</code>.
+     * @param block_cache Block cache, may be 0
+     * @param query_cache Query cache, may be 0
+     * @param step Amount of memory moved per interval
+     */
+    MemoryGovernor(FileBlockCache *block_cache, QueryCache *query_cache,
+                   int64_t step);
+
+    /** Measures marginal hit rates and adjusts cache limits.
+     * Called once per maintenance interval.  In low memory mode the hit
+     * rates are measured but the limits are left to the low memory
+     * prioritizer.
+     * @param limit RangeServer memory limit
+     * @param balance Memory currently in use
+     * @param usage Memory used by the other consumers
+     * @param low_memory <i>true</i> if in low memory mode
+     * @param trace Address of trace string, or 0
+     */
+    void rebalance(int64_t limit, int64_t balance, const Usage &usage,
+                   bool low_memory, String *trace);
+
+    /** Decides what to reclaim first in low memory mode.
+     * @return <i>true</i> if block indexes were loaded less often per byte
+     *         during the last interval than the block cache would have
+     *         hit per byte of additional memory
+     */
+    bool purge_indexes_first();
+
+    /** Gets current allocations.
+     * @param allocation Filled in with bytes per consumer: the limits of the
+     *        block and query caches and the usage of the other consumers
+     */
+    void get_allocation(std::map<String, int64_t> &allocation);
+
+  private:
+
+    /** Computes cache targets that fit the budget.
+     * @param budget Memory available to both caches
+     * @param block_cache_target Address of block cache target
+     * @param query_cache_target Address of query cache target
+     */
+    void compute_targets(int64_t budget, int64_t *block_cache_target,
+                         int64_t *query_cache_target);
+
+    /// %Mutex protecting members
+    Mutex m_mutex;
+
+    /// Block cache
+    FileBlockCache *m_block_cache;
+
+    /// Query cache
+    QueryCache *m_query_cache;
+
+    /// Amount of memory moved per interval
+    int64_t m_step;
+
+    /// Smallest query cache limit, so that it keeps producing ghost hits
+    int64_t m_query_cache_min;
+
+    /// Block cache ghost hits at end of last interval
+    uint64_t m_last_block_cache_ghost_hits;
+
+    /// Query cache ghost hits at end of last interval
+    uint64_t m_last_query_cache_ghost_hits;
+
+    /// Block index loads at end of last interval
+    uint64_t m_last_block_index_loads;
+
+    /// Block cache ghost hits during last interval
+    uint64_t m_block_cache_benefit;
+
+    /// Query cache ghost hits during last interval
+    uint64_t m_query_cache_benefit;
+
+    /// Block index loads during last interval, per step of index memory
+    double m_block_index_cost;
+
+    /// Most recent usage of the other consumers
+    Usage m_usage;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_MEMORYGOVERNOR_H
@@ -46,18 +46,7 @@ bool QueryCache::insert(Key *key, const char *tablename, const char *row,
     hash_index.erase(lookup_iter);
   }
 
-  // make room
-  if (m_avail_memory < length) {
-    Cache::iterator iter = m_cache.begin();
-    while (iter != m_cache.end()) {
-      m_avail_memory += (*iter).result_length + OVERHEAD + strlen((*iter).row_key.row);
-      iter = m_cache.erase(iter);
-      if (m_avail_memory >= length)
-	break;
-    }
-  }
-
-  if (m_avail_memory < length)
+  if (!make_room(length))
     return false;
 
   QueryCacheEntry entry(*key, tablename, row, result, result_length);
@@ -87,8 +76,10 @@ bool QueryCache::lookup(Key *key, boost::shared_array<uint8_t> &result,
 
   m_total_lookup_count++;
 
-  if ((iter = hash_index.find(*key)) == hash_index.end())
+  if ((iter = hash_index.find(*key)) == hash_index.end()) {
+    m_ghost.hit(*key);
     return false;
+  }
 
   QueryCacheEntry entry = *iter;
 
@@ -105,6 +96,31 @@ bool QueryCache::lookup(Key *key, boost::shared_array<uint8_t> &result,
   return true;
 }
 
+void QueryCache::set_max_memory(uint64_t max_memory) {
+  ScopedLock lock(m_mutex);
+  uint64_t memory_used = m_max_memory - m_avail_memory;
+  m_max_memory = max_memory;
+  if (memory_used > max_memory) {
+    m_avail_memory = 0;
+    make_room(memory_used - max_memory);
+    m_avail_memory -= memory_used - max_memory;
+  }
+  else
+    m_avail_memory = max_memory - memory_used;
+}
+
+bool QueryCache::make_room(uint64_t length) {
+  Cache::iterator iter = m_cache.begin();
+  uint64_t entry_length;
+  while (m_avail_memory < length && iter != m_cache.end()) {
+    entry_length = (*iter).result_length + OVERHEAD + strlen((*iter).row_key.row);
+    m_avail_memory += entry_length;
+    m_ghost.insert((*iter).key, entry_length);
+    iter = m_cache.erase(iter);
+  }
+  return m_avail_memory >= length;
+}
+
 void QueryCache::get_stats(uint64_t *max_memoryp, uint64_t *available_memoryp,
                            uint64_t *total_lookupsp, uint64_t *total_hitsp)
 {
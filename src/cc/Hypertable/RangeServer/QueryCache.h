@@ -36,6 +36,8 @@
 #include "Common/atomic.h"
 #include "Common/Checksum.h"
 
+#include "GhostCache.h"
+
 namespace Hypertable {
   using namespace boost::multi_index;
 
@@ -81,11 +83,39 @@ namespace Hypertable {
 
     uint64_t memory_used() { ScopedLock lock(m_mutex); return m_max_memory-m_avail_memory; }
 
+    uint64_t max_memory() { ScopedLock lock(m_mutex); return m_max_memory; }
+
+    /**
+     * Changes the memory limit, evicting least recently used results if the
+     * cache no longer fits.
+     *
+     * @param max_memory New memory limit
+     */
+    void set_max_memory(uint64_t max_memory);
+
+    /**
+     * Sets the amount of evicted result data remembered to measure how many
+     * misses additional memory would have turned into hits.
+     *
+     * @param capacity Ghost capacity in bytes, 0 disables ghost tracking
+     */
+    void set_ghost_capacity(int64_t capacity) {
+      ScopedLock lock(m_mutex);
+      m_ghost.set_capacity(capacity);
+    }
+
+    /**
+     * Returns the number of misses on recently evicted results.
+     */
+    uint64_t ghost_hits() { ScopedLock lock(m_mutex); return m_ghost.hits(); }
+
     void get_stats(uint64_t *max_memoryp, uint64_t *available_memoryp,
                    uint64_t *total_lookupsp, uint64_t *total_hitsp);
 
   private:
 
+    bool make_room(uint64_t length);
+
     class QueryCacheEntry {
     public:
       QueryCacheEntry(Key &k, const char *tname, const char *rw,
@@ -129,6 +159,7 @@ namespace Hypertable {
 
     Mutex     m_mutex;
     Cache     m_cache;
+    GhostCache<Key, KeyHash> m_ghost;
     uint64_t  m_max_memory;
     uint64_t  m_avail_memory;
     uint64_t  m_total_lookup_count;
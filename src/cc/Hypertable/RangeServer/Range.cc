@@ -515,6 +515,45 @@ CellListScanner *Range::create_scanner(ScanContextPtr &scan_ctx) {
   return mscanner;
 }
 
+void Range::create_row_lookups(RowLookupVector &lookups) {
+  AccessGroupVector ag_vector(0);
+
+  HT_ASSERT(m_initialized);
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    ag_vector = m_access_group_vector;
+  }
+
+  lookups.clear();
+  lookups.reserve(ag_vector.size());
+  foreach_ht (AccessGroupPtr &ag, ag_vector)
+    lookups.push_back(ag->create_row_lookup());
+}
+
+CellListScanner *Range::create_row_scanner(RowLookupVector &lookups,
+                                           ScanContextPtr &scan_ctx) {
+  MergeScanner *mscanner = new MergeScannerRange(scan_ctx);
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    m_scans++;
+  }
+
+  try {
+    foreach_ht (AccessGroup::RowLookupPtr &lookup, lookups) {
+      if (lookup->access_group()->include_in_scan(scan_ctx))
+        mscanner->add_scanner(lookup->create_scanner(scan_ctx));
+    }
+  }
+  catch (Exception &e) {
+    delete mscanner;
+    HT_THROW2(e.code(), e, "");
+  }
+
+  return mscanner;
+}
+
 CellListScanner *Range::create_scanner_pseudo_table(ScanContextPtr &scan_ctx,
                                                     const String &table_name) {
   CellListScannerBuffer *scanner = 0;
@@ -1204,10 +1243,16 @@ void Range::split_compact_and_shrink() {
   std::vector<AccessGroup::Hints> hints(ag_vector.size());
 
   /**
-   * Perform major compactions
+   * Perform major compactions, or, for copy-free splits, just flush the
+   * cell caches.  In the latter case both halves reference the existing
+   * CellStores with restricted ranges (see AccessGroup::shrink) and the
+   * stores get rewritten later by merging compactions
+   * (see AccessGroup::find_merge_run)
    */
+  int compaction_type = Global::copy_free_split ?
+    MaintenanceFlag::COMPACT_MINOR : MaintenanceFlag::COMPACT_MAJOR;
   for (size_t i=0; i<ag_vector.size(); i++)
-    ag_vector[i]->run_compaction(MaintenanceFlag::COMPACT_MAJOR|MaintenanceFlag::SPLIT,
+    ag_vector[i]->run_compaction(compaction_type|MaintenanceFlag::SPLIT,
                                  &hints[i]);
 
   m_hints_file.set(hints);
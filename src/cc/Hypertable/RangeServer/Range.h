@@ -132,6 +132,28 @@ namespace Hypertable {
 
     CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
 
+    /// Row lookups of the access groups, for a batch of single row reads
+    typedef std::vector<AccessGroup::RowLookupPtr> RowLookupVector;
+
+    /** Prepares a batch of single row reads.
+     * Creates a AccessGroup::RowLookup on each access group, so the access
+     * group state is pinned once for all of the keys of a multi get request.
+     * @param lookups Filled with the row lookup of each access group
+     */
+    void create_row_lookups(RowLookupVector &lookups);
+
+    /** Creates a scanner for one row of a batch of single row reads.
+     * Only the access groups holding a column family of the scan are read,
+     * each through AccessGroup::RowLookup::create_scanner().
+     * @note The scanner that is returned by this method will be owned by the
+     * caller and must be freed by the caller to prevent a memory leak.
+     * @param lookups Row lookups from create_row_lookups()
+     * @param scan_ctx Single row scan context
+     * @return Pointer to CellListScanner (to be freed by caller)
+     */
+    CellListScanner *create_row_scanner(RowLookupVector &lookups,
+                                        ScanContextPtr &scan_ctx);
+
     /** Creates a scanner over the pseudo-table indicated by
      * <code>table_name</code>.  The following pseudo-tables are supported:
      *
@@ -44,6 +44,7 @@
 #include <Hypertable/RangeServer/MetaLogEntityRemoveOkLogs.h>
 #include <Hypertable/RangeServer/MetaLogEntityTask.h>
 #include <Hypertable/RangeServer/ReplayBuffer.h>
+#include <Hypertable/RangeServer/RequestHandlerFetchScanblockStream.h>
 #include <Hypertable/RangeServer/ScanContext.h>
 #include <Hypertable/RangeServer/TableSchemaCache.h>
 #include <Hypertable/RangeServer/UpdateThread.h>
@@ -58,10 +59,12 @@
 #include <Hypertable/Lib/RangeRecoveryReceiverPlan.h>
 
 #include <DfsBroker/Lib/Client.h>
+#include <DfsBroker/Lib/LocalFilesystem.h>
 
 #include <Common/FailureInducer.h>
 #include <Common/FileUtils.h>
 #include <Common/md5.h>
+#include <Common/Path.h>
 #include <Common/Random.h>
 #include <Common/StringExt.h>
 #include <Common/SystemInfo.h>
@@ -122,6 +125,7 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
     = cfg.get_bool("Range.IgnoreCellsWithClockSkew");
   Global::failover_timeout = props->get_i32("Hypertable.Failover.Timeout");
   Global::range_split_size = cfg.get_i64("Range.SplitSize");
+  Global::copy_free_split = cfg.get_bool("Range.CopyFreeSplit");
   Global::range_maximum_size = cfg.get_i64("Range.MaximumSize");
   Global::range_metadata_split_size = cfg.get_i64("Range.MetadataSplitSize",
           Global::range_split_size);
@@ -135,6 +139,7 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
   m_scanner_buffer_size = cfg.get_i64("Scanner.BufferSize");
   port = cfg.get_i16("Port");
   m_update_coalesce_limit = cfg.get_i64("UpdateCoalesceLimit");
+  LatencyMetrics::set_trace_interval(cfg.get_i32("Trace.SampleInterval"));
   m_maintenance_pause_interval = cfg.get_i32("Testing.MaintenanceNeeded.PauseInterval");
 
   m_control_file_check_interval = cfg.get_i32("ControlFile.CheckInterval");
@@ -238,7 +243,8 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   if (block_cache_max > 0)
     Global::block_cache = new FileBlockCache(block_cache_min, block_cache_max,
-					     cfg.get_bool("BlockCache.Compressed"));
+					     cfg.get_bool("BlockCache.Compressed"),
+					     cfg.get_bool("BlockCache.Decoded"));
 
   int64_t query_cache_memory = cfg.get_i64("QueryCache.MaxMemory");
   if (query_cache_memory > 0) {
@@ -253,6 +259,13 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   Global::memory_tracker = new MemoryTracker(Global::block_cache, m_query_cache);
 
+  if (cfg.get_bool("MemoryGovernor.Enable")) {
+    int64_t step = (Global::memory_limit / 100) *
+      std::max(1, std::min(cfg.get_i32("MemoryGovernor.StepPercentage"), 50));
+    Global::memory_governor =
+      new MemoryGovernor(Global::block_cache, m_query_cache, step);
+  }
+
   Global::protocol = new Hypertable::RangeServerProtocol();
 
   DfsBroker::Client *dfsclient = new DfsBroker::Client(conn_mgr, props);
@@ -268,6 +281,27 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   Global::dfs = dfsclient;
 
+  // With a local broker on this host, read files directly instead of
+  // through it
+  if (props->get_bool("DfsBroker.Local.InProcessReads")) {
+    Path root = props->get_str("DfsBroker.Local.Root", "");
+    if (!root.is_complete())
+      root = Path(props->get_str("Hypertable.DataDirectory")) / root;
+    String host = props->get_str("DfsBroker.Host");
+    InetAddr broker_addr(host, props->get_i16("DfsBroker.Port"));
+    InetAddr primary_addr(System::net_info().primary_addr, 0);
+    if ((ntohl(broker_addr.sin_addr.s_addr) >> 24) != 127 &&
+        broker_addr.sin_addr.s_addr != primary_addr.sin_addr.s_addr)
+      HT_WARNF("Ignoring DfsBroker.Local.InProcessReads, DFS broker %s is "
+               "not on this host", host.c_str());
+    else if (!DfsBroker::LocalFilesystem::shares_root(Global::dfs,
+                                                      root.string()))
+      HT_WARNF("Ignoring DfsBroker.Local.InProcessReads, DFS broker does "
+               "not keep its files under %s", root.string().c_str());
+    else
+      Global::dfs = new DfsBroker::LocalFilesystem(Global::dfs, root.string());
+  }
+
   m_log_roll_limit = cfg.get_i64("CommitLog.RollLimit");
 
   /**
@@ -437,6 +471,11 @@ void RangeServer::shutdown() {
       */
     }
 
+    if (Global::memory_governor) {
+      delete Global::memory_governor;
+      Global::memory_governor = 0;
+    }
+
     if (Global::block_cache) {
       delete Global::block_cache;
       Global::block_cache = 0;
@@ -533,28 +572,34 @@ namespace {
     }
   };
 
-  void add_mark_file_to_commit_logs(const String &logname) {
+  /** Removes zero-length fragments of a log directory.
+   * @param logdir Log directory
+   * @param stripe_dirs Stripe directories found in <code>logdir</code> are
+   *        added to this vector, if non-NULL
+   * @return Largest number of the remaining fragments, -1 if none
+   */
+  long remove_empty_fragments(const String &logdir,
+                              vector<String> *stripe_dirs) {
     vector<Filesystem::Dirent> listing;
-    vector<Filesystem::Dirent> listing2;
-    String logdir = Global::log_dir + "/" + logname;
+    long max_num = -1;
 
     try {
-      if (!Global::log_dfs->exists(logdir))
-        return;
       Global::log_dfs->readdir(logdir, listing);
     }
     catch (Hypertable::Exception &e) {
       HT_FATALF("Unable to read log directory '%s'", logdir.c_str());
     }
 
-    if (listing.size() == 0)
-      return;
-
     sort(listing.begin(), listing.end(), ByFragmentNumber());
 
     // Remove zero-length files
     foreach_ht (Filesystem::Dirent &entry, listing) {
       String fragment_file = logdir + "/" + entry.name;
+      if (CommitLog::is_stripe_dir(entry.name)) {
+        if (stripe_dirs)
+          stripe_dirs->push_back(fragment_file);
+        continue;
+      }
       try {
         if (Global::log_dfs->length(fragment_file) == 0) {
           HT_INFOF("Removing log fragment '%s' because it has zero length",
@@ -562,18 +607,36 @@ namespace {
           Global::log_dfs->remove(fragment_file);
         }
         else
-          listing2.push_back(entry);
+          max_num = std::max(max_num, strtol(entry.name.c_str(), 0, 10));
       }
       catch (Hypertable::Exception &e) {
         HT_FATALF("Unable to check fragment file '%s'", fragment_file.c_str());
       }
     }
 
-    if (listing2.size() == 0)
+    return max_num;
+  }
+
+  void add_mark_file_to_commit_logs(const String &logname) {
+    vector<String> stripe_dirs;
+    String logdir = Global::log_dir + "/" + logname;
+
+    try {
+      if (!Global::log_dfs->exists(logdir))
+        return;
+    }
+    catch (Hypertable::Exception &e) {
+      HT_FATALF("Unable to read log directory '%s'", logdir.c_str());
+    }
+
+    // The mark covers the fragments of all stripes of the log
+    long num = remove_empty_fragments(logdir, &stripe_dirs);
+    foreach_ht (const String &stripe_dir, stripe_dirs)
+      num = std::max(num, remove_empty_fragments(stripe_dir, 0));
+
+    if (num == -1)
       return;
 
-    char *endptr;
-    long num = strtol(listing2.back().name.c_str(), &endptr, 10);
     String mark_filename = logdir + "/" + (int64_t)num + ".mark";
 
     try {
@@ -878,7 +941,8 @@ void RangeServer::local_recover() {
       m_live_map->merge(&replay_map);
 
       Global::user_log = new CommitLog(Global::log_dfs, Global::log_dir
-                                       + "/user", m_props, user_log_reader.get(), false);
+                                       + "/user", m_props, user_log_reader.get(), false,
+                                       std::max(1, m_props->get_i32("Hypertable.RangeServer.CommitLog.Stripes")));
 
       {
         ScopedLock lock(m_mutex);
@@ -916,7 +980,8 @@ void RangeServer::local_recover() {
             + "/system", m_props, system_log_reader.get());
 
       Global::user_log = new CommitLog(Global::log_dfs, Global::log_dir
-          + "/user", m_props, user_log_reader.get(), false);
+          + "/user", m_props, user_log_reader.get(), false,
+          std::max(1, m_props->get_i32("Hypertable.RangeServer.CommitLog.Stripes")));
 
       Global::rsml_writer = new MetaLog::Writer(Global::log_dfs, rsml_definition,
                                                 Global::log_dir + "/" + rsml_definition->name(),
@@ -1408,10 +1473,15 @@ RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
   SchemaPtr schema;
   ScanContextPtr scan_ctx;
   bool decrement_needed=false;
+  LatencyMetrics::RequestTimer request_timer(LatencyMetrics::CREATE_SCANNER);
 
   HT_DEBUG_OUT <<"Creating scanner:\n"<< *table << *range_spec
                << *scan_spec << HT_END;
 
+  if (request_timer.trace())
+    request_timer.trace()->set_description(format("%s[%s..%s]", table->id,
+                                  range_spec->start_row, range_spec->end_row));
+
   if (!m_replay_finished) {
     if (!wait_for_recovery_finish(table, range_spec, cb->get_event()->expiration_time()))
       return;
@@ -1571,6 +1641,162 @@ RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
   }
 }
 
+void
+RangeServer::multi_get(ResponseCallbackMultiGet *cb,
+        const TableIdentifier *table, const RangeSpec *range_spec,
+        uint32_t max_versions, const std::vector<const char *> &rows,
+        const std::vector<const char *> &columns) {
+  int error = Error::OK;
+  TableInfoPtr table_info;
+  RangePtr range;
+  SchemaPtr schema;
+  bool decrement_needed = false;
+  LatencyMetrics::RequestTimer request_timer(LatencyMetrics::MULTI_GET);
+
+  HT_DEBUG_OUT << "Multi get of " << rows.size() << " keys:\n" << *table
+               << *range_spec << HT_END;
+
+  if (request_timer.trace())
+    request_timer.trace()->set_description(format("%s[%s..%s] keys=%u",
+        table->id, range_spec->start_row, range_spec->end_row,
+        (unsigned)rows.size()));
+
+  if (!m_replay_finished) {
+    if (!wait_for_recovery_finish(table, range_spec, cb->get_event()->expiration_time()))
+      return;
+  }
+
+  try {
+    DynamicBuffer rbuf;
+    uint32_t keys_completed = 0;
+    uint64_t cells_scanned = 0, cells_returned = 0;
+    uint64_t bytes_scanned = 0, bytes_returned = 0, disk_read = 0;
+
+    HT_ASSERT(rows.size() == columns.size());
+
+    if (!m_live_map->lookup(table->id, table_info))
+      HT_THROW(Error::TABLE_NOT_FOUND, table->id);
+
+    if (!table_info->get_range(range_spec, range))
+      HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND, "(a) %s[%s..%s]",
+                table->id, range_spec->start_row, range_spec->end_row);
+
+    schema = table_info->get_schema();
+
+    if (schema->get_generation() != table->generation) {
+      HT_THROWF(Error::RANGESERVER_GENERATION_MISMATCH,
+                "RangeServer Schema generation for table '%s'"
+                " is %lld but supplied is %lld",
+                table->id, (Lld)schema->get_generation(),
+                (Lld)table->generation);
+    }
+
+    range->deferred_initialization(cb->get_event()->header.timeout_ms);
+
+    if (!range->increment_scan_counter())
+      HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND,
+                "Range %s[%s..%s] dropped or relinquished",
+                table->id, range_spec->start_row, range_spec->end_row);
+
+    decrement_needed = true;
+
+    String start_row, end_row;
+    range->get_boundary_rows(start_row, end_row);
+
+    // Check to see if range just shrunk
+    if (strcmp(start_row.c_str(), range_spec->start_row) ||
+        strcmp(end_row.c_str(), range_spec->end_row))
+      HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND, "(b) %s[%s..%s]",
+                table->id, range_spec->start_row, range_spec->end_row);
+
+    // All keys are read as of the same revision
+    int64_t revision =
+      range->get_scan_revision(cb->get_event()->header.timeout_ms);
+
+    // The access group caches and cell stores are pinned once for the
+    // batch; every key then only reads the cell stores whose bloom filter
+    // may contain it, through their block indexes
+    Range::RowLookupVector lookups;
+    range->create_row_lookups(lookups);
+
+    // Reserve space for the block length
+    rbuf.ensure(4);
+    rbuf.ptr += 4;
+
+    ScanSpec scan_spec;
+    scan_spec.max_versions = max_versions;
+
+    for (size_t i=0; i<rows.size(); i++) {
+      scan_spec.row_intervals.clear();
+      scan_spec.row_intervals.push_back(RowInterval(rows[i], true,
+                                                    rows[i], true));
+      scan_spec.columns.clear();
+      if (*columns[i])
+        scan_spec.columns.push_back(columns[i]);
+
+      ScanContextPtr scan_ctx = new ScanContext(revision, &scan_spec,
+                                                range_spec, schema);
+      scan_ctx->timeout_ms = cb->get_event()->header.timeout_ms;
+
+      CellListScannerPtr scanner =
+        range->create_row_scanner(lookups, scan_ctx);
+
+      // A single row may exceed the buffer size, drain it completely
+      bool more = true;
+      while (more) {
+        DynamicBuffer kbuf;
+        more = FillScanBlock(scanner, kbuf, m_scanner_buffer_size);
+        if (kbuf.fill() > 4)
+          rbuf.add(kbuf.base + 4, kbuf.fill() - 4);
+      }
+
+      MergeScanner *mscanner = static_cast<MergeScanner *>(scanner.get());
+      uint64_t key_cells_scanned, key_cells_returned;
+      uint64_t key_bytes_scanned, key_bytes_returned;
+      mscanner->get_io_accounting_data(&key_bytes_scanned,
+          &key_bytes_returned, &key_cells_scanned, &key_cells_returned);
+      cells_scanned += key_cells_scanned;
+      cells_returned += key_cells_returned;
+      bytes_scanned += key_bytes_scanned;
+      bytes_returned += key_bytes_returned;
+      disk_read += mscanner->get_disk_read();
+
+      keys_completed++;
+      if (rbuf.fill() >= (size_t)m_scanner_buffer_size + 4)
+        break;
+    }
+
+    lookups.clear();
+    range->decrement_scan_counter();
+    decrement_needed = false;
+
+    {
+      Locker<LoadStatistics> lock(*Global::load_statistics);
+      Global::load_statistics->add_scan_data(keys_completed, cells_scanned,
+                                             bytes_scanned);
+      range->add_read_data(cells_scanned, cells_returned, bytes_scanned,
+                           bytes_returned, disk_read);
+    }
+
+    uint8_t *ptr = rbuf.base;
+    Serialization::encode_i32(&ptr, rbuf.fill() - 4);
+
+    StaticBuffer ext(rbuf);
+    if ((error = cb->response(keys_completed, ext)) != Error::OK)
+      HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
+  }
+  catch (Hypertable::Exception &e) {
+    if (decrement_needed)
+      range->decrement_scan_counter();
+    if (e.code() == Error::RANGESERVER_RANGE_NOT_FOUND)
+      HT_INFOF("Range not found - %s", e.what());
+    else
+      HT_ERROR_OUT << e << HT_END;
+    if ((error = cb->error(e.code(), e.what())) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+  }
+}
+
 void
 RangeServer::destroy_scanner(ResponseCallback *cb, uint32_t scanner_id) {
   HT_DEBUGF("destroying scanner id=%u", scanner_id);
@@ -1580,13 +1806,12 @@ RangeServer::destroy_scanner(ResponseCallback *cb, uint32_t scanner_id) {
 
 void
 RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
-        uint32_t scanner_id) {
+        uint32_t scanner_id, uint32_t window) {
   String errmsg;
   int error = Error::OK;
   CellListScannerPtr scanner;
   RangePtr range;
   bool more = true;
-  DynamicBuffer rbuf;
   TableInfoPtr table_info;
   TableIdentifierManaged scanner_table;
   SchemaPtr schema;
@@ -1615,27 +1840,40 @@ RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
                       schema->get_generation(), scanner_table.generation));
     }
 
-    uint64_t cells_scanned, cells_returned, bytes_scanned, bytes_returned;
-
-    more = FillScanBlock(scanner, rbuf, m_scanner_buffer_size);
-
     MergeScanner *mscanner = dynamic_cast<MergeScanner*>(scanner.get());
 
     assert(mscanner);
 
+    LatencyMetrics::RequestTimer
+      request_timer(LatencyMetrics::FETCH_SCANBLOCK);
+    DynamicBuffer rbuf;
+
+    if (request_timer.trace())
+      request_timer.trace()->set_description(format("scanner=%u", scanner_id));
+
+    uint64_t cells_scanned, cells_returned, bytes_scanned, bytes_returned;
+
+    more = FillScanBlock(scanner, rbuf, m_scanner_buffer_size);
+
     mscanner->get_io_accounting_data(&bytes_scanned, &bytes_returned,
                                      &cells_scanned, &cells_returned);
 
     {
       Locker<LoadStatistics> lock(*Global::load_statistics);
       Global::load_statistics->add_scan_data(0, cells_scanned, bytes_scanned);
-      range->add_read_data(cells_scanned, cells_returned, bytes_scanned, bytes_returned,
+      range->add_read_data(cells_scanned, cells_returned, bytes_scanned,
+                           bytes_returned,
                            more ? 0 : mscanner->get_disk_read());
     }
 
     if (!more)
       Global::scanner_map.remove(scanner_id);
 
+    // A "fetch scanblock stream" request gets up to window blocks pushed
+    // back, one response each; all but the last are flagged as stream
+    // responses so the client keeps the request pending
+    bool stream = more && window > 1;
+
     /**
      *  Send back data
      */
@@ -1643,14 +1881,24 @@ RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
       short moreflag = more ? 0 : 1;
       StaticBuffer ext(rbuf);
 
-      error = cb->response(moreflag, scanner_id, ext);
-      if (error != Error::OK)
+      error = cb->response(moreflag, scanner_id, ext, stream);
+      if (error != Error::OK) {
         HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
-
-      HT_DEBUGF("Successfully fetched %u bytes (%lld k/v pairs) of scan data",
-                ext.size-4, (Lld)cells_returned);
+        stream = false;
+      }
+      else
+        HT_DEBUGF("Successfully fetched %u bytes (%lld k/v pairs) of scan data",
+                  ext.size-4, (Lld)cells_returned);
     }
 
+    // The next block of the window is filled by a handler queued behind
+    // the requests that arrived in the meantime, so that a long stream
+    // doesn't hold on to an application queue thread; it carries the
+    // scanner's group id and so still runs after this one
+    if (stream)
+      m_app_queue->add(new RequestHandlerFetchScanblockStream(m_comm, this,
+                           cb->get_event(), window - 1));
+
   }
   catch (Hypertable::Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -2164,7 +2412,10 @@ void RangeServer::update_qualify_and_transform() {
   SerializedKey key;
   const uint8_t *mod, *mod_end;
   const char *row;
-  String start_row, end_row;
+  RangeSnapshotPtr range_snapshot;
+  const RangeInfo *range_info;
+  size_t range_hint;
+  SchemaPtr schema;
   RangeUpdateList *rulist;
   int error = Error::OK;
   int64_t latest_range_revision;
@@ -2176,7 +2427,6 @@ void RangeServer::update_qualify_and_transform() {
   uint32_t root_buf_reset_offset;
   CommitLogPtr transfer_log;
   RangeUpdate range_update;
-  RangePtr range;
   Mutex &mutex = m_update_qualify_queue_mutex;
   boost::condition &cond = m_update_qualify_queue_cond;
   std::list<UpdateContext *> &queue = m_update_qualify_queue;
@@ -2193,6 +2443,7 @@ void RangeServer::update_qualify_and_transform() {
       queue.pop_front();
     }
 
+    uc->phase_start_ns = Hypertable::get_ts64();
     rulist = 0;
     transfer_bufp = 0;
     go_buf_reset_offset = 0;
@@ -2235,16 +2486,21 @@ void RangeServer::update_qualify_and_transform() {
       }
 
       // verify schema
-      if (table_update->table_info->get_schema()->get_generation() !=
-          table_update->id.generation) {
+      schema = table_update->table_info->get_schema();
+      if (schema->get_generation() != table_update->id.generation) {
         table_update->error = Error::RANGESERVER_GENERATION_MISMATCH;
         table_update->error_msg =
           format("Update schema generation mismatch for table %s (received %u != %u)",
                  table_update->id.id, table_update->id.generation,
-                 table_update->table_info->get_schema()->get_generation());
+                 schema->get_generation());
         continue;
       }
 
+      // Classify rows against a snapshot of the range boundaries, starting
+      // with the range of the previous row
+      range_snapshot = table_update->table_info->get_range_snapshot();
+      range_hint = 0;
+
       // Pre-allocate the go_buf - each key could expand by 8 or 9 bytes,
       // if auto-assigned (8 for the ts or rev and maybe 1 for possible
       // increase in vint length)
@@ -2299,9 +2555,8 @@ void RangeServer::update_qualify_and_transform() {
           }
 
           // Look for containing range, add to stop mods if not found
-          if (!table_update->table_info->find_containing_range(row, range,
-                                                          start_row, end_row) ||
-              range->get_relinquish()) {
+          range_info = range_snapshot->find(row, &range_hint);
+          if (!range_info || range_info->range->get_relinquish()) {
             if (uc->send_back.error != Error::RANGESERVER_OUT_OF_RANGE
                 && uc->send_back.count > 0) {
               uc->send_back.len = (mod - request->buffer.base) - uc->send_back.offset;
@@ -2319,10 +2574,10 @@ void RangeServer::update_qualify_and_transform() {
             continue;
           }
 
-          if ((rulist = table_update->range_map[range.get()]) == 0) {
+          if ((rulist = table_update->range_map[range_info->range.get()]) == 0) {
             rulist = new RangeUpdateList();
-            rulist->range = range;
-            table_update->range_map[range.get()] = rulist;
+            rulist->range = range_info->range;
+            table_update->range_map[range_info->range.get()] = rulist;
           }
 
           if (table_update->wait_for_metadata_recovery && !rulist->range->is_root()) {
@@ -2379,17 +2634,20 @@ void RangeServer::update_qualify_and_transform() {
               continue;
             }
             rulist->range_blocked = true;
-          }
-
-          String range_start_row, range_end_row;
-          rulist->range->get_boundary_rows(range_start_row, range_end_row);
 
-          // Make sure range didn't just shrink
-          if (range_start_row != start_row || range_end_row != end_row) {
-            rulist->range->decrement_update_counter();
-            table_update->range_map.erase(rulist->range.get());
-            delete rulist;
-            continue;
+            // Make sure range didn't just shrink.  Boundaries cannot change
+            // while the update counter is held, so this is checked once per
+            // range.
+            String range_start_row, range_end_row;
+            rulist->range->get_boundary_rows(range_start_row, range_end_row);
+            if (range_start_row != range_info->start_row ||
+                range_end_row != range_info->end_row) {
+              rulist->range->decrement_update_counter();
+              table_update->range_map.erase(rulist->range.get());
+              delete rulist;
+              range_snapshot = table_update->table_info->get_range_snapshot();
+              continue;
+            }
           }
 
           /** Fetch range transfer information **/
@@ -2469,7 +2727,8 @@ void RangeServer::update_qualify_and_transform() {
           range_update.offset = cur_bufp->fill();
 
           while (mod < mod_end &&
-                 (end_row == "" || (strcmp(row, end_row.c_str()) <= 0))) {
+                 (range_info->end_row.empty() ||
+                  strcmp(row, range_info->end_row.c_str()) <= 0)) {
 
             if (transfer_pending) {
 
@@ -2497,7 +2756,6 @@ void RangeServer::update_qualify_and_transform() {
             }
 
             try {
-              SchemaPtr schema = table_update->table_info->get_schema();
               uint8_t family=*(key.ptr+1+strlen((const char *)key.ptr+1)+1);
               Schema::ColumnFamily *cf = schema->get_column_family(family);
 
@@ -2594,8 +2852,15 @@ void RangeServer::update_qualify_and_transform() {
         uc->total_added += table_update->total_added;
     }
 
+    // Don't hold on to ranges while waiting for the next batch
+    range_snapshot = 0;
+    schema = 0;
+
     uc->last_revision = m_last_revision;
 
+    LatencyMetrics::record(LatencyMetrics::UPDATE_QUALIFY, uc->phase_start_ns,
+                           uc->trace);
+
     // Enqueue update
     {
       ScopedLock lock(m_update_commit_queue_mutex);
@@ -2691,7 +2956,11 @@ void RangeServer::update_commit() {
           log = Global::system_log;
         }
 
-        if ((error = log->write(table_update->go_buf, uc->last_revision, sync)) != Error::OK) {
+        int64_t write_start = Hypertable::get_ts64();
+        error = log->write(table_update->go_buf, uc->last_revision, sync);
+        LatencyMetrics::record(LatencyMetrics::COMMIT_LOG_WRITE, write_start,
+                               uc->trace);
+        if (error != Error::OK) {
           table_update->error_msg = format("Problem writing %d bytes to commit log (%s) - %s",
                                            (int)table_update->go_buf.fill(),
                                            log->get_log_dir().c_str(),
@@ -2720,6 +2989,7 @@ void RangeServer::update_commit() {
     // Now sync the USER commit log if needed
     if (do_sync) {
       size_t retry_count = 0;
+      int64_t sync_start = Hypertable::get_ts64();
       uc->total_syncs++;
       while ((error = Global::user_log->sync()) != Error::OK) {
         HT_ERRORF("Problem sync'ing user log fragment (%s) - %s",
@@ -2729,6 +2999,8 @@ void RangeServer::update_commit() {
           break;
         poll(0, 0, 10000);
       }
+      LatencyMetrics::record(LatencyMetrics::COMMIT_LOG_SYNC, sync_start,
+                             uc->trace);
     }
 
     // Enqueue update
@@ -2773,6 +3045,7 @@ void RangeServer::update_add_and_respond() {
     /**
      *  Insert updates into Ranges
      */
+    uc->phase_start_ns = Hypertable::get_ts64();
     foreach_ht (TableUpdate *table_update, uc->updates) {
 
       // Iterate through all of the ranges, inserting updates
@@ -2814,6 +3087,9 @@ void RangeServer::update_add_and_respond() {
       }
     }
 
+    LatencyMetrics::record(LatencyMetrics::CELL_CACHE_ADD, uc->phase_start_ns,
+                           uc->trace);
+
     /**
      * Decrement usage counters for all referenced ranges
      */
@@ -2896,6 +3172,15 @@ void RangeServer::update_add_and_respond() {
       Global::load_statistics->add_update_data(uc->total_updates, uc->total_added, uc->total_bytes_added, uc->total_syncs);
     }
 
+    uint64_t update_usec = LatencyMetrics::record(LatencyMetrics::UPDATE,
+                                                  uc->start_ns);
+    if (uc->trace) {
+      uc->trace->set_description(format("tables=%u cells=%u",
+                                        (unsigned)uc->updates.size(),
+                                        (unsigned)uc->total_added));
+      uc->trace->log(update_usec);
+    }
+
     if (m_profile_query) {
       ScopedLock lock(m_profile_mutex);
       boost::xtime now;
@@ -3398,6 +3683,24 @@ void RangeServer::get_statistics(ResponseCallbackGetStatistics *cb,
     m_stats->block_cache_hits = 0;
   }
 
+  {
+    std::map<String, LatencyHistogram::Snapshot> latency;
+    LatencyMetrics::get(latency);
+    m_app_queue->get_queue_wait(latency["queue_wait"]);
+    m_stats->latency = latency;
+    for (std::map<String, LatencyHistogram::Snapshot>::iterator iter =
+           m_stats->latency.begin(); iter != m_stats->latency.end(); ++iter) {
+      std::map<String, LatencyHistogram::Snapshot>::iterator previous =
+        m_latency_previous.find(iter->first);
+      if (previous != m_latency_previous.end())
+        iter->second.subtract(previous->second);
+    }
+    m_latency_previous.swap(latency);
+  }
+
+  if (Global::memory_governor)
+    Global::memory_governor->get_allocation(m_stats->memory_allocation);
+
   /**
    * If created a mutator above, write data to sys/RS_METRICS
    */
@@ -30,6 +30,7 @@
 #include <Hypertable/RangeServer/Global.h>
 #include <Hypertable/RangeServer/GroupCommitInterface.h>
 #include <Hypertable/RangeServer/GroupCommitTimerHandler.h>
+#include <Hypertable/RangeServer/LatencyMetrics.h>
 #include <Hypertable/RangeServer/LoadStatistics.h>
 #include <Hypertable/RangeServer/MaintenanceScheduler.h>
 #include <Hypertable/RangeServer/MetaLogEntityRange.h>
@@ -39,6 +40,7 @@
 #include <Hypertable/RangeServer/ResponseCallbackCreateScanner.h>
 #include <Hypertable/RangeServer/ResponseCallbackFetchScanblock.h>
 #include <Hypertable/RangeServer/ResponseCallbackGetStatistics.h>
+#include <Hypertable/RangeServer/ResponseCallbackMultiGet.h>
 #include <Hypertable/RangeServer/ResponseCallbackPhantomUpdate.h>
 #include <Hypertable/RangeServer/ResponseCallbackUpdate.h>
 #include <Hypertable/RangeServer/ServerState.h>
@@ -96,7 +98,27 @@ namespace Hypertable {
                         const  RangeSpec *, const ScanSpec *,
                         QueryCache::Key *);
     void destroy_scanner(ResponseCallback *cb, uint32_t scanner_id);
-    void fetch_scanblock(ResponseCallbackFetchScanblock *, uint32_t scanner_id);
+    void fetch_scanblock(ResponseCallbackFetchScanblock *, uint32_t scanner_id,
+                         uint32_t window=1);
+
+    /** Fetches the cells of a sorted batch of (row, column) keys within one
+     * range.  Each key is looked up with a single row scan that goes
+     * through the bloom filters and block indexes of the cell stores, but
+     * no scanner is registered, so the whole batch is answered in one
+     * response.  Stops after the key at which the response reaches the
+     * scanner buffer size; the client requests the remaining keys again.
+     * @param cb Response callback
+     * @param table Table identifier
+     * @param range_spec Range containing all of the rows
+     * @param max_versions Maximum number of versions per column, 0 for all
+     * @param rows Row keys, sorted
+     * @param columns Column of each key ("family" or "family:qualifier"),
+     *        empty for all columns
+     */
+    void multi_get(ResponseCallbackMultiGet *cb, const TableIdentifier *table,
+                   const RangeSpec *range_spec, uint32_t max_versions,
+                   const std::vector<const char *> &rows,
+                   const std::vector<const char *> &columns);
     void load_range(ResponseCallback *, const TableIdentifier *,
                     const RangeSpec *, const RangeState *,
                     bool needs_compaction);
@@ -242,10 +264,13 @@ namespace Hypertable {
     class UpdateContext {
     public:
       UpdateContext(std::vector<TableUpdate *> &tu, boost::xtime xt) : updates(tu), expire_time(xt),
-          total_updates(0), total_added(0), total_syncs(0), total_bytes_added(0) { }
+          total_updates(0), total_added(0), total_syncs(0), total_bytes_added(0),
+          start_ns(get_ts64()), phase_start_ns(start_ns),
+          trace(LatencyMetrics::sample(LatencyMetrics::UPDATE)) { }
       ~UpdateContext() {
         foreach_ht(TableUpdate *u, updates)
           delete u;
+        delete trace;
       }
       std::vector<TableUpdate *> updates;
       boost::xtime expire_time;
@@ -261,6 +286,9 @@ namespace Hypertable {
       uint32_t qualify_time;
       uint32_t commit_time;
       uint32_t add_time;
+      int64_t start_ns;
+      int64_t phase_start_ns;
+      LatencyMetrics::Trace *trace;
     };
 
     Mutex                      m_update_qualify_queue_mutex;
@@ -310,6 +338,10 @@ namespace Hypertable {
     uint64_t               m_update_coalesce_limit;
 
     StatsRangeServerPtr    m_stats;
+
+    /// Cumulative latency histograms as of the previous get_statistics()
+    std::map<String, LatencyHistogram::Snapshot> m_latency_previous;
+
     LoadStatisticsPtr      m_load_statistics;
     int64_t                m_server_stats_timestamp;
 
@@ -0,0 +1,65 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_REQUESTHANDLERFETCHSCANBLOCKSTREAM_H
+#define HYPERTABLE_REQUESTHANDLERFETCHSCANBLOCKSTREAM_H
+
+#include "AsyncComm/ApplicationHandler.h"
+#include "AsyncComm/Comm.h"
+#include "AsyncComm/Event.h"
+
+
+namespace Hypertable {
+
+  class RangeServer;
+
+  class RequestHandlerFetchScanblockStream : public ApplicationHandler {
+  public:
+    RequestHandlerFetchScanblockStream(Comm *comm, RangeServer *rs,
+                                       EventPtr &event)
+      : ApplicationHandler(event), m_comm(comm), m_range_server(rs),
+        m_window(0) { }
+
+    /** Constructor for the continuation of a stream.
+     * Sends the next block of a window whose earlier blocks were sent
+     * by previous handlers for the same request.
+     * @param comm Comm layer
+     * @param rs RangeServer
+     * @param event Event of the original request
+     * @param window Number of blocks of the window left to send
+     */
+    RequestHandlerFetchScanblockStream(Comm *comm, RangeServer *rs,
+                                       EventPtr &event, uint32_t window)
+      : ApplicationHandler(event), m_comm(comm), m_range_server(rs),
+        m_window(window) { }
+
+    virtual void run();
+
+  private:
+    Comm        *m_comm;
+    RangeServer *m_range_server;
+    /// Blocks left to send, 0 to decode the window from the request
+    uint32_t     m_window;
+  };
+
+}
+
+#endif // HYPERTABLE_REQUESTHANDLERFETCHSCANBLOCKSTREAM_H
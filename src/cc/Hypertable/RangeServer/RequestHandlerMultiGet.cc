@@ -0,0 +1,79 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for RequestHandlerMultiGet.
+ * This file contains definitions for RequestHandlerMultiGet, the
+ * application handler that decodes a "multi get" request and passes it
+ * to RangeServer::multi_get().
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "Hypertable/Lib/Types.h"
+
+#include "RangeServer.h"
+#include "RequestHandlerMultiGet.h"
+#include "ResponseCallbackMultiGet.h"
+
+#include <vector>
+
+using namespace Hypertable;
+using namespace Serialization;
+
+void RequestHandlerMultiGet::run() {
+  ResponseCallbackMultiGet cb(m_comm, m_event);
+  TableIdentifier table;
+  RangeSpec range;
+  std::vector<const char *> rows;
+  std::vector<const char *> columns;
+  const uint8_t *decode_ptr = m_event->payload;
+  size_t decode_remain = m_event->payload_len;
+
+  try {
+    table.decode(&decode_ptr, &decode_remain);
+    range.decode(&decode_ptr, &decode_remain);
+    uint32_t max_versions = decode_i32(&decode_ptr, &decode_remain);
+    uint32_t count = decode_i32(&decode_ptr, &decode_remain);
+    // Each key takes at least two bytes (two empty vstrs), so a count
+    // beyond that is bogus and must not drive the reservation
+    if (count > decode_remain / 2)
+      HT_THROWF(Error::PROTOCOL_ERROR, "multi get key count %u exceeds "
+                "remaining payload %u", (unsigned)count,
+                (unsigned)decode_remain);
+    rows.reserve(count);
+    columns.reserve(count);
+    for (uint32_t i=0; i<count; i++) {
+      rows.push_back(decode_vstr(&decode_ptr, &decode_remain));
+      columns.push_back(decode_vstr(&decode_ptr, &decode_remain));
+    }
+    m_range_server->multi_get(&cb, &table, &range, max_versions, rows,
+                              columns);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    cb.error(e.code(), e.what());
+  }
+}
@@ -0,0 +1,64 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for RequestHandlerMultiGet.
+ * This file contains declarations for RequestHandlerMultiGet, the
+ * application handler that decodes a "multi get" request and passes it
+ * to RangeServer::multi_get().
+ */
+
+#ifndef HYPERTABLE_REQUESTHANDLERMULTIGET_H
+#define HYPERTABLE_REQUESTHANDLERMULTIGET_H
+
+#include "AsyncComm/ApplicationHandler.h"
+#include "AsyncComm/Comm.h"
+#include "AsyncComm/Event.h"
+
+
+namespace Hypertable {
+
+  class RangeServer;
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Decodes a "multi get" request and carries it out.
+   */
+  class RequestHandlerMultiGet : public ApplicationHandler {
+  public:
+    RequestHandlerMultiGet(Comm *comm, RangeServer *rs, EventPtr &event)
+      : ApplicationHandler(event), m_comm(comm), m_range_server(rs) { }
+
+    virtual void run();
+
+  private:
+    Comm        *m_comm;
+    RangeServer *m_range_server;
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_REQUESTHANDLERMULTIGET_H
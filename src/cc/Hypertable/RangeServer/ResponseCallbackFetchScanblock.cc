@@ -26,9 +26,11 @@ using namespace Hypertable;
 
 int
 ResponseCallbackFetchScanblock::response(short moreflag, int32_t id,
-        StaticBuffer &ext) {
+        StaticBuffer &ext, bool stream) {
   CommHeader header;
   header.initialize_from_request_header(m_event->header);
+  if (stream)
+    header.flags |= CommHeader::FLAGS_BIT_STREAM;
   CommBufPtr cbp(new CommBuf( header, 18, ext));
   cbp->append_i32(Error::OK);
   cbp->append_i16(moreflag);
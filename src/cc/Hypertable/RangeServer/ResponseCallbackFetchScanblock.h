@@ -34,7 +34,16 @@ namespace Hypertable {
     ResponseCallbackFetchScanblock(Comm *comm, EventPtr &event_ptr)
       : ResponseCallback(comm, event_ptr) { }
 
-    int response(short moreflag, int32_t id, StaticBuffer &ext);
+    /** Sends a scan block.
+     * @param moreflag 1 if the scan is finished, 0 otherwise
+     * @param id Scanner ID
+     * @param ext Scan block
+     * @param stream true if more scan blocks will be sent in response to
+     *        the same "fetch scanblock stream" request
+     * @return Error::OK on success or error code on failure
+     */
+    int response(short moreflag, int32_t id, StaticBuffer &ext,
+                 bool stream=false);
   };
 
 }
@@ -0,0 +1,43 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for ResponseCallbackMultiGet.
+ * This file contains definitions for ResponseCallbackMultiGet, the
+ * response callback of the "multi get" RangeServer request.
+ */
+
+#include "Common/Compat.h"
+#include "ResponseCallbackMultiGet.h"
+
+using namespace Hypertable;
+
+int
+ResponseCallbackMultiGet::response(uint32_t keys_completed,
+                                   StaticBuffer &ext) {
+  CommHeader header;
+  header.initialize_from_request_header(m_event->header);
+  CommBufPtr cbp(new CommBuf(header, 8, ext));
+  cbp->append_i32(Error::OK);
+  cbp->append_i32(keys_completed);
+  return m_comm->send_response(m_event->addr, cbp);
+}
@@ -0,0 +1,63 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for ResponseCallbackMultiGet.
+ * This file contains declarations for ResponseCallbackMultiGet, the
+ * response callback of the "multi get" RangeServer request.
+ */
+
+#ifndef HYPERTABLE_RESPONSECALLBACKMULTIGET_H
+#define HYPERTABLE_RESPONSECALLBACKMULTIGET_H
+
+#include "Common/Error.h"
+
+#include "AsyncComm/CommBuf.h"
+#include "AsyncComm/ResponseCallback.h"
+
+namespace Hypertable {
+
+  /** @addtogroup RangeServer
+   *  @{
+   */
+
+  /** Response callback for the "multi get" request.
+   */
+  class ResponseCallbackMultiGet : public ResponseCallback {
+  public:
+    ResponseCallbackMultiGet(Comm *comm, EventPtr &event_ptr)
+      : ResponseCallback(comm, event_ptr) { }
+
+    /** Sends the cells of a batch of keys.
+     * @param keys_completed Number of leading keys of the request whose
+     *        cells are contained in <code>ext</code>
+     * @param ext Length prefixed block of key/value pairs
+     * @return Error::OK on success or error code on failure
+     */
+    int response(uint32_t keys_completed, StaticBuffer &ext);
+  };
+
+  /** @}*/
+
+}
+
+#endif // HYPERTABLE_RESPONSECALLBACKMULTIGET_H
@@ -29,10 +29,36 @@
 
 #include <Common/Logger.h>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace std;
 using namespace Hypertable;
 
 
+const RangeInfo *RangeSnapshot::find(const char *row, size_t *hint) const {
+  const RangeInfo *info;
+
+  if (*hint < entries.size()) {
+    info = &entries[*hint];
+    if (strcmp(row, info->end_row.c_str()) <= 0 &&
+        strcmp(row, info->start_row.c_str()) > 0)
+      return info;
+  }
+
+  auto iter = std::lower_bound(entries.begin(), entries.end(), row,
+                               [](const RangeInfo &info, const char *row) {
+                                 return strcmp(info.end_row.c_str(), row) < 0;
+                               });
+
+  if (iter == entries.end() || strcmp(iter->start_row.c_str(), row) >= 0)
+    return 0;
+
+  *hint = iter - entries.begin();
+  return &*iter;
+}
+
+
 TableInfo::TableInfo(const TableIdentifier *identifier, SchemaPtr &schema)
     : m_identifier(*identifier), m_schema(schema) {
 }
@@ -54,6 +80,7 @@ bool TableInfo::remove(const String &start_row, const String &end_row) {
   HT_INFOF("Removing %s[%s..%s] from TableInfo",
            m_identifier.id, start_row.c_str(), end_row.c_str());
 
+  m_snapshot = 0;
   m_active_set.erase(iter);
 
   return true;
@@ -77,6 +104,7 @@ TableInfo::change_end_row(const String &start_row, const String &old_end_row,
   HT_INFOF("Changing end row %s removing old row '%s' (start row '%s')",
            m_identifier.id, old_end_row.c_str(), start_row.c_str());
 
+  m_snapshot = 0;
   m_active_set.erase(iter);
 
   HT_ASSERT(m_active_set.insert(range_info).second);
@@ -102,6 +130,7 @@ TableInfo::change_start_row(const String &old_start_row, const String &new_start
   HT_INFOF("Changing start row %s removing old row '%s' (end row '%s')",
            m_identifier.id, old_start_row.c_str(), end_row.c_str());
 
+  m_snapshot = 0;
   m_active_set.erase(iter);
 
   HT_ASSERT(m_active_set.insert(range_info).second);
@@ -153,6 +182,7 @@ bool TableInfo::remove_range(const RangeSpec *range_spec, RangePtr &range) {
   HT_INFOF("Removing range %s[%s..%s] from TableInfo",
            m_identifier.id, range_spec->start_row, range_spec->end_row);
 
+  m_snapshot = 0;
   m_active_set.erase(iter);
 
   return true;
@@ -209,6 +239,7 @@ void TableInfo::promote_staged_range(RangePtr &range) {
   HT_ASSERT(iter != m_staged_set.end());
   range_info.range = range;
   m_staged_set.erase(iter);
+  m_snapshot = 0;
   HT_ASSERT(m_active_set.insert(range_info).second);
   m_cond.notify_all();
 }
@@ -226,6 +257,7 @@ void TableInfo::add_range(RangePtr &range, bool remove_if_exists) {
   }
   HT_ASSERT(iter == m_active_set.end());
   HT_INFOF("Adding range %s to TableInfo", range->get_name().c_str());
+  m_snapshot = 0;
   HT_ASSERT(m_active_set.insert(range_info).second);
 }
 
@@ -247,6 +279,16 @@ TableInfo::find_containing_range(const String &row, RangePtr &range,
 }
 
 
+RangeSnapshotPtr TableInfo::get_range_snapshot() {
+  ScopedLock lock(m_mutex);
+  if (!m_snapshot) {
+    m_snapshot = new RangeSnapshot();
+    m_snapshot->entries.assign(m_active_set.begin(), m_active_set.end());
+  }
+  return m_snapshot;
+}
+
+
 bool TableInfo::includes_row(const String &row) const {
   RangeInfo range_info("", row);
   auto iter = m_active_set.lower_bound(range_info);
@@ -272,6 +314,7 @@ void TableInfo::clear() {
   ScopedLock lock(m_mutex);
   HT_INFOF("Clearing set for table %s", m_identifier.id);
   m_active_set.clear();
+  m_snapshot = 0;
 }
 
 void TableInfo::update_schema(SchemaPtr &schema) {
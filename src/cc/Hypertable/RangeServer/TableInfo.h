@@ -40,6 +40,7 @@
 #include <iterator>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace Hypertable {
 
@@ -88,6 +89,28 @@ namespace Hypertable {
     return lhs.end_row.compare(rhs.end_row) < 0;
   }
 
+  /// Immutable copy of the active range set of a table.
+  /// Update batches classify their rows against a snapshot, so the
+  /// TableInfo lock is taken once per batch and no strings are copied per
+  /// cell.  TableInfo caches the snapshot until its active set changes.
+  class RangeSnapshot : public ReferenceCount {
+  public:
+
+    /// Finds the range to which a row belongs.
+    /// The entry at index <code>*hint</code> is checked first, so runs of
+    /// rows that fall into the same range skip the binary search.
+    /// @param row Row key
+    /// @param hint Address of index of entry found by previous call (updated)
+    /// @return Range info of containing range, or 0 if not found
+    const RangeInfo *find(const char *row, size_t *hint) const;
+
+    /// Range info objects, sorted by end row
+    std::vector<RangeInfo> entries;
+  };
+
+  /// Smart pointer to RangeSnapshot
+  typedef intrusive_ptr<RangeSnapshot> RangeSnapshotPtr;
+
 
   class Schema;
 
@@ -220,6 +243,12 @@ namespace Hypertable {
     bool find_containing_range(const String &row, RangePtr &range,
                                String &start_row, String &end_row);
 
+    /// Returns snapshot of the active set.
+    /// The snapshot is built on first use after the active set changes and
+    /// shared by callers until the next change.
+    /// @return Smart pointer to snapshot of #m_active_set
+    RangeSnapshotPtr get_range_snapshot();
+
     /// Checks to see if a given row belongs to any of the ranges in the active
     /// set.  This function searches #m_active_set for the range that should
     /// contain <code>row</code>.  If found, <i>true</i> is returned, otherwise
@@ -263,6 +292,9 @@ namespace Hypertable {
 
     /// Set of staged ranges (soon to become active)
     std::set<RangeInfo> m_staged_set;
+
+    /// Cached snapshot of #m_active_set, reset whenever it changes
+    RangeSnapshotPtr m_snapshot;
   };
 
   /// Smart pointer to TableInfo
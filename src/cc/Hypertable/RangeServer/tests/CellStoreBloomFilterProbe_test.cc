@@ -0,0 +1,237 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Stopwatch.h"
+#include "Common/Usage.h"
+
+#include <atomic>
+#include <iostream>
+
+#include <boost/thread/thread.hpp>
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../CellStoreFactory.h"
+#include "../CellStoreV6.h"
+#include "../CellStoreV7.h"
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreBloomFilterProbe_test",
+    "",
+    "  This program measures bloom filter probe throughput of a single",
+    "  cell store with an increasing number of reader threads, while another",
+    "  thread repeatedly purges the bloom filter.  It checks that rows",
+    "  present in the store are never ruled out and that absent rows are",
+    "  ruled out at the configured false positive rate",
+    (const char *)0
+  };
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>a</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  const int ROW_COUNT = 10000;
+  const int MAX_THREADS = 8;
+  const int PROBES = 100000;
+
+  /// Upper bound on the observed false positive rate; the filters are
+  /// created with the default expected rate of 0.01
+  const double MAX_FALSE_POSITIVE_RATE = 0.05;
+
+  /// Probe outcomes, summed over all reader threads
+  struct ProbeCounts {
+    ProbeCounts() : misses(0), absent(0), false_positives(0) { }
+    /// Present rows that were ruled out
+    std::atomic<int> misses;
+    /// Probes of absent rows
+    std::atomic<int> absent;
+    /// Absent rows that were not ruled out
+    std::atomic<int> false_positives;
+  };
+
+  /// Probes rows, even rows are present in the store
+  struct ProbeThread {
+    ProbeThread(CellStorePtr &cs, SchemaPtr &schema, int seed, int probes,
+                ProbeCounts *counts)
+      : m_cs(cs), m_schema(schema), m_seed(seed), m_probes(probes),
+        m_counts(counts) { }
+    void operator()() {
+      RangeSpec range_spec;
+      range_spec.start_row = "";
+      range_spec.end_row = Key::END_ROW_MARKER;
+      char row[32];
+      int misses = 0, absent = 0, false_positives = 0;
+      for (int i=0; i<m_probes; ++i) {
+        int n = (m_seed + i * 7919) % ROW_COUNT;
+        sprintf(row, "%010d", n);
+        ScanSpecBuilder ssbuilder;
+        ssbuilder.add_row(row);
+        ScanContextPtr scan_ctx = new ScanContext(TIMESTAMP_MAX,
+            &(ssbuilder.get()), &range_spec, m_schema);
+        bool maybe = m_cs->may_contain(scan_ctx);
+        if ((n % 2) == 0) {
+          if (!maybe)
+            misses++;
+        }
+        else {
+          absent++;
+          if (maybe)
+            false_positives++;
+        }
+      }
+      m_counts->misses += misses;
+      m_counts->absent += absent;
+      m_counts->false_positives += false_positives;
+    }
+    CellStorePtr m_cs;
+    SchemaPtr m_schema;
+    int m_seed;
+    int m_probes;
+    ProbeCounts *m_counts;
+  };
+
+  /// Purges the cell store indexes until told to stop
+  struct PurgeThread {
+    PurgeThread(CellStorePtr &cs, std::atomic<bool> *done)
+      : m_cs(cs), m_done(done) { }
+    void operator()() {
+      while (!*m_done) {
+        m_cs->purge_indexes();
+        boost::this_thread::yield();
+      }
+    }
+    CellStorePtr m_cs;
+    std::atomic<bool> *m_done;
+  };
+
+  CellStorePtr create(CellStorePtr cs, const String &name) {
+    TableIdentifier table_id("0");
+    PropertiesPtr cs_props = new Properties();
+    Schema::parse_bloom_filter("rows", cs_props);
+
+    HT_TRY("creating cellstore",
+           cs->create(name.c_str(), ROW_COUNT, cs_props, &table_id));
+
+    DynamicBuffer key_buf(256);
+    uint8_t valuebuf[16];
+    uint8_t *uptr = valuebuf;
+    Serialization::encode_vi32(&uptr, 1);
+    *uptr = 'x';
+    ByteString bsvalue;
+    bsvalue.ptr = valuebuf;
+    char row[32];
+    Key key;
+
+    for (int i=0; i<ROW_COUNT; i+=2) {
+      sprintf(row, "%010d", i);
+      key_buf.clear();
+      create_key_and_append(key_buf, FLAG_INSERT, row, 1, "", 1, 1);
+      key.load(SerializedKey(key_buf.base));
+      cs->add(key, bsvalue);
+    }
+    cs->finalize(&table_id);
+    return CellStoreFactory::open(name, 0, 0);
+  }
+
+  void run(CellStorePtr &cs, SchemaPtr &schema) {
+    for (int threads=1; threads<=MAX_THREADS; threads*=2) {
+      ProbeCounts counts;
+      std::atomic<bool> done(false);
+      boost::thread_group readers;
+      Stopwatch stopwatch;
+
+      boost::thread purger(PurgeThread(cs, &done));
+      for (int i=0; i<threads; ++i)
+        readers.create_thread(ProbeThread(cs, schema, i, PROBES, &counts));
+      readers.join_all();
+      stopwatch.stop();
+      done = true;
+      purger.join();
+
+      // present rows are never ruled out, absent rows are (true negatives)
+      // except at about the false positive rate
+      HT_ASSERT(counts.misses == 0);
+      HT_ASSERT(counts.absent > 0);
+      double false_positive_rate =
+        (double)counts.false_positives / (double)counts.absent;
+      HT_ASSERT(false_positive_rate < MAX_FALSE_POSITIVE_RATE);
+      cout << cs->get_filename() << " threads=" << threads << " probes/s="
+           << (int64_t)((threads * PROBES) / stopwatch.elapsed())
+           << " false_positive_rate=" << false_positive_rate << endl;
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    String testdir = "/CellStoreBloomFilterProbe_test";
+    DfsBroker::ClientPtr client =
+      cellstore_test_setup(argc, argv, usage, testdir);
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      exit(1);
+    }
+
+    CellStorePtr cs;
+
+    cs = create(new CellStoreV6(Global::dfs.get(), schema.get()),
+                testdir + "/cs6");
+    run(cs, schema);
+
+    cs = create(new CellStoreV7(Global::dfs.get(), schema.get()),
+                testdir + "/cs7");
+    run(cs, schema);
+
+    cs = 0;
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Usage.h"
+
+#include <iostream>
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../CellStoreFactory.h"
+#include "../CellStoreV8.h"
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreCopyFreeSplit_test",
+    "",
+    "  This program tests the cell store side of copy-free range splits.",
+    "  It creates a cell store, opens it for both halves of a split the",
+    "  way the split ranges do, and checks the coverage reported to the",
+    "  merge scheduler and the rows each half returns",
+    (const char *)0
+  };
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>a</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  const int ROW_COUNT = 1000;
+
+  /// Returns the number of rows of <code>cs</code> a full scan returns
+  size_t count_rows(CellStorePtr &cs, SchemaPtr &schema) {
+    ScanSpecBuilder ssbuilder;
+    RangeSpec range_spec;
+    range_spec.start_row = "";
+    range_spec.end_row = Key::END_ROW_MARKER;
+    ScanContextPtr scan_ctx = new ScanContext(TIMESTAMP_MAX,
+        &(ssbuilder.get()), &range_spec, schema);
+    CellListScannerPtr scanner = cs->create_scanner(scan_ctx);
+    Key key;
+    ByteString value;
+    String last_row;
+    size_t rows = 0;
+    while (scanner->get(key, value)) {
+      HT_ASSERT(strcmp(key.row, cs->get_start_row()) > 0 &&
+                strcmp(key.row, cs->get_end_row()) <= 0);
+      if (last_row != key.row) {
+        last_row = key.row;
+        rows++;
+      }
+      scanner->forward();
+    }
+    return rows;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    CellStorePtr cs;
+    TableIdentifier table_id("0");
+
+    String testdir = "/CellStoreCopyFreeSplit_test";
+    DfsBroker::ClientPtr client =
+      cellstore_test_setup(argc, argv, usage, testdir);
+
+    String csname = testdir + "/cs0";
+    PropertiesPtr cs_props = new Properties();
+    cs_props->set("blocksize", uint32_t(2048));
+    cs_props->set("compressor", String("none"));
+    Schema::parse_bloom_filter("none", cs_props);
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      exit(1);
+    }
+
+    cs = new CellStoreV8(Global::dfs.get(), schema.get());
+    HT_TRY("creating cellstore",
+           cs->create(csname.c_str(), ROW_COUNT, cs_props, &table_id));
+
+    DynamicBuffer key_buf(256);
+    uint8_t valuebuf[128];
+    uint8_t *uptr = valuebuf;
+    const char *value = "All work and no play makes jack a dull boy.";
+    Serialization::encode_vi32(&uptr, strlen(value));
+    strcpy((char *)uptr, value);
+    ByteString bsvalue;
+    bsvalue.ptr = valuebuf;
+    char row[32];
+    Key key;
+
+    for (int i=0; i<ROW_COUNT; ++i) {
+      sprintf(row, "%010d", i);
+      key_buf.clear();
+      create_key_and_append(key_buf, FLAG_INSERT, row, 1, "q",
+                            (int64_t)i + 1, (int64_t)i + 1);
+      key.load(SerializedKey(key_buf.base));
+      cs->add(key, bsvalue);
+    }
+    cs->finalize(&table_id);
+
+    String split_row = format("%010d", ROW_COUNT/2 - 1);
+
+    // A store opened for the whole range covers all of its blocks
+    cs = CellStoreFactory::open(csname, 0, 0);
+    HT_ASSERT(cs->fraction_covered() == 1.0);
+    size_t block_count = cs->block_count();
+    HT_ASSERT(block_count > 10);
+    HT_ASSERT(count_rows(cs, schema) == (size_t)ROW_COUNT);
+
+    // After a copy-free split each half opens the parent's file restricted
+    // to its own rows.  Together they cover every block, the one holding the
+    // split row possibly twice.
+    CellStorePtr low = CellStoreFactory::open(csname, "", split_row.c_str());
+    CellStorePtr high = CellStoreFactory::open(csname, split_row.c_str(),
+                                               Key::END_ROW_MARKER);
+    HT_ASSERT(low->fraction_covered() < 1.0);
+    HT_ASSERT(high->fraction_covered() < 1.0);
+    double sum = low->fraction_covered() + high->fraction_covered();
+    HT_ASSERT(sum >= 1.0 && sum <= 1.0 + 1.0 / block_count + 1e-9);
+    HT_ASSERT(count_rows(low, schema) == (size_t)ROW_COUNT/2);
+    HT_ASSERT(count_rows(high, schema) == (size_t)ROW_COUNT/2);
+
+    // The range that keeps the store object rescopes it in place
+    cs->rescope("", split_row);
+    HT_ASSERT(cs->fraction_covered() == low->fraction_covered());
+    HT_ASSERT(cs->block_count() < block_count);
+    HT_ASSERT(count_rows(cs, schema) == (size_t)ROW_COUNT/2);
+
+    cs = low = high = 0;
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
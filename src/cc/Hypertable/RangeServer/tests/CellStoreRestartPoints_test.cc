@@ -0,0 +1,191 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Usage.h"
+
+#include <iostream>
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../CellStoreFactory.h"
+#include "../CellStoreV8.h"
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreRestartPoints_test",
+    "",
+    "  This program tests prefix compression restart points in version 8",
+    "  cell stores.  It creates cell stores with several restart intervals",
+    "  and checks that point and row interval scans, which seek to restart",
+    "  points within blocks, return the same cells as a full scan",
+    (const char *)0
+  };
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>a</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  const int ROW_COUNT = 2000;
+
+  /// Rows are the even numbers, so odd numbers are absent rows
+  void make_row(char *row, int i) { sprintf(row, "row%010d", i); }
+
+  size_t scan(CellStorePtr &cs, SchemaPtr &schema, ScanSpecBuilder &ssbuilder,
+              const char *expected_first_row) {
+    RangeSpec range_spec;
+    range_spec.start_row = "";
+    range_spec.end_row = Key::END_ROW_MARKER;
+    ScanContextPtr scan_ctx = new ScanContext(TIMESTAMP_MAX,
+        &(ssbuilder.get()), &range_spec, schema);
+    CellListScannerPtr scanner = cs->create_scanner(scan_ctx);
+    Key key;
+    ByteString value;
+    size_t count = 0;
+    while (scanner->get(key, value)) {
+      HT_ASSERT(count || !expected_first_row ||
+                !strcmp(key.row, expected_first_row));
+      count++;
+      scanner->forward();
+    }
+    return count;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    CellStorePtr cs;
+    TableIdentifier table_id("0");
+
+    String testdir = "/CellStoreRestartPoints_test";
+    DfsBroker::ClientPtr client =
+      cellstore_test_setup(argc, argv, usage, testdir);
+
+    PropertiesPtr cs_props = new Properties();
+    cs_props->set("blocksize", uint32_t(4096));
+    cs_props->set("compressor", String("none"));
+    Schema::parse_bloom_filter("none", cs_props);
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      exit(1);
+    }
+
+    DynamicBuffer key_buf(256);
+    uint8_t valuebuf[128];
+    uint8_t *uptr = valuebuf;
+    const char *value = "All work and no play makes jack a dull boy.";
+    Serialization::encode_vi32(&uptr, strlen(value));
+    strcpy((char *)uptr, value);
+    ByteString bsvalue;
+    bsvalue.ptr = valuebuf;
+    char row[32], end_row[32];
+    Key key;
+
+    int32_t intervals[] = { 0, 1, 4, 16 };
+
+    for (size_t n=0; n<sizeof(intervals)/sizeof(int32_t); ++n) {
+      String csname = format("%s/cs%d", testdir.c_str(), (int)n);
+
+      Config::properties->set("Hypertable.RangeServer.CellStore.RestartInterval",
+                              intervals[n]);
+
+      cs = new CellStoreV8(Global::dfs.get(), schema.get());
+      HT_TRY("creating cellstore",
+             cs->create(csname.c_str(), ROW_COUNT, cs_props, &table_id));
+
+      for (int i=0; i<ROW_COUNT; ++i) {
+        make_row(row, i*2);
+        key_buf.clear();
+        create_key_and_append(key_buf, FLAG_INSERT, row, 1, "q", i+1, i+1);
+        key.load(SerializedKey(key_buf.base));
+        cs->add(key, bsvalue);
+      }
+      cs->finalize(&table_id);
+
+      cs = CellStoreFactory::open(csname, 0, 0);
+      CellStoreTrailer *trailer = cs->get_trailer();
+      HT_ASSERT(boost::any_cast<uint16_t>(trailer->get("version")) == 8);
+      HT_ASSERT(boost::any_cast<uint16_t>(trailer->get("restart_interval")) ==
+                (uint16_t)intervals[n]);
+      HT_ASSERT(cs->block_count() > 10);
+
+      ScanSpecBuilder ssbuilder;
+
+      // Full scan (readahead scanner)
+      HT_ASSERT(scan(cs, schema, ssbuilder, "row0000000000") == ROW_COUNT);
+
+      // Point reads of present and absent rows (block index scanner)
+      for (int i=0; i<ROW_COUNT; i+=37) {
+        make_row(row, i*2);
+        ssbuilder.clear();
+        ssbuilder.add_row(row);
+        HT_ASSERT(scan(cs, schema, ssbuilder, row) == 1);
+        make_row(row, i*2 + 1);
+        ssbuilder.clear();
+        ssbuilder.add_row(row);
+        HT_ASSERT(scan(cs, schema, ssbuilder, 0) == 0);
+      }
+
+      // Row intervals starting inside blocks
+      for (int i=1; i<ROW_COUNT-100; i+=113) {
+        make_row(row, i*2 + 1);
+        make_row(end_row, (i+100)*2);
+        ssbuilder.clear();
+        ssbuilder.add_row_interval(row, true, end_row, true);
+        make_row(row, (i+1)*2);
+        HT_ASSERT(scan(cs, schema, ssbuilder, row) == 100);
+      }
+    }
+
+    cs = 0;
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
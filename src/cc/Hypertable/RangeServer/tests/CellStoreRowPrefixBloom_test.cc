@@ -0,0 +1,183 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Usage.h"
+
+#include <iostream>
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../CellStoreFactory.h"
+#include "../CellStoreV7.h"
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreRowPrefixBloom_test",
+    "",
+    "  This program tests the row prefix bloom filter mode.  It creates",
+    "  cell stores with prefix bloom filters and checks which prefix, row",
+    "  interval and single row scans they rule out",
+    (const char *)0
+  };
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>a</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  const int USER_COUNT = 200;
+
+  bool may_contain(CellStorePtr &cs, SchemaPtr &schema, const String &start,
+                   const String &end) {
+    RangeSpec range_spec;
+    range_spec.start_row = "";
+    range_spec.end_row = Key::END_ROW_MARKER;
+    ScanSpecBuilder ssbuilder;
+    if (start == end)
+      ssbuilder.add_row(start.c_str());
+    else
+      ssbuilder.add_row_interval(start.c_str(), true, end.c_str(), true);
+    ScanContextPtr scan_ctx = new ScanContext(TIMESTAMP_MAX,
+        &(ssbuilder.get()), &range_spec, schema);
+    return cs->may_contain(scan_ctx);
+  }
+
+  /// Creates cell store holding rows "userNNN:itemMMM" for even users
+  CellStorePtr create(const String &name, const String &bloom_filter,
+                      SchemaPtr &schema) {
+    TableIdentifier table_id("0");
+    PropertiesPtr cs_props = new Properties();
+    Schema::parse_bloom_filter(bloom_filter, cs_props);
+
+    CellStorePtr cs = new CellStoreV7(Global::dfs.get(), schema.get());
+    HT_TRY("creating cellstore",
+           cs->create(name.c_str(), USER_COUNT*5, cs_props, &table_id));
+
+    DynamicBuffer key_buf(256);
+    uint8_t valuebuf[16];
+    uint8_t *uptr = valuebuf;
+    Serialization::encode_vi32(&uptr, 1);
+    *uptr = 'x';
+    ByteString bsvalue;
+    bsvalue.ptr = valuebuf;
+    char row[32];
+    Key key;
+
+    for (int user=0; user<USER_COUNT; user+=2) {
+      for (int item=0; item<10; ++item) {
+        sprintf(row, "user%03d:item%03d", user, item);
+        key_buf.clear();
+        create_key_and_append(key_buf, FLAG_INSERT, row, 1, "", 1, 1);
+        key.load(SerializedKey(key_buf.base));
+        cs->add(key, bsvalue);
+      }
+    }
+    cs->finalize(&table_id);
+    return CellStoreFactory::open(name, 0, 0);
+  }
+
+  void run(CellStorePtr &cs, SchemaPtr &schema) {
+    char prefix[32], end[32];
+    int false_positives = 0;
+
+    for (int user=0; user<USER_COUNT; ++user) {
+      sprintf(prefix, "user%03d:", user);
+      sprintf(end, "user%03d:\xff\xff", user);
+      bool maybe = may_contain(cs, schema, prefix, end);
+      if ((user % 2) == 0)
+        HT_ASSERT(maybe);
+      else if (maybe)
+        false_positives++;
+    }
+    HT_ASSERT(false_positives < USER_COUNT / 20);
+
+    HT_ASSERT(may_contain(cs, schema, "user010:item003", "user010:item003"));
+    HT_ASSERT(may_contain(cs, schema, "user010:item003", "user010:item007"));
+
+    // Rows in ["user01", "user02"] do not share a prefix, so the filter
+    // cannot be used
+    HT_ASSERT(may_contain(cs, schema, "user011", "user021"));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    String testdir = "/CellStoreRowPrefixBloom_test";
+    DfsBroker::ClientPtr client =
+      cellstore_test_setup(argc, argv, usage, testdir);
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      exit(1);
+    }
+
+    CellStorePtr cs;
+
+    cs = create(testdir + "/cs0", "prefix --prefix-delimiter :", schema);
+    HT_ASSERT(boost::any_cast<uint8_t>(cs->get_trailer()->get("bloom_filter_mode"))
+              == BLOOM_FILTER_ROW_PREFIX);
+    run(cs, schema);
+
+    cs = create(testdir + "/cs1", "prefix --prefix-length 8", schema);
+    run(cs, schema);
+
+    bool bad_spec = false;
+    try {
+      PropertiesPtr props = new Properties();
+      Schema::parse_bloom_filter("prefix", props);
+    }
+    catch (Exception &e) {
+      bad_spec = e.code() == Error::BAD_SCHEMA;
+    }
+    HT_ASSERT(bad_spec);
+
+    cs = 0;
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for cellstore_test_setup().
+ * This file contains the definition of cellstore_test_setup(), which
+ * connects the CellStore tests to the DFS broker.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/InetAddr.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/ConnectionManager.h"
+#include "AsyncComm/ReactorFactory.h"
+
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+
+DfsBroker::ClientPtr
+Hypertable::cellstore_test_setup(int argc, char **argv, const char **usage,
+                                 const String &testdir) {
+  struct sockaddr_in addr;
+
+  Config::init(argc, argv);
+
+  if (Config::has("help"))
+    Usage::dump_and_exit(usage);
+
+  System::initialize(System::locate_install_dir(argv[0]));
+  ReactorFactory::initialize(2);
+
+  uint16_t port = Config::properties->get_i16("DfsBroker.Port");
+
+  InetAddr::initialize(&addr, "localhost", port);
+
+  // the client holds a reference to the connection manager, so it is
+  // destroyed before it
+  ConnectionManagerPtr conn_mgr = new ConnectionManager();
+  DfsBroker::ClientPtr client = new DfsBroker::Client(conn_mgr, addr, 15000);
+  Global::dfs = client.get();
+
+  if (!client->wait_for_connection(15000)) {
+    HT_ERROR("Unable to connect to DFS");
+    exit(1);
+  }
+
+  Global::memory_tracker = new MemoryTracker(0, 0);
+
+  client->mkdirs(testdir);
+
+  return client;
+}
@@ -0,0 +1,54 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Declarations for cellstore_test_setup().
+ * This file contains the declaration of cellstore_test_setup(), which
+ * connects the CellStore tests to the DFS broker.
+ */
+
+#ifndef HYPERTABLE_CELLSTORETESTDFS_H
+#define HYPERTABLE_CELLSTORETESTDFS_H
+
+#include "Common/String.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+namespace Hypertable {
+
+  /** Initializes a CellStore test.
+   * Initializes Config from the command line (dumping <code>usage</code>
+   * for <code>--help</code>), connects Global::dfs to the broker on
+   * localhost:<code>DfsBroker.Port</code>, sets up Global::memory_tracker and
+   * creates <code>testdir</code>.  Exits if the broker cannot be reached.
+   * @param argc Argument count
+   * @param argv Argument vector
+   * @param usage Usage text
+   * @param testdir DFS directory for the test's files
+   * @return Broker client (also installed as Global::dfs)
+   */
+  DfsBroker::ClientPtr cellstore_test_setup(int argc, char **argv,
+                                            const char **usage,
+                                            const String &testdir);
+
+}
+
+#endif // HYPERTABLE_CELLSTORETESTDFS_H
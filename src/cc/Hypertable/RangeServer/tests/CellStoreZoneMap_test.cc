@@ -0,0 +1,219 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Init.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Usage.h"
+
+#include <iostream>
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../CellStoreFactory.h"
+#include "../CellStoreV7.h"
+#include "../Global.h"
+
+#include "CellStoreTestDfs.h"
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreZoneMap_test",
+    "",
+    "  This program tests block skipping with the CellStore zone map.",
+    "  It creates a cell store with small blocks and scans it with time",
+    "  intervals and column selections that rule out most blocks",
+    (const char *)0
+  };
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>a</Name>\n"
+  "    </ColumnFamily>\n"
+  "    <ColumnFamily id=\"2\">\n"
+  "      <Name>b</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  const int ROW_COUNT = 1000;
+  const int DELETE_ROW = 500;
+
+  /// Row <code>i</code> has a cell in family 1 with this timestamp
+  int64_t row_timestamp(int i) { return (int64_t)(i + 1) * 1000; }
+
+  struct ScanResult {
+    ScanResult() : cells(0), deletes(0), disk_read(0) { }
+    size_t cells;
+    size_t deletes;
+    uint64_t disk_read;
+  };
+
+  void scan(CellStorePtr &cs, SchemaPtr &schema, ScanSpecBuilder &ssbuilder,
+            ScanResult &result) {
+    RangeSpec range_spec;
+    range_spec.start_row = "";
+    range_spec.end_row = Key::END_ROW_MARKER;
+    ScanContextPtr scan_ctx = new ScanContext(TIMESTAMP_MAX,
+        &(ssbuilder.get()), &range_spec, schema);
+    CellListScannerPtr scanner = cs->create_scanner(scan_ctx);
+    Key key;
+    ByteString value;
+    result = ScanResult();
+    while (scanner->get(key, value)) {
+      if (key.flag == FLAG_DELETE_ROW)
+        result.deletes++;
+      else if (key.timestamp >= scan_ctx->time_interval.first &&
+               key.timestamp < scan_ctx->time_interval.second)
+        result.cells++;
+      scanner->forward();
+    }
+    result.disk_read = scanner->get_disk_read();
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    CellStorePtr cs;
+    TableIdentifier table_id("0");
+
+    String testdir = "/CellStoreZoneMap_test";
+    DfsBroker::ClientPtr client =
+      cellstore_test_setup(argc, argv, usage, testdir);
+
+    String csname = testdir + "/cs0";
+    PropertiesPtr cs_props = new Properties();
+    cs_props->set("blocksize", uint32_t(2048));
+    cs_props->set("compressor", String("none"));
+    Schema::parse_bloom_filter("none", cs_props);
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      exit(1);
+    }
+
+    cs = new CellStoreV7(Global::dfs.get(), schema.get());
+    HT_TRY("creating cellstore",
+           cs->create(csname.c_str(), ROW_COUNT*2, cs_props, &table_id));
+
+    DynamicBuffer key_buf(256);
+    uint8_t valuebuf[128];
+    uint8_t *uptr = valuebuf;
+    const char *value = "All work and no play makes jack a dull boy.";
+    Serialization::encode_vi32(&uptr, strlen(value));
+    strcpy((char *)uptr, value);
+    ByteString bsvalue;
+    bsvalue.ptr = valuebuf;
+    char row[32];
+    Key key;
+
+    // Family 1 timestamps increase with the row; family 2 only appears in
+    // the last hundred rows.  Row DELETE_ROW is deleted with a timestamp
+    // that lies inside the interval scanned below.
+    for (int i=0; i<ROW_COUNT; ++i) {
+      sprintf(row, "%010d", i);
+      if (i == DELETE_ROW) {
+        key_buf.clear();
+        create_key_and_append(key_buf, FLAG_DELETE_ROW, row, 0, "",
+                              row_timestamp(550), row_timestamp(550));
+        key.load(SerializedKey(key_buf.base));
+        cs->add(key, bsvalue);
+      }
+      key_buf.clear();
+      create_key_and_append(key_buf, FLAG_INSERT, row, 1, "q",
+                            row_timestamp(i), row_timestamp(i));
+      key.load(SerializedKey(key_buf.base));
+      cs->add(key, bsvalue);
+      if (i >= ROW_COUNT - 100) {
+        key_buf.clear();
+        create_key_and_append(key_buf, FLAG_INSERT, row, 2, "q",
+                              row_timestamp(i), row_timestamp(i));
+        key.load(SerializedKey(key_buf.base));
+        cs->add(key, bsvalue);
+      }
+    }
+    cs->finalize(&table_id);
+
+    cs = CellStoreFactory::open(csname, 0, 0);
+    HT_ASSERT(boost::any_cast<uint16_t>(cs->get_trailer()->get("version")) == 7);
+    HT_ASSERT(boost::any_cast<int64_t>(cs->get_trailer()->get("zone_map_entries"))
+              == (int64_t)cs->block_count());
+
+    ScanSpecBuilder ssbuilder;
+    ScanResult full, result;
+
+    // Full scan (readahead scanner)
+    scan(cs, schema, ssbuilder, full);
+    HT_ASSERT(full.cells == ROW_COUNT + 100);
+    HT_ASSERT(full.deletes == 1);
+
+    // Time interval (readahead scanner)
+    ssbuilder.set_time_interval(row_timestamp(700), row_timestamp(710));
+    scan(cs, schema, ssbuilder, result);
+    HT_ASSERT(result.cells == 10);
+    HT_ASSERT(result.disk_read < full.disk_read / 10);
+
+    // Time interval (block index scanner)
+    ssbuilder.add_row_interval("", true, Key::END_ROW_MARKER, true);
+    scan(cs, schema, ssbuilder, result);
+    HT_ASSERT(result.cells == 10);
+    HT_ASSERT(result.disk_read < full.disk_read / 10);
+
+    // A row delete newer than the interval start may shadow cells in the
+    // interval, so its block must not be skipped
+    ssbuilder.clear();
+    ssbuilder.set_time_interval(row_timestamp(540), row_timestamp(545));
+    scan(cs, schema, ssbuilder, result);
+    HT_ASSERT(result.cells == 5);
+    HT_ASSERT(result.deletes == 1);
+
+    // Column selection
+    ssbuilder.clear();
+    ssbuilder.add_column("b");
+    scan(cs, schema, ssbuilder, result);
+    HT_ASSERT(result.cells == 100);
+    HT_ASSERT(result.deletes == 1);
+    HT_ASSERT(result.disk_read < full.disk_read / 2);
+
+    cs = 0;
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  return 0;
+}
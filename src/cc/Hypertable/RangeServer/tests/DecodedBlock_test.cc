@@ -0,0 +1,117 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Logger.h"
+#include "Common/System.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/RangeServer/DecodedBlock.h"
+#include "Hypertable/RangeServer/KeyCompressorPrefix.h"
+#include "Hypertable/RangeServer/KeyDecompressorPrefix.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const int ENTRY_COUNT = 1000;
+
+  void make_key(DynamicBuffer &buf, const char *row) {
+    create_key_and_append(buf, FLAG_INSERT, row, 1, "qualifier", 1, 1);
+  }
+
+}
+
+int main(int argc, char **argv) {
+  char row[32];
+  vector<DynamicBuffer *> keys;
+  DynamicBuffer block;
+  KeyCompressorPrefix compressor;
+  KeyDecompressorPrefix decompressor;
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  // Build a prefix compressed block, as written by CellStoreV7
+  for (int i=0; i<ENTRY_COUNT; ++i) {
+    sprintf(row, "row%06d", i*2);
+    keys.push_back(new DynamicBuffer());
+    make_key(*keys.back(), row);
+    Key key(SerializedKey(keys.back()->base));
+    compressor.add(key);
+    block.ensure(compressor.length());
+    compressor.write(block.ptr);
+    block.ptr += compressor.length();
+    append_as_byte_string(block, row);
+  }
+
+  uint32_t length;
+  uint8_t *buf = DecodedBlock::encode(&decompressor, block.base, block.ptr,
+                                      &length);
+  DecodedBlock decoded(buf, length);
+
+  HT_ASSERT(decoded.size() == (uint32_t)ENTRY_COUNT);
+
+  // Every entry holds the full key followed by its value
+  const uint8_t *ptr = decoded.base();
+  for (int i=0; i<ENTRY_COUNT; ++i) {
+    SerializedKey serkey(keys[i]->base);
+    HT_ASSERT(decoded.entry(i) == ptr);
+    HT_ASSERT(SerializedKey(ptr) == serkey);
+    ptr += serkey.length();
+    ByteString value(ptr);
+    sprintf(row, "row%06d", i*2);
+    HT_ASSERT(value.decode_length(&ptr) == strlen(row));
+    HT_ASSERT(!memcmp(ptr, row, strlen(row)));
+    ptr += strlen(row);
+  }
+  HT_ASSERT(ptr == decoded.end());
+
+  // lower_bound() finds present keys and the successor of absent ones
+  for (int i=0; i<ENTRY_COUNT; ++i) {
+    HT_ASSERT(decoded.lower_bound(SerializedKey(keys[i]->base)) ==
+              decoded.entry(i));
+    sprintf(row, "row%06d", i*2 + 1);
+    DynamicBuffer absent;
+    make_key(absent, row);
+    const uint8_t *expected = (i+1 < ENTRY_COUNT) ? decoded.entry(i+1) :
+      decoded.end();
+    HT_ASSERT(decoded.lower_bound(SerializedKey(absent.base)) == expected);
+  }
+  DynamicBuffer first;
+  make_key(first, "a");
+  HT_ASSERT(decoded.lower_bound(SerializedKey(first.base)) == decoded.entry(0));
+
+  for (size_t i=0; i<keys.size(); ++i)
+    delete keys[i];
+  delete [] buf;
+
+  cout << "DecodedBlock_test passed" << endl;
+  return 0;
+}
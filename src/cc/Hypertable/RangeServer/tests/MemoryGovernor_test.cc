@@ -0,0 +1,143 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/md5.h"
+
+#include "Hypertable/RangeServer/MemoryGovernor.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const int64_t STEP = 100000;
+  const uint32_t BLOCK_SIZE = 1000;
+
+  /// Inserts <code>count</code> blocks starting at <code>first</code>
+  void insert_blocks(FileBlockCache *cache, int first, int count) {
+    for (int i=first; i<first+count; i++)
+      cache->insert(1, (uint64_t)i * BLOCK_SIZE, new uint8_t [BLOCK_SIZE],
+                    BLOCK_SIZE);
+  }
+
+  /// Looks up <code>count</code> blocks starting at <code>first</code>
+  void lookup_blocks(FileBlockCache *cache, int first, int count) {
+    uint8_t *block;
+    uint32_t length;
+    for (int i=first; i<first+count; i++) {
+      if (cache->checkout(1, (uint64_t)i * BLOCK_SIZE, &block, &length))
+        cache->checkin(1, (uint64_t)i * BLOCK_SIZE);
+    }
+  }
+
+  void make_key(int i, QueryCache::Key *key) {
+    char keybuf[32];
+    sprintf(keybuf, "key-%d", i);
+    md5_csum((unsigned char *)keybuf, strlen(keybuf),
+             (unsigned char *)key->digest);
+  }
+
+}
+
+int main(int argc, char **argv) {
+  boost::shared_array<uint8_t> result(new uint8_t [1000]);
+  uint32_t result_length;
+  QueryCache::Key key;
+
+  // QueryCache shrinks by evicting, evicted keys count as ghost hits
+  {
+    QueryCache cache(1000000);
+    cache.set_ghost_capacity(1000000);
+    for (int i=0; i<100; i++) {
+      make_key(i, &key);
+      HT_ASSERT(cache.insert(&key, "/1", "row", result, 1000));
+    }
+    cache.set_max_memory(50000);
+    HT_ASSERT(cache.memory_used() <= 50000);
+    HT_ASSERT(cache.max_memory() == 50000);
+    make_key(0, &key);
+    HT_ASSERT(!cache.lookup(&key, result, &result_length));
+    make_key(99, &key);
+    HT_ASSERT(cache.lookup(&key, result, &result_length));
+    HT_ASSERT(cache.ghost_hits() == 1);
+    cache.set_max_memory(1000000);
+    HT_ASSERT(cache.available_memory() == 1000000 - cache.memory_used());
+  }
+
+  // Block cache misses on evicted blocks move memory from the query cache
+  {
+    FileBlockCache block_cache(0, 10000000, false);
+    QueryCache query_cache(500000);
+    MemoryGovernor governor(&block_cache, &query_cache, STEP);
+    MemoryGovernor::Usage usage;
+    std::map<String, int64_t> allocation;
+
+    block_cache.decrease_limit(block_cache.get_limit() - 200000);
+    HT_ASSERT(block_cache.get_limit() == 200000);
+
+    // Working set of 250 blocks in a cache of 200
+    insert_blocks(&block_cache, 0, 250);
+    lookup_blocks(&block_cache, 0, 50);
+    HT_ASSERT(block_cache.ghost_hits() == 50);
+
+    governor.rebalance(2000000, 1000000, usage, false, 0);
+    governor.get_allocation(allocation);
+    HT_ASSERT(query_cache.max_memory() == 500000 - STEP);
+    HT_ASSERT(allocation["QueryCache"] == 500000 - STEP);
+
+    // Spare budget goes to the block cache: limit - other - step
+    int64_t other = 1000000 - block_cache.memory_used();
+    HT_ASSERT(block_cache.get_limit() ==
+              2000000 - other - STEP - (int64_t)query_cache.max_memory());
+    HT_ASSERT(allocation["BlockCache"] == block_cache.get_limit());
+
+    // CellCaches grow, both caches have to fit into a smaller budget
+    usage.cell_cache = 1500000;
+    governor.rebalance(2000000, 1500000 + block_cache.memory_used(), usage,
+                       false, 0);
+    HT_ASSERT(block_cache.get_limit() + (int64_t)query_cache.max_memory() <=
+              2000000 - 1500000 - STEP);
+    governor.get_allocation(allocation);
+    HT_ASSERT(allocation["CellCache"] == 1500000);
+
+    // No index loads, so purging indexes is cheaper than shrinking the
+    // block cache only if the block cache is still producing ghost hits
+    insert_blocks(&block_cache, 250, 300);
+    lookup_blocks(&block_cache, 0, 550);
+    usage.block_index = 1000000;
+    governor.rebalance(2000000, 1500000 + block_cache.memory_used(), usage,
+                       true, 0);
+    HT_ASSERT(governor.purge_indexes_first());
+    governor.rebalance(2000000, 1500000 + block_cache.memory_used(), usage,
+                       true, 0);
+    HT_ASSERT(!governor.purge_indexes_first());
+  }
+
+  cout << "SUCCESS" << endl;
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/RangeServer/TableInfo.h"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  /// Builds a snapshot of ranges bounded by <code>splits</code>, the way
+  /// TableInfo::get_range_snapshot() copies its active set
+  RangeSnapshotPtr make_snapshot(const char **splits) {
+    RangeSnapshotPtr snapshot = new RangeSnapshot();
+    String start_row;
+    for (size_t i=0; splits[i]; i++) {
+      snapshot->entries.push_back(RangeInfo(start_row, splits[i]));
+      start_row = splits[i];
+    }
+    snapshot->entries.push_back(RangeInfo(start_row, Key::END_ROW_MARKER));
+    return snapshot;
+  }
+
+  /// Checks that <code>row</code> maps to the range ending in
+  /// <code>end_row</code>, starting the search at <code>*hint</code>
+  void check_row(RangeSnapshotPtr &snapshot, const char *row,
+                 const String &end_row, size_t *hint) {
+    const RangeInfo *info = snapshot->find(row, hint);
+    HT_ASSERT(info);
+    HT_ASSERT(info->end_row == end_row);
+    HT_ASSERT(&snapshot->entries[*hint] == info);
+  }
+
+  /// Classifies a run of sorted rows, as update_qualify_and_transform() does
+  /// for an update batch
+  void check_run(RangeSnapshotPtr &snapshot, const char **rows,
+                 const char **end_rows) {
+    size_t hint = 0;
+    for (size_t i=0; rows[i]; i++)
+      check_row(snapshot, rows[i], end_rows[i], &hint);
+  }
+
+  const char *pre_split[] = { "g", "p", 0 };
+  const char *post_split[] = { "g", "k", "p", 0 };
+
+  const char *rows[] = { "a", "b", "g", "h", "k", "ka", "m", "p", "q", "z", 0 };
+
+  const char *pre_split_end_rows[] = {
+    "g", "g", "g", "p", "p", "p", "p", "p",
+    Key::END_ROW_MARKER, Key::END_ROW_MARKER, 0
+  };
+
+  const char *post_split_end_rows[] = {
+    "g", "g", "g", "k", "k", "p", "p", "p",
+    Key::END_ROW_MARKER, Key::END_ROW_MARKER, 0
+  };
+
+}
+
+
+int main(int argc, char **argv) {
+
+  RangeSnapshotPtr before = make_snapshot(pre_split);
+  RangeSnapshotPtr after = make_snapshot(post_split);
+  size_t hint;
+
+  // Rows of one batch, before and after splitting [g..p] at "k"
+  check_run(before, rows, pre_split_end_rows);
+  check_run(after, rows, post_split_end_rows);
+
+  // The first row of a table is not part of any range
+  hint = 0;
+  HT_ASSERT(before->find("", &hint) == 0);
+  HT_ASSERT(hint == 0);
+
+  // Split boundary is inclusive on the low side only
+  hint = 1;
+  check_row(after, "k", "k", &hint);
+  HT_ASSERT(hint == 1);
+  check_row(after, "k\001", "p", &hint);
+  HT_ASSERT(hint == 2);
+
+  // A hint carried over from the pre-split snapshot still points at the
+  // range ending in "p", which no longer contains rows up to "k"
+  hint = 1;
+  check_row(before, "h", "p", &hint);
+  check_row(after, "h", "k", &hint);
+  HT_ASSERT(hint == 1);
+  hint = 1;
+  check_row(after, "m", "p", &hint);
+  HT_ASSERT(hint == 2);
+
+  // Out of range hints fall back to the binary search
+  hint = 99;
+  check_row(after, "z", Key::END_ROW_MARKER, &hint);
+  HT_ASSERT(hint == 3);
+
+  // Rows past a table whose last range is not loaded here
+  after->entries.pop_back();
+  hint = 2;
+  HT_ASSERT(after->find("q", &hint) == 0);
+  HT_ASSERT(hint == 2);
+
+  return 0;
+}
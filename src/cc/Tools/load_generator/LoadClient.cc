@@ -170,6 +170,10 @@ LoadClient::create_scanner(const String &tablename, const ScanSpec &scan_spec)
     thrift_scan_spec.columns.push_back(scan_spec.columns[0]);
     thrift_scan_spec.row_intervals.push_back(thrift_row_interval);
     thrift_scan_spec.__isset.columns = thrift_scan_spec.__isset.row_intervals = true;
+    if (scan_spec.row_limit) {
+      thrift_scan_spec.row_limit = scan_spec.row_limit;
+      thrift_scan_spec.__isset.row_limit = true;
+    }
 
     m_thrift_scanner = m_thrift_client->open_scanner(m_thrift_namespace,
             tablename, thrift_scan_spec);
@@ -229,6 +233,15 @@ LoadClient::close_scanner()
   }
 }
 
+bool
+LoadClient::get_location_cache_statistics(LocationCache::Statistics &stats)
+{
+  if (m_thrift)
+    return false;
+  m_native_client->get_location_cache_statistics(stats);
+  return true;
+}
+
 LoadClient::~LoadClient()
 {
   if (m_thrift) {
@@ -65,8 +65,8 @@ class LoadClient : public ReferenceCount {
                         ::uint64_t shared_mutator_flush_interval);
     /**
      * Create a scanner.
-     * For thrift scanners, just use the 1st column and 1st row_interval specified in the
-     * ScanSpec.
+     * For thrift scanners, just use the 1st column, 1st row_interval and the
+     * row limit specified in the ScanSpec.
      */
     void create_scanner(const String &tablename, const ScanSpec& scan_spec);
     void set_cells(const Cells &cells);
@@ -80,6 +80,12 @@ class LoadClient : public ReferenceCount {
      */
     uint64_t get_all_cells();
 
+    /**
+     * Get the statistics of the native client's range location cache
+     * return false for thrift clients, which have none
+     */
+    bool get_location_cache_statistics(LocationCache::Statistics &stats);
+
   private:
     bool m_thrift;
     ClientPtr m_native_client;
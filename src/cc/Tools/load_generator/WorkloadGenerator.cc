@@ -0,0 +1,417 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Definitions for WorkloadGenerator.
+ * This file contains definitions for WorkloadGenerator, a YCSB-style
+ * open-loop workload driver that reports latency percentiles per operation
+ * type.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/Time.h"
+
+#include "Common/DiscreteRandomGeneratorFactory.h"
+
+#include "Hypertable/Lib/Cells.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/ScanSpec.h"
+
+#include "LoadClient.h"
+#include "WorkloadGenerator.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cmath>
+#include <ostream>
+
+extern "C" {
+#include <time.h>
+}
+
+using namespace Hypertable;
+
+namespace {
+
+  const char *operation_names[WorkloadGenerator::OPERATION_COUNT] = {
+    "read",
+    "update",
+    "scan",
+    "read_modify_write"
+  };
+
+  const char *proportion_properties[WorkloadGenerator::OPERATION_COUNT] = {
+    "read-proportion",
+    "update-proportion",
+    "scan-proportion",
+    "rmw-proportion"
+  };
+
+  /// Percentiles reported for each histogram
+  const double percentiles[] = { 0.5, 0.9, 0.95, 0.99, 0.999, 0.9999 };
+
+  const size_t percentile_count = sizeof(percentiles) / sizeof(double);
+
+  /// Only the first few errors of each operation type are logged
+  const uint64_t MAX_LOGGED_ERRORS = 10;
+
+  String percentile_name(double fraction) {
+    return format("p%g", fraction * 100.0);
+  }
+
+  void sleep_until(int64_t when) {
+    int64_t delay = when - get_ts64();
+    if (delay <= 0)
+      return;
+    struct timespec ts;
+    ts.tv_sec = delay / 1000000000LL;
+    ts.tv_nsec = delay % 1000000000LL;
+    nanosleep(&ts, 0);
+  }
+
+  void json_histogram(std::ostream &out, const LatencyHistogram &histogram) {
+    LatencyHistogram::Snapshot snapshot;
+    histogram.snapshot(snapshot);
+    out << "{\"count\": " << snapshot.count
+        << ", \"mean\": " << format("%.1f", snapshot.mean());
+    for (size_t i=0; i<percentile_count; ++i)
+      out << ", \"" << percentile_name(percentiles[i]) << "\": "
+          << snapshot.percentile(percentiles[i]);
+    out << ", \"max\": " << snapshot.max << ", \"buckets\": [";
+    bool first = true;
+    for (size_t i=0; i<snapshot.counts.size(); ++i) {
+      if (snapshot.counts[i] == 0)
+        continue;
+      out << (first ? "" : ", ") << "["
+          << LatencyHistogram::bucket_upper_bound(i) << ", "
+          << snapshot.counts[i] << "]";
+      first = false;
+    }
+    out << "]}";
+  }
+
+}
+
+
+WorkloadGenerator::WorkloadGenerator(const String &tablename)
+  : m_tablename(tablename), m_u01(boost::mt19937()), m_finished(false),
+    m_ready(0), m_max_queue_depth(0), m_elapsed(0), m_scheduled(0) {
+
+  m_rate = get_f64("rate");
+  if (m_rate <= 0.0)
+    HT_THROWF(Error::CONFIG_BAD_VALUE, "Bad arrival rate %f", m_rate);
+
+  String arrival = get_str("arrival");
+  if (arrival == "poisson")
+    m_poisson = true;
+  else if (arrival == "uniform")
+    m_poisson = false;
+  else
+    HT_THROWF(Error::CONFIG_BAD_VALUE, "Bad arrival process '%s'",
+              arrival.c_str());
+
+  m_duration = get_i32("duration");
+  m_workers = get_i32("parallel");
+  if (m_workers <= 0)
+    m_workers = 16;
+  m_record_count = get_i64("record-count");
+  if (m_record_count <= 0)
+    HT_THROWF(Error::CONFIG_BAD_VALUE, "Bad record count %lld",
+              (Lld)m_record_count);
+  m_key_distribution = get_str("key-distribution");
+  m_row_format = get_str("row-format");
+  if (m_row_format.find("llu") == String::npos)
+    HT_THROWF(Error::CONFIG_BAD_VALUE, "Row format '%s' must contain a "
+              "%%llu conversion", m_row_format.c_str());
+  m_scan_length = get_i32("scan-length");
+  m_column_family = get_str("column-family");
+  m_value_size = get_i32("value-size");
+  m_thrift = get_bool("thrift");
+
+  double total = 0.0;
+  for (int i=0; i<OPERATION_COUNT; ++i) {
+    double proportion = get_f64(proportion_properties[i]);
+    if (proportion < 0.0)
+      HT_THROWF(Error::CONFIG_BAD_VALUE, "Negative %s",
+                proportion_properties[i]);
+    total += proportion;
+    m_cumulative[i] = total;
+  }
+  if (total <= 0.0)
+    HT_THROW(Error::CONFIG_BAD_VALUE, "All operation proportions are zero");
+  for (int i=0; i<OPERATION_COUNT; ++i)
+    m_cumulative[i] /= total;
+
+  uint32_t seed = get_i32("seed");
+  m_rng.seed(seed);
+  m_u01 = boost::uniform_01<boost::mt19937>(m_rng);
+
+  m_keys = DiscreteRandomGeneratorFactory::create(m_key_distribution);
+  m_keys->set_seed(seed);
+  m_keys->set_value_count(m_record_count);
+}
+
+
+const char *WorkloadGenerator::name(int op) {
+  return operation_names[op];
+}
+
+
+int WorkloadGenerator::next_operation() {
+  double u = m_u01();
+  for (int i=0; i<OPERATION_COUNT-1; ++i)
+    if (u < m_cumulative[i])
+      return i;
+  return OPERATION_COUNT-1;
+}
+
+
+int64_t WorkloadGenerator::next_interval() {
+  double seconds = 1.0 / m_rate;
+  if (m_poisson)
+    seconds *= -std::log(1.0 - m_u01());
+  return (int64_t)(seconds * 1e9);
+}
+
+
+void WorkloadGenerator::run() {
+  boost::thread_group threads;
+
+  for (int32_t i=0; i<m_workers; ++i)
+    threads.create_thread(boost::bind(&WorkloadGenerator::worker, this));
+
+  // Arrivals are only scheduled once every worker is connected
+  {
+    ScopedLock lock(m_mutex);
+    while (m_ready < m_workers)
+      m_cond.wait(lock);
+  }
+
+  int64_t start = get_ts64();
+  int64_t end = start + (int64_t)m_duration * 1000000000LL;
+  Request request;
+
+  request.scheduled = start;
+  while (true) {
+    request.scheduled += next_interval();
+    if (request.scheduled >= end)
+      break;
+    request.op = next_operation();
+    request.record = m_keys->get_sample();
+
+    // If we fall behind, requests are queued immediately with their
+    // original schedule, so the delay is charged to their response time
+    sleep_until(request.scheduled);
+    {
+      ScopedLock lock(m_mutex);
+      m_queue.push_back(request);
+      if (m_queue.size() > m_max_queue_depth)
+        m_max_queue_depth = m_queue.size();
+      m_cond.notify_one();
+    }
+    m_scheduled++;
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    m_finished = true;
+    m_cond.notify_all();
+  }
+
+  threads.join_all();
+
+  m_elapsed = (double)(get_ts64() - start) / 1e9;
+}
+
+
+void WorkloadGenerator::worker() {
+  LoadClientPtr client;
+  String config_file = get_str("config");
+  ScanSpecBuilder scan_spec;
+  Cells cells;
+  String row;
+  String value(m_value_size, ' ');
+  boost::mt19937 rng;
+  Request request;
+
+  try {
+    if (config_file != "")
+      client = new LoadClient(config_file, m_thrift);
+    else
+      client = new LoadClient(m_thrift);
+    client->create_mutator(m_tablename, 0, 0);
+  }
+  catch (Exception &e) {
+    HT_FATAL_OUT << e << HT_END;
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    rng.seed(get_i32("seed") + m_ready + 1);
+    m_ready++;
+    m_cond.notify_all();
+  }
+
+  while (true) {
+    {
+      ScopedLock lock(m_mutex);
+      while (m_queue.empty() && !m_finished)
+        m_cond.wait(lock);
+      if (m_queue.empty())
+        break;
+      request = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    int64_t start = get_ts64();
+    row = format(m_row_format.c_str(), (Llu)request.record);
+
+    try {
+      if (request.op != UPDATE) {
+        scan_spec.clear();
+        scan_spec.add_column(m_column_family.c_str());
+        if (request.op == SCAN) {
+          scan_spec.add_row_interval(row.c_str(), true, Key::END_ROW_MARKER,
+                                     false);
+          scan_spec.set_row_limit(m_scan_length);
+        }
+        else
+          scan_spec.add_row(row.c_str());
+        client->create_scanner(m_tablename, scan_spec.get());
+        client->get_all_cells();
+        client->close_scanner();
+      }
+      if (request.op == UPDATE || request.op == READ_MODIFY_WRITE) {
+        for (size_t i=0; i<value.size(); ++i)
+          value[i] = 'a' + (char)(rng() % 26);
+        cells.clear();
+        cells.push_back(Cell(row.c_str(), m_column_family.c_str(), 0,
+                             AUTO_ASSIGN, AUTO_ASSIGN,
+                             (uint8_t *)value.c_str(), value.size(),
+                             FLAG_INSERT));
+        client->set_cells(cells);
+        client->flush();
+      }
+    }
+    catch (std::exception &e) {
+      if (m_stats[request.op].errors++ < MAX_LOGGED_ERRORS)
+        HT_ERRORF("%s of row '%s' failed - %s", name(request.op),
+                  row.c_str(), e.what());
+    }
+
+    int64_t end = get_ts64();
+    m_stats[request.op].service.record((uint64_t)(end - start) / 1000);
+    m_stats[request.op].response.record(
+        (uint64_t)std::max((int64_t)0, end - request.scheduled) / 1000);
+  }
+
+  LocationCache::Statistics stats;
+  if (client->get_location_cache_statistics(stats)) {
+    ScopedLock lock(m_mutex);
+    m_location_cache.hits += stats.hits;
+    m_location_cache.misses += stats.misses;
+    m_location_cache.negative_hits += stats.negative_hits;
+    m_location_cache.evictions += stats.evictions;
+    m_location_cache.entries += stats.entries;
+  }
+}
+
+
+void WorkloadGenerator::report_json(std::ostream &out) {
+  out << "{\n  \"table\": \"" << m_tablename << "\",\n"
+      << "  \"rate\": " << m_rate << ",\n"
+      << "  \"arrival\": \"" << (m_poisson ? "poisson" : "uniform") << "\",\n"
+      << "  \"duration\": " << m_duration << ",\n"
+      << "  \"workers\": " << m_workers << ",\n"
+      << "  \"record_count\": " << m_record_count << ",\n"
+      << "  \"key_distribution\": \"" << m_key_distribution << "\",\n"
+      << "  \"scheduled\": " << m_scheduled << ",\n"
+      << "  \"elapsed\": " << format("%.3f", m_elapsed) << ",\n"
+      << "  \"throughput\": "
+      << format("%.1f", m_elapsed > 0 ? m_scheduled / m_elapsed : 0.0) << ",\n"
+      << "  \"max_queue_depth\": " << m_max_queue_depth << ",\n"
+      << "  \"operations\": {";
+  bool first = true;
+  for (int i=0; i<OPERATION_COUNT; ++i) {
+    double proportion = m_cumulative[i] - (i ? m_cumulative[i-1] : 0.0);
+    if (proportion <= 0.0)
+      continue;
+    out << (first ? "\n" : ",\n") << "    \"" << name(i) << "\": {\n"
+        << "      \"proportion\": " << format("%.4f", proportion) << ",\n"
+        << "      \"errors\": " << m_stats[i].errors.load() << ",\n"
+        << "      \"response_time_us\": ";
+    json_histogram(out, m_stats[i].response);
+    out << ",\n      \"service_time_us\": ";
+    json_histogram(out, m_stats[i].service);
+    out << "\n    }";
+    first = false;
+  }
+  out << "\n  },\n"
+      << "  \"location_cache\": {\n"
+      << "    \"hits\": " << m_location_cache.hits << ",\n"
+      << "    \"misses\": " << m_location_cache.misses << ",\n"
+      << "    \"negative_hits\": " << m_location_cache.negative_hits << ",\n"
+      << "    \"evictions\": " << m_location_cache.evictions << "\n"
+      << "  }\n}\n";
+}
+
+
+void WorkloadGenerator::report_text(std::ostream &out) {
+  out << "\n"
+      << format("        Elapsed time: %.2f s\n", m_elapsed)
+      << format("Scheduled operations: %llu\n", (Llu)m_scheduled)
+      << format(" Throughput (ops/s): %.2f (offered %.2f)\n",
+                m_elapsed > 0 ? m_scheduled / m_elapsed : 0.0, m_rate)
+      << format("     Max queue depth: %llu\n", (Llu)m_max_queue_depth)
+      << format(" Location cache hits: %llu (misses %llu, negative hits %llu, "
+                "evictions %llu)\n\n", (Llu)m_location_cache.hits,
+                (Llu)m_location_cache.misses,
+                (Llu)m_location_cache.negative_hits,
+                (Llu)m_location_cache.evictions);
+
+  out << format("%-18s %-9s %10s %8s %10s", "Operation", "Latency",
+                "Count", "Errors", "Mean(us)");
+  for (size_t i=0; i<percentile_count; ++i)
+    out << format(" %10s", percentile_name(percentiles[i]).c_str());
+  out << format(" %10s\n", "Max");
+
+  for (int i=0; i<OPERATION_COUNT; ++i) {
+    for (int j=0; j<2; ++j) {
+      LatencyHistogram::Snapshot snapshot;
+      if (j == 0)
+        m_stats[i].response.snapshot(snapshot);
+      else
+        m_stats[i].service.snapshot(snapshot);
+      if (snapshot.count == 0)
+        continue;
+      out << format("%-18s %-9s %10llu %8llu %10.1f", name(i),
+                    j == 0 ? "response" : "service", (Llu)snapshot.count,
+                    (Llu)m_stats[i].errors.load(), snapshot.mean());
+      for (size_t k=0; k<percentile_count; ++k)
+        out << format(" %10llu", (Llu)snapshot.percentile(percentiles[k]));
+      out << format(" %10llu\n", (Llu)snapshot.max);
+    }
+  }
+  out << std::endl;
+}
@@ -0,0 +1,233 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2013 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+/** @file
+ * Declarations for WorkloadGenerator.
+ * This file contains declarations for WorkloadGenerator, a YCSB-style
+ * open-loop workload driver that reports latency percentiles per operation
+ * type.
+ */
+
+#ifndef HYPERTABLE_WORKLOADGENERATOR_H
+#define HYPERTABLE_WORKLOADGENERATOR_H
+
+#include "Common/DiscreteRandomGenerator.h"
+#include "Common/LatencyHistogram.h"
+#include "Common/Mutex.h"
+#include "Common/Properties.h"
+#include "Common/String.h"
+
+#include "Hypertable/Lib/LocationCache.h"
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/thread/condition.hpp>
+
+#include <atomic>
+#include <deque>
+#include <iosfwd>
+
+namespace Hypertable {
+
+  /** Open-loop workload generator.
+   * Operations arrive at a configured rate, independent of how quickly the
+   * cluster serves them, and are handed to a pool of worker threads, each
+   * with its own LoadClient.  An operation's response time is measured
+   * from the time it was scheduled to arrive, not from the time a worker
+   * picked it up, so queueing behind slow requests shows up in the
+   * percentiles instead of silently lowering the offered load (coordinated
+   * omission).  Service time, from pickup to completion, is recorded
+   * separately.
+   *
+   * The operation mix is given by the read, update, scan and
+   * read-modify-write proportions.  Row keys are drawn from a
+   * DiscreteRandomGenerator over a fixed number of records (zipf by
+   * default), and every operation touches one column family.
+   *
+   * Configuration is read from the following properties:
+   *   - <code>rate</code>: arrival rate in operations per second
+   *   - <code>arrival</code>: <code>poisson</code> (exponential
+   *     inter-arrival times) or <code>uniform</code> (fixed interval)
+   *   - <code>duration</code>: seconds to generate arrivals for
+   *   - <code>parallel</code>: number of worker threads
+   *   - <code>record-count</code>, <code>key-distribution</code>,
+   *     <code>row-format</code>: key space
+   *   - <code>read-proportion</code>, <code>update-proportion</code>,
+   *     <code>scan-proportion</code>, <code>rmw-proportion</code>
+   *   - <code>scan-length</code>, <code>column-family</code>,
+   *     <code>value-size</code>, <code>seed</code>, <code>thrift</code>
+   */
+  class WorkloadGenerator {
+  public:
+
+    /// Operation types
+    enum Operation {
+      READ = 0,           //!< Single row read
+      UPDATE,             //!< Single cell write, flushed
+      SCAN,               //!< Scan of <code>scan-length</code> rows
+      READ_MODIFY_WRITE,  //!< Read of a row followed by a write to it
+      OPERATION_COUNT
+    };
+
+    /** Constructor.
+     * @param tablename Name of table to run the workload against
+     */
+    WorkloadGenerator(const String &tablename);
+
+    /** Runs the workload.
+     * Generates arrivals for the configured duration and returns once all
+     * operations have completed.
+     */
+    void run();
+
+    /** Writes results as JSON.
+     * @param out Output stream
+     */
+    void report_json(std::ostream &out);
+
+    /** Writes a human readable summary.
+     * @param out Output stream
+     */
+    void report_text(std::ostream &out);
+
+    /** Returns name of an operation type.
+     * @param op Operation type
+     * @return Name used in reports
+     */
+    static const char *name(int op);
+
+  private:
+
+    /// Scheduled operation
+    struct Request {
+      /// Operation type
+      int op;
+      /// Record number of the row key
+      uint64_t record;
+      /// Scheduled arrival time (nanoseconds, see get_ts64())
+      int64_t scheduled;
+    };
+
+    /// Per operation type results
+    struct Stats {
+      Stats() : errors(0) { }
+      /// Scheduled arrival to completion
+      LatencyHistogram response;
+      /// Pickup by a worker to completion
+      LatencyHistogram service;
+      /// Number of failed operations
+      std::atomic<uint64_t> errors;
+    };
+
+    /// Worker thread body
+    void worker();
+
+    /** Picks the next operation type according to the proportions.
+     * @return Operation type
+     */
+    int next_operation();
+
+    /// Returns the time until the next arrival (nanoseconds)
+    int64_t next_interval();
+
+    /// Table name
+    String m_tablename;
+
+    /// Arrival rate (operations/s)
+    double m_rate;
+
+    /// True for poisson arrivals, false for a fixed interval
+    bool m_poisson;
+
+    /// Seconds to generate arrivals for
+    int32_t m_duration;
+
+    /// Number of worker threads
+    int32_t m_workers;
+
+    /// Number of rows keys are drawn from
+    int64_t m_record_count;
+
+    /// Key distribution specification
+    String m_key_distribution;
+
+    /// printf format of row keys, applied to the record number
+    String m_row_format;
+
+    /// Cumulative operation proportions, indexed by Operation
+    double m_cumulative[OPERATION_COUNT];
+
+    /// Rows per scan
+    int32_t m_scan_length;
+
+    /// Column family read and written
+    String m_column_family;
+
+    /// Size of written values
+    int32_t m_value_size;
+
+    /// Use the Thrift broker instead of the native client
+    bool m_thrift;
+
+    /// Random number generator for arrivals and the operation mix
+    boost::mt19937 m_rng;
+
+    /// Uniform [0,1) distribution over m_rng
+    boost::uniform_01<boost::mt19937> m_u01;
+
+    /// Key generator
+    DiscreteRandomGeneratorPtr m_keys;
+
+    /// Mutex protecting m_queue and m_finished
+    Mutex m_mutex;
+
+    /// Signalled when a request is queued or generation finishes
+    boost::condition m_cond;
+
+    /// Requests waiting for a worker
+    std::deque<Request> m_queue;
+
+    /// Set when no more requests will be queued
+    bool m_finished;
+
+    /// Number of workers that are connected
+    int32_t m_ready;
+
+    /// Largest number of requests waiting for a worker
+    size_t m_max_queue_depth;
+
+    /// Seconds from first arrival to last completion
+    double m_elapsed;
+
+    /// Number of scheduled operations
+    uint64_t m_scheduled;
+
+    /// Results, indexed by Operation
+    Stats m_stats[OPERATION_COUNT];
+
+    /// Location cache counters summed over the workers' clients
+    LocationCache::Statistics m_location_cache;
+  };
+
+}
+
+#endif // HYPERTABLE_WORKLOADGENERATOR_H
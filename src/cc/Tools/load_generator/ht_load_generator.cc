@@ -55,6 +55,7 @@ extern "C" {
 #include "LoadThread.h"
 #include "QueryThread.h"
 #include "ParallelLoad.h"
+#include "WorkloadGenerator.h"
 
 using namespace Hypertable;
 using namespace Hypertable::Config;
@@ -69,7 +70,14 @@ namespace {
     "Description:\n"
     "  This program is used to generate load on a Hypertable\n"
     "  cluster.  The <type> argument indicates the type of load\n"
-    "  to generate ('query' or 'update').\n\n"
+    "  to generate ('query', 'update' or 'ycsb').\n\n"
+    "  The 'query' and 'update' loads are closed-loop: each request is\n"
+    "  sent when the previous one completes.  The 'ycsb' load is open-loop:\n"
+    "  reads, updates, scans and read-modify-writes arrive at --rate\n"
+    "  operations per second regardless of how fast they complete, are\n"
+    "  served by --parallel worker threads, and latency percentiles are\n"
+    "  reported per operation type, measured from each operation's\n"
+    "  scheduled arrival time.\n\n"
     "Options";
 
   struct AppPolicy : Config::Policy {
@@ -109,6 +117,36 @@ namespace {
          "Generate load via Thrift interface instead of C++ client library")
         ("version", "Show version information and exit")
         ("overwrite-delete-flag", str(), "Force delete flag (DELETE_ROW, DELETE_CELL, DELETE_COLUMN_FAMILY)")
+        ("rate", f64()->default_value(1000.0),
+         "[ycsb] Arrival rate (operations/s)")
+        ("arrival", str()->default_value("poisson"),
+         "[ycsb] Arrival process (poisson, uniform)")
+        ("duration", i32()->default_value(60),
+         "[ycsb] Number of seconds to generate arrivals for")
+        ("record-count", i64()->default_value(1000000),
+         "[ycsb] Number of distinct row keys")
+        ("key-distribution", str()->default_value("zipf"),
+         "[ycsb] Row key distribution (uniform, zipf, 'zipf --s=<s>')")
+        ("row-format", str()->default_value("user%012llu"),
+         "[ycsb] printf-style format rendering the record number as row key")
+        ("read-proportion", f64()->default_value(0.5),
+         "[ycsb] Proportion of single row reads")
+        ("update-proportion", f64()->default_value(0.5),
+         "[ycsb] Proportion of single cell updates")
+        ("scan-proportion", f64()->default_value(0.0),
+         "[ycsb] Proportion of scans")
+        ("rmw-proportion", f64()->default_value(0.0),
+         "[ycsb] Proportion of read-modify-writes")
+        ("scan-length", i32()->default_value(100),
+         "[ycsb] Number of rows returned by a scan")
+        ("column-family", str()->default_value("col"),
+         "[ycsb] Column family read and written")
+        ("value-size", i32()->default_value(100),
+         "[ycsb] Size of written values")
+        ("output-format", str()->default_value("text"),
+         "[ycsb] Result format (text, json)")
+        ("result-file", str(),
+         "[ycsb] File to write results to instead of stdout")
         ;
       alias("delete-percentage", "DataGenerator.DeletePercentage");
       alias("max-bytes", "DataGenerator.MaxBytes");
@@ -144,6 +182,8 @@ void generate_query_load(PropertiesPtr &props, String &tablename,
 void generate_query_load_parallel(PropertiesPtr &props, String &tablename,
         int32_t parallel);
 
+void generate_open_loop_load(String &tablename);
+
 double std_dev(::uint64_t nn, double sum, double sq_sum);
 
 void parse_command_line(int argc, char **argv, PropertiesPtr &props);
@@ -248,6 +288,8 @@ int main(int argc, char **argv) {
         generate_query_load(generator_props, table, to_stdout, query_delay,
                 sample_fname, thrift);
     }
+    else if (load_type == "ycsb")
+      generate_open_loop_load(table);
     else {
       std::cout << cmdline_desc() << std::flush;
       _exit(1);
@@ -865,6 +907,30 @@ void generate_query_load_parallel(PropertiesPtr &props, String &tablename,
 
 }
 
+void generate_open_loop_load(String &tablename) {
+  String output_format = get_str("output-format");
+  if (output_format != "text" && output_format != "json")
+    HT_THROWF(Error::CONFIG_BAD_VALUE, "Bad output format '%s'",
+              output_format.c_str());
+
+  WorkloadGenerator generator(tablename);
+  generator.run();
+
+  ofstream result_file;
+  if (has("result-file")) {
+    result_file.open(get_str("result-file").c_str());
+    if (!result_file)
+      HT_THROWF(Error::LOCAL_IO_ERROR, "Unable to open result file '%s'",
+                get_str("result-file").c_str());
+  }
+  ostream &out = has("result-file") ? result_file : cout;
+  if (output_format == "json")
+    generator.report_json(out);
+  else
+    generator.report_text(out);
+  out << flush;
+}
+
 
 /**
  * @param nn Size of set of numbers
@@ -46,6 +46,7 @@ extern "C" {
 #include "Hypertable/Lib/RangeState.h"
 #include "Hypertable/Lib/ScanBlock.h"
 #include "Hypertable/Lib/ScanSpec.h"
+#include "Hypertable/Lib/StatsRangeServer.h"
 #include "Hypertable/Lib/TestSource.h"
 
 #include "RangeServerCommandInterpreter.h"
@@ -357,6 +358,23 @@ void RangeServerCommandInterpreter::execute_line(const String &line) {
     else if (state.command == COMMAND_HEAPCHECK) {
       m_range_server->heapcheck(m_addr, state.output_file);
     }
+    else if (state.command == COMMAND_LATENCY) {
+      std::vector<SystemVariable::Spec> specs;
+      StatsRangeServer stats;
+      m_range_server->get_statistics(m_addr, specs, 0, stats);
+      cout << format("%-18s %10s %10s %10s %10s %10s %10s %10s", "metric",
+                     "count", "mean", "p50", "p90", "p99", "p999", "max")
+           << endl;
+      for (std::map<String, LatencyHistogram::Snapshot>::iterator iter =
+             stats.latency.begin(); iter != stats.latency.end(); ++iter) {
+        LatencyHistogram::Snapshot &h = iter->second;
+        cout << format("%-18s %10llu %10.0f %10llu %10llu %10llu %10llu %10llu",
+                       iter->first.c_str(), (Llu)h.count, h.mean(),
+                       (Llu)h.percentile(0.5), (Llu)h.percentile(0.9),
+                       (Llu)h.percentile(0.99), (Llu)h.percentile(0.999),
+                       (Llu)h.max) << endl;
+      }
+    }
     else if (state.command == COMMAND_COMPACT) {
       if (table)
         m_range_server->compact(m_addr, *table, state.str, 0);
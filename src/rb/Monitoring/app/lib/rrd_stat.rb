@@ -1,7 +1,7 @@
 # Author : Sriharsha Chintalapani(harsha@defun.org)
 
-require "#{File.dirname(__FILE__)}/graph.rb"
 require "#{File.dirname(__FILE__)}/stats_json.rb"
+require "#{File.dirname(__FILE__)}/time_series_store.rb"
 class RRDStat
 
   attr_accessor :stats_total, :stats_type,:time_intervals,:selected_stat, :chart_type
@@ -116,12 +116,12 @@ class RRDStat
     "bloom_filter_maybes" ]
   end
 
-  def get_rs_rrd_file(rs)
-    @rs_rrd_dir+"/"+rs.to_s+"_stats_v0.rrd"
+  def get_rs_ts_file(rs)
+    @rs_rrd_dir+"/"+rs.to_s+"_stats_v0.ts"
   end
 
-  def get_table_rrd_file(table)
-    @table_rrd_dir+"/"+table.to_s.gsub("_","/")+"_table_stats_v0.rrd"
+  def get_table_ts_file(table)
+    @table_rrd_dir+"/"+table.to_s.gsub("_","/")+"_table_stats_v0.ts"
   end
 
   def get_server_list
@@ -156,85 +156,60 @@ class RRDStat
   end
 
 
-  def get_rrd_stat_image(server,stat,start_time,end_time)
+  # Returns the history of a statistic of one RangeServer or table (or of
+  # all of them if server is "all") between start_time and end_time as JSON:
+  # a title, units and one series per server and statistic, with its points
+  # and the minimum, average, maximum and last known value.
+  def get_stat_data(type,server,stat,start_time,end_time)
+    graph = { }
     begin
-      rrd_graph_data = []
-      get_rs_info
-      range_servers = { }
-
-      if (server.downcase == "all")
-        range_servers = @server_ip_list
+      if (type.downcase == "table")
+        servers = get_table_info
+        stats_config = @table_stats_config
       else
-        range_servers[:"#{server}"] = @server_ip_list[:"#{server}"]
-      end
-
-      title = @stats_config[:"#{stat}"][:pname]
-      stats_pair = @stats_config[:"#{stat}"][:pair]
-      index = 0
-      range_servers.each_pair do |rs, ip|
-        rrd_file = get_rs_rrd_file(rs)
-        stats_pair.each do |pstat|
-          name = @stats_config[:"#{pstat}"][:pname]
-          color = @stats_config[:"#{pstat}"][:color].first
-          rrd_graph_data << ["#{ip} #{name}   ", "#{rrd_file}:#{pstat}:AVERAGE",color]
-        end
-        index = index + 1
+        servers = get_rs_info
+        stats_config = @stats_config
       end
 
-      image_data = rrd_make_graph(rrd_graph_data,title,start_time,end_time)
-    rescue Exception => err
-      raise err
-    end
-  end
-
-  def get_table_stat_image(server,stat,start_time,end_time)
-    begin
-      rrd_graph_data = []
-      get_table_info
-      range_servers = { }
-
+      selected = { }
       if (server.downcase == "all")
-        range_servers = @server_ip_list
+        selected = servers
       else
-        range_servers[:"#{server}"] = @server_ip_list[:"#{server}"]
+        selected[:"#{server}"] = servers[:"#{server}"]
       end
 
-      title = @table_stats_config[:"#{stat}"][:pname]
-      stats_pair = @table_stats_config[:"#{stat}"][:pair]
-      index = 0
-      range_servers.each_pair do |rs, ip|
-        rrd_file = get_table_rrd_file(rs)
-        puts "harsha "+rrd_file
-        stats_pair.each do |pstat|
-          name = @table_stats_config[:"#{pstat}"][:pname]
-          color = @table_stats_config[:"#{pstat}"][:color].first
-          rrd_graph_data << ["#{ip} #{name}   ", "#{rrd_file}:#{pstat}:AVERAGE",color]
+      graph[:title] = stats_config[:"#{stat}"][:pname]
+      graph[:units] = stats_config[:"#{stat}"][:units]
+      graph[:series] = []
+      selected.each_pair do |id, name|
+        if (type.downcase == "table")
+          ts_file = get_table_ts_file(id)
+        else
+          ts_file = get_rs_ts_file(id)
+        end
+        next unless File.exist?(ts_file)
+        store = TimeSeriesStore.new(ts_file)
+        stats_config[:"#{stat}"][:pair].each do |pstat|
+          resolution, points = store.fetch(pstat.to_s, TimeSeriesStore::AVERAGE,
+                                           start_time.to_i, end_time.to_i)
+          series = { :label => "#{name} #{stats_config[:"#{pstat}"][:pname]}",
+                     :color => stats_config[:"#{pstat}"][:color].first,
+                     :resolution => resolution,
+                     :points => points }
+          known = points.map { |point| point[1] }.compact
+          if !known.empty?
+            series[:min] = known.min
+            series[:avg] = known.inject(0.0) { |sum, value| sum + value } / known.length
+            series[:max] = known.max
+            series[:last] = known.last
+          end
+          graph[:series] << series
         end
-        index = index + 1
       end
-
-      image_data = rrd_make_graph(rrd_graph_data,title,start_time,end_time)
     rescue Exception => err
-      raise err
-    end
-  end
-
-  def rrd_make_graph(rrd_graph_data,title,start_time,end_time)
-    w = 900
-    h = 260
-    line = 2
-    period = end_time.to_f - start_time.to_f
-    expr = RRD::Graph::Expr
-
-    rrd_graph = RRD::Graph.new w, h, title, start_time, end_time  do |g|
-      rrd_graph_data.each do |label, path, color|
-        temp   = expr.read "#{path}"
-        smooth = temp.trendnan period/48.0
-        g.line   line, smooth, label, color
-        g.gprint temp
-      end
+      graph[:error] = err.message
     end
-    rrd_graph.image_data
+    { :graph => graph }.to_json
   end
 
 
@@ -0,0 +1,105 @@
+# Reads the round-robin time series files the Master writes for every
+# RangeServer and table (see src/cc/Hypertable/Master/TimeSeriesStore.cc).
+# All integers are little-endian; values are IEEE 754 doubles and NaN
+# marks an unknown row.
+class TimeSeriesStore
+
+  MAGIC = "HTTSDB01"
+  HEADER_LENGTH = 32
+  NAME_LENGTH = 32
+  ARCHIVE_LENGTH = 16
+
+  AVERAGE = 0
+  MAX = 1
+
+  attr_reader :step, :metrics
+
+  def initialize(filename)
+    @filename = filename
+    File.open(filename, "rb") do |f|
+      header = f.read(HEADER_LENGTH)
+      if header.nil? or header.length < HEADER_LENGTH or header[0,8] != MAGIC
+        raise "#{filename} is not a time series file"
+      end
+      @step, metric_count, archive_count = header[8,12].unpack("V3")
+      @last_slot = header[24,8].unpack("Q<").first
+      @metrics = []
+      metric_count.times { @metrics << f.read(NAME_LENGTH).unpack("Z*").first }
+      @archives = []
+      archive_count.times do
+        consolidation, steps_per_row, rows = f.read(ARCHIVE_LENGTH).unpack("V3")
+        @archives << { :consolidation => consolidation,
+                       :steps_per_row => steps_per_row, :rows => rows }
+      end
+      state_length = 24 + 16 * metric_count
+      @archives.each do |archive|
+        state = f.read(state_length)
+        archive[:acc_row], archive[:first_row], archive[:last_row] = state[0,24].unpack("q<3")
+      end
+      offset = f.pos
+      @archives.each do |archive|
+        archive[:offset] = offset
+        offset += archive[:rows] * 8 * metric_count
+      end
+    end
+  end
+
+  # Time of the most recent sample (seconds), 0 if none
+  def last_update
+    @last_slot * @step
+  end
+
+  # Fetches the rows of a metric between start_time and end_time (seconds)
+  # from the finest archive with the given consolidation function that
+  # covers start_time, or the coarsest one if none does.  Returns the
+  # resolution of the rows (0 if there is no such metric or archive) and
+  # the rows as [timestamp, value] pairs, oldest first, value nil if unknown.
+  def fetch(metric, consolidation, start_time, end_time)
+    column = @metrics.index(metric)
+    return [0, []] if column.nil?
+
+    best = nil
+    best_resolution = 0
+    best_covers = false
+    @archives.each do |archive|
+      next if archive[:consolidation] != consolidation
+      resolution = archive[:steps_per_row] * @step
+      span = resolution * archive[:rows]
+      covers = (last_update < span or last_update - span <= start_time)
+      if best.nil? or (covers and (!best_covers or resolution < best_resolution)) or
+          (!covers and !best_covers and resolution > best_resolution)
+        best = archive
+        best_resolution = resolution
+        best_covers = covers
+      end
+    end
+    return [0, []] if best.nil?
+
+    points = []
+    return [best_resolution, points] if best[:last_row] < 0
+
+    rows = best[:rows]
+    first = [start_time / best_resolution, best[:first_row],
+             best[:last_row] - rows + 1].max
+    last = [end_time / best_resolution, best[:last_row]].min
+    row_length = 8 * @metrics.length
+
+    # Read the rows of the period, in at most two pieces as the ring wraps
+    File.open(@filename, "rb") do |f|
+      row = first
+      while row <= last
+        position = row % rows
+        count = [last - row + 1, rows - position].min
+        f.seek(best[:offset] + position * row_length)
+        data = f.read(count * row_length)
+        count.times do |i|
+          value = data[i * row_length + column * 8, 8].unpack("E").first
+          points << [(row + i) * best_resolution, value.nan? ? nil : value]
+        end
+        row += count
+      end
+    end
+    [best_resolution, points]
+  end
+
+end
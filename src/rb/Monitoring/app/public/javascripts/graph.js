@@ -218,17 +218,127 @@ var RSGraph = new Class({
         if ( selected_server != this.options.stat) {
             selected_server = this.options.stat + " (" + selected_server + ")";
         }
-        this.graphHeader.set('text',"RRD Graphs for "+selected_server);
+        this.graphHeader.set('text',"Graphs for "+selected_server);
         for (i=0; i < this.data['stats'].length; i++) {
             key = this.data['stats'][i];
             this.buildGraphImageContainer();
-            url = this.buildGraphImageUrl(key);
-            img = new Element('img', {'src':url,'height':360,'width':1000});
-            $(this.graphImageContainer).grab(img);
+            var canvas = new Element('canvas', {'height':300,'width':1000});
+            var legend = new Element('div', {'class':'graph legend',
+                                              'styles': {'text-align':'left',
+                                                         'margin-left':'90px',
+                                                         'font-family':'monospace'}});
+            $(this.graphImageContainer).grab(canvas);
+            $(this.graphImageContainer).grab(legend);
             $(this.graphContainer).grab(this.graphImageContainer);
+            this.getStatData(key, canvas, legend);
         }
     },
 
+    // fetches the history of one statistic and draws it into canvas
+    getStatData: function(key, canvas, legend) {
+        new Request.JSONP({
+            url: this.buildGraphImageUrl(key),
+            secure: this.options.secureJSON,
+            method: this.options.httpMethod,
+            onComplete: function(json) {
+                if (json['graph']['error']) {
+                    legend.set('text', json['graph']['error']);
+                    return;
+                }
+                this.drawStatGraph(canvas, legend, json['graph']);
+            }.bind(this)
+        }).send();
+    },
+
+    formatValue: function(value) {
+        var suffixes = ['', 'k', 'M', 'G', 'T', 'P'];
+        var i = 0;
+        while (Math.abs(value) >= 1000 && i < suffixes.length - 1) {
+            value = value / 1000;
+            i++;
+        }
+        return value.toFixed(1) + suffixes[i];
+    },
+
+    drawStatGraph: function(canvas, legend, graph) {
+        var ctx = canvas.getContext('2d');
+        var left = 80, right = 20, top = 30, bottom = 30;
+        var width = canvas.width - left - right;
+        var height = canvas.height - top - bottom;
+        var tmin = this.parseGraphDateSecs(this.options.start_time);
+        var tmax = this.parseGraphDateSecs(this.options.end_time);
+        var vmax = 0;
+
+        graph['series'].each(function(series) {
+            series['points'].each(function(point) {
+                if (point[1] != null && point[1] > vmax)
+                    vmax = point[1];
+            });
+        });
+        if (vmax == 0)
+            vmax = 1;
+
+        ctx.font = '12px sans-serif';
+        ctx.fillStyle = '#000';
+        ctx.textAlign = 'center';
+        ctx.fillText(graph['title'], canvas.width / 2, 15);
+
+        // horizontal grid with value labels, time labels below
+        ctx.strokeStyle = this.options.gridBorderColour;
+        ctx.lineWidth = 1;
+        ctx.textAlign = 'right';
+        for (var i=0; i<=4; i++) {
+            var y = top + height - height * i / 4;
+            ctx.beginPath();
+            ctx.moveTo(left, y);
+            ctx.lineTo(left + width, y);
+            ctx.stroke();
+            ctx.fillText(this.formatValue(vmax * i / 4) + ' ' + graph['units'],
+                         left - 5, y + 4);
+        }
+        ctx.textAlign = 'center';
+        for (var i=0; i<=5; i++) {
+            var x = left + width * i / 5;
+            var t = new Date((tmin + (tmax - tmin) * i / 5) * 1000);
+            ctx.fillText(t.format('%m-%d %H:%M'), x, top + height + 18);
+        }
+
+        // one line per series, broken where values are unknown
+        graph['series'].each(function(series) {
+            ctx.strokeStyle = series['color'];
+            ctx.lineWidth = 2;
+            ctx.beginPath();
+            var drawing = false;
+            series['points'].each(function(point) {
+                if (point[1] == null || point[0] < tmin || point[0] > tmax) {
+                    drawing = false;
+                    return;
+                }
+                var x = left + (point[0] - tmin) / (tmax - tmin) * width;
+                var y = top + height - point[1] / vmax * height;
+                if (drawing)
+                    ctx.lineTo(x, y);
+                else
+                    ctx.moveTo(x, y);
+                drawing = true;
+            });
+            ctx.stroke();
+
+            var line = new Element('div');
+            line.grab(new Element('span', {'html':'&#9632; ',
+                                           'styles': {'color':series['color']}}));
+            var text = series['label'];
+            if (series['max'] != null) {
+                text += '  min ' + this.formatValue(series['min']) +
+                        '  avg ' + this.formatValue(series['avg']) +
+                        '  max ' + this.formatValue(series['max']) +
+                        '  last ' + this.formatValue(series['last']);
+            }
+            line.grab(new Element('span', {'text':text}));
+            legend.grab(line);
+        }.bind(this));
+    },
+
     buildGraphImageUrl: function(key) {
         url = ['/graph'];
 	url.push(this.options.type);
@@ -132,14 +132,9 @@ module HTMonitoring
     end
 
     get '/graph/:type/:server/:stat/:starttime/:endtime' do
-      content_type 'image/gif'
-      if params[:type].downcase == "rangeserver"
-        rrd_stats = RRDStat.new
-        image_data = rrd_stats.get_rrd_stat_image params[:server],params[:stat],params[:starttime],params[:endtime]
-      elsif params[:type].downcase == "table"
-        rrd_stats = RRDStat.new
-        image_data = rrd_stats.get_table_stat_image params[:server],params[:stat],params[:starttime],params[:endtime]
-      end
+      rrd_stats = RRDStat.new
+      json = rrd_stats.get_stat_data params[:type],params[:server],params[:stat],params[:starttime],params[:endtime]
+      graph_callback(json)
     end
 
      get '/data/:type/:stat/:timestamp_index/:sort_by/:resolution' do
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+
+HT_HOME=${INSTALL_DIR:-"$HOME/hypertable/current"}
+SCRIPT_DIR=`dirname $0`
+RATE=${RATE:-"200"}
+DURATION=${DURATION:-"10"}
+
+$HT_HOME/bin/start-test-servers.sh --clear --no-thriftbroker
+
+$HT_HOME/bin/ht shell --no-prompt < $SCRIPT_DIR/create-table.hql
+
+$HT_HOME/bin/ht ht_load_generator ycsb \
+    --table=YcsbTest \
+    --rate=$RATE \
+    --duration=$DURATION \
+    --parallel=4 \
+    --record-count=1000 \
+    --read-proportion=0.4 \
+    --update-proportion=0.3 \
+    --scan-proportion=0.1 \
+    --rmw-proportion=0.2 \
+    --output-format=json \
+    --result-file=ycsb.output
+
+if [ $? != 0 ] || [ ! -s ycsb.output ]; then
+  echo "ht_load_generator ycsb failed, exiting ..."
+  exit 1
+fi
+
+# Every scheduled operation is accounted for in the response time
+# histograms of its type, without errors, and repeated lookups of the
+# table's ranges are served by the clients' location caches
+awk -v rate=$RATE -v duration=$DURATION '
+  /"scheduled":/ { gsub(/[^0-9]/, "", $2); scheduled = $2 }
+  /"hits":/ { gsub(/[^0-9]/, "", $2); hits = $2 }
+  /"errors":/ { gsub(/[^0-9]/, "", $2); errors += $2 }
+  /"response_time_us":/ { gsub(/[^0-9]/, "", $3); completed += $3; types++ }
+  END {
+    if (types != 4) { print "expected 4 operation types, got " types; exit 1 }
+    if (errors != 0) { print errors " operations failed"; exit 1 }
+    if (completed != scheduled) {
+      print completed " of " scheduled " operations completed"; exit 1
+    }
+    if (scheduled < rate * duration / 2) {
+      print "only " scheduled " operations scheduled"; exit 1
+    }
+    if (hits == 0) { print "no location cache hits"; exit 1 }
+  }' ycsb.output
+
+if [ $? != 0 ]; then
+  echo "Test failed, exiting ..."
+  cat ycsb.output
+  exit 1
+fi
+
+exit 0
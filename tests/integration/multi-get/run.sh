@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+
+HT_HOME=${INSTALL_DIR:-"$HOME/hypertable/current"}
+TEST_BIN=./multi_get_test
+
+set -v
+
+# Small ranges so that the batch spans many ranges and servers are still
+# splitting them while it is fetched
+$HT_HOME/bin/start-test-servers.sh --clear --no-thriftbroker \
+    --Hypertable.RangeServer.Range.SplitSize=400K
+
+cd ${TEST_BIN_DIR};
+${TEST_BIN}
+if [ $? != 0 ] ; then
+  echo "${TEST_BIN} failed"
+  exit 1
+fi
+
+exit 0